@@ -0,0 +1,84 @@
+#!/usr/bin/python
+# GemRB - Infinity Engine Emulator
+# Copyright (C) 2011 The GemRB Project
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# Precompiles the shared and the game type specific GUIScripts into a single
+# zip, which GUIScript::Init puts in front of the loose files as long as it is
+# newer than all of them. Run it with the same python version GemRB links to,
+# since the bytecode is only valid for that one.
+import imp
+import marshal
+import os
+import struct
+import sys
+import time
+import zipfile
+
+def usage():
+  print("Usage:", sys.argv[0], "GUIScripts-dir gametype output.zip")
+  print()
+  print("Example:")
+  print("python bundle_guiscripts.py gemrb/GUIScripts bg2 gemrb/GUIScripts/bg2.zip")
+
+def collect(directory, scripts):
+  for name in sorted(os.listdir(directory)):
+    path = os.path.join(directory, name)
+    if name.endswith(".py") and os.path.isfile(path):
+      # the game type specific scripts shadow the shared ones
+      scripts[name[:-3]] = path
+
+def compile_script(path, label):
+  with open(path, "rU") as source:
+    code = compile(source.read() + "\n", label, "exec")
+  mtime = int(os.stat(path).st_mtime)
+  return imp.get_magic() + struct.pack("<I", mtime & 0xFFFFFFFF) + marshal.dumps(code)
+
+if len(sys.argv) != 4:
+  usage()
+  sys.exit(1)
+
+root, game, output = sys.argv[1:]
+if not os.path.isdir(os.path.join(root, game)):
+  print("Error: no such game type directory:", os.path.join(root, game))
+  sys.exit(1)
+
+scripts = {}
+collect(root, scripts)
+collect(os.path.join(root, game), scripts)
+
+try:
+  import zlib
+  compression = zipfile.ZIP_DEFLATED
+except ImportError:
+  compression = zipfile.ZIP_STORED
+
+# write to a temporary name, so an aborted run doesn't leave a stale bundle
+temp = output + ".tmp"
+bundle = zipfile.ZipFile(temp, "w", compression)
+now = time.localtime()[:6]
+for module in sorted(scripts):
+  path = scripts[module]
+  label = os.path.relpath(path, os.path.dirname(os.path.abspath(root)))
+  entry = zipfile.ZipInfo(module + ".pyc", now)
+  entry.compress_type = compression
+  bundle.writestr(entry, compile_script(path, label))
+bundle.close()
+if os.path.exists(output):
+  os.remove(output)
+os.rename(temp, output)
+print("Bundled %d scripts into %s" % (len(scripts), output))
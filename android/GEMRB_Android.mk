@@ -154,6 +154,7 @@ LOCAL_SRC_FILES :=  main/gemrb/plugins/SAVImporter/SAVImporter.cpp \
 		    main/gemrb/core/System/Logger/File.cpp \
 		    main/gemrb/core/System/Logger/Stdio.cpp \
 		    main/gemrb/core/System/Logger/Android.cpp \
+		    main/gemrb/core/System/AndroidMemory.cpp \
 		    main/gemrb/core/System/StringBuffer.cpp \
 		    main/gemrb/core/System/VFS.cpp \
 		    main/gemrb/core/System/String.cpp \
@@ -133,6 +133,14 @@ public class GemRB extends SDLActivity {
       }
   }
 
+  // SDL only forwards onLowMemory, the earlier levels let us give back the caches first
+  public static native void nativeTrimMemory(int level);
+
+  public void onTrimMemory(int level) {
+    super.onTrimMemory(level);
+    nativeTrimMemory(level);
+  }
+
   public void onConfigurationChanged(Configuration newConfig) {
     // we're only overriding for orientation change (cmp AndroidManifest.xml)
     // but we don't actually want to react to that
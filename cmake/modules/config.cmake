@@ -13,6 +13,8 @@ CHECK_FUNCTION_EXISTS("strndup" HAVE_STRNDUP)
 CHECK_FUNCTION_EXISTS("strlcpy" HAVE_STRLCPY)
 CHECK_FUNCTION_EXISTS("setenv" HAVE_SETENV)
 CHECK_FUNCTION_EXISTS("ldexpf" HAVE_LDEXPF)
+CHECK_FUNCTION_EXISTS("mmap" HAVE_MMAP)
+CHECK_FUNCTION_EXISTS("inotify_init1" HAVE_INOTIFY_INIT1)
 
 INCLUDE(CheckIncludeFiles)
 CHECK_INCLUDE_FILES("unistd.h" HAVE_UNISTD_H)
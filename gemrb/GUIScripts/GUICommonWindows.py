@@ -2067,6 +2067,9 @@ def HideInterface(): #todo:should really add to pst if possible
 def ToggleAlwaysRun():
 	GemRB.GameControlToggleAlwaysRun()
 
+def ToggleFrameStats():
+	GemRB.ToggleFrameStats()
+
 def RestPress ():
 	GUICommon.CloseOtherWindow(None)
 	# only rest if the dream scripts haven't already
@@ -34,6 +34,9 @@ public:
 	virtual ~ActorMgr(void);
 	virtual bool Open(DataStream* stream) = 0;
 	virtual Actor* GetActor(unsigned char is_in_party) = 0;
+	/** Reads the saved effects of the opened creature ahead of GetActor.
+	 * It only touches the opened stream, so it may run on another thread. */
+	virtual void DecodeEffects() {}
   virtual int FindSpellType(char *name, unsigned short &level, unsigned int clsmsk, unsigned int kit) const = 0;
 
 	//returns saved size, updates internal offsets before save
@@ -23,6 +23,7 @@
 #include "win32def.h"
 
 #include "Game.h"
+#include "InputRecord.h"
 #include "Interface.h"
 #include "Map.h"
 #include "Sprite2D.h"
@@ -36,7 +37,7 @@ Animation::Animation(int count)
 	frames = (Sprite2D **) calloc(count, sizeof(Sprite2D *));
 	indicesCount = count;
 	if (count) {
-		pos = RAND(0, count-1);
+		pos = VISUAL_RAND(0, count-1);
 	}
 	else {
 		pos = 0;
@@ -114,7 +115,7 @@ Sprite2D* Animation::LastFrame(void)
 	if (gameAnimation) {
 		starttime = core->GetGame()->Ticks;
 	} else {
-		starttime = GetTickCount();
+		starttime = InputRecord::GetTicks();
 	}
 	Sprite2D* ret;
 	if (playReversed)
@@ -134,7 +135,7 @@ Sprite2D* Animation::NextFrame(void)
 		if (gameAnimation) {
 			starttime = core->GetGame()->Ticks;
 		} else {
-			starttime = GetTickCount();
+			starttime = InputRecord::GetTicks();
 		}
 	}
 	Sprite2D* ret;
@@ -150,7 +151,7 @@ Sprite2D* Animation::NextFrame(void)
 	if (gameAnimation) {
 		time = core->GetGame()->Ticks;
 	} else {
-		time = GetTickCount();
+		time = InputRecord::GetTicks();
 	}
 
 	//it could be that we skip more than one frame in case of slow rendering
@@ -23,7 +23,9 @@
 #include "win32def.h"
 
 #include "Interface.h"
+#include "MemoryStats.h"
 #include "Sprite2D.h"
+#include "Video.h"
 
 namespace GemRB {
 
@@ -32,6 +34,7 @@ AnimationFactory::AnimationFactory(const char* ResRef)
 {
 	FLTable = NULL;
 	FrameData = NULL;
+	FrameDataSize = 0;
 	datarefcount = 0;
 }
 
@@ -40,6 +43,11 @@ AnimationFactory::~AnimationFactory(void)
 	for (unsigned int i = 0; i < frames.size(); i++) {
 		frames[i]->release();
 	}
+	for (int m = 0; m < 3; m++) {
+		for (unsigned int i = 0; i < mirrored[m].size(); i++) {
+			Sprite2D::FreeSprite(mirrored[m][i]);
+		}
+	}
 	if (FLTable)
 		free( FLTable);
 
@@ -48,8 +56,10 @@ AnimationFactory::~AnimationFactory(void)
 		Log(ERROR, "AnimationFactory", "AnimationFactory %s has refcount %d", ResRef, datarefcount);
 		//assert(datarefcount == 0);
 	}
-	if (FrameData)
+	if (FrameData) {
+		MemoryStats::Remove(MEM_BAM_FRAMES, FrameDataSize);
 		free( FrameData);
+	}
 }
 
 void AnimationFactory::AddFrame(Sprite2D* frame)
@@ -72,13 +82,44 @@ void AnimationFactory::LoadFLT(unsigned short* buffer, int count)
 	memcpy( FLTable, buffer, count * sizeof( unsigned short ) );
 }
 
-void AnimationFactory::SetFrameData(unsigned char* FrameData)
+void AnimationFactory::SetFrameData(unsigned char* FrameData, unsigned long size)
 {
 	this->FrameData = FrameData;
+	FrameDataSize = size;
+	MemoryStats::Add(MEM_BAM_FRAMES, size);
 }
 
 
-Animation* AnimationFactory::GetCycle(unsigned char cycle)
+Sprite2D* AnimationFactory::GetMirroredFrame(unsigned short index, bool mirrorX, bool mirrorY)
+{
+	std::vector<Sprite2D*> &cache = mirrored[(mirrorX ? 1 : 0) + (mirrorY ? 2 : 0) - 1];
+	if (cache.size() < frames.size()) {
+		cache.resize(frames.size(), NULL);
+	}
+	if (!cache[index]) {
+		// the same as Animation::MirrorAnimation and MirrorAnimationVert would make
+		Video *video = core->GetVideoDriver();
+		Sprite2D* spr = frames[index];
+		spr->acquire();
+		if (mirrorX) {
+			Sprite2D* tmp = spr;
+			spr = video->MirrorSpriteHorizontal(tmp, true);
+			tmp->release();
+		}
+		if (mirrorY) {
+			Sprite2D* tmp = spr;
+			spr = video->MirrorSpriteVertical(tmp, true);
+			tmp->release();
+		}
+		cache[index] = spr;
+	}
+	cache[index]->acquire();
+	return cache[index];
+}
+
+/* the mirrored frames are shared by everyone asking for the same cycle, the
+ * animation area comes out as flipped by MirrorAnimation */
+Animation* AnimationFactory::GetCycle(unsigned char cycle, bool mirrorX, bool mirrorY)
 {
 	if (cycle >= cycles.size()) {
 		return NULL;
@@ -88,6 +129,10 @@ Animation* AnimationFactory::GetCycle(unsigned char cycle)
 	Animation* anim = new Animation( cycles[cycle].FramesCount );
 	int c = 0;
 	for (int i = ff; i < lf; i++) {
+		if (mirrorX || mirrorY) {
+			anim->AddFrame( GetMirroredFrame(FLTable[i], mirrorX, mirrorY), c++ );
+			continue;
+		}
 		frames[FLTable[i]]->acquire();
 		anim->AddFrame( frames[FLTable[i]], c++ );
 	}
@@ -131,7 +176,8 @@ Sprite2D* AnimationFactory::GetPaperdollImage(ieDword *Colors,
 		return NULL;
 	}
 	if (Colors) {
-		Palette* palette = Picture2->GetPalette();
+		// the frames share the palette of the factory
+		Palette* palette = Picture2->GetPalette()->Unshare();
 		palette->SetupPaperdollColours(Colors, type);
 		Picture2->SetPalette(palette);
 		palette->release();
@@ -142,7 +188,8 @@ Sprite2D* AnimationFactory::GetPaperdollImage(ieDword *Colors,
 
 	Sprite2D* spr = frames[0]->copy();
 	if (Colors) {
-		Palette* palette = spr->GetPalette();
+		// the frames share the palette of the factory
+		Palette* palette = spr->GetPalette()->Unshare();
 		palette->SetupPaperdollColours(Colors, type);
 		spr->SetPalette(palette);
 		palette->release();
@@ -33,18 +33,23 @@ namespace GemRB {
 class GEM_EXPORT AnimationFactory : public FactoryObject {
 private:
 	std::vector< Sprite2D*> frames;
+	// the mirrored frames, made on first use and shared by all the cycles
+	// one vector for each of x, y and both
+	std::vector< Sprite2D*> mirrored[3];
 	std::vector< CycleEntry> cycles;
 	unsigned short* FLTable;	// Frame Lookup Table
 	unsigned char* FrameData;
+	unsigned long FrameDataSize;
 	int datarefcount;
+	Sprite2D* GetMirroredFrame(unsigned short index, bool mirrorX, bool mirrorY);
 public:
 	AnimationFactory(const char* ResRef);
 	~AnimationFactory(void);
 	void AddFrame(Sprite2D* frame);
 	void AddCycle(CycleEntry cycle);
 	void LoadFLT(unsigned short* buffer, int count);
-	void SetFrameData(unsigned char* FrameData);
-	Animation* GetCycle(unsigned char cycle);
+	void SetFrameData(unsigned char* FrameData, unsigned long size);
+	Animation* GetCycle(unsigned char cycle, bool mirrorX = false, bool mirrorY = false);
 	/** No descriptions */
 	Sprite2D* GetFrame(unsigned short index, unsigned char cycle=0) const;
 	Sprite2D* GetFrameWithoutCycle(unsigned short index) const;
@@ -0,0 +1,166 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "AnimationPreloader.h"
+
+#include "win32def.h"
+
+#include "FileCache.h"
+#include "PluginMgr.h"
+#include "System/DataStream.h"
+#include "System/String.h"
+
+namespace GemRB {
+
+class PreloadJob : public Job {
+public:
+	PreloadJob(const std::string &resref, DataStream *stream, Holder<AnimationMgr> &importer, Compressor *comp)
+		: Job("AnimationPreloader::Open"), resref(resref), stream(stream), comp(comp), ok(false), finished(false)
+	{
+		this->importer.swap(importer);
+	}
+	// only when it never ran
+	~PreloadJob() { delete stream; }
+
+	std::string resref;
+	DataStream *stream;
+	Holder<AnimationMgr> importer;
+	Compressor *comp;
+	bool ok;
+	// set on the main thread, for TakeFinished
+	bool finished;
+protected:
+	void Run();
+	void Completed() { finished = true; }
+};
+
+// expands a compressed BAM and reads the headers, the importer takes the stream
+void PreloadJob::Run()
+{
+	char Signature[8];
+	if (comp && stream->Read(Signature, 8) == 8 && strncmp(Signature, "BAMCV1  ", 8) == 0) {
+		stream->Seek(4, GEM_CURRENT_POS);
+		DataStream *cached = CacheCompressedStream(comp, stream, stream->filename);
+		delete stream;
+		stream = cached;
+	} else {
+		stream->Seek(0, GEM_STREAM_START);
+	}
+	ok = importer->Open(stream);
+	stream = NULL;
+	if (!ok) {
+		Log(ERROR, "AnimationPreloader", "Cannot open %s.", resref.c_str());
+	}
+}
+
+// the resrefs are case insensitive
+static std::string JobKey(const char *resref)
+{
+	char key[9];
+	strnlwrcpy(key, resref, 8);
+	return key;
+}
+
+AnimationPreloader::AnimationPreloader(JobSystem *jobs)
+	: jobs(jobs)
+{
+	if (PluginMgr::Get()->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) {
+		comp = PluginHolder<Compressor>(PLUGIN_COMPRESSION_ZLIB);
+	}
+}
+
+AnimationPreloader::~AnimationPreloader()
+{
+	MutexLock l(lock);
+	for (JobMap::iterator it = preloading.begin(); it != preloading.end(); ++it) {
+		if (!jobs->Cancel(it->second.get())) {
+			jobs->Wait(it->second.get());
+		}
+	}
+}
+
+bool AnimationPreloader::IsQueued(const char *resref)
+{
+	MutexLock l(lock);
+	return preloading.count(JobKey(resref)) != 0;
+}
+
+void AnimationPreloader::Preload(const char *resref, DataStream *stream)
+{
+	std::string key = JobKey(resref);
+	if (!IsEnabled() || IsQueued(resref)) {
+		delete stream;
+		return;
+	}
+	PluginHolder<AnimationMgr> importer(IE_BAM_CLASS_ID);
+	if (!importer) {
+		delete stream;
+		return;
+	}
+
+	PreloadJob *job = new PreloadJob(key, stream, importer, comp.get());
+	MutexLock l(lock);
+	preloading[key] = job;
+	jobs->Submit(job);
+}
+
+bool AnimationPreloader::Take(const char *resref, Holder<AnimationMgr> &importer)
+{
+	Holder<PreloadJob> job;
+	{
+		MutexLock l(lock);
+		JobMap::iterator it = preloading.find(JobKey(resref));
+		if (it == preloading.end()) {
+			return false;
+		}
+		job = it->second;
+		preloading.erase(it);
+	}
+	// opens it right here, unless a worker has taken it already
+	jobs->Wait(job.get());
+	Collect(job.get(), importer);
+	return true;
+}
+
+bool AnimationPreloader::TakeFinished(std::string &resref, Holder<AnimationMgr> &importer)
+{
+	MutexLock l(lock);
+	for (JobMap::iterator it = preloading.begin(); it != preloading.end(); ++it) {
+		if (it->second->finished) {
+			Holder<PreloadJob> job = it->second;
+			preloading.erase(it);
+			resref = job->resref;
+			Collect(job.get(), importer);
+			return true;
+		}
+	}
+	return false;
+}
+
+// hands the importer of the finished job over
+void AnimationPreloader::Collect(PreloadJob *job, Holder<AnimationMgr> &importer)
+{
+	if (job->ok) {
+		importer.swap(job->importer);
+	} else {
+		importer.release();
+	}
+}
+
+}
@@ -0,0 +1,81 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef ANIMATIONPRELOADER_H
+#define ANIMATIONPRELOADER_H
+
+#include "exports.h"
+
+#include "AnimationMgr.h"
+#include "Compressor.h"
+#include "Holder.h"
+#include "JobSystem.h"
+
+#include <map>
+#include <string>
+
+namespace GemRB {
+
+class DataStream;
+class PreloadJob;
+
+/* Reads creature animations ahead of need as background jobs
+ * actors queue the stances they are about to need (attacking, casting,
+ * getting hit, dying) when they show up or turn hostile, so the BAM files
+ * are read, and the compressed ones expanded, in the background instead of
+ * in the draw path at the start of a fight. The file is looked up and the
+ * importer made on the main thread, and the frames are made into sprites
+ * there too, since that needs the video driver. The jobs expand the
+ * compressed BAMs themselves, with a compressor made up front, since the
+ * importer would make one of its own, and plugins aren't made off the main
+ * thread.
+ */
+class GEM_EXPORT AnimationPreloader {
+public:
+	/* without job threads, nothing is preloaded */
+	AnimationPreloader(JobSystem *jobs);
+	~AnimationPreloader();
+
+	bool IsEnabled() const { return jobs->GetThreadCount() > 0; }
+	bool IsQueued(const char *resref);
+	/* queues the opening of the animation, the preloader takes the stream */
+	void Preload(const char *resref, DataStream *stream);
+	/* hands over the opened importer of a queued animation, opening it
+	 * right now or waiting for the job if needed; the importer is NULL
+	 * if it couldn't be opened. False if it wasn't queued at all. */
+	bool Take(const char *resref, Holder<AnimationMgr> &importer);
+	/* hands over any animation the jobs are done with */
+	bool TakeFinished(std::string &resref, Holder<AnimationMgr> &importer);
+
+private:
+	typedef std::map<std::string, Holder<PreloadJob> > JobMap;
+
+	JobSystem *jobs;
+	Mutex lock;
+	JobMap preloading;
+	// stateless, so one instance serves all the jobs
+	Holder<Compressor> comp;
+
+	void Collect(PreloadJob *job, Holder<AnimationMgr> &importer);
+};
+
+}
+
+#endif
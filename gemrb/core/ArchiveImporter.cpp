@@ -20,6 +20,8 @@
 
 #include "ArchiveImporter.h"
 
+#include "System/FileStream.h"
+
 namespace GemRB {
 
 ArchiveImporter::ArchiveImporter(void)
@@ -30,4 +32,29 @@ ArchiveImporter::~ArchiveImporter(void)
 {
 }
 
+int ArchiveImporter::AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &files)
+{
+	for (size_t i = 0; i < files.size(); i++) {
+		FileStream fs;
+		if (!fs.Open(files[i].c_str())) {
+			Log(ERROR, "ArchiveImporter", "Failed to open \"%s\".", files[i].c_str());
+			continue;
+		}
+		AddToSaveGame(str, &fs);
+	}
+	return GEM_OK;
+}
+
+int ArchiveImporter::AddMembersToSaveGame(DataStream *str, const std::vector<ArchiveMember> &members, ArchiveProgress *progress)
+{
+	for (size_t i = 0; i < members.size(); i++) {
+		AddToSaveGame(str, members[i].stream);
+		delete members[i].stream;
+		if (progress) {
+			progress->Progress((int) ((i + 1) * 100 / members.size()));
+		}
+	}
+	return GEM_OK;
+}
+
 }
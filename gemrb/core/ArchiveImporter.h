@@ -25,8 +25,27 @@
 
 #include "Plugin.h"
 
+#include <ctime>
+#include <string>
+#include <vector>
+
 namespace GemRB {
 
+/** a file read into memory before being archived, with the mtime it had
+ * and the time it was read */
+struct ArchiveMember {
+	DataStream *stream;
+	time_t mtime;
+	time_t read;
+};
+
+/** told how far the writing of an archive got, maybe from another thread */
+class GEM_EXPORT ArchiveProgress {
+public:
+	virtual ~ArchiveProgress() {}
+	virtual void Progress(int percent) = 0;
+};
+
 class GEM_EXPORT ArchiveImporter : public Plugin {
 public:
 	ArchiveImporter(void);
@@ -35,6 +54,10 @@ public:
 	//decompressing a .sav file similar to CBF
 	virtual int DecompressSaveGame(DataStream *compressed) = 0;
 	virtual int AddToSaveGame(DataStream *str, DataStream *uncompressed) = 0;
+	/** adds the files in this order, the importer may compress them in parallel */
+	virtual int AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &files);
+	/** same for files already read into memory, the streams are deleted */
+	virtual int AddMembersToSaveGame(DataStream *str, const std::vector<ArchiveMember> &members, ArchiveProgress *progress = NULL);
 };
 
 }
@@ -0,0 +1,211 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "AreaWriter.h"
+
+#include "win32def.h"
+
+#include "System/FileStream.h"
+#include "System/MemoryStream.h"
+#include "System/VFS.h"
+
+#include <cstdio>
+
+namespace GemRB {
+
+class AreaWriterWorker : public Thread {
+public:
+	AreaWriterWorker(AreaWriter *owner) : writer(owner) {}
+	~AreaWriterWorker() { Join(); }
+protected:
+	void Run();
+private:
+	AreaWriter *writer;
+};
+
+// an unchanged area leaves its cache file (and the time stamp) alone,
+// so the next save can reuse the compressed copy
+static bool HasContents(const char *path, const char *data, unsigned long size)
+{
+	FileStream str;
+	if (!str.Open(path) || str.Size() != size) {
+		return false;
+	}
+	char buffer[8192];
+	while (size) {
+		unsigned int chunk = size < sizeof(buffer) ? (unsigned int) size : (unsigned int) sizeof(buffer);
+		if (str.Read(buffer, chunk) != (int) chunk || memcmp(buffer, data, chunk)) {
+			return false;
+		}
+		data += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+void AreaWriterWorker::Run()
+{
+	AreaWriter::Job *job;
+	while ((job = writer->WaitForJob())) {
+		bool ok = AreaWriter::Write(job->path.c_str(), job->area->GetData(), job->area->Size());
+		writer->Done(job, ok);
+	}
+}
+
+bool AreaWriter::Write(const char *path, const char *data, unsigned long size)
+{
+	if (HasContents(path, data, size)) {
+		return true;
+	}
+	FileStream str;
+	if (str.Create(path) && str.Write(data, (unsigned int) size) == (int) size) {
+		return true;
+	}
+	// a half written area is worse than none, it gets loaded fresh
+	str.Close();
+	remove(path);
+	return false;
+}
+
+AreaWriter::AreaWriter()
+	: stopping(false)
+{
+	worker = new AreaWriterWorker(this);
+	if (!worker->Start()) {
+		Log(ERROR, "AreaWriter", "Couldn't start the area writing thread!");
+		delete worker;
+		worker = NULL;
+	}
+}
+
+AreaWriter::~AreaWriter()
+{
+	Flush();
+	{
+		MutexLock l(lock);
+		stopping = true;
+		wakeup.Broadcast();
+	}
+	delete worker;
+}
+
+bool AreaWriter::Queue(MemoryStream *area)
+{
+	if (!worker) {
+		return false;
+	}
+	ReportFailures();
+
+	Job *job = new Job;
+	job->path = area->originalfile;
+	job->area = area;
+
+	MutexLock l(lock);
+	// a newer copy of the same area replaces the one not written yet
+	for (size_t i = 0; i < queue.size(); i++) {
+		if (!stricmp(queue[i]->path.c_str(), area->originalfile)) {
+			delete queue[i]->area;
+			delete queue[i];
+			queue[i] = job;
+			return true;
+		}
+	}
+	queue.push_back(job);
+	wakeup.Signal();
+	return true;
+}
+
+// the callers all build the path from the cache path, but the resrefs may differ in case
+bool AreaWriter::IsPending(const char *path)
+{
+	if (!stricmp(writing.c_str(), path)) {
+		return true;
+	}
+	for (size_t i = 0; i < queue.size(); i++) {
+		if (!stricmp(queue[i]->path.c_str(), path)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void AreaWriter::Wait(const char *path)
+{
+	{
+		MutexLock l(lock);
+		while (IsPending(path)) {
+			written.Wait(lock);
+		}
+	}
+	ReportFailures();
+}
+
+void AreaWriter::Flush()
+{
+	{
+		MutexLock l(lock);
+		while (!queue.empty() || !writing.empty()) {
+			written.Wait(lock);
+		}
+	}
+	ReportFailures();
+}
+
+AreaWriter::Job *AreaWriter::WaitForJob()
+{
+	MutexLock l(lock);
+	while (!stopping && queue.empty()) {
+		wakeup.Wait(lock);
+	}
+	if (queue.empty()) {
+		return NULL;
+	}
+	Job *job = queue.front();
+	queue.pop_front();
+	writing = job->path;
+	return job;
+}
+
+void AreaWriter::Done(Job *job, bool ok)
+{
+	MutexLock l(lock);
+	if (!ok) {
+		failed.push_back(job->path);
+	}
+	writing.clear();
+	delete job->area;
+	delete job;
+	written.Broadcast();
+}
+
+// only the main thread's records reach the message window, so the worker
+// leaves this to the main thread
+void AreaWriter::ReportFailures()
+{
+	std::vector<std::string> paths;
+	{
+		MutexLock l(lock);
+		paths.swap(failed);
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		Log(WARNING, "Core", "Area removed: %s", paths[i].c_str());
+	}
+}
+
+}
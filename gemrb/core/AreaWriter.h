@@ -0,0 +1,85 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef AREAWRITER_H
+#define AREAWRITER_H
+
+#include "exports.h"
+
+#include "System/Thread.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+class AreaWriterWorker;
+class MemoryStream;
+
+/* Writes the swapped out areas to the cache directory in the background
+ * SwapoutArea still puts the area together in memory on the main thread,
+ * the worker only compares it with the cached file and writes it if it
+ * changed. Whatever reads or removes a cached area waits for its write
+ * first, and saving (or dropping) the cache waits for all of them.
+ */
+class GEM_EXPORT AreaWriter {
+public:
+	AreaWriter();
+	~AreaWriter();
+
+	/* takes over the area put together in memory, to be written to its
+	 * originalfile; false (keeping it) if there is no worker to do it */
+	bool Queue(MemoryStream *area);
+	/* waits until the file at path has been written */
+	void Wait(const char *path);
+	/* waits until all the queued areas have been written */
+	void Flush();
+
+	/* writes the area unless the file already has the same contents,
+	 * what the worker does, for the callers that can't queue */
+	static bool Write(const char *path, const char *data, unsigned long size);
+
+private:
+	friend class AreaWriterWorker;
+
+	struct Job {
+		std::string path;
+		MemoryStream *area;
+	};
+
+	Mutex lock;
+	ConditionVariable wakeup, written;
+	bool stopping;
+	std::deque<Job *> queue;
+	// the path being written right now, empty if none
+	std::string writing;
+	// the paths that couldn't be written, to report on the main thread
+	std::vector<std::string> failed;
+	AreaWriterWorker *worker;
+
+	Job *WaitForJob();
+	void Done(Job *job, bool ok);
+	bool IsPending(const char *path);
+	void ReportFailures();
+};
+
+}
+
+#endif
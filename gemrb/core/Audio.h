@@ -79,6 +79,9 @@ public:
 	virtual void QueueBuffer(int stream, unsigned short bits,
 				int channels, short* memory, int size, int samplerate) = 0;
 	virtual void UpdateMapAmbient(MapReverb&) {};
+	virtual void DumpStats() {};
+	/** Frees cached sounds for the given TrimLevel, returns the bytes */
+	virtual unsigned long TrimMemory(int /*level*/) { return 0; }
 
 protected:
 	AmbientMgr* ambim;
@@ -0,0 +1,77 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "Benchmark.h"
+
+#include "System/Logging.h"
+
+namespace GemRB {
+
+static const char *SectionNames[BENCH_COUNT] = {
+	"world timer", "path delivery", "actor queues", "area scripts",
+	"actor scripts", "actor state", "movement", "doors and triggers"
+};
+
+static unsigned __int64 SectionTimes[BENCH_COUNT];
+static unsigned int SectionCalls[BENCH_COUNT];
+
+bool Benchmark::enabled = false;
+
+void Benchmark::SetEnabled(bool enable)
+{
+	enabled = enable;
+}
+
+void Benchmark::Reset()
+{
+	for (int i = 0; i < BENCH_COUNT; i++) {
+		SectionTimes[i] = 0;
+		SectionCalls[i] = 0;
+	}
+}
+
+void Benchmark::Add(BenchmarkSection section, unsigned __int64 time)
+{
+	SectionTimes[section] += time;
+	SectionCalls[section]++;
+}
+
+void Benchmark::Report(unsigned int ticks, unsigned __int64 elapsed)
+{
+	if (!ticks || !elapsed) {
+		Log(WARNING, "Benchmark", "Nothing ran.");
+		return;
+	}
+
+	Log(MESSAGE, "Benchmark", "%u ticks in %.3f s, %.1f ticks per second (%.1f us per tick)",
+		ticks, elapsed / 1e9, ticks * 1e9 / elapsed, elapsed / 1e3 / ticks);
+	Log(MESSAGE, "Benchmark", "%-20s %10s %10s %7s %10s", "section", "total ms", "us/tick", "share", "calls");
+	unsigned __int64 accounted = 0;
+	for (int i = 0; i < BENCH_COUNT; i++) {
+		accounted += SectionTimes[i];
+		Log(MESSAGE, "Benchmark", "%-20s %10.2f %10.2f %6.1f%% %10u", SectionNames[i],
+			SectionTimes[i] / 1e6, SectionTimes[i] / 1e3 / ticks,
+			100.0 * SectionTimes[i] / elapsed, SectionCalls[i]);
+	}
+	unsigned __int64 rest = elapsed > accounted ? elapsed - accounted : 0;
+	Log(MESSAGE, "Benchmark", "%-20s %10.2f %10.2f %6.1f%%", "other",
+		rest / 1e6, rest / 1e3 / ticks, 100.0 * rest / elapsed);
+}
+
+}
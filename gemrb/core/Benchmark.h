@@ -0,0 +1,77 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "GameScript/ScriptProfiler.h"
+
+namespace GemRB {
+
+/* the parts of a game tick the benchmark reports on */
+enum BenchmarkSection {
+	BENCH_WORLD, // fog, area effects and the game time
+	BENCH_PATHS, // delivering the background paths
+	BENCH_QUEUES, // sorting the actors for the tick
+	BENCH_AREA_SCRIPTS,
+	BENCH_ACTOR_SCRIPTS, // actor scripts and actions
+	BENCH_ACTOR_STATE, // effects, stats and speed
+	BENCH_MOVEMENT,
+	BENCH_TRIGGERS, // doors, containers, infopoints and spawns
+	BENCH_COUNT
+};
+
+/* Times spent in the parts of the game ticks during a benchmark run,
+ * nothing is recorded outside of one. The rest of the tick (the game
+ * script, party checks, ...) is reported as the remainder.
+ */
+class GEM_EXPORT Benchmark {
+public:
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled() { return enabled; }
+	static void Reset();
+	static void Add(BenchmarkSection section, unsigned __int64 time);
+	/** prints the ticks per second and the time spent in each section */
+	static void Report(unsigned int ticks, unsigned __int64 elapsed);
+private:
+	static bool enabled;
+};
+
+/* One section, timed from its creation to its destruction */
+class BenchmarkTimer {
+public:
+	BenchmarkTimer(BenchmarkSection section)
+		: section(section), start(Benchmark::IsEnabled() ? ScriptProfiler::Now() : 0) {}
+	~BenchmarkTimer()
+	{
+		if (start) {
+			Benchmark::Add(section, ScriptProfiler::Now() - start);
+		}
+	}
+private:
+	BenchmarkSection section;
+	unsigned __int64 start;
+};
+
+}
+
+#endif
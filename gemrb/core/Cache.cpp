@@ -43,9 +43,14 @@ Cache::Cache(int nBlockSize, int nHashTableSize)
 	m_pHashTable = NULL;
 	m_nHashTableSize = nHashTableSize; // default size
 	m_nCount = 0;
+	m_nBytes = 0;
 	m_pFreeList = NULL;
+	m_pOldest = NULL;
+	m_pNewest = NULL;
 	m_pBlocks = NULL;
 	m_nBlockSize = nBlockSize;
+	m_nBudget = 0;
+	m_pRelease = NULL;
 }
 
 void Cache::InitHashTable(unsigned int nHashSize, bool bAllocNow)
@@ -88,7 +93,10 @@ void Cache::RemoveAll(ReleaseFun fun)
 	}
 
 	m_nCount = 0;
+	m_nBytes = 0;
 	m_pFreeList = NULL;
+	m_pOldest = NULL;
+	m_pNewest = NULL;
 
 	// free memory blocks
 	MemBlock* p = m_pBlocks;
@@ -134,11 +142,16 @@ Cache::MyAssoc* Cache::NewAssoc()
 	pAssoc->data = 0;
 #endif
 	pAssoc->nRefCount=1;
+	pAssoc->size = 0;
+	pAssoc->pOlder = NULL;
+	pAssoc->pNewer = NULL;
 	return pAssoc;
 }
 
 void Cache::FreeAssoc(Cache::MyAssoc* pAssoc)
 {
+	Referenced(pAssoc);
+	m_nBytes -= pAssoc->size;
 	if(pAssoc->pNext) {
 		pAssoc->pNext->pPrev=pAssoc->pPrev;
 	}
@@ -154,6 +167,38 @@ void Cache::FreeAssoc(Cache::MyAssoc* pAssoc)
 	}
 }
 
+//puts a zero refcount entry at the end of the eviction queue
+void Cache::Released(Cache::MyAssoc* pAssoc)
+{
+	pAssoc->pOlder = m_pNewest;
+	pAssoc->pNewer = NULL;
+	if (m_pNewest) {
+		m_pNewest->pNewer = pAssoc;
+	} else {
+		m_pOldest = pAssoc;
+	}
+	m_pNewest = pAssoc;
+}
+
+//takes the entry out of the eviction queue, if it was there
+void Cache::Referenced(Cache::MyAssoc* pAssoc) const
+{
+	if (pAssoc->pOlder) {
+		pAssoc->pOlder->pNewer = pAssoc->pNewer;
+	} else if (m_pOldest == pAssoc) {
+		m_pOldest = pAssoc->pNewer;
+	} else {
+		return;
+	}
+	if (pAssoc->pNewer) {
+		pAssoc->pNewer->pOlder = pAssoc->pOlder;
+	} else {
+		m_pNewest = pAssoc->pOlder;
+	}
+	pAssoc->pOlder = NULL;
+	pAssoc->pNewer = NULL;
+}
+
 Cache::MyAssoc *Cache::GetNextAssoc(Cache::MyAssoc *Position) const
 {
 	if (m_pHashTable == NULL || m_nCount==0) {
@@ -211,12 +256,15 @@ void *Cache::GetResource(const ieResRef key) const
 		return NULL;
 	} // not in map
 
+	if (!pAssoc->nRefCount) {
+		Referenced(pAssoc);
+	}
 	pAssoc->nRefCount++;
 	return pAssoc->data;
 }
 
 //returns true if it was successful
-bool Cache::SetAt(const ieResRef key, void *rValue)
+bool Cache::SetAt(const ieResRef key, void *rValue, unsigned long size)
 {
 	int i;
 
@@ -240,6 +288,8 @@ bool Cache::SetAt(const ieResRef key, void *rValue)
 		pAssoc->key[i]=0;
 	}
 	pAssoc->data=rValue;
+	pAssoc->size=size;
+	m_nBytes += size;
 	// put into hash table
 	unsigned int nHash = MyHashKey(pAssoc->key);
 	pAssoc->pNext = m_pHashTable[nHash];
@@ -248,6 +298,8 @@ bool Cache::SetAt(const ieResRef key, void *rValue)
 		pAssoc->pNext->pPrev = &pAssoc->pNext;
 	}
 	m_pHashTable[nHash] = pAssoc;
+	//the new entry is referenced, so it stays
+	Trim();
 	return true;
 }
 
@@ -271,9 +323,12 @@ int Cache::DecRef(void *data, const ieResRef key, bool remove)
 				return -1;
 			}
 			--pAssoc->nRefCount;
-			if (remove && !pAssoc->nRefCount) {
-				FreeAssoc(pAssoc);
-				return 0;
+			if (!pAssoc->nRefCount) {
+				if (remove) {
+					FreeAssoc(pAssoc);
+					return 0;
+				}
+				Released(pAssoc);
 			}
 			return pAssoc->nRefCount;
 		}
@@ -288,9 +343,12 @@ int Cache::DecRef(void *data, const ieResRef key, bool remove)
 				return -1;
 			}
 			--pAssoc->nRefCount;
-			if (remove && !pAssoc->nRefCount) {
-				FreeAssoc(pAssoc);
-				return 0;
+			if (!pAssoc->nRefCount) {
+				if (remove) {
+					FreeAssoc(pAssoc);
+					return 0;
+				}
+				Released(pAssoc);
 			}
 			return pAssoc->nRefCount;
 		}
@@ -313,4 +371,38 @@ void Cache::Cleanup()
 	}
 }
 
+void Cache::SetBudget(unsigned long budget, ReleaseFun fun)
+{
+	m_nBudget = budget;
+	m_pRelease = fun;
+	Trim();
+}
+
+unsigned long Cache::Purge(ReleaseFun fun)
+{
+	unsigned long bytes = m_nBytes;
+	while (m_pOldest) {
+		void *data = m_pOldest->data;
+		FreeAssoc(m_pOldest);
+		if (fun) {
+			fun(data);
+		}
+	}
+	return bytes - m_nBytes;
+}
+
+void Cache::Trim()
+{
+	if (!m_nBudget) {
+		return;
+	}
+	while (m_nBytes > m_nBudget && m_pOldest) {
+		void *data = m_pOldest->data;
+		FreeAssoc(m_pOldest);
+		if (m_pRelease) {
+			m_pRelease(data);
+		}
+	}
+}
+
 }
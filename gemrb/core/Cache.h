@@ -21,6 +21,7 @@
 #ifndef CACHE_H
 #define CACHE_H
 
+#include "exports.h"
 #include "globals.h"
 #include "win32def.h"
 
@@ -32,7 +33,7 @@ namespace GemRB {
 typedef void (*ReleaseFun)(void *);
 #endif
 
-class Cache
+class GEM_EXPORT Cache
 {
 protected:
 	// Association
@@ -42,6 +43,10 @@ protected:
 		char key[KEYSIZE]; //not ieResRef!
 		ieDword nRefCount;
 		void* data;
+		unsigned long size; // bytes held by data, as told by SetAt
+		// unreferenced entries, least recently released first
+		MyAssoc* pOlder;
+		MyAssoc* pNewer;
 	};
 	struct MemBlock {
 		MemBlock* pNext;
@@ -61,10 +66,16 @@ public:
 	{
 		return m_nCount==0;
 	}
+	// bytes held by all the elements
+	inline unsigned long GetSize() const
+	{
+		return m_nBytes;
+	}
 	// Lookup
 	void *GetResource(const ieResRef key) const;
 	// Operations
-	bool SetAt(const ieResRef key, void *rValue);
+	//size is only used for the budget, it may be an estimate
+	bool SetAt(const ieResRef key, void *rValue, unsigned long size = 0);
 	// decreases refcount or drops data
 	//if name is supplied it is faster, it will use rValue to validate the request
 	int DecRef(void *rValue, const ieResRef name, bool free);
@@ -72,6 +83,14 @@ public:
 	void RemoveAll(ReleaseFun fun);//removes all refcounts
 	void Cleanup();  //removes only zero refcounts
 	void InitHashTable(unsigned int hashSize, bool bAllocNow = true);
+	//zero refcount entries are kept until the size goes over budget,
+	//then the least recently released ones are dropped with fun
+	//a budget of 0 means no limit
+	void SetBudget(unsigned long budget, ReleaseFun fun);
+	void Trim();
+	//drops all the zero refcount entries with fun, whatever the budget
+	//returns the bytes they were counted for
+	unsigned long Purge(ReleaseFun fun);
 
 	// Implementation
 protected:
@@ -81,12 +100,19 @@ protected:
 	MyAssoc* m_pFreeList;
 	MemBlock* m_pBlocks;
 	int m_nBlockSize;
+	unsigned long m_nBytes;
+	unsigned long m_nBudget;
+	ReleaseFun m_pRelease;
+	mutable MyAssoc* m_pOldest;
+	mutable MyAssoc* m_pNewest;
 
 	Cache::MyAssoc* NewAssoc();
 	void FreeAssoc(Cache::MyAssoc*);
 	Cache::MyAssoc* GetAssocAt(const ieResRef) const;
 	Cache::MyAssoc *GetNextAssoc(Cache::MyAssoc * rNextPosition) const;
 	unsigned int MyHashKey(const ieResRef) const;
+	void Released(Cache::MyAssoc*);
+	void Referenced(Cache::MyAssoc*) const;
 
 public:
 	~Cache();
@@ -333,6 +333,14 @@ void CharAnimations::CheckColorMod()
 	lockPalette = false;
 }
 
+//the palettes are interned, so identical looking creatures share them and whatever
+//the video driver derives from them; they are copied before being changed
+static Palette* WritablePalette(Palette* pal)
+{
+	if (!pal) return new Palette();
+	return pal->Unshare();
+}
+
 void CharAnimations::SetupColors(PaletteType type)
 {
 	Palette* pal = palette[type];
@@ -377,16 +385,18 @@ void CharAnimations::SetupColors(PaletteType type)
 			return;
 		}
 		*/
+		palette[PAL_MAIN] = palette[PAL_MAIN]->Unshare();
 		for (int i = 0; i < colorcount; i++) {
 			core->GetPalette( Colors[i]&255, size,
 				&palette[PAL_MAIN]->col[dest] );
 			dest +=size;
 		}
+		palette[PAL_MAIN] = palette[PAL_MAIN]->Intern();
 
 		if (needmod) {
-			if (!modifiedPalette[PAL_MAIN])
-				modifiedPalette[PAL_MAIN] = new Palette();
+			modifiedPalette[PAL_MAIN] = WritablePalette(modifiedPalette[PAL_MAIN]);
 			modifiedPalette[PAL_MAIN]->SetupGlobalRGBModification(palette[PAL_MAIN], GlobalColorMod);
+			modifiedPalette[PAL_MAIN] = modifiedPalette[PAL_MAIN]->Intern();
 		} else {
 			gamedata->FreePalette(modifiedPalette[PAL_MAIN], 0);
 		}
@@ -419,16 +429,18 @@ void CharAnimations::SetupColors(PaletteType type)
 		}
 		bool needmod = GlobalColorMod.type != RGBModifier::NONE;
 		if (needmod) {
-			if (!modifiedPalette[type])
-				modifiedPalette[type] = new Palette();
+			modifiedPalette[type] = WritablePalette(modifiedPalette[type]);
 			modifiedPalette[type]->SetupGlobalRGBModification(palette[type], GlobalColorMod);
+			modifiedPalette[type] = modifiedPalette[type]->Intern();
 		} else {
 			gamedata->FreePalette(modifiedPalette[type], 0);
 		}
 		return;
 	}
 
+	pal = pal->Unshare();
 	pal->SetupPaperdollColours(Colors, type);
+	palette[type] = pal->Intern();
 	if (lockPalette) {
 		return;
 	}
@@ -445,14 +457,14 @@ void CharAnimations::SetupColors(PaletteType type)
 	}
 
 	if (needmod) {
-		if (!modifiedPalette[type])
-			modifiedPalette[type] = new Palette();
+		modifiedPalette[type] = WritablePalette(modifiedPalette[type]);
 
 		if (GlobalColorMod.type != RGBModifier::NONE) {
 			modifiedPalette[type]->SetupGlobalRGBModification(palette[type], GlobalColorMod);
 		} else {
 			modifiedPalette[type]->SetupRGBModification(palette[type],ColorMods, type);
 		}
+		modifiedPalette[type] = modifiedPalette[type]->Intern();
 	} else {
 		gamedata->FreePalette(modifiedPalette[type], 0);
 	}
@@ -911,6 +923,44 @@ WSW 003      |      013 ESE
 
 */
 
+// the stances a fight needs first, the hitch of loading them shows the most
+static const unsigned char CombatStances[] = {
+	IE_ANI_ATTACK, IE_ANI_ATTACK_SLASH, IE_ANI_ATTACK_BACKSLASH, IE_ANI_ATTACK_JAB,
+	IE_ANI_SHOOT, IE_ANI_CAST, IE_ANI_CONJURE, IE_ANI_DAMAGE, IE_ANI_DIE
+};
+
+void CharAnimations::PreloadCombatStances(unsigned char Orient)
+{
+	int AnimType = GetAnimType();
+	if (AnimType == -1) {
+		return;
+	}
+	Orient &= 15;
+	int partCount = GetActorPartCount();
+	for (size_t i = 0; i < sizeof(CombatStances); i++) {
+		unsigned char stance = CombatStances[i];
+		//pst animations don't have separate animation for sleep/die
+		if (AnimType >= IE_ANI_PST_ANIMATION_1 && stance == IE_ANI_DIE) {
+			stance = IE_ANI_TWITCH;
+		}
+		stance = MaybeOverrideStance(stance);
+		if (Anims[stance][Orient]) {
+			continue;
+		}
+		// only the creature itself, the equipment is small and shared
+		for (int part = 0; part < partCount; part++) {
+			char NewResRef[12];
+			unsigned char Cycle = 0;
+			EquipResRefData* equipdat = 0;
+			strlcpy(NewResRef, ResRef, sizeof(ieResRef));
+			GetAnimResRef(stance, Orient, NewResRef, Cycle, part, equipdat);
+			delete equipdat;
+			NewResRef[8] = 0;
+			gamedata->PreloadAnimation(NewResRef);
+		}
+	}
+}
+
 Animation** CharAnimations::GetAnimation(unsigned char Stance, unsigned char Orient)
 {
 	if (Stance >= MAX_ANIMS) {
@@ -1564,7 +1614,7 @@ void CharAnimations::AddPSTSuffix(char* ResRef, unsigned char StanceID,
 			Prefix="wlk"; break;
 		case IE_ANI_HEAD_TURN:
 			Cycle=SixteenToFive[Orient];
-			if (RAND(0,1)) {
+			if (VISUAL_RAND(0,1)) {
 				Prefix="sf2";
 				sprintf(ResRef,"%c%3s%4s",this->ResRef[0], Prefix, this->ResRef+1);
 				if (gamedata->Exists(ResRef, IE_BAM_CLASS_ID) ) {
@@ -1955,7 +2005,7 @@ void CharAnimations::AddVHRSuffix(char* ResRef, unsigned char StanceID,
 			break;
 
 		case IE_ANI_HEAD_TURN:
-			if (RAND(0,1)) {
+			if (VISUAL_RAND(0,1)) {
 				strcat( ResRef, "g12" );
 				Cycle += 18;
 			} else {
@@ -2920,9 +2970,9 @@ void CharAnimations::PulseRGBModifiers()
 
 void CharAnimations::DebugDump()
 {
-	Log (DEBUG, "CharAnimations", "Anim ID   : %04x", GetAnimationID() );
-	Log (DEBUG, "CharAnimations", "BloodColor: %d", GetBloodColor() );
-	Log (DEBUG, "CharAnimations", "Flags     : %04x", GetFlags() );
+	LogDebug ("CharAnimations", "Anim ID   : %04x", GetAnimationID() );
+	LogDebug ("CharAnimations", "BloodColor: %d", GetBloodColor() );
+	LogDebug ("CharAnimations", "Flags     : %04x", GetFlags() );
 }
 
 }
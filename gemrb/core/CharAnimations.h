@@ -195,6 +195,8 @@ public:
 
 	// returns an array of animations of size GetTotalPartCount()
 	Animation** GetAnimation(unsigned char Stance, unsigned char Orient);
+	// starts reading the files of the fighting stances in the background
+	void PreloadCombatStances(unsigned char Orient);
 	int GetTotalPartCount() const;
 	const int* GetZOrder(unsigned char Orient);
 	Animation** GetShadowAnimation(unsigned char Stance, unsigned char Orient);
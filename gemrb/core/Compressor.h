@@ -34,6 +34,14 @@ public:
 	virtual int Decompress(DataStream* dest, DataStream* source, unsigned int size_guess = 0) const = 0;
 	/** compresses a datastream (memory or file) to another DataStream */
 	virtual int Compress(DataStream *dest, DataStream* source) const = 0;
+	/** inflates a whole zlib stream of sourcelen bytes in one go, straight
+	 * into dest, which holds destlen bytes; returns the inflated length or GEM_ERROR */
+	virtual int DecompressBuffer(void *dest, unsigned int destlen, const void *source, unsigned int sourcelen) const = 0;
+	/** returns a stream inflating the next complen bytes of source (0 for
+	 * the rest) only as they are read, declen is the inflated length;
+	 * the new stream takes over source. Seeking back inflates from the start
+	 * again, so this is meant for readers going through the data in order */
+	virtual DataStream* CreateInflateStream(DataStream *source, unsigned int complen, unsigned int declen) const = 0;
 };
 
 }
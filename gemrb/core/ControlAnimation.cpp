@@ -91,10 +91,10 @@ void ControlAnimation::UpdateAnimation(bool paused)
 			// note: the granularity of time should be
 			// one of twenty values from [500, 10000]
 			// but not the full range.
-			time = 500 + 500 * RAND(0, 19);
+			time = 500 + 500 * VISUAL_RAND(0, 19);
 			cycle&=~1;
 		} else if (anim_phase == 1) {
-			if (!RAND(0,29)) {
+			if (!VISUAL_RAND(0,29)) {
 				cycle|=1;
 			}
 			anim_phase = 2;
@@ -135,8 +135,9 @@ void ControlAnimation::UpdateAnimationSprite () {
 		return;
 	}
 
+	// the frames share the palette of the animation
 	if (has_palette) {
-		Palette* palette = pic->GetPalette();
+		Palette* palette = pic->GetPalette()->Unshare();
 		palette->SetupPaperdollColours(colors, 0);
 		if (is_blended) {
 			palette->CreateShadedAlphaChannel();
@@ -145,7 +146,7 @@ void ControlAnimation::UpdateAnimationSprite () {
 		palette->release();
 	} else {
 		if (is_blended) {
-			Palette* palette = pic->GetPalette();
+			Palette* palette = pic->GetPalette()->Unshare();
 			palette->CreateShadedAlphaChannel();
 			pic->SetPalette(palette);
 			palette->release();
@@ -0,0 +1,277 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "DecompressionService.h"
+
+#include "win32def.h"
+
+#include "Interface.h"
+#include "ResourceStats.h"
+#include "System/FileStream.h"
+#include "System/VFS.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace GemRB {
+
+// BIFC blocks handed out at once, they are usually 8K each when inflated
+#define BIFC_BATCH_SIZE 64
+
+class ExpandJob : public Job {
+public:
+	ExpandJob(DecompressionService *owner, const char *path, const char *cachePath, JobPriority priority)
+		: Job("DecompressionService::Expand", priority), service(owner),
+		path(path), cachePath(cachePath), ok(false), urgent(priority == JOB_FRAME) {}
+
+	DecompressionService *service;
+	std::string path, cachePath;
+	bool ok;
+	// somebody waits for it, so the rest of its blocks go first
+	volatile bool urgent;
+protected:
+	void Run() { service->Run(this); }
+};
+
+// a zlib block of a BIFC, inflated in any order, written in order
+class InflateJob : public Job {
+public:
+	InflateJob(Compressor *comp, JobPriority priority)
+		: Job("DecompressionService::Inflate", priority), comp(comp),
+		in(NULL), out(NULL), complen(0), declen(0), ok(false) {}
+	~InflateJob() { free(in); free(out); }
+
+	Compressor *comp;
+	void *in, *out;
+	ieDword complen, declen;
+	bool ok;
+protected:
+	void Run()
+	{
+		// the sizes are known, so inflate in one go and skip the stream buffers
+		ok = comp->DecompressBuffer(out, declen, in, complen) == (int) declen;
+	}
+};
+
+static void GetCachePath(char *cachePath, const char *path)
+{
+	char filename[_MAX_PATH];
+	ExtractFileFromPath(filename, path);
+	PathJoin(cachePath, core->CachePath, filename, NULL);
+}
+
+DecompressionService::DecompressionService(JobSystem *jobs)
+	: jobs(jobs), stopping(false)
+{
+	if (core->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) {
+		// the plugin is stateless, so one instance serves all the threads
+		comp = PluginHolder<Compressor>(PLUGIN_COMPRESSION_ZLIB);
+	}
+}
+
+DecompressionService::~DecompressionService()
+{
+	std::map<std::string, Holder<ExpandJob> > left;
+	{
+		MutexLock l(lock);
+		stopping = true;
+		left = expanding;
+	}
+	// the running ones notice stopping and give up
+	std::map<std::string, Holder<ExpandJob> >::iterator it;
+	for (it = left.begin(); it != left.end(); ++it) {
+		if (!jobs->Cancel(it->second.get())) {
+			jobs->Wait(it->second.get());
+		}
+	}
+}
+
+void DecompressionService::Prefetch(const char *path)
+{
+	if (!jobs->GetThreadCount() || !comp) {
+		return;
+	}
+	char cachePath[_MAX_PATH];
+	GetCachePath(cachePath, path);
+	if (file_exists(cachePath)) {
+		return;
+	}
+
+	MutexLock l(lock);
+	if (expanding.count(cachePath)) {
+		return;
+	}
+	Queue(path, cachePath, JOB_BACKGROUND);
+}
+
+DataStream *DecompressionService::Expand(const char *path)
+{
+	if (!comp) {
+		Log(ERROR, "DecompressionService", "No Compression Manager Available. Cannot expand %s.", path);
+		return NULL;
+	}
+	char cachePath[_MAX_PATH];
+	GetCachePath(cachePath, path);
+	// waiting for a worker counts too, the load is held up all the same
+	DecompressionTimer timer;
+
+	Holder<ExpandJob> job;
+	{
+		MutexLock l(lock);
+		std::map<std::string, Holder<ExpandJob> >::iterator it = expanding.find(cachePath);
+		if (it != expanding.end()) {
+			job = it->second;
+			job->urgent = true;
+		} else if (!file_exists(cachePath)) {
+			job = Queue(path, cachePath, JOB_FRAME);
+		}
+	}
+	if (!job) {
+		timer.Cancel();
+		return FileStream::OpenFile(cachePath);
+	}
+	// runs it right here, unless a worker has taken it already
+	jobs->Wait(job.get());
+	if (!job->ok) {
+		return NULL;
+	}
+	return FileStream::OpenFile(cachePath);
+}
+
+// call with the lock held
+ExpandJob *DecompressionService::Queue(const char *path, const char *cachePath, JobPriority priority)
+{
+	ExpandJob *job = new ExpandJob(this, path, cachePath, priority);
+	expanding[cachePath] = job;
+	jobs->Submit(job);
+	return job;
+}
+
+void DecompressionService::Run(ExpandJob *job)
+{
+	Log(MESSAGE, "DecompressionService", "Expanding %s...", job->path.c_str());
+	bool ok = false;
+	FileStream *file = FileStream::OpenFile(job->path.c_str());
+	char Signature[8];
+	if (file && file->Read(Signature, 8) == 8) {
+		std::string partPath = job->cachePath + ".part";
+		FileStream out;
+		if (!out.Create(partPath.c_str())) {
+			Log(ERROR, "DecompressionService", "Cannot write %s.", partPath.c_str());
+		} else {
+			if (strncmp(Signature, "BIF V1.0", 8) == 0) {
+				ok = ExpandCBF(file, &out);
+			} else if (strncmp(Signature, "BIFCV1.0", 8) == 0) {
+				ok = ExpandBIFC(job, file, &out);
+			}
+			out.Close(); // windows can't rename open files
+			if (ok && rename(partPath.c_str(), job->cachePath.c_str())) {
+				Log(ERROR, "DecompressionService", "Cannot write %s.", job->cachePath.c_str());
+				ok = false;
+			}
+			if (!ok) {
+				remove(partPath.c_str());
+			}
+		}
+	}
+	delete file;
+	if (!ok) {
+		Log(ERROR, "DecompressionService", "Cannot expand %s.", job->path.c_str());
+	}
+
+	// the waiters hold on to the job, the next Expand finds the file
+	MutexLock l(lock);
+	job->ok = ok;
+	expanding.erase(job->cachePath);
+}
+
+// a CBF is a single zlib stream, it can't be split
+bool DecompressionService::ExpandCBF(DataStream *file, DataStream *out)
+{
+	ieDword fnlen, complen, declen;
+	file->ReadDword(&fnlen);
+	file->Seek(fnlen, GEM_CURRENT_POS);
+	file->ReadDword(&declen);
+	file->ReadDword(&complen);
+	return comp->Decompress(out, file, complen) == GEM_OK;
+}
+
+bool DecompressionService::ExpandBIFC(ExpandJob *job, DataStream *file, DataStream *out)
+{
+	ieDword unCompBifSize;
+	if (file->ReadDword(&unCompBifSize) != 4) {
+		return false;
+	}
+	ieDword finalsize = 0;
+	bool ok = true;
+	std::vector<Holder<InflateJob> > batch;
+	while (ok && finalsize < unCompBifSize) {
+		JobPriority priority = job->urgent ? JOB_FRAME : JOB_BACKGROUND;
+
+		// read the compressed blocks of the batch
+		while (batch.size() < BIFC_BATCH_SIZE && finalsize < unCompBifSize) {
+			ieDword declen, complen;
+			if (file->ReadDword(&declen) != 4 || file->ReadDword(&complen) != 4 ||
+				!declen || complen > file->Remains()) {
+				ok = false;
+				break;
+			}
+			Holder<InflateJob> block(new InflateJob(comp.get(), priority));
+			block->in = malloc(complen);
+			block->out = malloc(declen);
+			if (!block->in || !block->out || file->Read(block->in, complen) != (int) complen) {
+				ok = false;
+				break;
+			}
+			block->complen = complen;
+			block->declen = declen;
+			jobs->Submit(block.get());
+			batch.push_back(block);
+			finalsize += declen;
+		}
+
+		// this thread inflates its share too, meanwhile
+		for (size_t i = 0; i < batch.size(); i++) {
+			InflateJob *block = batch[i].get();
+			jobs->Wait(block);
+			if (ok && (!block->ok || out->Write(block->out, block->declen) != (int) block->declen)) {
+				ok = false;
+			}
+		}
+		batch.clear();
+
+		if (IsStopping()) {
+			return false;
+		}
+	}
+	return ok;
+}
+
+bool DecompressionService::IsStopping()
+{
+	{
+		MutexLock l(lock);
+		if (stopping) {
+			return true;
+		}
+	}
+	return jobs->IsStopping();
+}
+
+}
@@ -0,0 +1,77 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef DECOMPRESSIONSERVICE_H
+#define DECOMPRESSIONSERVICE_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "Compressor.h"
+#include "JobSystem.h"
+#include "PluginMgr.h"
+
+#include <map>
+#include <string>
+
+namespace GemRB {
+
+class DataStream;
+class ExpandJob;
+
+/* Expands the compressed archives (CBF and BIFC) into the cache directory
+ * archives can be queued ahead of need and are then expanded as background
+ * jobs, several at a time. The independent zlib blocks of a BIFC are
+ * inflated as jobs of their own, by whoever is idle, the caller included.
+ * The expanded file is written under a temporary name and renamed when
+ * complete, so the cache never holds a partial archive.
+ */
+class GEM_EXPORT DecompressionService {
+public:
+	/* without job threads, everything is expanded on demand by the caller */
+	DecompressionService(JobSystem *jobs);
+	~DecompressionService();
+
+	/* queues the expansion of the archive, if it isn't cached yet;
+	 * does nothing without job threads */
+	void Prefetch(const char *path);
+	/* returns the expanded copy of the archive from the cache, expanding it
+	 * now or waiting for its queued or running job; NULL on failure */
+	DataStream *Expand(const char *path);
+
+private:
+	friend class ExpandJob;
+
+	JobSystem *jobs;
+	PluginHolder<Compressor> comp;
+	Mutex lock;
+	bool stopping;
+	// by cache path, until they are done
+	std::map<std::string, Holder<ExpandJob> > expanding;
+
+	ExpandJob *Queue(const char *path, const char *cachePath, JobPriority priority);
+	void Run(ExpandJob *job);
+	bool ExpandCBF(DataStream *file, DataStream *out);
+	bool ExpandBIFC(ExpandJob *job, DataStream *file, DataStream *out);
+	bool IsStopping();
+};
+
+}
+
+#endif
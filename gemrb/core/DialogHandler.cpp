@@ -21,7 +21,6 @@
 
 #include "strrefs.h"
 
-#include "DialogMgr.h"
 #include "DisplayMessage.h"
 #include "Game.h"
 #include "GameData.h"
@@ -59,7 +58,9 @@ DialogHandler::DialogHandler(void)
 
 DialogHandler::~DialogHandler(void)
 {
-	delete dlg;
+	if (dlg) {
+		gamedata->FreeDialog(dlg, dlg->ResRef);
+	}
 }
 
 void DialogHandler::UpdateJournalForTransition(DialogTransition* tr)
@@ -98,24 +99,22 @@ void DialogHandler::UpdateJournalForTransition(DialogTransition* tr)
 //Try to start dialogue between two actors (one of them could be inanimate)
 bool DialogHandler::InitDialog(Scriptable* spk, Scriptable* tgt, const char* dlgref, ieDword si)
 {
-	delete dlg;
-	dlg = NULL;
+	if (dlg) {
+		gamedata->FreeDialog(dlg, dlg->ResRef);
+		dlg = NULL;
+	}
 
 	if (!dlgref || dlgref[0] == '\0' || dlgref[0] == '*') {
 		return false;
 	}
 
-	PluginHolder<DialogMgr> dm(IE_DLG_CLASS_ID);
-	dm->Open(gamedata->GetResource(dlgref, IE_DLG_CLASS_ID));
-	dlg = dm->GetDialog();
+	dlg = gamedata->GetDialog(dlgref);
 
 	if (!dlg) {
 		Log(ERROR, "DialogHandler", "Cannot start dialog (%s): %s with %s", dlgref, spk->GetName(1), tgt->GetName(1));
 		return false;
 	}
 
-	strnlwrcpy(dlg->ResRef, dlgref, 8); //this isn't handled by GetDialog???
-
 	//target is here because it could be changed when a dialog runs onto
 	//and external link, we need to find the new target (whose dialog was
 	//linked to)
@@ -155,7 +154,7 @@ bool DialogHandler::InitDialog(Scriptable* spk, Scriptable* tgt, const char* dlg
 		}
 	}
 	if (initialState < 0) {
-		Log(DEBUG, "DialogHandler", "Could not find a proper state");
+		LogDebug("DialogHandler", "Could not find a proper state");
 		return false;
 	}
 
@@ -222,8 +221,10 @@ void DialogHandler::EndDialog(bool try_to_break)
 		tmp->SetCircleSize();
 	}
 	ds = NULL;
-	delete dlg;
-	dlg = NULL;
+	if (dlg) {
+		gamedata->FreeDialog(dlg, dlg->ResRef);
+		dlg = NULL;
+	}
 
 	// FIXME: it's not so nice having this here, but things call EndDialog directly :(
 	core->GetGUIScriptEngine()->RunFunction( "GUIWORLD", "DialogEnded" );
@@ -31,6 +31,8 @@
 #else
 #  include <cstdarg>
 #endif
+#include <deque>
+#include <vector>
 
 namespace GemRB {
 
@@ -45,6 +47,53 @@ static const wchar_t* DisplayFormatValue = L"[p][color=%06X]%ls: %d[/color][/p]"
 static const wchar_t* DisplayFormatNameString = L"[color=%06X]%ls - [/color][p][color=%06X]%ls: %ls[/color][/p]";
 static const wchar_t* DisplayFormatSimple = L"[p]%ls[/p]";
 
+// measured once instead of for every message
+static const size_t DisplayFormatNameLen = wcslen(DisplayFormatName);
+static const size_t DisplayFormatActionLen = wcslen(DisplayFormatAction);
+static const size_t DisplayFormatLen = wcslen(DisplayFormat);
+static const size_t DisplayFormatValueLen = wcslen(DisplayFormatValue);
+static const size_t DisplayFormatNameStringLen = wcslen(DisplayFormatNameString);
+static const size_t DisplayFormatSimpleLen = wcslen(DisplayFormatSimple);
+
+/**
+ * Scratch space for building a message. Each nesting level (a message
+ * formatted while building another) has its own buffer, and the buffers
+ * are kept, so busy fights don't allocate for every line of feedback.
+ */
+class MessageBuffer {
+public:
+	MessageBuffer() : level(depth++)
+	{
+		if (buffers.size() <= level) {
+			buffers.resize(level + 1);
+		}
+	}
+	~MessageBuffer() { depth--; }
+	/** len is the most characters the result may take, including the terminator */
+	const wchar_t* Format(size_t len, const wchar_t* format, ...);
+private:
+	size_t level;
+	// a deque, so growing it leaves the outer levels' buffers in place
+	static std::deque<std::vector<wchar_t> > buffers;
+	static size_t depth;
+};
+
+std::deque<std::vector<wchar_t> > MessageBuffer::buffers;
+size_t MessageBuffer::depth = 0;
+
+const wchar_t* MessageBuffer::Format(size_t len, const wchar_t* format, ...)
+{
+	std::vector<wchar_t>& buffer = buffers[level];
+	if (buffer.size() < len) {
+		buffer.resize(len);
+	}
+	va_list args;
+	va_start(args, format);
+	vswprintf(&buffer[0], len, format, args);
+	va_end(args);
+	return &buffer[0];
+}
+
 DisplayMessage::StrRefs DisplayMessage::SRefs;
 
 DisplayMessage::StrRefs::StrRefs()
@@ -109,11 +158,8 @@ void DisplayMessage::DisplayMarkupString(const String& Text) const
 
 void DisplayMessage::DisplayString(const String& text) const
 {
-	size_t newlen = wcslen(DisplayFormatSimple) + text.length() + 1;
-	wchar_t *newstr = (wchar_t *) malloc(newlen * sizeof(wchar_t));
-	swprintf(newstr, newlen, DisplayFormatSimple, text.c_str());
-	DisplayMarkupString(newstr);
-	free(newstr);
+	MessageBuffer buffer;
+	DisplayMarkupString(buffer.Format(DisplayFormatSimpleLen + text.length() + 1, DisplayFormatSimple, text.c_str()));
 }
 
 unsigned int DisplayMessage::GetSpeakerColor(String& name, const Scriptable *&speaker) const
@@ -183,11 +229,8 @@ void DisplayMessage::DisplayString(const String& text, unsigned int color, Scrip
 
 	TextArea* ta = core->GetMessageTextArea();
 	if (ta) {
-		size_t newlen = wcslen( DisplayFormat) + text.length() + 12;
-		wchar_t* newstr = ( wchar_t* ) malloc( newlen * sizeof(wchar_t) );
-		swprintf(newstr, newlen, DisplayFormat, color, text.c_str());
-		DisplayMarkupString( newstr );
-		free( newstr );
+		MessageBuffer buffer;
+		DisplayMarkupString(buffer.Format(DisplayFormatLen + text.length() + 12, DisplayFormat, color, text.c_str()));
 	}
 
 	if (target && l == NULL && ta == NULL) {
@@ -207,13 +250,10 @@ void DisplayMessage::DisplayConstantStringValue(int stridx, unsigned int color,
 		return;
 	}
 
-	size_t newlen = wcslen( DisplayFormatValue ) + text->length() + 10;
-	wchar_t* newstr = ( wchar_t* ) malloc( newlen * sizeof(wchar_t) );
-	swprintf( newstr, newlen, DisplayFormatValue, color, text->c_str(), value);
-
+	MessageBuffer buffer;
+	const wchar_t* newstr = buffer.Format(DisplayFormatValueLen + text->length() + 10, DisplayFormatValue, color, text->c_str(), value);
 	delete text;
 	DisplayMarkupString( newstr );
-	free( newstr );
 }
 
 // String format is
@@ -232,22 +272,18 @@ void DisplayMessage::DisplayConstantStringNameString(int stridx, unsigned int co
 	String* text2 = core->GetString( DisplayMessage::SRefs[stridx2], IE_STR_SOUND );
 
 	size_t newlen = text->length() + name.length();
+	MessageBuffer buffer;
+	const wchar_t* newstr;
 	if (text2) {
-		newlen += wcslen(DisplayFormatNameString) + text2->length();
-	} else {
-		newlen += wcslen(DisplayFormatName);
-	}
-
-	wchar_t* newstr = ( wchar_t* ) malloc( newlen * sizeof(wchar_t) );
-	if (text2) {
-		swprintf( newstr, newlen, DisplayFormatNameString, actor_color, name.c_str(), color, text->c_str(), text2->c_str() );
+		newlen += DisplayFormatNameStringLen + text2->length();
+		newstr = buffer.Format(newlen, DisplayFormatNameString, actor_color, name.c_str(), color, text->c_str(), text2->c_str());
 	} else {
-		swprintf( newstr, newlen, DisplayFormatName, color, name.c_str(), color, text->c_str() );
+		newlen += DisplayFormatNameLen;
+		newstr = buffer.Format(newlen, DisplayFormatName, color, name.c_str(), color, text->c_str());
 	}
 	delete text;
 	delete text2;
 	DisplayMarkupString( newstr );
-	free( newstr );
 }
 
 // String format is
@@ -270,11 +306,8 @@ void DisplayMessage::DisplayConstantStringNameValue(int stridx, unsigned int col
 
 	String* text = core->GetString( DisplayMessage::SRefs[stridx], IE_STR_SOUND|IE_STR_SPEECH );
 	//allow for a number
-	size_t bufflen = text->length() + 6;
-	wchar_t* newtext = ( wchar_t* ) malloc( bufflen * sizeof(wchar_t));
-	swprintf( newtext, bufflen, text->c_str(), value );
-	DisplayStringName(newtext, color, speaker);
-	free(newtext);
+	MessageBuffer buffer;
+	DisplayStringName(buffer.Format(text->length() + 6, text->c_str(), value), color, speaker);
 	delete text;
 }
 
@@ -296,12 +329,11 @@ void DisplayMessage::DisplayConstantStringAction(int stridx, unsigned int color,
 		return;
 	}
 
-	size_t newlen = wcslen( DisplayFormatAction ) + name1.length() + name2.length() + text->length() + 18;
-	wchar_t* newstr = ( wchar_t* ) malloc( newlen * sizeof(wchar_t));
-	swprintf( newstr, newlen, DisplayFormatAction, attacker_color, name1.c_str(), color, text->c_str(), name2.c_str());
+	size_t newlen = DisplayFormatActionLen + name1.length() + name2.length() + text->length() + 18;
+	MessageBuffer buffer;
+	const wchar_t* newstr = buffer.Format(newlen, DisplayFormatAction, attacker_color, name1.c_str(), color, text->c_str(), name2.c_str());
 	delete text;
 	DisplayMarkupString( newstr );
-	free( newstr );
 }
 
 // display tokenized strings like ~Open lock check. Open lock skill %d vs. lock difficulty %d (%d DEX bonus).~
@@ -342,11 +374,9 @@ void DisplayMessage::DisplayStringName(const String& text, unsigned int color, c
 	if (name.length() == 0) {
 		DisplayString(text, color, NULL);
 	} else {
-		size_t newlen = wcslen(DisplayFormatName) + name.length() + text.length() + 18;
-		wchar_t* newstr = (wchar_t *) malloc(newlen * sizeof(wchar_t));
-		swprintf(newstr, newlen, DisplayFormatName, speaker_color, name.c_str(), color, text.c_str());
-		DisplayMarkupString(newstr);
-		free(newstr);
+		size_t newlen = DisplayFormatNameLen + name.length() + text.length() + 18;
+		MessageBuffer buffer;
+		DisplayMarkupString(buffer.Format(newlen, DisplayFormatName, speaker_color, name.c_str(), color, text.c_str()));
 	}
 }
 }
@@ -27,10 +27,13 @@
 #ifndef EFFECT_H
 #define EFFECT_H
 
+#include "exports.h"
 #include "ie_types.h"
 
 #include "Region.h"
 
+#include <cstddef>
+
 namespace GemRB {
 
 class Actor;
@@ -83,7 +86,7 @@ class Actor;
  */
 
 // the same as ITMFeature and SPLFeature
-struct Effect {
+struct GEM_EXPORT Effect {
 	ieDword Opcode;
 	ieDword Target;
 	ieDword Power;
@@ -134,6 +137,10 @@ struct Effect {
 
 	ieDword SpellLevel; // Power does not always contain the Source level, which is needed in iwd2; items will be left at 0
 public:
+	// the spells, items and auras create and drop them all the time
+	static void *operator new(size_t size);
+	static void operator delete(void *obj, size_t size);
+
 	//don't modify position in case it was already set
 	void SetPosition(const Point &p) {
 		if(PosX==0xffffffff && PosY==0xffffffff) {
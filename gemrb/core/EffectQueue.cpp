@@ -29,12 +29,15 @@
 #include "Game.h"
 #include "Interface.h"
 #include "Map.h"
+#include "MemoryStats.h"
 #include "SymbolMgr.h"
 #include "Scriptable/Actor.h"
 #include "Spell.h" //needs for the source flags bitfield
 #include "TableMgr.h"
+#include "Tracer.h"
 #include "System/StringBuffer.h"
 
+#include <algorithm>
 #include <cstdio>
 #include "GameData.h"
 
@@ -45,10 +48,28 @@ static struct {
 	EffectFunction Function;
 	int Strref;
 	int Flags;
+	int Stat;
 } Opcodes[MAX_EFFECTS];
 
+static ObjectPool<sizeof(Effect)> EffectPool("effects");
+
+void *Effect::operator new(size_t size)
+{
+	MemoryStats::Add(MEM_EFFECTS, size);
+	return EffectPool.Take(size);
+}
+
+void Effect::operator delete(void *obj, size_t size)
+{
+	if (obj) {
+		MemoryStats::Remove(MEM_EFFECTS, size);
+	}
+	EffectPool.Give(obj, size);
+}
+
 static int initialized = 0;
 static EffectDesc *effectnames = NULL;
+static std::vector<EffectStatDesc> statmods;
 static int effectnames_count = 0;
 static int pstflags = false;
 static bool iwd2fx = false;
@@ -264,6 +285,7 @@ bool Init_EffectQueue()
 	memset( Opcodes, 0, sizeof( Opcodes ) );
 	for(i=0;i<MAX_EFFECTS;i++) {
 		Opcodes[i].Strref=-1;
+		Opcodes[i].Stat=-1;
 	}
 
 	initialized = 1;
@@ -299,6 +321,12 @@ bool Init_EffectQueue()
 			Opcodes[i].Function = poi->Function;
 			Opcodes[i].Name = poi->Name;
 			Opcodes[i].Flags = poi->Flags;
+			for (size_t j = 0; j < statmods.size(); j++) {
+				if (!stricmp(statmods[j].Name, poi->Name)) {
+					Opcodes[i].Stat = statmods[j].Stat;
+					break;
+				}
+			}
 			//reverse linking opcode number
 			//using this unused field
 			if( (poi->opcode!=-1) && effectname[0]!='*') {
@@ -320,6 +348,12 @@ void EffectQueue_ReleaseMemory()
 	}
 	effectnames_count = 0;
 	effectnames = NULL;
+	statmods.clear();
+}
+
+void EffectQueue_RegisterStatModifiers(int count, const EffectStatDesc* stats)
+{
+	statmods.insert(statmods.end(), stats, stats + count);
 }
 
 void EffectQueue_RegisterOpcodes(int count, const EffectDesc* opcodes)
@@ -342,11 +376,12 @@ void EffectQueue_RegisterOpcodes(int count, const EffectDesc* opcodes)
 EffectQueue::EffectQueue()
 {
 	Owner = NULL;
+	generation = 0;
 }
 
 EffectQueue::~EffectQueue()
 {
-	std::list< Effect* >::iterator f;
+	EffectList::iterator f;
 
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		delete (*f);
@@ -412,7 +447,7 @@ EffectQueue *EffectQueue::CopySelf() const
 	EffectQueue *effects;
 
 	effects = new EffectQueue();
-	std::list< Effect* >::const_iterator fxit = GetFirstEffect();
+	EffectList::const_iterator fxit = GetFirstEffect();
 	Effect *fx;
 
 	while( (fx = GetNextEffect(fxit))) {
@@ -477,10 +512,62 @@ void EffectQueue::AddEffect(Effect* fx, bool insert)
 {
 	Effect* new_fx = new Effect;
 	memcpy( new_fx, fx, sizeof( Effect ) );
+	EffectBucket &bucket = buckets[new_fx->Opcode];
 	if( insert) {
 		effects.insert( effects.begin(), new_fx );
+		bucket.insert( bucket.begin(), new_fx );
 	} else {
 		effects.push_back( new_fx );
+		bucket.push_back( new_fx );
+	}
+	generation++;
+}
+
+const EffectQueue::EffectBucket &EffectQueue::GetBucket(ieDword opcode) const
+{
+	static const EffectBucket none;
+
+	BucketMap::const_iterator b = buckets.find(opcode);
+	if (b == buckets.end()) {
+		return none;
+	}
+	return b->second;
+}
+
+void EffectQueue::RemoveFromBucket(Effect *fx, ieDword opcode) const
+{
+	BucketMap::iterator b = buckets.find(opcode);
+	if (b == buckets.end()) {
+		return;
+	}
+	EffectBucket::iterator f = std::find(b->second.begin(), b->second.end(), fx);
+	if (f == b->second.end()) {
+		return;
+	}
+	b->second.erase(f);
+	if (b->second.empty()) {
+		buckets.erase(b);
+	}
+}
+
+void EffectQueue::Refile(Effect *fx, ieDword oldOpcode) const
+{
+	const EffectBucket &old = GetBucket(oldOpcode);
+	if (std::find(old.begin(), old.end(), fx) == old.end()) {
+		// not one of ours
+		return;
+	}
+	RemoveFromBucket(fx, oldOpcode);
+	generation++;
+
+	// rebuilt from the list to keep it in queue order, converting is rare
+	EffectBucket &bucket = buckets[fx->Opcode];
+	bucket.clear();
+	EffectList::const_iterator f;
+	for ( f = effects.begin(); f != effects.end(); f++ ) {
+		if ((*f)->Opcode == fx->Opcode) {
+			bucket.push_back(*f);
+		}
 	}
 }
 
@@ -490,12 +577,14 @@ bool EffectQueue::RemoveEffect(Effect* fx)
 {
 	int invariant_size = offsetof( Effect, random_value );
 
-	for (std::list< Effect* >::iterator f = effects.begin(); f != effects.end(); f++ ) {
+	for (EffectList::iterator f = effects.begin(); f != effects.end(); f++ ) {
 		Effect* fx2 = *f;
 
 		if( (fx==fx2) || !memcmp( fx, fx2, invariant_size)) {
+			RemoveFromBucket(fx2, fx2->Opcode);
 			delete fx2;
 			effects.erase( f );
+			generation++;
 			return true;
 		}
 	}
@@ -507,9 +596,22 @@ bool EffectQueue::RemoveEffect(Effect* fx)
 //... but some require reinitialisation
 void EffectQueue::ApplyAllEffects(Actor* target) const
 {
-	std::list< Effect* >::const_iterator f;
+	TRACE_SCOPE("EffectQueue::ApplyAllEffects");
+	ieDword GameTime = core->GetGame()->GameTime;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		if (Opcodes[(*f)->Opcode].Flags & EFFECT_REINIT_ON_LOAD) {
+		Effect *fx = *f;
+		// plain stat modifiers that are already running only need their
+		// NewStat repeated, the timing and result handling are no-ops for them
+		if (target && fx->Opcode < MAX_EFFECTS && Opcodes[fx->Opcode].Stat >= 0 && !fx->FirstApply
+			&& fx->TimingMode != FX_DURATION_INSTANT_PERMANENT && fx->TimingMode != FX_DURATION_JUST_EXPIRED) {
+			int delay = DelayType(fx->TimingMode&0xff);
+			if (delay == PERMANENT || (delay == DURATION && fx->Duration > GameTime)) {
+				target->NewStat(Opcodes[fx->Opcode].Stat, fx->Parameter1, fx->Parameter2);
+				continue;
+			}
+		}
+		if (Opcodes[fx->Opcode].Flags & EFFECT_REINIT_ON_LOAD) {
 			// pretend to be the first application (FirstApply==1)
 			ApplyEffect(target, *f, 1);
 		} else {
@@ -518,14 +620,50 @@ void EffectQueue::ApplyAllEffects(Actor* target) const
 	}
 }
 
+//true if reapplying the queue would only repeat the last application,
+//until returns the earliest time a timed effect triggers or expires
+bool EffectQueue::OnlyStaticEffects(ieDword &until) const
+{
+	until = 0xffffffff;
+	EffectList::const_iterator f;
+	for ( f = effects.begin(); f != effects.end(); f++ ) {
+		if ((*f)->TimingMode == FX_DURATION_JUST_EXPIRED) {
+			continue;
+		}
+		if (!(Opcodes[(*f)->Opcode].Flags & EFFECT_STATIC)) {
+			return false;
+		}
+		if (DelayType((*f)->TimingMode&0xff) != PERMANENT && (*f)->Duration < until) {
+			until = (*f)->Duration;
+		}
+	}
+	return true;
+}
+
+static bool JustExpired(const Effect *fx)
+{
+	return fx->TimingMode == FX_DURATION_JUST_EXPIRED;
+}
+
 void EffectQueue::Cleanup()
 {
-	std::list< Effect* >::iterator f;
+	BucketMap::iterator b;
+	for ( b = buckets.begin(); b != buckets.end(); ) {
+		EffectBucket &bucket = b->second;
+		bucket.erase(std::remove_if(bucket.begin(), bucket.end(), JustExpired), bucket.end());
+		if (bucket.empty()) {
+			buckets.erase(b++);
+		} else {
+			b++;
+		}
+	}
 
+	EffectList::iterator f;
 	for ( f = effects.begin(); f != effects.end(); ) {
 		if( (*f)->TimingMode == FX_DURATION_JUST_EXPIRED) {
 			delete *f;
 			effects.erase(f++);
+			generation++;
 		} else {
 			f++;
 		}
@@ -759,7 +897,7 @@ int EffectQueue::AddAllEffects(Actor* target, const Point &destination) const
 	if( target) {
 		target->RollSaves();
 	}
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		//handle resistances and saving throws here
 		(*f)->random_value = random_value;
@@ -870,7 +1008,7 @@ static int check_type(Actor* actor, Effect* fx)
 	if(fx->Power && actor->fxqueue.HasEffectWithParamPair(fx_level_immunity_ref, fx->Power, 0) ) {
 		Actor *caster = core->GetGame()->GetActorByGlobalID(fx->CasterID);
 		if (caster != actor || (fx->SourceFlags & SF_HOSTILE)) {
-			Log(DEBUG, "EffectQueue", "Resisted by level immunity");
+			LogDebug("EffectQueue", "Resisted by level immunity");
 			return 0;
 		}
 	}
@@ -879,12 +1017,12 @@ static int check_type(Actor* actor, Effect* fx)
 	//if source is unspecified, don't resist it
 	if( fx->Source[0]) {
 		if( actor->fxqueue.HasEffectWithResource(fx_spell_immunity_ref, fx->Source) ) {
-			Log(DEBUG, "EffectQueue", "Resisted by spell immunity (%s)", fx->Source);
+			LogDebug("EffectQueue", "Resisted by spell immunity (%s)", fx->Source);
 			return 0;
 		}
 		if( actor->fxqueue.HasEffectWithResource(fx_spell_immunity2_ref, fx->Source) ) {
 			if (strnicmp(fx->Source, "detect", 6)) { // our secret door pervasive effect
-				Log(DEBUG, "EffectQueue", "Resisted by spell immunity2 (%s)", fx->Source);
+				LogDebug("EffectQueue", "Resisted by spell immunity2 (%s)", fx->Source);
 			}
 			return 0;
 		}
@@ -893,7 +1031,7 @@ static int check_type(Actor* actor, Effect* fx)
 	//primary type immunity (school)
 	if( fx->PrimaryType) {
 		if( actor->fxqueue.HasEffectWithParam(fx_school_immunity_ref, fx->PrimaryType)) {
-			Log(DEBUG, "EffectQueue", "Resisted by school/primary type");
+			LogDebug("EffectQueue", "Resisted by school/primary type");
 			return 0;
 		}
 	}
@@ -901,7 +1039,7 @@ static int check_type(Actor* actor, Effect* fx)
 	//secondary type immunity (usage)
 	if( fx->SecondaryType) {
 		if( actor->fxqueue.HasEffectWithParam(fx_secondary_type_immunity_ref, fx->SecondaryType) ) {
-			Log(DEBUG, "EffectQueue", "Resisted by usage/secondary type");
+			LogDebug("EffectQueue", "Resisted by usage/secondary type");
 			return 0;
 		}
 	}
@@ -912,7 +1050,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx = actor->fxqueue.HasEffectWithParam(fx_level_immunity_dec_ref, fx->Power);
 		if( efx ) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Resisted by level immunity (decrementing)");
+				LogDebug("EffectQueue", "Resisted by level immunity (decrementing)");
 				return 0;
 			}
 		}
@@ -923,7 +1061,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx = actor->fxqueue.HasEffectWithResource(fx_spell_immunity_dec_ref, fx->Source);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Resisted by spell immunity (decrementing)");
+				LogDebug("EffectQueue", "Resisted by spell immunity (decrementing)");
 				return 0;
 			}
 		}
@@ -933,7 +1071,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx = actor->fxqueue.HasEffectWithParam(fx_school_immunity_dec_ref, fx->PrimaryType);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Resisted by school immunity (decrementing)");
+				LogDebug("EffectQueue", "Resisted by school immunity (decrementing)");
 				return 0;
 			}
 		}
@@ -944,7 +1082,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx = actor->fxqueue.HasEffectWithParam(fx_secondary_type_immunity_dec_ref, fx->SecondaryType);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Resisted by usage/sectype immunity (decrementing)");
+				LogDebug("EffectQueue", "Resisted by usage/sectype immunity (decrementing)");
 				return 0;
 			}
 		}
@@ -965,7 +1103,7 @@ static int check_type(Actor* actor, Effect* fx)
 			//if decrease needs the spell level, use fx->Power here
 			actor->fxqueue.DecreaseParam1OfEffect(fx_spelltrap, 1);
 			//efx->Parameter1--;
-			Log(DEBUG, "EffectQueue", "Absorbed by spelltrap");
+			LogDebug("EffectQueue", "Absorbed by spelltrap");
 			return 0;
 		}
 	}
@@ -973,31 +1111,31 @@ static int check_type(Actor* actor, Effect* fx)
 	//bounce checks
 	if (fx->Power) {
 		if( (bounce&BNC_LEVEL) && actor->fxqueue.HasEffectWithParamPair(fx_level_bounce_ref, 0, fx->Power) ) {
-			Log(DEBUG, "EffectQueue", "Bounced by level");
+			LogDebug("EffectQueue", "Bounced by level");
 			return -1;
 		}
 	}
 
 	if((bounce&BNC_PROJECTILE) && actor->fxqueue.HasEffectWithParam(fx_projectile_bounce_ref, fx->Projectile)) {
-		Log(DEBUG, "EffectQueue", "Bounced by projectile");
+		LogDebug("EffectQueue", "Bounced by projectile");
 		return -1;
 	}
 
 	if( fx->Source[0] && (bounce&BNC_RESOURCE) && actor->fxqueue.HasEffectWithResource(fx_spell_bounce_ref, fx->Source) ) {
-		Log(DEBUG, "EffectQueue", "Bounced by resource");
+		LogDebug("EffectQueue", "Bounced by resource");
 		return -1;
 	}
 
 	if( fx->PrimaryType && (bounce&BNC_SCHOOL) ) {
 		if( actor->fxqueue.HasEffectWithParam(fx_school_bounce_ref, fx->PrimaryType)) {
-			Log(DEBUG, "EffectQueue", "Bounced by school");
+			LogDebug("EffectQueue", "Bounced by school");
 			return -1;
 		}
 	}
 
 	if( fx->SecondaryType && (bounce&BNC_SECTYPE) ) {
 		if( actor->fxqueue.HasEffectWithParam(fx_secondary_type_bounce_ref, fx->SecondaryType)) {
-			Log(DEBUG, "EffectQueue", "Bounced by usage/sectype");
+			LogDebug("EffectQueue", "Bounced by usage/sectype");
 			return -1;
 		}
 	}
@@ -1009,7 +1147,7 @@ static int check_type(Actor* actor, Effect* fx)
 			efx=actor->fxqueue.HasEffectWithParamPair(fx_level_bounce_dec_ref, 0, fx->Power);
 			if( efx) {
 				if (DecreaseEffect(efx)) {
-					Log(DEBUG, "EffectQueue", "Bounced by level (decrementing)");
+					LogDebug("EffectQueue", "Bounced by level (decrementing)");
 					return -1;
 				}
 			}
@@ -1020,7 +1158,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx=actor->fxqueue.HasEffectWithResource(fx_spell_bounce_dec_ref, fx->Resource);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Bounced by resource (decrementing)");
+				LogDebug("EffectQueue", "Bounced by resource (decrementing)");
 				return -1;
 			}
 		}
@@ -1030,7 +1168,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx=actor->fxqueue.HasEffectWithParam(fx_school_bounce_dec_ref, fx->PrimaryType);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Bounced by school (decrementing)");
+				LogDebug("EffectQueue", "Bounced by school (decrementing)");
 				return -1;
 			}
 		}
@@ -1040,7 +1178,7 @@ static int check_type(Actor* actor, Effect* fx)
 		efx=actor->fxqueue.HasEffectWithParam(fx_secondary_type_bounce_dec_ref, fx->SecondaryType);
 		if( efx) {
 			if (DecreaseEffect(efx)) {
-				Log(DEBUG, "EffectQueue", "Bounced by usage (decrementing)");
+				LogDebug("EffectQueue", "Bounced by usage (decrementing)");
 				return -1;
 			}
 		}
@@ -1290,8 +1428,13 @@ int EffectQueue::ApplyEffect(Actor* target, Effect* fx, ieDword first_apply, ieD
 			}
 		}
 
+		ieDword opcode = fx->Opcode;
 		res=fn( Owner, target, fx );
 		fx->FirstApply = 0;
+		//some effects turn into another one
+		if (fx->Opcode != opcode) {
+			Refile(fx, opcode);
+		}
 
 		//if there is no owner, we assume it is the target
 		switch( res ) {
@@ -1328,9 +1471,7 @@ int EffectQueue::ApplyEffect(Actor* target, Effect* fx, ieDword first_apply, ieD
 	return res;
 }
 
-// looks for opcode with param2
-
-#define MATCH_OPCODE() if((*f)->Opcode!=opcode) { continue; }
+// the opcode queries walk only the bucket of their opcode
 
 // useful for: remove equipped item
 #define MATCH_SLOTCODE() if((*f)->InventorySlot!=slotcode) { continue; }
@@ -1356,47 +1497,51 @@ static inline bool IsLive(ieByte timingmode)
 //will be killed along with it
 void EffectQueue::RemoveAllEffects(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
 //removes all equipping effects that match slotcode
 void EffectQueue::RemoveEquippingEffects(ieDwordSigned slotcode) const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		if( !IsEquipped((*f)->TimingMode)) continue;
 		MATCH_SLOTCODE();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
 //removes all effects that match projectile
 void EffectQueue::RemoveAllEffectsWithProjectile(ieDword projectile) const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		MATCH_PROJECTILE();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
 //remove effects belonging to a given spell
 void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 
 	if (!Owner || (Owner->Type != ST_ACTOR)) return;
@@ -1409,6 +1554,7 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 		Log(WARNING, "EffectQueue", "Spell %s has more than one extended header, removing only first!", Removed);
 	}
 	SPLExtHeader *sph = spell->GetExtHeader(0);
+	spell->LoadFeatures();
 	for (int i=0; i < sph->FeatureCount; i++) {
 		Effect *origfx = sph->features+i;
 
@@ -1431,7 +1577,7 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 
 		fx->Parameter1 = -fx->Parameter1;
 
-		Log(DEBUG, "EffectQueue", "Manually removing effect %d (from %s)", fx->Opcode, Removed);
+		LogDebug("EffectQueue", "Manually removing effect %d (from %s)", fx->Opcode, Removed);
 		ApplyEffect((Actor *)Owner, fx, 1, 0);
 		delete fx;
 	}
@@ -1441,12 +1587,13 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 //remove effects belonging to a given spell, but only if they match timing method x
 void EffectQueue::RemoveAllEffects(const ieResRef Removed, ieByte timing) const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		MATCH_TIMING();
 		MATCH_SOURCE();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
@@ -1463,13 +1610,14 @@ void EffectQueue::RemoveAllEffects(EffectRef &effect_reference) const
 //Removes all effects with a matching resource field
 void EffectQueue::RemoveAllEffectsWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
@@ -1484,9 +1632,9 @@ void EffectQueue::RemoveAllEffectsWithResource(EffectRef &effect_reference, cons
 //(works only if a higher stat means good for the target)
 void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		switch((*f)->Parameter2) {
 		case 0:case 3:
@@ -1502,6 +1650,7 @@ void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) c
 			break;
 		}
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
@@ -1518,13 +1667,14 @@ void EffectQueue::RemoveAllDetrimentalEffects(EffectRef &effect_reference, ieDwo
 //opcode need to be removed (see removal of portrait icon)
 void EffectQueue::RemoveAllEffectsWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
@@ -1538,9 +1688,9 @@ void EffectQueue::RemoveAllEffectsWithParam(EffectRef &effect_reference, ieDword
 //Removes all effects with a matching resource field
 void EffectQueue::RemoveAllEffectsWithParamAndResource(ieDword opcode, ieDword param2, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		if(resource[0]) {
@@ -1548,6 +1698,7 @@ void EffectQueue::RemoveAllEffectsWithParamAndResource(ieDword opcode, ieDword p
 		}
 
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 	}
 }
 
@@ -1570,13 +1721,14 @@ void EffectQueue::RemoveExpiredEffects(ieDword futuretime) const
 		GameTime += futuretime;
 	}
 
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		//FIXME: how this method handles delayed effects???
 		//it should remove them as well, i think
 		if( DelayType( ((*f)->TimingMode) )!=PERMANENT ) {
 			if( (*f)->Duration<=GameTime) {
 				(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+				generation++;
 			}
 		}
 	}
@@ -1586,10 +1738,11 @@ void EffectQueue::RemoveExpiredEffects(ieDword futuretime) const
 //which i call permanent after death (iesdp calls it permanent after bonuses)
 void EffectQueue::RemoveAllNonPermanentEffects() const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		if( IsRemovable((*f)->TimingMode) ) {
 			(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+			generation++;
 		}
 	}
 }
@@ -1600,7 +1753,7 @@ void EffectQueue::RemoveAllNonPermanentEffects() const
 void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword Flags, ieDword match) const
 {
 	Removed[0]=0;
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		if( (*f)->Power>level) {
 			continue;
@@ -1627,6 +1780,7 @@ void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword F
 			}
 		}
 		(*f)->TimingMode = FX_DURATION_JUST_EXPIRED;
+		generation++;
 		if( Flags&RL_REMOVEFIRST) {
 			memcpy(Removed,(*f)->Source, sizeof(Removed));
 		}
@@ -1635,9 +1789,9 @@ void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword F
 
 Effect *EffectQueue::HasOpcode(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		return (*f);
@@ -1656,9 +1810,9 @@ Effect *EffectQueue::HasEffect(EffectRef &effect_reference) const
 
 Effect *EffectQueue::HasOpcodeWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 
@@ -1682,9 +1836,9 @@ Effect *EffectQueue::HasEffectWithParam(EffectRef &effect_reference, ieDword par
 
 Effect *EffectQueue::HasOpcodeWithParamPair(ieDword opcode, ieDword param1, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		//0 is always accepted as first parameter
@@ -1710,9 +1864,9 @@ Effect *EffectQueue::HasEffectWithParamPair(EffectRef &effect_reference, ieDword
 //this could be used for stoneskins and mirror images as well
 void EffectQueue::DecreaseParam1OfEffect(ieDword opcode, ieDword amount) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		ieDword value = (*f)->Parameter1;
 		if( value>amount) {
@@ -1723,6 +1877,7 @@ void EffectQueue::DecreaseParam1OfEffect(ieDword opcode, ieDword amount) const
 			value = 0;
 		}
 		(*f)->Parameter1=value;
+		generation++;
 		if (value) {
 			return;
 		}
@@ -1742,9 +1897,9 @@ void EffectQueue::DecreaseParam1OfEffect(EffectRef &effect_reference, ieDword am
 //returns the damage amount NOT soaked
 int EffectQueue::DecreaseParam3OfEffect(ieDword opcode, ieDword amount, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		ieDword value = (*f)->Parameter3;
@@ -1756,6 +1911,7 @@ int EffectQueue::DecreaseParam3OfEffect(ieDword opcode, ieDword amount, ieDword
 			value = 0;
 		}
 		(*f)->Parameter3=value;
+		generation++;
 		if (value) {
 			return 0;
 		}
@@ -1782,9 +1938,9 @@ static const int ids_stats[9]={IE_FACTION, IE_TEAM, IE_EA, IE_GENERAL, IE_RACE,
 int EffectQueue::BonusAgainstCreature(ieDword opcode, Actor *actor) const
 {
 	int sum = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		if( (*f)->Parameter1) {
 			ieDword param1;
@@ -1832,9 +1988,9 @@ int EffectQueue::BonusAgainstCreature(EffectRef &effect_reference, Actor *actor)
 int EffectQueue::BonusForParam2(ieDword opcode, ieDword param2) const
 {
 	int sum = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
 		sum += (*f)->Parameter1;
@@ -1855,9 +2011,9 @@ int EffectQueue::MaxParam1(ieDword opcode, bool positive) const
 {
 	int max = 0;
 	ieDwordSigned param1 = 0;
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		param1 = signed((*f)->Parameter1);
@@ -1879,9 +2035,9 @@ int EffectQueue::MaxParam1(EffectRef &effect_reference, bool positive) const
 
 bool EffectQueue::WeaponImmunity(ieDword opcode, int enchantment, ieDword weapontype) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		//
 		int magic = (int) (*f)->Parameter1;
@@ -1920,15 +2076,15 @@ void EffectQueue::AddWeaponEffects(EffectQueue *fxqueue, EffectRef &fx_ref) cons
 	ieDword opcode = fx_ref.opcode;
 	Point p(-1,-1);
 
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		//
-		Effect *fx = core->GetEffect( (*f)->Resource, (*f)->Power, p);
-		if (!fx) continue;
-		fx->Target = FX_TARGET_PRESET;
-		fxqueue->AddEffect(fx, true);
+		Effect fx;
+		if (!core->GetEffect( (*f)->Resource, (*f)->Power, p, fx)) continue;
+		fx.Target = FX_TARGET_PRESET;
+		fxqueue->AddEffect(&fx, true);
 	}
 }
 
@@ -1940,9 +2096,9 @@ int EffectQueue::SumDamageReduction(EffectRef &effect_reference, ieDword weaponE
 	int remaining = 0;
 	int count = 0;
 
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 
 		Effect* fx = *f;
@@ -1964,9 +2120,9 @@ int EffectQueue::SumDamageReduction(EffectRef &effect_reference, ieDword weaponE
 //useful for immunity vs spell, can't use item, etc.
 Effect *EffectQueue::HasOpcodeWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
 
@@ -1990,9 +2146,9 @@ Effect *EffectQueue::HasEffectWithPower(EffectRef &effect_reference, ieDword pow
 
 Effect *EffectQueue::HasOpcodeWithPower(ieDword opcode, ieDword power) const
 {
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		// NOTE: matching greater or equals!
 		if ((*f)->Power < power) { continue; }
@@ -2005,7 +2161,7 @@ Effect *EffectQueue::HasOpcodeWithPower(ieDword opcode, ieDword power) const
 //returns the first effect with source 'Removed'
 Effect *EffectQueue::HasSource(const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
@@ -2018,9 +2174,9 @@ Effect *EffectQueue::HasSource(const ieResRef Removed) const
 //used in contingency/sequencer code (cannot have the same contingency twice)
 Effect *EffectQueue::HasOpcodeWithSource(ieDword opcode, const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
@@ -2037,7 +2193,7 @@ Effect *EffectQueue::HasEffectWithSource(EffectRef &effect_reference, const ieRe
 
 bool EffectQueue::HasAnyDispellableEffect() const
 {
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		if( (*f)->Resistance&FX_CAN_DISPEL) {
 			return true;
@@ -2050,14 +2206,14 @@ void EffectQueue::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "EffectQueue", buffer);
+	LogDebug("EffectQueue", buffer);
 }
 
 void EffectQueue::dump(StringBuffer& buffer) const
 {
 	buffer.append("EFFECT QUEUE:\n");
 	int i = 0;
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		Effect* fx = *f;
 		if( fx) {
@@ -2129,7 +2285,7 @@ void EffectQueue::HackColorEffects(Actor *Owner, Effect *fx)
 }
 
 //iterate through saved effects
-const Effect *EffectQueue::GetNextSavedEffect(std::list< Effect* >::const_iterator &f) const
+const Effect *EffectQueue::GetNextSavedEffect(EffectList::const_iterator &f) const
 {
 	while(f!=effects.end()) {
 		Effect *effect = *f;
@@ -2141,7 +2297,7 @@ const Effect *EffectQueue::GetNextSavedEffect(std::list< Effect* >::const_iterat
 	return NULL;
 }
 
-Effect *EffectQueue::GetNextEffect(std::list< Effect* >::const_iterator &f) const
+Effect *EffectQueue::GetNextEffect(EffectList::const_iterator &f) const
 {
 	if( f!=effects.end()) return *f++;
 	return NULL;
@@ -2151,10 +2307,10 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 {
 	ieDword cnt = 0;
 
-	std::list< Effect* >::const_iterator f;
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		if( param1!=0xffffffff)
 			MATCH_PARAM1();
 		if( param2!=0xffffffff)
@@ -2169,13 +2325,14 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 
 void EffectQueue::ModifyEffectPoint(ieDword opcode, ieDword x, ieDword y) const
 {
-	std::list< Effect* >::const_iterator f;
+	const EffectBucket &bucket = GetBucket(opcode);
+	EffectBucket::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
-		MATCH_OPCODE();
+	for ( f = bucket.begin(); f != bucket.end(); f++ ) {
 		(*f)->PosX=x;
 		(*f)->PosY=y;
 		(*f)->Parameter3=0;
+		generation++;
 		return;
 	}
 }
@@ -2185,7 +2342,7 @@ ieDword EffectQueue::GetSavedEffectsCount() const
 {
 	ieDword cnt = 0;
 
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 
 	for ( f = effects.begin(); f != effects.end(); f++ ) {
 		Effect* fx = *f;
@@ -2277,7 +2434,7 @@ bool EffectQueue::HasHostileEffects() const
 {
 	bool hostile = false;
 
-	std::list< Effect* >::const_iterator f;
+	EffectList::const_iterator f;
 	for (f = effects.begin(); f != effects.end(); f++) {
 		Effect* fx = *f;
 		if (fx->SourceFlags&SF_HOSTILE) {
@@ -31,10 +31,13 @@
 #include "exports.h"
 
 #include "Effect.h"
+#include "ObjectPool.h"
 #include "Region.h"
 
 #include <cstdlib>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace GemRB {
 
@@ -161,6 +164,13 @@ struct EffectDesc {
 	int opcode;
 };
 
+/** Links the opcodes that are a plain STAT_MOD once queued to their stat,
+ * see EffectQueue::ApplyAllEffects */
+struct EffectStatDesc {
+	const char* Name;
+	int Stat;
+};
+
 enum EffectFlags {
 	EFFECT_NORMAL = 0,
 	EFFECT_DICED = 1,
@@ -168,7 +178,8 @@ enum EffectFlags {
 	EFFECT_NO_ACTOR = 4,
 	EFFECT_REINIT_ON_LOAD = 8,
 	EFFECT_PRESET_TARGET = 16,
-	EFFECT_SPECIAL_UNDO = 32
+	EFFECT_SPECIAL_UNDO = 32,
+	EFFECT_STATIC = 64 // only derives stats from its parameters, see Actor::RefreshEffects
 };
 
 /** Initializes table of available spell Effects used by all the queues. */
@@ -177,6 +188,7 @@ bool Init_EffectQueue();
 
 /** Registers opcodes implemented by an effect plugin */
 void EffectQueue_RegisterOpcodes(int count, const EffectDesc *opcodes);
+void EffectQueue_RegisterStatModifiers(int count, const EffectStatDesc *stats);
 
 /** release effect list when Interface is destroyed */
 void EffectQueue_ReleaseMemory();
@@ -184,6 +196,9 @@ void EffectQueue_ReleaseMemory();
 /** Check if opcode is for an effect that takes a color slot as parameter. */
 bool IsColorslotEffect(int opcode);
 
+/** the queue's list, its nodes come from a pool */
+typedef std::list< Effect*, PoolAllocator< Effect* > > EffectList;
+
 /**
  * @class EffectQueue
  * Class holding and processing spell Effects on a single Actor
@@ -192,7 +207,17 @@ bool IsColorslotEffect(int opcode);
 class GEM_EXPORT EffectQueue {
 private:
 	/** List of Effects applied on the Actor */
-	std::list< Effect* > effects;
+	EffectList effects;
+	/** The same Effects by opcode, each in queue order, so the opcode
+	 * queries don't walk the whole list. Applying an effect may convert
+	 * it to another opcode, hence mutable */
+	typedef std::vector< Effect* > EffectBucket;
+	typedef std::map< ieDword, EffectBucket, std::less< ieDword >,
+		PoolAllocator< std::pair< const ieDword, EffectBucket > > > BucketMap;
+	mutable BucketMap buckets;
+	/** Bumped whenever an effect is added, removed or changed by the queue,
+	 * so the owner can tell if reapplying would do the same */
+	mutable ieDword generation;
 	/** Actor which is target of the Effects */
 	Scriptable* Owner;
 
@@ -219,6 +244,8 @@ public:
 
 	int AddAllEffects(Actor* target, const Point &dest) const;
 	void ApplyAllEffects(Actor* target) const;
+	bool OnlyStaticEffects(ieDword &until) const;
+	ieDword GetGeneration() const { return generation; }
 	/** remove effects marked for removal */
 	void Cleanup();
 
@@ -254,12 +281,12 @@ public:
 	/* returns true if the effect should be saved */
 	static bool Persistent(Effect* fx);
 	/* returns next saved effect, increases index */
-	std::list< Effect* >::const_iterator GetFirstEffect() const
+	EffectList::const_iterator GetFirstEffect() const
 	{
 		return effects.begin();
 	}
-	const Effect *GetNextSavedEffect(std::list< Effect* >::const_iterator &f) const;
-	Effect *GetNextEffect(std::list< Effect* >::const_iterator &f) const;
+	const Effect *GetNextSavedEffect(EffectList::const_iterator &f) const;
+	Effect *GetNextEffect(EffectList::const_iterator &f) const;
 	ieDword CountEffects(EffectRef &effect_reference, ieDword param1, ieDword param2, const char *ResRef) const;
 	void ModifyEffectPoint(EffectRef &effect_reference, ieDword x, ieDword y) const;
 	/* returns the number of saved effects */
@@ -335,6 +362,11 @@ private:
 	int MaxParam1(ieDword opcode, bool positive) const;
 	int BonusAgainstCreature(ieDword opcode, Actor *actor) const;
 	bool WeaponImmunity(ieDword opcode, int enchantment, ieDword weapontype) const;
+	/** the effects with this opcode, in queue order */
+	const EffectBucket &GetBucket(ieDword opcode) const;
+	void RemoveFromBucket(Effect *fx, ieDword opcode) const;
+	/** moves a queued effect an effect function converted to its new bucket */
+	void Refile(Effect *fx, ieDword oldOpcode) const;
 };
 
 }
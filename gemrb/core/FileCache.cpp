@@ -21,6 +21,7 @@
 #include "Compressor.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "ResourceStats.h"
 #include "System/FileStream.h"
 #include "System/VFS.h"
 
@@ -32,20 +33,25 @@ DataStream* CacheCompressedStream(DataStream *stream, const char* filename, int
 		Log(ERROR, "FileCache", "No Compression Manager Available. Cannot Load Compressed File.");
 		return NULL;
 	}
+	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
+	return CacheCompressedStream(comp.get(), stream, filename, length, overwrite);
+}
 
+DataStream* CacheCompressedStream(Compressor *comp, DataStream *stream, const char* filename, int length, bool overwrite)
+{
 	char fname[_MAX_PATH];
 	ExtractFileFromPath(fname, filename);
 	char path[_MAX_PATH];
 	PathJoin(path, core->CachePath, fname, NULL);
 
 	if (overwrite || !file_exists(path)) {
+		DecompressionTimer timer;
 		FileStream out;
 		if (!out.Create(path)) {
 			Log(ERROR, "FileCache", "Cannot write %s.", path);
 			return NULL;
 		}
 
-		PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
 		if (comp->Decompress(&out, stream, length) != GEM_OK)
 			return NULL;
 	} else {
@@ -23,7 +23,11 @@
 
 namespace GemRB {
 
+class Compressor;
+
 GEM_EXPORT DataStream* CacheCompressedStream(DataStream *stream, const char* filename, int length = 0, bool overwrite = false);
+/* the same with a compressor made beforehand, for the threads that mustn't create plugins */
+GEM_EXPORT DataStream* CacheCompressedStream(Compressor *comp, DataStream *stream, const char* filename, int length = 0, bool overwrite = false);
 
 }
 
@@ -0,0 +1,209 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "FlowField.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace GemRB {
+
+//the fields kept per area
+#define FLOW_MAX_FIELDS 4
+//the goals remembered per area
+#define FLOW_MAX_DEMANDS 8
+//how long (in ms) a goal waits for a second walker
+#define FLOW_DEMAND_TIME 2000
+//how long (in ms) an unused field is kept
+#define FLOW_EXPIRY 5000
+
+// the steps are stored as the offset to the next cell, (dx+1)+(dy+1)*3
+#define FLOW_AT_GOAL 4
+#define FLOW_UNREACHED 0xff
+
+FlowField::FlowField(PathFinder *finder, PathMapSource &source, const Point &goal, unsigned int size)
+	: LastUse(0), Goal(goal), Size(size)
+{
+	Left = std::max(0, goal.x - FLOW_FIELD_RADIUS);
+	Top = std::max(0, goal.y - FLOW_FIELD_RADIUS);
+	int right = std::min((int) finder->GetWidth() - 1, goal.x + FLOW_FIELD_RADIUS);
+	int bottom = std::min((int) finder->GetHeight() - 1, goal.y + FLOW_FIELD_RADIUS);
+	Width = std::max(0, right - Left + 1);
+	Height = std::max(0, bottom - Top + 1);
+	Steps.assign(Width * Height, FLOW_UNREACHED);
+
+	// the moves cost the same both ways, so the parents of a flood from
+	// the goal lead back to it
+	finder->Begin(goal);
+	Point p, parent;
+	unsigned int cost;
+	while (finder->Next(p, cost)) {
+		int index = IndexOf(p);
+		if (index < 0) {
+			// the field ends here, don't go further
+			continue;
+		}
+		if (finder->GetParent(p, parent)) {
+			Steps[index] = (unsigned char) ((parent.x - p.x + 1) + (parent.y - p.y + 1) * 3);
+		} else {
+			Steps[index] = FLOW_AT_GOAL;
+		}
+		finder->Expand(source, size);
+	}
+}
+
+int FlowField::IndexOf(const Point &p) const
+{
+	int x = p.x - Left;
+	int y = p.y - Top;
+	if (x < 0 || y < 0 || x >= Width || y >= Height) {
+		return -1;
+	}
+	return y * Width + x;
+}
+
+bool FlowField::Covers(const Point &p) const
+{
+	int index = IndexOf(p);
+	return index >= 0 && Steps[index] != FLOW_UNREACHED;
+}
+
+bool FlowField::Overlaps(unsigned int x, unsigned int y) const
+{
+	return (int) x >= Left && (int) y >= Top && (int) x < Left + Width && (int) y < Top + Height;
+}
+
+bool FlowField::GetNext(const Point &p, Point &next) const
+{
+	int index = IndexOf(p);
+	if (index < 0) {
+		return false;
+	}
+	unsigned char step = Steps[index];
+	if (step == FLOW_UNREACHED || step == FLOW_AT_GOAL) {
+		return false;
+	}
+	next.x = (short) (p.x + step % 3 - 1);
+	next.y = (short) (p.y + step / 3 - 1);
+	return true;
+}
+
+FlowFieldCache::FlowFieldCache(PathFinder *finder)
+	: finder(finder), nextDemand(0)
+{
+}
+
+FlowFieldCache::~FlowFieldCache()
+{
+	Clear();
+}
+
+void FlowFieldCache::Clear()
+{
+	for (size_t i = 0; i < fields.size(); i++) {
+		delete fields[i];
+	}
+	fields.clear();
+	demands.clear();
+	nextDemand = 0;
+}
+
+bool FlowFieldCache::IsNear(const Point &a, const Point &b)
+{
+	return abs(a.x - b.x) <= FLOW_GOAL_REGION && abs(a.y - b.y) <= FLOW_GOAL_REGION;
+}
+
+void FlowFieldCache::Expire(ieDword time)
+{
+	size_t i = fields.size();
+	while (i--) {
+		if (time - fields[i]->LastUse > FLOW_EXPIRY) {
+			delete fields[i];
+			fields.erase(fields.begin() + i);
+		}
+	}
+}
+
+FlowField *FlowFieldCache::Get(PathMapSource &source, const Point &start, const Point &goal, unsigned int size, ieDword time)
+{
+	Expire(time);
+
+	size_t i;
+	for (i = 0; i < fields.size(); i++) {
+		FlowField *field = fields[i];
+		if (field->GetSize() == size && IsNear(field->GetGoal(), goal) && field->Covers(start)) {
+			field->LastUse = time;
+			return field;
+		}
+	}
+
+	bool shared = false;
+	for (i = 0; i < demands.size(); i++) {
+		const Demand &demand = demands[i];
+		if (demand.size == size && IsNear(demand.goal, goal) && time - demand.time <= FLOW_DEMAND_TIME) {
+			shared = true;
+			break;
+		}
+	}
+	if (!shared) {
+		Demand demand;
+		demand.goal = goal;
+		demand.size = size;
+		demand.time = time;
+		if (demands.size() < FLOW_MAX_DEMANDS) {
+			demands.push_back(demand);
+		} else {
+			demands[nextDemand] = demand;
+			nextDemand = (nextDemand + 1) % FLOW_MAX_DEMANDS;
+		}
+		return NULL;
+	}
+
+	if (fields.size() >= FLOW_MAX_FIELDS) {
+		size_t oldest = 0;
+		for (i = 1; i < fields.size(); i++) {
+			if (time - fields[i]->LastUse > time - fields[oldest]->LastUse) {
+				oldest = i;
+			}
+		}
+		delete fields[oldest];
+		fields.erase(fields.begin() + oldest);
+	}
+	FlowField *field = new FlowField(finder, source, goal, size);
+	field->LastUse = time;
+	fields.push_back(field);
+	if (!field->Covers(start)) {
+		return NULL;
+	}
+	return field;
+}
+
+void FlowFieldCache::Invalidate(unsigned int x, unsigned int y)
+{
+	size_t i = fields.size();
+	while (i--) {
+		if (fields[i]->Overlaps(x, y)) {
+			delete fields[i];
+			fields.erase(fields.begin() + i);
+		}
+	}
+}
+
+}
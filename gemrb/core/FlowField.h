@@ -0,0 +1,103 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "PathFinder.h"
+
+#include <vector>
+
+namespace GemRB {
+
+//cells around the goal a flow field reaches
+#define FLOW_FIELD_RADIUS 48
+//goals this close (in cells) share a field, walkers leave it this close to theirs
+#define FLOW_GOAL_REGION 8
+
+/* Distance field towards one goal
+ * a Dijkstra flood from the goal over the passability without the actors,
+ * so every cell it reached knows its next step towards the goal. Walkers
+ * heading for the same place (a party ordered somewhere, a crowd chasing
+ * someone) walk down the same field instead of searching each.
+ */
+class GEM_EXPORT FlowField {
+public:
+	FlowField(PathFinder *finder, PathMapSource &source, const Point &goal, unsigned int size);
+
+	const Point &GetGoal() const { return Goal; }
+	unsigned int GetSize() const { return Size; }
+	/* true if the flood reached the cell */
+	bool Covers(const Point &p) const;
+	/* true if the cell is within the flooded square, so it matters to the field */
+	bool Overlaps(unsigned int x, unsigned int y) const;
+	/* the neighbour of p one step closer to the goal, false at the goal or off the field */
+	bool GetNext(const Point &p, Point &next) const;
+
+	ieDword LastUse;
+private:
+	Point Goal;
+	unsigned int Size;
+	int Left, Top, Width, Height;
+	// the offset of the next step of each cell, see FlowField.cpp
+	std::vector<unsigned char> Steps;
+
+	int IndexOf(const Point &p) const;
+};
+
+/* the fields of an area
+ * a field only pays off from the second walker on, so the first one asking
+ * for a goal is just remembered; the fields are kept while the goal is in
+ * use and dropped when the passability under them changes (doors), the
+ * actors are left to the walkers
+ */
+class GEM_EXPORT FlowFieldCache {
+public:
+	FlowFieldCache(PathFinder *finder);
+	~FlowFieldCache();
+
+	/* the field leading from start to a goal near this one, if it is shared */
+	FlowField *Get(PathMapSource &source, const Point &start, const Point &goal, unsigned int size, ieDword time);
+	/* a cell changed, the fields flooded over it are dropped */
+	void Invalidate(unsigned int x, unsigned int y);
+	void Clear();
+	/* true if the goals are close enough to share a field */
+	static bool IsNear(const Point &a, const Point &b);
+private:
+	struct Demand {
+		Point goal;
+		unsigned int size;
+		ieDword time;
+	};
+
+	PathFinder *finder;
+	std::vector<FlowField *> fields;
+	std::vector<Demand> demands;
+	unsigned int nextDemand;
+
+	void Expire(ieDword time);
+};
+
+}
+
+#endif
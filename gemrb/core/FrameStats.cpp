@@ -0,0 +1,152 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "FrameStats.h"
+
+#include "Interface.h"
+#include "Video.h"
+#include "GUI/TextSystem/Font.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace GemRB {
+
+// frames kept for the percentiles, the averages and the graph
+#define FRAME_HISTORY 120
+#define GRAPH_HEIGHT 60
+// graph pixels per millisecond
+#define GRAPH_SCALE 2
+
+struct FrameRecord {
+	unsigned __int64 time;
+	unsigned __int64 sections[FRAME_SECTIONS];
+	unsigned int counts[FRAME_COUNTERS];
+};
+
+static FrameRecord history[FRAME_HISTORY];
+static unsigned int recorded, newest;
+static unsigned __int64 sections[FRAME_SECTIONS];
+static unsigned __int64 lastEnd;
+
+bool FrameStats::enabled = false;
+unsigned int FrameStats::counts[FRAME_COUNTERS];
+FrameTimer *FrameStats::current = NULL;
+
+void FrameStats::SetEnabled(bool enable)
+{
+	enabled = enable;
+	recorded = newest = 0;
+	lastEnd = 0;
+	memset(sections, 0, sizeof(sections));
+	memset(counts, 0, sizeof(counts));
+}
+
+void FrameStats::Add(FrameSection section, unsigned __int64 time)
+{
+	sections[section] += time;
+}
+
+void FrameStats::EndFrame()
+{
+	if (!enabled) {
+		return;
+	}
+	unsigned __int64 now = ScriptProfiler::Now();
+	if (lastEnd) {
+		newest = (newest + 1) % FRAME_HISTORY;
+		FrameRecord &record = history[newest];
+		record.time = now - lastEnd;
+		memcpy(record.sections, sections, sizeof(sections));
+		memcpy(record.counts, counts, sizeof(counts));
+		if (recorded < FRAME_HISTORY) {
+			recorded++;
+		}
+	}
+	lastEnd = now;
+	memset(sections, 0, sizeof(sections));
+	memset(counts, 0, sizeof(counts));
+}
+
+static double Percentile(const std::vector<unsigned __int64> &sorted, unsigned int percent)
+{
+	return sorted[(sorted.size() - 1) * percent / 100] / 1e6;
+}
+
+void FrameStats::Draw(Font *font, Palette *palette)
+{
+	if (!enabled || !recorded) {
+		return;
+	}
+
+	std::vector<unsigned __int64> times(recorded);
+	double averages[FRAME_SECTIONS] = {};
+	unsigned int totals[FRAME_COUNTERS] = {};
+	for (unsigned int i = 0; i < recorded; i++) {
+		const FrameRecord &record = history[(newest + FRAME_HISTORY - i) % FRAME_HISTORY];
+		times[i] = record.time;
+		for (int j = 0; j < FRAME_SECTIONS; j++) {
+			averages[j] += record.sections[j] / 1e6 / recorded;
+		}
+		for (int j = 0; j < FRAME_COUNTERS; j++) {
+			totals[j] += record.counts[j];
+		}
+	}
+	std::sort(times.begin(), times.end());
+
+	wchar_t lines[3][80];
+	swprintf(lines[0], 80, L"frame %.1f ms  50%% %.1f  95%% %.1f  99%% %.1f",
+		history[newest].time / 1e6, Percentile(times, 50), Percentile(times, 95), Percentile(times, 99));
+	swprintf(lines[1], 80, L"input %.1f  game %.1f  area %.1f  gui %.1f  swap %.1f",
+		averages[FRAME_INPUT], averages[FRAME_GAME], averages[FRAME_AREA], averages[FRAME_GUI], averages[FRAME_SWAP]);
+	swprintf(lines[2], 80, L"draws %u  blits %u  paths %u  scripts %u",
+		totals[FRAME_DRAWS] / recorded, totals[FRAME_BLITS] / recorded,
+		totals[FRAME_PATHS] / recorded, totals[FRAME_SCRIPTS] / recorded);
+
+	Video *video = core->GetVideoDriver();
+	int lineHeight = font->LineHeight;
+	Region rgn(0, 0, FRAME_HISTORY * 3, 3 * lineHeight + GRAPH_HEIGHT + 4);
+	video->DrawRect(rgn, ColorBlack);
+	video->MarkDirty(rgn);
+	for (int i = 0; i < 3; i++) {
+		font->Print(Region(2, i * lineHeight, rgn.w - 4, lineHeight), String(lines[i]), palette,
+			IE_FONT_ALIGN_LEFT | IE_FONT_ALIGN_MIDDLE | IE_FONT_SINGLE_LINE);
+	}
+
+	// the oldest frame on the left, the target frame time as a line
+	int bottom = rgn.h - 2;
+	unsigned int target = core->MaxFPS > 0 ? 1000 / core->MaxFPS : 33;
+	const Color green = { 0x00, 0xc0, 0x00, 0xff };
+	const Color yellow = { 0xe0, 0xe0, 0x00, 0xff };
+	const Color red = { 0xe0, 0x00, 0x00, 0xff };
+	for (unsigned int i = 0; i < recorded; i++) {
+		const FrameRecord &record = history[(newest + FRAME_HISTORY - i) % FRAME_HISTORY];
+		unsigned int ms = (unsigned int) (record.time / 1000000);
+		int height = std::min<int>(ms * GRAPH_SCALE, GRAPH_HEIGHT);
+		if (!height) {
+			continue;
+		}
+		const Color &color = ms <= target ? green : ms <= 2 * target ? yellow : red;
+		video->DrawRect(Region((FRAME_HISTORY - 1 - i) * 3, bottom - height, 2, height), color);
+	}
+	int line = bottom - std::min<int>(target * GRAPH_SCALE, GRAPH_HEIGHT);
+	video->DrawLine(0, line, rgn.w - 1, line, ColorWhite);
+}
+
+}
@@ -0,0 +1,115 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "GameScript/ScriptProfiler.h"
+
+#include <cstddef>
+
+namespace GemRB {
+
+class Font;
+class FrameTimer;
+class Palette;
+
+/* the parts of a frame the overlay tells apart */
+enum FrameSection {
+	FRAME_INPUT, // the driver's event polling and HandleEvents
+	FRAME_GAME, // GameLoop: scripts, effects, movement and fog
+	FRAME_AREA, // Map::DrawMap
+	FRAME_GUI, // DrawWindows, without the area
+	FRAME_SWAP, // the driver's SwapBuffers, without the input
+	FRAME_SECTIONS
+};
+
+enum FrameCounter {
+	FRAME_DRAWS, // draw calls of the GL driver, screen updates of the SDL2 one
+	FRAME_BLITS,
+	FRAME_PATHS, // path searches, in place or handed to the path service
+	FRAME_SCRIPTS, // script runs
+	FRAME_COUNTERS
+};
+
+/* The frame time overlay: the percentiles and a graph of the recent frame
+ * times, the time each section took and the counters, averaged over the
+ * same frames. Nothing is recorded while it is hidden.
+ */
+class GEM_EXPORT FrameStats {
+public:
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled() { return enabled; }
+	static void Add(FrameSection section, unsigned __int64 time);
+	static void Count(FrameCounter counter)
+	{
+		if (enabled) counts[counter]++;
+	}
+	/** closes the frame, called once per main loop after the swap */
+	static void EndFrame();
+	/** draws the overlay into the top left corner */
+	static void Draw(Font *font, Palette *palette);
+private:
+	friend class FrameTimer;
+
+	static bool enabled;
+	static unsigned int counts[FRAME_COUNTERS];
+	// the innermost running timer, its time is taken out of the outer one
+	static FrameTimer *current;
+};
+
+/* One section, timed from its creation to its destruction
+ * the sections nested into it are not counted twice.
+ */
+class FrameTimer {
+public:
+	FrameTimer(FrameSection section)
+		: section(section), parent(NULL), nested(0), start(0)
+	{
+		if (FrameStats::IsEnabled()) {
+			parent = FrameStats::current;
+			FrameStats::current = this;
+			start = ScriptProfiler::Now();
+		}
+	}
+	~FrameTimer()
+	{
+		if (!start) {
+			return;
+		}
+		unsigned __int64 elapsed = ScriptProfiler::Now() - start;
+		FrameStats::current = parent;
+		FrameStats::Add(section, elapsed > nested ? elapsed - nested : 0);
+		if (parent) {
+			parent->nested += elapsed;
+		}
+	}
+private:
+	FrameSection section;
+	FrameTimer *parent;
+	unsigned __int64 nested;
+	unsigned __int64 start;
+};
+
+}
+
+#endif
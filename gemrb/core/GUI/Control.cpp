@@ -109,9 +109,18 @@ void Control::Draw(unsigned short x, unsigned short y)
 	video->SetScreenClip(&drawFrame);
 	DrawInternal(drawFrame);
 	video->SetScreenClip(&clip);
+	video->MarkDirty(drawFrame);
 	Changed = false; // set *after* calling DrawInternal
 }
 
+void Control::MarkDirty()
+{
+	Changed = true;
+	if (Owner) {
+		Owner->DropCache();
+	}
+}
+
 void Control::SetText(const String* string)
 {
 	SetText((string) ? *string : L"");
@@ -127,7 +136,7 @@ int Control::SetTooltip(const char* string)
 		Tooltip = StringFromCString(string);
 		TrimString(*Tooltip); // for proper vertical alaignment
 	}
-	Changed = true;
+	MarkDirty();
 	return 0;
 }
 
@@ -227,7 +236,7 @@ bool Control::OnSpecialKeyPress(unsigned char Key)
 void Control::SetFocus(bool focus)
 {
 	hasFocus = focus;
-	Changed = true;
+	MarkDirty();
 }
 
 bool Control::isFocused()
@@ -263,7 +272,7 @@ int Control::SetFlags(int arg_flags, int opcode)
 			return -1;
 	}
 	Flags = newFlags;
-	Changed = true;
+	MarkDirty();
 	Owner->Invalidate();
 	return 0;
 }
@@ -284,7 +293,7 @@ int Control::SetScrollBar(Control* ptr)
 		return -1;
 	}
 	sb = ptr;
-	Changed = true;
+	MarkDirty();
 	return (bool)sb;
 }
 
@@ -79,7 +79,8 @@ public:
 	void SetControlFrame(const Region&);
 	/** Draws the Control on the Output Display */
 	void Draw(unsigned short x, unsigned short y);
-	void MarkDirty() { Changed = true; }
+	/** The control looks different now, also drops its window's cached image */
+	void MarkDirty();
 	virtual bool NeedsDraw() const { return Changed || animation; }
 	virtual bool IsOpaque() const { return true; }
 	/** Sets the Text of the current control */
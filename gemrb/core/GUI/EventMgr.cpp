@@ -27,12 +27,22 @@
 
 #include "Game.h"
 #include "Interface.h"
+#include "InputRecord.h"
 #include "KeyMap.h"
 #include "Video.h"
 #include "GUI/Window.h"
 
 namespace GemRB {
 
+// the game view follows the input, whatever the player did may show up in it
+static void MarkGameDirty()
+{
+	GameControl *gc = core->GetGameControl();
+	if (gc) {
+		gc->MarkDirty();
+	}
+}
+
 EventMgr::EventMgr(void)
 {
 	// Function bar window (for function keys)
@@ -169,6 +179,15 @@ void EventMgr::DelWindow(Window *win)
 /** BroadCast Mouse Move Event */
 void EventMgr::MouseMove(unsigned short x, unsigned short y)
 {
+	if (!InputRecord::Accept(INPUT_MOUSEMOVE, x, y)) {
+		return;
+	}
+	DispatchMouseMove(x, y);
+}
+
+void EventMgr::DispatchMouseMove(unsigned short x, unsigned short y)
+{
+	MarkGameDirty();
 	if (windows.size() == 0) {
 		return;
 	}
@@ -258,12 +277,16 @@ bool EventMgr::ClickMatch(unsigned short x, unsigned short y, unsigned long this
 void EventMgr::MouseDown(unsigned short x, unsigned short y, unsigned short Button,
 	unsigned short Mod)
 {
+	if (!InputRecord::Accept(INPUT_MOUSEDOWN, x, y, Button, Mod)) {
+		return;
+	}
+	MarkGameDirty();
 	std::vector< int>::iterator t;
 	std::vector< Window*>::iterator m;
 	Control *ctrl;
 	unsigned long thisTime;
 
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 	if (ClickMatch(x, y, thisTime)) {
 		Button |= GEM_MB_DOUBLECLICK;
 		dc_x = 0;
@@ -327,6 +350,10 @@ void EventMgr::MouseDown(unsigned short x, unsigned short y, unsigned short Butt
 void EventMgr::MouseUp(unsigned short x, unsigned short y, unsigned short Button,
 	unsigned short Mod)
 {
+	if (!InputRecord::Accept(INPUT_MOUSEUP, x, y, Button, Mod)) {
+		return;
+	}
+	MarkGameDirty();
 	if ((Button & GEM_MB_ONGOING_ACTION) == GEM_MB_ACTION) {
 		focusLock = NULL;
 	}
@@ -341,6 +368,10 @@ void EventMgr::MouseUp(unsigned short x, unsigned short y, unsigned short Button
 /** BroadCast Mouse ScrollWheel Event */
 void EventMgr::MouseWheelScroll( short x, short y)//these are signed!
 {
+	if (!InputRecord::Accept(INPUT_MOUSEWHEEL, x, y)) {
+		return;
+	}
+	MarkGameDirty();
 	Control *ctrl = GetMouseFocusedControl();
 	if (ctrl) {
 		ctrl->OnMouseWheelScroll( x, y);
@@ -359,6 +390,10 @@ void EventMgr::MouseIdle(unsigned long /*time*/)
 /** BroadCast Key Press Event */
 void EventMgr::KeyPress(unsigned char Key, unsigned short Mod)
 {
+	if (!InputRecord::Accept(INPUT_KEYPRESS, Key, Mod)) {
+		return;
+	}
+	MarkGameDirty();
 	if (last_win_focused == NULL) return;
 	Control *ctrl = last_win_focused->GetFocus();
 	if (!ctrl || !ctrl->OnKeyPress( Key, Mod )) {
@@ -379,6 +414,10 @@ void EventMgr::KeyPress(unsigned char Key, unsigned short Mod)
 /** BroadCast Key Release Event */
 void EventMgr::KeyRelease(unsigned char Key, unsigned short Mod)
 {
+	if (!InputRecord::Accept(INPUT_KEYRELEASE, Key, Mod)) {
+		return;
+	}
+	MarkGameDirty();
 	if (last_win_focused == NULL) return;
 	if (Key == GEM_GRAB) {
 		core->GetVideoDriver()->ToggleGrabInput();
@@ -392,6 +431,10 @@ void EventMgr::KeyRelease(unsigned char Key, unsigned short Mod)
 /** Special Key Press Event */
 void EventMgr::OnSpecialKeyPress(unsigned char Key)
 {
+	if (!InputRecord::Accept(INPUT_SPECIALKEY, Key)) {
+		return;
+	}
+	MarkGameDirty();
 	if (!last_win_focused) {
 		return;
 	}
@@ -465,7 +508,8 @@ void EventMgr::FakeMouseMove()
 {
 	int x, y;
 	core->GetVideoDriver()->GetMousePos(x, y);
-	MouseMove((unsigned short) x, (unsigned short) y);
+	// not an input event, so it is neither recorded nor replayed
+	DispatchMouseMove((unsigned short) x, (unsigned short) y);
 }
 
 void EventMgr::SetFocused(Window *win, Control *ctrl)
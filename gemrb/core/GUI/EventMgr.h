@@ -147,6 +147,7 @@ public:
 	/** Mask of which Mouse Buttons are pressed */
 	unsigned char MButtons;
 private:
+	void DispatchMouseMove(unsigned short x, unsigned short y);
 	void SetDefaultFocus(Window *win);
 	void SetOnTop(int Index);
 	bool ClickMatch(unsigned short x, unsigned short y, unsigned long thisTime);
@@ -102,6 +102,10 @@ GameControl::GameControl(const Region& frame)
 	numScrollCursor = 0;
 	DebugFlags = 0;
 	AIUpdateCounter = 1;
+	drawnTicks = 0;
+	drawnAnimated = false;
+	drawnInterpolated = false;
+	drawnTickOffset = 0;
 
 	ieDword tmp=0;
 	core->GetDictionary()->Lookup("Always Run", tmp);
@@ -339,6 +343,7 @@ void GameControl::DrawTargetReticle(Point p, int size, bool animate, bool flash,
 
 	unsigned short step = 0;
 	if (animate) {
+		drawnAnimated = true;
 		// generates "step" from sequence 3 2 1 0 1 2 3 4
 		// updated each 1/15 sec
 		++step = tp_steps [(GetTickCount() >> 6) & 7];
@@ -377,6 +382,24 @@ void GameControl::DrawTargetReticle(Point p, int size, bool animate, bool flash,
 }
 
 /** Draws the Control on the Output Display */
+bool GameControl::NeedsDraw() const
+{
+	if (Control::NeedsDraw() || moveX || moveY || drawnAnimated) {
+		return true;
+	}
+	const Game* game = core->GetGame();
+	if (!game) {
+		return true;
+	}
+	if (game->Ticks != drawnTicks || core->timer->ViewportIsMoving()) {
+		return true;
+	}
+	if (drawnInterpolated && core->GetTickOffset() != drawnTickOffset) {
+		return true;
+	}
+	return core->GetVideoDriver()->GetViewport().Origin() != drawnViewport;
+}
+
 void GameControl::DrawInternal(Region& screen)
 {
 	bool update_scripts = !(DialogueFlags & DF_FREEZE_SCRIPTS);
@@ -405,6 +428,10 @@ void GameControl::DrawInternal(Region& screen)
 		viewport.y += moveY;
 		MoveViewportTo( viewport.x, viewport.y, false );
 	}
+	drawnTicks = game->Ticks;
+	drawnViewport = video->GetViewport().Origin();
+	drawnAnimated = false;
+	drawnTickOffset = core->GetTickOffset();
 	video->DrawRect( screen, ColorBlack, true );
 
 	// setup outlines
@@ -498,8 +525,10 @@ void GameControl::DrawInternal(Region& screen)
 	}
 
 	//drawmap should be here so it updates fog of war
-	area->DrawMap( screen );
-	game->DrawWeather(screen, update_scripts);
+	drawnInterpolated = area->DrawMap( screen );
+	if (game->DrawWeather(screen, update_scripts)) {
+		drawnAnimated = true;
+	}
 
 	if (trackerID) {
 		Actor *actor = area->GetActorByGlobalID(trackerID);
@@ -777,17 +806,7 @@ bool GameControl::OnKeyRelease(unsigned char Key, unsigned short Mod)
 				break;
 			case 'b': //draw a path to the target (pathfinder debug)
 				//You need to select an origin with ctrl-o first
-				if (drawPath) {
-					PathNode* nextNode = drawPath->Next;
-					PathNode* thisNode = drawPath;
-					while (true) {
-						delete( thisNode );
-						thisNode = nextNode;
-						if (!thisNode)
-							break;
-						nextNode = thisNode->Next;
-					}
-				}
+				PathNode::FreePath(drawPath);
 				drawPath = core->GetGame()->GetCurrentArea()->FindPath( pfs, p, lastActor?lastActor->size:1 );
 				break;
 			case 'c': //force cast a hardcoded spell
@@ -1268,7 +1287,7 @@ void GameControl::OnMouseOver(unsigned short x, unsigned short y)
 		return;
 	}
 
-	overInfoPoint = area->TMap->GetInfoPoint( p, true );
+	overInfoPoint = area->TMap->PickInfoPoint( p, true );
 	if (overInfoPoint) {
 		//nextCursor = overInfoPoint->Cursor;
 		nextCursor = GetCursorOverInfoPoint(overInfoPoint);
@@ -1291,8 +1310,8 @@ void GameControl::OnMouseOver(unsigned short x, unsigned short y)
 		lastActor->SetOver( false );
 	}
 
-	overDoor = area->TMap->GetDoor( p );
-	overContainer = area->TMap->GetContainer( p );
+	overDoor = area->TMap->PickDoor( p );
+	overContainer = area->TMap->PickContainer( p );
 
 	if (!DrawSelectionRect) {
 		if (overDoor) {
@@ -1312,7 +1331,7 @@ void GameControl::OnMouseOver(unsigned short x, unsigned short y)
 
 		Actor *prevActor = lastActor;
 		// let us target party members even if they are invisible
-		lastActor = area->GetActor(p, GA_NO_DEAD|GA_NO_UNSCHEDULED);
+		lastActor = area->PickActor(p, GA_NO_DEAD|GA_NO_UNSCHEDULED);
 		if (lastActor && lastActor->Modified[IE_EA]>=EA_CONTROLLED) {
 			if (!lastActor->ValidTarget(target_types) || !area->IsVisible(p, false)) {
 				lastActor = NULL;
@@ -2535,8 +2554,8 @@ Sprite2D* GameControl::GetScreenshot(const Region& rgn, bool show_gui)
 	return screenshot;
 }
 
-//copies a downscaled screenshot into a sprite for save game preview
-Sprite2D* GameControl::GetPreview()
+// the region of the screenshot for the save game preview
+static Region GetPreviewRegion()
 {
 	// We get preview by first taking a screenshot of quintuple size of the preview control size (a few pixels bigger only in pst),
 	// centered in the display. This is to get a decent picture for
@@ -2563,7 +2582,29 @@ Sprite2D* GameControl::GetPreview()
 	if (!x)
 		y = 0;
 
-	Sprite2D *screenshot = GetScreenshot( Region(x, y, w, h) );
+	return Region(x, y, w, h);
+}
+
+void GameControl::RequestPreview()
+{
+	int hf = SetGUIHidden(true);
+	Draw (0, 0);
+	core->GetVideoDriver()->StartScreenshot(GetPreviewRegion());
+	if (hf) {
+		SetGUIHidden(false);
+	}
+	core->DrawWindows ();
+}
+
+//copies a downscaled screenshot into a sprite for save game preview
+Sprite2D* GameControl::GetPreview()
+{
+	Video* video = core->GetVideoDriver();
+	Sprite2D *screenshot = video->FinishScreenshot();
+	if (!screenshot) {
+		RequestPreview();
+		screenshot = video->FinishScreenshot();
+	}
 
 	Sprite2D* preview = video->SpriteScaleDown ( screenshot, 5 );
 	Sprite2D::FreeSprite( screenshot );
@@ -98,8 +98,9 @@ protected:
 	/** Draws the Control on the Output Display */
 	void DrawInternal(Region& drawFrame);
 public:
-	// GameControl always needs to redraw
-	bool NeedsDraw() const { return true; };
+	/** The world only changes with the game clock, the viewport and the input,
+	 * so a paused game with an idle player isn't redrawn */
+	bool NeedsDraw() const;
 	/** Draws the target reticle for Actor movement. */
 	void DrawTargetReticle(Point p, int size, bool animate, bool flash=false, bool actorSelected=false);
 	/** Sets multiple quicksaves flag*/
@@ -138,6 +139,14 @@ private:
 	Point pfs;
 	PathNode* drawPath;
 	unsigned long AIUpdateCounter;
+	// the game clock and the viewport at the last redraw
+	ieDword drawnTicks;
+	Point drawnViewport;
+	// the weather or a reticle moved even without the clock (like while paused)
+	bool drawnAnimated;
+	// an actor was drawn between the ticks, at this offset
+	bool drawnInterpolated;
+	unsigned long drawnTickOffset;
 	unsigned int ScreenFlags;
 	unsigned int DialogueFlags;
 	String* DisplayText;
@@ -241,6 +250,9 @@ public:
 	void ChangeMap(Actor *pc, bool forced);
 	/** Returns game screenshot, with or without GUI controls */
 	Sprite2D* GetScreenshot(const Region& rgn, bool show_gui = false );
+	/** Starts the screenshot for GetPreview, so the video driver can read
+	 * it back while the rest of the game is saved */
+	void RequestPreview();
 	/** Returns current area preview for saving a game */
 	Sprite2D* GetPreview();
 	/** Returns PC portrait for a currently running game */
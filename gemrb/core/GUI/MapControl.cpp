@@ -30,6 +30,8 @@
 #include "GUI/Window.h"
 #include "Scriptable/Actor.h"
 
+#include <cstring>
+
 namespace GemRB {
 
 #define MAP_NO_NOTES   0
@@ -120,12 +122,24 @@ MapControl::~MapControl(void)
 	}
 }
 
-// Draw fog on the small bitmap
-void MapControl::DrawFog(const Region& rgn)
+bool MapControl::FogChanged() const
 {
-	ieWord XWin = rgn.x;
-	ieWord YWin = rgn.y;
-	Video *video = core->GetVideoDriver();
+	if (!MyMap->ExploredBitmap) {
+		return !fogSeen.empty();
+	}
+	size_t size = MyMap->GetExploredMapSize();
+	return fogSeen.size() != size || memcmp(&fogSeen[0], MyMap->ExploredBitmap, size);
+}
+
+// Collect the unexplored cells of the small bitmap into runs
+void MapControl::UpdateFog()
+{
+	fogRuns.clear();
+	if (!MyMap->ExploredBitmap) {
+		fogSeen.clear();
+		return;
+	}
+	fogSeen.assign(MyMap->ExploredBitmap, MyMap->ExploredBitmap + MyMap->GetExploredMapSize());
 
 	// FIXME: this is ugly, the knowledge of Map and ExploredMask
 	//   sizes should be in Map.cpp
@@ -133,17 +147,71 @@ void MapControl::DrawFog(const Region& rgn)
 	int h = MyMap->GetHeight() / 2;
 
 	for (int y = 0; y < h; y++) {
-		for (int x = 0; x < w; x++) {
+		int start = -1;
+		for (int x = 0; x <= w; x++) {
 			Point p( (short) (MAP_MULT * x), (short) (MAP_MULT * y) );
-			bool visible = MyMap->IsVisible( p, true );
-			if (! visible) {
-				Region rgn = Region ( MAP_TO_SCREENX(MAP_DIV * x), MAP_TO_SCREENY(MAP_DIV * y), MAP_DIV, MAP_DIV );
-				video->DrawRect( rgn, colors[black] );
+			bool visible = x == w || MyMap->IsVisible( p, true );
+			if (!visible && start == -1) {
+				start = x;
+			} else if (visible && start != -1) {
+				fogRuns.push_back(Region(MAP_DIV * start, MAP_DIV * y, MAP_DIV * (x - start), MAP_DIV));
+				start = -1;
 			}
 		}
 	}
 }
 
+// Draw fog on the small bitmap
+void MapControl::DrawFog(const Region& rgn)
+{
+	ieWord XWin = rgn.x;
+	ieWord YWin = rgn.y;
+	Video *video = core->GetVideoDriver();
+
+	if (FogChanged()) {
+		UpdateFog();
+	}
+	for (size_t i = 0; i < fogRuns.size(); i++) {
+		const Region& run = fogRuns[i];
+		Region rgn = Region( MAP_TO_SCREENX(run.x), MAP_TO_SCREENY(run.y), run.w, run.h );
+		video->DrawRect( rgn, colors[black] );
+	}
+}
+
+// Everything the drawing depends on that changes without MarkDirty
+void MapControl::GetDrawState(std::vector<int>& state) const
+{
+	state.clear();
+	Region vp = core->GetVideoDriver()->GetViewport();
+	state.push_back(vp.x);
+	state.push_back(vp.y);
+	state.push_back(core->FogOfWar & FOG_DRAWFOG);
+	state.push_back(MyMap->GetMapNoteCount());
+	Game *game = core->GetGame();
+	int i = game->GetPartySize(true);
+	while (i--) {
+		Actor* actor = game->GetPC( i, true );
+		if (MyMap->HasActor(actor) ) {
+			state.push_back(actor->Pos.x);
+			state.push_back(actor->Pos.y);
+			state.push_back(actor->Selected);
+		}
+	}
+}
+
+// the small map is only drawn again when something on it moved or got explored
+bool MapControl::NeedsDraw() const
+{
+	if (Control::NeedsDraw() || !MyMap) {
+		return true;
+	}
+	GetDrawState(stateScratch);
+	if (stateScratch != drawnState) {
+		return true;
+	}
+	return (core->FogOfWar & FOG_DRAWFOG) && FogChanged();
+}
+
 // To be called after changes in control's or screen geometry
 void MapControl::Realize()
 {
@@ -183,6 +251,11 @@ void MapControl::DrawInternal(Region& rgn)
 	ieWord YWin = rgn.y;
 
 	Realize();
+	if (MyMap) {
+		GetDrawState(drawnState);
+	}
+	// a cached image of the window would have the old map
+	Owner->DropCache();
 
 	// we're going to paint over labels/etc, so they need to repaint!
 	bool seen_this = false;
@@ -31,6 +31,8 @@
 #include "exports.h"
 #include "Interface.h"
 
+#include <vector>
+
 namespace GemRB {
 
 // !!! Keep these synchronized with GUIDefines.py !!!
@@ -50,6 +52,17 @@ protected:
 	/** Draws the Control on the Output Display */
 	void DrawInternal(Region& drawFrame);
 	void DrawFog(const Region& rgn);
+private:
+	// the explored bitmap the fog runs were made from
+	std::vector<ieByte> fogSeen;
+	// the unexplored cells merged into runs along the rows, in small map pixels
+	std::vector<Region> fogRuns;
+	// what the last drawing showed: viewport, fog switch, notes and party positions
+	std::vector<int> drawnState;
+	mutable std::vector<int> stateScratch;
+	bool FogChanged() const;
+	void UpdateFog();
+	void GetDrawState(std::vector<int>& state) const;
 public:
 	int ScrollX, ScrollY;
 	int NotePosX, NotePosY;
@@ -76,7 +89,7 @@ public:
 	MapControl(const Region& frame);
 	~MapControl(void);
 
-	bool NeedsDraw() const {return true;}
+	bool NeedsDraw() const;
 	/** Refreshes the control after its associated variable has changed */
 	void UpdateState(unsigned int Sum);
 	/** Compute parameters after changes in control's or screen geometry */
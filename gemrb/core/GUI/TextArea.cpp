@@ -255,13 +255,14 @@ void TextArea::SetPalette(const Color* color, PALETTE_TYPE idx)
 
 void TextArea::AppendText(const String& text)
 {
-	if (Flags&IE_GUI_TEXTAREA_HISTORY) {
-		int heightLimit = (ftext->LineHeight * 100); // 100 lines of content
+	if (Flags&IE_GUI_TEXTAREA_HISTORY && core->MessageLogLines > 0) {
+		int heightLimit = (ftext->LineHeight * core->MessageLogLines);
 		// start trimming content from the top until we are under the limit.
+		// trim a quarter more than needed, so the rest is laid out again only every so many lines
 		Size frame = textContainer->ContentFrame();
 		int currHeight = frame.h;
 		if (currHeight > heightLimit) {
-			Region exclusion(Point(), Size(frame.w, currHeight - heightLimit));
+			Region exclusion(Point(), Size(frame.w, currHeight - heightLimit + heightLimit / 4));
 			textContainer->DeleteContentsInRect(exclusion);
 		}
 	}
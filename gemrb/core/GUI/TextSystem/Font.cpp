@@ -86,6 +86,7 @@ bool Font::GlyphAtlasPage::AddGlyph(ieWord chr, const Glyph& g)
 		// must grow to accommodate this glyph
 		pageData = (ieByte*)realloc(pageData, SheetRegion.w * glyphH);
 		assert(pageData);
+		MemoryStats::Add(MEM_FONT_PAGES, SheetRegion.w * (glyphH - SheetRegion.h), 0);
 		SheetRegion.h = glyphH;
 	}
 
@@ -128,12 +129,15 @@ void Font::GlyphAtlasPage::Draw(ieWord chr, const Region& dest, Palette* pal)
 			// memcpy(pixels, GlyphPageData, size);
 		}
 		Sheet = core->GetVideoDriver()->CreateSprite8(SheetRegion.w, SheetRegion.h, pixels, pal, true, 0);
+		runPalette = pal;
+	}
+	// the palette stays on the sheet, so the glyphs of a string share a single
+	// binding instead of swapping it in and out for each of them
+	if (runPalette != pal) {
+		Sheet->SetPalette(pal);
+		runPalette = pal;
 	}
-	Palette* oldPal = Sheet->GetPalette();
-	Sheet->SetPalette(pal);
 	SpriteSheet<ieWord>::Draw(chr, dest);
-	Sheet->SetPalette(oldPal);
-	oldPal->release();
 }
 
 #if DEBUG_FONT
@@ -577,6 +581,9 @@ size_t Font::Print(Region rgn, const String& string,
 	}
 
 	size_t ret = RenderText(string, rgn, pal, alignment, &p);
+	for (size_t i = 0; i < Atlas.size(); i++) {
+		Atlas[i]->EndRun();
+	}
 	if (point) {
 		*point = p;
 	}
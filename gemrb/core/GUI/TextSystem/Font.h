@@ -35,6 +35,7 @@
 #include "globals.h"
 #include "exports.h"
 
+#include "MemoryStats.h"
 #include "Sprite2D.h"
 
 #include <deque>
@@ -103,18 +104,22 @@ private:
 			ieByte* pageData; // current raw page being built
 			int pageXPos; // current position on building page
 			Font* font;
+			Palette* runPalette; // set on the sheet for the glyphs of the current Print
 		public:
 			GlyphAtlasPage(Size pageSize, Font* font)
 			: SpriteSheet<ieWord>(), font(font)
 			{
 				pageXPos = 0;
+				runPalette = NULL;
 				SheetRegion.w = pageSize.w;
 				SheetRegion.h = pageSize.h;
 
 				pageData = (ieByte*)calloc(pageSize.h, pageSize.w);
+				MemoryStats::Add(MEM_FONT_PAGES, pageSize.w * pageSize.h);
 			}
 
 			~GlyphAtlasPage() {
+				MemoryStats::Remove(MEM_FONT_PAGES, SheetRegion.w * SheetRegion.h);
 				if (Sheet == NULL) {
 					free(pageData);
 				} else {
@@ -128,6 +133,8 @@ private:
 		// we need a non-const version of Draw here that will call the base const version
 		using SpriteSheet<ieWord>::Draw;
 		void Draw(ieWord chr, const Region& dest, Palette* pal = NULL);
+		// the next Draw sets the palette again, it may have been changed in place
+		void EndRun() { runPalette = NULL; }
 #if DEBUG_FONT
 		void DumpToScreen(const Region&);
 #endif
@@ -22,7 +22,21 @@
 
 namespace GemRB {
 
+// how many parsed strings are kept
+#define MARKUP_CACHE_SIZE 128
+
 GemMarkupParser::PaletteCache GemMarkupParser::PalCache;
+GemMarkupParser::MarkupCache GemMarkupParser::ParseCache;
+unsigned long GemMarkupParser::ParseClock = 0;
+
+bool GemMarkupParser::MarkupKey::operator<(const MarkupKey& other) const
+{
+	if (font != other.font) return font < other.font;
+	if (swapFont != other.swapFont) return swapFont < other.swapFont;
+	if (palette != other.palette) return palette < other.palette;
+	if (swapPalette != other.swapPalette) return swapPalette < other.swapPalette;
+	return text < other.text;
+}
 
 Palette* GemMarkupParser::GetSharedPalette(const String& colorString)
 {
@@ -68,13 +82,87 @@ void GemMarkupParser::Reset()
 	}
 }
 
+GemMarkupParser::MarkupKey GemMarkupParser::KeyFor(const String& text) const
+{
+	const TextAttributes& attributes = context.top();
+	MarkupKey key;
+	key.text = text;
+	key.font = attributes.TextFont;
+	key.swapFont = attributes.SwapFont;
+	key.palette = attributes.GivenPalette();
+	key.swapPalette = attributes.GivenSwapPalette();
+	return key;
+}
+
+void GemMarkupParser::CacheSpans(const MarkupKey& key, const MarkupSpans& spans)
+{
+	if (ParseCache.size() >= MARKUP_CACHE_SIZE) {
+		// drop the one unused for the longest
+		MarkupCache::iterator oldest = ParseCache.begin();
+		MarkupCache::iterator it = ParseCache.begin();
+		for (; it != ParseCache.end(); ++it) {
+			if (it->second.lastUse < oldest->second.lastUse) {
+				oldest = it;
+			}
+		}
+		ParseCache.erase(oldest);
+	}
+	MarkupEntry& entry = ParseCache[key];
+	entry.spans = spans;
+	entry.palette = key.palette;
+	entry.swapPalette = key.swapPalette;
+	entry.lastUse = ++ParseClock;
+}
+
+void GemMarkupParser::AppendSpan(TextContainer& container, MarkupSpans* spans, const String& text,
+								 const Font* font, Palette* pal, const Size* frame)
+{
+	if (!font) {
+		container.AppendText(text);
+	} else {
+		container.AppendContent(new TextSpan(text, font, pal, frame));
+	}
+	if (spans) {
+		MarkupSpan span;
+		span.text = text;
+		span.font = font;
+		span.palette = pal;
+		span.framed = frame != NULL;
+		if (frame) {
+			span.frame = *frame;
+		}
+		spans->push_back(span);
+	}
+}
+
 GemMarkupParser::ParseState
 GemMarkupParser::ParseMarkupStringIntoContainer(const String& text, TextContainer& container)
 {
+	// only the strings parsed from and back to the starting attributes are cached,
+	// those continuing an unclosed tag depend on what came before
+	bool cacheable = state == TEXT && context.size() == 1;
+	MarkupKey key;
+	MarkupSpans recorded;
+	MarkupSpans* spans = NULL;
+	if (cacheable) {
+		key = KeyFor(text);
+		MarkupCache::iterator hit = ParseCache.find(key);
+		if (hit != ParseCache.end()) {
+			hit->second.lastUse = ++ParseClock;
+			const MarkupSpans& cached = hit->second.spans;
+			for (size_t i = 0; i < cached.size(); i++) {
+				const MarkupSpan& span = cached[i];
+				AppendSpan(container, NULL, span.text, span.font, span.palette.get(), span.framed ? &span.frame : NULL);
+			}
+			return state;
+		}
+		spans = &recorded;
+	}
+
 	size_t tagPos = text.find_first_of('[');
 	if (tagPos != 0) {
 		// handle any text before the markup
-		container.AppendText(text.substr(0, tagPos));
+		AppendSpan(container, spans, text.substr(0, tagPos));
 	}
 	// parse the text looking for accepted tags ([cap], [color], [p])
 	// [cap] encloses a span of text to be rendered with the finit font
@@ -140,7 +228,7 @@ GemMarkupParser::ParseMarkupStringIntoContainer(const String& text, TextContaine
 						if (token.length() && token != L"\n") {
 							// FIXME: lazy hack.
 							// we ought to ignore all white space between markup unless it contains other text
-							container.AppendContent(new TextSpan(token, attributes.TextFont, attributes.TextPalette(), &frame));
+							AppendSpan(container, spans, token, attributes.TextFont, attributes.TextPalette(), &frame);
 						}
 						token.clear();
 						if (*++it == '/')
@@ -172,7 +260,14 @@ GemMarkupParser::ParseMarkupStringIntoContainer(const String& text, TextContaine
 
 	if (token.length()) {
 		// there was some text at the end without markup
-		container.AppendText(token);
+		AppendSpan(container, spans, token);
+	}
+	if (spans && state == TEXT && context.size() == 1) {
+		// an unclosed [cap] leaves the fonts swapped
+		const TextAttributes& after = context.top();
+		if (after.TextFont == key.font && after.GivenPalette() == key.palette) {
+			CacheSpans(key, recorded);
+		}
 	}
 	return state;
 }
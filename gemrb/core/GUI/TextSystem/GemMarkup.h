@@ -24,6 +24,7 @@
 
 #include <map>
 #include <stack>
+#include <vector>
 
 namespace GemRB {
 
@@ -111,6 +112,10 @@ private:
 			palette = pal;
 		}
 
+		// the palettes as given, for telling the attributes apart
+		Palette* GivenPalette() const { return palette; }
+		Palette* GivenSwapPalette() const { return swapPalette; }
+
 		Palette* TextPalette() const {
 			if (palette) {
 				return palette;
@@ -125,6 +130,43 @@ private:
 
 	typedef std::map<String, Holder<Palette> > PaletteCache;
 	static PaletteCache PalCache;
+
+	// the spans a string came out as, so the descriptions and tooltips
+	// shown again and again are only tokenized once
+	struct MarkupSpan {
+		String text;
+		const Font* font; // NULL for the text in the container font
+		Holder<Palette> palette;
+		Size frame;
+		bool framed;
+	};
+	typedef std::vector<MarkupSpan> MarkupSpans;
+
+	// the same string parsed with other starting attributes comes out different
+	struct MarkupKey {
+		String text;
+		const Font* font;
+		const Font* swapFont;
+		Palette* palette;
+		Palette* swapPalette;
+
+		bool operator<(const MarkupKey& other) const;
+	};
+	struct MarkupEntry {
+		MarkupSpans spans;
+		// keep the palettes of the key from being reused by others
+		Holder<Palette> palette;
+		Holder<Palette> swapPalette;
+		unsigned long lastUse;
+	};
+	typedef std::map<MarkupKey, MarkupEntry> MarkupCache;
+	static MarkupCache ParseCache;
+	static unsigned long ParseClock;
+
+	MarkupKey KeyFor(const String& text) const;
+	void CacheSpans(const MarkupKey& key, const MarkupSpans& spans);
+	static void AppendSpan(TextContainer& container, MarkupSpans* spans, const String& text,
+						   const Font* font = NULL, Palette* pal = NULL, const Size* frame = NULL);
 	std::stack<TextAttributes> context;
 	ParseState state;
 };
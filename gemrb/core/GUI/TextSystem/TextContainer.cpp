@@ -76,6 +76,7 @@ TextSpan::TextSpan(const String& string, const Font* fnt, Palette* pal, const Si
 	palette = pal;
 	if (palette)
 		palette->acquire();
+	drawnFont = NULL;
 }
 
 TextSpan::~TextSpan()
@@ -256,24 +257,46 @@ Regions TextSpan::LayoutForPointInRegion(Point layoutPoint, const Region& rgn) c
 	return layoutRegions;
 }
 
+bool TextSpan::DrawnLayoutMatches(const Font* printFont, const Regions& rgns) const
+{
+	if (printFont != drawnFont || rgns.size() != drawnSizes.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < rgns.size(); i++) {
+		// only the sizes matter, the breaks don't move with the regions
+		if (rgns[i].Dimensions() != drawnSizes[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void TextSpan::DrawContentsInRegions(const Regions& rgns, const Point& offset) const
 {
+	const Font* printFont = font;
+	Palette* printPalette = palette;
+	TextContainer* container = dynamic_cast<TextContainer*>(parent);
+	if (printFont == NULL && container) {
+		printFont = container->TextFont();
+	}
+	if (printPalette == NULL && container) {
+		printPalette = container->TextPalette();
+	}
+	assert(printFont && printPalette);
+
+	bool known = DrawnLayoutMatches(printFont, rgns);
+	if (!known) {
+		drawnFont = printFont;
+		drawnSizes.clear();
+		drawnChars.clear();
+	}
+
+	const Region& sclip = core->GetVideoDriver()->GetScreenClip();
 	size_t charsPrinted = 0;
-	Regions::const_iterator rit = rgns.begin();
-	for (; rit != rgns.end(); ++rit) {
-		Region drawRect = *rit;
+	for (size_t i = 0; i < rgns.size(); i++) {
+		Region drawRect = rgns[i];
 		drawRect.x += offset.x;
 		drawRect.y += offset.y;
-		const Font* printFont = font;
-		Palette* printPalette = palette;
-		TextContainer* container = dynamic_cast<TextContainer*>(parent);
-		if (printFont == NULL && container) {
-			printFont = container->TextFont();
-		}
-		if (printPalette == NULL && container) {
-			printPalette = container->TextPalette();
-		}
-		assert(printFont && printPalette);
 #if (DEBUG_TEXT)
 		// FIXME: this shouldnt happen, but it does (BG2 belt03 unidentified).
 		// for now only assert when DEBUG_TEXT is set
@@ -281,7 +304,19 @@ void TextSpan::DrawContentsInRegions(const Regions& rgns, const Point& offset) c
 		assert(charsPrinted < text.length());
 		core->GetVideoDriver()->DrawRect(drawRect, ColorRed, true);
 #endif
-		charsPrinted += printFont->Print(drawRect, text.substr(charsPrinted), printPalette, IE_FONT_ALIGN_LEFT);
+		if (known) {
+			// print just the characters of this region, if it is on screen at all
+			size_t numChars = drawnChars[i];
+			if (sclip.IntersectsRegion(drawRect)) {
+				printFont->Print(drawRect, text.substr(charsPrinted, numChars), printPalette, IE_FONT_ALIGN_LEFT);
+			}
+			charsPrinted += numChars;
+		} else {
+			size_t numChars = printFont->Print(drawRect, text.substr(charsPrinted), printPalette, IE_FONT_ALIGN_LEFT);
+			drawnSizes.push_back(drawRect.Dimensions());
+			drawnChars.push_back(numChars);
+			charsPrinted += numChars;
+		}
 #if (DEBUG_TEXT)
 		core->GetVideoDriver()->DrawRect(drawRect, ColorWhite, false);
 #endif
@@ -462,21 +497,24 @@ void ContentContainer::LayoutContentsFrom(ContentList::const_iterator it)
 
 	const Content* exContent = NULL;
 	const Region* excluded = NULL;
-	contentBounds = Size();
 
 	if (it != contents.begin()) {
 		// relaying content some place in the middle of the container
+		// the content before it keeps its place, and so do the bounds it took
 		exContent = *--it;
 		it++;
-	}
-	// clear the existing layout, but only for "it" and onward
-	ContentList::const_iterator clearit = it;
-	for (; clearit != contents.end(); ++clearit) {
-		ContentLayout::iterator i = std::find(layout.begin(), layout.end(), *clearit);
-		if (i != layout.end()) {
+		// clear the existing layout, but only for "it" and onward
+		// the layout is in the order of the contents, so that is its tail
+		// appending only has to look at the new content this way, no matter how long the container is
+		const ContentList::const_iterator end = contents.end();
+		while (!layout.empty() && std::find(it, end, layout.back().content) != end) {
 			layoutPoint = Point(); // reset cached layoutPoint
-			layout.erase(i);
+			layout.pop_back();
 		}
+	} else {
+		contentBounds = Size();
+		layoutPoint = Point();
+		layout.clear();
 	}
 
 	while (it != contents.end()) {
@@ -538,10 +576,21 @@ void ContentContainer::DrawContentsInRegions(const Regions& rgns, const Point& o
 	core->GetVideoDriver()->DrawRect(dr, ColorWhite, false);
 #endif
 
+	// only the content near the screen clip is drawn, so long containers cost no more than short ones
+	// the content starts ttb, so once one starts below the clip all the rest do too
+	const Region& sclip = core->GetVideoDriver()->GetScreenClip();
+	const Point drawOffset = offset + parentOffset;
 	for (; it != layout.end(); ++it) {
 		const Layout& l = *it;
 		assert(drawPoint.x <= drawOrigin.x + frame.w);
-		l.content->DrawContentsInRegions(l.regions, offset + parentOffset);
+		if (l.regions.front().y + drawOffset.y >= sclip.y + sclip.h) {
+			break;
+		}
+		const Region& bounds = Region::RegionEnclosingRegions(l.regions);
+		if (bounds.y + bounds.h + drawOffset.y <= sclip.y) {
+			continue;
+		}
+		l.content->DrawContentsInRegions(l.regions, drawOffset);
 	}
 }
 
@@ -69,6 +69,12 @@ private:
 	const Font* font;
 	Palette* palette;
 
+	// where the text broke the last time it was drawn, so repainting only prints the visible regions
+	// the text never changes, so this holds as long as the font and the region sizes stay the same
+	mutable const Font* drawnFont;
+	mutable std::vector<Size> drawnSizes;
+	mutable std::vector<size_t> drawnChars;
+
 public:
 	// make a "block" of text that always occupies the area of "size", or autosizes if size in NULL
 	// TODO: we should probably be able to align the text in the frame
@@ -84,6 +90,7 @@ protected:
 private:
 	inline const Font* LayoutFont() const;
 	inline Region LayoutInFrameAtPoint(const Point&, const Region&) const;
+	bool DrawnLayoutMatches(const Font*, const Regions&) const;
 };
 
 
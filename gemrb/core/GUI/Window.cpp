@@ -39,6 +39,8 @@ Window::Window(unsigned short WindowID, unsigned short XPos,
 	this->Width = Width;
 	this->Height = Height;
 	this->BackGround = NULL;
+	opaqueBackGround = -1;
+	DrawCache = NULL;
 	lastC = NULL;
 	lastFocus = NULL;
 	lastMouseFocus = NULL;
@@ -61,6 +63,7 @@ Window::~Window()
 	Controls.clear();
 	Sprite2D::FreeSprite( BackGround );
 	BackGround = NULL;
+	Sprite2D::FreeSprite( DrawCache );
 }
 /** Add a Control in the Window */
 void Window::AddControl(Control* ctrl)
@@ -69,6 +72,7 @@ void Window::AddControl(Control* ctrl)
 		return;
 	}
 	ctrl->Owner = this;
+	DropCache();
 	for (std::vector<Control*>::iterator m = Controls.begin(); m != Controls.end(); ++m) {
 		if ((*m)->ControlID == ctrl->ControlID) {
 			ControlRemoved(*m);
@@ -88,8 +92,39 @@ void Window::SetBackGround(Sprite2D* img, bool clean)
 		Sprite2D::FreeSprite( this->BackGround );
 	}
 	BackGround = img;
+	opaqueBackGround = -1;
+	DropCache();
 	Invalidate();
 }
+
+void Window::DropCache()
+{
+	Sprite2D::FreeSprite(DrawCache);
+}
+
+/** Only windows fully painted by their own background can be cached, through
+ * holes in it whatever was below at the time would get frozen in */
+bool Window::CanCache()
+{
+	if (!BackGround || (Flags & WF_FLOAT) || !Width || !Height) {
+		return false;
+	}
+	if (!core->GetVideoDriver()->CanCacheRegions()) {
+		return false;
+	}
+	if (opaqueBackGround == -1) {
+		opaqueBackGround = BackGround->Width >= Width && BackGround->Height >= Height;
+		for (unsigned short y = 0; opaqueBackGround && y < Height; y++) {
+			for (unsigned short x = 0; x < Width; x++) {
+				if (BackGround->IsPixelTransparent(x, y)) {
+					opaqueBackGround = 0;
+					break;
+				}
+			}
+		}
+	}
+	return opaqueBackGround;
+}
 /** This function Draws the Window on the Output Screen */
 void Window::DrawWindow()
 {
@@ -110,13 +145,32 @@ void Window::DrawWindow()
 			video->BlitSprite( core->WindowFrames[2], (core->Width - core->WindowFrames[2]->Width) / 2, 0, true );
 		if (core->WindowFrames[3])
 			video->BlitSprite( core->WindowFrames[3], (core->Width - core->WindowFrames[3]->Width) / 2, core->Height - core->WindowFrames[3]->Height, true );
+		video->MarkScreenDirty();
 	}
 
 	video->SetScreenClip( &clip );
+	// floating windows have to be redrawn whenever what they float over was
+	bool overdrawn = (Flags & WF_FLOAT) && video->IsDirty(clip);
 	//Float || Changed
 	bool bgRefreshed = false;
-	if (BackGround && (Flags & (WF_FLOAT|WF_CHANGED) ) ) {
+	bool cached = false;
+	if (DrawCache && (DrawCache->Width != Width || DrawCache->Height != Height)) {
+		DropCache();
+	}
+	if ((Flags & WF_CHANGED) && DrawCache) {
+		// nothing changed since the last full redraw
+		video->BlitSprite(DrawCache, XPos, YPos, true);
+		video->MarkDirty(clip);
+		cached = true;
+	} else if (Flags & WF_CHANGED) {
+		// a control may have dropped the cache after Invalidate skipped marking them
+		for (std::vector<Control*>::iterator m = Controls.begin(); m != Controls.end(); ++m) {
+			(*m)->MarkDirty();
+		}
+	}
+	if (!cached && BackGround && ((Flags & WF_CHANGED) || overdrawn)) {
 		DrawBackground(NULL);
+		video->MarkDirty(clip);
 		bgRefreshed = true;
 	}
 
@@ -130,15 +184,26 @@ void Window::DrawWindow()
 			const Region& fromClip = c->ControlFrame();
 			DrawBackground(&fromClip);
 		}
-		if (Flags & (WF_FLOAT)) {
+		if (overdrawn) {
 			// FIXME: this is a total hack. Required for anything drawing over GameControl (nothing really at all to do with floating)
 			c->MarkDirty();
 		}
 		c->Draw( XPos, YPos );
 	}
+	if ((Flags & WF_CHANGED) && !cached && CanCache()) {
+		// windows with controls that keep drawing (animations, the game) can't be kept
+		bool still = true;
+		for (m = Controls.begin(); still && m != Controls.end(); ++m) {
+			still = !(*m)->NeedsDraw();
+		}
+		if (still) {
+			DrawCache = video->GetScreenshot(clip);
+		}
+	}
 	if ( (Flags&WF_CHANGED) && (Visible == WINDOW_GRAYED) ) {
 		Color black = { 0, 0, 0, 128 };
 		video->DrawRect(clip, black);
+		video->MarkDirty(clip);
 	}
 	video->SetScreenClip( NULL );
 	Flags &= ~WF_CHANGED;
@@ -303,6 +368,7 @@ Control* Window::RemoveControl(unsigned short i)
 
 void Window::ControlRemoved(const Control *ctrl)
 {
+	DropCache();
 	if (ctrl == lastC) {
 		lastC = NULL;
 	}
@@ -358,7 +424,10 @@ void Window::Invalidate()
 	unsigned int i = 0;
 	for (std::vector<Control*>::iterator m = Controls.begin(); m != Controls.end(); ++m, ++i) {
 		Control *ctrl = *m;
-		ctrl->MarkDirty();
+		// the cached image already holds them as they are
+		if (!DrawCache) {
+			ctrl->MarkDirty();
+		}
 		switch (ctrl->ControlType) {
 			case IE_GUI_SCROLLBAR:
 				if ((ScrollControl == -1) || (ctrl->Flags & IE_GUI_SCROLLBAR_DEFAULT))
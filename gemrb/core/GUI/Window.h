@@ -80,6 +80,7 @@ class GEM_EXPORT Window {
 private:
 	void DrawBackground(const Region* rgn) const;
 	void ControlRemoved(const Control *ctrl);
+	bool CanCache();
 
 public: 
 	Window(unsigned short WindowID, unsigned short XPos, unsigned short YPos,
@@ -88,6 +89,8 @@ public:
 	/** Set the Window's BackGround Image. 
 	 * If 'img' is NULL, no background will be set. If the 'clean' parameter is true (default is false) the old background image will be deleted. */
 	void SetBackGround(Sprite2D* img, bool clean = false);
+	/** Forgets the cached image of the window, a control changed */
+	void DropCache();
 	/** Add a Control in the Window */
 	void AddControl(Control* ctrl);
 	/** This function Draws the Window on the Output Screen */
@@ -166,6 +169,10 @@ public: //Public attributes
 private: // Private attributes
 	/** BackGround Image. No BackGround if this variable is NULL. */
 	Sprite2D* BackGround;
+	/** -1 if not checked yet, else whether BackGround covers the window without holes */
+	int opaqueBackGround;
+	/** The window as it was last drawn in full, redrawing it is a single blit while valid */
+	Sprite2D* DrawCache;
 	/** Controls Array */
 	std::vector< Control*> Controls;
 	/** Last Control returned by GetControl */
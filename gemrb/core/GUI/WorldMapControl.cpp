@@ -47,6 +47,7 @@ WorldMapControl::WorldMapControl(const Region& frame, const char *font, int dire
 	Area = NULL;
 	Value = direction;
 	OverrideIconPalette = false;
+	captionsMap = NULL;
 	Game* game = core->GetGame();
 	WorldMap* worldmap = core->GetWorldMap();
 	CopyResRef(currentArea, game->CurrentArea);
@@ -99,6 +100,16 @@ WorldMapControl::~WorldMapControl(void)
 	gamedata->FreePalette( pal_normal );
 	gamedata->FreePalette( pal_selected );
 	gamedata->FreePalette( pal_notvisited );
+	ClearCaptions();
+}
+
+void WorldMapControl::ClearCaptions()
+{
+	for (size_t i = 0; i < captions.size(); i++) {
+		Sprite2D::FreeSprite(captions[i]);
+	}
+	captions.clear();
+	captionsMap = NULL;
 }
 
 /** Draws the Control on the Output Display */
@@ -120,7 +131,10 @@ void WorldMapControl::DrawInternal(Region& rgn)
 		int xOffs = MAP_TO_SCREENX(m->X);
 		int yOffs = MAP_TO_SCREENY(m->Y);
 		Sprite2D* icon = m->GetMapIcon(worldmap->bam, OverrideIconPalette);
-		if( icon ) {
+		if (icon && !rgn.IntersectsRegion(Region(xOffs - icon->XPos, yOffs - icon->YPos, icon->Width, icon->Height))) {
+			// scrolled out of the control
+			Sprite2D::FreeSprite( icon );
+		} else if( icon ) {
 			if (m == Area && m->HighlightSelected()) {
 				Palette *pal = icon->GetPalette();
 				icon->SetPalette(pal_selected);
@@ -143,6 +157,12 @@ void WorldMapControl::DrawInternal(Region& rgn)
 	if (ftext==NULL) {
 		return;
 	}
+	// the labels only need the font once, then they are just recolored blits
+	if (captionsMap != worldmap || captions.size() != ec) {
+		ClearCaptions();
+		captions.resize(ec, NULL);
+		captionsMap = worldmap;
+	}
 	for(i=0;i<ec;i++) {
 		WMPAreaEntry *m = worldmap->GetEntry(i);
 		if (! (m->GetAreaStatus() & WMP_ENTRY_VISIBLE)) continue;
@@ -170,10 +190,18 @@ void WorldMapControl::DrawInternal(Region& rgn)
 			}
 		}
 
-		Size ts = ftext->StringSize(*m->GetCaption());
-		ts.w += 10;
-		ftext->Print( Region( Point(r2.x + (r2.w - ts.w)/2, r2.y + r2.h), ts ),
-					 *m->GetCaption(), text_pal, 0 );
+		if (!captions[i]) {
+			Size ts = ftext->StringSize(*m->GetCaption());
+			ts.w += 10;
+			captions[i] = ftext->RenderTextAsSprite(*m->GetCaption(), ts, 0, pal_normal);
+		}
+		Sprite2D *caption = captions[i];
+		// the label area is 10 wider than the text, centered below the icon
+		Point pos(r2.x + (r2.w - caption->Width - 10)/2, r2.y + r2.h);
+		if (!rgn.IntersectsRegion(Region(pos.x, pos.y, caption->Width, caption->Height))) {
+			continue;
+		}
+		video->BlitSprite( caption, pos.x, pos.y, true, &rgn, text_pal );
 	}
 }
 
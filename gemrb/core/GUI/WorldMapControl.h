@@ -33,11 +33,15 @@
 
 #include "Dialog.h"
 
+#include <vector>
+
 namespace GemRB {
 
 class Font;
 class Palette;
+class Sprite2D;
 class WMPAreaEntry;
+class WorldMap;
 class WorldMapControl;
 
 // !!! Keep these synchronized with GUIDefines.py !!!
@@ -94,6 +98,10 @@ private:
 	Palette *pal_selected;
 	/** Label color of a not yet visited area */
 	Palette *pal_notvisited;
+	/** The rendered labels by entry index, recolored when blitted */
+	std::vector<Sprite2D*> captions;
+	/** The worldmap the labels were rendered for */
+	WorldMap *captionsMap;
 	/** guiscript Event when button pressed */
 	ControlEventHandler WorldMapControlOnPress;
 	/** guiscript Event when mouse is over a reachable area */
@@ -115,6 +123,8 @@ private:
 	bool OnSpecialKeyPress(unsigned char Key);
 	/** DisplayTooltip */
 	void DisplayTooltip();
+	/** Frees the rendered labels */
+	void ClearCaptions();
 };
 
 }
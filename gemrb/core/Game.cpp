@@ -26,6 +26,7 @@
 #include "strrefs.h"
 #include "win32def.h"
 
+#include "AreaWriter.h"
 #include "DisplayMessage.h"
 #include "GameData.h"
 #include "Interface.h"
@@ -34,9 +35,12 @@
 #include "MusicMgr.h"
 #include "Particles.h"
 #include "PluginMgr.h"
+#include "Prefetcher.h"
 #include "ScriptEngine.h"
 #include "TableMgr.h"
+#include "Tracer.h"
 #include "GameScript/GameScript.h"
+#include "GameScript/ScriptScheduler.h"
 #include "GUI/GameControl.h"
 #include "System/DataStream.h"
 #include "System/StringBuffer.h"
@@ -86,6 +90,8 @@ struct Injured {
 Game::Game(void) : Scriptable( ST_GLOBAL )
 {
 	protagonist = PM_YES; //set it to 2 for iwd/iwd2 and 0 for pst
+	// the scripts reach the globals and area variables through their slots
+	locals->UseSlots();
 	partysize = 6;
 	Ticks = 0;
 	GameTime = RealTime = 0;
@@ -175,6 +181,7 @@ Game::Game(void) : Scriptable( ST_GLOBAL )
 	interval = 1000/AI_UPDATE_TIME;
 	hasInfra = false;
 	familiarBlock = false;
+	globalTintPass = false;
 	//FIXME:i'm not sure in this...
 	NoInterrupt();
 	bntchnc = NULL;
@@ -904,6 +911,7 @@ void Game::PlacePersistents(Map *newMap, const char *ResRef)
 /* Loads an area */
 int Game::LoadMap(const char* ResRef, bool loadscreen)
 {
+	TRACE_SCOPE_DETAIL("Game::LoadMap", ResRef);
 	unsigned int i, ret;
 	Map *newMap;
 	PluginHolder<MapMgr> mM(IE_ARE_CLASS_ID);
@@ -925,6 +933,12 @@ int Game::LoadMap(const char* ResRef, bool loadscreen)
 		sE->RunFunction("LoadScreen", "StartLoadScreen");
 		sE->RunFunction("LoadScreen", "SetLoadScreen");
 	}
+	{
+		//the area may still be on its way to the cache since it was swapped out
+		char path[_MAX_PATH];
+		PathJoinExt(path, core->CachePath, ResRef, core->TypeExt(IE_ARE_CLASS_ID));
+		core->GetAreaWriter()->Wait(path);
+	}
 	DataStream* ds = gamedata->GetResource( ResRef, IE_ARE_CLASS_ID );
 	if (!ds) {
 		goto failedload;
@@ -1300,7 +1314,7 @@ void Game::ShareXP(int xp, int flags)
 bool Game::EveryoneStopped() const
 {
 	for (unsigned int i=0; i<PCs.size(); i++) {
-		if (PCs[i]->GetNextStep() ) return false;
+		if (PCs[i]->GetNextStep() || PCs[i]->GetPathRequest()) return false;
 	}
 	return true;
 }
@@ -1552,11 +1566,32 @@ void Game::UpdateScripts()
 	size_t idx;
 
 	PartyAttack = false;
+	// a new round, the world moved on since the triggers were kept
+	ResetTriggerCache();
+	ScriptScheduler::BeginTick();
+
+	// the areas only share the world through variables, moves between them
+	// and the like, so they still run one after the other, but with more of
+	// them active their scripts are prepared by the script workers together
+	if (core->ScriptThreads && Maps.size() > 1) {
+		std::vector<GameScript*> dueScripts;
+		for (idx=0;idx<Maps.size();idx++) {
+			Maps[idx]->GetDueScripts(dueScripts);
+		}
+		PrepareScripts(dueScripts);
+	}
 
 	for (idx=0;idx<Maps.size();idx++) {
 		Maps[idx]->UpdateScripts();
 	}
 
+	Prefetcher *prefetcher = core->GetPrefetcher();
+	if (prefetcher) {
+		prefetcher->Update(GetCurrentArea());
+	}
+	// the animations the actors queued up, made ready before they are drawn
+	gamedata->FinishPreloads();
+
 	if (PartyAttack) {
 		//ChangeSong will set the battlesong only if CombatCounter is nonzero
 		CombatCounter=150;
@@ -2074,10 +2109,18 @@ const Color *Game::GetGlobalTint() const
 	return NULL;
 }
 
+const Color *Game::GetSpriteTint() const
+{
+	if (globalTintPass) {
+		return NULL;
+	}
+	return GetGlobalTint();
+}
+
 // applies the global tint, if any
 void Game::ApplyGlobalTint(Color &tint, ieDword &flags) const
 {
-	const Color *globalTint = GetGlobalTint();
+	const Color *globalTint = GetSpriteTint();
 	if (globalTint) {
 		if (flags & BLIT_TINTED) {
 			Color::MultiplyTint(tint, globalTint);
@@ -2128,18 +2171,18 @@ void Game::ChangeSong(bool always, bool force)
 /* this method redraws weather. If update is false,
 // then the weather particles won't change (game paused)
 */
-void Game::DrawWeather(const Region &screen, bool update)
+bool Game::DrawWeather(const Region &screen, bool update)
 {
 	if (!weather) {
-		return;
+		return false;
 	}
 	if (!area->HasWeather()) {
-		return;
+		return false;
 	}
 
 	weather->Draw( screen );
 	if (!update) {
-		return;
+		return false;
 	}
 
 	if (!(WeatherBits & (WB_RAIN|WB_SNOW)) ) {
@@ -2153,9 +2196,10 @@ void Game::DrawWeather(const Region &screen, bool update)
 	}
 
 	if (WeatherBits&WB_HASWEATHER) {
-		return;
+		return weather->GetPhase() != P_EMPTY;
 	}
 	StartRainOrSnow(true, area->GetWeather());
+	return weather->GetPhase() != P_EMPTY;
 }
 
 /* sets the weather type */
@@ -2247,7 +2291,7 @@ void Game::dump() const
 
 		buffer.appendFormatted("Name: %s Order %d %s\n",actor->ShortName, actor->InParty, actor->Selected?"x":"-");
 	}
-	Log(DEBUG, "Game", buffer);
+	LogDebug("Game", buffer);
 }
 
 Actor *Game::GetActorByGlobalID(ieDword globalID)
@@ -305,6 +305,8 @@ public:
 	bool hasInfra;
 	bool familiarBlock;
 	bool PartyAttack;
+	// the video driver puts the global tint over the area being drawn
+	bool globalTintPass;
 private:
 	/** reads the challenge rating table */
 	void LoadCRTable();
@@ -482,10 +484,14 @@ public:
 	/** gets the colour which should be applied over the game area,
 	may return NULL */
 	const Color *GetGlobalTint() const;
+	/** the global tint the sprites have to apply themselves, NULL while the
+	video driver tints the whole area (see SetGlobalTintPass) */
+	const Color *GetSpriteTint() const;
+	void SetGlobalTintPass(bool pass) { globalTintPass = pass; }
 	/** returns true if party has infravision */
 	bool PartyHasInfravision() const { return hasInfra; }
-	/** draw weather */
-	void DrawWeather(const Region &screen, bool update);
+	/** draw weather, returns true while the particles keep moving */
+	bool DrawWeather(const Region &screen, bool update);
 	/** updates current area music */
 	void ChangeSong(bool always = true, bool force = true);
 	/** sets expansion mode */
@@ -24,8 +24,11 @@
 
 #include "ActorMgr.h"
 #include "AnimationMgr.h"
+#include "AnimationPreloader.h"
 #include "Cache.h"
 #include "CharAnimations.h"
+#include "Dialog.h"
+#include "DialogMgr.h"
 #include "Effect.h"
 #include "EffectMgr.h"
 #include "Factory.h"
@@ -41,9 +44,12 @@
 #include "Spell.h"
 #include "SpellMgr.h"
 #include "StoreMgr.h"
+#include "Tracer.h"
 #include "VEFObject.h"
+#include "GameScript/GameScript.h"
 #include "Scriptable/Actor.h"
 #include "System/FileStream.h"
+#include "System/MemoryStream.h"
 
 #include <cstdio>
 
@@ -64,6 +70,16 @@ static void ReleaseEffect(void *poi)
 	delete ((Effect *) poi);
 }
 
+static void ReleaseDialog(void *poi)
+{
+	delete ((Dialog *) poi);
+}
+
+static void ReleaseCreature(void *poi)
+{
+	delete ((DataStream *) poi);
+}
+
 static void ReleasePalette(void *poi)
 {
 	//we allow nulls, but we shouldn't release them
@@ -72,11 +88,49 @@ static void ReleasePalette(void *poi)
 	((Palette *) poi)->release();
 }
 
+// rough sizes of the cached objects, for the cache budgets
+static unsigned long ItemSize(const Item *item)
+{
+	unsigned long size = sizeof(Item) + item->EquippingFeatureCount * sizeof(Effect);
+	for (int i = 0; i < item->ExtHeaderCount; i++) {
+		size += sizeof(ITMExtHeader) + item->ext_headers[i].FeatureCount * sizeof(Effect);
+	}
+	return size;
+}
+
+static unsigned long SpellSize(const Spell *spell)
+{
+	unsigned long size = sizeof(Spell) + spell->CastingFeatureCount * sizeof(Effect);
+	for (int i = 0; i < spell->ExtHeaderCount; i++) {
+		size += sizeof(SPLExtHeader) + spell->ext_headers[i].FeatureCount * sizeof(Effect);
+	}
+	return size;
+}
+
+static unsigned long DialogSize(const Dialog *dlg)
+{
+	unsigned long size = sizeof(Dialog) + dlg->TopLevelCount * sizeof(ieDword);
+	for (unsigned int i = 0; i < dlg->TopLevelCount; i++) {
+		const DialogState *ds = dlg->initialStates[i];
+		if (!ds) continue;
+		size += sizeof(DialogState) + ds->transitionsCount * sizeof(DialogTransition);
+		for (unsigned int j = 0; j < ds->transitionsCount; j++) {
+			size += ds->transitions[j]->actions.size() * sizeof(Action);
+		}
+	}
+	return size;
+}
+
 GEM_EXPORT GameData* gamedata;
 
+// how many released tables are kept loaded, the most recently released ones
+#define TABLE_RETAIN 48
+
 GameData::GameData()
 {
 	factory = new Factory();
+	retainedTables = 0;
+	tableClock = 0;
 }
 
 GameData::~GameData()
@@ -90,6 +144,8 @@ void GameData::ClearCaches()
 	SpellCache.RemoveAll(ReleaseSpell);
 	EffectCache.RemoveAll(ReleaseEffect);
 	PaletteCache.RemoveAll(ReleasePalette);
+	DialogCache.RemoveAll(ReleaseDialog);
+	CreatureCache.RemoveAll(ReleaseCreature);
 
 	while (!stores.empty()) {
 		Store *store = stores.begin()->second;
@@ -98,11 +154,62 @@ void GameData::ClearCaches()
 	}
 }
 
+void GameData::SetCacheBudgets(unsigned long items, unsigned long spells, unsigned long effects, unsigned long dialogs, unsigned long creatures)
+{
+	CreatureCache.SetBudget(creatures, ReleaseCreature);
+	ItemCache.SetBudget(items, ReleaseItem);
+	SpellCache.SetBudget(spells, ReleaseSpell);
+	EffectCache.SetBudget(effects, ReleaseEffect);
+	DialogCache.SetBudget(dialogs, ReleaseDialog);
+}
+
+void GameData::GetCacheUsage(unsigned long &bytes, int &count) const
+{
+	const Cache *caches[] = { &ItemCache, &SpellCache, &EffectCache, &PaletteCache, &DialogCache, &CreatureCache };
+	bytes = 0;
+	count = 0;
+	for (size_t i = 0; i < sizeof(caches) / sizeof(caches[0]); i++) {
+		bytes += caches[i]->GetSize();
+		count += caches[i]->GetCount();
+	}
+}
+
+unsigned long GameData::TrimCaches()
+{
+	unsigned long bytes = 0;
+	bytes += ItemCache.Purge(ReleaseItem);
+	bytes += SpellCache.Purge(ReleaseSpell);
+	bytes += EffectCache.Purge(ReleaseEffect);
+	bytes += PaletteCache.Purge(ReleasePalette);
+	bytes += DialogCache.Purge(ReleaseDialog);
+	bytes += CreatureCache.Purge(ReleaseCreature);
+	return bytes;
+}
+
 Actor *GameData::GetCreature(const char* ResRef, unsigned int PartySlot)
 {
-	DataStream* ds = GetResource( ResRef, IE_CRE_CLASS_ID );
-	if (!ds)
-		return 0;
+	TRACE_SCOPE_DETAIL("GameData::GetCreature", ResRef);
+	// spawns come in groups, so keep the file in memory and only parse it anew
+	DataStream* cre = (DataStream *) CreatureCache.GetResource(ResRef);
+	if (!cre) {
+		DataStream* str = GetResource( ResRef, IE_CRE_CLASS_ID );
+		if (!str)
+			return 0;
+
+		unsigned long size = str->Size();
+		void* data = malloc(size);
+		if (str->Read(data, size) != (int) size) {
+			Log(ERROR, "GameData", "Couldn't read creature %s!", ResRef);
+			free(data);
+			delete str;
+			return 0;
+		}
+		cre = new MemoryStream(str->originalfile, data, size);
+		delete str;
+		CreatureCache.SetAt(ResRef, (void *) cre, sizeof(MemoryStream) + size);
+	}
+	DataStream* ds = cre->Clone();
+	CreatureCache.DecRef((void *) cre, ResRef, false);
 
 	PluginHolder<ActorMgr> actormgr(IE_CRE_CLASS_ID);
 	if (!actormgr->Open(ds)) {
@@ -114,6 +221,7 @@ Actor *GameData::GetCreature(const char* ResRef, unsigned int PartySlot)
 
 int GameData::LoadCreature(const char* ResRef, unsigned int PartySlot, bool character, int VersionOverride)
 {
+	TRACE_SCOPE_DETAIL("GameData::LoadCreature", ResRef);
 	DataStream *stream;
 
 	Actor* actor;
@@ -159,10 +267,16 @@ int GameData::LoadCreature(const char* ResRef, unsigned int PartySlot, bool char
 /** Loads a 2DA Table, returns -1 on error or the Table Index on success */
 int GameData::LoadTable(const ieResRef ResRef, bool silent)
 {
-	int ind = GetTableIndex( ResRef );
-	if (ind != -1) {
-		tables[ind].refcount++;
-		return ind;
+	std::map<GemRB::ResRef, int>::const_iterator it = tableIndex.find(ResRef);
+	if (it != tableIndex.end()) {
+		Table &table = tables[it->second];
+		if (table.released) {
+			// still loaded from its last use
+			table.released = 0;
+			retainedTables--;
+		}
+		table.refcount++;
+		return it->second;
 	}
 	//print("(%s) Table not found... Loading from file", ResRef);
 	DataStream* str = GetResource( ResRef, IE_2DA_CLASS_ID, silent );
@@ -179,32 +293,33 @@ int GameData::LoadTable(const ieResRef ResRef, bool silent)
 	}
 	Table t;
 	t.refcount = 1;
+	t.released = 0;
 	CopyResRef(t.ResRef, ResRef);
 	t.tm = tm;
-	ind = -1;
+	int ind = -1;
 	for (size_t i = 0; i < tables.size(); i++) {
-		if (tables[i].refcount == 0) {
+		if (tables[i].refcount == 0 && !tables[i].released) {
 			ind = ( int ) i;
 			break;
 		}
 	}
 	if (ind != -1) {
 		tables[ind] = t;
-		return ind;
+	} else {
+		tables.push_back( t );
+		ind = ( int ) tables.size() - 1;
 	}
-	tables.push_back( t );
-	return ( int ) tables.size() - 1;
+	tableIndex[t.ResRef] = ind;
+	return ind;
 }
 /** Gets the index of a loaded table, returns -1 on error */
 int GameData::GetTableIndex(const char* ResRef) const
 {
-	for (size_t i = 0; i < tables.size(); i++) {
-		if (tables[i].refcount == 0)
-			continue;
-		if (strnicmp( tables[i].ResRef, ResRef, 8 ) == 0)
-			return ( int ) i;
+	std::map<GemRB::ResRef, int>::const_iterator it = tableIndex.find(ResRef);
+	if (it == tableIndex.end() || tables[it->second].refcount == 0) {
+		return -1;
 	}
-	return -1;
+	return it->second;
 }
 /** Gets a Loaded Table by its index, returns NULL on error */
 Holder<TableMgr> GameData::GetTable(unsigned int index) const
@@ -223,6 +338,8 @@ bool GameData::DelTable(unsigned int index)
 {
 	if (index==0xffffffff) {
 		tables.clear();
+		tableIndex.clear();
+		retainedTables = 0;
 		return true;
 	}
 	if (index >= tables.size()) {
@@ -232,9 +349,26 @@ bool GameData::DelTable(unsigned int index)
 		return false;
 	}
 	tables[index].refcount--;
-	if (tables[index].refcount == 0)
-		if (tables[index].tm)
-			tables[index].tm.release();
+	if (tables[index].refcount) {
+		return true;
+	}
+	// the short lived AutoTables come back soon, so keep it parsed for a while
+	tables[index].released = ++tableClock;
+	retainedTables++;
+	if (retainedTables <= TABLE_RETAIN) {
+		return true;
+	}
+	// the longest unused has to go
+	size_t oldest = index;
+	for (size_t i = 0; i < tables.size(); i++) {
+		if (tables[i].released && tables[i].released < tables[oldest].released) {
+			oldest = i;
+		}
+	}
+	tables[oldest].released = 0;
+	tables[oldest].tm.release();
+	tableIndex.erase(tables[oldest].ResRef);
+	retainedTables--;
 	return true;
 }
 
@@ -257,7 +391,7 @@ Palette *GameData::GetPalette(const ieResRef resname)
 	palette = new Palette();
 	im->GetPalette(256,palette->col);
 	palette->named=true;
-	PaletteCache.SetAt(resname, (void *) palette);
+	PaletteCache.SetAt(resname, (void *) palette, sizeof(Palette));
 	return palette;
 }
 
@@ -292,6 +426,7 @@ void GameData::FreePalette(Palette *&pal, const ieResRef name)
 
 Item* GameData::GetItem(const ieResRef resname, bool silent)
 {
+	TRACE_SCOPE_DETAIL("GameData::GetItem", resname);
 	Item *item = (Item *) ItemCache.GetResource(resname);
 	if (item) {
 		return item;
@@ -311,10 +446,27 @@ Item* GameData::GetItem(const ieResRef resname, bool silent)
 	strnlwrcpy(item->Name, resname, 8);
 	sm->GetItem( item );
 
-	ItemCache.SetAt(resname, (void *) item);
+	ItemCache.SetAt(resname, (void *) item, ItemSize(item));
 	return item;
 }
 
+//the headers are all most users need, so the feature blocks wait for the first use
+void GameData::LoadItemFeatures(Item *item)
+{
+	DataStream* str = GetResource(item->Name, IE_ITM_CLASS_ID, true);
+	PluginHolder<ItemMgr> sm(IE_ITM_CLASS_ID);
+	if (!sm) {
+		delete ( str );
+	} else if (sm->Open(str) && sm->GetItemFeatures(item)) {
+		return;
+	}
+	Log(ERROR, "GameData", "Couldn't read the features of item %.8s!", item->Name);
+	item->EquippingFeatureCount = 0;
+	for (int i = 0; i < item->ExtHeaderCount; i++) {
+		item->ext_headers[i].FeatureCount = 0;
+	}
+}
+
 //you can supply name for faster access
 void GameData::FreeItem(Item const *itm, const ieResRef name, bool free)
 {
@@ -330,6 +482,7 @@ void GameData::FreeItem(Item const *itm, const ieResRef name, bool free)
 
 Spell* GameData::GetSpell(const ieResRef resname, bool silent)
 {
+	TRACE_SCOPE_DETAIL("GameData::GetSpell", resname);
 	Spell *spell = (Spell *) SpellCache.GetResource(resname);
 	if (spell) {
 		return spell;
@@ -349,10 +502,26 @@ Spell* GameData::GetSpell(const ieResRef resname, bool silent)
 	strnlwrcpy(spell->Name, resname, 8);
 	sm->GetSpell( spell, silent );
 
-	SpellCache.SetAt(resname, (void *) spell);
+	SpellCache.SetAt(resname, (void *) spell, SpellSize(spell));
 	return spell;
 }
 
+void GameData::LoadSpellFeatures(Spell *spell)
+{
+	DataStream* str = GetResource(spell->Name, IE_SPL_CLASS_ID, true);
+	PluginHolder<SpellMgr> sm(IE_SPL_CLASS_ID);
+	if (!sm) {
+		delete ( str );
+	} else if (sm->Open(str) && sm->GetSpellFeatures(spell)) {
+		return;
+	}
+	Log(ERROR, "GameData", "Couldn't read the features of spell %.8s!", spell->Name);
+	spell->CastingFeatureCount = 0;
+	for (int i = 0; i < spell->ExtHeaderCount; i++) {
+		spell->ext_headers[i].FeatureCount = 0;
+	}
+}
+
 void GameData::FreeSpell(Spell *spl, const ieResRef name, bool free)
 {
 	int res;
@@ -366,9 +535,45 @@ void GameData::FreeSpell(Spell *spl, const ieResRef name, bool free)
 	if (free) delete spl;
 }
 
-Effect* GameData::GetEffect(const ieResRef resname)
+Dialog* GameData::GetDialog(const ieResRef resname)
+{
+	Dialog *dlg = (Dialog *) DialogCache.GetResource(resname);
+	if (dlg) {
+		return dlg;
+	}
+	DataStream* str = GetResource(resname, IE_DLG_CLASS_ID);
+	PluginHolder<DialogMgr> dm(IE_DLG_CLASS_ID);
+	if (!dm) {
+		delete ( str );
+		return NULL;
+	}
+	if (!dm->Open(str)) {
+		return NULL;
+	}
+
+	// the importer compiles every state trigger and transition action,
+	// so keep the result around instead of redoing it for each talk
+	dlg = dm->GetDialog();
+	if (!dlg) {
+		return NULL;
+	}
+	strnlwrcpy(dlg->ResRef, resname, 8);
+
+	DialogCache.SetAt(resname, (void *) dlg, DialogSize(dlg));
+	return dlg;
+}
+
+void GameData::FreeDialog(Dialog *dlg, const ieResRef name)
+{
+	int res = DialogCache.DecRef((void *) dlg, name, false);
+	if (res<0) {
+		error("Core", "Corrupted Dialog cache encountered (reference count went below zero), Dialog name is: %.8s\n", name);
+	}
+}
+
+const Effect* GameData::GetEffect(const ieResRef resname)
 {
-	Effect *effect = (Effect *) EffectCache.GetResource(resname);
+	const Effect *effect = (const Effect *) EffectCache.GetResource(resname);
 	if (effect) {
 		return effect;
 	}
@@ -382,16 +587,16 @@ Effect* GameData::GetEffect(const ieResRef resname)
 		return NULL;
 	}
 
-	effect = em->GetEffect(new Effect() );
-	if (effect == NULL) {
+	Effect *loaded = em->GetEffect(new Effect() );
+	if (loaded == NULL) {
 		return NULL;
 	}
 
-	EffectCache.SetAt(resname, (void *) effect);
-	return effect;
+	EffectCache.SetAt(resname, (void *) loaded, sizeof(Effect));
+	return loaded;
 }
 
-void GameData::FreeEffect(Effect *eff, const ieResRef name, bool free)
+void GameData::FreeEffect(const Effect *eff, const ieResRef name, bool free)
 {
 	int res;
 
@@ -464,6 +669,46 @@ Sprite2D* GameData::GetBAMSprite(const ieResRef ResRef, int cycle, int frame, bo
 	return tspr;
 }
 
+AnimationFactory* GameData::MakeAnimationFactory(AnimationMgr* ani, const char* resname, unsigned char mode)
+{
+	AnimationFactory* af = ani->GetAnimationFactory( resname, mode );
+	factory->AddFactoryObject( af );
+	return af;
+}
+
+void GameData::PreloadAnimation(const char* resname)
+{
+	AnimationPreloader *preloader = core->GetAnimationPreloader();
+	if (!preloader || !preloader->IsEnabled() || !resname[0]) {
+		return;
+	}
+	if (factory->IsLoaded(resname, IE_BAM_CLASS_ID) != -1 || preloader->IsQueued(resname)) {
+		return;
+	}
+	DataStream* str = GetResource( resname, IE_BAM_CLASS_ID, true );
+	if (str) {
+		preloader->Preload(resname, str);
+	}
+}
+
+// a few per call, making the sprites is done on the main thread
+#define PRELOADS_PER_UPDATE 4
+
+void GameData::FinishPreloads()
+{
+	AnimationPreloader *preloader = core->GetAnimationPreloader();
+	if (!preloader) {
+		return;
+	}
+	std::string resname;
+	Holder<AnimationMgr> ani;
+	for (int i = 0; i < PRELOADS_PER_UPDATE && preloader->TakeFinished(resname, ani); i++) {
+		if (ani && factory->IsLoaded(resname.c_str(), IE_BAM_CLASS_ID) == -1) {
+			MakeAnimationFactory(ani.get(), resname.c_str(), IE_NORMAL);
+		}
+	}
+}
+
 void* GameData::GetFactoryResource(const char* resname, SClass_ID type,
 	unsigned char mode, bool silent)
 {
@@ -479,6 +724,13 @@ void* GameData::GetFactoryResource(const char* resname, SClass_ID type,
 	switch (type) {
 	case IE_BAM_CLASS_ID:
 	{
+		Holder<AnimationMgr> ani;
+		AnimationPreloader *preloader = core->GetAnimationPreloader();
+		if (preloader && preloader->Take(resname, ani)) {
+			if (!ani)
+				return NULL;
+			return MakeAnimationFactory(ani.get(), resname, mode);
+		}
 		DataStream* ret = GetResource( resname, type, silent );
 		if (ret) {
 			PluginHolder<AnimationMgr> ani(IE_BAM_CLASS_ID);
@@ -486,9 +738,7 @@ void* GameData::GetFactoryResource(const char* resname, SClass_ID type,
 				return NULL;
 			if (!ani->Open(ret))
 				return NULL;
-			AnimationFactory* af = ani->GetAnimationFactory( resname, mode );
-			factory->AddFactoryObject( af );
-			return af;
+			return MakeAnimationFactory(ani.get(), resname, mode);
 		}
 		return NULL;
 	}
@@ -512,6 +762,7 @@ void* GameData::GetFactoryResource(const char* resname, SClass_ID type,
 
 Store* GameData::GetStore(const ieResRef ResRef)
 {
+	TRACE_SCOPE_DETAIL("GameData::GetStore", ResRef);
 	StoreMap::iterator it = stores.find(ResRef);
 	if (it != stores.end()) {
 		return it->second;
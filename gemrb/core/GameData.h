@@ -28,6 +28,7 @@
 
 #include "Cache.h"
 #include "Holder.h"
+#include "Resource.h"
 #include "ResourceManager.h"
 
 #include <map>
@@ -40,6 +41,9 @@
 namespace GemRB {
 
 class Actor;
+class AnimationFactory;
+class AnimationMgr;
+class Dialog;
 struct Effect;
 class Factory;
 class Item;
@@ -55,6 +59,8 @@ struct Table {
 	Holder<TableMgr> tm;
 	ieResRef ResRef;
 	unsigned int refcount;
+	// when it was last released, if it is kept loaded for a while; 0 otherwise
+	unsigned long released;
 };
 
 class GEM_EXPORT GameData : public ResourceManager
@@ -64,6 +70,14 @@ public:
 	~GameData();
 
 	void ClearCaches();
+	/** Bytes the unreferenced items, spells, effects, dialogs and creature
+	 * files may keep cached, the least recently used ones go first.
+	 * 0 means no limit. */
+	void SetCacheBudgets(unsigned long items, unsigned long spells, unsigned long effects, unsigned long dialogs, unsigned long creatures);
+	/** Bytes and entries of all the caches above, palettes included */
+	void GetCacheUsage(unsigned long &bytes, int &count) const;
+	/** Drops every unreferenced entry of those caches, returns the bytes freed */
+	unsigned long TrimCaches();
 
 	/** Returns actor */
 	Actor *GetCreature(const char *ResRef, unsigned int PartySlot=0);
@@ -90,8 +104,15 @@ public:
 	void FreeItem(Item const *itm, const ieResRef name, bool free=false);
 	Spell* GetSpell(const ieResRef resname, bool silent=false);
 	void FreeSpell(Spell *spl, const ieResRef name, bool free=false);
-	Effect* GetEffect(const ieResRef resname);
-	void FreeEffect(Effect *eff, const ieResRef name, bool free=false);
+	/** Reads the feature blocks of a cached item or spell, see Item::LoadFeatures */
+	void LoadItemFeatures(Item *item);
+	void LoadSpellFeatures(Spell *spell);
+	/** Returns the shared template of an EFF resource, copy it before changing anything */
+	const Effect* GetEffect(const ieResRef resname);
+	void FreeEffect(const Effect *eff, const ieResRef name, bool free=false);
+	/** Returns a compiled dialog, shared with everyone else talking with it */
+	Dialog* GetDialog(const ieResRef resname);
+	void FreeDialog(Dialog *dlg, const ieResRef name);
 
 	/** creates a vvc/bam animation object at point */
 	ScriptedAnimation* GetScriptedAnimation( const char *ResRef, bool doublehint);
@@ -105,6 +126,10 @@ public:
 	/** returns factory resource, currently works only with animations */
 	void* GetFactoryResource(const char* resname, SClass_ID type,
 		unsigned char mode = IE_NORMAL, bool silent=false);
+	/** starts reading the animation in the background, if it isn't loaded yet */
+	void PreloadAnimation(const char* resname);
+	/** makes factories of the preloaded animations that are ready */
+	void FinishPreloads();
 
 	Store* GetStore(const ieResRef ResRef);
 	/// Saves a store to the cache and frees it.
@@ -116,10 +141,18 @@ private:
 	Cache SpellCache;
 	Cache EffectCache;
 	Cache PaletteCache;
+	Cache DialogCache;
+	Cache CreatureCache;
 	Factory* factory;
 	std::vector<Table> tables;
+	// the table slots by resref, including the released ones still kept
+	std::map<ResRef, int> tableIndex;
+	unsigned int retainedTables;
+	unsigned long tableClock;
 	typedef std::map<const char*, Store*, iless> StoreMap;
 	StoreMap stores;
+
+	AnimationFactory* MakeAnimationFactory(AnimationMgr* ani, const char* resname, unsigned char mode);
 };
 
 extern GEM_EXPORT GameData * gamedata;
@@ -132,16 +132,16 @@ void GameScript::SG(Scriptable* Sender, Action* parameters)
 
 void GameScript::SetGlobal(Scriptable* Sender, Action* parameters)
 {
-	SetVariable( Sender, parameters->string0Parameter, parameters->int0Parameter );
+	SetVariable( Sender, parameters->string0Variable, parameters->int0Parameter );
 }
 
 void GameScript::SetGlobalRandom(Scriptable* Sender, Action* parameters)
 {
 	int max=parameters->int1Parameter-parameters->int0Parameter+1;
 	if (max>0) {
-		SetVariable( Sender, parameters->string0Parameter, RandomNumValue%max+parameters->int0Parameter );
+		SetVariable( Sender, parameters->string0Variable, RandomNumValue%max+parameters->int0Parameter );
 	} else {
-		SetVariable( Sender, parameters->string0Parameter, 0);
+		SetVariable( Sender, parameters->string0Variable, 0);
 	}
 }
 
@@ -161,7 +161,7 @@ void GameScript::SetGlobalTimer(Scriptable* Sender, Action* parameters)
 	ieDword mytime;
 
 	mytime=core->GetGame()->GameTime; //gametime (should increase it)
-	SetVariable( Sender, parameters->string0Parameter,
+	SetVariable( Sender, parameters->string0Variable,
 		parameters->int0Parameter*AI_UPDATE_TIME + mytime);
 }
 
@@ -180,17 +180,17 @@ void GameScript::SetGlobalTimerRandom(Scriptable* Sender, Action* parameters)
 		random = RandomNumValue % random + parameters->int1Parameter;
 	}
 	mytime=core->GetGame()->GameTime; //gametime (should increase it)
-	SetVariable( Sender, parameters->string0Parameter, random*AI_UPDATE_TIME + mytime);
+	SetVariable( Sender, parameters->string0Variable, random*AI_UPDATE_TIME + mytime);
 }
 
 void GameScript::SetGlobalTimerOnce(Scriptable* Sender, Action* parameters)
 {
-	ieDword mytime = CheckVariable( Sender, parameters->string0Parameter );
+	ieDword mytime = CheckVariable( Sender, parameters->string0Variable );
 	if (mytime != 0) {
 		return;
 	}
 	mytime=core->GetGame()->GameTime; //gametime (should increase it)
-	SetVariable( Sender, parameters->string0Parameter,
+	SetVariable( Sender, parameters->string0Variable,
 		parameters->int0Parameter*AI_UPDATE_TIME + mytime);
 }
 
@@ -198,7 +198,7 @@ void GameScript::RealSetGlobalTimer(Scriptable* Sender, Action* parameters)
 {
 	ieDword mytime=core->GetGame()->RealTime;
 
-	SetVariable( Sender, parameters->string0Parameter,
+	SetVariable( Sender, parameters->string0Variable,
 		parameters->int0Parameter*AI_UPDATE_TIME + mytime);
 }
 
@@ -821,7 +821,7 @@ void GameScript::StartCutScene(Scriptable* Sender, Action* parameters)
 void GameScript::CutSceneID(Scriptable *Sender, Action* /*parameters*/)
 {
 	// shouldn't get called
-	Log(DEBUG, "GameScript", "CutSceneID was called by %s!", Sender->GetScriptName());
+	LogDebug("GameScript", "CutSceneID was called by %s!", Sender->GetScriptName());
 }
 
 static EffectRef fx_charm_ref = { "State:Charmed", -1 };
@@ -1224,7 +1224,7 @@ void GameScript::MoveToSavedLocation(Scriptable* Sender, Action* parameters)
 
 	Point p;
 	Actor* actor = ( Actor* ) tar;
-	ieDword value = (ieDword) CheckVariable( Sender, parameters->string0Parameter );
+	ieDword value = (ieDword) CheckVariable( Sender, parameters->string0Variable );
 	p.fromDword(value);
 	actor->SetPosition(p, true );
 	Sender->ReleaseCurrentAction();
@@ -2236,7 +2236,7 @@ void GameScript::NIDSpecial2(Scriptable* Sender, Action* /*parameters*/)
 		if (directions[best] != -1) {
 			direction = best;
 		}
-		Log(DEBUG, "Actions", "Travel direction determined by party: %d", direction);
+		LogDebug("Actions", "Travel direction determined by party: %d", direction);
 	}
 
 	if (direction==-1) {
@@ -3161,7 +3161,7 @@ void GameScript::SetToken(Scriptable* /*Sender*/, Action* parameters)
 //Assigns a numeric variable to the token
 void GameScript::SetTokenGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value = CheckVariable( Sender, parameters->string0Parameter );
+	ieDword value = CheckVariable( Sender, parameters->string0Variable );
 	//using SetAtCopy because we need a copy of the value
 	core->GetTokenDictionary()->SetAtCopy( parameters->string1Parameter, value );
 }
@@ -3278,8 +3278,8 @@ void GameScript::AnkhegHide(Scriptable* Sender, Action* /*parameters*/)
 
 void GameScript::GlobalSetGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value = CheckVariable( Sender, parameters->string0Parameter );
-	SetVariable( Sender, parameters->string1Parameter, value );
+	ieDword value = CheckVariable( Sender, parameters->string0Variable );
+	SetVariable( Sender, parameters->string1Variable, value );
 }
 
 /* adding the second variable to the first, they must be GLOBAL */
@@ -3294,24 +3294,24 @@ void GameScript::AddGlobals(Scriptable* Sender, Action* parameters)
 void GameScript::GlobalAddGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 + value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 + value2 );
 }
 
 /* adding the number to the global, they could be area or locals */
 void GameScript::IncrementGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value = CheckVariable( Sender, parameters->string0Parameter );
-	SetVariable( Sender, parameters->string0Parameter,
+	ieDword value = CheckVariable( Sender, parameters->string0Variable );
+	SetVariable( Sender, parameters->string0Variable,
 		value + parameters->int0Parameter );
 }
 
 /* adding the number to the global ONLY if the first global is zero */
 void GameScript::IncrementGlobalOnce(Scriptable* Sender, Action* parameters)
 {
-	ieDword value = CheckVariable( Sender, parameters->string0Parameter );
+	ieDword value = CheckVariable( Sender, parameters->string0Variable );
 	if (value != 0) {
 		return;
 	}
@@ -3319,180 +3319,180 @@ void GameScript::IncrementGlobalOnce(Scriptable* Sender, Action* parameters)
 	//just a best guess at how the two parameters are changed, and could
 	//well be more complex; the original usage of this function is currently
 	//not well understood (relates to hardcoded alignment changes)
-	SetVariable( Sender, parameters->string0Parameter, 1 );
+	SetVariable( Sender, parameters->string0Variable, 1 );
 
-	value = CheckVariable( Sender, parameters->string1Parameter );
-	SetVariable( Sender, parameters->string1Parameter,
+	value = CheckVariable( Sender, parameters->string1Variable );
+	SetVariable( Sender, parameters->string1Variable,
 		value + parameters->int0Parameter );
 }
 
 void GameScript::GlobalSubGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 - value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 - value2 );
 }
 
 void GameScript::GlobalAndGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 && value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 && value2 );
 }
 
 void GameScript::GlobalOrGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 || value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 || value2 );
 }
 
 void GameScript::GlobalBOrGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 | value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 | value2 );
 }
 
 void GameScript::GlobalBAndGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 & value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 & value2 );
 }
 
 void GameScript::GlobalXorGlobal(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = CheckVariable( Sender,
-		parameters->string1Parameter );
-	SetVariable( Sender, parameters->string0Parameter, value1 ^ value2 );
+		parameters->string1Variable );
+	SetVariable( Sender, parameters->string0Variable, value1 ^ value2 );
 }
 
 void GameScript::GlobalBOr(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
-	SetVariable( Sender, parameters->string0Parameter,
+		parameters->string0Variable );
+	SetVariable( Sender, parameters->string0Variable,
 		value1 | parameters->int0Parameter );
 }
 
 void GameScript::GlobalBAnd(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
-	SetVariable( Sender, parameters->string0Parameter,
+		parameters->string0Variable );
+	SetVariable( Sender, parameters->string0Variable,
 		value1 & parameters->int0Parameter );
 }
 
 void GameScript::GlobalXor(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
-	SetVariable( Sender, parameters->string0Parameter,
+		parameters->string0Variable );
+	SetVariable( Sender, parameters->string0Variable,
 		value1 ^ parameters->int0Parameter );
 }
 
 void GameScript::GlobalMax(Scriptable* Sender, Action* parameters)
 {
-	long value1 = CheckVariable( Sender, parameters->string0Parameter );
+	long value1 = CheckVariable( Sender, parameters->string0Variable );
 	if (value1 > parameters->int0Parameter) {
-		SetVariable( Sender, parameters->string0Parameter, value1 );
+		SetVariable( Sender, parameters->string0Variable, value1 );
 	}
 }
 
 void GameScript::GlobalMin(Scriptable* Sender, Action* parameters)
 {
-	long value1 = CheckVariable( Sender, parameters->string0Parameter );
+	long value1 = CheckVariable( Sender, parameters->string0Variable );
 	if (value1 < parameters->int0Parameter) {
-		SetVariable( Sender, parameters->string0Parameter, value1 );
+		SetVariable( Sender, parameters->string0Variable, value1 );
 	}
 }
 
 void GameScript::BitClear(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
-	SetVariable( Sender, parameters->string0Parameter,
+		parameters->string0Variable );
+	SetVariable( Sender, parameters->string0Variable,
 		value1 & ~parameters->int0Parameter );
 }
 
 void GameScript::GlobalShL(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = parameters->int0Parameter;
 	if (value2 > 31) {
 		value1 = 0;
 	} else {
 		value1 <<= value2;
 	}
-	SetVariable( Sender, parameters->string0Parameter, value1 );
+	SetVariable( Sender, parameters->string0Variable, value1 );
 }
 
 void GameScript::GlobalShR(Scriptable* Sender, Action* parameters)
 {
 	ieDword value1 = CheckVariable( Sender,
-		parameters->string0Parameter );
+		parameters->string0Variable );
 	ieDword value2 = parameters->int0Parameter;
 	if (value2 > 31) {
 		value1 = 0;
 	} else {
 		value1 >>= value2;
 	}
-	SetVariable( Sender, parameters->string0Parameter, value1 );
+	SetVariable( Sender, parameters->string0Variable, value1 );
 }
 
 void GameScript::GlobalMaxGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter );
-	ieDword value2 = CheckVariable( Sender, parameters->string1Parameter );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Variable );
+	ieDword value2 = CheckVariable( Sender, parameters->string1Variable );
 	if (value1 < value2) {
-		SetVariable( Sender, parameters->string0Parameter, value2 );
+		SetVariable( Sender, parameters->string0Variable, value2 );
 	}
 }
 
 void GameScript::GlobalMinGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter );
-	ieDword value2 = CheckVariable( Sender, parameters->string1Parameter );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Variable );
+	ieDword value2 = CheckVariable( Sender, parameters->string1Variable );
 	if (value1 > value2) {
-		SetVariable( Sender, parameters->string0Parameter, value2 );
+		SetVariable( Sender, parameters->string0Variable, value2 );
 	}
 }
 
 void GameScript::GlobalShLGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter );
-	ieDword value2 = CheckVariable( Sender, parameters->string1Parameter );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Variable );
+	ieDword value2 = CheckVariable( Sender, parameters->string1Variable );
 	if (value2 > 31) {
 		value1 = 0;
 	} else {
 		value1 <<= value2;
 	}
-	SetVariable( Sender, parameters->string0Parameter, value1 );
+	SetVariable( Sender, parameters->string0Variable, value1 );
 }
 void GameScript::GlobalShRGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter );
-	ieDword value2 = CheckVariable( Sender, parameters->string1Parameter );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Variable );
+	ieDword value2 = CheckVariable( Sender, parameters->string1Variable );
 	if (value2 > 31) {
 		value1 = 0;
 	} else {
 		value1 >>= value2;
 	}
-	SetVariable( Sender, parameters->string0Parameter, value1 );
+	SetVariable( Sender, parameters->string0Variable, value1 );
 }
 
 void GameScript::ClearAllActions(Scriptable* Sender, Action* /*parameters*/)
@@ -3622,17 +3622,17 @@ void GameScript::SetTextColor(Scriptable* /*Sender*/, Action* parameters)
 
 void GameScript::BitGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter );
+	ieDword value = CheckVariable(Sender, parameters->string0Variable );
 	HandleBitMod( value, parameters->int0Parameter, parameters->int1Parameter);
-	SetVariable(Sender, parameters->string0Parameter, value);
+	SetVariable(Sender, parameters->string0Variable, value);
 }
 
 void GameScript::GlobalBitGlobal(Scriptable* Sender, Action* parameters)
 {
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter );
-	ieDword value2 = CheckVariable(Sender, parameters->string1Parameter );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Variable );
+	ieDword value2 = CheckVariable(Sender, parameters->string1Variable );
 	HandleBitMod( value1, value2, parameters->int1Parameter);
-	SetVariable(Sender, parameters->string0Parameter, value1);
+	SetVariable(Sender, parameters->string0Variable, value1);
 }
 
 void GameScript::SetVisualRange(Scriptable* Sender, Action* parameters)
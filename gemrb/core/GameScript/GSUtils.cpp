@@ -52,6 +52,8 @@
 #include "System/StringBuffer.h"
 
 #include <cstdio>
+#include <map>
+#include <string>
 
 namespace GemRB {
 
@@ -360,6 +362,7 @@ void PlaySequenceCore(Scriptable *Sender, Action *parameters, ieDword value)
 				anim->frame=0;
 				//what else to be done???
 				anim->InitAnimation();
+				Sender->GetCurrentArea()->AnimationChanged();
 			}
 			return;
 		}
@@ -1333,7 +1336,7 @@ void AttackCore(Scriptable *Sender, Scriptable *target, int flags)
 	// mislead and projected images can't attack
 	int puppet = actor->GetStat(IE_PUPPETMASTERTYPE);
 	if (puppet && puppet < 3) {
-		Log(DEBUG, "AttackCore", "Tried attacking with an illusionary copy: %s!", actor->GetName(1));
+		LogDebug("AttackCore", "Tried attacking with an illusionary copy: %s!", actor->GetName(1));
 		return;
 	}
 
@@ -1488,17 +1491,21 @@ static void ParseObject(const char *&str,const char *&src, Object *&object)
 		object->objectFilters[0] = 1;
 		break;
 	case '"':
+	{
 		//Scriptable Name
 		src++;
+		char name[65];
 		int i;
-		for (i=0;i<(int) sizeof(object->objectName)-1 && *src && *src!='"';i++)
+		for (i=0;i<(int) sizeof(name)-1 && *src && *src!='"';i++)
 		{
-			object->objectName[i] = *src;
+			name[i] = *src;
 			src++;
 		}
-		object->objectName[i] = 0;
+		name[i] = 0;
+		object->objectName = InternScriptString(name);
 		src++;
 		break;
+	}
 	case '[':
 		src++; //skipping [
 		ParseIdsTarget(src, object);
@@ -1737,6 +1744,7 @@ Action* GenerateActionCore(const char *src, const char *str, unsigned short acti
 		if (*src == ',' || *src==')')
 			src++;
 	}
+	ResolveVariables(newAction);
 	return newAction;
 }
 
@@ -1858,7 +1866,7 @@ static Object *ObjectCopy(Object *object)
 	MEMCPY( newObject->objectFields, object->objectFields );
 	MEMCPY( newObject->objectFilters, object->objectFilters );
 	MEMCPY( newObject->objectRect, object->objectRect );
-	MEMCPY( newObject->objectName, object->objectName );
+	newObject->objectName = object->objectName;
 	return newObject;
 }
 
@@ -1872,6 +1880,8 @@ Action *ParamCopy(Action *parameters)
 	newAction->pointParameter = parameters->pointParameter;
 	MEMCPY( newAction->string0Parameter, parameters->string0Parameter );
 	MEMCPY( newAction->string1Parameter, parameters->string1Parameter );
+	newAction->string0Variable = parameters->string0Variable;
+	newAction->string1Variable = parameters->string1Variable;
 	for (int c=0;c<3;c++) {
 		newAction->objects[c]= ObjectCopy( parameters->objects[c] );
 	}
@@ -1888,18 +1898,64 @@ Action *ParamCopyNoOverride(Action *parameters)
 	newAction->pointParameter = parameters->pointParameter;
 	MEMCPY( newAction->string0Parameter, parameters->string0Parameter );
 	MEMCPY( newAction->string1Parameter, parameters->string1Parameter );
+	newAction->string0Variable = parameters->string0Variable;
+	newAction->string1Variable = parameters->string1Variable;
 	newAction->objects[0]= NULL;
 	newAction->objects[1]= ObjectCopy( parameters->objects[1] );
 	newAction->objects[2]= ObjectCopy( parameters->objects[2] );
 	return newAction;
 }
 
+// ActionOverride hands the same script action to its target round after
+// round, so the copy is kept with the action and refreshed in place once
+// nobody else holds it anymore
+Action *OverrideCopy(Action *parameters)
+{
+	Action *copy = parameters->overrideCopy;
+	bool reusable = copy && copy->GetRef() == 1;
+	for (int c = 1; reusable && c < 3; c++) {
+		reusable = !copy->objects[c] == !parameters->objects[c];
+	}
+	if (!reusable) {
+		Action *newAction = ParamCopyNoOverride(parameters);
+		if (!copy) {
+			newAction->IncRef();
+			parameters->overrideCopy = newAction;
+		}
+		return newAction;
+	}
+
+	// the target may have changed the parameters while it ran
+	copy->actionID = parameters->actionID;
+	copy->int0Parameter = parameters->int0Parameter;
+	copy->int1Parameter = parameters->int1Parameter;
+	copy->int2Parameter = parameters->int2Parameter;
+	copy->pointParameter = parameters->pointParameter;
+	MEMCPY( copy->string0Parameter, parameters->string0Parameter );
+	MEMCPY( copy->string1Parameter, parameters->string1Parameter );
+	copy->string0Variable = parameters->string0Variable;
+	copy->string1Variable = parameters->string1Variable;
+	for (int c = 1; c < 3; c++) {
+		Object *object = parameters->objects[c];
+		if (object) {
+			MEMCPY( copy->objects[c]->objectFields, object->objectFields );
+			MEMCPY( copy->objects[c]->objectFilters, object->objectFilters );
+			MEMCPY( copy->objects[c]->objectRect, object->objectRect );
+			copy->objects[c]->objectName = object->objectName;
+		}
+	}
+	return copy;
+}
+
 Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int negate)
 {
 	Trigger *newTrigger = new Trigger();
 	newTrigger->triggerID = (unsigned short) triggersTable->GetValueIndex( trIndex )&0x3fff;
 	newTrigger->flags = (unsigned short) negate;
 	int mergestrings = triggerflags[newTrigger->triggerID]&TF_MERGESTRINGS;
+	// the strings are parsed here and interned at the end
+	char strings[2][65];
+	memset(strings, 0, sizeof(strings));
 	int stringsCount = 0;
 	int intCount = 0;
 	//Here is the Trigger; Now we need to evaluate the parameters
@@ -1971,12 +2027,7 @@ Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int
 				SKIP_ARGUMENT();
 				src++;
 				int i;
-				char* dst;
-				if (!stringsCount) {
-					dst = newTrigger->string0Parameter;
-				} else {
-					dst = newTrigger->string1Parameter;
-				}
+				char* dst = strings[stringsCount ? 1 : 0];
 				//skipping the context part, which
 				//is to be readed later
 				if (mergestrings) {
@@ -2013,11 +2064,7 @@ Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int
 						return NULL;
 					}
 					SKIP_ARGUMENT();
-					if (!stringsCount) {
-						dst = newTrigger->string0Parameter;
-					} else {
-						dst = newTrigger->string1Parameter;
-					}
+					dst = strings[stringsCount ? 1 : 0];
 
 					//this works only if there are no spaces
 					if (*src++!='"' || *src++!=',' || *src++!='"') {
@@ -2046,6 +2093,9 @@ Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int
 		if (*src == ',' || *src==')')
 			src++;
 	}
+	newTrigger->string0Parameter = InternScriptString(strings[0]);
+	newTrigger->string1Parameter = InternScriptString(strings[1]);
+	ResolveVariables(newTrigger);
 	return newTrigger;
 }
 
@@ -2053,8 +2103,11 @@ void SetVariable(Scriptable* Sender, const char* VarName, const char* Context, i
 {
 	char newVarName[8+33];
 
+	// the kept Global() and similar results may be stale now
+	ResetTriggerCache();
+
 	if (InDebug&ID_VARIABLES) {
-		Log(DEBUG, "GSUtils", "Setting variable(\"%s%s\", %d)", Context,
+		LogDebug("GSUtils", "Setting variable(\"%s%s\", %d)", Context,
 			VarName, value );
 	}
 
@@ -2093,6 +2146,8 @@ void SetVariable(Scriptable* Sender, const char* VarName, ieDword value)
 	char newVarName[8];
 	const char *poi;
 
+	ResetTriggerCache();
+
 	poi = &VarName[6];
 	//some HoW triggers use a : to separate the scope from the variable name
 	if (*poi==':') {
@@ -2100,7 +2155,7 @@ void SetVariable(Scriptable* Sender, const char* VarName, ieDword value)
 	}
 
 	if (InDebug&ID_VARIABLES) {
-		Log(DEBUG, "GSUtils", "Setting variable(\"%s\", %d)", VarName, value );
+		LogDebug("GSUtils", "Setting variable(\"%s\", %d)", VarName, value );
 	}
 	strlcpy( newVarName, VarName, 7 );
 	if (stricmp( newVarName, "MYAREA" ) == 0) {
@@ -2238,6 +2293,145 @@ ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Conte
 	return value;
 }
 
+// scripts are cached and dialogs compile their own triggers, so the references are shared too
+static std::map<std::string, VariableRef> ResolvedVariables;
+
+const VariableRef* ResolveVariable(const char* VarName, const char* Context)
+{
+	char newVarName[8];
+	strnlwrcpy(newVarName, Context, 6);
+	std::string name(newVarName);
+	name += ':';
+	name += VarName;
+	std::map<std::string, VariableRef>::iterator it = ResolvedVariables.find(name);
+	if (it != ResolvedVariables.end()) {
+		return &it->second;
+	}
+
+	VariableRef var;
+	strlcpy(var.context, newVarName, sizeof(var.context));
+	// the same precedence as in SetVariable and CheckVariable
+	if (!stricmp(newVarName, "MYAREA")) {
+		var.scope = VR_MYAREA;
+	} else if (!stricmp(newVarName, "LOCALS")) {
+		var.scope = VR_LOCALS;
+	} else if (HasKaputz && !stricmp(newVarName, "KAPUTZ")) {
+		var.scope = VR_KAPUTZ;
+	} else if (!stricmp(newVarName, "GLOBAL")) {
+		var.scope = VR_GLOBAL;
+	} else {
+		var.scope = VR_AREA;
+	}
+	var.key = Variables::InternKey(VarName);
+	if (!var.key) {
+		return NULL;
+	}
+	return &ResolvedVariables.insert(std::make_pair(name, var)).first->second;
+}
+
+const VariableRef* ResolveVariable(const char* VarName)
+{
+	char newVarName[8];
+	const char *poi;
+
+	strlcpy(newVarName, VarName, 7);
+	poi = VarName + strlen(newVarName);
+	//some HoW triggers use a : to separate the scope from the variable name
+	if (*poi==':') {
+		poi++;
+	}
+	return ResolveVariable(poi, newVarName);
+}
+
+void ResolveVariables(Trigger *tR)
+{
+	if (!(triggerflags[tR->triggerID] & TF_MERGESTRINGS)) {
+		return;
+	}
+	if (tR->string0Parameter[0]) {
+		tR->string0Variable = ResolveVariable(tR->string0Parameter);
+	}
+	if (tR->string1Parameter[0]) {
+		tR->string1Variable = ResolveVariable(tR->string1Parameter);
+	}
+}
+
+void ResolveVariables(Action *aC)
+{
+	if (!(actionflags[aC->actionID] & AF_MERGESTRINGS)) {
+		return;
+	}
+	if (aC->string0Parameter[0]) {
+		aC->string0Variable = ResolveVariable(aC->string0Parameter);
+	}
+	if (aC->string1Parameter[0]) {
+		aC->string1Variable = ResolveVariable(aC->string1Parameter);
+	}
+}
+
+static Variables *GetVariableTable(Scriptable* Sender, const VariableRef* var)
+{
+	Game *game = core->GetGame();
+	switch (var->scope) {
+		case VR_MYAREA:
+			return Sender->GetCurrentArea()->locals;
+		case VR_LOCALS:
+			return Sender->locals;
+		case VR_KAPUTZ:
+			return game->kaputz;
+		case VR_GLOBAL:
+			return game->locals;
+		default:
+			Map *map = game->GetMap(game->FindMap(var->context));
+			return map ? map->locals : NULL;
+	}
+}
+
+void SetVariable(Scriptable* Sender, const VariableRef* var, ieDword value)
+{
+	// the kept Global() and similar results may be stale now
+	ResetTriggerCache();
+
+	// an empty string, nothing to set
+	if (!var) {
+		return;
+	}
+	if (InDebug&ID_VARIABLES) {
+		LogDebug("GSUtils", "Setting variable(\"%s%s\", %d)", var->context,
+			var->key->name, value );
+	}
+
+	Variables *vars = GetVariableTable(Sender, var);
+	if (vars) {
+		vars->SetAt(*var->key, value, NoCreate);
+	} else if (InDebug&ID_VARIABLES) {
+		Log(WARNING, "GameScript", "Invalid variable %s %s in setvariable",
+			var->context, var->key->name);
+	}
+}
+
+ieDword CheckVariable(Scriptable* Sender, const VariableRef* var, bool *valid)
+{
+	ieDword value = 0;
+
+	Variables *vars = var ? GetVariableTable(Sender, var) : NULL;
+	if (!vars) {
+		if (valid) {
+			*valid=false;
+		}
+		if (var && (InDebug&ID_VARIABLES)) {
+			Log(WARNING, "GameScript", "Invalid variable %s %s in checkvariable",
+				var->context, var->key->name);
+		}
+		return value;
+	}
+	vars->Lookup(*var->key, value);
+	if (InDebug&ID_VARIABLES) {
+		print("CheckVariable %s%s: %d", var->context, var->key->name, value);
+	}
+	return value;
+}
+
 // checks if a variable exists in any context
 bool VariableExists(Scriptable *Sender, const char *VarName, const char *Context)
 {
@@ -2344,6 +2538,28 @@ int GetGroup(Actor *actor)
 	return type;
 }
 
+// CanSee is the costly part, so it only runs on the candidates nearest first
+static Actor *GetNearestSeen(NearestQueue &queue, Actor *origin, int whoseeswho)
+{
+	unsigned int distance;
+	Scriptable *sc;
+	while ((sc = queue.PopNearest(distance))) {
+		Actor *ac = (Actor *) sc;
+		if (whoseeswho&ENEMY_SEES_ORIGIN) {
+			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
+				continue;
+			}
+		}
+		if (whoseeswho&ORIGIN_SEES_ENEMY) {
+			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
+				continue;
+			}
+		}
+		return ac;
+	}
+	return NULL;
+}
+
 Actor *GetNearestEnemyOf(Map *map, Actor *origin, int whoseeswho)
 {
 	//determining the allegiance of the origin
@@ -2354,7 +2570,8 @@ Actor *GetNearestEnemyOf(Map *map, Actor *origin, int whoseeswho)
 		return NULL;
 	}
 
-	Targets *tgts = new Targets();
+	static NearestQueue enemies;
+	enemies.Clear();
 
 	int i = map->GetActorCount(true);
 	Actor *ac;
@@ -2362,61 +2579,31 @@ Actor *GetNearestEnemyOf(Map *map, Actor *origin, int whoseeswho)
 		ac=map->GetActor(i,true);
 		if (ac == origin) continue;
 
-		if (whoseeswho&ENEMY_SEES_ORIGIN) {
-			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
-				continue;
-			}
-		}
-		if (whoseeswho&ORIGIN_SEES_ENEMY) {
-			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
-				continue;
-			}
-		}
-
-		int distance = Distance(ac, origin);
 		if (type) { //origin is PC
-			if (ac->GetStat(IE_EA) >= EA_EVILCUTOFF) {
-				tgts->AddTarget(ac, distance, GA_NO_DEAD|GA_NO_UNSCHEDULED);
-			}
-		}
-		else {
-			if (ac->GetStat(IE_EA) <= EA_GOODCUTOFF) {
-				tgts->AddTarget(ac, distance, GA_NO_DEAD|GA_NO_UNSCHEDULED);
-			}
+			if (ac->GetStat(IE_EA) < EA_EVILCUTOFF) continue;
+		} else {
+			if (ac->GetStat(IE_EA) > EA_GOODCUTOFF) continue;
 		}
+		if (!ac->ValidTarget(GA_NO_DEAD|GA_NO_UNSCHEDULED)) continue;
+		enemies.Add(ac, Distance(ac, origin));
 	}
-	ac = (Actor *) tgts->GetTarget(0, ST_ACTOR);
-	delete tgts;
-	return ac;
+	return GetNearestSeen(enemies, origin, whoseeswho);
 }
 
 Actor *GetNearestOf(Map *map, Actor *origin, int whoseeswho)
 {
-	Targets *tgts = new Targets();
+	static NearestQueue actors;
+	actors.Clear();
 
 	int i = map->GetActorCount(true);
 	Actor *ac;
 	while (i--) {
 		ac=map->GetActor(i,true);
 		if (ac == origin) continue;
-
-		if (whoseeswho&ENEMY_SEES_ORIGIN) {
-			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
-				continue;
-			}
-		}
-		if (whoseeswho&ORIGIN_SEES_ENEMY) {
-			if (!CanSee(ac, origin, true, GA_NO_DEAD|GA_NO_UNSCHEDULED)) {
-				continue;
-			}
-		}
-
-		int distance = Distance(ac, origin);
-		tgts->AddTarget(ac, distance, GA_NO_DEAD|GA_NO_UNSCHEDULED);
+		if (!ac->ValidTarget(GA_NO_DEAD|GA_NO_UNSCHEDULED)) continue;
+		actors.Add(ac, Distance(ac, origin));
 	}
-	ac = (Actor *) tgts->GetTarget(0, ST_ACTOR);
-	delete tgts;
-	return ac;
+	return GetNearestSeen(actors, origin, whoseeswho);
 }
 
 Point GetEntryPoint(const char *areaname, const char *entryname)
@@ -123,6 +123,7 @@ GEM_EXPORT void FreeSrc(SrcVector *poi, const ieResRef key);
 GEM_EXPORT SrcVector *LoadSrc(const ieResRef resname);
 Action *ParamCopy(Action *parameters);
 Action *ParamCopyNoOverride(Action *parameters);
+Action *OverrideCopy(Action *parameters);
 void SetVariable(Scriptable* Sender, const char* VarName, ieDword value);
 Point GetEntryPoint(const char *areaname, const char *entryname);
 //these are used from other plugins
@@ -136,6 +137,13 @@ GEM_EXPORT void MoveBetweenAreasCore(Actor* actor, const char *area, const Point
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid = NULL);
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, bool *valid = NULL);
 GEM_EXPORT bool VariableExists(Scriptable *Sender, const char *VarName, const char *Context);
+/* the handle based variants, for the variables resolved when compiling */
+const VariableRef* ResolveVariable(const char* VarName);
+const VariableRef* ResolveVariable(const char* VarName, const char* Context);
+void ResolveVariables(Trigger *tR);
+void ResolveVariables(Action *aC);
+ieDword CheckVariable(Scriptable* Sender, const VariableRef* var, bool *valid = NULL);
+void SetVariable(Scriptable* Sender, const VariableRef* var, ieDword value);
 Action* GenerateActionCore(const char *src, const char *str, unsigned short actionID);
 Trigger *GenerateTriggerCore(const char *src, const char *str, int trIndex, int negate);
 GEM_EXPORT unsigned int GetSpellDistance(const ieResRef spellres, Scriptable *Sender);
@@ -22,16 +22,24 @@
 
 #include "GameScript/GSUtils.h"
 #include "GameScript/Matching.h"
+#include "GameScript/ScriptProfiler.h"
 
 #include "win32def.h"
 
+#include "FrameStats.h"
 #include "Game.h"
 #include "GameData.h"
 #include "Interface.h"
+#include "ObjectPool.h"
 #include "PluginMgr.h"
 #include "TableMgr.h"
 #include "RNG/RNG_SFMT.h"
 #include "System/StringBuffer.h"
+#include "System/Thread.h"
+
+#include <map>
+#include <set>
+#include <string>
 
 namespace GemRB {
 
@@ -121,7 +129,7 @@ static const TriggerLink triggernames[] = {
 	{"e", GameScript::E, 0},
 	{"entered", GameScript::Entered, 0},
 	{"entirepartyonmap", GameScript::EntirePartyOnMap, 0},
-	{"exists", GameScript::Exists, 0},
+	{"exists", GameScript::Exists, TF_PURE},
 	{"extendedstatecheck", GameScript::ExtendedStateCheck, 0},
 	{"extraproficiency", GameScript::ExtraProficiency, 0},
 	{"extraproficiencygt", GameScript::ExtraProficiencyGT, 0},
@@ -139,17 +147,17 @@ static const TriggerLink triggernames[] = {
 	{"general", GameScript::General, 0},
 	{"ggt", GameScript::GGT_Trigger, 0},
 	{"glt", GameScript::GLT_Trigger, 0},
-	{"global", GameScript::Global,TF_MERGESTRINGS},
+	{"global", GameScript::Global,TF_MERGESTRINGS|TF_PURE|TF_CONCURRENT},
 	{"globalandglobal", GameScript::GlobalAndGlobal_Trigger,TF_MERGESTRINGS},
 	{"globalband", GameScript::BitCheck,TF_MERGESTRINGS},
 	{"globalbandglobal", GameScript::GlobalBAndGlobal_Trigger,TF_MERGESTRINGS},
 	{"globalbandglobalexact", GameScript::GlobalBAndGlobalExact,TF_MERGESTRINGS},
 	{"globalbitglobal", GameScript::GlobalBitGlobal_Trigger,TF_MERGESTRINGS},
 	{"globalequalsglobal", GameScript::GlobalsEqual,TF_MERGESTRINGS}, //this is the same
-	{"globalgt", GameScript::GlobalGT,TF_MERGESTRINGS},
-	{"globalgtglobal", GameScript::GlobalGTGlobal,TF_MERGESTRINGS},
-	{"globallt", GameScript::GlobalLT,TF_MERGESTRINGS},
-	{"globalltglobal", GameScript::GlobalLTGlobal,TF_MERGESTRINGS},
+	{"globalgt", GameScript::GlobalGT,TF_MERGESTRINGS|TF_PURE|TF_CONCURRENT},
+	{"globalgtglobal", GameScript::GlobalGTGlobal,TF_MERGESTRINGS|TF_PURE|TF_CONCURRENT},
+	{"globallt", GameScript::GlobalLT,TF_MERGESTRINGS|TF_PURE|TF_CONCURRENT},
+	{"globalltglobal", GameScript::GlobalLTGlobal,TF_MERGESTRINGS|TF_PURE|TF_CONCURRENT},
 	{"globalorglobal", GameScript::GlobalOrGlobal_Trigger,TF_MERGESTRINGS},
 	{"globalsequal", GameScript::GlobalsEqual, 0},
 	{"globalsgt", GameScript::GlobalsGT, 0},
@@ -206,8 +214,8 @@ static const TriggerLink triggernames[] = {
 	{"inline", GameScript::InLine, 0},
 	{"inmyarea", GameScript::InMyArea, 0},
 	{"inmygroup", GameScript::InMyGroup, 0},
-	{"inparty", GameScript::InParty, 0},
-	{"inpartyallowdead", GameScript::InPartyAllowDead, 0},
+	{"inparty", GameScript::InParty, TF_PURE},
+	{"inpartyallowdead", GameScript::InPartyAllowDead, TF_PURE},
 	{"inpartyslot", GameScript::InPartySlot, 0},
 	{"internal", GameScript::Internal, 0},
 	{"internalgt", GameScript::InternalGT, 0},
@@ -261,8 +269,8 @@ static const TriggerLink triggernames[] = {
 	{"levelpartygt", GameScript::LevelPartyGT, 0},
 	{"levelpartylt", GameScript::LevelPartyLT, 0},
 	{"localsequal", GameScript::LocalsEqual, 0},
-	{"localsgt", GameScript::LocalsGT, 0},
-	{"localslt", GameScript::LocalsLT, 0},
+	{"localsgt", GameScript::LocalsGT, TF_PURE|TF_CONCURRENT},
+	{"localslt", GameScript::LocalsLT, TF_PURE|TF_CONCURRENT},
 	{"los", GameScript::LOS, 0},
 	{"lt", GameScript::LT, 0},
 	{"modalstate", GameScript::ModalState, 0},
@@ -287,9 +295,9 @@ static const TriggerLink triggernames[] = {
 	{"numbouncingspelllevel", GameScript::NumBouncingSpellLevel, 0},
 	{"numbouncingspelllevelgt", GameScript::NumBouncingSpellLevelGT, 0},
 	{"numbouncingspelllevellt", GameScript::NumBouncingSpellLevelLT, 0},
-	{"numcreature", GameScript::NumCreatures, 0},
-	{"numcreaturegt", GameScript::NumCreaturesGT, 0},
-	{"numcreaturelt", GameScript::NumCreaturesLT, 0},
+	{"numcreature", GameScript::NumCreatures, TF_PURE},
+	{"numcreaturegt", GameScript::NumCreaturesGT, TF_PURE},
+	{"numcreaturelt", GameScript::NumCreaturesLT, TF_PURE},
 	{"numcreaturesatmylevel", GameScript::NumCreaturesAtMyLevel, 0},
 	{"numcreaturesgtmylevel", GameScript::NumCreaturesGTMyLevel, 0},
 	{"numcreaturesltmylevel", GameScript::NumCreaturesLTMyLevel, 0},
@@ -372,7 +380,7 @@ static const TriggerLink triggernames[] = {
 	{"randomnumgt", GameScript::RandomNumGT, 0},
 	{"randomnumlt", GameScript::RandomNumLT, 0},
 	{"randomstatcheck", GameScript::RandomStatCheck, 0},
-	{"range", GameScript::Range, 0},
+	{"range", GameScript::Range, TF_PURE},
 	{"reaction", GameScript::Reaction, 0},
 	{"reactiongt", GameScript::ReactionGT, 0},
 	{"reactionlt", GameScript::ReactionLT, 0},
@@ -1149,6 +1157,60 @@ static const IDSLink idsnames[] = {
 	{ NULL,NULL}
 };
 
+//the triggers that only look for a pending TriggerEntry, so they are false without one
+struct EventTriggerLink {
+	TriggerFunction Function;
+	unsigned short Event;
+};
+
+static const EventTriggerLink eventtriggers[] = {
+	{GameScript::AttackedBy, trigger_attackedby},
+	{GameScript::BecameVisible, trigger_becamevisible},
+	{GameScript::Clicked, trigger_clicked},
+	{GameScript::Closed, trigger_closed},
+	{GameScript::Detected, trigger_detected},
+	{GameScript::Die, trigger_die},
+	{GameScript::Died, trigger_died},
+	{GameScript::Disarmed, trigger_disarmed},
+	{GameScript::DisarmFailed, trigger_disarmfailed},
+	{GameScript::Entered, trigger_entered},
+	{GameScript::HarmlessClosed, trigger_harmlessclosed},
+	{GameScript::HarmlessEntered, trigger_harmlessentered},
+	{GameScript::HarmlessOpened, trigger_harmlessopened},
+	{GameScript::Heard, trigger_heard},
+	{GameScript::Help_Trigger, trigger_help},
+	{GameScript::HitBy, trigger_hitby},
+	{GameScript::HotKey, trigger_hotkey},
+	{GameScript::Joins, trigger_joins},
+	{GameScript::Killed, trigger_killed},
+	{GameScript::Leaves, trigger_leaves},
+	{GameScript::NamelessBitTheDust, trigger_namelessbitthedust},
+	{GameScript::OnCreation, trigger_oncreation},
+	{GameScript::OpenFailed, trigger_failedtoopen},
+	{GameScript::Opened, trigger_opened},
+	{GameScript::PartyMemberDied, trigger_partymemberdied},
+	{GameScript::PartyRested, trigger_partyrested},
+	{GameScript::PickLockFailed, trigger_picklockfailed},
+	{GameScript::PickpocketFailed, trigger_pickpocketfailed},
+	{GameScript::ReceivedOrder, trigger_receivedorder},
+	{GameScript::SpellCast, trigger_spellcast},
+	{GameScript::SpellCastInnate, trigger_spellcastinnate},
+	{GameScript::SpellCastOnMe, trigger_spellcastonme},
+	{GameScript::SpellCastPriest, trigger_spellcastpriest},
+	{GameScript::StealFailed, trigger_disarmfailed},
+	{GameScript::TookDamage, trigger_tookdamage},
+	{GameScript::TrapTriggered, trigger_traptriggered},
+	{GameScript::TriggerTrigger, trigger_trigger},
+	{GameScript::TurnedBy, trigger_turnedby},
+	{GameScript::Unlocked, trigger_unlocked},
+	{GameScript::WalkedToTrigger, trigger_walkedtotrigger},
+	{GameScript::WasInDialog, trigger_wasindialog},
+	{ NULL, 0}
+};
+
+//the TriggerEntry each trigger code waits for, 0 if it isn't an event trigger
+static unsigned short triggerevents[MAX_TRIGGERS];
+
 static const TriggerLink* FindTrigger(const char* triggername)
 {
 	if (!triggername) {
@@ -1181,6 +1243,30 @@ static const ActionLink* FindAction(const char* actionname)
 	return NULL;
 }
 
+const char* GetTriggerLinkName(unsigned short triggerID)
+{
+	if (triggerID < MAX_TRIGGERS && triggers[triggerID]) {
+		for (int i = 0; triggernames[i].Name; i++) {
+			if (triggernames[i].Function == triggers[triggerID]) {
+				return triggernames[i].Name;
+			}
+		}
+	}
+	return NULL;
+}
+
+const char* GetActionLinkName(unsigned short actionID)
+{
+	if (actionID < MAX_ACTIONS && actions[actionID]) {
+		for (int i = 0; actionnames[i].Name; i++) {
+			if (actionnames[i].Function == actions[actionID]) {
+				return actionnames[i].Name;
+			}
+		}
+	}
+	return NULL;
+}
+
 static const ObjectLink* FindObject(const char* objectname)
 {
 	if (!objectname) {
@@ -1223,68 +1309,117 @@ void SetScriptDebugMode(int arg)
 
 /********************** Targets **********************************/
 
+// the actions issued by the scripts and the gui, and their objects, come
+// and go every round
+static ObjectPool<sizeof(Action)> ActionPool("actions");
+static ObjectPool<sizeof(Object)> ScriptObjectPool("action objects");
+
+void *Action::operator new(size_t size)
+{
+	return ActionPool.Take(size);
+}
+
+void Action::operator delete(void *obj, size_t size)
+{
+	ActionPool.Give(obj, size);
+}
+
+void *Object::operator new(size_t size)
+{
+	return ScriptObjectPool.Take(size);
+}
+
+void Object::operator delete(void *obj, size_t size)
+{
+	ScriptObjectPool.Give(obj, size);
+}
+
+// the object matching creates and drops these all the time (on the main thread)
+#define MAX_POOLED_TARGETS 32
+static void *targetsPool[MAX_POOLED_TARGETS];
+static int pooledTargets = 0;
+
+void* Targets::operator new(size_t size)
+{
+	if (pooledTargets && size == sizeof(Targets)) {
+		return targetsPool[--pooledTargets];
+	}
+	return ::operator new(size);
+}
+
+void Targets::operator delete(void* p)
+{
+	if (!p) {
+		return;
+	}
+	if (pooledTargets < MAX_POOLED_TARGETS) {
+		targetsPool[pooledTargets++] = p;
+		return;
+	}
+	::operator delete(p);
+}
+
 int Targets::Count() const
 {
-	return (int)objects.size();
+	return (int) count;
 }
 
-targettype *Targets::RemoveTargetAt(targetlist::iterator &m)
+targettype *Targets::RemoveTargetAt(iterator &m)
 {
-	m=objects.erase(m);
-	if (m!=objects.end() ) {
-		return &(*m);
+	count--;
+	memmove(items + m, items + m + 1, (count - m) * sizeof(targettype));
+	if (m < count) {
+		return items + m;
 	}
 	return NULL;
 }
 
 const targettype *Targets::GetLastTarget(int Type)
 {
-	targetlist::const_iterator m = objects.end();
-	while (m--!=objects.begin() ) {
-		if ( (Type==-1) || ((*m).actor->Type==Type) ) {
-			return &(*(m));
+	unsigned int m = count;
+	while (m--) {
+		if ( (Type==-1) || (items[m].actor->Type==Type) ) {
+			return items + m;
 		}
 	}
 	return NULL;
 }
 
-const targettype *Targets::GetFirstTarget(targetlist::iterator &m, int Type)
+const targettype *Targets::GetFirstTarget(iterator &m, int Type)
 {
-	m=objects.begin();
-	while (m!=objects.end() ) {
-		if ( (Type!=-1) && ( (*m).actor->Type!=Type)) {
+	m = 0;
+	while (m < count) {
+		if ( (Type!=-1) && (items[m].actor->Type!=Type)) {
 			m++;
 			continue;
 		}
-		return &(*m);
+		return items + m;
 	}
 	return NULL;
 }
 
-const targettype *Targets::GetNextTarget(targetlist::iterator &m, int Type)
+const targettype *Targets::GetNextTarget(iterator &m, int Type)
 {
 	m++;
-	while (m!=objects.end() ) {
-		if ( (Type!=-1) && ( (*m).actor->Type!=Type)) {
+	while (m < count) {
+		if ( (Type!=-1) && (items[m].actor->Type!=Type)) {
 			m++;
 			continue;
 		}
-		return &(*m);
+		return items + m;
 	}
 	return NULL;
 }
 
 Scriptable *Targets::GetTarget(unsigned int index, int Type)
 {
-	targetlist::iterator m = objects.begin();
-	while(m!=objects.end() ) {
-		if ( (Type==-1) || ((*m).actor->Type==Type)) {
+	for (unsigned int m = 0; m < count; m++) {
+		if ( (Type==-1) || (items[m].actor->Type==Type)) {
 			if (!index) {
-				return (*m).actor;
+				return items[m].actor;
 			}
 			index--;
 		}
-		m++;
 	}
 	return NULL;
 }
@@ -1312,36 +1447,50 @@ void Targets::AddTarget(Scriptable* target, unsigned int distance, int ga_flags)
 	default:
 		break;
 	}
-	targettype Target = {target, distance};
-	targetlist::iterator m;
-	for (m = objects.begin(); m != objects.end(); ++m) {
-		if ( (*m).distance>distance) {
-			objects.insert( m, Target);
-			return;
+	if (count == capacity) {
+		capacity *= 2;
+		if (items == inlineItems) {
+			items = (targettype *) malloc(capacity * sizeof(targettype));
+			memcpy(items, inlineItems, count * sizeof(targettype));
+		} else {
+			items = (targettype *) realloc(items, capacity * sizeof(targettype));
 		}
 	}
-	objects.push_back( Target );
+	// after the ones at the same distance, like before
+	unsigned int m = count;
+	while (m && items[m-1].distance > distance) {
+		m--;
+	}
+	memmove(items + m + 1, items + m, (count - m) * sizeof(targettype));
+	items[m].actor = target;
+	items[m].distance = distance;
+	count++;
 }
 
 void Targets::Clear()
 {
-	objects.clear();
+	count = 0;
 }
 
 void Targets::dump() const
 {
 	print("Target dump (actors only):");
-	targetlist::const_iterator m;
-	for (m = objects.begin(); m != objects.end(); ++m) {
-		if ((*m).actor->Type == ST_ACTOR) {
-			print("%s", (*m).actor->GetName(1));
+	for (unsigned int m = 0; m < count; m++) {
+		if (items[m].actor->Type == ST_ACTOR) {
+			print("%s", items[m].actor->GetName(1));
 		}
 	}
 }
 
 /** releasing global memory */
+static void StopScriptWorkers();
+
 static void CleanupIEScript()
 {
+	StopScriptWorkers();
+	while (pooledTargets) {
+		::operator delete(targetsPool[--pooledTargets]);
+	}
 	triggersTable.release();
 	actionsTable.release();
 	objectsTable.release();
@@ -1496,7 +1645,7 @@ void InitializeIEScript()
 					buffer.appendFormatted("%s is a synonym of ",
 						triggersTable->GetStringIndex( j ) );
 					printFunction(buffer, triggersTable, triggersTable->FindValue(triggersTable->GetValueIndex(j)));
-					Log(DEBUG, "GameScript", buffer);
+					LogDebug("GameScript", buffer);
 				}
 			}
 			continue; //we already found an alternative
@@ -1567,7 +1716,7 @@ void InitializeIEScript()
 					buffer.appendFormatted("%s is a synonym of ",
 						actionsTable->GetStringIndex( j ) );
 					printFunction(buffer, actionsTable, actionsTable->FindValue(actionsTable->GetValueIndex(j)));
-					Log(DEBUG, "GameScript", buffer);
+					LogDebug("GameScript", buffer);
 				}
 			}
 			continue; //we already found an alternative
@@ -1714,7 +1863,7 @@ void InitializeIEScript()
 				buffer.appendFormatted("%s is a synonym of ",
 					objectsTable->GetStringIndex( j ) );
 				printFunction(buffer, objectsTable, objectsTable->FindValue(objectsTable->GetValueIndex(j)));
-				Log(DEBUG, "GameScript", buffer);
+				LogDebug("GameScript", buffer);
 			}
 			continue;
 		}
@@ -1786,6 +1935,17 @@ void InitializeIEScript()
 			triggerflags[i] |= TF_SAVED;
 		}
 	}
+
+	for (i = 0; i < MAX_TRIGGERS; i++) {
+		triggerevents[i] = 0;
+		if (!triggers[i]) continue;
+		for (j = 0; eventtriggers[j].Function; j++) {
+			if (triggers[i] == eventtriggers[j].Function) {
+				triggerevents[i] = eventtriggers[j].Event;
+				break;
+			}
+		}
+	}
 }
 
 /********************** GameScript *******************************/
@@ -1795,6 +1955,9 @@ GameScript::GameScript(const ieResRef ResRef, Scriptable* MySelf,
 {
 	scriptlevel = ScriptLevel;
 	lastAction = (unsigned int) ~0;
+	preparedChanges = 0;
+	preparedArea = NULL;
+	prepared = false;
 
 	strnlwrcpy( Name, ResRef, 8 );
 
@@ -1807,7 +1970,7 @@ GameScript::~GameScript(void)
 		//set 3. parameter to true if you want instant free
 		//and possible death
 		if (InDebug&ID_REFERENCE) {
-			Log(DEBUG, "GameScript", "One instance of %s is dropped from %d.", Name, BcsCache.RefCount(Name) );
+			LogDebug("GameScript", "One instance of %s is dropped from %d.", Name, BcsCache.RefCount(Name) );
 		}
 		int res = BcsCache.DecRef(script, Name, true);
 
@@ -1831,7 +1994,7 @@ Script* GameScript::CacheScript(ieResRef ResRef, bool AIScript)
 	Script *newScript = (Script *) BcsCache.GetResource(ResRef);
 	if ( newScript ) {
 		if (InDebug&ID_REFERENCE) {
-			Log(DEBUG, "GameScript", "Caching %s for the %d. time\n", ResRef, BcsCache.RefCount(ResRef) );
+			LogDebug("GameScript", "Caching %s for the %d. time\n", ResRef, BcsCache.RefCount(ResRef) );
 		}
 		return newScript;
 	}
@@ -1847,9 +2010,10 @@ Script* GameScript::CacheScript(ieResRef ResRef, bool AIScript)
 		return NULL;
 	}
 	newScript = new Script( );
-	BcsCache.SetAt( ResRef, (void *) newScript );
+	// the compiled blocks take about as much as the source
+	BcsCache.SetAt( ResRef, (void *) newScript, stream->Size() );
 	if (InDebug&ID_REFERENCE) {
-		Log(DEBUG, "GameScript", "Caching %s for the %d. time", ResRef, BcsCache.RefCount(ResRef) );
+		LogDebug("GameScript", "Caching %s for the %d. time", ResRef, BcsCache.RefCount(ResRef) );
 	}
 
 	while (true) {
@@ -1891,6 +2055,17 @@ static void ParseString(const char*& src, char* tmp)
 		src++;
 }
 
+// scripts are cached and dialogs compile their triggers without one, so all of them share the pool
+static std::set<std::string> ScriptStrings;
+
+const char* InternScriptString(const char* str)
+{
+	if (!str[0]) {
+		return "";
+	}
+	return ScriptStrings.insert(str).first->c_str();
+}
+
 static Object* DecodeObject(const char* line)
 {
 	int i;
@@ -1914,12 +2089,14 @@ static Object* DecodeObject(const char* line)
 	}
 	if (*line == '"')
 		line++; //Skip "
-	ParseString( line, oB->objectName );
+	char name[65];
+	ParseString( line, name );
 	// HACK for iwd2 AddExperiencePartyCR
-	if (!stricmp(oB->objectName, "0.0.0.0 ")) {
-		strlcpy(oB->objectName, "", sizeof(oB->objectName));
-		Log(DEBUG, "asda", "overriding: +%s+", oB->objectName);
+	if (!stricmp(name, "0.0.0.0 ")) {
+		name[0] = 0;
+		LogDebug("asda", "overriding: +%s+", name);
 	}
+	oB->objectName = InternScriptString(name);
 	if (*line == '"')
 		line++; //Skip " (the same as above)
 	//this seems to be needed too
@@ -1950,20 +2127,23 @@ static Trigger* ReadTrigger(DataStream* stream)
 	}
 	stream->ReadLine( line, 1024 );
 	Trigger* tR = new Trigger();
+	char string0[65] = "", string1[65] = "";
 	//this exists only in PST?
 	if (HasTriggerPoint) {
-		sscanf( line, "%hu %d %d %d %d [%hd,%hd] \"%[^\"]\" \"%[^\"]\" OB",
+		sscanf( line, "%hu %d %d %d %d [%hd,%hd] \"%64[^\"]\" \"%64[^\"]\" OB",
 			&tR->triggerID, &tR->int0Parameter, &tR->flags,
 			&tR->int1Parameter, &tR->int2Parameter, &tR->pointParameter.x,
-			&tR->pointParameter.y, tR->string0Parameter, tR->string1Parameter );
+			&tR->pointParameter.y, string0, string1 );
 	} else {
-		sscanf( line, "%hu %d %d %d %d \"%[^\"]\" \"%[^\"]\" OB",
+		sscanf( line, "%hu %d %d %d %d \"%64[^\"]\" \"%64[^\"]\" OB",
 			&tR->triggerID, &tR->int0Parameter, &tR->flags,
-			&tR->int1Parameter, &tR->int2Parameter, tR->string0Parameter,
-			tR->string1Parameter );
+			&tR->int1Parameter, &tR->int2Parameter, string0,
+			string1 );
 	}
-	strlwr(tR->string0Parameter);
-	strlwr(tR->string1Parameter);
+	strlwr(string0);
+	strlwr(string1);
+	tR->string0Parameter = InternScriptString(string0);
+	tR->string1Parameter = InternScriptString(string1);
 	tR->triggerID &= 0x3fff;
 	stream->ReadLine( line, 1024 );
 	tR->objectParameter = DecodeObject( line );
@@ -1974,6 +2154,7 @@ static Trigger* ReadTrigger(DataStream* stream)
 		delete tR;
 		return NULL;
 	}
+	ResolveVariables(tR);
 	return tR;
 }
 
@@ -1990,7 +2171,24 @@ static Condition* ReadCondition(DataStream* stream)
 		Trigger* tR = ReadTrigger( stream );
 		if (!tR)
 			break;
-		cO->triggers.push_back( tR );
+		cO->triggers.push_back( *tR );
+		tR->Release();
+	}
+	// the leading triggers free of side effects, the block is false if one of them is,
+	// and there is no need to evaluate it while the first event trigger among them isn't pending
+	for (size_t i = 0; i < cO->triggers.size(); i++) {
+		const Trigger &tR = cO->triggers[i];
+		if (tR.triggerID >= MAX_TRIGGERS) {
+			break;
+		}
+		if (triggerevents[tR.triggerID]) {
+			if (!cO->gate && !(tR.flags & TF_NEGATE)) {
+				cO->gate = triggerevents[tR.triggerID];
+			}
+		} else if (!(triggerflags[tR.triggerID] & TF_PURE)) {
+			break;
+		}
+		cO->pureTriggers++;
 	}
 	return cO;
 }
@@ -2005,6 +2203,9 @@ bool GameScript::Update(bool *continuing, bool *done)
 	if (!MySelf)
 		return false;
 
+	bool usePrepared = IsPrepared();
+	prepared = false;
+
 	if (!script)
 		return false;
 
@@ -2012,13 +2213,30 @@ bool GameScript::Update(bool *continuing, bool *done)
 		return false;
 	}
 
+	ScriptRunTimer timer(Name);
+	FrameStats::Count(FRAME_SCRIPTS);
 	bool continueExecution = false;
 	if (continuing) continueExecution = *continuing;
 
 	RandomNumValue=RNG_SFMT::getInstance()->rand();
 	for (size_t a = 0; a < script->responseBlocks.size(); a++) {
 		ResponseBlock* rB = script->responseBlocks[a];
-		if (rB->condition->Evaluate(MySelf)) {
+		//nothing to evaluate until its event comes
+		if (rB->condition->gate && !MySelf->MatchTrigger(rB->condition->gate)) {
+			continue;
+		}
+		if (usePrepared && failedBlocks[a]) {
+			continue;
+		}
+		bool result;
+		if (ScriptProfiler::IsEnabled()) {
+			unsigned __int64 start = ScriptProfiler::Now();
+			result = rB->condition->Evaluate(MySelf);
+			ScriptProfiler::AddBlock(Name, (unsigned int) a, ScriptProfiler::Now() - start, result);
+		} else {
+			result = rB->condition->Evaluate(MySelf);
+		}
+		if (result) {
 			//if this isn't a continue-d block, we have to clear the queue
 			//we cannot clear the queue and cannot execute the new block
 			//if we already have stuff on the queue!
@@ -2058,6 +2276,160 @@ bool GameScript::Update(bool *continuing, bool *done)
 	return continueExecution;
 }
 
+bool GameScript::IsPrepared() const
+{
+	return prepared && preparedChanges == Variables::GetChangeCount() &&
+		preparedArea == MySelf->GetCurrentArea();
+}
+
+void GameScript::PrepareBlocks()
+{
+	prepared = false;
+	if (!script || !(MySelf->GetInternalFlag()&IF_ACTIVE)) {
+		return;
+	}
+	size_t count = script->responseBlocks.size();
+	failedBlocks.assign(count, false);
+	for (size_t a = 0; a < count; a++) {
+		Condition *cO = script->responseBlocks[a]->condition;
+		if (!cO) continue;
+		for (unsigned int i = 0; i < cO->pureTriggers; i++) {
+			Trigger *tR = &cO->triggers[i];
+			if (!(triggerflags[tR->triggerID] & TF_CONCURRENT)) {
+				continue;
+			}
+			// not Trigger::Evaluate, the trigger cache is for the main thread
+			int ret = triggers[tR->triggerID]( MySelf, tR );
+			if (tR->flags & TF_NEGATE) {
+				ret = !ret;
+			}
+			if (!ret) {
+				failedBlocks[a] = true;
+				break;
+			}
+		}
+	}
+	preparedChanges = Variables::GetChangeCount();
+	preparedArea = MySelf->GetCurrentArea();
+	prepared = true;
+}
+
+// a few scripts aren't worth waking the workers for
+#define SCRIPT_BATCH_MIN 16
+#define SCRIPT_BATCH_CHUNK 8
+
+class ScriptWorker : public Thread {
+protected:
+	void Run();
+};
+
+static std::vector<ScriptWorker*> scriptWorkers;
+static bool scriptWorkersStarted = false;
+static bool scriptWorkersStopping = false;
+static Mutex scriptLock;
+static ConditionVariable scriptWakeup;
+static ConditionVariable scriptDone;
+// the batch being prepared, the workers take from scriptNext on
+static const std::vector<GameScript*> *scriptBatch = NULL;
+static size_t scriptNext = 0;
+static size_t scriptFinished = 0;
+
+// call with scriptLock held, it is dropped while preparing
+static void RunScriptBatch()
+{
+	while (scriptBatch && scriptNext < scriptBatch->size()) {
+		const std::vector<GameScript*> &batch = *scriptBatch;
+		size_t first = scriptNext;
+		size_t last = std::min(first + SCRIPT_BATCH_CHUNK, batch.size());
+		scriptNext = last;
+		scriptLock.Unlock();
+		for (size_t i = first; i < last; i++) {
+			batch[i]->PrepareBlocks();
+		}
+		scriptLock.Lock();
+		scriptFinished += last - first;
+		if (scriptFinished == batch.size()) {
+			scriptDone.Signal();
+		}
+	}
+}
+
+void ScriptWorker::Run()
+{
+	MutexLock l(scriptLock);
+	while (true) {
+		while (!scriptWorkersStopping && (!scriptBatch || scriptNext >= scriptBatch->size())) {
+			scriptWakeup.Wait(scriptLock);
+		}
+		if (scriptWorkersStopping) {
+			return;
+		}
+		RunScriptBatch();
+	}
+}
+
+static void StartScriptWorkers()
+{
+	scriptWorkersStarted = true;
+	int threads = core->ScriptThreads;
+	if (threads < 0) {
+		threads = Thread::GetProcessorCount() - 1;
+	}
+	for (int i = 0; i < threads; i++) {
+		ScriptWorker *worker = new ScriptWorker();
+		if (!worker->Start()) {
+			Log(ERROR, "GameScript", "Couldn't start script thread %d!", i);
+			delete worker;
+			break;
+		}
+		scriptWorkers.push_back(worker);
+	}
+	if (scriptWorkers.size()) {
+		Log(MESSAGE, "GameScript", "Started %d script threads.", (int) scriptWorkers.size());
+	}
+}
+
+static void StopScriptWorkers()
+{
+	{
+		MutexLock l(scriptLock);
+		scriptWorkersStopping = true;
+		scriptWakeup.Broadcast();
+	}
+	for (size_t i = 0; i < scriptWorkers.size(); i++) {
+		scriptWorkers[i]->Join();
+		delete scriptWorkers[i];
+	}
+	scriptWorkers.clear();
+	scriptWorkersStarted = false;
+	scriptWorkersStopping = false;
+}
+
+void PrepareScripts(const std::vector<GameScript*> &scripts)
+{
+	if (!core->ScriptThreads || scripts.size() < SCRIPT_BATCH_MIN) {
+		return;
+	}
+	if (!scriptWorkersStarted) {
+		StartScriptWorkers();
+	}
+	if (scriptWorkers.empty()) {
+		return;
+	}
+
+	MutexLock l(scriptLock);
+	scriptBatch = &scripts;
+	scriptNext = 0;
+	scriptFinished = 0;
+	scriptWakeup.Broadcast();
+	// this thread takes its share too
+	RunScriptBatch();
+	while (scriptFinished < scripts.size()) {
+		scriptDone.Wait(scriptLock);
+	}
+	scriptBatch = NULL;
+}
+
 //IE simply takes the first action's object for cutscene object
 //then adds these actions to its queue:
 // SetInterrupt(false), <actions>, SetInterrupt(true)
@@ -2191,6 +2563,7 @@ Response* GameScript::ReadResponse(DataStream* stream)
 				//just to find bugs faster
 				aC->int0Parameter = -1;
 			}
+			ResolveVariables(aC);
 		}
 		rE->actions.push_back( aC );
 		stream->ReadLine( line, 1024 );
@@ -2235,7 +2608,7 @@ bool Condition::Evaluate(Scriptable* Sender)
 	bool subresult = true;
 
 	for (size_t i = 0; i < triggers.size(); i++) {
-		Trigger* tR = triggers[i];
+		Trigger* tR = &triggers[i];
 		//do not evaluate triggers in an Or() block if one of them
 		//was already True()
 		if (!ORcount || !subresult) {
@@ -2271,6 +2644,58 @@ bool Condition::Evaluate(Scriptable* Sender)
 	return 1;
 }
 
+// what the result of a pure trigger depends on, the object is kept as it was written,
+// since it resolves to the same target for the same sender within a round
+struct TriggerCacheKey {
+	const Scriptable* sender;
+	int ints[3];
+	short pointX, pointY;
+	unsigned short triggerID;
+	bool hasObject;
+	const char* strings[2];
+	int objectFields[MAX_OBJECT_FIELDS];
+	int objectFilters[MAX_NESTING];
+	int objectRect[4];
+	const char* objectName;
+
+	bool operator<(const TriggerCacheKey& other) const
+	{
+		return memcmp(this, &other, sizeof(TriggerCacheKey)) < 0;
+	}
+};
+
+static void MakeTriggerCacheKey(TriggerCacheKey& key, const Scriptable* Sender, const Trigger* tR)
+{
+	// the padding is compared too
+	memset(&key, 0, sizeof(TriggerCacheKey));
+	key.sender = Sender;
+	key.ints[0] = tR->int0Parameter;
+	key.ints[1] = tR->int1Parameter;
+	key.ints[2] = tR->int2Parameter;
+	key.pointX = tR->pointParameter.x;
+	key.pointY = tR->pointParameter.y;
+	key.triggerID = tR->triggerID;
+	// interned, so equal strings have equal pointers
+	key.strings[0] = tR->string0Parameter;
+	key.strings[1] = tR->string1Parameter;
+	const Object* oB = tR->objectParameter;
+	if (oB) {
+		key.hasObject = true;
+		memcpy(key.objectFields, oB->objectFields, sizeof(key.objectFields));
+		memcpy(key.objectFilters, oB->objectFilters, sizeof(key.objectFilters));
+		memcpy(key.objectRect, oB->objectRect, sizeof(key.objectRect));
+		key.objectName = oB->objectName;
+	}
+}
+
+typedef std::map<TriggerCacheKey, int> TriggerCache;
+static TriggerCache triggerCache;
+
+void ResetTriggerCache()
+{
+	triggerCache.clear();
+}
+
 /* this may return more than a boolean, in case of Or(x) */
 int Trigger::Evaluate(Scriptable* Sender)
 {
@@ -2279,21 +2704,47 @@ int Trigger::Evaluate(Scriptable* Sender)
 		return 0;
 	}
 	TriggerFunction func = triggers[triggerID];
-	const char *tmpstr=triggersTable->GetValue(triggerID);
-	if (!tmpstr) {
-		tmpstr=triggersTable->GetValue(triggerID|0x4000);
-	}
-	if (!func) {
-		triggers[triggerID] = GameScript::False;
-		Log(WARNING, "GameScript", "Unhandled trigger code: 0x%04x %s",
-			triggerID, tmpstr );
-		return 0;
-	}
-	if (InDebug&ID_TRIGGERS) {
+	// the name is only looked up for the messages
+	if (!func || (InDebug&ID_TRIGGERS)) {
+		const char *tmpstr=triggersTable->GetValue(triggerID);
+		if (!tmpstr) {
+			tmpstr=triggersTable->GetValue(triggerID|0x4000);
+		}
+		if (!func) {
+			triggers[triggerID] = GameScript::False;
+			Log(WARNING, "GameScript", "Unhandled trigger code: 0x%04x %s",
+				triggerID, tmpstr );
+			return 0;
+		}
 		Log(WARNING, "GameScript", "Executing trigger code: 0x%04x %s",
 				triggerID, tmpstr );
 	}
-	int ret = func( Sender, this );
+	int ret;
+	unsigned __int64 start = ScriptProfiler::IsEnabled() ? ScriptProfiler::Now() : 0;
+	if (core->TriggerCache && (triggerflags[triggerID] & TF_PURE)) {
+		TriggerCacheKey key;
+		MakeTriggerCacheKey(key, Sender, this);
+		TriggerCache::iterator it = triggerCache.find(key);
+		if (core->TriggerCache > 1) {
+			// the debug mode: evaluate anyway and compare
+			ret = func( Sender, this );
+			if (it != triggerCache.end() && it->second != ret) {
+				Log(WARNING, "GameScript", "Kept result %d of trigger 0x%04x %s for %s is now %d",
+					it->second, triggerID, triggersTable->GetValue(triggerID), Sender->GetScriptName(), ret);
+			}
+			triggerCache[key] = ret;
+		} else if (it != triggerCache.end()) {
+			ret = it->second;
+		} else {
+			ret = func( Sender, this );
+			triggerCache.insert(std::make_pair(key, ret));
+		}
+	} else {
+		ret = func( Sender, this );
+	}
+	if (start) {
+		ScriptProfiler::AddTrigger(triggerID, ScriptProfiler::Now() - start, ret != 0);
+	}
 	if (flags & TF_NEGATE) {
 		return !ret;
 	}
@@ -2389,7 +2840,7 @@ void GameScript::ExecuteAction(Scriptable* Sender, Action* aC)
 					Sender->GetScriptName(), scr->GetScriptName() );
 			}
 			scr->ReleaseCurrentAction();
-			scr->AddAction(ParamCopyNoOverride(aC));
+			scr->AddAction(OverrideCopy(aC));
 			if (!(actionflags[actionID] & AF_INSTANT)) {
 				assert(scr->GetNextAction());
 				// TODO: below was written before i added instants, this might be unnecessary now
@@ -2427,7 +2878,13 @@ void GameScript::ExecuteAction(Scriptable* Sender, Action* aC)
 				}
 			}
 		}
-		func( Sender, aC );
+		if (ScriptProfiler::IsEnabled()) {
+			unsigned __int64 start = ScriptProfiler::Now();
+			func( Sender, aC );
+			ScriptProfiler::AddAction((unsigned short) actionID, ScriptProfiler::Now() - start);
+		} else {
+			func( Sender, aC );
+		}
 	} else {
 		actions[actionID] = NoActionAtAll;
 		StringBuffer buffer;
@@ -2459,9 +2916,32 @@ void GameScript::ExecuteAction(Scriptable* Sender, Action* aC)
 	}
 }
 
-Trigger* GenerateTrigger(char* String)
+// dialogs, cutscenes and the effects generate their triggers and actions from
+// a limited set of strings, so each is compiled once and then cloned
+#define MAX_GENERATED_PROTOTYPES 1024
+
+typedef std::map<std::string, Trigger*> TriggerPrototypes;
+static TriggerPrototypes triggerPrototypes;
+typedef std::map<std::string, Action*> ActionPrototypes;
+static ActionPrototypes actionPrototypes;
+
+// the formatted strings (with global IDs or coordinates) don't repeat, so just start over when full
+static void ClearPrototypes()
+{
+	TriggerPrototypes::iterator tit;
+	for (tit = triggerPrototypes.begin(); tit != triggerPrototypes.end(); ++tit) {
+		tit->second->Release();
+	}
+	triggerPrototypes.clear();
+	ActionPrototypes::iterator ait;
+	for (ait = actionPrototypes.begin(); ait != actionPrototypes.end(); ++ait) {
+		ait->second->Release();
+	}
+	actionPrototypes.clear();
+}
+
+static Trigger* CompileTrigger(char* String)
 {
-	strlwr( String );
 	if (InDebug&ID_TRIGGERS) {
 		Log(WARNING, "GameScript", "Compiling:%s", String);
 	}
@@ -2486,7 +2966,25 @@ Trigger* GenerateTrigger(char* String)
 	return trigger;
 }
 
-Action* GenerateAction(const char* String)
+Trigger* GenerateTrigger(char* String)
+{
+	strlwr( String );
+	TriggerPrototypes::iterator it = triggerPrototypes.find(String);
+	if (it != triggerPrototypes.end()) {
+		return new Trigger(*it->second);
+	}
+	Trigger *trigger = CompileTrigger(String);
+	if (!trigger) {
+		return NULL;
+	}
+	if (triggerPrototypes.size() + actionPrototypes.size() >= MAX_GENERATED_PROTOTYPES) {
+		ClearPrototypes();
+	}
+	triggerPrototypes[String] = new Trigger(*trigger);
+	return trigger;
+}
+
+static Action* CompileAction(const char* String)
 {
 	Action* action = NULL;
 	char* actionString = strdup(String);
@@ -2526,6 +3024,26 @@ Action* GenerateAction(const char* String)
 	return action;
 }
 
+Action* GenerateAction(const char* String)
+{
+	ActionPrototypes::iterator it = actionPrototypes.find(String);
+	if (it != actionPrototypes.end()) {
+		return ParamCopy(it->second);
+	}
+	Action *action = CompileAction(String);
+	if (!action) {
+		return NULL;
+	}
+	if (triggerPrototypes.size() + actionPrototypes.size() >= MAX_GENERATED_PROTOTYPES) {
+		ClearPrototypes();
+	}
+	// the callers may change the parameters, so the prototype is a separate copy held by us
+	Action *prototype = ParamCopy(action);
+	prototype->IncRef();
+	actionPrototypes[String] = prototype;
+	return action;
+}
+
 Action* GenerateActionDirect(const char *String, Scriptable *object)
 {
 	Action* action = GenerateAction(String);
@@ -2542,7 +3060,7 @@ void Object::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "GameScript", buffer);
+	LogDebug("GameScript", buffer);
 }
 
 void Object::dump(StringBuffer& buffer) const
@@ -2587,7 +3105,7 @@ void Trigger::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "GameScript", buffer);
+	LogDebug("GameScript", buffer);
 }
 
 void Trigger::dump(StringBuffer& buffer) const
@@ -2610,7 +3128,7 @@ void Action::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "GameScript", buffer);
+	LogDebug("GameScript", buffer);
 }
 
 void Action::dump(StringBuffer& buffer) const
@@ -140,27 +140,47 @@ struct targettype {
 	unsigned int distance;
 };
 
-typedef std::list<targettype> targetlist;
+// enough for most object filters, more spill to the heap
+#define TARGETS_INLINE 16
 
+/* the matched scriptables sorted by distance, the instances are recycled,
+ * so resolving an object usually doesn't allocate */
 class GEM_EXPORT Targets {
 public:
+	// a position in the list
+	typedef unsigned int iterator;
+
 	Targets()
 	{
+		items = inlineItems;
+		count = 0;
+		capacity = TARGETS_INLINE;
 	}
 
 	~Targets()
 	{
-		Clear();
+		if (items != inlineItems) {
+			free(items);
+		}
 	}
+
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
 private:
-	targetlist objects;
+	targettype inlineItems[TARGETS_INLINE];
+	targettype *items;
+	unsigned int count;
+	unsigned int capacity;
+
+	Targets(const Targets&);
+	Targets& operator=(const Targets&);
 public:
 	int Count() const;
 	void dump() const;
-	targettype *RemoveTargetAt(targetlist::iterator &m);
-	const targettype *GetNextTarget(targetlist::iterator &m, int Type);
+	targettype *RemoveTargetAt(iterator &m);
+	const targettype *GetNextTarget(iterator &m, int Type);
 	const targettype *GetLastTarget(int Type);
-	const targettype *GetFirstTarget(targetlist::iterator &m, int Type);
+	const targettype *GetFirstTarget(iterator &m, int Type);
 	Scriptable *GetTarget(unsigned int index, int Type);
 	void AddTarget(Scriptable* target, unsigned int distance, int flags);
 	void Clear();
@@ -191,11 +211,30 @@ protected:
 	}
 };
 
+/** Returns the shared copy of a script string, the compiled triggers and
+ * objects keep only these, so the same names are stored once */
+GEM_EXPORT const char* InternScriptString(const char* str);
+
+//the scopes of the resolved variables
+#define VR_GLOBAL  0
+#define VR_LOCALS  1
+#define VR_MYAREA  2
+#define VR_KAPUTZ  3
+#define VR_AREA    4 //the area named by the context
+
+/** A context+name variable reference, resolved once when the script
+ * compiles, so the hot variable checks skip the parsing and hashing */
+struct VariableRef {
+	int scope;
+	ieResRef context;
+	const VariableKey* key;
+};
+
 class GEM_EXPORT Object : protected Canary {
 public:
 	Object()
 	{
-		memset( objectName, 0, 65 );
+		objectName = "";
 		memset( objectFields, 0, MAX_OBJECT_FIELDS * sizeof( int ) );
 		memset( objectFilters, 0, MAX_NESTING * sizeof( int ) );
 		memset( objectRect, 0, 4 * sizeof( int ) );
@@ -204,9 +243,12 @@ public:
 	int objectFields[MAX_OBJECT_FIELDS];
 	int objectFilters[MAX_NESTING];
 	int objectRect[4];
-	char objectName[65];
+	const char* objectName; // interned
 
 public:
+	static void *operator new(size_t size);
+	static void operator delete(void *obj, size_t size);
+
 	void dump() const;
 	void dump(StringBuffer&) const;
 	void Release()
@@ -223,13 +265,42 @@ public:
 		triggerID = 0;
 		flags = 0;
 		objectParameter = NULL;
-		memset(string0Parameter, 0, 65);
-		memset(string1Parameter, 0, 65);
+		string0Parameter = "";
+		string1Parameter = "";
+		string0Variable = NULL;
+		string1Variable = NULL;
 		int0Parameter = 0;
 		int1Parameter = 0;
 		int2Parameter = 0;
 		pointParameter.null();
 	}
+	// the conditions keep their triggers in place, so they have to be copied with their object
+	Trigger(const Trigger& other)
+		: Canary()
+	{
+		objectParameter = NULL;
+		*this = other;
+	}
+	Trigger& operator=(const Trigger& other)
+	{
+		if (this != &other) {
+			int0Parameter = other.int0Parameter;
+			int1Parameter = other.int1Parameter;
+			int2Parameter = other.int2Parameter;
+			flags = other.flags;
+			pointParameter = other.pointParameter;
+			triggerID = other.triggerID;
+			string0Parameter = other.string0Parameter;
+			string1Parameter = other.string1Parameter;
+			string0Variable = other.string0Variable;
+			string1Variable = other.string1Variable;
+			if (objectParameter) {
+				objectParameter->Release();
+			}
+			objectParameter = other.objectParameter ? new Object(*other.objectParameter) : NULL;
+		}
+		return *this;
+	}
 	~Trigger()
 	{
 		if (objectParameter) {
@@ -239,14 +310,18 @@ public:
 	}
 	int Evaluate(Scriptable* Sender);
 public:
-	unsigned short triggerID;
+	// packed, the strings are interned and shared
 	int int0Parameter;
-	int flags;
 	int int1Parameter;
 	int int2Parameter;
+	int flags;
 	Point pointParameter;
-	char string0Parameter[65];
-	char string1Parameter[65];
+	unsigned short triggerID;
+	const char* string0Parameter;
+	const char* string1Parameter;
+	// the strings resolved as variables, for the TF_MERGESTRINGS triggers
+	const VariableRef* string0Variable;
+	const VariableRef* string1Variable;
 	Object* objectParameter;
 
 public:
@@ -261,22 +336,19 @@ public:
 
 class GEM_EXPORT Condition : protected Canary {
 public:
-	~Condition()
-	{
-		for (size_t c = 0; c < triggers.size(); ++c) {
-			if (triggers[c]) {
-				triggers[c]->Release();
-				triggers[c] = NULL;
-			}
-		}
-	}
+	Condition() : gate(0), pureTriggers(0) {}
 	void Release()
 	{
 		delete this;
 	}
 	bool Evaluate(Scriptable* Sender);
 public:
-	std::vector<Trigger*> triggers;
+	// in one block, so the evaluation walks them in order
+	std::vector<Trigger> triggers;
+	// the TriggerEntry the condition can't be true without, 0 if there is none
+	unsigned short gate;
+	// the leading triggers free of side effects
+	unsigned short pureTriggers;
 };
 
 class GEM_EXPORT Action : protected Canary {
@@ -289,10 +361,13 @@ public:
 		objects[2] = NULL;
 		memset(string0Parameter, 0, 65);
 		memset(string1Parameter, 0, 65);
+		string0Variable = NULL;
+		string1Variable = NULL;
 		int0Parameter = 0;
 		pointParameter.null();
 		int1Parameter = 0;
 		int2Parameter = 0;
+		overrideCopy = NULL;
 		//changed now
 		if (autoFree) {
 			RefCount = 0; //refcount will be increased by each AddAction
@@ -308,6 +383,10 @@ public:
 				objects[c] = NULL;
 			}
 		}
+		if (overrideCopy) {
+			overrideCopy->Release();
+			overrideCopy = NULL;
+		}
 	}
 public:
 	unsigned short actionID;
@@ -318,9 +397,17 @@ public:
 	int int2Parameter;
 	char string0Parameter[65];
 	char string1Parameter[65];
+	// the strings resolved as variables, for the AF_MERGESTRINGS actions
+	const VariableRef* string0Variable;
+	const VariableRef* string1Variable;
+	// the copy ActionOverride handed out last, see OverrideCopy
+	Action* overrideCopy;
 private:
 	int RefCount;
 public:
+	static void *operator new(size_t size);
+	static void operator delete(void *obj, size_t size);
+
 	int GetRef() {
 		return RefCount;
 	}
@@ -453,6 +540,8 @@ typedef int (* IDSFunction)(Actor *, int parameter);
 #define TF_CONDITION    1 //this isn't a trigger, just a condition (0x4000)
 #define TF_SAVED        2 //trigger is in svtriobj.ids
 #define TF_MERGESTRINGS 8 //same value as actions' mergestring
+#define TF_PURE         16 //no side effects, the result may be kept for the rest of the round
+#define TF_CONCURRENT   32 //only reads variables, the script workers may check it in advance
 
 struct TriggerLink {
 	const char* Name;
@@ -544,6 +633,10 @@ public:
 public:
 	bool Update(bool *continuing = NULL, bool *done = NULL);
 	void EvaluateAllBlocks();
+	/* checks the TF_CONCURRENT triggers among the pure ones leading each block, on a script worker */
+	void PrepareBlocks();
+	/* whether what PrepareBlocks found still holds */
+	bool IsPrepared() const;
 private: //Internal Functions
 	Script* CacheScript(ieResRef ResRef, bool AIScript);
 	ResponseBlock* ReadResponseBlock(DataStream* stream);
@@ -557,6 +650,11 @@ private: //Internal variables
 	Script* script;
 	unsigned int lastAction;
 	int scriptlevel;
+	// what PrepareBlocks found, good while no variable changes and MySelf stays in preparedArea
+	std::vector<bool> failedBlocks;
+	unsigned int preparedChanges;
+	Map *preparedArea;
+	bool prepared;
 public: //Script Functions
 	static int ID_Alignment(Actor *actor, int parameter);
 	static int ID_Allegiance(Actor *actor, int parameter);
@@ -1544,6 +1642,13 @@ Action* GenerateActionDirect(const char* String, Scriptable *object);
 GEM_EXPORT Trigger* GenerateTrigger(char* String);
 
 void InitializeIEScript();
+/** Forgets the kept trigger results, at each script round and whenever a variable changes */
+void ResetTriggerCache();
+/** The names the trigger and action codes are implemented under, NULL if they aren't */
+const char* GetTriggerLinkName(unsigned short triggerID);
+const char* GetActionLinkName(unsigned short actionID);
+/** Runs PrepareBlocks for the scripts on the ScriptThreads workers, the world holds still meanwhile */
+GEM_EXPORT void PrepareScripts(const std::vector<GameScript*> &scripts);
 
 }
 
@@ -30,8 +30,41 @@
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
 
+#include <algorithm>
+
 namespace GemRB {
 
+void NearestQueue::Clear()
+{
+	heap.clear();
+	added = 0;
+	heaped = false;
+}
+
+void NearestQueue::Add(Scriptable *target, unsigned int distance)
+{
+	Candidate c = { target, distance, added++ };
+	heap.push_back(c);
+	heaped = false;
+}
+
+Scriptable *NearestQueue::PopNearest(unsigned int &distance)
+{
+	if (heap.empty()) {
+		return NULL;
+	}
+	// heapifying is linear, so only the popped ones pay the log
+	if (!heaped) {
+		std::make_heap(heap.begin(), heap.end(), Farther());
+		heaped = true;
+	}
+	std::pop_heap(heap.begin(), heap.end(), Farther());
+	Candidate c = heap.back();
+	heap.pop_back();
+	distance = c.distance;
+	return c.target;
+}
+
 /* return a Targets object with a single scriptable inside */
 static inline Targets* ReturnScriptableAsTarget(Scriptable *sc)
 {
@@ -62,7 +95,7 @@ static inline bool DoObjectIDSCheck(Object *oC, Actor *ac, bool *filtered) {
 
 /* do object filtering: Myself, LastAttackerOf(Player1), etc */
 static inline Targets *DoObjectFiltering(Scriptable *Sender, Targets *tgts, Object *oC, int ga_flags) {
-	targetlist::iterator m;
+	Targets::iterator m;
 	const targettype *tt = tgts->GetFirstTarget(m, ST_ACTOR);
 	while (tt) {
 		Actor *target = (Actor *) tt->actor;
@@ -416,7 +449,7 @@ bool MatchActor(Scriptable *Sender, ieDword actorID, Object* oC)
 		// what we give them, they clear it and return a list :(
 		// so we have to search the whole list..
 		bool ret = false;
-		targetlist::iterator m;
+		Targets::iterator m;
 		const targettype *tt = tgts->GetFirstTarget(m, ST_ACTOR);
 		while (tt) {
 			Actor *actor = (Actor *) tt->actor;
@@ -467,7 +500,7 @@ int GetObjectLevelCount(Scriptable* Sender, Object* oC)
 	Targets* tgts = GetAllObjects(Sender->GetCurrentArea(), Sender, oC, 0);
 	int count = 0;
 	if (tgts) {
-		targetlist::iterator m;
+		Targets::iterator m;
 		const targettype *tt = tgts->GetFirstTarget(m, ST_ACTOR);
 		while (tt) {
 			count += ((Actor *) tt->actor)->GetXPLevel(true);
@@ -509,15 +542,18 @@ Targets *XthNearestDoor(Targets *parameters, unsigned int count)
 	if (count>i) {
 		return parameters;
 	}
+	static NearestQueue doors;
+	doors.Clear();
 	while (i--) {
 		Door *door = map->TMap->GetDoor(i);
-		unsigned int dist = Distance(origin->Pos, door->Pos);
-		parameters->AddTarget(door, dist, 0);
+		doors.Add(door, Distance(origin->Pos, door->Pos));
 	}
 
 	//now get the xth door
-	origin = parameters->GetTarget(count, ST_DOOR);
-	parameters->Clear();
+	unsigned int dist;
+	do {
+		origin = doors.PopNearest(dist);
+	} while (origin && count--);
 	if (!origin) {
 		return parameters;
 	}
@@ -555,7 +591,7 @@ Targets *XthNearestMyGroupOfType(Scriptable *origin, Targets *parameters, unsign
 		return parameters;
 	}
 
-	targetlist::iterator m;
+	Targets::iterator m;
 	const targettype *t = parameters->GetFirstTarget(m, ST_ACTOR);
 	if (!t) {
 		return parameters;
@@ -586,7 +622,7 @@ Targets *ClosestEnemySummoned(Scriptable *origin, Targets *parameters, int ga_fl
 		return parameters;
 	}
 
-	targetlist::iterator m;
+	Targets::iterator m;
 	const targettype *t = parameters->GetFirstTarget(m, ST_ACTOR);
 	if (!t) {
 		return parameters;
@@ -638,7 +674,7 @@ Targets *XthNearestEnemyOfType(Scriptable *origin, Targets *parameters, unsigned
 		return parameters;
 	}
 
-	targetlist::iterator m;
+	Targets::iterator m;
 	const targettype *t = parameters->GetFirstTarget(m, ST_ACTOR);
 	if (!t) {
 		return parameters;
@@ -694,26 +730,36 @@ Targets *XthNearestEnemyOf(Targets *parameters, int count, int ga_flags)
 		return parameters;
 	}
 	Map *map = origin->GetCurrentArea();
-	int i = map->GetActorCount(true);
 	ga_flags |= GA_NO_UNSCHEDULED|GA_NO_DEAD;
-	while (i--) {
-		Actor *ac = map->GetActor(i,true);
+	// the ones beyond the visual range fail DoObjectChecks anyway
+	unsigned int visualrange = origin->Modified[IE_VISUALRANGE];
+	const std::vector<Actor*> &near = map->GetActorsNear(origin->Pos, (visualrange + 1) * 16);
+	static NearestQueue enemies;
+	enemies.Clear();
+	for (size_t i = 0; i < near.size(); i++) {
+		Actor *ac = near[i];
 		if (ac == origin) continue;
+		if (type) { //origin is PC
+			if (ac->GetStat(IE_EA) < EA_EVILCUTOFF) continue;
+		} else {
+			if (ac->GetStat(IE_EA) > EA_GOODCUTOFF) continue;
+		}
+		if (!ac->ValidTarget(ga_flags)) continue;
+		enemies.Add(ac, SquaredMapDistance(origin, ac));
+	}
+
+	// only the nearest few need the visibility checks, the last one needs them all
+	int needed = count < 0 ? -1 : count + 1;
+	unsigned int dist;
+	Scriptable *sc;
+	while (needed && (sc = enemies.PopNearest(dist))) {
+		Actor *ac = (Actor *) sc;
 		int distance;
-		//int distance = Distance(ac, origin);
 		// TODO: if it turns out you need to check Sender here, beware you take the right distance!
 		// (n the original games, this is only used for NearestEnemyOf(Player1) in obsgolem.bcs)
 		if (!DoObjectChecks(map, origin, ac, distance)) continue;
-		if (type) { //origin is PC
-			if (ac->GetStat(IE_EA) >= EA_EVILCUTOFF) {
-				parameters->AddTarget(ac, distance, ga_flags);
-			}
-		}
-		else {
-			if (ac->GetStat(IE_EA) <= EA_GOODCUTOFF) {
-				parameters->AddTarget(ac, distance, ga_flags);
-			}
-		}
+		parameters->AddTarget(ac, distance, ga_flags);
+		needed--;
 	}
 	return XthNearestOf(parameters,count, ga_flags);
 }
@@ -28,6 +28,34 @@ namespace GemRB {
 
 class TileMap;
 
+/* the candidates of a k-nearest query: filled after the cheap checks, then
+ * taken nearest first, so the costly ones (visibility, LOS) only run until
+ * enough of them passed. Equal distances come in the order they were added. */
+class NearestQueue {
+public:
+	NearestQueue() : added(0), heaped(false) {}
+	void Clear();
+	void Add(Scriptable *target, unsigned int distance);
+	/* the nearest candidate left, NULL once they ran out */
+	Scriptable *PopNearest(unsigned int &distance);
+private:
+	struct Candidate {
+		Scriptable *target;
+		unsigned int distance;
+		unsigned int order;
+	};
+	struct Farther {
+		bool operator()(const Candidate &a, const Candidate &b) const
+		{
+			if (a.distance != b.distance) return a.distance > b.distance;
+			return a.order > b.order;
+		}
+	};
+	std::vector<Candidate> heap;
+	unsigned int added;
+	bool heaped;
+};
+
 GEM_EXPORT Targets* GetAllObjects(Map *map, Scriptable* Sender, Object* oC, int ga_flags);
 Targets* GetAllActors(Scriptable* Sender, int ga_flags);
 Scriptable* GetActorFromObject(Scriptable* Sender, Object* oC, int ga_flags = 0);
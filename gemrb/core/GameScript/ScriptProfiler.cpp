@@ -0,0 +1,183 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "GameScript/ScriptProfiler.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include "GameScript/GameScript.h"
+#include "System/StringBuffer.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <time.h>
+
+namespace GemRB {
+
+// the longest tables are cut, the rest is rarely of interest
+#define PROFILE_LINES 40
+
+struct ScriptTally {
+	unsigned long count, hits;
+	unsigned __int64 time;
+
+	ScriptTally() : count(0), hits(0), time(0) {}
+	void Add(unsigned __int64 t, bool hit)
+	{
+		count++;
+		if (hit) hits++;
+		time += t;
+	}
+};
+
+typedef std::map<std::string, ScriptTally> TallyMap;
+typedef std::pair<std::string, ScriptTally> TallyEntry;
+
+bool ScriptProfiler::enabled = false;
+
+// the scripts only run on the main thread
+static TallyMap scripts, blocks;
+static ScriptTally triggerTallies[MAX_TRIGGERS];
+static ScriptTally actionTallies[MAX_ACTIONS];
+
+void ScriptProfiler::SetEnabled(int enabled)
+{
+	ScriptProfiler::enabled = enabled != 0;
+}
+
+void ScriptProfiler::Reset()
+{
+	scripts.clear();
+	blocks.clear();
+	for (int i = 0; i < MAX_TRIGGERS; i++) {
+		triggerTallies[i] = ScriptTally();
+	}
+	for (int i = 0; i < MAX_ACTIONS; i++) {
+		actionTallies[i] = ScriptTally();
+	}
+}
+
+unsigned __int64 ScriptProfiler::Now()
+{
+#ifdef WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (unsigned __int64) (count.QuadPart / frequency.QuadPart * 1000000000 +
+		count.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned __int64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((unsigned __int64) tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
+#endif
+}
+
+void ScriptProfiler::AddScript(const char *name, unsigned __int64 time)
+{
+	scripts[name].Add(time, false);
+}
+
+void ScriptProfiler::AddBlock(const char *name, unsigned int block, unsigned __int64 time, bool result)
+{
+	char key[32];
+	snprintf(key, sizeof(key), "%s:%u", name, block);
+	blocks[key].Add(time, result);
+}
+
+void ScriptProfiler::AddTrigger(unsigned short id, unsigned __int64 time, bool result)
+{
+	if (id < MAX_TRIGGERS) {
+		triggerTallies[id].Add(time, result);
+	}
+}
+
+void ScriptProfiler::AddAction(unsigned short id, unsigned __int64 time)
+{
+	if (id < MAX_ACTIONS) {
+		actionTallies[id].Add(time, false);
+	}
+}
+
+static bool SlowerFirst(const TallyEntry &a, const TallyEntry &b)
+{
+	return a.second.time > b.second.time;
+}
+
+// hits is the true rate of the conditions and triggers, the scripts and actions have none
+static void PrintTallies(const char *title, const TallyMap &tallies, bool hits)
+{
+	std::vector<TallyEntry> sorted(tallies.begin(), tallies.end());
+	std::sort(sorted.begin(), sorted.end(), SlowerFirst);
+
+	StringBuffer buffer;
+	buffer.appendFormatted("%s (times in ms):\n", title);
+	buffer.appendFormatted("%-32s %10s %10s %10s", "", "count", "total", "each (us)");
+	if (hits) {
+		buffer.appendFormatted(" %8s", "true");
+	}
+	size_t lines = std::min(sorted.size(), (size_t) PROFILE_LINES);
+	for (size_t i = 0; i < lines; i++) {
+		const ScriptTally &tally = sorted[i].second;
+		buffer.appendFormatted("\n%-32.32s %10lu %10.2f %10.2f", sorted[i].first.c_str(), tally.count,
+			tally.time / 1000000.0, tally.time / 1000.0 / tally.count);
+		if (hits) {
+			buffer.appendFormatted(" %7.1f%%", tally.hits * 100.0 / tally.count);
+		}
+	}
+	if (lines < sorted.size()) {
+		buffer.appendFormatted("\n(%d more)", (int) (sorted.size() - lines));
+	}
+	Log(MESSAGE, "ScriptProfiler", buffer);
+}
+
+static void CollectOpcodes(const ScriptTally *tallies, int count, const char *(*GetName)(unsigned short), TallyMap &named)
+{
+	for (int i = 0; i < count; i++) {
+		if (!tallies[i].count) continue;
+		const char *name = GetName((unsigned short) i);
+		char key[40];
+		snprintf(key, sizeof(key), "%s (0x%04x)", name ? name : "?", i);
+		named[key] = tallies[i];
+	}
+}
+
+void ScriptProfiler::Dump()
+{
+	if (!enabled) {
+		Log(MESSAGE, "ScriptProfiler", "The script runs aren't being recorded.");
+	}
+	TallyMap triggerNames, actionNames;
+	CollectOpcodes(triggerTallies, MAX_TRIGGERS, GetTriggerLinkName, triggerNames);
+	CollectOpcodes(actionTallies, MAX_ACTIONS, GetActionLinkName, actionNames);
+
+	PrintTallies("Script runs by resource", scripts, false);
+	PrintTallies("Conditions by block", blocks, true);
+	PrintTallies("Triggers by opcode", triggerNames, true);
+	PrintTallies("Actions by opcode", actionNames, false);
+}
+
+}
@@ -0,0 +1,73 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef SCRIPTPROFILER_H
+#define SCRIPTPROFILER_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+namespace GemRB {
+
+/* Optional records of the script runs, to tell which script and block eats the time
+ * Each run of a script is counted under its resource, each condition evaluated under
+ * its block and each trigger and action call under its opcode, with the times spent
+ * and how often the conditions and triggers were true. The times are inclusive,
+ * a script run contains its blocks, a block its triggers.
+ */
+class GEM_EXPORT ScriptProfiler {
+public:
+	static void SetEnabled(int enabled);
+	static bool IsEnabled() { return enabled; }
+	static void Reset();
+	/** prints the tables to the log, the slowest first */
+	static void Dump();
+
+	static void AddScript(const char *name, unsigned __int64 time);
+	static void AddBlock(const char *name, unsigned int block, unsigned __int64 time, bool result);
+	static void AddTrigger(unsigned short id, unsigned __int64 time, bool result);
+	static void AddAction(unsigned short id, unsigned __int64 time);
+	/** nanoseconds since an arbitrary point */
+	static unsigned __int64 Now();
+private:
+	static bool enabled;
+};
+
+/* One script run, timed from its creation to its destruction
+ * does nothing unless the records are enabled.
+ */
+class ScriptRunTimer {
+public:
+	ScriptRunTimer(const char *name)
+		: name(name), start(ScriptProfiler::IsEnabled() ? ScriptProfiler::Now() : 0) {}
+	~ScriptRunTimer()
+	{
+		if (start) {
+			ScriptProfiler::AddScript(name, ScriptProfiler::Now() - start);
+		}
+	}
+private:
+	const char *name;
+	unsigned __int64 start;
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "GameScript/ScriptScheduler.h"
+
+#include "globals.h"
+#include "ie_stats.h"
+#include "win32def.h"
+
+#include "Game.h"
+#include "Interface.h"
+#include "Map.h"
+#include "Video.h"
+#include "GameScript/ScriptProfiler.h"
+#include "Scriptable/Actor.h"
+#include "System/StringBuffer.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace GemRB {
+
+// the longest table is cut, the rest is rarely of interest
+#define SCHEDULE_LINES 40
+// less than the 16 tick stagger of the rounds
+#define MAX_SCRIPT_DELAY 8
+
+struct ScriptFairness {
+	unsigned long rounds, deferred, waited;
+	ieDword maxWait;
+	char name[33];
+
+	ScriptFairness() : rounds(0), deferred(0), waited(0), maxWait(0) { name[0] = 0; }
+};
+
+typedef std::map<ieDword, ScriptFairness> FairnessMap;
+typedef std::pair<ieDword, ScriptFairness> FairnessEntry;
+
+unsigned __int64 ScriptScheduler::budget = 0;
+
+// the scripts only run on the main thread
+static FairnessMap fairness;
+static unsigned __int64 spent = 0;
+// rounds that were put off, seen last tick and so far this tick
+static unsigned int waiting = 0, waitingNow = 0;
+
+void ScriptScheduler::SetBudget(int budget)
+{
+	ScriptScheduler::budget = budget > 0 ? (unsigned __int64) budget * 1000 : 0;
+}
+
+void ScriptScheduler::BeginTick()
+{
+	spent = 0;
+	waiting = waitingNow;
+	waitingNow = 0;
+}
+
+// the party, what the player looks at and the fights can't wait
+static bool IsUrgent(const Actor *actor)
+{
+	if (actor->InParty || actor->LastTarget) {
+		return true;
+	}
+	const Game *game = core->GetGame();
+	if (game->AnyPCInCombat() && actor->GetStat(IE_EA) >= EA_EVILCUTOFF) {
+		return true;
+	}
+	if (actor->GetCurrentArea() != game->GetCurrentArea()) {
+		return false;
+	}
+	return core->GetVideoDriver()->GetViewport().PointInside(actor->Pos);
+}
+
+bool ScriptScheduler::Admit(Scriptable *scr)
+{
+	if (!budget || scr->Type != ST_ACTOR) {
+		return true;
+	}
+	Actor *actor = (Actor *) scr;
+	ScriptFairness &entry = fairness[actor->GetGlobalID()];
+
+	bool run;
+	if (actor->ScriptDelay >= MAX_SCRIPT_DELAY || IsUrgent(actor)) {
+		run = true;
+	} else if (actor->ScriptDelay) {
+		run = spent < budget;
+	} else {
+		// keep half of the budget for the rounds that already waited
+		run = spent < (waiting ? budget / 2 : budget);
+	}
+
+	if (!run) {
+		if (!actor->ScriptDelay) {
+			entry.deferred++;
+		}
+		actor->ScriptDelay++;
+		waitingNow++;
+		return false;
+	}
+
+	if (!entry.name[0]) {
+		strnuprcpy(entry.name, actor->GetScriptName(), sizeof(entry.name) - 1);
+	}
+	entry.rounds++;
+	entry.waited += actor->ScriptDelay;
+	entry.maxWait = std::max(entry.maxWait, actor->ScriptDelay);
+	actor->ScriptDelay = 0;
+	return true;
+}
+
+void ScriptScheduler::Spend(unsigned __int64 time)
+{
+	spent += time;
+}
+
+void ScriptScheduler::Reset()
+{
+	fairness.clear();
+}
+
+static bool MoreDeferredFirst(const FairnessEntry &a, const FairnessEntry &b)
+{
+	return a.second.deferred > b.second.deferred;
+}
+
+void ScriptScheduler::Dump()
+{
+	if (!budget) {
+		Log(MESSAGE, "ScriptScheduler", "The script rounds aren't budgeted.");
+	}
+	std::vector<FairnessEntry> sorted(fairness.begin(), fairness.end());
+	std::sort(sorted.begin(), sorted.end(), MoreDeferredFirst);
+
+	StringBuffer buffer;
+	buffer.appendFormatted("Script rounds by creature (waits in ticks), budget %.2f ms:\n", budget / 1000000.0);
+	buffer.appendFormatted("%-32s %8s %10s %10s %10s %8s", "", "id", "rounds", "deferred", "avg wait", "max");
+	size_t lines = std::min(sorted.size(), (size_t) SCHEDULE_LINES);
+	for (size_t i = 0; i < lines; i++) {
+		const ScriptFairness &entry = sorted[i].second;
+		buffer.appendFormatted("\n%-32.32s %8u %10lu %10lu %10.2f %8u", entry.name, (unsigned int) sorted[i].first,
+			entry.rounds, entry.deferred, entry.rounds ? (double) entry.waited / entry.rounds : 0.0,
+			(unsigned int) entry.maxWait);
+	}
+	if (lines < sorted.size()) {
+		buffer.appendFormatted("\n(%d more)", (int) (sorted.size() - lines));
+	}
+	Log(MESSAGE, "ScriptScheduler", buffer);
+}
+
+}
@@ -0,0 +1,61 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef SCRIPTSCHEDULER_H
+#define SCRIPTSCHEDULER_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+namespace GemRB {
+
+class Scriptable;
+
+/* Optional per tick budget for the creature script rounds
+ * Party members, creatures on screen and creatures in combat always run their
+ * rounds. The others run while the budget of the tick lasts, otherwise their
+ * round is put off to one of the next ticks, where the rounds that waited go
+ * before the fresh ones. A round never waits more than MAX_SCRIPT_DELAY ticks,
+ * so it is always done before the creature's next staggered round is due and
+ * the script period stays the same. Only the script rounds are budgeted, the
+ * actions still run every tick.
+ */
+class GEM_EXPORT ScriptScheduler {
+public:
+	/** microseconds of script rounds per tick, 0 runs every round (default) */
+	static void SetBudget(int budget);
+	static bool IsEnabled() { return budget != 0; }
+	/** called once per game tick, before the areas run their scripts */
+	static void BeginTick();
+	/** whether the due script round of scr may run now,
+	 * if not, it is retried from the next tick on */
+	static bool Admit(Scriptable *scr);
+	/** records the time the admitted round took */
+	static void Spend(unsigned __int64 time);
+	/** forgets the recorded rounds */
+	static void Reset();
+	/** prints how long the creatures waited for their rounds, the most deferred first */
+	static void Dump();
+private:
+	static unsigned __int64 budget;
+};
+
+}
+
+#endif
@@ -455,7 +455,7 @@ int GameScript::BitCheck(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if ( value & parameters->int0Parameter ) return 1;
 	}
@@ -466,7 +466,7 @@ int GameScript::BitCheckExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		ieDword tmp = (ieDword) parameters->int0Parameter ;
 		if ((value & tmp) == tmp) return 1;
@@ -480,7 +480,7 @@ int GameScript::BitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		HandleBitMod(value, parameters->int0Parameter, parameters->int1Parameter);
 		if (value!=0) return 1;
@@ -492,10 +492,10 @@ int GameScript::GlobalOrGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if ( value1 ) return 1;
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			if ( value2 ) return 1;
 		}
@@ -507,9 +507,9 @@ int GameScript::GlobalAndGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable( Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable( Sender, parameters->string0Variable, &valid );
 	if (valid && value1) {
-		ieDword value2 = CheckVariable( Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable( Sender, parameters->string1Variable, &valid );
 		if (valid && value2) return 1;
 	}
 	return 0;
@@ -519,9 +519,9 @@ int GameScript::GlobalBAndGlobal_Trigger(Scriptable* Sender, Trigger* parameters
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			if ((value1& value2 ) != 0) return 1;
 		}
@@ -533,9 +533,9 @@ int GameScript::GlobalBAndGlobalExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			if (( value1& value2 ) == value2) return 1;
 		}
@@ -547,9 +547,9 @@ int GameScript::GlobalBitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
-		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDword value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			HandleBitMod( value1, value2, parameters->int1Parameter);
 			if (value1!=0) return 1;
@@ -571,7 +571,7 @@ int GameScript::Xor(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if (( value ^ parameters->int0Parameter ) != 0) return 1;
 	}
@@ -633,7 +633,7 @@ int GameScript::Global(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if ( value == parameters->int0Parameter ) return 1;
 	}
@@ -650,7 +650,7 @@ int GameScript::GlobalLT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if ( value < parameters->int0Parameter ) return 1;
 	}
@@ -667,7 +667,7 @@ int GameScript::GlobalGT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
 		if ( value > parameters->int0Parameter ) return 1;
 	}
@@ -678,9 +678,9 @@ int GameScript::GlobalLTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
-		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			if ( value1 < value2 ) return 1;
 		}
@@ -692,9 +692,9 @@ int GameScript::GlobalGTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Variable, &valid );
 	if (valid) {
-		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
+		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Variable, &valid );
 		if (valid) {
 			if ( value1 > value2 ) return 1;
 		}
@@ -1697,7 +1697,7 @@ int GameScript::IsOverMe(Scriptable* Sender, Trigger* parameters)
 	Targets *tgts = GetAllObjects(Sender->GetCurrentArea(), Sender, parameters->objectParameter, GA_NO_DEAD|GA_NO_UNSCHEDULED);
 	int ret = 0;
 	if (tgts) {
-		targetlist::iterator m;
+		Targets::iterator m;
 		const targettype *tt = tgts->GetFirstTarget(m, ST_ACTOR);
 		while (tt) {
 			Actor *actor = (Actor *) tt->actor;
@@ -22,6 +22,7 @@
 
 #include "ControlAnimation.h"
 #include "Game.h"
+#include "InputRecord.h"
 #include "Interface.h"
 #include "Video.h"
 #include "GUI/GameControl.h"
@@ -29,6 +30,9 @@
 
 namespace GemRB {
 
+//the ticks run to catch up after a slow frame, anything more late is dropped
+#define MAX_CATCHUP_TICKS 4
+
 GlobalTimer::GlobalTimer(void)
 {
 	//AI_UPDATE_TIME: how many AI updates in a second
@@ -54,6 +58,7 @@ void GlobalTimer::Init()
 	shakeX = shakeY = 0;
 	shakeCounter = 0;
 	startTime = 0; //forcing an update
+	advancing = false;
 	speed = 0;
 	ClearAnimations();
 }
@@ -64,8 +69,9 @@ void GlobalTimer::Freeze()
 	unsigned long advance;
 
 	UpdateAnimations(true);
+	advancing = false;
 
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 	advance = thisTime - startTime;
 	if ( advance < interval) {
 		return;
@@ -141,20 +147,18 @@ void GlobalTimer::DoStep(int count)
 		}
 		if (shakeCounter) {
 			if (shakeX) {
-				x += RAND(0, shakeX-1);
+				x += VISUAL_RAND(0, shakeX-1);
 			}
 			if (shakeY) {
-				y += RAND(0, shakeY-1);
+				y += VISUAL_RAND(0, shakeY-1);
 			}
 		}
 	}
 	video->MoveViewportTo(x,y);
 }
 
-bool GlobalTimer::Update()
+int GlobalTimer::Update()
 {
-	Map *map;
-	Game *game;
 	GameControl* gc;
 	unsigned long thisTime;
 	unsigned long advance;
@@ -165,48 +169,70 @@ bool GlobalTimer::Update()
 
 	UpdateAnimations(false);
 
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 
 	if (!startTime) {
 		startTime = thisTime;
-		return false;
+		return 0;
 	}
 
 	advance = thisTime - startTime;
 	if ( advance < interval) {
-		return false;
+		return 0;
 	}
 	ieDword count = advance/interval;
 	DoStep(count);
 	DoFadeStep(count);
+	//the ticks keep a fixed pace, so slow frames don't slow the game down,
+	//up to a point: a long stall (loading, dragging the window) is skipped
+	if (count > MAX_CATCHUP_TICKS) {
+		count = MAX_CATCHUP_TICKS;
+		startTime = thisTime;
+	} else {
+		startTime += count*interval;
+	}
+	return count;
+}
+
+void GlobalTimer::Tick()
+{
+	advancing = false;
+	GameControl* gc = core->GetGameControl();
 	if (!gc) {
-		goto end;
+		return;
 	}
-	game = core->GetGame();
+	Game *game = core->GetGame();
 	if (!game) {
-		goto end;
+		return;
 	}
-	map = game->GetCurrentArea();
+	Map *map = game->GetCurrentArea();
 	if (!map) {
-		goto end;
+		return;
 	}
 	//do spell effects expire in dialogs?
 	//if yes, then we should remove this condition
 	if (!(gc->GetDialogueFlags()&DF_IN_DIALOG) ) {
 		map->UpdateFog();
 		map->UpdateEffects();
-		if (thisTime) {
-			//this measures in-world time (affected by effects, actions, etc)
-			game->AdvanceTime(1);
-		}
+		//this measures in-world time (affected by effects, actions, etc)
+		game->AdvanceTime(1);
+		advancing = true;
 	}
 	//this measures time spent in the game (including pauses)
-	if (thisTime) {
-		game->RealTime++;
+	game->RealTime++;
+}
+
+unsigned long GlobalTimer::GetTickOffset() const
+{
+	if (!advancing || !startTime) {
+		return 0;
 	}
-end:
-	startTime = thisTime;
-	return true;
+	unsigned long offset = InputRecord::GetTicks() - startTime;
+	//never ahead of the next tick
+	if (offset >= interval) {
+		offset = interval - 1;
+	}
+	return offset;
 }
 
 
@@ -275,7 +301,7 @@ void GlobalTimer::AddAnimation(ControlAnimation* ctlanim, unsigned long time)
 	AnimationRef* anim;
 	unsigned long thisTime;
 
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 	time += thisTime;
 
 	// if there are no free animation reference objects,
@@ -319,7 +345,7 @@ void GlobalTimer::RemoveAnimation(ControlAnimation* ctlanim)
 void GlobalTimer::UpdateAnimations(bool paused)
 {
 	unsigned long thisTime;
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 	while (animations.begin() + first_animation != animations.end()) {
 		AnimationRef* anim = animations[first_animation];
 		if (anim->ctlanim == NULL) {
@@ -42,6 +42,8 @@ class GEM_EXPORT GlobalTimer {
 private:
 	unsigned long startTime;
 	unsigned long interval;
+	//whether the last tick advanced the game time (for drawing in between)
+	bool advancing;
 
 	int fadeToCounter, fadeToMax;
 	int fadeFromCounter, fadeFromMax;
@@ -63,7 +65,11 @@ public:
 public:
 	void Init();
 	void Freeze();
-	bool Update();
+	/* returns the number of ticks due, each to be run with Tick */
+	int Update();
+	void Tick();
+	/* the milliseconds since the last tick that advanced the game time */
+	unsigned long GetTickOffset() const;
 	bool ViewportIsMoving();
 	void DoStep(int count);
 	void SetMoveViewPort(ieDword x, ieDword y, int spd, bool center);
@@ -24,22 +24,56 @@
 #include <cassert>
 #include <cstddef>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #if defined(sgi)
 #include <iostream>
 #endif
 
 namespace GemRB {
 
-template <class T>
+/** Reference count for objects that stay on one thread. */
+class PlainRefCount {
+public:
+	PlainRefCount() : count(0) {}
+	void increment() { ++count; }
+	size_t decrement() { return --count; }
+	size_t get() const { return count; }
+private:
+	size_t count;
+};
+
+/**
+ * Reference count for objects that are handed to or shared with other
+ * threads, the holders may then be copied and dropped on any of them.
+ */
+class AtomicRefCount {
+public:
+	AtomicRefCount() : count(0) {}
+#ifdef _MSC_VER
+	void increment() { _InterlockedIncrement(&count); }
+	size_t decrement() { return _InterlockedDecrement(&count); }
+#else
+	void increment() { __sync_add_and_fetch(&count, 1); }
+	size_t decrement() { return __sync_sub_and_fetch(&count, 1); }
+#endif
+	size_t get() const { return count; }
+private:
+	volatile long count;
+};
+
+template <class T, class Count = PlainRefCount>
 class Held {
 public:
-	Held() : RefCount(0) {}
-	void acquire() { ++RefCount; }
-	void release() { assert(RefCount && "Broken Held usage.");
-		if (!--RefCount) delete static_cast<T*>(this); }
-	size_t GetRefCount() { return RefCount; }
+	Held() {}
+	void acquire() { RefCount.increment(); }
+	void release() { assert(RefCount.get() && "Broken Held usage.");
+		if (!RefCount.decrement()) delete static_cast<T*>(this); }
+	size_t GetRefCount() { return RefCount.get(); }
 private:
-	size_t RefCount;
+	Count RefCount;
 };
 
 /**
@@ -83,6 +117,25 @@ public:
 		ptr = rhs.ptr;
 		return *this;
 	}
+#if __cplusplus >= 201103L
+	Holder(Holder&& rhs)
+		: ptr(rhs.ptr)
+	{
+		rhs.ptr = NULL;
+	}
+	Holder& operator=(Holder&& rhs)
+	{
+		swap(rhs);
+		return *this;
+	}
+#endif
+	/** Trades the objects without touching their refcounts. */
+	void swap(Holder& rhs)
+	{
+		T *tmp = ptr;
+		ptr = rhs.ptr;
+		rhs.ptr = tmp;
+	}
 	T& operator*() const { return *ptr; }
 	T* operator->() const { return ptr; }
 	bool operator!() const { return !ptr; }
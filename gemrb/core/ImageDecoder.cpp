@@ -0,0 +1,159 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "ImageDecoder.h"
+
+#include "win32def.h"
+
+#include "GameData.h"
+#include "PluginMgr.h"
+#include "ResourceDesc.h"
+#include "ResourceManager.h"
+
+namespace GemRB {
+
+class DecodeJob : public Job {
+public:
+	DecodeJob(const char *resref, DataStream *stream, const ResourceDesc *desc)
+		: Job("ImageDecoder::Decode"), resref(resref), stream(stream), desc(desc), failed(false) {}
+	// only when it never ran
+	~DecodeJob() { delete stream; }
+
+	std::string resref;
+	DataStream *stream;
+	const ResourceDesc *desc;
+	Holder<ImageMgr> image;
+	// reported by whoever takes the image, only the main thread's records reach the message window
+	bool failed;
+protected:
+	void Run();
+};
+
+// parses and unpacks the image, the importer takes the stream
+void DecodeJob::Run()
+{
+	ImageMgr *decoded = static_cast<ImageMgr *>(desc->Create(stream));
+	stream = NULL;
+	if (decoded && !decoded->Decode()) {
+		failed = true;
+		delete decoded;
+		decoded = NULL;
+	}
+	image = decoded;
+}
+
+ImageDecoder::ImageDecoder(JobSystem *jobs)
+	: jobs(jobs)
+{
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	MutexLock l(lock);
+	Drop(decoding.begin(), decoding.end());
+}
+
+void ImageDecoder::Prefetch(const char *resref, const ResourceManager &manager)
+{
+	if (!jobs->GetThreadCount()) {
+		return;
+	}
+	JobKey key(&manager, resref);
+	{
+		MutexLock l(lock);
+		if (decoding.count(key)) {
+			return;
+		}
+	}
+
+	// find the file the way the manager would for an ImageMgr
+	const std::vector<ResourceDesc> &types = PluginMgr::Get()->GetResourceDesc(&ImageMgr::ID);
+	DataStream *stream = NULL;
+	size_t j;
+	for (j = 0; j < types.size(); j++) {
+		stream = manager.GetResource(resref, types[j].GetKeyType(), true);
+		if (stream) {
+			break;
+		}
+	}
+	if (!stream) {
+		return;
+	}
+
+	DecodeJob *job = new DecodeJob(resref, stream, &types[j]);
+	MutexLock l(lock);
+	decoding[key] = job;
+	jobs->Submit(job);
+}
+
+Sprite2D *ImageDecoder::GetSprite2D(const char *resref, const ResourceManager &manager)
+{
+	Holder<ImageMgr> image;
+	Holder<DecodeJob> job;
+	{
+		MutexLock l(lock);
+		JobMap::iterator it = decoding.find(JobKey(&manager, resref));
+		if (it != decoding.end()) {
+			job = it->second;
+			decoding.erase(it);
+		}
+	}
+
+	if (job) {
+		// runs it right here, unless a worker has taken it already
+		jobs->Wait(job.get());
+		if (job->failed) {
+			Log(ERROR, "ImageDecoder", "Cannot decode %s.", job->resref.c_str());
+		}
+		image.swap(job->image);
+	} else {
+		ResourceHolder<ImageMgr> loaded(resref, manager, true);
+		image.swap(loaded);
+	}
+
+	if (!image) {
+		return NULL;
+	}
+	return image->GetSprite2D();
+}
+
+void ImageDecoder::Forget(const ResourceManager &manager)
+{
+	MutexLock l(lock);
+	JobMap::iterator first = decoding.lower_bound(JobKey(&manager, std::string()));
+	JobMap::iterator last = first;
+	while (last != decoding.end() && last->first.first == &manager) {
+		++last;
+	}
+	Drop(first, last);
+}
+
+// call with the lock held
+void ImageDecoder::Drop(JobMap::iterator first, JobMap::iterator last)
+{
+	for (JobMap::iterator it = first; it != last; ++it) {
+		// a running one still reads from the manager's files
+		if (!jobs->Cancel(it->second.get())) {
+			jobs->Wait(it->second.get());
+		}
+	}
+	decoding.erase(first, last);
+}
+
+}
@@ -0,0 +1,72 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include "exports.h"
+
+#include "Holder.h"
+#include "ImageMgr.h"
+#include "JobSystem.h"
+
+#include <map>
+#include <string>
+
+namespace GemRB {
+
+class DecodeJob;
+class ResourceManager;
+
+/* Decodes images as background jobs
+ * images can be queued ahead of need (the save previews and portraits of the
+ * save browser) and are then parsed and unpacked in the background. The file
+ * is looked up when queued and the sprite is made when the image is asked for,
+ * both on the main thread, so neither the resource manager nor the video
+ * driver is used by the jobs. Images that weren't queued are decoded on
+ * demand, as before.
+ */
+class GEM_EXPORT ImageDecoder {
+public:
+	/* without job threads, everything is decoded on demand by the caller */
+	ImageDecoder(JobSystem *jobs);
+	~ImageDecoder();
+
+	/* queues the decoding of the image; does nothing without job threads */
+	void Prefetch(const char *resref, const ResourceManager &manager);
+	/* returns the image as a sprite, taking the queued decoding if there
+	 * is one, waiting for it if it is running; NULL if it can't be loaded */
+	Sprite2D *GetSprite2D(const char *resref, const ResourceManager &manager);
+	/* drops everything queued from the manager, before it goes away */
+	void Forget(const ResourceManager &manager);
+
+private:
+	typedef std::pair<const ResourceManager *, std::string> JobKey;
+	typedef std::map<JobKey, Holder<DecodeJob> > JobMap;
+
+	JobSystem *jobs;
+	Mutex lock;
+	JobMap decoding;
+
+	void Drop(JobMap::iterator first, JobMap::iterator last);
+};
+
+}
+
+#endif
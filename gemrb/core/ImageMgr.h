@@ -44,6 +44,11 @@ public:
 	virtual ~ImageMgr(void);
 	/** Returns a \ref Sprite2D containing the image. */
 	virtual Sprite2D* GetSprite2D() = 0;
+	/**
+	 * Reads and unpacks all the pixels, so GetSprite2D only has to make the
+	 * sprite. Unlike the rest, this may be called off the main thread.
+	 */
+	virtual bool Decode() { return true; }
 	virtual Image* GetImage();
 	virtual Bitmap* GetBitmap();
 	/**
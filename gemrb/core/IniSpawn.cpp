@@ -53,6 +53,7 @@ IniSpawn::IniSpawn(Map *owner)
 	eventspawns = NULL;
 	eventcount = 0;
 	last_spawndate = 0;
+	next_spawndate = 0;
 	//high detail level by default
 	detail_level = 2;
 	core->GetDictionary()->Lookup("Detail Level", detail_level);
@@ -872,12 +873,39 @@ void IniSpawn::ExitSpawn()
 	SpawnGroup(exitspawn);
 }
 
+//the intervals all run from the last spawn of any group, the events without
+//one are checked again once the game time moved on
+ieDword IniSpawn::NextSpawnDate(ieDword gametime) const
+{
+	ieDword next = (ieDword) -1;
+	for (int i = 0; i < eventcount; i++) {
+		if (!eventspawns[i].critters) {
+			continue;
+		}
+		ieDword date = gametime + 1;
+		if (eventspawns[i].interval) {
+			date = last_spawndate + eventspawns[i].interval + 1;
+		}
+		if (date < next) {
+			next = date;
+		}
+	}
+	return next;
+}
+
 //checks if a respawn event occurred
 void IniSpawn::CheckSpawn()
 {
+	//this comes with every drawn frame, but the events can only fire
+	//when the game time reaches them, so most calls stop here
+	ieDword gametime = core->GetGame()->GameTime;
+	if (gametime < next_spawndate) {
+		return;
+	}
 	for(int i=0;i<eventcount;i++) {
 		SpawnGroup(eventspawns[i]);
 	}
+	next_spawndate = NextSpawnDate(gametime);
 }
 
 
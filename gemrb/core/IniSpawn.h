@@ -159,6 +159,8 @@ private:
 	SpawnEntry enterspawn;
 	SpawnEntry exitspawn;
 	ieDword last_spawndate;
+	//no event can fire before this game time
+	ieDword next_spawndate;
 	int eventcount;
 	SpawnEntry *eventspawns;
 	ieDword detail_level;
@@ -170,6 +172,8 @@ private:
 	//spawns a single creature
 	void SpawnCreature(CritterEntry &critter) const;
 	void SpawnGroup(SpawnEntry &event);
+	//the first game time one of the events could fire
+	ieDword NextSpawnDate(ieDword gametime) const;
 	//gets the spec var operation code from a keyword
 	int GetDiffMode(const char *keyword) const;
 public:
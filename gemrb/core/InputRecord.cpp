@@ -0,0 +1,232 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "InputRecord.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include "Interface.h"
+#include "Video.h"
+#include "GUI/EventMgr.h"
+#include "GameScript/ScriptProfiler.h"
+#include "RNG/RNG_SFMT.h"
+#include "System/FileStream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace GemRB {
+
+#define INPUT_RECORD_VERSION 2
+
+struct InputEvent {
+	unsigned long frame;
+	char type;
+	int a, b, c, d;
+};
+
+int InputRecord::mode = InputRecord::MODE_OFF;
+
+// only the main thread handles the input
+static FileStream *record = NULL;
+static std::vector<InputEvent> events;
+static size_t nextEvent = 0;
+static unsigned long frame = 0;
+static unsigned long frameClock = 0;
+static unsigned int step = 33;
+static bool feeding = false;
+static unsigned __int64 replayStart = 0;
+static unsigned __int64 frameStart = 0, slowestFrame = 0;
+
+static void WriteLine(const char *line)
+{
+	record->Write(line, (unsigned int) strlen(line));
+}
+
+bool InputRecord::StartRecording(const char *path, unsigned int frameStep)
+{
+	record = new FileStream();
+	if (!record->Create(path)) {
+		Log(ERROR, "InputRecord", "Cannot create the input record: %s", path);
+		delete record;
+		record = NULL;
+		return false;
+	}
+	step = frameStep ? frameStep : 1;
+	frameClock = GetTickCount();
+	unsigned int seed = (unsigned int) frameClock;
+	RNG_SFMT::seedStreams(seed);
+	// a few corners still use the C library generator
+	srand(seed);
+
+	char line[80];
+	snprintf(line, sizeof(line), "GemRB input record %d\nseed %u\nclock %lu %u\n", INPUT_RECORD_VERSION, seed, frameClock, step);
+	WriteLine(line);
+	frame = 0;
+	mode = MODE_RECORD;
+	Log(MESSAGE, "InputRecord", "Recording the input to %s", path);
+	return true;
+}
+
+bool InputRecord::StartReplay(const char *path)
+{
+	FileStream *str = FileStream::OpenFile(path);
+	if (!str) {
+		Log(ERROR, "InputRecord", "Cannot open the input record: %s", path);
+		return false;
+	}
+
+	char line[80];
+	int version = 0;
+	unsigned int seed = 0;
+	bool valid = str->ReadLine(line, sizeof(line)) > 0 && sscanf(line, "GemRB input record %d", &version) == 1 &&
+		version == INPUT_RECORD_VERSION &&
+		str->ReadLine(line, sizeof(line)) > 0 && sscanf(line, "seed %u", &seed) == 1 &&
+		str->ReadLine(line, sizeof(line)) > 0 && sscanf(line, "clock %lu %u", &frameClock, &step) == 2;
+	if (!valid) {
+		Log(ERROR, "InputRecord", "Not a valid input record: %s", path);
+		delete str;
+		return false;
+	}
+
+	events.clear();
+	while (str->ReadLine(line, sizeof(line)) != -1) {
+		if (!line[0]) continue;
+		InputEvent event = { 0, 0, 0, 0, 0, 0 };
+		if (sscanf(line, "%lu %c %d %d %d %d", &event.frame, &event.type, &event.a, &event.b, &event.c, &event.d) < 3) {
+			Log(WARNING, "InputRecord", "Skipping a bad line: %s", line);
+			continue;
+		}
+		events.push_back(event);
+	}
+	delete str;
+
+	RNG_SFMT::seedStreams(seed);
+	srand(seed);
+	nextEvent = 0;
+	frame = 0;
+	slowestFrame = 0;
+	replayStart = frameStart = ScriptProfiler::Now();
+	mode = MODE_REPLAY;
+	Log(MESSAGE, "InputRecord", "Replaying %d input events from %s", (int) events.size(), path);
+	return true;
+}
+
+void InputRecord::Stop()
+{
+	if (mode == MODE_REPLAY) {
+		unsigned __int64 elapsed = ScriptProfiler::Now() - replayStart;
+		Log(MESSAGE, "InputRecord", "Replayed %lu frames in %.2f ms, %.3f ms per frame, the slowest took %.3f ms",
+			frame, elapsed / 1000000.0, frame ? elapsed / 1000000.0 / frame : 0.0, slowestFrame / 1000000.0);
+		events.clear();
+	}
+	delete record;
+	record = NULL;
+	mode = MODE_OFF;
+}
+
+void InputRecord::BeginFrame(EventMgr *evntmgr)
+{
+	if (mode == MODE_OFF) {
+		return;
+	}
+	frame++;
+	frameClock += step;
+	if (mode != MODE_REPLAY) {
+		return;
+	}
+
+	unsigned __int64 now = ScriptProfiler::Now();
+	if (now - frameStart > slowestFrame) {
+		slowestFrame = now - frameStart;
+	}
+	frameStart = now;
+
+	if (nextEvent == events.size()) {
+		Stop();
+		core->ExitGemRB();
+		return;
+	}
+
+	feeding = true;
+	for (; nextEvent < events.size() && events[nextEvent].frame <= frame; nextEvent++) {
+		const InputEvent &event = events[nextEvent];
+		switch (event.type) {
+			case INPUT_MOUSEMOVE:
+				core->GetVideoDriver()->SetCursorPos(event.a, event.b);
+				evntmgr->MouseMove((unsigned short) event.a, (unsigned short) event.b);
+				break;
+			case INPUT_MOUSEDOWN:
+				core->GetVideoDriver()->SetCursorPos(event.a, event.b);
+				evntmgr->MouseDown((unsigned short) event.a, (unsigned short) event.b,
+					(unsigned short) event.c, (unsigned short) event.d);
+				break;
+			case INPUT_MOUSEUP:
+				core->GetVideoDriver()->SetCursorPos(event.a, event.b);
+				evntmgr->MouseUp((unsigned short) event.a, (unsigned short) event.b,
+					(unsigned short) event.c, (unsigned short) event.d);
+				break;
+			case INPUT_MOUSEWHEEL:
+				evntmgr->MouseWheelScroll((short) event.a, (short) event.b);
+				break;
+			case INPUT_KEYPRESS:
+				evntmgr->KeyPress((unsigned char) event.a, (unsigned short) event.b);
+				break;
+			case INPUT_KEYRELEASE:
+				evntmgr->KeyRelease((unsigned char) event.a, (unsigned short) event.b);
+				break;
+			case INPUT_SPECIALKEY:
+				evntmgr->OnSpecialKeyPress((unsigned char) event.a);
+				break;
+			default:
+				Log(WARNING, "InputRecord", "Unknown event type: %c", event.type);
+				break;
+		}
+	}
+	feeding = false;
+}
+
+unsigned long InputRecord::GetTicks()
+{
+	if (mode == MODE_OFF) {
+		return GetTickCount();
+	}
+	return frameClock;
+}
+
+bool InputRecord::Accept(InputEventType type, int a, int b, int c, int d)
+{
+	switch (mode) {
+		case MODE_RECORD:
+			{
+				char line[80];
+				snprintf(line, sizeof(line), "%lu %c %d %d %d %d\n", frame, (char) type, a, b, c, d);
+				WriteLine(line);
+			}
+			return true;
+		case MODE_REPLAY:
+			return feeding;
+		default:
+			return true;
+	}
+}
+
+}
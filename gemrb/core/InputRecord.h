@@ -0,0 +1,69 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef INPUTRECORD_H
+#define INPUTRECORD_H
+
+#include "exports.h"
+
+namespace GemRB {
+
+class EventMgr;
+
+enum InputEventType {
+	INPUT_MOUSEMOVE = 'M',
+	INPUT_MOUSEDOWN = 'D',
+	INPUT_MOUSEUP = 'U',
+	INPUT_MOUSEWHEEL = 'W',
+	INPUT_KEYPRESS = 'K',
+	INPUT_KEYRELEASE = 'R',
+	INPUT_SPECIALKEY = 'S'
+};
+
+/* Records the input of a session or plays a recorded one back
+ * Every event reaching the EventMgr is written with the number of the frame
+ * it arrived in, along with the seed of the random number generator and the
+ * frame clock. While recording or replaying, the engine runs on that clock
+ * instead of the wall clock: each frame of Interface::Main advances it by the
+ * same step. A replay seeds the generator the same way, ignores the live
+ * input and hands each event to the EventMgr in its frame, so the session
+ * plays out identically, then quits and logs how long the frames took.
+ */
+class GEM_EXPORT InputRecord {
+public:
+	static bool StartRecording(const char *path, unsigned int frameStep);
+	static bool StartReplay(const char *path);
+	/** closes the record, a replay also reports its times */
+	static void Stop();
+	static bool IsActive() { return mode != MODE_OFF; }
+
+	/** called at the start of each frame, a replay feeds the events of the frame */
+	static void BeginFrame(EventMgr *evntmgr);
+	/** milliseconds for the timing of the game: the frame clock or GetTickCount */
+	static unsigned long GetTicks();
+	/** whether a live event may be handled, it is recorded on the way */
+	static bool Accept(InputEventType type, int a, int b = 0, int c = 0, int d = 0);
+private:
+	enum { MODE_OFF, MODE_RECORD, MODE_REPLAY };
+	static int mode;
+};
+
+}
+
+#endif
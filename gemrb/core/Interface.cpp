@@ -34,9 +34,13 @@
 #include "ActorMgr.h"
 #include "AmbientMgr.h"
 #include "AnimationMgr.h"
+#include "AnimationPreloader.h"
 #include "ArchiveImporter.h"
+#include "AreaWriter.h"
+#include "Benchmark.h"
 #include "Calendar.h"
 #include "DataFileMgr.h"
+#include "DecompressionService.h"
 #include "DialogHandler.h"
 #include "DialogMgr.h"
 #include "DisplayMessage.h"
@@ -44,35 +48,49 @@
 #include "EffectQueue.h"
 #include "Factory.h"
 #include "FontManager.h"
+#include "FrameStats.h"
 #include "Game.h"
 #include "GameData.h"
 #include "GlobalTimer.h"
+#include "ImageDecoder.h"
 #include "ImageMgr.h"
+#include "InputRecord.h"
 #include "ItemMgr.h"
+#include "JobSystem.h"
 #include "KeyMap.h"
 #include "MapMgr.h"
+#include "MemoryStats.h"
 #include "MoviePlayer.h"
 #include "MusicMgr.h"
+#include "ObjectPool.h"
 #include "Palette.h"
+#include "PathService.h"
+#include "Prefetcher.h"
 #include "PluginLoader.h"
 #include "PluginMgr.h"
 #include "Predicates.h"
 #include "ProjectileServer.h"
+#include "ResourceStats.h"
+#include "SaveExtractor.h"
 #include "SaveGameIterator.h"
 #include "SaveGameMgr.h"
 #include "ScriptEngine.h"
 #include "ScriptedAnimation.h"
 #include "SoundMgr.h"
 #include "SpellMgr.h"
+#include "StartupTimeline.h"
 #include "StoreMgr.h"
 #include "StringMgr.h"
 #include "SymbolMgr.h"
 #include "TileMap.h"
+#include "Tracer.h"
 #include "VEFObject.h"
 #include "Video.h"
 #include "WindowMgr.h"
 #include "WorldMapMgr.h"
+#include "GameScript/GSUtils.h"
 #include "GameScript/GameScript.h"
+#include "GameScript/ScriptScheduler.h"
 #include "GUI/Button.h"
 #include "GUI/Console.h"
 #include "GUI/EventMgr.h"
@@ -85,6 +103,7 @@
 #include "RNG/RNG_SFMT.h"
 #include "Scriptable/Container.h"
 #include "System/FileStream.h"
+#include "System/MemoryStream.h"
 #include "System/VFS.h"
 #include "System/StringBuffer.h"
 
@@ -92,6 +111,7 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <vector>
 
 namespace GemRB {
@@ -118,6 +138,10 @@ static ieWord IDT_SKILLPENALTY = 3;
 
 static int MagicBit = 0;
 
+//the highest TrimLevel asked for since the last frame
+static int pendingTrim = TRIM_NONE;
+static Mutex pendingTrimLock;
+
 Interface::Interface()
 {
 	Log(MESSAGE, "Core", "GemRB Core Version v%s Loading...", VERSION_GEMRB );
@@ -136,6 +160,14 @@ Interface::Interface()
 	}
 
 	projserv = NULL;
+	pathservice = NULL;
+	decompressor = NULL;
+	imagedecoder = NULL;
+	animpreloader = NULL;
+	prefetcher = NULL;
+	areawriter = NULL;
+	saveextractor = NULL;
+	jobsystem = NULL;
 	VideoDriverName = "sdl";
 	AudioDriverName = "openal";
 	vars = NULL;
@@ -183,6 +215,9 @@ Interface::Interface()
 	ConsolePopped = false;
 	CheatFlag = false;
 	FogOfWar = 1;
+	SmoothFog = false;
+	CompressTiles = false;
+	MaxFPS = 30;
 	QuitFlag = QF_NORMAL;
 	EventFlag = EF_CONTROL;
 #ifndef WIN32
@@ -257,6 +292,24 @@ Interface::Interface()
 	VersionOverride = ItemTypes = SlotTypes = Width = Height = 0;
 	MultipleQuickSaves = false;
 	MaxPartySize = 6;
+	PathfinderThreads = 0;
+	RenderThreads = 0;
+	JobThreads = 1;
+	ScriptThreads = 0;
+	SimulationLOD = false;
+	IncrementalRefresh = 0;
+	BenchmarkTicks = 0;
+	MessageLogLines = 100;
+	TriggerCache = 0;
+	PrefetchBudget = 32;
+	ItemCacheBudget = SpellCacheBudget = EffectCacheBudget = 0;
+	DialogCacheBudget = 1024;
+	CreatureCacheBudget = 256;
+	SoundCacheBudget = 16384;
+	FastResampler = 0;
+	loadProgress = 0;
+	loadProgressDrawn = 0;
+	TileBudget = 0;
 
 	//once GemRB own format is working well, this might be set to 0
 	SaveAsOriginal = 1;
@@ -332,8 +385,19 @@ Interface::~Interface(void)
 		AmbientMgr *ambim = AudioDriver->GetAmbientMgr();
 		if (ambim) ambim->deactivate();
 	}
+	// a save still being written needs the plugins
+	if (sgiterator) {
+		sgiterator->WaitForSave();
+	}
 	//destroy the highest objects in the hierarchy first!
 	delete game;
+	// after the game, the areas tell it when they go
+	delete pathservice;
+	delete prefetcher;
+	// the swapped out areas have to be in the cache before it is dropped
+	delete areawriter;
+	delete saveextractor;
+	delete decompressor;
 	delete calendar;
 	delete worldmap;
 	delete keymap;
@@ -373,6 +437,15 @@ Interface::~Interface(void)
 	itemtypedata.clear();
 
 	delete sgiterator;
+	// the save games let go of their images first
+	delete imagedecoder;
+	imagedecoder = NULL;
+	// before gamedata, the importers never taken free their palettes through it
+	delete animpreloader;
+	animpreloader = NULL;
+	// the services above cancel or wait for their jobs
+	delete jobsystem;
+	jobsystem = NULL;
 
 	if (Cursors) {
 		for (int i = 0; i < CursorCount; i++) {
@@ -967,6 +1040,11 @@ char *Interface::GetMusicPlaylist(int SongType) const {
 /** this is the main loop */
 void Interface::Main()
 {
+	if (BenchmarkTicks > 0) {
+		RunBenchmark();
+		return;
+	}
+
 	ieDword speed = 10;
 
 	vars->Lookup("Mouse Scroll Speed", speed);
@@ -985,18 +1063,36 @@ void Interface::Main()
 	timebase = GetTickCount();
 	double frames = 0.0;
 	Palette* palette = new Palette( ColorWhite, ColorBlack );
+
+	if (!ReplayInputPath.empty()) {
+		InputRecord::StartReplay(ReplayInputPath.c_str());
+	} else if (!RecordInputPath.empty()) {
+		InputRecord::StartRecording(RecordInputPath.c_str(), MaxFPS > 0 ? 1000 / MaxFPS : 33);
+	}
+	if (InputRecord::IsActive() && PathfinderThreads) {
+		Log(WARNING, "Core", "The paths found in the background arrive on varying ticks, set PathfinderThreads=0 for exact replays.");
+	}
+
+	int swapped;
 	do {
+		TRACE_SCOPE("Interface::Main");
+		InputRecord::BeginFrame(evntmgr);
 		//don't change script when quitting is pending
 
 		while (QuitFlag && QuitFlag != QF_KILL) {
 			HandleFlags();
 		}
-		//eventflags are processed only when there is a game
-		if (EventFlag && game) {
-			HandleEvents();
+		{
+			FrameTimer timer(FRAME_INPUT);
+			TRACE_SCOPE("Interface::HandleEvents");
+			//eventflags are processed only when there is a game
+			if (EventFlag && game) {
+				HandleEvents();
+			}
+			HandleGUIBehaviour();
 		}
-		HandleGUIBehaviour();
 
+		jobsystem->Update();
 		GameLoop();
 		DrawWindows(true);
 		if (DrawFPS) {
@@ -1009,15 +1105,73 @@ void Interface::Main()
 				swprintf(fpsstring, sizeof(fpsstring)/sizeof(fpsstring[0]), L"%.3f fps", frames);
 			}
 			video->DrawRect( fpsRgn, ColorBlack );
+			video->MarkDirty( fpsRgn );
 			fps->Print( fpsRgn, String(fpsstring), palette,
 					   IE_FONT_ALIGN_LEFT | IE_FONT_ALIGN_MIDDLE | IE_FONT_SINGLE_LINE );
 		}
+		FrameStats::Draw(fps, palette);
 		if (TickHook)
 			TickHook();
-	} while (video->SwapBuffers() == GEM_OK && !(QuitFlag&QF_KILL));
+		{
+			FrameTimer timer(FRAME_SWAP);
+			swapped = video->SwapBuffers();
+		}
+		FrameStats::EndFrame();
+		MemoryStats::Update();
+		int trim;
+		{
+			MutexLock l(pendingTrimLock);
+			trim = pendingTrim;
+			pendingTrim = TRIM_NONE;
+		}
+		if (trim != TRIM_NONE) {
+			TrimMemory(trim);
+		}
+	} while (swapped == GEM_OK && !(QuitFlag&QF_KILL));
+	InputRecord::Stop();
 	gamedata->FreePalette( palette );
 }
 
+void Interface::RequestTrimMemory(int level)
+{
+	MutexLock l(pendingTrimLock);
+	if (level > pendingTrim) {
+		pendingTrim = level;
+	}
+}
+
+unsigned long Interface::TrimMemory(int level)
+{
+	if (level <= TRIM_NONE) {
+		return 0;
+	}
+
+	unsigned long cached = gamedata->TrimCaches();
+	unsigned long sounds = AudioDriver ? AudioDriver->TrimMemory(level) : 0;
+
+	// the overlays rebuild their chunks and tiles on the next draw,
+	// so only the video counts tell how much went
+	unsigned long tiles = 0;
+	if (level >= TRIM_COMPLETE && game) {
+		unsigned long before = MemoryStats::GetBytes(MEM_SPRITES_SDL) + MemoryStats::GetBytes(MEM_SPRITES_GL) + MemoryStats::GetBytes(MEM_TILES);
+		for (unsigned int i = 0; i < game->GetLoadedMapCount(); i++) {
+			TileMap *tm = game->GetMap(i)->GetTileMap();
+			if (tm) {
+				tm->TrimOverlays();
+			}
+		}
+		unsigned long after = MemoryStats::GetBytes(MEM_SPRITES_SDL) + MemoryStats::GetBytes(MEM_SPRITES_GL) + MemoryStats::GetBytes(MEM_TILES);
+		if (before > after) {
+			tiles = before - after;
+		}
+	}
+
+	unsigned long total = cached + sounds + tiles;
+	Log(MESSAGE, "Core", "Trimmed %lu KB at level %d: %lu KB of cached game data, %lu KB of sounds, %lu KB of area graphics",
+		total / 1024, level, cached / 1024, sounds / 1024, tiles / 1024);
+	return total;
+}
+
 int Interface::ReadResRefTable(const ieResRef tablename, ieResRef *&data)
 {
 	int count = 0;
@@ -1253,6 +1407,13 @@ int Interface::LoadFonts()
 	return GEM_OK;
 }
 
+// logs the start of an init phase and times it in the startup timeline
+static void StartupPhase(const char *name)
+{
+	StartupTimeline::Phase(name);
+	Log(MESSAGE, "Core", "%s...", name);
+}
+
 int Interface::Init(InterfaceConfig* config)
 {
 	if (!config) {
@@ -1260,10 +1421,11 @@ int Interface::Init(InterfaceConfig* config)
 		return GEM_ERROR;
 	}
 
+	StartupTimeline::Begin();
 	plugin_flags = new Variables();
 	plugin_flags->SetType( GEM_VARIABLES_INT );
 
-	Log(MESSAGE, "Core", "Initializing the Event Manager...");
+	StartupPhase("Initializing the Event Manager");
 	evntmgr = new EventMgr();
 
 	lists = new Variables();
@@ -1281,6 +1443,7 @@ int Interface::Init(InterfaceConfig* config)
 	vars->SetType( GEM_VARIABLES_INT );
 	vars->ParseKey(true);
 
+	StartupPhase("Reading the configuration");
 	const char* value = NULL;
 #define CONFIG_INT(key, var) \
 		value = config->GetValueForKey(key); \
@@ -1288,13 +1451,20 @@ int Interface::Init(InterfaceConfig* config)
 			var ( atoi( value ) ); \
 		value = NULL;
 
+	CONFIG_INT("BenchmarkTicks", BenchmarkTicks = );
 	CONFIG_INT("Bpp", Bpp =);
 	vars->SetAt("BitsPerPixel", Bpp); //put into vars so that reading from game.ini wont overwrite
 	CONFIG_INT("CaseSensitive", CaseSensitive =);
+	CONFIG_INT("CompressTiles", CompressTiles = );
+	CONFIG_INT("CreatureCacheBudget", CreatureCacheBudget = );
+	CONFIG_INT("DialogCacheBudget", DialogCacheBudget = );
 	CONFIG_INT("DoubleClickDelay", evntmgr->SetDCDelay);
 	CONFIG_INT("DrawFPS", DrawFPS = );
+	CONFIG_INT("EffectCacheBudget", EffectCacheBudget = );
 	CONFIG_INT("EnableCheatKeys", EnableCheatKeys);
 	CONFIG_INT("EndianSwitch", DataStream::SetEndianSwitch);
+	CONFIG_INT("FastResampler", FastResampler = );
+	CONFIG_INT("FileReadAhead", FileStream::SetReadAhead);
 	CONFIG_INT("FogOfWar", FogOfWar = );
 	ieDword FullScreen = 0;
 	CONFIG_INT("FullScreen", FullScreen = );
@@ -1302,15 +1472,35 @@ int Interface::Init(InterfaceConfig* config)
 	CONFIG_INT("GUIEnhancements", GUIEnhancements = );
 	CONFIG_INT("TouchScrollAreas", TouchScrollAreas = );
 	CONFIG_INT("Height", Height = );
+	CONFIG_INT("IncrementalRefresh", IncrementalRefresh = );
+	CONFIG_INT("ItemCacheBudget", ItemCacheBudget = );
+	CONFIG_INT("JobThreads", JobThreads = );
 	CONFIG_INT("KeepCache", KeepCache = );
+	CONFIG_INT("LogQueueSize", SetLogQueueSize);
+	CONFIG_INT("MaxFPS", MaxFPS = );
 	CONFIG_INT("MaxPartySize", MaxPartySize = );
+	CONFIG_INT("MemoryStatsInterval", MemoryStats::SetLogInterval);
+	CONFIG_INT("MessageLogLines", MessageLogLines = );
 	vars->SetAt("MaxPartySize", MaxPartySize); // for simple GUIScript access
 	CONFIG_INT("MultipleQuickSaves", MultipleQuickSaves = );
+	CONFIG_INT("PathfinderThreads", PathfinderThreads = );
+	CONFIG_INT("PoolStats", PoolStats::SetEnabled);
+	CONFIG_INT("PrefetchBudget", PrefetchBudget = );
+	CONFIG_INT("RenderThreads", RenderThreads = );
 	CONFIG_INT("RepeatKeyDelay", evntmgr->SetRKDelay);
+	CONFIG_INT("ResourceStats", ResourceStats::SetEnabled);
 	CONFIG_INT("SaveAsOriginal", SaveAsOriginal = );
+	CONFIG_INT("ScriptBudget", ScriptScheduler::SetBudget);
 	CONFIG_INT("ScriptDebugMode", SetScriptDebugMode);
+	CONFIG_INT("ScriptThreads", ScriptThreads = );
+	CONFIG_INT("SimulationLOD", SimulationLOD = );
 	CONFIG_INT("SkipIntroVideos", SkipIntroVideos = );
+	CONFIG_INT("SmoothFog", SmoothFog = );
+	CONFIG_INT("SoundCacheBudget", SoundCacheBudget = );
+	CONFIG_INT("SpellCacheBudget", SpellCacheBudget = );
+	CONFIG_INT("TileBudget", TileBudget = );
 	CONFIG_INT("TooltipDelay", TooltipDelay = );
+	CONFIG_INT("TriggerCache", TriggerCache = );
 	CONFIG_INT("Width", Width = );
 	CONFIG_INT("IgnoreOriginalINI", IgnoreOriginalINI = );
 	CONFIG_INT("UseSoftKeyboard", UseSoftKeyboard = );
@@ -1393,6 +1583,11 @@ int Interface::Init(InterfaceConfig* config)
 	CONFIG_STRING("AudioDriver", AudioDriverName);
 	CONFIG_STRING("VideoDriver", VideoDriverName);
 	CONFIG_STRING("Encoding", Encoding);
+	CONFIG_STRING("RecordInput", RecordInputPath);
+	CONFIG_STRING("ReplayInput", ReplayInputPath);
+	CONFIG_STRING("BenchmarkSave", BenchmarkSave);
+	CONFIG_STRING("BenchmarkArea", BenchmarkArea);
+	CONFIG_STRING("StartupProfile", StartupProfile);
 #undef CONFIG_STRING
 
 	value = config->GetValueForKey("ModPath");
@@ -1445,7 +1640,7 @@ int Interface::Init(InterfaceConfig* config)
 	}
 	if (!KeepCache) DelTree((const char *) CachePath, false);
 
-	Log(MESSAGE, "Core", "Starting Plugin Manager...");
+	StartupPhase("Starting Plugin Manager");
 	PluginMgr *plugin = PluginMgr::Get();
 #if TARGET_OS_MAC
 	// search the bundle plugins first
@@ -1465,8 +1660,21 @@ int Interface::Init(InterfaceConfig* config)
 	}
 	plugin->RunInitializers();
 
+	jobsystem = new JobSystem(JobThreads < 0 ? Thread::GetProcessorCount() : JobThreads);
+	// before anything is read from the archives
+	decompressor = new DecompressionService(jobsystem);
+	imagedecoder = new ImageDecoder(jobsystem);
+	animpreloader = new AnimationPreloader(jobsystem);
+	saveextractor = new SaveExtractor(jobsystem);
+	// given in kilobytes
+	gamedata->SetCacheBudgets(ItemCacheBudget > 0 ? (unsigned long) ItemCacheBudget * 1024 : 0,
+		SpellCacheBudget > 0 ? (unsigned long) SpellCacheBudget * 1024 : 0,
+		EffectCacheBudget > 0 ? (unsigned long) EffectCacheBudget * 1024 : 0,
+		DialogCacheBudget > 0 ? (unsigned long) DialogCacheBudget * 1024 : 0,
+		CreatureCacheBudget > 0 ? (unsigned long) CreatureCacheBudget * 1024 : 0);
+
 	Log(MESSAGE, "Core", "GemRB Core Initialization...");
-	Log(MESSAGE, "Core", "Initializing Video Driver...");
+	StartupPhase("Initializing Video Driver");
 	video = ( Video * ) PluginMgr::Get()->GetDriver(&Video::ID, VideoDriverName.c_str());
 	if (!video) {
 		Log(FATAL, "Core", "No Video Driver Available.");
@@ -1494,7 +1702,7 @@ int Interface::Init(InterfaceConfig* config)
 	SetInfoTextColor(defcolor);
 
 	{
-		Log(MESSAGE, "Core", "Initializing Search Path...");
+		StartupPhase("Initializing Search Path");
 		if (!IsAvailable( PLUGIN_RESOURCE_DIRECTORY )) {
 			Log(FATAL, "Core", "no DirectoryImporter!");
 			return GEM_ERROR;
@@ -1566,7 +1774,7 @@ int Interface::Init(InterfaceConfig* config)
 	}
 
 	{
-		Log(MESSAGE, "Core", "Initializing KEY Importer...");
+		StartupPhase("Initializing KEY Importer");
 		char ChitinPath[_MAX_PATH];
 		PathJoin( ChitinPath, GamePath, "chitin.key", NULL );
 		if (!gamedata->AddSource(ChitinPath, "chitin.key", PLUGIN_RESOURCE_KEY)) {
@@ -1575,7 +1783,7 @@ int Interface::Init(InterfaceConfig* config)
 		}
 	}
 
-	Log(MESSAGE, "Core", "Initializing GUI Script Engine...");
+	StartupPhase("Initializing GUI Script Engine");
 	guiscript = PluginHolder<ScriptEngine>(IE_GUI_SCRIPT_CLASS_ID);
 	if (guiscript == NULL) {
 		Log(FATAL, "Core", "Missing GUI Script Engine.");
@@ -1599,7 +1807,7 @@ int Interface::Init(InterfaceConfig* config)
 	// Purposely add the font directory last since we will only ever need it at engine load time.
 	if (CustomFontPath[0]) gamedata->AddSource(CustomFontPath, "CustomFonts", PLUGIN_RESOURCE_DIRECTORY);
 
-	Log(MESSAGE, "Core", "Reading Game Options...");
+	StartupPhase("Reading Game Options");
 	if (!LoadGemRBINI()) {
 		Log(FATAL, "Core", "Cannot Load INI.");
 		return GEM_ERROR;
@@ -1638,24 +1846,37 @@ int Interface::Init(InterfaceConfig* config)
 	}
 	GameNameResRef[i] = 0;
 
-	Log(MESSAGE, "Core", "Reading Encoding Table...");
+	StartupPhase("Reading Encoding Table");
 	if (!LoadEncoding()) {
 		Log(ERROR, "Core", "Cannot Load Encoding.");
 	}
 
-	Log(MESSAGE, "Core", "Creating Projectile Server...");
+	StartupPhase("Creating Projectile Server");
 	projserv = new ProjectileServer();
 	if (!projserv->GetHighestProjectileNumber()) {
 		Log(ERROR, "Core", "No projectiles are available...");
 	}
 
-	Log(MESSAGE, "Core", "Checking for Dialogue Manager...");
+	if (PathfinderThreads) {
+		StartupPhase("Starting Path Service");
+		pathservice = new PathService(PathfinderThreads > 0 ? PathfinderThreads : 0);
+	}
+
+	if (PrefetchBudget > 0) {
+		StartupPhase("Starting Prefetcher");
+		prefetcher = new Prefetcher((unsigned long) PrefetchBudget * 1024 * 1024);
+	}
+
+	StartupPhase("Starting Area Writer");
+	areawriter = new AreaWriter();
+
+	StartupPhase("Checking for Dialogue Manager");
 	if (!IsAvailable( IE_TLK_CLASS_ID )) {
 		Log(FATAL, "Core", "No TLK Importer Available.");
 		return GEM_ERROR;
 	}
 	strings = PluginHolder<StringMgr>(IE_TLK_CLASS_ID);
-	Log(MESSAGE, "Core", "Loading Dialog.tlk file...");
+	StartupPhase("Loading Dialog.tlk file");
 	char strpath[_MAX_PATH];
 	PathJoin(strpath, GamePath, "dialog.tlk", NULL);
 	FileStream* fs = FileStream::OpenFile(strpath);
@@ -1668,7 +1889,7 @@ int Interface::Init(InterfaceConfig* config)
 	// does the language use an extra tlk?
 	if (strings->HasAltTLK()) {
 		strings2 = PluginHolder<StringMgr>(IE_TLK_CLASS_ID);
-		Log(MESSAGE, "Core", "Loading DialogF.tlk file...");
+		StartupPhase("Loading DialogF.tlk file");
 		char strpath[_MAX_PATH];
 		PathJoin(strpath, GamePath, "dialogf.tlk", NULL);
 		FileStream* fs = FileStream::OpenFile(strpath);
@@ -1682,7 +1903,7 @@ int Interface::Init(InterfaceConfig* config)
 	}
 
 	{
-		Log(MESSAGE, "Core", "Loading Palettes...");
+		StartupPhase("Loading Palettes");
 		ResourceHolder<ImageMgr> pal16im(Palette16);
 		if (pal16im)
 			pal16 = pal16im->GetImage();
@@ -1704,16 +1925,16 @@ int Interface::Init(InterfaceConfig* config)
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Initializing stock sounds...");
+	StartupPhase("Initializing stock sounds");
 	DSCount = ReadResRefTable ("defsound", DefSound);
 	if (DSCount == 0) {
 		Log(FATAL, "Core", "Cannot find defsound.2da.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Broadcasting Event Manager...");
+	StartupPhase("Broadcasting Event Manager");
 	video->SetEventMgr( evntmgr );
-	Log(MESSAGE, "Core", "Initializing Window Manager...");
+	StartupPhase("Initializing Window Manager");
 	windowmgr = PluginHolder<WindowMgr>(IE_CHU_CLASS_ID);
 	if (windowmgr == NULL) {
 		Log(FATAL, "Core", "Failed to load Window Manager.");
@@ -1728,7 +1949,7 @@ int Interface::Init(InterfaceConfig* config)
 
 	QuitFlag = QF_CHANGESCRIPT;
 
-	Log(MESSAGE, "Core", "Starting up the Sound Driver...");
+	StartupPhase("Starting up the Sound Driver");
 	AudioDriver = ( Audio * ) PluginMgr::Get()->GetDriver(&Audio::ID, AudioDriverName.c_str());
 	if (AudioDriver == NULL) {
 		Log(FATAL, "Core", "Failed to load sound driver.");
@@ -1739,7 +1960,7 @@ int Interface::Init(InterfaceConfig* config)
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Allocating SaveGameIterator...");
+	StartupPhase("Allocating SaveGameIterator");
 	sgiterator = new SaveGameIterator();
 	if (sgiterator == NULL) {
 		Log(FATAL, "Core", "Failed to allocate SaveGameIterator.");
@@ -1751,7 +1972,7 @@ int Interface::Init(InterfaceConfig* config)
 	vars->SetAt( "GUIEnhancements", (unsigned long)GUIEnhancements );
 	vars->SetAt( "TouchScrollAreas", (unsigned long)TouchScrollAreas );
 
-	Log(MESSAGE, "Core", "Initializing Token Dictionary...");
+	StartupPhase("Initializing Token Dictionary");
 	tokens = new Variables();
 	if (!tokens) {
 		Log(FATAL, "Core", "Failed to allocate Token dictionary.");
@@ -1759,14 +1980,14 @@ int Interface::Init(InterfaceConfig* config)
 	}
 	tokens->SetType( GEM_VARIABLES_STRING );
 
-	Log(MESSAGE, "Core", "Initializing Music Manager...");
+	StartupPhase("Initializing Music Manager");
 	music = PluginHolder<MusicMgr>(IE_MUS_CLASS_ID);
 	if (!music) {
 		Log(FATAL, "Core", "Failed to load Music Manager.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Loading music list...");
+	StartupPhase("Loading music list");
 	if (HasFeature( GF_HAS_SONGLIST )) {
 		ret = ReadMusicTable("songlist", 1);
 	} else {
@@ -1781,7 +2002,7 @@ int Interface::Init(InterfaceConfig* config)
 
 	int resdata = HasFeature( GF_RESDATA_INI );
 	if (resdata || HasFeature(GF_SOUNDS_INI) ) {
-		Log(MESSAGE, "Core", "Loading resource data File...");
+		StartupPhase("Loading resource data File");
 		INIresdata = PluginHolder<DataFileMgr>(IE_INI_CLASS_ID);
 		DataStream* ds = gamedata->GetResource(resdata? "resdata":"sounds", IE_INI_CLASS_ID);
 		if (!INIresdata->Open(ds)) {
@@ -1790,7 +2011,7 @@ int Interface::Init(InterfaceConfig* config)
 	}
 
 	if (HasFeature( GF_HAS_PARTY_INI )) {
-		Log(MESSAGE, "Core", "Loading precreated teams setup...");
+		StartupPhase("Loading precreated teams setup");
 		INIparty = PluginHolder<DataFileMgr>(IE_INI_CLASS_ID);
 		char tINIparty[_MAX_PATH];
 		PathJoin( tINIparty, GamePath, "Party.ini", NULL );
@@ -1805,7 +2026,7 @@ int Interface::Init(InterfaceConfig* config)
 	}
 
 	if (HasFeature( GF_HAS_BEASTS_INI )) {
-		Log(MESSAGE, "Core", "Loading beasts definition File...");
+		StartupPhase("Loading beasts definition File");
 		INIbeasts = PluginHolder<DataFileMgr>(IE_INI_CLASS_ID);
 		char tINIbeasts[_MAX_PATH];
 		PathJoin( tINIbeasts, GamePath, "beast.ini", NULL );
@@ -1815,7 +2036,7 @@ int Interface::Init(InterfaceConfig* config)
 			Log(WARNING, "Core", "Failed to load beast definitions.");
 		}
 
-		Log(MESSAGE, "Core", "Loading quests definition File...");
+		StartupPhase("Loading quests definition File");
 		INIquests = PluginHolder<DataFileMgr>(IE_INI_CLASS_ID);
 		char tINIquests[_MAX_PATH];
 		PathJoin( tINIquests, GamePath, "quests.ini", NULL );
@@ -1829,97 +2050,97 @@ int Interface::Init(InterfaceConfig* config)
 	calendar = NULL;
 	keymap = NULL;
 
-	Log(MESSAGE, "Core", "Bringing up the Global Timer...");
+	StartupPhase("Bringing up the Global Timer");
 	timer = new GlobalTimer();
 	if (!timer) {
 		Log(FATAL, "Core", "Failed to create global timer.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Initializing effects...");
+	StartupPhase("Initializing effects");
 	ret = Init_EffectQueue();
 	if (!ret) {
 		Log(FATAL, "Core", "Failed to initialize effects.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Initializing Inventory Management...");
+	StartupPhase("Initializing Inventory Management");
 	ret = InitItemTypes();
 	if (!ret) {
 		Log(FATAL, "Core", "Failed to initialize inventory.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Initializing string constants...");
+	StartupPhase("Initializing string constants");
 	displaymsg = new DisplayMessage();
 	if (!displaymsg) {
 		Log(FATAL, "Core", "Failed to initialize string constants.");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Initializing random treasure...");
+	StartupPhase("Initializing random treasure");
 	ret = ReadRandomItems();
 	if (!ret) {
 		Log(WARNING, "Core", "Failed to initialize random treasure.");
 	}
 
-	Log(MESSAGE, "Core", "Initializing ability tables...");
+	StartupPhase("Initializing ability tables");
 	ret = ReadAbilityTables();
 	if (!ret) {
 		Log(FATAL, "Core", "Failed to initialize ability tables...");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Reading reputation mod table...");
+	StartupPhase("Reading reputation mod table");
 	ret = ReadReputationModTable();
 	if (!ret) {
 		Log(WARNING, "Core", "Failed to read reputation mod table.");
 	}
 
 	if ( gamedata->Exists("WMAPLAY", IE_2DA_CLASS_ID) ) {
-		Log(MESSAGE, "Core", "Initializing area aliases...");
+		StartupPhase("Initializing area aliases");
 		ret = ReadAreaAliasTable( "WMAPLAY" );
 		if (!ret) {
 			Log(WARNING, "Core", "Failed to load area aliases...");
 		}
 	}
 
-	Log(MESSAGE, "Core", "Reading game time table...");
+	StartupPhase("Reading game time table");
 	ret = ReadGameTimeTable();
 	if (!ret) {
 		Log(FATAL, "Core", "Failed to read game time table...");
 		return GEM_ERROR;
 	}
 
-	Log(MESSAGE, "Core", "Reading special spells table...");
+	StartupPhase("Reading special spells table");
 	ret = ReadSpecialSpells();
 	if (!ret) {
 		Log(WARNING, "Core", "Failed to load special spells.");
 	}
 
 	ret = ReadDamageTypeTable();
-	Log(MESSAGE, "Core", "Reading damage type table...");
+	StartupPhase("Reading damage type table");
 	if (!ret) {
 		Log(WARNING, "Core", "Reading damage type table...");
 	}
 
-	Log(MESSAGE, "Core", "Reading modal states table...");
+	StartupPhase("Reading modal states table");
 	ret = ReadModalStates();
 	if (!ret) {
 		Log(ERROR, "Core", "Failed to modal states table...");
 	}
 
-	Log(MESSAGE, "Core", "Reading game script tables...");
+	StartupPhase("Reading game script tables");
 	InitializeIEScript();
 
-	Log(MESSAGE, "Core", "Initializing keymap tables...");
+	StartupPhase("Initializing keymap tables");
 	keymap = new KeyMap();
 	ret = keymap->InitializeKeyMap("keymap.ini", "keymap");
 	if (!ret) {
 		Log(WARNING, "Core", "Failed to initialize keymaps.");
 	}
 
-	Log(MESSAGE, "Core", "Setting up the Console...");
+	StartupPhase("Setting up the Console");
 	console = new Console(Region(0, 0, Width, 25));
 	Sprite2D* cursor = GetCursorSprite();
 	if (!cursor) {
@@ -1927,6 +2148,12 @@ int Interface::Init(InterfaceConfig* config)
 	} else
 		console->SetCursor (cursor);
 
+	StartupTimeline::End();
+	StartupTimeline::Dump();
+	if (!StartupProfile.empty()) {
+		StartupTimeline::WriteJSON(StartupProfile.c_str());
+	}
+
 	Log(MESSAGE, "Core", "Core Initialization Complete!");
 	return GEM_OK;
 }
@@ -1947,6 +2174,46 @@ ProjectileServer* Interface::GetProjectileServer() const
 	return projserv;
 }
 
+PathService* Interface::GetPathService() const
+{
+	return pathservice;
+}
+
+DecompressionService* Interface::GetDecompressionService() const
+{
+	return decompressor;
+}
+
+ImageDecoder* Interface::GetImageDecoder() const
+{
+	return imagedecoder;
+}
+
+AnimationPreloader* Interface::GetAnimationPreloader() const
+{
+	return animpreloader;
+}
+
+Prefetcher* Interface::GetPrefetcher() const
+{
+	return prefetcher;
+}
+
+AreaWriter* Interface::GetAreaWriter() const
+{
+	return areawriter;
+}
+
+SaveExtractor* Interface::GetSaveExtractor() const
+{
+	return saveextractor;
+}
+
+JobSystem* Interface::GetJobSystem() const
+{
+	return jobsystem;
+}
+
 Video* Interface::GetVideoDriver() const
 {
 	return video.get();
@@ -2619,12 +2886,18 @@ void Interface::RedrawAll()
 /** Loads a WindowPack (CHUI file) in the Window Manager */
 bool Interface::LoadWindowPack(const char* name)
 {
+	// packs are kept parsed by the window manager once they were opened
+	if (GetWindowMgr()->Select(name)) {
+		CopyResRef( WindowPack, name );
+		return true;
+	}
+
 	DataStream* stream = gamedata->GetResource( name, IE_CHU_CLASS_ID );
 	if (stream == NULL) {
 		Log(ERROR, "Interface", "Error: Cannot find %s.chu", name );
 		return false;
 	}
-	if (!GetWindowMgr()->Open(stream)) {
+	if (!GetWindowMgr()->Open(stream, name)) {
 		Log(ERROR, "Interface", "Error: Cannot Load %s.chu", name );
 		return false;
 	}
@@ -2956,23 +3229,119 @@ bool Interface::IsFreezed()
 
 void Interface::GameLoop(void)
 {
+	FrameTimer frameTimer(FRAME_GAME);
+	TRACE_SCOPE("Interface::GameLoop");
 	update_scripts = false;
 	GameControl *gc = GetGameControl();
 	if (gc) {
 		update_scripts = !(gc->GetDialogueFlags() & DF_FREEZE_SCRIPTS);
 	}
 
-	bool do_update = GSUpdate(update_scripts);
+	int ticks = GSUpdate(update_scripts);
 
 	if (game) {
 		if ( gc && (game->selected.size() > 0) ) {
 			gc->ChangeMap(GetFirstSelectedPC(true), false);
 		}
+	}
+	//the ticks a slow frame fell behind are caught up on here
+	while (ticks--) {
+		timer->Tick();
 		//in multi player (if we ever get to it), only the server must call this
-		if (do_update) {
+		if (game) {
 			// the game object will run the area scripts as well
 			game->UpdateScripts();
 		}
+		//the scripts may have paused the game or started to quit
+		if (QuitFlag != QF_NORMAL || !game) break;
+		gc = GetGameControl();
+		if (gc && (gc->GetDialogueFlags() & DF_FREEZE_SCRIPTS)) break;
+	}
+}
+
+bool Interface::EnterSavedGame(Holder<SaveGame> save)
+{
+	// straight into the game, without the start screens
+	QuitFlag = QF_NORMAL;
+	SetupLoadGame(save, 0);
+	QuitFlag |= QF_ENTERGAME;
+	while (QuitFlag && QuitFlag != QF_KILL) {
+		HandleFlags();
+	}
+	return game && GetGameControl();
+}
+
+unsigned int Interface::RunTicks(unsigned int count)
+{
+	unsigned int ticks = 0;
+	while (ticks < count) {
+		{
+			BenchmarkTimer benchmark(BENCH_WORLD);
+			timer->Tick();
+		}
+		game->UpdateScripts();
+		ticks++;
+		//a dialog or a quit would stall the ticks, nobody is there to answer
+		if (QuitFlag != QF_NORMAL || !game) break;
+		GameControl *gc = GetGameControl();
+		if (!gc || (gc->GetDialogueFlags() & DF_FREEZE_SCRIPTS)) break;
+	}
+	return ticks;
+}
+
+bool Interface::EnterBenchmarkGame()
+{
+	Holder<SaveGame> sg;
+	if (!BenchmarkSave.empty()) {
+		sg = sgiterator->GetSaveGame(BenchmarkSave.c_str());
+		if (!sg) {
+			Log(ERROR, "Benchmark", "No saved game called \"%s\".", BenchmarkSave.c_str());
+			return false;
+		}
+	}
+
+	if (!EnterSavedGame(sg)) {
+		Log(ERROR, "Benchmark", "Failed to enter the game.");
+		return false;
+	}
+
+	if (!BenchmarkArea.empty()) {
+		Map *map = game->GetMap(BenchmarkArea.c_str(), true);
+		if (!map) {
+			Log(ERROR, "Benchmark", "No area called %s.", BenchmarkArea.c_str());
+			return false;
+		}
+		Point center(map->GetWidth() * 8, map->GetHeight() * 6);
+		for (int i = 0; i < game->GetPartySize(false); i++) {
+			MoveBetweenAreasCore(game->GetPC(i, false), map->GetScriptName(), center, -1, true);
+		}
+	}
+	if (!game->GetPartySize(false)) {
+		Log(WARNING, "Benchmark", "There is no party, the actor scripts won't run.");
+	}
+	return true;
+}
+
+void Interface::RunBenchmark()
+{
+	if (!EnterBenchmarkGame()) {
+		return;
+	}
+
+	Log(MESSAGE, "Benchmark", "Running %d ticks in %s...", BenchmarkTicks, game->CurrentArea);
+	Benchmark::Reset();
+	Benchmark::SetEnabled(true);
+	unsigned __int64 start = ScriptProfiler::Now();
+	unsigned int ticks = RunTicks(BenchmarkTicks);
+	unsigned __int64 elapsed = ScriptProfiler::Now() - start;
+	Benchmark::SetEnabled(false);
+
+	if (ticks < (unsigned int) BenchmarkTicks) {
+		Log(WARNING, "Benchmark", "Stopped after %u ticks, the game paused or quit.", ticks);
+	}
+	Benchmark::Report(ticks, elapsed);
+	if (ScriptProfiler::IsEnabled()) {
+		ScriptProfiler::Dump();
 	}
 }
 
@@ -3038,6 +3407,8 @@ void Interface::HandleGUIBehaviour(void)
 
 void Interface::DrawWindows(bool allow_delete)
 {
+	FrameTimer frameTimer(FRAME_GUI);
+	TRACE_SCOPE("Interface::DrawWindows");
 	//here comes the REAL drawing of windows
 	static bool modalShield = false;
 	static size_t windowStackShield = 0;
@@ -3052,6 +3423,7 @@ void Interface::DrawWindows(bool allow_delete)
 				shieldColor.a = 0xff;
 			}
 			video->DrawRect( Region( 0, 0, Width, Height ), shieldColor );
+			video->MarkScreenDirty();
 			video->TakeBackgroundBuffer();
 			RedrawAll(); // wont actually have any effect until the modal window is dismissed.
 			modalShield = true;
@@ -3178,6 +3550,11 @@ void Interface::DrawTooltip ()
 	}
 	Region textr = Region( strx, y, strw, h );
 
+	// the caps hang off the sides of the background
+	int left = std::min(x - w1, strx);
+	int right = std::max(x + w + w2, strx + strw);
+	video->MarkDirty(Region(left, y, right - left, h));
+
 	// clip drawing to the control bounds, then restore after drawing
 	Region oldclip = video->GetScreenClip();
 	video->SetScreenClip(&clip);
@@ -3345,21 +3722,21 @@ int Interface::LoadSymbol(const char* ResRef)
 	}
 	if (ind != -1) {
 		symbols[ind] = s;
-		return ind;
+	} else {
+		symbols.push_back( s );
+		ind = ( int ) symbols.size() - 1;
 	}
-	symbols.push_back( s );
-	return ( int ) symbols.size() - 1;
+	symbolIndex[ResRef] = ind;
+	return ind;
 }
 /** Gets the index of a loaded Symbol Table, returns -1 on error */
 int Interface::GetSymbolIndex(const char* ResRef) const
 {
-	for (size_t i = 0; i < symbols.size(); i++) {
-		if (!symbols[i].sm)
-			continue;
-		if (strnicmp( symbols[i].ResRef, ResRef, 8 ) == 0)
-			return ( int ) i;
+	std::map<GemRB::ResRef, int>::const_iterator it = symbolIndex.find(ResRef);
+	if (it == symbolIndex.end()) {
+		return -1;
 	}
-	return -1;
+	return it->second;
 }
 /** Gets a Loaded Symbol Table by its index, returns NULL on error */
 Holder<SymbolMgr> Interface::GetSymbol(unsigned int index) const
@@ -3382,6 +3759,7 @@ bool Interface::DelSymbol(unsigned int index)
 		return false;
 	}
 	symbols[index].sm.release();
+	symbolIndex.erase(GemRB::ResRef(symbols[index].ResRef));
 	return true;
 }
 /** Plays a Movie */
@@ -3716,17 +4094,22 @@ bool Interface::InCutSceneMode() const
 }
 
 /** Updates the Game Script Engine State */
-bool Interface::GSUpdate(bool update_scripts)
+int Interface::GSUpdate(bool update_scripts)
 {
 	if(update_scripts) {
 		return timer->Update();
 	}
 	else {
 		timer->Freeze();
-		return false;
+		return 0;
 	}
 }
 
+unsigned long Interface::GetTickOffset() const
+{
+	return timer->GetTickOffset();
+}
+
 void Interface::QuitGame(int BackToMain)
 {
 	SetCutSceneMode(false);
@@ -3773,12 +4156,15 @@ void Interface::SetupLoadGame(Holder<SaveGame> sg, int ver_override)
 
 void Interface::LoadGame(SaveGame *sg, int ver_override)
 {
+	TRACE_SCOPE("Interface::LoadGame");
 	// This function has rather painful error handling,
 	// as it should swap all the objects or none at all
 	// and the loading can fail for various reasons
 
 	// Yes, it uses goto. Other ways seemed too awkward for me.
 
+	// the save may be the one still being written
+	sgiterator->WaitForSave();
 	gamedata->SaveAllStores();
 	strings->CloseAux();
 	tokens->RemoveAll(NULL); //clearing the token dictionary
@@ -3795,6 +4181,9 @@ void Interface::LoadGame(SaveGame *sg, int ver_override)
 	WorldMapArray* new_worldmap = NULL;
 
 	LoadProgress(10);
+	areawriter->Flush();
+	// nothing of the last save may land in the cache after this
+	saveextractor->Clear();
 	if (!KeepCache) DelTree((const char *) CachePath, true);
 	LoadProgress(15);
 
@@ -4404,6 +4793,14 @@ void Interface::RemoveFromCache(const ieResRef resref, SClass_ID ClassID)
 	char filename[_MAX_PATH];
 
 	PathJoinExt(filename, CachePath, resref, TypeExt(ClassID));
+	// or the pending write would bring it back
+	if (areawriter) {
+		areawriter->Wait(filename);
+	}
+	// nor the member of the loaded save
+	if (saveextractor) {
+		saveextractor->Forget(filename);
+	}
 	unlink ( filename);
 }
 
@@ -4471,15 +4868,38 @@ void Interface::DelTree(const char* Pt, bool onlysave)
 	} while (++dir);
 }
 
+// the load screen is drawn (and the events handled) at most this often
+#define LOAD_PROGRESS_INTERVAL 33
+
 void Interface::LoadProgress(int percent)
 {
+	loadProgress = percent;
 	vars->SetAt("Progress", percent);
 	RedrawControls("Progress", percent);
+	// the loaders report often, but each draw waits for the frame limiter
+	unsigned long time = GetTickCount();
+	if (percent < 100 && time - loadProgressDrawn < LOAD_PROGRESS_INTERVAL) {
+		return;
+	}
+	loadProgressDrawn = time;
 	RedrawAll();
 	DrawWindows();
 	video->SwapBuffers();
 }
 
+void Interface::LoadProgress(int from, int to, unsigned int done, unsigned int total)
+{
+	int percent = to;
+	if (done < total) {
+		percent = from + (int) ((to - from) * (long long) done / total);
+	}
+	// a finished load was at 100, anything else is the same one going on
+	if (loadProgress < 100 && percent < loadProgress) {
+		percent = loadProgress;
+	}
+	LoadProgress(percent);
+}
+
 void Interface::ReleaseDraggedItem()
 {
 	DraggedItem=NULL; //shouldn't free this
@@ -4859,9 +5279,7 @@ int Interface::GetMouseScrollSpeed() {
 
 ieStrRef Interface::GetRumour(const ieResRef dlgref)
 {
-	PluginHolder<DialogMgr> dm(IE_DLG_CLASS_ID);
-	dm->Open(gamedata->GetResource(dlgref, IE_DLG_CLASS_ID));
-	Dialog *dlg = dm->GetDialog();
+	Dialog *dlg = gamedata->GetDialog(dlgref);
 
 	if (!dlg) {
 		Log(ERROR, "Interface", "Cannot load dialog: %s", dlgref);
@@ -4874,7 +5292,7 @@ ieStrRef Interface::GetRumour(const ieResRef dlgref)
 	if (i>=0 ) {
 		ret = dlg->GetState( i )->StrRef;
 	}
-	delete dlg;
+	gamedata->FreeDialog(dlg, dlgref);
 	return ret;
 }
 
@@ -5028,28 +5446,31 @@ int Interface::ApplyEffectQueue(EffectQueue *fxqueue, Actor *actor, Scriptable *
 	return res;
 }
 
-Effect *Interface::GetEffect(const ieResRef resname, int level, const Point &p)
+bool Interface::GetEffect(const ieResRef resname, int level, const Point &p, Effect &fx)
 {
-	//Don't free this reference, it is cached!
-	Effect *effect = gamedata->GetEffect(resname);
+	//the cached template is shared by every user, only the copy is changed
+	const Effect *effect = gamedata->GetEffect(resname);
 	if (!effect) {
-		return NULL;
+		return false;
 	}
+	memcpy(&fx, effect, sizeof(Effect));
+	gamedata->FreeEffect(effect, resname);
 	if (!level) {
 		level = 1;
 	}
-	effect->Power = level;
-	effect->PosX=p.x;
-	effect->PosY=p.y;
-	return effect;
+	fx.Power = level;
+	fx.PosX=p.x;
+	fx.PosY=p.y;
+	return true;
 }
 
 // dealing with saved games
+//true if the file already holds exactly these bytes
 int Interface::SwapoutArea(Map *map)
 {
 	//refuse to save ambush areas, for example
 	if (map->AreaFlags & AF_NOSAVE) {
-		Log(DEBUG, "Core", "Not saving area %s",
+		LogDebug("Core", "Not saving area %s",
 			map->GetScriptName());
 		RemoveFromCache(map->GetScriptName(), IE_ARE_CLASS_ID);
 		return 0;
@@ -5061,12 +5482,31 @@ int Interface::SwapoutArea(Map *map)
 	}
 	int size = mm->GetStoredFileSize (map);
 	if (size > 0) {
-		//created streams are always autofree (close file on destruct)
-		//this one will be destructed when we return from here
-		FileStream str;
-
-		str.Create( map->GetScriptName(), IE_ARE_CLASS_ID );
-		int ret = mm->PutArea (&str, map);
+		//the area is put together in memory first, so an unchanged one
+		//can leave its cache file alone and the next save reuse its
+		//compressed copy; the file is written in the background
+		char path[_MAX_PATH];
+		PathJoinExt(path, CachePath, map->GetScriptName(), TypeExt(IE_ARE_CLASS_ID));
+		char *data = (char *) malloc(size);
+		MemoryStream *area = new MemoryStream(path, data, size);
+		int ret = mm->PutArea (area, map);
+		if (ret >= 0 && area->GetPos() != (unsigned long) size) {
+			//the size estimate was off, write it straight to the file
+			//after any older copy still being written
+			//created streams are always autofree (close file on destruct)
+			//this one will be destructed when we return from here
+			areawriter->Wait(path);
+			FileStream str;
+
+			str.Create( map->GetScriptName(), IE_ARE_CLASS_ID );
+			ret = mm->PutArea (&str, map);
+		} else if (ret >= 0 && areawriter->Queue(area)) {
+			//the writer has taken the area over
+			area = NULL;
+		} else if (ret >= 0 && !AreaWriter::Write(path, data, size)) {
+			ret = -1;
+		}
+		delete area;
 		if (ret <0) {
 			Log(WARNING, "Core", "Area removed: %s",
 				map->GetScriptName());
@@ -5185,19 +5625,13 @@ int Interface::WriteWorldMap(const char *folder)
 	return 0;
 }
 
-int Interface::CompressSave(const char *folder)
+//.tot and .toh should be saved last, because they are updated when an .are is saved
+bool Interface::GetSaveFiles(std::vector<std::string> &files)
 {
-	FileStream str;
-
-	str.Create( folder, GameNameResRef, IE_SAV_CLASS_ID );
 	DirectoryIterator dir(CachePath);
 	if (!dir) {
-		return -1;
+		return false;
 	}
-	PluginHolder<ArchiveImporter> ai(IE_SAV_CLASS_ID);
-	ai->CreateArchive( &str);
-
-	//.tot and .toh should be saved last, because they are updated when an .are is saved
 	int priority=2;
 	while(priority) {
 		do {
@@ -5209,11 +5643,7 @@ int Interface::CompressSave(const char *folder)
 			if (SavedExtension(name)==priority) {
 				char dtmp[_MAX_PATH];
 				dir.GetFullPath(dtmp);
-				FileStream fs;
-				if (!fs.Open(dtmp)) {
-					Log(ERROR, "Interface", "Failed to open \"%s\".", dtmp);
-				}
-				ai->AddToSaveGame(&str, &fs);
+				files.push_back(dtmp);
 			}
 		} while (++dir);
 		//reopen list for the second round
@@ -5222,6 +5652,54 @@ int Interface::CompressSave(const char *folder)
 			dir.Rewind();
 		}
 	}
+	return true;
+}
+
+int Interface::CompressSave(const char *folder)
+{
+	areawriter->Flush();
+	saveextractor->Flush();
+	FileStream str;
+
+	str.Create( folder, GameNameResRef, IE_SAV_CLASS_ID );
+	std::vector<std::string> files;
+	if (!GetSaveFiles(files)) {
+		return -1;
+	}
+	PluginHolder<ArchiveImporter> ai(IE_SAV_CLASS_ID);
+	ai->CreateArchive( &str);
+	ai->AddFilesToSaveGame(&str, files);
+	return 0;
+}
+
+int Interface::SnapshotSave(std::vector<ArchiveMember> &members)
+{
+	areawriter->Flush();
+	saveextractor->Flush();
+	std::vector<std::string> files;
+	if (!GetSaveFiles(files)) {
+		return -1;
+	}
+	time_t now = time(NULL);
+	for (size_t i = 0; i < files.size(); i++) {
+		FileStream fs;
+		if (!fs.Open(files[i].c_str())) {
+			Log(ERROR, "Core", "Failed to open \"%s\".", files[i].c_str());
+			continue;
+		}
+		ArchiveMember member;
+		unsigned long size = fs.Size();
+		char *data = (char *) malloc(size);
+		if (fs.Read(data, size) != (int) size) {
+			Log(ERROR, "Core", "Failed to read \"%s\".", files[i].c_str());
+			free(data);
+			continue;
+		}
+		member.stream = new MemoryStream(fs.originalfile, data, size);
+		member.mtime = file_mtime(files[i].c_str());
+		member.read = now;
+		members.push_back(member);
+	}
 	return 0;
 }
 
@@ -5403,6 +5881,11 @@ void Interface::RegisterOpcodes(int count, const EffectDesc *opcodes)
 	EffectQueue_RegisterOpcodes(count, opcodes);
 }
 
+void Interface::RegisterStatModifiers(int count, const EffectStatDesc *stats)
+{
+	EffectQueue_RegisterStatModifiers(count, stats);
+}
+
 void Interface::SetInfoTextColor(const Color &color)
 {
 	if (InfoTextPalette) {
@@ -55,6 +55,8 @@
 namespace GemRB {
 
 class Actor;
+class AnimationPreloader;
+struct ArchiveMember;
 class Audio;
 class CREItem;
 class Calendar;
@@ -62,9 +64,13 @@ class Console;
 class Container;
 class Control;
 class DataFileMgr;
+class DecompressionService;
+class ImageDecoder;
+class JobSystem;
 struct Effect;
 class EffectQueue;
 struct EffectDesc;
+struct EffectStatDesc;
 class EventMgr;
 class Factory;
 class Font;
@@ -79,10 +85,14 @@ class Label;
 class Map;
 class MusicMgr;
 class Palette;
+class PathService;
+class Prefetcher;
+class AreaWriter;
 class ProjectileServer;
 class Resource;
 class SPLExtHeader;
 class SaveGame;
+class SaveExtractor;
 class SaveGameIterator;
 class ScriptEngine;
 class ScriptedAnimation;
@@ -335,13 +345,30 @@ private:
 	Holder<Audio> AudioDriver;
 	std::string VideoDriverName;
 	std::string AudioDriverName;
+	std::string RecordInputPath;
+	std::string ReplayInputPath;
+	std::string BenchmarkSave;
+	std::string BenchmarkArea;
+	std::string StartupProfile;
+	int BenchmarkTicks;
 	ProjectileServer * projserv;
+	PathService * pathservice;
+	DecompressionService * decompressor;
+	ImageDecoder * imagedecoder;
+	AnimationPreloader * animpreloader;
+	Prefetcher * prefetcher;
+	AreaWriter * areawriter;
+	SaveExtractor * saveextractor;
+	JobSystem * jobsystem;
 
 	EventMgr * evntmgr;
 	Holder<WindowMgr> windowmgr;
 	Window* ModalWindow;
 	MODAL_SHADOW modalShadow;
 	char WindowPack[10];
+	//the load screen state, the last reported percent and when it was drawn
+	int loadProgress;
+	unsigned long loadProgressDrawn;
 	Holder<ScriptEngine> guiscript;
 	SaveGameIterator *sgiterator;
 	/** Windows Array */
@@ -352,6 +379,8 @@ private:
 	Variables * lists;
 	Holder<MusicMgr> music;
 	std::vector<Symbol> symbols;
+	// the symbol slots by resref, LoadSymbol is called with the same few all the time
+	std::map<ResRef, int> symbolIndex;
 	Holder<DataFileMgr> INIparty;
 	Holder<DataFileMgr> INIbeasts;
 	Holder<DataFileMgr> INIquests;
@@ -450,7 +479,29 @@ public:
 	bool IsAvailable(SClass_ID filetype) const;
 	const char * TypeExt(SClass_ID type) const;
 	ProjectileServer* GetProjectileServer() const;
+	/* the background pathfinder, NULL if it is disabled */
+	PathService* GetPathService() const;
+	/* expands the compressed archives into the cache */
+	DecompressionService* GetDecompressionService() const;
+	/* decodes queued images in the background */
+	ImageDecoder* GetImageDecoder() const;
+	/* reads the creature animations about to be needed in the background */
+	AnimationPreloader* GetAnimationPreloader() const;
+	/* reads the next area ahead, NULL if it is disabled */
+	Prefetcher* GetPrefetcher() const;
+	AreaWriter* GetAreaWriter() const;
+	/* expands the members of the loaded save into the cache as needed */
+	SaveExtractor* GetSaveExtractor() const;
+	/* runs the jobs of the subsystems on the shared worker threads */
+	JobSystem* GetJobSystem() const;
+	/* for the system low memory signals, safe from any thread,
+	 * the trim runs at the end of the next frame */
+	void RequestTrimMemory(int level);
+	/* frees what can be rebuilt at the given TrimLevel, returns the bytes */
+	unsigned long TrimMemory(int level);
 	Video * GetVideoDriver() const;
+	/* the VideoDriver option, "none" for the headless runs */
+	const char *GetVideoDriverName() const { return VideoDriverName.c_str(); }
 	/* create or change a custom string */
 	ieStrRef UpdateString(ieStrRef strref, const char *text) const;
 	/* returns a newly created c string */
@@ -553,8 +604,10 @@ public:
 	void SetCutSceneMode(bool active);
 	/** returns true if in cutscene mode */
 	bool InCutSceneMode() const;
-	/** Updates the Game Script Engine State */
-	bool GSUpdate(bool update_scripts);
+	/** Updates the Game Script Engine State, returns the number of ticks due */
+	int GSUpdate(bool update_scripts);
+	/** Returns how far the drawn frame is past the last game tick, in milliseconds */
+	unsigned long GetTickOffset() const;
 	/** Get the Party INI Interpreter */
 	DataFileMgr * GetPartyINI() const
 	{
@@ -601,6 +654,15 @@ public:
 	void QuitGame(int backtomain);
 	/** sets up load game */
 	void SetupLoadGame(Holder<SaveGame> save, int ver_override);
+	/** Loads the save (a new game if it is NULL) right away, without the
+	 * start screens; false if it didn't get into the game */
+	bool EnterSavedGame(Holder<SaveGame> save);
+	/** Runs game ticks as fast as possible, stops early when the game
+	 * pauses or quits; returns the number of ticks run */
+	unsigned int RunTicks(unsigned int count);
+	/** Loads the BenchmarkSave game and moves the party into BenchmarkArea,
+	 * without the start screens; used by the benchmarks */
+	bool EnterBenchmarkGame();
 	/** load saved game by index (-1 is default), ver_override is an optional parameter
 	to override the saved game's version */
 	void LoadGame(SaveGame *save, int ver_override);
@@ -634,12 +696,16 @@ public:
 	void DelTree(const char *path, bool onlysaved);
 	/*returns 0,1,2 based on how the file should be saved */
 	int SavedExtension(const char *filename);
+	/** lists the cache files a save game is made of, in the order they are archived */
+	bool GetSaveFiles(std::vector<std::string> &files);
 	/*returns true if the file should never be deleted accidentally */
 	bool ProtectedExtension(const char *filename);
 	/*returns true if the directory path isn't good as a Cache */
 	bool StupidityDetector(const char* Pt);
-	/*handles the load screen*/
+	/*handles the load screen, drawing it only every few frames*/
 	void LoadProgress(int percent);
+	/*the same for step done of total between from and to percent, never going back*/
+	void LoadProgress(int from, int to, unsigned int done, unsigned int total);
 
 	void DragItem(CREItem* item, const ieResRef Picture);
 	CREItem* GetDraggedItem() const { return DraggedItem; }
@@ -702,7 +768,8 @@ public:
 	/** applies an effect queue on the target */
 	int ApplyEffectQueue(EffectQueue *fxqueue, Actor *actor, Scriptable *caster);
 	int ApplyEffectQueue(EffectQueue *fxqueue, Actor *actor, Scriptable *caster, Point p);
-	Effect *GetEffect(const ieResRef resname, int level, const Point &p);
+	/** copies the EFF resource into fx, set up for the given level and position */
+	bool GetEffect(const ieResRef resname, int level, const Point &p, Effect &fx);
 	/** dumps an area object to the cache */
 	int SwapoutArea(Map *map);
 	/** saves (exports a character to the characters folder */
@@ -713,6 +780,8 @@ public:
 	int WriteWorldMap(const char *folder);
 	/** saves the .are and .sto files to the destination folder */
 	int CompressSave(const char *folder);
+	/** reads the files CompressSave would save into memory, to be archived later */
+	int SnapshotSave(std::vector<ArchiveMember> &members);
 	/** toggles the pause. returns either PAUSE_ON or PAUSE_OFF to reflect the script state after toggling. */
 	PauseSetting TogglePause();
 	/** returns true the passed pause setting was applied. false otherwise. */
@@ -721,6 +790,8 @@ public:
 	bool Autopause(ieDword flag, Scriptable *target);
 	/** registers engine opcodes */
 	void RegisterOpcodes(int count, const EffectDesc *opcodes);
+	/** registers the opcodes that only modify one stat */
+	void RegisterStatModifiers(int count, const EffectStatDesc *stats);
 	/** reads a list of resrefs into an array, returns array size */
 	int ReadResRefTable(const ieResRef tablename, ieResRef *&data);
 	/** frees the data */
@@ -781,6 +852,8 @@ private:
 	GameControl* StartGameControl();
 	/** Executes everything (non graphical) in the main game loop */
 	void GameLoop(void);
+	/** Loads the benchmark save and runs its ticks as fast as possible */
+	void RunBenchmark();
 	/** the internal (without cache) part of GetListFrom2DA */
 	ieDword *GetListFrom2DAInternal(const ieResRef resref);
 public:
@@ -811,12 +884,28 @@ public:
 	unsigned int TooltipDelay;
 	int IgnoreOriginalINI;
 	unsigned int FogOfWar;
+	bool SmoothFog;
+	bool CompressTiles;
+	int MaxFPS;
 	bool CaseSensitive, SkipIntroVideos, DrawFPS;
 	bool TouchScrollAreas, UseSoftKeyboard;
 	unsigned short NumFingScroll, NumFingKboard, NumFingInfo;
 	int MouseFeedback;
 	int GUIEnhancements;
 	int MaxPartySize;
+	int PathfinderThreads;
+	int RenderThreads;
+	int JobThreads;
+	int ScriptThreads;
+	bool SimulationLOD;
+	int IncrementalRefresh;
+	int MessageLogLines;
+	int TriggerCache;
+	int PrefetchBudget;
+	int ItemCacheBudget, SpellCacheBudget, EffectCacheBudget, DialogCacheBudget, CreatureCacheBudget;
+	int SoundCacheBudget;
+	int TileBudget;
+	int FastResampler;
 	bool KeepCache;
 	bool MultipleQuickSaves;
 	bool UseCorruptedHack;
@@ -178,6 +178,16 @@ if (config->Open(path) \
 #undef ATTEMPT_INIT
 done:
 	delete config;
+
+	// --Key=Value overrides the cfg, eg. --VideoDriver=none for headless runs
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--", 2) != 0) continue;
+		const char* equals = strchr(argv[i], '=');
+		if (!equals || equals == argv[i] + 2) continue;
+
+		std::string key(argv[i] + 2, equals - argv[i] - 2);
+		SetKeyValuePair(key.c_str(), equals + 1);
+	}
 }
 
 CFGConfig::~CFGConfig()
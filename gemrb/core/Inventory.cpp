@@ -38,6 +38,7 @@
 #include "Scriptable/Actor.h"
 #include "System/StringBuffer.h"
 
+#include <algorithm>
 #include <cstdio>
 
 namespace GemRB {
@@ -139,7 +140,6 @@ void Inventory::CopyFrom(const Actor *source)
 	Equipped = source->inventory.GetEquipped();
 	EquippedHeader = source->inventory.GetEquippedHeader();
 
-	Changed = true;
 	CalculateWeight();
 }
 
@@ -151,7 +151,7 @@ CREItem *Inventory::GetItem(unsigned int slot)
 	}
 	CREItem *item = Slots[slot];
 	Slots.erase(Slots.begin()+slot);
-	Changed = true;
+	SlotRemoved(item);
 	return item;
 }
 
@@ -159,20 +159,50 @@ void Inventory::AddItem(CREItem *item)
 {
 	if (!item) return; //invalid items get no slot
 	Slots.push_back(item);
+	SlotAdded(item);
+}
+
+void Inventory::AdjustWeight(const CREItem *item, int sign) const
+{
+	// unknown weights are added once CalculateWeight looks them up
+	if (item && item->Weight > 0) {
+		Weight += sign * item->Weight * ((item->Usages[0] && item->MaxStackAmount) ? item->Usages[0] : 1);
+	}
+}
+
+void Inventory::SlotAdded(CREItem *item)
+{
+	if (!item) {
+		return;
+	}
+	AdjustWeight(item, 1);
+	Recent.push_back(item);
+	Changed = true;
+}
+
+void Inventory::SlotRemoved(CREItem *item)
+{
+	if (!item) {
+		return;
+	}
+	AdjustWeight(item, -1);
+	std::vector<CREItem*>::iterator it = std::find(Recent.begin(), Recent.end(), item);
+	if (it != Recent.end()) {
+		Recent.erase(it);
+	}
 	Changed = true;
 }
 
+// weighs the new items and clears the acquired flag of the ones already
+// weighed, the total itself is kept up to date by the slot changes
 void Inventory::CalculateWeight() const
 {
 	if (!Changed) {
 		return;
 	}
-	Weight = 0;
-	for (size_t i = 0; i < Slots.size(); i++) {
-		CREItem *slot = Slots[i];
-		if (!slot) {
-			continue;
-		}
+	size_t keep = 0;
+	for (size_t i = 0; i < Recent.size(); i++) {
+		CREItem *slot = Recent[i];
 		if (slot->Weight == -1) {
 			Item *itm = gamedata->GetItem(slot->ItemResRef, true);
 			if (itm) {
@@ -188,13 +218,14 @@ void Inventory::CalculateWeight() const
 				Log(ERROR, "Inventory", "Invalid item: %s!", slot->ItemResRef);
 				slot->Weight = 0;
 			}
+			AdjustWeight(slot, 1);
+			// its flag goes on the next change
+			Recent[keep++] = slot;
 		} else {
 			slot->Flags &= ~IE_INV_ITEM_ACQUIRED;
 		}
-		if (slot->Weight > 0) {
-			Weight += slot->Weight * ((slot->Usages[0] && slot->MaxStackAmount) ? slot->Usages[0] : 1);
-		}
 	}
+	Recent.resize(keep);
 	Changed = false;
 }
 
@@ -335,6 +366,7 @@ bool Inventory::HasItem(const char *resref, ieDword flags) const
 void Inventory::KillSlot(unsigned int index)
 {
 	if (InventoryType==INVENTORY_HEAP) {
+		SlotRemoved(Slots[index]);
 		Slots.erase(Slots.begin()+index);
 		return;
 	}
@@ -349,7 +381,7 @@ void Inventory::KillSlot(unsigned int index)
 	}
 
 	Slots[index] = NULL;
-	Changed = true;
+	SlotRemoved(item);
 	int effect = core->QuerySlotEffects( index );
 	if (!effect) {
 		return;
@@ -484,7 +516,7 @@ unsigned int Inventory::DestroyItem(const char *resref, ieDword flags, ieDword c
 		if (count && (destructed>=count) )
 			break;
 	}
-	if (Changed && Owner && Owner->InParty) displaymsg->DisplayConstantString(STR_LOSTITEM, DMC_BG2XPGREEN);
+	if (destructed && Owner && Owner->InParty) displaymsg->DisplayConstantString(STR_LOSTITEM, DMC_BG2XPGREEN);
 
 	return destructed;
 }
@@ -509,7 +541,9 @@ CREItem *Inventory::RemoveItem(unsigned int slot, unsigned int count)
 	}
 
 	CREItem *returned = new CREItem(*item);
+	AdjustWeight(item, -1);
 	item->Usages[0]-=count;
+	AdjustWeight(item, 1);
 	returned->Usages[0]=(ieWord) count;
 	Changed = true;
 	return returned;
@@ -552,10 +586,10 @@ void Inventory::SetSlotItem(CREItem* item, unsigned int slot)
 		InvalidSlot(slot);
 		return;
 	}
-	Changed = true;
-
+	SlotRemoved(Slots[slot]);
 	delete Slots[slot];
 	Slots[slot] = item;
+	SlotAdded(item);
 
 	//update the action bar next time
 	if (Owner->IsSelected()) {
@@ -622,6 +656,7 @@ void Inventory::TryEquipAll(int slot)
 		}
 
 		Slots[i]=NULL;
+		SlotRemoved(item);
 		if (AddSlotItem(item, slot) == ASI_SUCCESS) {
 			return;
 		}
@@ -1473,7 +1508,7 @@ void Inventory::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "Inventory", buffer);
+	LogDebug("Inventory", buffer);
 }
 
 void Inventory::dump(StringBuffer& buffer) const
@@ -1490,7 +1525,6 @@ void Inventory::dump(StringBuffer& buffer) const
 	}
 
 	buffer.appendFormatted("Equipped: %d       EquippedHeader: %d\n", Equipped, EquippedHeader);
-	Changed = true;
 	CalculateWeight();
 	buffer.appendFormatted( "Total weight: %d\n", Weight );
 }
@@ -1825,6 +1859,8 @@ void Inventory::ChargeAllItems(int hours)
 		Item *itm = gamedata->GetItem(item->ItemResRef, true);
 		if (!itm)
 			continue;
+		// stacks keep their size in the first counter
+		AdjustWeight(item, -1);
 		for(int h=0;h<CHARGE_COUNTERS;h++) {
 			ITMExtHeader *header = itm->GetExtHeader(h);
 			if (header && (header->RechargeFlags&IE_ITEM_RECHARGE)) {
@@ -1835,6 +1871,7 @@ void Inventory::ChargeAllItems(int hours)
 				item->Usages[h]=add;
 			}
 		}
+		AdjustWeight(item, 1);
 		gamedata->FreeItem( itm, item->ItemResRef, false );
 	}
 }
@@ -1846,7 +1883,7 @@ int Inventory::FindStealableItem()
 	unsigned int start = core->Roll(1, slotcnt, -1);
 	int inc = start & 1 ? 1 : -1;
 
-	Log(DEBUG, "Inventory", "Start Slot: %d, increment: %d", start, inc);
+	LogDebug("Inventory", "Start Slot: %d, increment: %d", start, inc);
 	for (unsigned int i = 0; i < slotcnt; ++i) {
 		int slot = (slotcnt - 1 + start + i * inc) % slotcnt;
 		CREItem *item = Slots[slot];
@@ -1911,8 +1948,13 @@ int Inventory::MergeItems(int slot, CREItem *item)
 		}
 
 		slotitem->Flags |= IE_INV_ITEM_ACQUIRED;
+		AdjustWeight(slotitem, -1);
 		slotitem->Usages[0] = (ieWord) (slotitem->Usages[0] + chunk);
+		AdjustWeight(slotitem, 1);
 		item->Usages[0] = (ieWord) (item->Usages[0] - chunk);
+		if (std::find(Recent.begin(), Recent.end(), slotitem) == Recent.end()) {
+			Recent.push_back(slotitem);
+		}
 		Changed = true;
 		EquipItem(slot);
 		if (item->Usages[0] == 0) {
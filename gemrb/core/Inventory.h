@@ -199,16 +199,23 @@ private:
 	std::vector<CREItem*> Slots;
 	Actor* Owner;
 	int InventoryType;
-	/// Flag indicating whether weight needs to be recalculated
+	/// Flag indicating whether the recently added items need a look
 	mutable int Changed;
-	/** Total weight of all items in Inventory */
+	/** Total weight of all items in Inventory, kept up to date as they move */
 	mutable int Weight;
+	/** Items added since the last CalculateWeight, or weighed there */
+	mutable std::vector<CREItem*> Recent;
 
 	ieWordSigned Equipped;
 	ieWord EquippedHeader;
 	/** this isn't saved */
 	ieDword ItemExcl;
 	ieDword ItemTypes[8]; //256 bits
+
+	/** adds (sign 1) or subtracts (sign -1) the weight of a stack */
+	void AdjustWeight(const CREItem *item, int sign) const;
+	void SlotAdded(CREItem *item);
+	void SlotRemoved(CREItem *item);
 public: 
 	Inventory();
 	virtual ~Inventory();
@@ -25,6 +25,7 @@
 
 #include "win32def.h"
 
+#include "GameData.h"
 #include "Interface.h"
 #include "Projectile.h"
 #include "ProjectileServer.h"
@@ -57,6 +58,16 @@ Item::Item(void)
 	EquippingFeatureOffset = EquippingFeatureCount = 0;
 	unknown1 = unknown2 = unknown3 = 0;
 	ItemExcl = DialogName = 0;
+	FeaturesLoaded = true;
+}
+
+void Item::LoadFeatures() const
+{
+	if (FeaturesLoaded) {
+		return;
+	}
+	FeaturesLoaded = true;
+	gamedata->LoadItemFeatures(const_cast<Item *>(this));
 }
 
 Item::~Item(void)
@@ -76,6 +87,7 @@ EffectQueue *Item::GetEffectBlock(Scriptable *self, const Point &pos, int usage,
 	if (usage>=ExtHeaderCount) {
 		return NULL;
 	}
+	LoadFeatures();
 	if (usage>=0) {
 		features = ext_headers[usage].features;
 		count = ext_headers[usage].FeatureCount;
@@ -278,6 +290,7 @@ std::vector<DMGOpcodeInfo> Item::GetDamageOpcodesDetails(ITMExtHeader *header) c
 	std::multimap<ieDword, DamageInfoStruct>::iterator it;
 	std::vector<DMGOpcodeInfo> damage_opcodes;
 	if (!header) return damage_opcodes;
+	LoadFeatures();
 	for (int i=0; i< header->FeatureCount; i++) {
 		Effect *fx = header->features+i;
 		if (fx->Opcode == damage_opcode) {
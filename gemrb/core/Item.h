@@ -283,7 +283,12 @@ public:
 	unsigned int GetCastingDistance(int header) const;
 	// returns  a vector with details about any extended headers containing fx_damage with a 100% probability
 	std::vector<DMGOpcodeInfo> GetDamageOpcodesDetails(ITMExtHeader *header) const;
+	//the feature blocks (equipping_features and those of the ext_headers) are only
+	//read when first needed, the inventory and store screens mostly don't
+	void LoadFeatures() const;
+	void SetFeaturesPending() { FeaturesLoaded = false; }
 private:
+	mutable bool FeaturesLoaded;
 };
 
 }
@@ -49,7 +49,9 @@ public:
 	ItemMgr(void);
 	virtual ~ItemMgr(void);
 	virtual bool Open(DataStream* stream) = 0;
+	/** reads the header data, the feature blocks are left for GetItemFeatures */
 	virtual Item* GetItem(Item *s) = 0;
+	virtual bool GetItemFeatures(Item *s) = 0;
 };
 
 }
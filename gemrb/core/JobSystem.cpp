@@ -0,0 +1,374 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "JobSystem.h"
+
+#include "Tracer.h"
+#include "System/Logging.h"
+
+#include <cassert>
+
+namespace GemRB {
+
+class JobWorker : public Thread {
+public:
+	JobWorker(JobSystem *owner, int index) : system(owner), index(index), ready(false) {}
+	~JobWorker() { Join(); }
+	bool IsCurrent() const { return ready && Thread::IsSameThread(id, Thread::GetCurrentID()); }
+protected:
+	void Run();
+private:
+	JobSystem *system;
+	int index;
+	ThreadID id;
+	bool ready;
+};
+
+void JobWorker::Run()
+{
+	{
+		MutexLock l(system->sleepLock);
+		id = Thread::GetCurrentID();
+		ready = true;
+	}
+	Job *job;
+	while (system->WaitForWork(index, job)) {
+		system->RunJob(job);
+	}
+}
+
+Job::Job(const char *name, JobPriority priority)
+	: name(name), priority(priority), done(false), submitted(false), blockers(0)
+{
+}
+
+Job::~Job()
+{
+	// only when it was never run, the followers are dropped with it
+	for (size_t i = 0; i < followers.size(); i++) {
+		followers[i]->release();
+	}
+}
+
+JobSystem::JobSystem(unsigned int threads)
+	: queued(0), nextQueue(0), stopping(false)
+{
+	// all of them exist before any worker looks for work
+	for (unsigned int i = 0; i < (threads ? threads : 1); i++) {
+		queues.push_back(new WorkQueue);
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		JobWorker *worker = new JobWorker(this, i);
+		if (!worker->Start()) {
+			Log(ERROR, "JobSystem", "Couldn't start job thread %d!", i);
+			delete worker;
+			break;
+		}
+		workers.push_back(worker);
+	}
+	if (workers.size()) {
+		Log(MESSAGE, "JobSystem", "Started %d job threads.", (int) workers.size());
+	} else {
+		Log(MESSAGE, "JobSystem", "Running the jobs on the main thread.");
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		MutexLock l(sleepLock);
+		stopping = true;
+		wakeup.Broadcast();
+	}
+	// the running jobs are finished, the queued ones never start
+	for (size_t i = 0; i < workers.size(); i++) {
+		delete workers[i];
+	}
+
+	for (size_t i = 0; i < queues.size(); i++) {
+		for (int p = 0; p < JOB_PRIORITIES; p++) {
+			std::deque<Job *> &jobs = queues[i]->jobs[p];
+			while (!jobs.empty()) {
+				Drop(jobs.front());
+				jobs.pop_front();
+			}
+		}
+		delete queues[i];
+	}
+	for (size_t i = 0; i < completed.size(); i++) {
+		completed[i]->release();
+	}
+}
+
+void JobSystem::AddDependency(Job *job, Job *before)
+{
+	MutexLock l(doneLock);
+	assert(!job->submitted);
+	if (before->done) {
+		return;
+	}
+	job->blockers++;
+	job->acquire();
+	before->followers.push_back(job);
+}
+
+void JobSystem::Submit(Job *job)
+{
+	{
+		MutexLock l(doneLock);
+		job->submitted = true;
+		// the jobs it waits for hold it meanwhile
+		if (job->blockers) {
+			return;
+		}
+	}
+	// released once Completed was called
+	job->acquire();
+	Enqueue(job);
+}
+
+void JobSystem::Wait(Job *job)
+{
+	// needed right now, so don't wait for a free worker
+	if (Claim(job)) {
+		RunJob(job);
+		return;
+	}
+	int own = CurrentQueue();
+	while (true) {
+		{
+			MutexLock l(doneLock);
+			if (job->done) {
+				return;
+			}
+		}
+		Job *other = Take(own);
+		if (other) {
+			RunJob(other);
+			continue;
+		}
+		MutexLock l(doneLock);
+		if (!job->done) {
+			finished.Wait(doneLock);
+		}
+	}
+}
+
+bool JobSystem::Cancel(Job *job)
+{
+	if (!Claim(job)) {
+		return false;
+	}
+	MutexLock l(doneLock);
+	// nothing waits for it in vain
+	job->done = true;
+	finished.Broadcast();
+	Drop(job);
+	return true;
+}
+
+bool JobSystem::IsStopping()
+{
+	MutexLock l(sleepLock);
+	return stopping;
+}
+
+void JobSystem::Update()
+{
+	TRACE_SCOPE("JobSystem::Update");
+	if (workers.empty()) {
+		Job *job;
+		while ((job = Take(-1, JOB_FRAME))) {
+			RunJob(job);
+		}
+		job = Take(-1, JOB_BACKGROUND);
+		if (job) {
+			RunJob(job);
+		}
+	}
+
+	std::vector<Job *> done;
+	{
+		MutexLock l(doneLock);
+		done.swap(completed);
+	}
+	for (size_t i = 0; i < done.size(); i++) {
+		{
+			TRACE_SCOPE_DETAIL("JobSystem::Completed", done[i]->name);
+			done[i]->Completed();
+		}
+		done[i]->release();
+	}
+}
+
+int JobSystem::CurrentQueue()
+{
+	// the workers note who they are under the lock
+	MutexLock l(sleepLock);
+	for (size_t i = 0; i < workers.size(); i++) {
+		if (workers[i]->IsCurrent()) {
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+void JobSystem::Enqueue(Job *job)
+{
+	int own = CurrentQueue();
+	MutexLock l(sleepLock);
+	if (own < 0) {
+		// from the main or another foreign thread, spread them out
+		own = nextQueue++ % (workers.size() ? workers.size() : 1);
+	}
+	{
+		MutexLock q(queues[own]->lock);
+		queues[own]->jobs[job->priority].push_back(job);
+	}
+	queued++;
+	wakeup.Signal();
+}
+
+Job *JobSystem::Take(int own, int priority)
+{
+	Job *job = NULL;
+	// the newest of our own is the likeliest to be warm in the cache
+	if (own >= 0) {
+		MutexLock l(queues[own]->lock);
+		std::deque<Job *> &jobs = queues[own]->jobs[priority];
+		if (!jobs.empty()) {
+			job = jobs.back();
+			jobs.pop_back();
+		}
+	}
+	// and the oldest of the others has waited the longest
+	for (size_t i = 0; !job && i < queues.size(); i++) {
+		if ((int) i == own) {
+			continue;
+		}
+		MutexLock l(queues[i]->lock);
+		std::deque<Job *> &jobs = queues[i]->jobs[priority];
+		if (!jobs.empty()) {
+			job = jobs.front();
+			jobs.pop_front();
+		}
+	}
+	if (job) {
+		MutexLock l(sleepLock);
+		queued--;
+	}
+	return job;
+}
+
+Job *JobSystem::Take(int own)
+{
+	for (int p = 0; p < JOB_PRIORITIES; p++) {
+		Job *job = Take(own, p);
+		if (job) {
+			return job;
+		}
+	}
+	return NULL;
+}
+
+bool JobSystem::Claim(Job *job)
+{
+	bool found = false;
+	for (size_t i = 0; !found && i < queues.size(); i++) {
+		MutexLock l(queues[i]->lock);
+		std::deque<Job *> &jobs = queues[i]->jobs[job->priority];
+		for (std::deque<Job *>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+			if (*it == job) {
+				jobs.erase(it);
+				found = true;
+				break;
+			}
+		}
+	}
+	if (found) {
+		MutexLock l(sleepLock);
+		queued--;
+	}
+	return found;
+}
+
+bool JobSystem::WaitForWork(int own, Job *&job)
+{
+	while (true) {
+		{
+			MutexLock l(sleepLock);
+			while (!queued && !stopping) {
+				wakeup.Wait(sleepLock);
+			}
+			if (stopping) {
+				return false;
+			}
+		}
+		// queued counts the jobs being taken too, so this may come up empty
+		job = Take(own);
+		if (job) {
+			return true;
+		}
+	}
+}
+
+void JobSystem::RunJob(Job *job)
+{
+	{
+		TRACE_SCOPE_DETAIL("JobSystem::Run", job->name);
+		job->Run();
+	}
+
+	std::vector<Job *> ready, followers;
+	{
+		MutexLock l(doneLock);
+		job->done = true;
+		followers.swap(job->followers);
+		for (size_t i = 0; i < followers.size(); i++) {
+			if (!--followers[i]->blockers && followers[i]->submitted) {
+				ready.push_back(followers[i]);
+			}
+		}
+		completed.push_back(job);
+		finished.Broadcast();
+	}
+	for (size_t i = 0; i < ready.size(); i++) {
+		ready[i]->acquire();
+		Enqueue(ready[i]);
+	}
+	for (size_t i = 0; i < followers.size(); i++) {
+		followers[i]->release();
+	}
+}
+
+void JobSystem::Drop(Job *job)
+{
+	for (size_t i = 0; i < job->followers.size(); i++) {
+		Job *follower = job->followers[i];
+		if (!--follower->blockers && follower->submitted) {
+			follower->acquire();
+			Drop(follower);
+		}
+		follower->release();
+	}
+	job->followers.clear();
+	job->release();
+}
+
+}
@@ -0,0 +1,141 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "exports.h"
+
+#include "Holder.h"
+#include "System/Thread.h"
+
+#include <deque>
+#include <vector>
+
+namespace GemRB {
+
+class JobSystem;
+class JobWorker;
+
+enum JobPriority {
+	JOB_FRAME, // needed by the frame being built, runs before any background job
+	JOB_BACKGROUND,
+	JOB_PRIORITIES
+};
+
+/* A unit of work for the JobSystem
+ * Run is called once on a worker (or on the main thread without workers),
+ * Completed afterwards on the main thread, from JobSystem::Update.
+ * The system holds a reference until then, so a job may be submitted
+ * and forgotten, or kept in a Holder to Wait for it.
+ */
+class GEM_EXPORT Job : public Held<Job, AtomicRefCount> {
+public:
+	/* name has to be a literal, it labels the job in the traces */
+	Job(const char *name, JobPriority priority = JOB_BACKGROUND);
+	virtual ~Job();
+
+	const char *GetName() const { return name; }
+	JobPriority GetPriority() const { return priority; }
+	/* Run has returned (or it was cancelled), Completed may still be pending */
+	bool IsDone() const { return done; }
+
+protected:
+	virtual void Run() = 0;
+	virtual void Completed() {}
+
+private:
+	friend class JobSystem;
+	const char *name;
+	JobPriority priority;
+	volatile bool done;
+	bool submitted;
+	// unfinished jobs this one has to wait for
+	unsigned int blockers;
+	// submitted or not, they wait for this one
+	std::vector<Job *> followers;
+};
+
+/* Runs the jobs of all the subsystems on one pool of threads
+ * Every worker has its own queues, the jobs submitted by a worker go to its
+ * own and an idle worker steals from the others, frame critical jobs first.
+ * A job can be made to wait for others (AddDependency), it is queued when
+ * the last of them finishes, which is how continuations are chained.
+ * Without threads the jobs run on the main thread: all the frame critical
+ * ones and one background job on each Update, or right away in Wait.
+ */
+class GEM_EXPORT JobSystem {
+public:
+	JobSystem(unsigned int threads);
+	~JobSystem();
+
+	/* job won't run before before has finished, call it before submitting job */
+	void AddDependency(Job *job, Job *before);
+	/* queues the job, or parks it until its dependencies have finished */
+	void Submit(Job *job);
+	/* returns once job has run, running it right away if it is still
+	 * queued, or other queued jobs meanwhile; safe from the jobs themselves */
+	void Wait(Job *job);
+	/* takes job out of the queues if it hasn't started, false if it has;
+	 * the system forgets it, so it is never run nor Completed, but counts
+	 * as done for Wait */
+	bool Cancel(Job *job);
+	/* the system is going away, long jobs should give up */
+	bool IsStopping();
+	/* main thread, once per frame: calls Completed of the finished jobs */
+	void Update();
+	unsigned int GetThreadCount() const { return (unsigned int) workers.size(); }
+
+private:
+	friend class JobWorker;
+
+	struct WorkQueue {
+		Mutex lock;
+		std::deque<Job *> jobs[JOB_PRIORITIES];
+	};
+
+	std::vector<JobWorker *> workers;
+	// one per worker, a single one without
+	std::vector<WorkQueue *> queues;
+	// the sleeping workers wait for queued to grow
+	Mutex sleepLock;
+	ConditionVariable wakeup;
+	unsigned int queued;
+	unsigned int nextQueue;
+	bool stopping;
+	// the dependencies and the finished jobs
+	Mutex doneLock;
+	ConditionVariable finished;
+	std::vector<Job *> completed;
+
+	int CurrentQueue();
+	void Enqueue(Job *job);
+	Job *Take(int own, int priority);
+	Job *Take(int own);
+	// removes job from the queues, false if it wasn't queued
+	bool Claim(Job *job);
+	bool WaitForWork(int own, Job *&job);
+	void RunJob(Job *job);
+	// for the shutdown and Cancel, releases job and whatever waits only for it
+	void Drop(Job *job);
+};
+
+}
+
+#endif
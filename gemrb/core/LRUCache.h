@@ -19,44 +19,311 @@
  */
 
 #ifndef LRUCACHE_H
-#define LRUCACHE_H 
+#define LRUCACHE_H
 
 #include "exports.h"
 
-#include "Variables.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 
 namespace GemRB {
 
-struct VarEntry;
+// case insensitive string keys of any length
+GEM_EXPORT unsigned int LRUHashKey(const char* key);
+GEM_EXPORT bool LRUEqualKeys(const char* a, const char* b);
 
-class GEM_EXPORT LRUCache {
+/**
+ * Keeps values by string key in the order they were last used.
+ * The entries are linked into the usage list themselves and found through
+ * an open addressing table of entry pointers, so every operation is O(1).
+ * Callers that look up the same key often can hash it once with HashKey
+ * and pass the hash along.
+ * With a limit, adding an entry past it evicts the least recently used one.
+ * The release function is called for the values the cache drops by itself,
+ * on those evictions and in Clear, but not for the ones removed explicitly.
+ */
+template<typename Value>
+class LRUCache {
 public:
-	LRUCache();
+	typedef void (*ReleaseFunc)(const char* key, Value& value);
+
+	class Entry {
+		friend class LRUCache;
+		Entry* older;
+		Entry* newer;
+		char* key;
+		unsigned int hash;
+	public:
+		Value value;
+
+		const char* Key() const { return key; }
+		// the next more recently used entry, NULL for the most recent
+		Entry* Newer() const { return newer; }
+	};
+
+	explicit LRUCache(unsigned int limit = 0, ReleaseFunc release = NULL);
 	~LRUCache();
 
-	// set value, overwriting any previous entry
-	void SetAt(const char* key, void* value);
-	bool Lookup(const char* key, void*& value) const;
-	bool Touch(const char* key);
-	bool Remove(const char* key);
+	static unsigned int HashKey(const char* key) { return LRUHashKey(key); }
 
-	int GetCount() const;
+	// sets the value, overwriting any previous entry, and makes it the
+	// most recently used; may evict the oldest entry if over the limit
+	Entry* SetAt(const char* key, const Value& value) { return SetAt(key, HashKey(key), value); }
+	Entry* SetAt(const char* key, unsigned int hash, const Value& value);
+	// finds the value without changing the order
+	Value* Lookup(const char* key) const { return Lookup(key, HashKey(key)); }
+	Value* Lookup(const char* key, unsigned int hash) const;
+	// finds the value and makes it the most recently used
+	Value* Use(const char* key) { return Use(key, HashKey(key)); }
+	Value* Use(const char* key, unsigned int hash);
+	bool Touch(const char* key) { return Use(key) != NULL; }
+	void Touch(Entry* e);
+	bool Remove(const char* key) { return Remove(key, HashKey(key)); }
+	bool Remove(const char* key, unsigned int hash);
+	// the entry must belong to this cache
+	void Remove(Entry* e);
+	void Clear();
 
-	// return n-th LRU entry. key remains owned by LRUCache.
-	// (n = 0 is least recently used, n = 1 the next least recently used,
-	//  etc...)
-	bool getLRU(unsigned int n, const char*& key, void*& value) const;
+	unsigned int GetCount() const { return count; }
+	void SetLimit(unsigned int limit);
+	// the least recently used entry, walk on with Entry::Newer()
+	Entry* Oldest() const { return oldest; }
+	Entry* Newest() const { return newest; }
 
 private:
-	// internal storage
-	Variables v;
-	VarEntry* head;
-	VarEntry* tail;
+	Entry** table;
+	unsigned int tableSize; // a power of two, or 0 before the first entry
+	unsigned int count;
+	unsigned int limit;
+	ReleaseFunc release;
+	Entry* oldest;
+	Entry* newest;
+
+	LRUCache(const LRUCache&);
+	LRUCache& operator=(const LRUCache&);
 
-	void removeFromList(VarEntry* e);
+	unsigned int FindSlot(const char* key, unsigned int hash) const;
+	void Grow();
+	void Unlink(Entry* e);
+	void LinkNewest(Entry* e);
+	void Erase(Entry* e, bool notify);
 };
 
+template<typename Value>
+LRUCache<Value>::LRUCache(unsigned int limit, ReleaseFunc release)
+	: table(NULL), tableSize(0), count(0), limit(limit), release(release), oldest(NULL), newest(NULL)
+{
+}
+
+template<typename Value>
+LRUCache<Value>::~LRUCache()
+{
+	Clear();
+	free(table);
+}
+
+// returns the slot holding key, or the empty one where it would go
+template<typename Value>
+unsigned int LRUCache<Value>::FindSlot(const char* key, unsigned int hash) const
+{
+	unsigned int mask = tableSize - 1;
+	unsigned int i = hash & mask;
+	while (table[i]) {
+		if (table[i]->hash == hash && LRUEqualKeys(table[i]->key, key)) {
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+// keeps the table at most half full, so the probes stay short
+template<typename Value>
+void LRUCache<Value>::Grow()
+{
+	unsigned int oldSize = tableSize;
+	Entry** oldTable = table;
+
+	tableSize = oldSize ? oldSize * 2 : 32;
+	table = (Entry**) calloc(tableSize, sizeof(Entry*));
+	unsigned int mask = tableSize - 1;
+	for (unsigned int i = 0; i < oldSize; i++) {
+		Entry* e = oldTable[i];
+		if (!e) continue;
+		unsigned int j = e->hash & mask;
+		while (table[j]) {
+			j = (j + 1) & mask;
+		}
+		table[j] = e;
+	}
+	free(oldTable);
+}
+
+template<typename Value>
+void LRUCache<Value>::Unlink(Entry* e)
+{
+	if (e->older) {
+		e->older->newer = e->newer;
+	} else {
+		assert(e == oldest);
+		oldest = e->newer;
+	}
+	if (e->newer) {
+		e->newer->older = e->older;
+	} else {
+		assert(e == newest);
+		newest = e->older;
+	}
+	e->older = e->newer = NULL;
+}
+
+template<typename Value>
+void LRUCache<Value>::LinkNewest(Entry* e)
+{
+	e->older = newest;
+	e->newer = NULL;
+	if (newest) {
+		newest->newer = e;
+	} else {
+		oldest = e;
+	}
+	newest = e;
+}
+
+template<typename Value>
+typename LRUCache<Value>::Entry* LRUCache<Value>::SetAt(const char* key, unsigned int hash, const Value& value)
+{
+	if (tableSize) {
+		unsigned int i = FindSlot(key, hash);
+		if (table[i]) {
+			Entry* e = table[i];
+			e->value = value;
+			Touch(e);
+			return e;
+		}
+	}
+	if ((count + 1) * 2 > tableSize) {
+		Grow();
+	}
+
+	Entry* e = new Entry();
+	e->key = strdup(key);
+	e->hash = hash;
+	e->value = value;
+	table[FindSlot(key, hash)] = e;
+	count++;
+	LinkNewest(e);
 
+	if (limit && count > limit) {
+		Erase(oldest, true);
+	}
+	return e;
+}
+
+template<typename Value>
+Value* LRUCache<Value>::Lookup(const char* key, unsigned int hash) const
+{
+	if (!count) return NULL;
+	Entry* e = table[FindSlot(key, hash)];
+	return e ? &e->value : NULL;
+}
+
+template<typename Value>
+Value* LRUCache<Value>::Use(const char* key, unsigned int hash)
+{
+	if (!count) return NULL;
+	Entry* e = table[FindSlot(key, hash)];
+	if (!e) return NULL;
+	Touch(e);
+	return &e->value;
+}
+
+template<typename Value>
+void LRUCache<Value>::Touch(Entry* e)
+{
+	if (e == newest) return;
+	Unlink(e);
+	LinkNewest(e);
+}
+
+template<typename Value>
+bool LRUCache<Value>::Remove(const char* key, unsigned int hash)
+{
+	if (!count) return false;
+	Entry* e = table[FindSlot(key, hash)];
+	if (!e) return false;
+	Erase(e, false);
+	return true;
+}
+
+template<typename Value>
+void LRUCache<Value>::Remove(Entry* e)
+{
+	Erase(e, false);
+}
+
+// takes the entry out of the table and closes the gap behind it, so the
+// lookups never need tombstones
+template<typename Value>
+void LRUCache<Value>::Erase(Entry* e, bool notify)
+{
+	unsigned int mask = tableSize - 1;
+	unsigned int i = FindSlot(e->key, e->hash);
+	assert(table[i] == e);
+	table[i] = NULL;
+	unsigned int j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		Entry* next = table[j];
+		if (!next) break;
+		unsigned int home = next->hash & mask;
+		// move it back unless its home lies cyclically in (i, j]
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) {
+			continue;
+		}
+		table[i] = next;
+		table[j] = NULL;
+		i = j;
+	}
+
+	Unlink(e);
+	count--;
+	if (notify && release) {
+		release(e->key, e->value);
+	}
+	free(e->key);
+	delete e;
+}
+
+template<typename Value>
+void LRUCache<Value>::Clear()
+{
+	Entry* e = oldest;
+	while (e) {
+		Entry* next = e->newer;
+		if (release) {
+			release(e->key, e->value);
+		}
+		free(e->key);
+		delete e;
+		e = next;
+	}
+	oldest = newest = NULL;
+	count = 0;
+	if (table) {
+		memset(table, 0, tableSize * sizeof(Entry*));
+	}
+}
+
+template<typename Value>
+void LRUCache<Value>::SetLimit(unsigned int newLimit)
+{
+	limit = newLimit;
+	while (limit && count > limit) {
+		Erase(oldest, true);
+	}
+}
 
 }
 
@@ -27,7 +27,10 @@
 #include "Ambient.h"
 #include "AmbientMgr.h"
 #include "Audio.h"
+#include "Benchmark.h"
 #include "DisplayMessage.h"
+#include "FlowField.h"
+#include "FrameStats.h"
 #include "Game.h"
 #include "GameData.h"
 #include "IniSpawn.h"
@@ -38,11 +41,15 @@
 #include "Palette.h"
 #include "Particles.h"
 #include "PathFinder.h"
+#include "PathGraph.h"
+#include "PathService.h"
 #include "PluginMgr.h"
 #include "Projectile.h"
 #include "SaveGameIterator.h"
 #include "ScriptedAnimation.h"
+#include "SearchMap.h"
 #include "TileMap.h"
+#include "Tracer.h"
 #include "VEFObject.h"
 #include "Video.h"
 #include "WorldMap.h"
@@ -55,7 +62,9 @@
 #include "Scriptable/Container.h"
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
+#include "System/FileStream.h"
 #include "System/StringBuffer.h"
+#include "System/VFS.h"
 
 #include <cmath>
 #include <cassert>
@@ -65,6 +74,8 @@ namespace GemRB {
 #define YESNO(x) ( (x)?"Yes":"No")
 
 #define ANI_PRI_BACKGROUND	-9999
+// the entries of the line of sight cache, a power of two
+#define LOS_CACHE_SIZE 4096
 
 // TODO: fix this hardcoded resource reference
 static ieResRef PortalResRef={"EF03TPR3"};
@@ -82,9 +93,56 @@ static Point **VisibilityMasks=NULL;
 static bool PathFinderInited = false;
 static Variables Spawns;
 static int LargeFog;
+//the area whose fog the video driver holds
+static const Map *FogOwner = NULL;
 static TerrainSounds *terrainsounds=NULL;
 static int tsndcount = -1;
 
+// counts of the path requests and of how the taken steps were resolved
+static struct {
+	unsigned long requests; // paths asked for, by anyone
+	unsigned long waits; // walkers that found their next step taken
+	unsigned long yielded; // ... and could go on after waiting
+	unsigned long repaths; // ... and waited in vain, so looked for a new path
+} pathStats = { 0, 0, 0, 0 };
+
+// the searchmap without the actors, for the precomputed path graph
+class AreaStaticPathSource : public PathMapSource {
+public:
+	AreaStaticPathSource(Map *map) : area(map) {}
+	bool IsBlocked(unsigned int x, unsigned int y, unsigned int /*size*/)
+	{
+		unsigned int value = area->GetInternalSearchMap(x, y);
+		return !(value & PATH_MAP_PASSABLE) || (value & PATH_MAP_DOOR);
+	}
+private:
+	Map *area;
+};
+
+// the searchmap without the actors, but with the footprints of the walkers
+class AreaFlowPathSource : public SearchMap {
+public:
+	AreaFlowPathSource(const unsigned short *cells, unsigned int width, unsigned int height, unsigned int maxCircle)
+		: SearchMap(cells, width, height, maxCircle)
+	{
+	}
+protected:
+	unsigned int RawCell(unsigned int x, unsigned int y) const
+	{
+		return SearchMap::RawCell(x, y) & ~PATH_MAP_ACTOR;
+	}
+	bool SpanBlocked(int x0, int x1, int y) const
+	{
+		if (y < 0 || y >= (int) Height || x0 < 0 || x1 >= (int) Width) {
+			return true;
+		}
+		for (int x = x0; x <= x1; x++) {
+			if (CellBlocked(RawCell(x, y))) return true;
+		}
+		return false;
+	}
+};
+
 static void ReleaseSpawnGroup(void *poi)
 {
 	delete (SpawnGroup *) poi;
@@ -98,6 +156,21 @@ Spawn::Spawn() {
 	Name[0] = 0;
 }
 
+void Map::CountPathRequest()
+{
+	pathStats.requests++;
+}
+
+void Map::DumpPathStats(bool reset)
+{
+	Log(MESSAGE, "Map", "Paths requested: %lu", pathStats.requests);
+	Log(MESSAGE, "Map", "Blocked steps: %lu, freed while waiting: %lu, walked around: %lu",
+		pathStats.waits, pathStats.yielded, pathStats.repaths);
+	if (reset) {
+		pathStats.requests = pathStats.waits = pathStats.yielded = pathStats.repaths = 0;
+	}
+}
+
 void Map::ReleaseMemory()
 {
 	if (VisibilityMasks) {
@@ -330,14 +403,32 @@ Map::Map(void)
 	: Scriptable( ST_AREA )
 {
 	area=this;
+	// the scripts reach the globals and area variables through their slots
+	locals->UseSlots();
 	TMap = NULL;
 	LightMap = NULL;
 	HeightMap = NULL;
 	SmallMap = NULL;
-	MapSet = NULL;
 	SrchMap = NULL;
+	searchmap = NULL;
+	flowsource = NULL;
+	flowfields = NULL;
+	pathfinder = NULL;
+	pathgraph = NULL;
+	LightLevelsWidth = LightLevelsHeight = 0;
+	TintLevel = 0;
+	LOSEntry unused = { 0, 0, 0, false };
+	LOSCache.resize(LOS_CACHE_SIZE, unused);
+	losGeneration = 1;
+	TintLevelTime = 0;
+	TintLevelValid = false;
 	Walls = NULL;
 	WallCount = 0;
+	WallIndexColumns = 0;
+	SpawnIndexColumns = 0;
+	AnimationIndexColumns = 0;
+	ActorIndexColumns = ActorIndexRows = 0;
+	ActorIndexMaxSize = 0;
 	queue[PR_SCRIPT] = NULL;
 	queue[PR_DISPLAY] = NULL;
 	INISpawn = NULL;
@@ -349,6 +440,7 @@ Map::Map(void)
 	//Qcount[PR_IGNORE] = 0;
 	lastActorCount[PR_SCRIPT] = 0;
 	lastActorCount[PR_DISPLAY] = 0;
+	drawnActorsValid = false;
 	//no one needs this
 	//lastActorCount[PR_IGNORE] = 0;
 	if (!PathFinderInited) {
@@ -358,6 +450,13 @@ Map::Map(void)
 	}
 	ExploredBitmap = NULL;
 	VisibleBitmap = NULL;
+	FogSnapshot = NULL;
+	FogUpdates = 0;
+	FogVisibilityValid = false;
+	FogWallLeft = FogWallTop = 1;
+	FogWallRight = FogWallBottom = 0;
+	FogChangedTop = 0;
+	FogChangedBottom = -1;
 	version = 0;
 	MasterArea = core->GetGame()->MasterArea(scriptName);
 	Background = NULL;
@@ -378,7 +477,14 @@ Map::~Map(void)
 {
 	unsigned int i;
 
-	free( MapSet );
+	if (core->GetPathService()) {
+		core->GetPathService()->ClearArea(this);
+	}
+	delete flowfields;
+	delete flowsource;
+	delete pathgraph;
+	delete pathfinder;
+	delete searchmap;
 	free( SrchMap );
 	free( MaterialMap );
 
@@ -446,6 +552,10 @@ Map::~Map(void)
 	//malloc-d in AREImp
 	free( ExploredBitmap );
 	free( VisibleBitmap );
+	free( FogSnapshot );
+	if (FogOwner == this) {
+		FogOwner = NULL;
+	}
 	if (Walls) {
 		for(i=0;i<WallCount;i++) {
 			delete Walls[i];
@@ -462,10 +572,24 @@ void Map::ChangeTileMap(Image* lm, Sprite2D* sm)
 
 	LightMap = lm;
 	SmallMap = sm;
+	UpdateLightLevels();
 
 	TMap->UpdateDoors();
 }
 
+void Map::UpdateLightLevels()
+{
+	LightLevelsWidth = LightMap->GetWidth();
+	LightLevelsHeight = LightMap->GetHeight();
+	LightLevels.resize(LightLevelsWidth * LightLevelsHeight);
+	for (unsigned int y = 0; y < LightLevelsHeight; y++) {
+		for (unsigned int x = 0; x < LightLevelsWidth; x++) {
+			Color c = LightMap->GetPixel(x, y);
+			LightLevels[y * LightLevelsWidth + x] = c.r*114 + c.g*587 + c.b*299;
+		}
+	}
+}
+
 void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* hm)
 {
 	// CHECKME: leaks? Should the old TMap, LightMap, etc... be freed?
@@ -473,10 +597,11 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 	LightMap = lm;
 	HeightMap = hm;
 	SmallMap = sm;
+	UpdateLightLevels();
 	Width = (unsigned int) (TMap->XCellCount * 4);
 	Height = (unsigned int) (( TMap->YCellCount * 64 + 63) / 12);
 	//Filling Matrices
-	MapSet = (unsigned short *) malloc(sizeof(unsigned short) * Width * Height);
+	pathfinder = new PathFinder(Width, Height, NormalCost, NormalCost + AdditionalCost);
 	//Internal Searchmap
 	int y = sr->GetHeight();
 	SrchMap = (unsigned short *) calloc(Width * Height, sizeof(unsigned short));
@@ -493,6 +618,58 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 
 	//delete the original searchmap
 	delete sr;
+	searchmap = new SearchMap(SrchMap, Width, Height, MAX_CIRCLESIZE);
+	flowsource = new AreaFlowPathSource(SrchMap, Width, Height, MAX_CIRCLESIZE);
+	flowfields = new FlowFieldCache(pathfinder);
+	BuildActorIndex();
+	BuildPathGraph();
+}
+
+static const char PathGraphSignature[] = "PGR V1.0";
+
+/* The path graph only depends on the searchmap and the path costs, so a
+ * hash of them names its file in the cache. Revisited areas (and areas
+ * sharing a searchmap) read the clusters back instead of searching them
+ * again. Dot files are spared when the cache is cleaned up. */
+void Map::BuildPathGraph()
+{
+	pathgraph = new PathGraph(pathfinder);
+
+	// FNV-1a over the cells
+	unsigned int hash = 2166136261U;
+	const unsigned char *bytes = (const unsigned char *) SrchMap;
+	for (size_t i = 0; i < Width * Height * sizeof(unsigned short); i++) {
+		hash = (hash ^ bytes[i]) * 16777619U;
+	}
+	char fname[_MAX_PATH];
+	snprintf(fname, sizeof(fname), ".paths-%08x-%ux%u-%d-%d.graph", hash,
+		Width, Height, NormalCost, AdditionalCost);
+	char path[_MAX_PATH];
+	PathJoin(path, core->CachePath, fname, NULL);
+
+	if (file_exists(path)) {
+		FileStream *str = FileStream::OpenFile(path);
+		if (str) {
+			char signature[8];
+			bool loaded = str->Read(signature, 8) == 8 &&
+				!strncmp(signature, PathGraphSignature, 8) && pathgraph->Load(str);
+			delete str;
+			if (loaded) {
+				return;
+			}
+		}
+	}
+
+	AreaStaticPathSource source(this);
+	pathgraph->Build(source);
+
+	FileStream out;
+	if (!out.Create(path)) {
+		Log(WARNING, "Map", "Cannot write the path graph cache %s.", path);
+		return;
+	}
+	out.Write(PathGraphSignature, 8);
+	pathgraph->Save(&out);
 }
 
 void Map::MoveToNewArea(const char *area, const char *entrance, unsigned int direction, int EveryOne, Actor *actor)
@@ -668,19 +845,100 @@ void Map::DrawPortal(InfoPoint *ip, int enable)
 	}
 }
 
+// the creatures no party member could see, out of the fights and off screen
+// run their scripts half as often and leave their animations until seen
+void Map::UpdateFarAway()
+{
+	size_t i = actors.size();
+	if (!core->SimulationLOD) {
+		while (i--) {
+			actors[i]->FarAway = false;
+		}
+		return;
+	}
+
+	Game *game = core->GetGame();
+	bool combat = game->AnyPCInCombat();
+	bool current = game->GetCurrentArea() == this;
+	Region vp = core->GetVideoDriver()->GetViewport();
+	while (i--) {
+		Actor *actor = actors[i];
+		actor->FarAway = !actor->InParty && !actor->LastTarget &&
+			!(combat && actor->GetStat(IE_EA) >= EA_EVILCUTOFF) &&
+			!(current && vp.PointInside(actor->Pos));
+	}
+
+	// twice the sight range, so the ones walking into view already behave
+	i = actors.size();
+	while (i--) {
+		Actor *pc = actors[i];
+		if (!pc->InParty) continue;
+		unsigned int reach = (pc->GetStat(IE_VISUALRANGE) + 1) * 32;
+		const std::vector<Actor*> &nearby = GetActorsNear(pc->Pos, reach);
+		for (size_t j = 0; j < nearby.size(); j++) {
+			nearby[j]->FarAway = false;
+		}
+	}
+}
+
+void Map::GetDueScripts(std::vector<GameScript*> &dueScripts)
+{
+	// only a look ahead: the queues, the path deliveries and the rest
+	// stay with UpdateScripts, since the areas before this one may still
+	// move or remove its actors
+	bool has_pcs = false;
+	size_t i = actors.size();
+	while (i--) {
+		if (actors[i]->InParty) {
+			has_pcs = true;
+			break;
+		}
+	}
+	if (!has_pcs && !(MasterArea && actors.size())) {
+		return;
+	}
+	if (core->GetGameControl()->GetDialogueFlags() & DF_FREEZE_SCRIPTS) {
+		return;
+	}
+
+	//the actors GenerateQueues would put on PR_SCRIPT, except the ones it activates
+	ieDword gametime = core->GetGame()->GameTime;
+	i = actors.size();
+	while (i--) {
+		const Actor *actor = actors[i];
+		ieDword internalFlag = actor->GetInternalFlag();
+		if (!(internalFlag&IF_ACTIVE)) continue;
+		if ((actor->GetStance() == IE_ANI_TWITCH) && (internalFlag&IF_IDLE)) continue;
+		if (!actor->Schedule(gametime, false)) continue;
+		actor->GetDueScripts(dueScripts);
+	}
+}
+
 void Map::UpdateScripts()
 {
+	TRACE_SCOPE("Map::UpdateScripts");
 	bool has_pcs = false;
 	size_t i=actors.size();
 	while (i--) {
+		//catch up with the moves that went around MoveTo and DoStepForActor
+		UpdateActorIndex(actors[i]);
 		if (actors[i]->InParty) {
 			has_pcs = true;
-			break;
 		}
 	}
 
-	GenerateQueues();
-	SortQueues();
+	// paths worked out in the background since the last tick
+	if (core->GetPathService()) {
+		BenchmarkTimer benchmark(BENCH_PATHS);
+		core->GetPathService()->Deliver(this);
+	}
+
+	{
+		BenchmarkTimer benchmark(BENCH_QUEUES);
+		GenerateQueues();
+		SortQueues();
+		UpdateFarAway();
+	}
 
 	// if masterarea, then we allow 'any' actors
 	// if not masterarea, we allow only players
@@ -706,8 +964,10 @@ void Map::UpdateScripts()
 		//Run all the Map Scripts (as in the original)
 		//The default area script is in the last slot anyway
 		//ExecuteScript( MAX_SCRIPTS );
+		BenchmarkTimer benchmark(BENCH_AREA_SCRIPTS);
 		Update();
 	} else {
+		BenchmarkTimer benchmark(BENCH_AREA_SCRIPTS);
 		ProcessActions();
 	}
 
@@ -726,6 +986,23 @@ void Map::UpdateScripts()
 		game->SetTimestopOwner(NULL);
 	}
 
+	//the variable checks of the scripts about to run go to the script workers first,
+	//unless Game already had them prepared and nothing changed since
+	if (core->ScriptThreads) {
+		std::vector<GameScript*> dueScripts;
+		for (int j = 0; j < q; j++) {
+			queue[PR_SCRIPT][j]->GetDueScripts(dueScripts);
+		}
+		size_t kept = 0;
+		for (size_t j = 0; j < dueScripts.size(); j++) {
+			if (!dueScripts[j]->IsPrepared()) {
+				dueScripts[kept++] = dueScripts[j];
+			}
+		}
+		dueScripts.resize(kept);
+		PrepareScripts(dueScripts);
+	}
+
 	while (q--) {
 		Actor* actor = queue[PR_SCRIPT][q];
 		//actor just moved away, don't run its script from this side
@@ -765,8 +1042,12 @@ void Map::UpdateScripts()
 		 * point, etc), but i did it this way for now because it seems least painful
 		 * and we should probably be staggering the script executions anyway
 		 */
-		actor->Update();
+		{
+			BenchmarkTimer benchmark(BENCH_ACTOR_SCRIPTS);
+			actor->Update();
+		}
 
+		BenchmarkTimer benchmark(BENCH_ACTOR_STATE);
 		actor->UpdateActorState(game->GameTime);
 
 		int speed = actor->CalculateSpeed(false);
@@ -803,16 +1084,22 @@ void Map::UpdateScripts()
 	// taking steps.
 	bool more_steps = true;
 	ieDword time = game->Ticks; // make sure everything moves at the same time
-	while (more_steps) {
-		more_steps = false;
+	{
+		BenchmarkTimer benchmark(BENCH_MOVEMENT);
+		while (more_steps) {
+			more_steps = false;
 
-		q=Qcount[PR_SCRIPT];
-		while (q--) {
-			Actor* actor = queue[PR_SCRIPT][q];
-			more_steps = !DoStepForActor(actor, actor->speed, time);
+			q=Qcount[PR_SCRIPT];
+			while (q--) {
+				Actor* actor = queue[PR_SCRIPT][q];
+				more_steps = !DoStepForActor(actor, actor->speed, time);
+			}
 		}
 	}
 
+	//the rest of the tick is for the doors, containers, infopoints and spawns
+	BenchmarkTimer benchmark(BENCH_TRIGGERS);
+
 	//Check if we need to start some door scripts
 	int doorCount = 0;
 	while (true) {
@@ -918,14 +1205,26 @@ bool Map::DoStepForActor(Actor *actor, int speed, ieDword time) {
 
 		PathNode * step = actor->GetNextStep();
 		if (step && step->Next) {
-			//we should actually wait for a short time and check then
 			if (GetBlocked(step->Next->x*16+8,step->Next->y*12+6,actor->size)) {
+				// wait for whoever stands there to move on before walking around them
+				if (!actor->IsWaitingForStep()) {
+					pathStats.waits++;
+				}
+				if (actor->WaitForStep(time)) {
+					BlockSearchMap( actor->Pos, actor->size, actor->IsPartyMember()?PATH_MAP_PC:PATH_MAP_NPC);
+					return true;
+				}
+				pathStats.repaths++;
 				actor->NewPath();
+			} else if (actor->IsWaitingForStep()) {
+				pathStats.yielded++;
+				actor->StepCleared();
 			}
 		}
 	}
 	if (!(actor->GetBase(IE_STATE_ID)&STATE_CANTMOVE) ) {
 		no_more_steps = actor->DoStep( speed, time );
+		UpdateActorIndex(actor);
 		if (actor->BlocksSearchMap()) {
 			BlockSearchMap( actor->Pos, actor->size, actor->IsPartyMember()?PATH_MAP_PC:PATH_MAP_NPC);
 		}
@@ -1028,13 +1327,15 @@ retry:
 	}
 }
 
-AreaAnimation *Map::GetNextAreaAnimation(aniIterator &iter, ieDword gametime)
+//walks the ones CollectShownAnimations found, their frames follow the clock
+//anyway, so the skipped ones catch up once they come into view
+AreaAnimation *Map::GetNextAreaAnimation(size_t &index, ieDword gametime)
 {
 retry:
-	if (iter==animations.end()) {
+	if (index >= shownAnimations.size()) {
 		return NULL;
 	}
-	AreaAnimation *a = *(iter++);
+	AreaAnimation *a = shownAnimations[index++];
 	if (!a->Schedule(gametime) ) {
 		goto retry;
 	}
@@ -1044,6 +1345,77 @@ retry:
 	return a;
 }
 
+//a coarse grid over the area, so a frame only looks at the animations nearby
+#define ANIM_INDEX_CELL 512
+
+void Map::IndexAnimations()
+{
+	AnimationOrder.assign(animations.begin(), animations.end());
+
+	int columns = 1;
+	int rows = 1;
+	std::vector<Region> bounds(AnimationOrder.size());
+	for (size_t i = 0; i < AnimationOrder.size(); ++i) {
+		bounds[i] = AnimationOrder[i]->GetBounds();
+		columns = std::max(columns, (bounds[i].x + bounds[i].w) / ANIM_INDEX_CELL + 1);
+		rows = std::max(rows, (bounds[i].y + bounds[i].h) / ANIM_INDEX_CELL + 1);
+	}
+	AnimationIndexColumns = columns;
+	AnimationIndex.assign(columns * rows, std::vector<unsigned int>());
+
+	for (size_t i = 0; i < AnimationOrder.size(); ++i) {
+		const Region &bb = bounds[i];
+		int left = std::max(bb.x / ANIM_INDEX_CELL, 0);
+		int top = std::max(bb.y / ANIM_INDEX_CELL, 0);
+		int right = std::min((bb.x + bb.w) / ANIM_INDEX_CELL, columns - 1);
+		int bottom = std::min((bb.y + bb.h) / ANIM_INDEX_CELL, rows - 1);
+		for (int cy = top; cy <= bottom; ++cy) {
+			for (int cx = left; cx <= right; ++cx) {
+				AnimationIndex[cy * columns + cx].push_back((unsigned int) i);
+			}
+		}
+	}
+}
+
+//the animations whose bounds reach into the viewport, in drawing order
+void Map::CollectShownAnimations(const Region &vp)
+{
+	shownAnimations.clear();
+	if (animations.empty()) {
+		return;
+	}
+	if (AnimationIndex.empty()) {
+		IndexAnimations();
+	}
+
+	int columns = AnimationIndexColumns;
+	int rows = (int) AnimationIndex.size() / columns;
+	int left = std::max(vp.x, 0) / ANIM_INDEX_CELL;
+	int top = std::max(vp.y, 0) / ANIM_INDEX_CELL;
+	int right = std::min((vp.x + vp.w) / ANIM_INDEX_CELL, columns - 1);
+	int bottom = std::min((vp.y + vp.h) / ANIM_INDEX_CELL, rows - 1);
+	if (left > right || top > bottom) {
+		return;
+	}
+
+	std::vector<unsigned int> found;
+	for (int cy = top; cy <= bottom; ++cy) {
+		for (int cx = left; cx <= right; ++cx) {
+			const std::vector<unsigned int> &cell = AnimationIndex[cy * columns + cx];
+			found.insert(found.end(), cell.begin(), cell.end());
+		}
+	}
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	for (size_t i = 0; i < found.size(); ++i) {
+		AreaAnimation *a = AnimationOrder[found[i]];
+		if (a->GetBounds().IntersectsRegion(vp)) {
+			shownAnimations.push_back(a);
+		}
+	}
+}
+
 Particles *Map::GetNextSpark(spaIterator &iter)
 {
 	if (iter==particles.end()) {
@@ -1105,13 +1477,27 @@ VEFObject *Map::GetNextScriptedAnimation(scaIterator &iter)
 static ieDword oldgametime = 0;
 
 //Draw the game area (including overlays, actors, animations, weather)
-void Map::DrawMap(Region screen)
+//the feet circle (see Selectable::IsOver) reaches into the viewport
+static bool CircleInViewport(const Actor *actor, const Region &vp)
+{
+	int csize = actor->size;
+	if (csize < 2) csize = 2;
+	int dx = (csize - 1) * 16;
+	int dy = (csize - 1) * 12;
+	return actor->Pos.x + dx >= vp.x && actor->Pos.x - dx <= vp.x + vp.w &&
+		actor->Pos.y + dy >= vp.y && actor->Pos.y - dy <= vp.y + vp.h;
+}
+
+bool Map::DrawMap(Region screen)
 {
+	TRACE_SCOPE("Map::DrawMap");
+	FrameTimer frameTimer(FRAME_AREA);
 	if (!TMap) {
-		return;
+		return false;
 	}
 	Game *game = core->GetGame();
 	ieDword gametime = game->GameTime;
+	bool interpolated = false;
 
 	//area specific spawn.ini files (a PST feature)
 	if (INISpawn) {
@@ -1131,15 +1517,22 @@ void Map::DrawMap(Region screen)
 		}
 	}
 
-	if (!bgoverride) {
-		int rain, flags;
+	int flags;
+	if (game->IsTimestopActive()) {
+		flags = TILE_GREY;
+	}
+	else if (AreaFlags&AF_DREAM) {
+		flags = TILE_SEPIA;
+	} else flags = 0;
 
-		if (game->IsTimestopActive()) {
-			flags = TILE_GREY;
-		}
-		else if (AreaFlags&AF_DREAM) {
-			flags = TILE_SEPIA;
-		} else flags = 0;
+	// the day and weather tint goes over the finished area in one go, unless
+	// the tiles are grey or sepia (that comes after the tint) or covered
+	const Color *globalTint = game->GetGlobalTint();
+	bool tintPass = globalTint && !bgoverride && !flags && video->CanTintGameArea();
+	game->SetGlobalTintPass(tintPass);
+
+	if (!bgoverride) {
+		int rain;
 
 		if (HasWeather()) {
 			//zero when the weather particles are all gone
@@ -1157,14 +1550,20 @@ void Map::DrawMap(Region screen)
 	int q = PR_DISPLAY;
 	int index = Qcount[q];
 	Actor* actor = GetNextActor(q, index);
-	aniIterator aniidx = animations.begin();
+	size_t aniidx = 0;
 	scaIterator scaidx = vvcCells.begin();
 	proIterator proidx = projectiles.begin();
 	spaIterator spaidx = particles.begin();
 	int pileidx = 0;
 	Container *pile = GetNextPile(pileidx);
 
+	Region vp = video->GetViewport();
+	CollectShownAnimations(vp);
 	AreaAnimation *a = GetNextAreaAnimation(aniidx, gametime);
+	//what the pointer can reach until the next frame
+	TMap->CollectShown(vp);
+	drawnActors.clear();
+	drawnViewport = vp;
 	VEFObject *sca = GetNextScriptedAnimation(scaidx);
 	Projectile *pro = GetNextProjectile(proidx);
 	Particles *spark = GetNextSpark(spaidx);
@@ -1175,7 +1574,8 @@ void Map::DrawMap(Region screen)
 		a = GetNextAreaAnimation(aniidx, gametime);
 	}
 
-	if (!bgoverride) {
+	// with the tint pass they come after it, so they keep their colours
+	if (!bgoverride && !tintPass) {
 		//Draw Outlines
 		DrawHighlightables();
 	}
@@ -1188,8 +1588,16 @@ void Map::DrawMap(Region screen)
 		switch(SelectObject(actor,q,a,sca,spark,pro,pile)) {
 		case AOT_ACTOR:
 			assert(actor != NULL);
-			actor->Draw( screen );
-			actor->UpdateAnimations();
+			if (actor->Draw( screen )) {
+				interpolated = true;
+			}
+			if (CircleInViewport(actor, vp)) {
+				drawnActors.push_back(actor);
+			}
+			// the skipped frames are caught up with once it is seen again
+			if (!actor->FarAway || !actor->AnimationCanWait()) {
+				actor->UpdateAnimations();
+			}
 			actor = GetNextActor(q, index);
 			break;
 		case AOT_PILE:
@@ -1202,7 +1610,7 @@ void Map::DrawMap(Region screen)
 		case AOT_AREA:
 			//draw animation
 			a->Draw( screen, this );
-			a = GetNextAreaAnimation(aniidx,gametime);
+			a = GetNextAreaAnimation(aniidx, gametime);
 			break;
 		case AOT_SCRIPTED:
 			{
@@ -1260,11 +1668,25 @@ void Map::DrawMap(Region screen)
 			error("Map", "Trying to draw unknown animation type.\n");
 		}
 	}
+	drawnActorsValid = true;
+
+	if (tintPass) {
+		video->TintGameArea(screen, *globalTint);
+		game->SetGlobalTintPass(false);
+		DrawHighlightables();
+		for (size_t i = 0; i < selections.size(); i++) {
+			selections[i].first->DrawSelection(selections[i].second);
+		}
+		selections.clear();
+	}
 
 	if ((core->FogOfWar&FOG_DRAWSEARCHMAP) && SrchMap) {
 		DrawSearchMap(screen);
 	} else {
 		if ((core->FogOfWar&FOG_DRAWFOG) && TMap) {
+			if (core->SmoothFog) {
+				UploadFog();
+			}
 			TMap->DrawFogOfWar( ExploredBitmap, VisibleBitmap, screen );
 		}
 	}
@@ -1307,6 +1729,7 @@ void Map::DrawMap(Region screen)
 	}
 
 	oldgametime=gametime;
+	return interpolated;
 }
 
 void Map::DrawSearchMap(const Region &screen)
@@ -1355,6 +1778,7 @@ void Map::AddAnimation(AreaAnimation* panim)
 	int Height = anim->GetHeight();
 	for(iter=animations.begin(); (iter!=animations.end()) && ((*iter)->GetHeight()<Height); iter++) ;
 	animations.insert(iter, anim);
+	AnimationIndex.clear();
 }
 
 //reapplying all of the effects on the actors of this map
@@ -1414,9 +1838,10 @@ int Map::CountSummons(ieDword flags, ieDword sex)
 bool Map::AnyEnemyNearPoint(const Point &p)
 {
 	ieDword gametime = core->GetGame()->GameTime;
-	size_t i = actors.size();
+	CollectActors(p.x - SPAWN_RANGE, p.y - SPAWN_RANGE, p.x + SPAWN_RANGE, p.y + SPAWN_RANGE);
+	size_t i = nearActors.size();
 	while (i--) {
-		Actor *actor = actors[i];
+		Actor *actor = nearActors[i];
 
 		if (!actor->Schedule(gametime, true) ) {
 			continue;
@@ -1499,11 +1924,17 @@ void Map::AddActor(Actor* actor, bool init)
 	strnlwrcpy(actor->Area, scriptName, 8);
 	if (!HasActor(actor)) {
 		actors.push_back( actor );
+		actorsByID[actor->GetGlobalID()] = actor;
+		IndexActor(actor);
+		drawnActorsValid = false;
 	}
 	if (init) {
 		actor->SetMap(this);
 		InitActor(actor);
 	}
+	if (actor->Modified[IE_EA] >= EA_EVILCUTOFF) {
+		actor->PreloadCombatAnimations();
+	}
 }
 
 bool Map::AnyPCSeesEnemy()
@@ -1530,6 +1961,8 @@ void Map::DeleteActor(int i)
 {
 	Actor *actor = actors[i];
 	if (actor) {
+		UnindexActor(actor);
+		actorsByID.erase(actor->GetGlobalID());
 		Game *game = core->GetGame();
 		//this makes sure that a PC will be demoted to NPC
 		game->LeaveParty( actor );
@@ -1546,6 +1979,7 @@ void Map::DeleteActor(int i)
 	}
 	//remove the actor from the area's actor list
 	actors.erase( actors.begin()+i );
+	drawnActorsValid = false;
 }
 
 Scriptable *Map::GetScriptableByGlobalID(ieDword objectID)
@@ -1578,42 +2012,21 @@ Door *Map::GetDoorByGlobalID(ieDword objectID)
 {
 	if (!objectID) return NULL;
 
-	int doorCount = 0;
-	while (true) {
-		Door* door = TMap->GetDoor( doorCount++ );
-		if (!door)
-			return NULL;
-		if (door->GetGlobalID() == objectID)
-			return door;
-	}
+	return TMap->GetDoorByGlobalID(objectID);
 }
 
 Container *Map::GetContainerByGlobalID(ieDword objectID)
 {
 	if (!objectID) return NULL;
 
-	int containerCount = 0;
-	while (true) {
-		Container* container = TMap->GetContainer( containerCount++ );
-		if (!container)
-			return NULL;
-		if (container->GetGlobalID() == objectID)
-			return container;
-	}
+	return TMap->GetContainerByGlobalID(objectID);
 }
 
 InfoPoint *Map::GetInfoPointByGlobalID(ieDword objectID)
 {
 	if (!objectID) return NULL;
 
-	int ipCount = 0;
-	while (true) {
-		InfoPoint* ip = TMap->GetInfoPoint( ipCount++ );
-		if (!ip)
-			return NULL;
-		if (ip->GetGlobalID() == objectID)
-			return ip;
-	}
+	return TMap->GetInfoPointByGlobalID(objectID);
 }
 
 Actor* Map::GetActorByGlobalID(ieDword objectID)
@@ -1621,15 +2034,11 @@ Actor* Map::GetActorByGlobalID(ieDword objectID)
 	if (!objectID) {
 		return NULL;
 	}
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
-
-		if (actor->GetGlobalID()==objectID) {
-			return actor;
-		}
+	std::map<ieDword, Actor*>::const_iterator it = actorsByID.find(objectID);
+	if (it == actorsByID.end()) {
+		return NULL;
 	}
-	return NULL;
+	return it->second;
 }
 
 /** flags:
@@ -1654,13 +2063,18 @@ Actor* Map::GetActor(const Point &p, int flags)
 	return NULL;
 }
 
-Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
+//the pointer can only be over what was drawn on the last frame, and the
+//later drawn actors cover the earlier ones, so they go first
+Actor* Map::PickActor(const Point &p, int flags)
 {
-	size_t i = actors.size();
+	if (!drawnActorsValid || !drawnViewport.PointInside(p)) {
+		return GetActor(p, flags);
+	}
+	size_t i = drawnActors.size();
 	while (i--) {
-		Actor* actor = actors[i];
+		Actor* actor = drawnActors[i];
 
-		if (PersonalDistance( p, actor ) > radius)
+		if (!actor->IsOver( p ))
 			continue;
 		if (!actor->ValidTarget(flags) ) {
 			continue;
@@ -1670,53 +2084,205 @@ Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
 	return NULL;
 }
 
-//maybe consider using a simple list
-Actor **Map::GetAllActorsInRadius(const Point &p, int flags, unsigned int radius, Scriptable *see)
+//a coarse grid over the area, so the radius queries only look at the actors nearby
+#define ACTOR_INDEX_CELL 256
+//how far an actor may be from its entry: GetNextStep moves it to the middle of its searchmap cell
+#define ACTOR_INDEX_SLACK 16
+
+//files every actor again, the positions outside of the area go to the border cells
+void Map::BuildActorIndex()
 {
-	ieDword count = 1;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	ActorIndexColumns = std::max(1, (int) (Width * 16 + ACTOR_INDEX_CELL - 1) / ACTOR_INDEX_CELL);
+	ActorIndexRows = std::max(1, (int) (Height * 12 + ACTOR_INDEX_CELL - 1) / ACTOR_INDEX_CELL);
+	ActorIndex.assign(ActorIndexColumns * ActorIndexRows, std::vector<ActorIndexEntry>());
+	ActorIndexMaxSize = 0;
+	for (size_t i = 0; i < actors.size(); ++i) {
+		IndexActor(actors[i]);
+	}
+}
 
-		if (PersonalDistance( p, actor ) > radius)
-			continue;
-		if (!actor->ValidTarget(flags, see) ) {
-			continue;
+int Map::GetActorIndexCell(const Point &p) const
+{
+	int cx = std::min(std::max((int) p.x, 0) / ACTOR_INDEX_CELL, ActorIndexColumns - 1);
+	int cy = std::min(std::max((int) p.y, 0) / ACTOR_INDEX_CELL, ActorIndexRows - 1);
+	return cy * ActorIndexColumns + cx;
+}
+
+void Map::IndexActor(Actor *actor)
+{
+	actor->actorIndexCell = -1;
+	if (ActorIndex.empty()) {
+		return;
+	}
+	actor->actorIndexCell = GetActorIndexCell(actor->Pos);
+	std::vector<ActorIndexEntry> &cell = ActorIndex[actor->actorIndexCell];
+	ActorIndexEntry entry = { actor->Pos, actor->size, actor };
+	actor->actorIndexSlot = (int) cell.size();
+	cell.push_back(entry);
+	ActorIndexMaxSize = std::max(ActorIndexMaxSize, actor->size);
+}
+
+void Map::UnindexActor(Actor *actor)
+{
+	if (actor->actorIndexCell < 0 || actor->actorIndexCell >= (int) ActorIndex.size()) {
+		return;
+	}
+	std::vector<ActorIndexEntry> &cell = ActorIndex[actor->actorIndexCell];
+	int slot = actor->actorIndexSlot;
+	if (slot >= 0 && slot < (int) cell.size() && cell[slot].actor == actor) {
+		cell[slot] = cell.back();
+		cell[slot].actor->actorIndexSlot = slot;
+		cell.pop_back();
+	}
+	actor->actorIndexCell = -1;
+	actor->actorIndexSlot = -1;
+}
+
+void Map::UpdateActorIndex(Actor *actor)
+{
+	//the actors AddActor didn't file aren't in this area (yet)
+	if (actor->actorIndexCell < 0) {
+		return;
+	}
+	//the circle may have grown since
+	ActorIndexMaxSize = std::max(ActorIndexMaxSize, actor->size);
+	if (GetActorIndexCell(actor->Pos) != actor->actorIndexCell) {
+		UnindexActor(actor);
+		IndexActor(actor);
+		return;
+	}
+	ActorIndexEntry &entry = ActorIndex[actor->actorIndexCell][actor->actorIndexSlot];
+	entry.Pos = actor->Pos;
+	entry.size = actor->size;
+}
+
+//the actors filed within the box go to nearActors, all of them without an index
+void Map::CollectActors(int left, int top, int right, int bottom)
+{
+	if (ActorIndex.empty()) {
+		nearActors = actors;
+		return;
+	}
+	nearActors.clear();
+	int cleft = std::min(std::max(left, 0) / ACTOR_INDEX_CELL, ActorIndexColumns - 1);
+	int ctop = std::min(std::max(top, 0) / ACTOR_INDEX_CELL, ActorIndexRows - 1);
+	int cright = std::min(std::max(right, 0) / ACTOR_INDEX_CELL, ActorIndexColumns - 1);
+	int cbottom = std::min(std::max(bottom, 0) / ACTOR_INDEX_CELL, ActorIndexRows - 1);
+	left -= ACTOR_INDEX_SLACK;
+	top -= ACTOR_INDEX_SLACK;
+	right += ACTOR_INDEX_SLACK;
+	bottom += ACTOR_INDEX_SLACK;
+	for (int cy = ctop; cy <= cbottom; ++cy) {
+		for (int cx = cleft; cx <= cright; ++cx) {
+			const std::vector<ActorIndexEntry> &cell = ActorIndex[cy * ActorIndexColumns + cx];
+			for (size_t i = 0; i < cell.size(); ++i) {
+				const Point &pos = cell[i].Pos;
+				if (pos.x < left || pos.x > right || pos.y < top || pos.y > bottom) {
+					continue;
+				}
+				nearActors.push_back(cell[i].actor);
+			}
 		}
-		if (!(flags&GA_NO_LOS)) {
-			//line of sight visibility
-			if (!IsVisibleLOS(actor->Pos, p)) {
-				continue;
+	}
+}
+
+//the candidates PersonalDistance might still find within radius of p
+static inline int ActorIndexReach(unsigned int radius, int maxSize)
+{
+	return (int) std::min(radius, 0x7fffU) + maxSize * 10;
+}
+
+//the actors filed close enough to p that PersonalDistance might be within radius
+void Map::CollectActorsInRadius(const Point &p, unsigned int radius)
+{
+	int reach = ActorIndexReach(radius, ActorIndexMaxSize);
+	if (ActorIndex.empty()) {
+		nearActors = actors;
+		return;
+	}
+	nearActors.clear();
+	int cleft = std::min(std::max(p.x - reach, 0) / ACTOR_INDEX_CELL, ActorIndexColumns - 1);
+	int ctop = std::min(std::max(p.y - reach, 0) / ACTOR_INDEX_CELL, ActorIndexRows - 1);
+	int cright = std::min(std::max(p.x + reach, 0) / ACTOR_INDEX_CELL, ActorIndexColumns - 1);
+	int cbottom = std::min(std::max(p.y + reach, 0) / ACTOR_INDEX_CELL, ActorIndexRows - 1);
+	radius = std::min(radius, 0x7fffU);
+	for (int cy = ctop; cy <= cbottom; ++cy) {
+		for (int cx = cleft; cx <= cright; ++cx) {
+			const std::vector<ActorIndexEntry> &cell = ActorIndex[cy * ActorIndexColumns + cx];
+			for (size_t i = 0; i < cell.size(); ++i) {
+				long x = cell[i].Pos.x - p.x;
+				long y = cell[i].Pos.y - p.y;
+				long r = radius + cell[i].size * 10 + ACTOR_INDEX_SLACK;
+				if (x * x + y * y > r * r) {
+					continue;
+				}
+				nearActors.push_back(cell[i].actor);
 			}
 		}
-		count++;
 	}
+}
 
-	Actor **ret = (Actor **) malloc( sizeof(Actor*) * count);
-	i = actors.size();
-	int j = 0;
+Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
+{
+	CollectActorsInRadius(p, radius);
+	size_t i = nearActors.size();
 	while (i--) {
-		Actor* actor = actors[i];
+		Actor* actor = nearActors[i];
 
 		if (PersonalDistance( p, actor ) > radius)
 			continue;
 		if (!actor->ValidTarget(flags) ) {
 			continue;
 		}
+		return actor;
+	}
+	return NULL;
+}
+
+const std::vector<Actor*> &Map::GetActorsNear(const Point &p, unsigned int reach)
+{
+	int r = (int) std::min(reach, 0x7fffU);
+	CollectActors(p.x - r, p.y - r, p.x + r, p.y + r);
+	return nearActors;
+}
+
+const std::vector<Actor*> &Map::GetActorsNear(const Region &box, unsigned int reach)
+{
+	int r = ActorIndexReach(reach, ActorIndexMaxSize);
+	CollectActors(box.x - r, box.y - r, box.x + box.w + r, box.y + box.h + r);
+	return nearActors;
+}
+
+Actor **Map::GetAllActorsInRadius(const Point &p, int flags, unsigned int radius, Scriptable *see)
+{
+	CollectActorsInRadius(p, radius);
+	//the matches are packed to the front of the candidates, behind the reading
+	size_t count = 0;
+	for (size_t i = 0; i < nearActors.size(); ++i) {
+		Actor* actor = nearActors[i];
+
+		if (PersonalDistance( p, actor ) > radius)
+			continue;
+		if (!actor->ValidTarget(flags, see) ) {
+			continue;
+		}
 		if (!(flags&GA_NO_LOS)) {
+			//line of sight visibility
 			if (!IsVisibleLOS(actor->Pos, p)) {
 				continue;
 			}
 		}
-
-		ret[j++]=actor;
+		nearActors[count++] = actor;
 	}
 
-	ret[j]=NULL;
+	Actor **ret = (Actor **) malloc( sizeof(Actor*) * (count + 1));
+	if (count) {
+		memcpy(ret, &nearActors[0], sizeof(Actor*) * count);
+	}
+	ret[count]=NULL;
 	return ret;
 }
 
-
 Actor* Map::GetActor(const char* Name, int flags)
 {
 	size_t i = actors.size();
@@ -1940,11 +2506,10 @@ Actor* Map::GetActorByScriptName(const char *name)
 
 int Map::GetActorInRect(Actor**& actorlist, Region& rgn, bool onlyparty)
 {
-	actorlist = ( Actor * * ) malloc( actors.size() * sizeof( Actor * ) );
+	CollectActors(rgn.x, rgn.y, rgn.x + rgn.w, rgn.y + rgn.h);
 	int count = 0;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	for (size_t i = 0; i < nearActors.size(); ++i) {
+		Actor* actor = nearActors[i];
 //use this function only for party?
 		if (onlyparty && actor->GetStat(IE_EA)>EA_CHARMED) {
 			continue;
@@ -1958,9 +2523,12 @@ int Map::GetActorInRect(Actor**& actorlist, Region& rgn, bool onlyparty)
 			continue;
 		if ((actor->Pos.x>rgn.x+rgn.w) || (actor->Pos.y>rgn.y+rgn.h) )
 			continue;
-		actorlist[count++] = actor;
+		nearActors[count++] = actor;
+	}
+	actorlist = ( Actor * * ) malloc( count * sizeof( Actor * ) );
+	if (count) {
+		memcpy(actorlist, &nearActors[0], count * sizeof( Actor * ));
 	}
-	actorlist = ( Actor * * ) realloc( actorlist, count * sizeof( Actor * ) );
 	return count;
 }
 
@@ -2002,43 +2570,12 @@ void Map::PlayAreaSong(int SongType, bool restart, bool hard)
 
 unsigned int Map::GetBlocked(unsigned int x, unsigned int y)
 {
-	if (y>=Height || x>=Width) {
-		return 0;
-	}
-	unsigned int ret = SrchMap[y*Width+x];
-	if (ret&(PATH_MAP_DOOR_IMPASSABLE|PATH_MAP_ACTOR)) {
-		ret&=~PATH_MAP_PASSABLE;
-	}
-	if (ret&PATH_MAP_DOOR_OPAQUE) {
-		ret=PATH_MAP_SIDEWALL;
-	}
-	return ret;
+	return searchmap->GetCell(x, y);
 }
 
 bool Map::GetBlocked(unsigned int px, unsigned int py, unsigned int size)
 {
-	// We check a circle of radius size-2 around (px,py)
-	// Note that this does not exactly match BG2. BG2's approximations of
-	// these circles are slightly different for sizes 7 and up.
-
-	if (size > MAX_CIRCLESIZE) size = MAX_CIRCLESIZE;
-	if (size < 2) size = 2;
-
-	unsigned int ppx = px/16;
-	unsigned int ppy = py/12;
-	unsigned int r=(size-2)*(size-2)+1;
-	if (size == 2) r = 0;
-	for (unsigned int i=0; i<size-1; i++) {
-		for (unsigned int j=0; j<size-1; j++) {
-			if (i*i+j*j <= r) {
-				if (!(GetBlocked(ppx+i,ppy+j)&PATH_MAP_PASSABLE)) return true;
-				if (!(GetBlocked(ppx+i,ppy-j)&PATH_MAP_PASSABLE)) return true;
-				if (!(GetBlocked(ppx-i,ppy+j)&PATH_MAP_PASSABLE)) return true;
-				if (!(GetBlocked(ppx-i,ppy-j)&PATH_MAP_PASSABLE)) return true;
-			}
-		}
-	}
-	return false;
+	return searchmap->GetBlocked(px, py, size);
 }
 
 unsigned int Map::GetBlocked(const Point &c)
@@ -2051,8 +2588,19 @@ unsigned int Map::GetBlocked(const Point &c)
 //	2 - always dither
 
 SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
-	unsigned int width, unsigned int height, int flags, bool areaanim)
+	unsigned int width, unsigned int height, int flags, bool areaanim, SpriteCover* reuse)
 {
+	std::vector<Wall_Polygon*> walls;
+	FindCoveringWalls(x, y, Region(x - xpos, y - ypos, width, height), areaanim, walls);
+
+	if (reuse && walls.empty() && !reuse->wallCount && reuse->XPos == xpos && reuse->YPos == ypos
+		&& reuse->Width == (int) width && reuse->Height == (int) height) {
+		//nothing covers it, here or where it was, so the empty mask just follows
+		reuse->worldx = x;
+		reuse->worldy = y;
+		return reuse;
+	}
+
 	SpriteCover* sc = new SpriteCover;
 	sc->worldx = x;
 	sc->worldy = y;
@@ -2064,20 +2612,91 @@ SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 	Video* video = core->GetVideoDriver();
 	video->InitSpriteCover(sc, flags);
 
-	unsigned int wpcount = GetWallCount();
-	unsigned int i;
+	for (size_t i = 0; i < walls.size(); ++i) {
+		video->AddPolygonToSpriteCover(sc, walls[i]);
+	}
+	sc->wallCount = (unsigned int) walls.size();
 
-	for (i = 0; i < wpcount; ++i)
-	{
+	return sc;
+}
+
+//a coarse grid over the area, so the covers only look at the walls nearby
+#define WALL_INDEX_CELL 256
+
+void Map::IndexWalls()
+{
+	//as far as the walls reach, the boxes beyond them find nothing anyway
+	int columns = 1;
+	int rows = 1;
+	for (unsigned int i = 0; i < WallCount; ++i) {
 		Wall_Polygon* wp = GetWallGroup(i);
 		if (!wp) continue;
-		if (!wp->PointCovered(x, y)) continue;
-		if (areaanim && !(wp->GetPolygonFlag() & WF_COVERANIMS)) continue;
+		columns = std::max(columns, (wp->BBox.x + wp->BBox.w) / WALL_INDEX_CELL + 1);
+		rows = std::max(rows, (wp->BBox.y + wp->BBox.h) / WALL_INDEX_CELL + 1);
+	}
+	WallIndexColumns = columns;
+	WallIndex.assign(columns * rows, std::vector<unsigned int>());
 
-		video->AddPolygonToSpriteCover(sc, wp);
+	for (unsigned int i = 0; i < WallCount; ++i) {
+		Wall_Polygon* wp = GetWallGroup(i);
+		if (!wp) continue;
+		//the edges of the box are part of the wall too
+		const Region &bb = wp->BBox;
+		int left = bb.x / WALL_INDEX_CELL;
+		int top = bb.y / WALL_INDEX_CELL;
+		int right = (bb.x + bb.w) / WALL_INDEX_CELL;
+		int bottom = (bb.y + bb.h) / WALL_INDEX_CELL;
+		left = std::max(left, 0);
+		top = std::max(top, 0);
+		right = std::min(right, columns - 1);
+		bottom = std::min(bottom, rows - 1);
+		for (int cy = top; cy <= bottom; ++cy) {
+			for (int cx = left; cx <= right; ++cx) {
+				WallIndex[cy * columns + cx].push_back(i);
+			}
+		}
 	}
+}
 
-	return sc;
+//the walls in front of the point x,y that reach into box, in wall order
+void Map::FindCoveringWalls(int x, int y, const Region &box, bool areaanim, std::vector<Wall_Polygon*> &walls)
+{
+	if (!WallCount || box.w <= 0 || box.h <= 0) {
+		return;
+	}
+	if (WallIndex.empty()) {
+		IndexWalls();
+	}
+
+	int columns = WallIndexColumns;
+	int rows = (int) WallIndex.size() / columns;
+	int left = std::max(box.x - 1, 0) / WALL_INDEX_CELL;
+	int top = std::max(box.y - 1, 0) / WALL_INDEX_CELL;
+	int right = std::min((box.x + box.w) / WALL_INDEX_CELL, columns - 1);
+	int bottom = std::min((box.y + box.h) / WALL_INDEX_CELL, rows - 1);
+	if (left > right || top > bottom) {
+		return;
+	}
+
+	std::vector<unsigned int> found;
+	for (int cy = top; cy <= bottom; ++cy) {
+		for (int cx = left; cx <= right; ++cx) {
+			const std::vector<unsigned int> &cell = WallIndex[cy * columns + cx];
+			found.insert(found.end(), cell.begin(), cell.end());
+		}
+	}
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+
+	//the box may just touch the last pixels of a wall
+	Region reach(box.x - 1, box.y - 1, box.w + 2, box.h + 2);
+	for (size_t i = 0; i < found.size(); ++i) {
+		Wall_Polygon* wp = GetWallGroup(found[i]);
+		if (!wp->BBox.IntersectsRegion(reach)) continue;
+		if (!wp->PointCovered(x, y)) continue;
+		if (areaanim && !(wp->GetPolygonFlag() & WF_COVERANIMS)) continue;
+		walls.push_back(wp);
+	}
 }
 
 void Map::ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg)
@@ -2087,6 +2706,7 @@ void Map::ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg
 	if (!Walls) {
 		return;
 	}
+	std::vector<Region> changed;
 	for(i=baseindex; i < baseindex+count; ++i) {
 		Wall_Polygon* wp = GetWallGroup(i);
 		if (!wp)
@@ -2096,12 +2716,46 @@ void Map::ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg
 			value&=~WF_DISABLED;
 		else
 			value|=WF_DISABLED;
+		if (value == wp->GetPolygonFlag())
+			continue;
 		wp->SetPolygonFlag(value);
+		changed.push_back(wp->BBox);
 	}
-	//all actors will have to generate a new spritecover
-	i=(int) actors.size();
-	while(i--) {
-		actors[i]->SetSpriteCover(NULL);
+	//only the covers built where the toggled walls reach are stale
+	for (i = 0; i < changed.size(); ++i) {
+		InvalidateSpriteCovers(changed[i]);
+	}
+}
+
+//what a cover was built for, in area coordinates
+static bool CoverTouches(const SpriteCover *sc, const Region &box)
+{
+	Region covered(sc->worldx - sc->XPos, sc->worldy - sc->YPos, sc->Width, sc->Height);
+	//the edges of a wall box are part of the wall too
+	Region reach(box.x - 1, box.y - 1, box.w + 2, box.h + 2);
+	return covered.IntersectsRegion(reach);
+}
+
+void Map::InvalidateSpriteCovers(const Region &box)
+{
+	size_t i = actors.size();
+	while (i--) {
+		SpriteCover *sc = actors[i]->GetSpriteCover();
+		if (sc && CoverTouches(sc, box)) {
+			actors[i]->SetSpriteCover(NULL);
+		}
+	}
+
+	aniIterator iter;
+	for (iter = animations.begin(); iter != animations.end(); ++iter) {
+		AreaAnimation *anim = *iter;
+		if (!anim->covers) continue;
+		for (int ac = 0; ac < anim->animcount; ac++) {
+			if (anim->covers[ac] && CoverTouches(anim->covers[ac], box)) {
+				delete anim->covers[ac];
+				anim->covers[ac] = NULL;
+			}
+		}
 	}
 }
 
@@ -2114,13 +2768,15 @@ void Map::GenerateQueues()
 
 	unsigned int i=(unsigned int) actors.size();
 	for (priority=0;priority<QUEUE_COUNT;priority++) {
-		if (lastActorCount[priority] != i) {
-			if (queue[priority]) {
-				free(queue[priority]);
-				queue[priority] = NULL;
+		if (lastActorCount[priority] < i || !queue[priority]) {
+			// some headroom, so a few spawns don't reallocate again
+			unsigned int room = i + i/4 + 8;
+			Actor **grown = (Actor **) realloc(queue[priority], room * sizeof(Actor *));
+			if (!grown) {
+				error("Map", "Could not grow the actor queues to %u.\n", room);
 			}
-			queue[priority] = (Actor **) calloc( i, sizeof(Actor *) );
-			lastActorCount[priority] = i;
+			queue[priority] = grown;
+			lastActorCount[priority] = room;
 		}
 		Qcount[priority] = 0;
 	}
@@ -2175,41 +2831,54 @@ void Map::GenerateQueues()
 	}
 }
 
-//the original qsort implementation was flawed
+//the actors barely move between two sorts, so the queues start out in
+//their last order, and an insertion sort only has to swap the few that
+//passed each other
 void Map::SortQueues()
 {
 	for (int q=0;q<QUEUE_COUNT;q++) {
 		Actor **baseline=queue[q];
 		int n = Qcount[q];
-		int i = n/2;
-		int parent, child;
-		Actor * tmp;
-
-		for (;;) {
-			if (i>0) {
-				i--;
-				tmp = baseline[i];
-			} else {
-				n--;
-				if (n<=0) break; //breaking loop
-				tmp = baseline[n];
-				baseline[n] = baseline[0];
-			}
-			parent = i;
-			child = i*2+1;
-			while(child<n) {
-				int chp = child+1;
-				if (chp<n && baseline[chp]->Pos.y < baseline[child]->Pos.y) {
-					child=chp;
+		int i;
+
+		//usually nobody joined or left, so they are already where they were
+		for (i=0;i<n;i++) {
+			if (baseline[i]->DrawRank != (unsigned int) i) break;
+		}
+
+		//if not, back to where they were, the newcomers after them
+		if (i<n) {
+			sortPlaced.assign(n, (Actor *) NULL);
+			sortNewcomers.clear();
+			for (i=0;i<n;i++) {
+				Actor *act = baseline[i];
+				if (act->DrawRank < (unsigned int) n && !sortPlaced[act->DrawRank]) {
+					sortPlaced[act->DrawRank] = act;
+				} else {
+					sortNewcomers.push_back(act);
 				}
-				if (baseline[child]->Pos.y<tmp->Pos.y) {
-					baseline[parent] = baseline[child];
-					parent = child;
-					child = parent*2+1;
-				} else
-					break;
 			}
-			baseline[parent]=tmp;
+			int count = 0;
+			for (i=0;i<n;i++) {
+				if (sortPlaced[i]) baseline[count++] = sortPlaced[i];
+			}
+			for (i=0;i<(int) sortNewcomers.size();i++) {
+				baseline[count++] = sortNewcomers[i];
+			}
+		}
+
+		//descending, the queues are drawn from the back
+		for (i=1;i<n;i++) {
+			Actor *tmp = baseline[i];
+			int j = i;
+			while (j>0 && baseline[j-1]->Pos.y < tmp->Pos.y) {
+				baseline[j] = baseline[j-1];
+				j--;
+			}
+			baseline[j] = tmp;
+		}
+		for (i=0;i<n;i++) {
+			baseline[i]->DrawRank = i;
 		}
 	}
 }
@@ -2301,6 +2970,7 @@ Spawn *Map::AddSpawn(char* Name, int XPos, int YPos, ieResRef *creatures, unsign
 		strnlwrcpy(sp->Creatures[i],creatures[i],8);
 	}
 	spawns.push_back( sp );
+	SpawnIndex.clear();
 	return sp;
 }
 
@@ -2329,13 +2999,8 @@ Entrance* Map::GetEntrance(const char* Name)
 
 bool Map::HasActor(Actor *actor)
 {
-	size_t i=actors.size();
-	while (i--) {
-		if (actors[i] == actor) {
-			return true;
-		}
-	}
-	return false;
+	std::map<ieDword, Actor*>::const_iterator it = actorsByID.find(actor->GetGlobalID());
+	return it != actorsByID.end() && it->second == actor;
 }
 
 void Map::RemoveActor(Actor* actor)
@@ -2346,9 +3011,12 @@ void Map::RemoveActor(Actor* actor)
 			//path is invalid outside this area, but actions may be valid
 			actor->ClearPath();
 			ClearSearchMapFor(actor);
+			UnindexActor(actor);
 			actor->SetMap(NULL);
 			CopyResRef(actor->Area, "");
+			actorsByID.erase(actor->GetGlobalID());
 			actors.erase( actors.begin()+i );
+			drawnActorsValid = false;
 			return;
 		}
 	}
@@ -2407,56 +3075,11 @@ void Map::dump(bool show_actors) const
 			}
 		}
 	}
-	Log(DEBUG, "Map", buffer);
+	LogDebug("Map", buffer);
 }
 
 /******************************************************************************/
 
-void Map::Leveldown(unsigned int px, unsigned int py,
-	unsigned int& level, Point &n, unsigned int& diff)
-{
-	int pos;
-	unsigned int nlevel;
-
-	if (( px >= Width ) || ( py >= Height )) {
-		return;
-	} //walked off the map
-	pos = py * Width + px;
-	nlevel = MapSet[pos];
-	if (!nlevel) {
-		return;
-	} //not even considered
-	if (level <= nlevel) {
-		return;
-	}
-	unsigned int ndiff = level - nlevel;
-	if (ndiff > diff) {
-		level = nlevel;
-		diff = ndiff;
-		n.x = (ieWord) px;
-		n.y = (ieWord) py;
-	}
-}
-
-void Map::SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost)
-{
-	unsigned int pos;
-
-	if (( x >= Width ) || ( y >= Height )) {
-		return;
-	}
-	pos = y * Width + x;
-	if (MapSet[pos]) {
-		return;
-	}
-	if (GetBlocked(x*16+8,y*12+6,size)) {
-		MapSet[pos] = 65535;
-		return;
-	}
-	MapSet[pos] = (ieWord) Cost;
-	InternalStack.push( ( x << 16 ) | y );
-}
-
 bool Map::AdjustPositionX(Point &goal, unsigned int radiusx, unsigned int radiusy)
 {
 	unsigned int minx = 0;
@@ -2554,57 +3177,42 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 	Point goal (d.x/16, d.y/12);
 	unsigned int dist;
 
-	//MapSet entries are made of 16 bits
-	if (PathLen>65535) {
-		PathLen = 65535;
-	}
-
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
-
 	if (!( GetBlocked( start.x, start.y) & PATH_MAP_PASSABLE )) {
 		AdjustPosition( start );
 	}
-	unsigned int pos = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
+	// no single goal, so this is a plain flood limited by the path length
+	pathfinder->Begin(start);
 	dist = 0;
 	Point best = start;
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-		long tx = (long) x - goal.x;
-		long ty = (long) y - goal.y;
+	Point p;
+	unsigned int Cost;
+	while (pathfinder->Next(p, Cost)) {
+		long tx = (long) p.x - goal.x;
+		long ty = (long) p.y - goal.y;
 		unsigned int distance = (unsigned int) std::sqrt( ( double ) ( tx* tx + ty* ty ) );
 		if (dist<distance) {
-			best.x=(ieWord) x;
-			best.y=(ieWord) y;
+			best = p;
 			dist=distance;
 		}
 
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > PathLen) {
+		if (Cost + NormalCost > PathLen) {
 			break;
 		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
+		pathfinder->Expand(*searchmap, size);
+	}
 
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+	// count the steps first, so the path is taken from the pool in one go
+	unsigned int count = 1;
+	Point n;
+	p = best;
+	while (p != start && pathfinder->GetParent(p, n)) {
+		count++;
+		p = n;
 	}
+	PathNode *StartNode;
+	PathNode *Return = PathNode::NewRun(count, StartNode);
 
 	//find path backwards from best to start
-	PathNode* StartNode = new PathNode;
-	PathNode* Return = StartNode;
-	StartNode->Next = NULL;
 	StartNode->x = best.x;
 	StartNode->y = best.y;
 	if (flags) {
@@ -2612,38 +3220,20 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 	} else {
 		StartNode->orient = GetOrient( best, start );
 	}
-	Point p = best;
-	unsigned int pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
-		Return = new PathNode;
-		StartNode->Parent = Return;
-		Return->Next = StartNode;
-		StartNode = Return;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		Return->x = n.x;
-		Return->y = n.y;
+	p = best;
+	while (StartNode->Parent) {
+		pathfinder->GetParent(p, n);
+		StartNode = StartNode->Parent;
+		StartNode->x = n.x;
+		StartNode->y = n.y;
 
 		if (flags) {
-			Return->orient = GetOrient( p, n );
+			StartNode->orient = GetOrient( p, n );
 		} else {
-			Return->orient = GetOrient( n, p );
+			StartNode->orient = GetOrient( n, p );
 		}
 		p = n;
-		if (!diff) {
-			break;
-		}
 	}
-	Return->Parent = NULL;
 	return Return;
 }
 
@@ -2651,9 +3241,6 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 {
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		return true;
@@ -2662,27 +3249,16 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 		return true;
 	}
 
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size() && pos!=pos2) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		SetupNode( x - 1, y - 1, size, 1 );
-		SetupNode( x + 1, y - 1, size, 1 );
-		SetupNode( x + 1, y + 1, size, 1 );
-		SetupNode( x - 1, y + 1, size, 1 );
-		SetupNode( x, y - 1, size, 1 );
-		SetupNode( x + 1, y, size, 1 );
-		SetupNode( x, y + 1, size, 1 );
-		SetupNode( x - 1, y, size, 1 );
+	pathfinder->Begin(goal, start);
+	Point p;
+	unsigned int cost;
+	while (pathfinder->Next(p, cost)) {
+		if (p == start) {
+			return false;
+		}
+		pathfinder->Expand(*searchmap, size);
 	}
-	return pos!=pos2;
+	return true;
 }
 
 /* Use this function when you target something by a straight line projectile (like a lightning bolt, arrow, etc)
@@ -2732,12 +3308,9 @@ PathNode* Map::GetLine(const Point &start, const Point &dest, int Speed, int Ori
 	StartNode->orient = Orientation;
 
 	int Count = 0;
-	int Max = Distance(start,dest);
-	for (int Steps = 0; Steps<Max; Steps++) {
-		Point p;
-		p.x = (ieWord) start.x + ((dest.x - start.x) * Steps / Max);
-		p.y = (ieWord) start.y + ((dest.y - start.y) * Steps / Max);
-
+	LineWalker line(start, dest, Distance(start, dest), false);
+	Point p;
+	while (line.Next(p)) {
 		//the path ends here as it would go off the screen, causing problems
 		//maybe there is a better way, but i needed a quick hack to fix
 		//the crash in projectiles
@@ -2787,182 +3360,48 @@ PathNode* Map::GetLine(const Point &start, const Point &dest, int Speed, int Ori
  */
 PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, unsigned int MinDistance, bool sight)
 {
-	// adjust the start/goal points to be searchmap locations
-	Point start( s.x/16, s.y/12 );
-	Point goal ( d.x/16, d.y/12 );
-	Point orig_goal = goal;
-
-	// re-initialise the path finding structures
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
-
-	// set the start point in the path finding structures
-	unsigned int pos2 = ( goal.x << 16 ) | goal.y;
-	unsigned int pos = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
+	FrameStats::Count(FRAME_PATHS);
+	return pathfinder->FindNear(*searchmap, s, d, size, MinDistance, sight);
+}
 
-	unsigned int squaredmindistance = MinDistance * MinDistance;
-	bool found_path = false;
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		if (pos == pos2) {
-			// we got all the way to the target!
-			found_path = true;
-			break;
-		} else if (MinDistance) {
-			/* check minimum distance:
-			 * as an obvious optimisation we only check squared distance: this is a
-			 * possible overestimate since the sqrt Distance() rounds down
-			 * (some other optimisations could be made here, but you'd be better off
-			 * fixing the pathfinder to do A* properly)
-			 * caller should have already done PersonalDistance adjustments, this is
-			 * simply between the specified points
-			 */
-
-			int distx = (x*16 + 8) - d.x;
-			int disty = (y*12 + 6) - d.y;
-			if ((unsigned int)(distx*distx + disty*disty) <= squaredmindistance) {
-				// we are within the minimum distance of the goal
-				Point ourpos(x*16 + 8, y*12 + 6);
-				// sight check is *slow* :(
-				if (!sight || IsVisibleLOS(ourpos, d)) {
-					// we got all the way to a suitable goal!
-					goal = Point(x, y);
-					found_path = true;
-					break;
-				}
-			}
-		}
+bool Map::TracePath(PathNode *&tail, const Point &start, const Point &goal, unsigned int size, unsigned int maxCost)
+{
+	return pathfinder->Trace(*searchmap, tail, start, goal, size, maxCost);
+}
 
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			// cost is far too high, no path found
+// walks down the field while the goal is far, then searches the rest of the way,
+// so each walker still ends up on its own spot (a formation slot, say)
+bool Map::FollowFlowField(PathNode *&tail, const FlowField *field, const Point &start, const Point &goal, unsigned int size)
+{
+	Point p = start;
+	Point next;
+	while (!FlowFieldCache::IsNear(p, goal) && field->GetNext(p, next)) {
+		// the field doesn't know about the actors, the search goes around them
+		if (searchmap->IsBlocked(next.x, next.y, size)) {
 			break;
 		}
-
-		// diagonal movements
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		// direct movements
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
-	}
-
-	// find path from goal to start
-	PathNode* StartNode = new PathNode;
-	PathNode* Return = StartNode;
-	StartNode->Next = NULL;
-	StartNode->Parent = NULL;
-	if (!found_path) {
-		// this is not really great, we should be finding the path that
-		// went nearest to where we wanted
-		StartNode->x = start.x;
-		StartNode->y = start.y;
-		StartNode->orient = GetOrient( goal, start );
-		return Return;
-	}
-	StartNode->x = goal.x;
-	StartNode->y = goal.y;
-	bool fixup_orient = false;
-	if (orig_goal != goal) {
-		StartNode->orient = GetOrient( orig_goal, goal );
-	} else {
-		// we pathed all the way to original goal!
-		// we don't know correct orientation until we find previous step
-		fixup_orient = true;
-		StartNode->orient = GetOrient( goal, start );
-	}
-	Point p = goal;
-	pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
-
-		if (fixup_orient) {
-			// don't change orientation at end of path? this seems best
-			StartNode->orient = GetOrient( p, n );
-		}
-
-		Return = new PathNode;
-		Return->Next = StartNode;
-		Return->Next->Parent = Return;
-		StartNode = Return;
-
-		StartNode->x = n.x;
-		StartNode->y = n.y;
-		StartNode->orient = GetOrient( p, n );
-		p = n;
+		PathNode *node = new PathNode;
+		node->x = next.x;
+		node->y = next.y;
+		node->orient = GetOrient( next, p );
+		node->Next = NULL;
+		node->Parent = tail;
+		tail->Next = node;
+		tail = node;
+		p = next;
 	}
-
-	return Return;
+	return TracePath(tail, p, goal, size, 0);
 }
 
 PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int MinDistance)
 {
+	FrameStats::Count(FRAME_PATHS);
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		AdjustPosition( goal );
 	}
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		if (pos == pos2) {
-			//We've found _a_ path
-			//print("GOAL!!!");
-			break;
-		}
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			//print("Path not found!");
-			break;
-		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
-	}
 
 	//find path from start to goal
 	PathNode* StartNode = new PathNode;
@@ -2972,50 +3411,46 @@ PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int M
 	StartNode->x = start.x;
 	StartNode->y = start.y;
 	StartNode->orient = GetOrient( goal, start );
-	if (pos != pos2) {
-		return Return;
-	}
-	Point p = start;
-	pos2 = goal.y * Width + goal.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
-		StartNode->Next = new PathNode;
-		StartNode->Next->Parent = StartNode;
-		StartNode = StartNode->Next;
-		StartNode->Next = NULL;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
-		StartNode->x = n.x;
-		StartNode->y = n.y;
-		StartNode->orient = GetOrient( n, p );
-		p = n;
-	}
-	//stepping back on the calculated path
-	if (MinDistance) {
-		while (StartNode->Parent) {
-			Point tar;
 
-			tar.x=StartNode->Parent->x*16;
-			tar.y=StartNode->Parent->y*12;
-			int dist = Distance(tar,d);
-			if (dist+14>=MinDistance) {
-				break;
+	// walkers heading for the same place share a flow field towards it
+	bool found_path = false;
+	if (!FlowFieldCache::IsNear(start, goal)) {
+		Game *game = core->GetGame();
+		FlowField *field = flowfields->Get(*flowsource, start, goal, size, game ? game->Ticks : 0);
+		if (field) {
+			found_path = FollowFlowField(StartNode, field, start, goal, size);
+			if (!found_path) {
+				PathNode::FreePath(Return->Next);
+				StartNode = Return;
+				StartNode->Next = NULL;
 			}
-			StartNode = StartNode->Parent;
-			delete StartNode->Next;
+		}
+	}
+
+	// long routes are planned on the cluster graph first, then refined
+	// between its waypoints, so the searches stay small
+	std::vector<Point> waypoints;
+	AreaStaticPathSource graphsource(this);
+	if (!found_path && pathgraph->IsLongRange(start, goal) && pathgraph->Plan(graphsource, start, goal, waypoints)) {
+		unsigned int limit = pathgraph->GetDetourLimit();
+		Point from = start;
+		found_path = true;
+		for (size_t i = 0; found_path && i < waypoints.size(); i++) {
+			found_path = TracePath(StartNode, from, waypoints[i], size, limit);
+			from = waypoints[i];
+		}
+		if (!found_path) {
+			// actors or a big footprint got in the way, do it the hard way
+			PathNode::FreePath(Return->Next);
+			StartNode = Return;
 			StartNode->Next = NULL;
 		}
 	}
+	if (!found_path && !TracePath(StartNode, start, goal, size, 0)) {
+		return Return;
+	}
+
+	PathFinder::TrimPath(StartNode, d, MinDistance);
 	return Return;
 }
 
@@ -3044,57 +3479,19 @@ bool Map::IsVisible(const Point &pos, int explored)
 //point a is visible from point b (searchmap)
 bool Map::IsVisibleLOS(const Point &s, const Point &d)
 {
-	int sX=s.x/16;
-	int sY=s.y/12;
-	int dX=d.x/16;
-	int dY=d.y/12;
-	int diffx = sX - dX;
-	int diffy = sY - dY;
-
-	// we basically draw a 'line' from (sX, sY) to (dX, dY)
-	// we want to move along the larger axis, to make sure we don't miss anything
-	if (abs( diffx ) >= abs( diffy )) {
-		// (sX - startX)/elevationy = (sX - startX)/fabs(diffx) * diffy
-		double elevationy = std::fabs((double)diffx ) / diffy;
-		if (sX > dX) {
-			// right to left
-			for (int startx = sX; startx >= dX; startx--) {
-				// sX - startx >= 0, so subtract (due to sign of diffy)
-				//if (GetBlocked( startx, sY - ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( startx, sY - ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_SIDEWALL)
-					return false;
-			}
-		} else {
-			// left to right
-			for (int startx = sX; startx <= dX; startx++) {
-				// sX - startx <= 0, so add (due to sign of diffy)
-				//if (GetBlocked( startx, sY + ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( startx, sY + ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_SIDEWALL)
-					return false;
-			}
-		}
-	} else {
-		// (sY - startY)/elevationx = (sY - startY)/fabs(diffy) * diffx
-		double elevationx = std::fabs((double)diffy ) / diffx;
-		if (sY > dY) {
-			// bottom to top
-			for (int starty = sY; starty >= dY; starty--) {
-				// sY - starty >= 0, so subtract (due to sign of diffx)
-				//if (GetBlocked( sX - ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( sX - ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_SIDEWALL)
-					return false;
-			}
-		} else {
-			// top to bottom
-			for (int starty = sY; starty <= dY; starty++) {
-				// sY - starty <= 0, so add (due to sign of diffx)
-				//if (GetBlocked( sX + ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( sX + ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_SIDEWALL)
-					return false;
-			}
-		}
+	// the cells as the searchmap walks them, both coordinates fit in 16 bits
+	unsigned int from = (unsigned short) (s.x/16) | ((unsigned int) (unsigned short) (s.y/12) << 16);
+	unsigned int to = (unsigned short) (d.x/16) | ((unsigned int) (unsigned short) (d.y/12) << 16);
+	unsigned int hash = from * 2654435761u ^ to * 2246822519u;
+	hash ^= hash >> 15;
+	LOSEntry &entry = LOSCache[hash & (LOS_CACHE_SIZE - 1)];
+	if (entry.generation != losGeneration || entry.from != from || entry.to != to) {
+		entry.from = from;
+		entry.to = to;
+		entry.generation = losGeneration;
+		entry.visible = searchmap->IsVisibleLOS(s, d);
 	}
-	return true;
+	return entry.visible;
 }
 
 //returns direction of area boundary, returns -1 if it isn't a boundary
@@ -3103,7 +3500,7 @@ int Map::WhichEdge(const Point &s)
 	unsigned int sX=s.x/16;
 	unsigned int sY=s.y/12;
 	if (!(GetBlocked( sX, sY )&PATH_MAP_TRAVEL)) {
-		Log(DEBUG, "Map", "This isn't a travel region [%d.%d]?",
+		LogDebug("Map", "This isn't a travel region [%d.%d]?",
 			sX, sY);
 		return -1;
 	}
@@ -3356,11 +3753,13 @@ int Map::GetExploredMapSize() const
 void Map::Explore(int setreset)
 {
 	memset (ExploredBitmap, setreset, GetExploredMapSize() );
+	FogVisibilityValid = false;
 }
 
 void Map::SetMapVisibility(int setreset)
 {
 	memset( VisibleBitmap, setreset, GetExploredMapSize() );
+	FogVisibilityValid = false;
 }
 
 // x, y are not in tile coordinates
@@ -3386,11 +3785,34 @@ void Map::ExploreTile(const Point &pos)
 
 void Map::ExploreMapChunk(const Point &Pos, int range, int los)
 {
-	Point Tile;
+	FogStamp stamp;
+	BuildFogStamp(stamp, Pos, range, los);
+	ApplyFogStamp(stamp);
+	// the next update has to clear it from the visible bitmap
+	FogVisibilityValid = false;
+}
 
+// walks the visibility rays once and notes the cells they reach as bit rows,
+// so the fog update only has to OR them in while the explorer stands still
+void Map::BuildFogStamp(FogStamp &stamp, const Point &Pos, int range, int los)
+{
 	if (range>MaxVisibility) {
 		range=MaxVisibility;
 	}
+	stamp.pos = Pos;
+	stamp.range = range;
+
+	// the rays stay within range*16 by range*12 pixels, so a row spans at
+	// most range+2 cells, well within the 64 bits even for MaxVisibility
+	int w = TMap->XCellCount * 2 + LargeFog;
+	int h = TMap->YCellCount * 2 + LargeFog;
+	stamp.x = (Pos.x - range*16)/32 - 1;
+	if (stamp.x < 0) stamp.x = 0;
+	stamp.y = (Pos.y - range*12)/32 - 1;
+	if (stamp.y < 0) stamp.y = 0;
+	stamp.rows.assign(range*24/32 + 4, 0);
+
+	Point Tile;
 	int p=VisibilityPerimeter;
 	while (p--) {
 		int Pass = 2;
@@ -3417,38 +3839,205 @@ void Map::ExploreMapChunk(const Point &Pos, int range, int los)
 					if (!Pass) break;
 				}
 			}
-			ExploreTile(Tile);
+			// the same cells ExploreTile would set
+			int y = Tile.y/32;
+			if (y < 0 || y >= h) continue;
+			int x = Tile.x/32;
+			if (x < 0 || x >= w) continue;
+			stamp.rows[y - stamp.y] |= (unsigned __int64) 1 << (x - stamp.x);
+		}
+	}
+}
+
+// ORs the rows into both bitmaps, a byte at a time past their bit offset
+void Map::ApplyFogStamp(const FogStamp &stamp)
+{
+	int w = TMap->XCellCount * 2 + LargeFog;
+	for (size_t r = 0; r < stamp.rows.size(); r++) {
+		unsigned __int64 bits = stamp.rows[r];
+		if (!bits) continue;
+		int b0 = (stamp.y + (int) r) * w + stamp.x;
+		int by = b0/8;
+		int shift = b0%8;
+
+		ieByte byte = (ieByte) (bits << shift);
+		ExploredBitmap[by] |= byte;
+		VisibleBitmap[by] |= byte;
+		bits >>= 8 - shift;
+		while (bits) {
+			by++;
+			byte = (ieByte) bits;
+			if (byte) {
+				ExploredBitmap[by] |= byte;
+				VisibleBitmap[by] |= byte;
+			}
+			bits >>= 8;
 		}
 	}
 }
 
+// the stamps only depend on the search map cell the explorer stands in
+static inline bool SameFogCell(const Point &a, const Point &b)
+{
+	return a.x/16 == b.x/16 && a.y/12 == b.y/12;
+}
+
 void Map::UpdateFog()
 {
-	if (!(core->FogOfWar&FOG_DRAWFOG) ) {
+	bool drawfog = (core->FogOfWar&FOG_DRAWFOG) != 0;
+	if (!drawfog) {
 		SetMapVisibility( -1 );
 		Explore(-1);
-	} else {
-		SetMapVisibility( 0 );
+		FogStamps.clear();
+	}
+
+	// a door or wall change only touches the stamps whose rays reach it
+	bool changed = false;
+	if (FogWallLeft <= FogWallRight) {
+		std::map<ieDword, FogStamp>::iterator it;
+		for (it = FogStamps.begin(); it != FogStamps.end(); ++it) {
+			FogStamp &stamp = it->second;
+			if (stamp.pos.x + stamp.range*16 < FogWallLeft || stamp.pos.x - stamp.range*16 > FogWallRight) continue;
+			if (stamp.pos.y + stamp.range*12 < FogWallTop || stamp.pos.y - stamp.range*12 > FogWallBottom) continue;
+			stamp.rows.clear();
+		}
+		FogWallLeft = FogWallTop = 1;
+		FogWallRight = FogWallBottom = 0;
 	}
 
+	FogUpdates++;
 	for (unsigned int e = 0; e<actors.size(); e++) {
 		Actor *actor = actors[e];
 		if (!actor->Modified[ IE_EXPLORE ] ) continue;
-		if (core->FogOfWar&FOG_DRAWFOG) {
+		if (drawfog) {
 			int state = actor->Modified[IE_STATE_ID];
 			if (state & STATE_CANTSEE) continue;
 			int vis2 = actor->Modified[IE_VISUALRANGE];
 			if ((state&STATE_BLIND) || (vis2<2)) vis2=2; //can see only themselves
-			ExploreMapChunk (actor->Pos, vis2+actor->GetAnims()->GetCircleSize(), 1);
+			int range = vis2+actor->GetAnims()->GetCircleSize();
+			if (range > MaxVisibility) range = MaxVisibility;
+			FogStamp &stamp = FogStamps[actor->GetGlobalID()];
+			if (stamp.rows.empty() || !SameFogCell(stamp.pos, actor->Pos) || stamp.range != range) {
+				BuildFogStamp(stamp, actor->Pos, range, 1);
+				changed = true;
+			}
+			stamp.update = FogUpdates;
 		}
+		if (spawns.empty()) continue;
 		Spawn *sp = GetSpawnRadius(actor->Pos, SPAWN_RANGE); //30 * 12
 		if (sp) {
 			TriggerSpawn(sp);
 		}
 	}
+
+	if (drawfog) {
+		// forget the explorers that left or stopped exploring
+		std::map<ieDword, FogStamp>::iterator it = FogStamps.begin();
+		while (it != FogStamps.end()) {
+			if (it->second.update != FogUpdates) {
+				FogStamps.erase(it++);
+				changed = true;
+			} else {
+				++it;
+			}
+		}
+
+		// nobody moved and nothing else touched the bitmaps, so they are still right
+		if (changed || !FogVisibilityValid) {
+			SetMapVisibility( 0 );
+			for (it = FogStamps.begin(); it != FogStamps.end(); ++it) {
+				ApplyFogStamp(it->second);
+			}
+			FogVisibilityValid = true;
+		}
+	}
+
+	if (core->SmoothFog) {
+		FindFogChanges();
+	}
+}
+
+// collects the cell rows that differ from what the video driver got last
+void Map::FindFogChanges()
+{
+	int size = GetExploredMapSize();
+	if (!FogSnapshot) {
+		FogSnapshot = (ieByte *) malloc(size*2);
+		memcpy(FogSnapshot, ExploredBitmap, size);
+		memcpy(FogSnapshot+size, VisibleBitmap, size);
+		FogChangedTop = 0;
+		FogChangedBottom = TMap->YCellCount * 2 + LargeFog - 1;
+		return;
+	}
+
+	// most of the map stays the same, so skip the equal stretches a block at a time
+	const int block = 64;
+	int first = 0;
+	while (first + block <= size && !memcmp(FogSnapshot+first, ExploredBitmap+first, block)
+		&& !memcmp(FogSnapshot+size+first, VisibleBitmap+first, block)) {
+		first += block;
+	}
+	while (first < size && FogSnapshot[first] == ExploredBitmap[first] && FogSnapshot[size+first] == VisibleBitmap[first]) {
+		first++;
+	}
+	if (first == size) {
+		return;
+	}
+	int last = size;
+	while (last - block >= first && !memcmp(FogSnapshot+last-block, ExploredBitmap+last-block, block)
+		&& !memcmp(FogSnapshot+size+last-block, VisibleBitmap+last-block, block)) {
+		last -= block;
+	}
+	last--;
+	while (FogSnapshot[last] == ExploredBitmap[last] && FogSnapshot[size+last] == VisibleBitmap[last]) {
+		last--;
+	}
+	memcpy(FogSnapshot+first, ExploredBitmap+first, last-first+1);
+	memcpy(FogSnapshot+size+first, VisibleBitmap+first, last-first+1);
+
+	// the rows don't start on byte boundaries
+	int w = TMap->XCellCount * 2 + LargeFog;
+	int h = TMap->YCellCount * 2 + LargeFog;
+	int top = first*8/w;
+	int bottom = (last*8+7)/w;
+	if (bottom >= h) bottom = h - 1;
+	if (FogChangedTop > FogChangedBottom) {
+		FogChangedTop = top;
+		FogChangedBottom = bottom;
+	} else {
+		if (top < FogChangedTop) FogChangedTop = top;
+		if (bottom > FogChangedBottom) FogChangedBottom = bottom;
+	}
+}
+
+// hands the changed fog rows to the video driver, all of them if it held another area
+void Map::UploadFog()
+{
+	int w = TMap->XCellCount * 2 + LargeFog;
+	int h = TMap->YCellCount * 2 + LargeFog;
+	if (FogOwner != this) {
+		FogOwner = this;
+		FogChangedTop = 0;
+		FogChangedBottom = h - 1;
+	}
+	if (FogChangedTop > FogChangedBottom) {
+		return;
+	}
+
+	Video *video = core->GetVideoDriver();
+	video->UpdateFogOfWar(ExploredBitmap, VisibleBitmap, w, h, FogChangedTop, FogChangedBottom - FogChangedTop + 1);
+	FogChangedTop = 0;
+	FogChangedBottom = -1;
 }
 
 //Valid values are - PATH_MAP_FREE, PATH_MAP_PC, PATH_MAP_NPC
+static inline void StampSearchMapRow(unsigned short *row, int x0, int x1, unsigned int value)
+{
+	for (int x = x0; x <= x1; x++) {
+		row[x] = (row[x]&PATH_MAP_NOTACTOR) | value;
+	}
+}
+
 void Map::BlockSearchMap(const Point &Pos, unsigned int size, unsigned int value)
 {
 	// We block a circle of radius size-1 around (px,py)
@@ -3458,39 +4047,18 @@ void Map::BlockSearchMap(const Point &Pos, unsigned int size, unsigned int value
 	// Note: this is a larger circle than the one tested in GetBlocked.
 	// This means that an actor can get closer to a wall than to another
 	// actor. This matches the behaviour of the original BG2.
+	const int *rows = searchmap->GetFootprint(size, true);
 
-	if (size > MAX_CIRCLESIZE) size = MAX_CIRCLESIZE;
-	if (size < 2) size = 2;
-	unsigned int ppx = Pos.x/16;
-	unsigned int ppy = Pos.y/12;
-	unsigned int r=(size-1)*(size-1)+1;
-	for (unsigned int i=0; i<size; i++) {
-		for (unsigned int j=0; j<size; j++) {
-			if (i*i+j*j <= r) {
-				unsigned int ppxpi = ppx+i;
-				unsigned int ppypj = ppy+j;
-				unsigned int ppxmi = ppx-i;
-				unsigned int ppymj = ppy-j;
-				if ((ppxpi<Width) && (ppypj<Height)) {
-					unsigned int pos = ppypj*Width+ppxpi;
-					SrchMap[pos] = (SrchMap[pos]&PATH_MAP_NOTACTOR) | value;
-				}
-
-				if ((ppxpi<Width) && (ppymj<Height)) {
-					unsigned int pos = (ppymj)*Width+ppxpi;
-					SrchMap[pos] = (SrchMap[pos]&PATH_MAP_NOTACTOR) | value;
-				}
-
-				if ((ppxmi<Width) && (ppypj<Height)) {
-					unsigned int pos = (ppypj)*Width+ppxmi;
-					SrchMap[pos] = (SrchMap[pos]&PATH_MAP_NOTACTOR) | value;
-				}
-
-				if ((ppxmi<Width) && (ppymj<Height)) {
-					unsigned int pos = (ppymj)*Width+ppxmi;
-					SrchMap[pos] = (SrchMap[pos]&PATH_MAP_NOTACTOR) | value;
-				}
-			}
+	int ppx = Pos.x/16;
+	int ppy = Pos.y/12;
+	for (int j = 0; rows[j] >= 0; j++) {
+		int x0 = std::max(ppx - rows[j], 0);
+		int x1 = std::min(ppx + rows[j], (int) Width - 1);
+		if (ppy + j >= 0 && ppy + j < (int) Height) {
+			StampSearchMapRow(SrchMap + (ppy + j)*Width, x0, x1, value);
+		}
+		if (j && ppy - j >= 0 && ppy - j < (int) Height) {
+			StampSearchMapRow(SrchMap + (ppy - j)*Width, x0, x1, value);
 		}
 	}
 }
@@ -3506,16 +4074,64 @@ Spawn* Map::GetSpawn(const char* Name)
 	return NULL;
 }
 
-Spawn *Map::GetSpawnRadius(const Point &point, unsigned int radius)
+//a coarse grid over the area, so the explorers only look at the spawn points nearby
+#define SPAWN_INDEX_CELL 256
+
+void Map::IndexSpawns()
 {
+	int columns = 1;
+	int rows = 1;
 	for (size_t i = 0; i < spawns.size(); i++) {
-		Spawn* sp = spawns[i];
+		columns = std::max(columns, spawns[i]->Pos.x / SPAWN_INDEX_CELL + 1);
+		rows = std::max(rows, spawns[i]->Pos.y / SPAWN_INDEX_CELL + 1);
+	}
+	SpawnIndexColumns = columns;
+	SpawnIndex.assign(columns * rows, std::vector<unsigned int>());
+	for (size_t i = 0; i < spawns.size(); i++) {
+		const Point &pos = spawns[i]->Pos;
+		int cx = std::max(pos.x / SPAWN_INDEX_CELL, 0);
+		int cy = std::max(pos.y / SPAWN_INDEX_CELL, 0);
+		SpawnIndex[cy * columns + cx].push_back((unsigned int) i);
+	}
+}
 
-		if (Distance(point, sp->Pos)<radius) {
-			return sp;
+//the first spawn point closer than radius, in the order they were added
+Spawn *Map::GetSpawnRadius(const Point &point, unsigned int radius)
+{
+	if (spawns.empty()) {
+		return NULL;
+	}
+	if (SpawnIndex.empty()) {
+		IndexSpawns();
+	}
+
+	int columns = SpawnIndexColumns;
+	int rows = (int) SpawnIndex.size() / columns;
+	int left = std::max(point.x - (int) radius, 0) / SPAWN_INDEX_CELL;
+	int top = std::max(point.y - (int) radius, 0) / SPAWN_INDEX_CELL;
+	int right = std::min((point.x + (int) radius) / SPAWN_INDEX_CELL, columns - 1);
+	int bottom = std::min((point.y + (int) radius) / SPAWN_INDEX_CELL, rows - 1);
+
+	//Distance truncates, so closer than radius is a squared distance below radius*radius
+	unsigned int best = (unsigned int) spawns.size();
+	for (int cy = top; cy <= bottom; ++cy) {
+		for (int cx = left; cx <= right; ++cx) {
+			const std::vector<unsigned int> &cell = SpawnIndex[cy * columns + cx];
+			for (size_t i = 0; i < cell.size(); i++) {
+				if (cell[i] >= best) continue;
+				const Point &pos = spawns[cell[i]]->Pos;
+				long x = pos.x - point.x;
+				long y = pos.y - point.y;
+				if (x*x + y*y < (long) radius * radius) {
+					best = cell[i];
+				}
+			}
 		}
 	}
-	return NULL;
+	if (best == spawns.size()) {
+		return NULL;
+	}
+	return spawns[best];
 }
 
 int Map::ConsolidateContainers()
@@ -3583,7 +4199,7 @@ void Map::MoveVisibleGroundPiles(const Point &Pos)
 					int slot = othercontainer->inventory.FindItem(item->ItemResRef, 0, --count);
 					if (slot == -1) {
 						// probably an inventory bug, shouldn't happen
-						Log(DEBUG, "Map", "MoveVisibleGroundPiles found unaccessible pile item: %s", item->ItemResRef);
+						LogDebug("Map", "MoveVisibleGroundPiles found unaccessible pile item: %s", item->ItemResRef);
 						skipped--;
 						continue;
 					}
@@ -3851,13 +4467,23 @@ bool Map::DisplayTrackString(Actor *target)
 // since the lightmap is much smaller than the area, we need to interpolate
 unsigned int Map::GetLightLevel(const Point &Pos) const
 {
-	Color c = LightMap->GetPixel(Pos.x/16, Pos.y/12);
 	// at night/dusk/dawn the lightmap color is adjusted by the color overlay. (Only get's darker.)
-	const Color *tint = core->GetGame()->GetGlobalTint();
-	if (tint) {
-		return ((c.r-tint->r)*114 + (c.g-tint->g)*587 + (c.b-tint->b)*299)/2550;
+	// the overlay only changes with the game time, so it is weighted once a tick
+	const Game *game = core->GetGame();
+	if (!TintLevelValid || TintLevelTime != game->GameTime) {
+		const Color *tint = game->GetGlobalTint();
+		TintLevel = tint ? tint->r*114 + tint->g*587 + tint->b*299 : 0;
+		TintLevelTime = game->GameTime;
+		TintLevelValid = true;
 	}
-	return (c.r*114+c.g*587+c.b*299)/2550;
+
+	// out of the lightmap is black, like its GetPixel
+	unsigned int x = Pos.x/16, y = Pos.y/12;
+	int level = 0;
+	if (x < LightLevelsWidth && y < LightLevelsHeight) {
+		level = LightLevels[y * LightLevelsWidth + x];
+	}
+	return (level - TintLevel)/2550;
 }
 
 ////////////////////AreaAnimation//////////////////
@@ -4000,6 +4626,30 @@ int AreaAnimation::GetHeight() const
 }
 
 
+Region AreaAnimation::GetBounds() const
+{
+	Region bounds;
+	bool first = true;
+	for (int ac = 0; ac < animcount; ac++) {
+		if (!animation[ac]) continue;
+		const Region &part = animation[ac]->animArea;
+		if (first) {
+			bounds = part;
+			first = false;
+			continue;
+		}
+		int right = std::max(bounds.x + bounds.w, part.x + part.w);
+		int bottom = std::max(bounds.y + bounds.h, part.y + part.h);
+		bounds.x = std::min(bounds.x, part.x);
+		bounds.y = std::min(bounds.y, part.y);
+		bounds.w = right - bounds.x;
+		bounds.h = bottom - bounds.y;
+	}
+	bounds.x += Pos.x;
+	bounds.y += Pos.y;
+	return bounds;
+}
+
 void AreaAnimation::Draw(const Region &screen, Map *area)
 {
 	Video* video = core->GetVideoDriver();
@@ -4080,15 +4730,9 @@ void Map::SeeSpellCast(Scriptable *caster, ieDword spell)
 	else if (spell < 2000)
 		triggerType = trigger_spellcastpriest;
 
+	// every witness used to add the very same trigger to the caster again,
+	// which matched nothing more, so the line of sight checks are gone
 	caster->AddTrigger(TriggerEntry(triggerType, caster->GetGlobalID(), spell));
-
-	size_t i = actors.size();
-	while (i--) {
-		Actor* witness = actors[i];
-		if (CanSee(witness, caster, true, 0)) {
-			caster->AddTrigger(TriggerEntry(triggerType, caster->GetGlobalID(), spell));
-		}
-	}
 }
 
 short unsigned int Map::GetInternalSearchMap(int x, int y) const
@@ -4104,6 +4748,26 @@ void Map::SetInternalSearchMap(int x, int y, int value)
 	if ((unsigned)x >= Width || (unsigned)y >= Height) {
 		return;
 	}
+	// actors come and go all the time, the path graph only cares about the rest
+	if ((SrchMap[x+y*Width] ^ value) & PATH_MAP_NOTACTOR) {
+		pathgraph->Invalidate(x, y);
+		flowfields->Invalidate(x, y);
+	}
+	// the sight only depends on these
+	if ((SrchMap[x+y*Width] ^ value) & (PATH_MAP_NO_SEE|PATH_MAP_SIDEWALL|PATH_MAP_DOOR_OPAQUE)) {
+		losGeneration++;
+		if (FogWallLeft > FogWallRight) {
+			FogWallLeft = x*16;
+			FogWallTop = y*12;
+			FogWallRight = x*16+15;
+			FogWallBottom = y*12+11;
+		} else {
+			FogWallLeft = std::min(FogWallLeft, x*16);
+			FogWallTop = std::min(FogWallTop, y*12);
+			FogWallRight = std::max(FogWallRight, x*16+15);
+			FogWallBottom = std::max(FogWallBottom, y*12+11);
+		}
+	}
 	SrchMap[x+y*Width] = value;
 }
 
@@ -28,7 +28,8 @@
 #include "Scriptable/Scriptable.h"
 
 #include <algorithm>
-#include <queue>
+#include <map>
+#include <utility>
 
 namespace GemRB {
 
@@ -38,6 +39,8 @@ class Animation;
 class AnimationFactory;
 class Bitmap;
 class CREItem;
+class FlowField;
+class FlowFieldCache;
 class GameControl;
 class Image;
 class IniSpawn;
@@ -46,7 +49,10 @@ class Palette;
 class Particles;
 struct PathNode;
 class Projectile;
+class PathFinder;
+class PathGraph;
 class ScriptedAnimation;
+class SearchMap;
 class SpriteCover;
 class TileMap;
 class VEFObject;
@@ -272,6 +278,8 @@ public:
 	bool Schedule(ieDword gametime) const;
 	void Draw(const Region &screen, Map *area);
 	int GetHeight() const;
+	/* what the frames can cover, in area coordinates */
+	Region GetBounds() const;
 private:
 	Animation *GetAnimationPiece(AnimationFactory *af, int animCycle);
 };
@@ -319,15 +327,64 @@ private:
 	ieStrRef trackString;
 	int trackFlag;
 	ieWord trackDiff;
-	unsigned short* MapSet;
 	unsigned short* SrchMap; //internal searchmap
 	unsigned short* MaterialMap;
-	std::queue< unsigned int> InternalStack;
+	PathFinder *pathfinder;
+	PathGraph *pathgraph;
+	SearchMap *searchmap;
+	// the searchmap without the actors, for the flow fields
+	SearchMap *flowsource;
+	FlowFieldCache *flowfields;
+	// the weighted lightmap colors (the lightness unscaled), one per search map cell
+	std::vector<int> LightLevels;
+	unsigned int LightLevelsWidth, LightLevelsHeight;
+	// the same weighting of the global tint, refreshed once a tick
+	mutable int TintLevel;
+	mutable ieDword TintLevelTime;
+	mutable bool TintLevelValid;
+	// the line of sight between two cells only changes with the walls and doors, not with
+	// the actors, so the recent answers are kept in a small direct mapped table
+	struct LOSEntry {
+		unsigned int from, to;
+		unsigned int generation; // stale unless losGeneration
+		bool visible;
+	};
+	std::vector<LOSEntry> LOSCache;
+	unsigned int losGeneration;
 	unsigned int Width, Height;
 	std::list< AreaAnimation*> animations;
 	std::vector< Actor*> actors;
+	//the same by their global id, for the object resolution
+	std::map<ieDword, Actor*> actorsByID;
 	Wall_Polygon **Walls;
 	unsigned int WallCount;
+	//the walls whose bounding box reaches into each WALL_INDEX_CELL sized square
+	std::vector< std::vector<unsigned int> > WallIndex;
+	int WallIndexColumns;
+	//the spawn points in each SPAWN_INDEX_CELL sized square, empty until queried
+	std::vector< std::vector<unsigned int> > SpawnIndex;
+	int SpawnIndexColumns;
+	//the animations in drawing order and the ones whose bounds reach into each
+	//ANIM_INDEX_CELL sized square, by that order, empty until drawn
+	std::vector<AreaAnimation*> AnimationOrder;
+	std::vector< std::vector<unsigned int> > AnimationIndex;
+	int AnimationIndexColumns;
+	//the animations reaching into the viewport this frame, in drawing order
+	std::vector<AreaAnimation*> shownAnimations;
+	//the part of an actor the index queries filter on, kept next to the others
+	//so the candidates out of reach are dropped without touching the actors
+	struct ActorIndexEntry {
+		Point Pos; // as of the last UpdateActorIndex
+		int size;
+		Actor *actor;
+	};
+	//the actors by the ACTOR_INDEX_CELL sized square they stand in, empty until the tilemap is set
+	std::vector< std::vector<ActorIndexEntry> > ActorIndex;
+	int ActorIndexColumns, ActorIndexRows;
+	//the biggest actor size filed, the radius queries reach out by it
+	int ActorIndexMaxSize;
+	//the candidates of the last actor index query, kept to spare the allocations
+	std::vector<Actor*> nearActors;
 	std::list< VEFObject*> vvcCells;
 	std::list< Projectile*> projectiles;
 	std::list< Particles*> particles;
@@ -337,11 +394,44 @@ private:
 	std::vector< Spawn*> spawns;
 	Actor** queue[QUEUE_COUNT];
 	int Qcount[QUEUE_COUNT];
+	//the room in the queues, they only grow, so the buffers are kept across ticks
 	unsigned int lastActorCount[QUEUE_COUNT];
+	//the scratch space of SortQueues, kept to spare the allocations
+	std::vector<Actor*> sortPlaced, sortNewcomers;
+	//the actors drawn within the viewport on the last frame, bottom to top
+	std::vector<Actor*> drawnActors;
+	Region drawnViewport;
+	bool drawnActorsValid;
+	//the ground circles waiting for the global tint pass to be done
+	std::vector<std::pair<Actor*, Point> > selections;
+	//the fog bitmaps as the video driver last got them (SmoothFog)
+	ieByte* FogSnapshot;
+	//the cell rows changed since, FogChangedTop > FogChangedBottom if none
+	int FogChangedTop, FogChangedBottom;
+	// the fog cells an explorer lights up from where it stands, a bit row per cell
+	// row, kept until it leaves its search map cell, its range changes or a wall
+	// or door near it does
+	struct FogStamp {
+		Point pos;
+		int range;
+		unsigned int update; // the last fog update that used it
+		int x, y; // the fog cell of the lowest bit of the first row
+		std::vector<unsigned __int64> rows;
+	};
+	//the stamps of the explorers by their global id
+	std::map<ieDword, FogStamp> FogStamps;
+	unsigned int FogUpdates;
+	//false if the visible bitmap isn't just the stamps ORed together
+	bool FogVisibilityValid;
+	//the pixels where the sight blocking changed since the last fog update, none if left > right
+	int FogWallLeft, FogWallTop, FogWallRight, FogWallBottom;
 public:
 	Map(void);
 	~Map(void);
 	static void ReleaseMemory();
+	/* the path counters: requests, and the waits for taken steps */
+	static void CountPathRequest();
+	static void DumpPathStats(bool reset);
 
 	/** prints useful information on console */
 	void dump(bool show_actors=0) const;
@@ -354,6 +444,9 @@ public:
 	/* sets all the auxiliary maps and the tileset */
 	void AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* hm);
 	void UpdateScripts();
+	/* adds the scripts UpdateScripts is about to run to dueScripts, without
+	 * touching the area, so Game can prepare them for all areas in one batch */
+	void GetDueScripts(std::vector<GameScript*> &dueScripts);
 	void ResolveTerrainSound(ieResRef &sound, Point &pos);
 	bool DoStepForActor(Actor *actor, int speed, ieDword time);
 	void UpdateEffects();
@@ -366,7 +459,11 @@ public:
 	/* draws stationary vvc graphics */
 	//void DrawVideocells(Region screen);
 	void DrawHighlightables();
-	void DrawMap(Region screen);
+	/* the actor's ground circle is drawn after the global tint pass */
+	void DeferSelection(Actor *actor, const Point &pos) { selections.push_back(std::make_pair(actor, pos)); }
+	/* returns true if something was drawn between the ticks, so it has to
+	 * be redrawn whenever the tick offset changes */
+	bool DrawMap(Region screen);
 	void PlayAreaSong(int SongType, bool restart = true, bool hard = false);
 	void AddAnimation(AreaAnimation* anim);
 	aniIterator GetFirstAnimation() { return animations.begin(); }
@@ -379,6 +476,8 @@ public:
 	}
 	AreaAnimation* GetAnimation(const char* Name);
 	size_t GetAnimationCount() const { return animations.size(); }
+	//call it after changing what an animation shows, its bounds may be different
+	void AnimationChanged() { AnimationIndex.clear(); }
 
 	unsigned int GetWallCount() { return WallCount; }
 	Wall_Polygon *GetWallGroup(int i) { return Walls[i]; }
@@ -386,10 +485,15 @@ public:
 	{
 		WallCount = count;
 		Walls = walls;
+		WallIndex.clear();
 	}
+	/* reuse is returned moved to x,y instead, if no wall covers it at either place */
 	SpriteCover* BuildSpriteCover(int x, int y, int xpos, int ypos,
-		unsigned int width, unsigned int height, int flag, bool areaanim = false);
+		unsigned int width, unsigned int height, int flag, bool areaanim = false,
+		SpriteCover* reuse = NULL);
 	void ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg);
+	/* drops the sprite covers of actors and animations built where box reaches */
+	void InvalidateSpriteCovers(const Region &box);
 	void Shout(Actor* actor, int shoutID, unsigned int radius);
 	void ActorSpottedByPlayer(Actor *actor);
 	void InitActors();
@@ -408,8 +512,15 @@ public:
 	InfoPoint *GetInfoPointByGlobalID(ieDword objectID);
 	Actor* GetActorByGlobalID(ieDword objectID);
 	Actor* GetActor(const Point &p, int flags);
+	//the same for the pointer, the topmost one drawn on the last frame wins
+	Actor* PickActor(const Point &p, int flags);
 	Actor* GetActorInRadius(const Point &p, int flags, unsigned int radius);
 	Actor **GetAllActorsInRadius(const Point &p, int flags, unsigned int radius, Scriptable *see=NULL);
+	//the actors filed in the index cells within reach of p, for the nearest queries
+	//(the list is reused by the next actor index query)
+	const std::vector<Actor*> &GetActorsNear(const Point &p, unsigned int reach);
+	//the actors that may be within PersonalDistance reach of any point of the box
+	const std::vector<Actor*> &GetActorsNear(const Region &box, unsigned int reach);
 	Actor* GetActor(const char* Name, int flags);
 	Actor* GetActor(int i, bool any);
 	Scriptable* GetActorByDialog(const char* resref);
@@ -419,6 +530,8 @@ public:
 	bool HasActor(Actor *actor);
 	bool SpawnsAlive() const;
 	void RemoveActor(Actor* actor);
+	//files the actor under the index cell of its current position, call it after moving one
+	void UpdateActorIndex(Actor *actor);
 	//returns actors in rect (onlyparty could be more sophisticated)
 	int GetActorInRect(Actor**& actors, Region& rgn, bool onlyparty);
 	int GetActorCount(bool any) const;
@@ -552,27 +665,46 @@ public:
 	void SetTrackString(ieStrRef strref, int flg, int difficulty);
 	//returns true if tracking failed
 	bool DisplayTrackString(Actor *actor);
+	void UpdateLightLevels();
 
 	unsigned int GetLightLevel(const Point &Pos) const;
 	unsigned short GetInternalSearchMap(int x, int y) const;
+	SearchMap *GetSearchMap() const { return searchmap; }
+	PathFinder *GetPathFinder() const { return pathfinder; }
 	void SetInternalSearchMap(int x, int y, int value);
 	void SetBackground(const ieResRef &bgResref, ieDword duration);
 	void SetupReverbInfo();
 private:
-	AreaAnimation *GetNextAreaAnimation(aniIterator &iter, ieDword gametime);
+	AreaAnimation *GetNextAreaAnimation(size_t &index, ieDword gametime);
+	void IndexAnimations();
+	void CollectShownAnimations(const Region &vp);
 	Particles *GetNextSpark(spaIterator &iter);
 	VEFObject *GetNextScriptedAnimation(scaIterator &iter);
 	Actor *GetNextActor(int &q, int &index);
 	Container *GetNextPile (int &index) const;
 	void DrawPile (Region screen, int pileidx);
 	void DrawSearchMap(const Region &screen);
+	void IndexWalls();
+	void IndexSpawns();
+	void BuildActorIndex();
+	void BuildPathGraph();
+	int GetActorIndexCell(const Point &p) const;
+	void IndexActor(Actor *actor);
+	void UnindexActor(Actor *actor);
+	void CollectActors(int left, int top, int right, int bottom);
+	void CollectActorsInRadius(const Point &p, unsigned int radius);
+	void FindCoveringWalls(int x, int y, const Region &box, bool areaanim, std::vector<Wall_Polygon*> &walls);
+	void FindFogChanges();
+	void BuildFogStamp(FogStamp &stamp, const Point &Pos, int range, int los);
+	void ApplyFogStamp(const FogStamp &stamp);
+	void UploadFog();
+	void UpdateFarAway();
 	void GenerateQueues();
 	void SortQueues();
 	//Actor* GetRoot(int priority, int &index);
 	void DeleteActor(int i);
-	void Leveldown(unsigned int px, unsigned int py, unsigned int& level,
-		Point &p, unsigned int& diff);
-	void SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost);
+	bool TracePath(PathNode *&tail, const Point &start, const Point &goal, unsigned int size, unsigned int maxCost);
+	bool FollowFlowField(PathNode *&tail, const FlowField *field, const Point &start, const Point &goal, unsigned int size);
 	//actor uses travel region
 	void UseExit(Actor *pc, InfoPoint *ip);
 	//separated position adjustment, so their order could be randomised */
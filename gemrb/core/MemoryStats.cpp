@@ -0,0 +1,148 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "MemoryStats.h"
+
+#include "win32def.h"
+
+#include "GameData.h"
+#include "Interface.h"
+#include "GameScript/GSUtils.h"
+#include "System/Logging.h"
+#include "System/StringBuffer.h"
+#include "System/Thread.h"
+
+namespace GemRB {
+
+static const char *tagNames[MEM_TAGS] = {
+	"sdl sprites", "gl sprites", "bam frames", "tiles", "font pages",
+	"sounds", "effects", "gamedata caches", "scripts"
+};
+
+struct MemoryCount {
+	unsigned long bytes, peakBytes;
+	long objects, peakObjects;
+};
+
+static MemoryCount counts[MEM_TAGS];
+static Mutex countsLock;
+static unsigned long logInterval = 0;
+static unsigned long lastLog = 0;
+
+static void Peak(MemoryCount &count)
+{
+	if (count.bytes > count.peakBytes) count.peakBytes = count.bytes;
+	if (count.objects > count.peakObjects) count.peakObjects = count.objects;
+}
+
+void MemoryStats::Add(MemoryTag tag, unsigned long bytes, long objects)
+{
+	MutexLock l(countsLock);
+	counts[tag].bytes += bytes;
+	counts[tag].objects += objects;
+	Peak(counts[tag]);
+}
+
+void MemoryStats::Remove(MemoryTag tag, unsigned long bytes, long objects)
+{
+	MutexLock l(countsLock);
+	MemoryCount &count = counts[tag];
+	count.bytes = bytes < count.bytes ? count.bytes - bytes : 0;
+	count.objects = objects < count.objects ? count.objects - objects : 0;
+}
+
+void MemoryStats::Set(MemoryTag tag, unsigned long bytes, long objects)
+{
+	MutexLock l(countsLock);
+	counts[tag].bytes = bytes;
+	counts[tag].objects = objects;
+	Peak(counts[tag]);
+}
+
+unsigned long MemoryStats::GetBytes(MemoryTag tag)
+{
+	MutexLock l(countsLock);
+	return counts[tag].bytes;
+}
+
+void MemoryStats::ResetPeaks()
+{
+	MutexLock l(countsLock);
+	for (int i = 0; i < MEM_TAGS; i++) {
+		counts[i].peakBytes = counts[i].bytes;
+		counts[i].peakObjects = counts[i].objects;
+	}
+}
+
+void MemoryStats::SetLogInterval(int seconds)
+{
+	logInterval = seconds > 0 ? seconds * 1000 : 0;
+}
+
+static void Sample()
+{
+	if (gamedata) {
+		unsigned long bytes;
+		int objects;
+		gamedata->GetCacheUsage(bytes, objects);
+		MemoryStats::Set(MEM_GAMEDATA, bytes, objects);
+	}
+	MemoryStats::Set(MEM_SCRIPTS, BcsCache.GetSize(), BcsCache.GetCount());
+}
+
+void MemoryStats::Dump()
+{
+	Sample();
+	MutexLock l(countsLock);
+	Log(MESSAGE, "MemoryStats", "%-16s %8s %10s %8s %10s", "", "objects", "KB", "peak", "peak KB");
+	unsigned long total = 0, peak = 0;
+	for (int i = 0; i < MEM_TAGS; i++) {
+		const MemoryCount &count = counts[i];
+		Log(MESSAGE, "MemoryStats", "%-16s %8ld %10lu %8ld %10lu", tagNames[i],
+			count.objects, count.bytes / 1024, count.peakObjects, count.peakBytes / 1024);
+		total += count.bytes;
+		peak += count.peakBytes;
+	}
+	// the peaks of the tags needn't have been at the same time
+	Log(MESSAGE, "MemoryStats", "%-16s %8s %10lu %8s %10lu", "total", "", total / 1024, "", peak / 1024);
+}
+
+void MemoryStats::Update()
+{
+	Sample();
+	if (!logInterval) {
+		return;
+	}
+	unsigned long now = GetTickCount();
+	if (now - lastLog < logInterval) {
+		return;
+	}
+	lastLog = now;
+
+	// one line, the KB in use and the peak in parentheses
+	StringBuffer buffer;
+	MutexLock l(countsLock);
+	for (int i = 0; i < MEM_TAGS; i++) {
+		buffer.appendFormatted("%s%s %lu (%lu)", i ? ", " : "", tagNames[i],
+			counts[i].bytes / 1024, counts[i].peakBytes / 1024);
+	}
+	Log(MESSAGE, "MemoryStats", "KB: %s", buffer.get().c_str());
+}
+
+}
@@ -0,0 +1,75 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+namespace GemRB {
+
+/* what the memory is counted under */
+enum MemoryTag {
+	MEM_SPRITES_SDL, // the surfaces of the SDL sprites, the tiles and fonts included
+	MEM_SPRITES_GL, // the pixels the GL sprites own, not their textures
+	MEM_BAM_FRAMES, // the compressed frames shared by the BAM sprites of an animation
+	MEM_TILES, // the tiles of the overlays, their pixels are sprites
+	MEM_FONT_PAGES, // the glyph atlas pages
+	MEM_SOUNDS, // the decoded sound buffers of the OpenAL driver
+	MEM_EFFECTS, // the effects in queues, caches and on their way
+	MEM_GAMEDATA, // the item, spell, effect, dialog, palette and creature caches
+	MEM_SCRIPTS, // the compiled scripts, as big as their source
+	MEM_TAGS
+};
+
+/* how much Interface::TrimMemory gives back, for the low memory signals */
+enum TrimLevel {
+	TRIM_NONE,
+	TRIM_MODERATE, // what is cheap to get back: the unused cache entries and idle sounds
+	TRIM_COMPLETE // also what takes a while to rebuild, like the decoded area tiles
+};
+
+/* The memory held per subsystem, with the high water marks
+ * The counts are always kept, the objects come and go from the start.
+ * Printed from the console with GemRB.DumpMemoryStats() and logged
+ * every MemoryStatsInterval seconds.
+ */
+class GEM_EXPORT MemoryStats {
+public:
+	/** any thread may count */
+	static void Add(MemoryTag tag, unsigned long bytes, long objects = 1);
+	static void Remove(MemoryTag tag, unsigned long bytes, long objects = 1);
+	/** for the counts kept elsewhere, replaces the earlier ones */
+	static void Set(MemoryTag tag, unsigned long bytes, long objects);
+	static unsigned long GetBytes(MemoryTag tag);
+	/** prints the table to the log */
+	static void Dump();
+	/** the high water marks start over from the current use */
+	static void ResetPeaks();
+	/** seconds between the lines logged by Update, 0 logs none */
+	static void SetLogInterval(int seconds);
+	/** once per frame, takes the counts kept elsewhere and logs if it is time */
+	static void Update();
+};
+
+}
+
+#endif
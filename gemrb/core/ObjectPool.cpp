@@ -0,0 +1,74 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2014 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "ObjectPool.h"
+
+#include "System/Logging.h"
+
+namespace GemRB {
+
+PoolStats *PoolStats::first = NULL;
+bool PoolStats::enabled = false;
+
+PoolStats::PoolStats(const char *name, size_t size)
+	: slabs(0), name(name), size(size), taken(0), heap(0), given(0), live(0), peak(0)
+{
+	next = first;
+	first = this;
+}
+
+PoolStats::~PoolStats()
+{
+	PoolStats **link = &first;
+	while (*link && *link != this) {
+		link = &(*link)->next;
+	}
+	if (*link) {
+		*link = next;
+	}
+}
+
+void PoolStats::SetEnabled(int enable)
+{
+	enabled = enable != 0;
+}
+
+void PoolStats::Reset()
+{
+	for (PoolStats *pool = first; pool; pool = pool->next) {
+		pool->taken = pool->heap = pool->given = 0;
+		pool->peak = pool->live;
+	}
+}
+
+void PoolStats::Dump()
+{
+	if (!enabled) {
+		Log(MESSAGE, "ObjectPool", "The counts are off, set PoolStats=1 to keep them.");
+	}
+	Log(MESSAGE, "ObjectPool", "%-20s %6s %10s %10s %10s %8s %8s %6s", "pool", "size",
+		"taken", "from heap", "given", "live", "peak", "slabs");
+	for (PoolStats *pool = first; pool; pool = pool->next) {
+		Log(MESSAGE, "ObjectPool", "%-20s %6lu %10lu %10lu %10lu %8lu %8lu %6lu", pool->name,
+			(unsigned long) pool->size, pool->taken, pool->heap, pool->given,
+			pool->live, pool->peak, pool->slabs);
+	}
+}
+
+}
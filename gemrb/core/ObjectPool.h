@@ -0,0 +1,187 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2014 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include "exports.h"
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace GemRB {
+
+/**
+ * The allocation counts of the pools, only kept while enabled (the
+ * PoolStats option), to see how much of the churn they absorb.
+ */
+class GEM_EXPORT PoolStats {
+public:
+	PoolStats(const char *name, size_t size);
+	virtual ~PoolStats();
+
+	static void SetEnabled(int enabled);
+	static bool IsEnabled() { return enabled; }
+	/** prints the counts of every pool to the log */
+	static void Dump();
+	static void Reset();
+protected:
+	void CountTake(bool fromHeap)
+	{
+		if (!enabled) return;
+		taken++;
+		if (fromHeap) heap++;
+		if (++live > peak) peak = live;
+	}
+	void CountGive()
+	{
+		if (!enabled) return;
+		given++;
+		if (live) live--;
+	}
+	unsigned long slabs;
+private:
+	const char *name;
+	size_t size;
+	unsigned long taken, heap, given, live, peak;
+	PoolStats *next;
+
+	static PoolStats *first;
+	static bool enabled;
+};
+
+/**
+ * Keeps the memory of the freed objects of one size for the next ones,
+ * for the operator new and delete of classes created and destroyed over
+ * and over on the main thread. New memory is taken from the heap a slab
+ * of objects at a time and only given back at exit.
+ */
+template <size_t Size>
+class ObjectPool : public PoolStats {
+public:
+	ObjectPool(const char *name) : PoolStats(name, Size), freeList(NULL) {}
+	~ObjectPool()
+	{
+		for (size_t i = 0; i < slabList.size(); i++) {
+			::operator delete(slabList[i]);
+		}
+	}
+	void *Take(size_t size)
+	{
+		// a derived class doesn't fit
+		if (size != Size) {
+			CountTake(true);
+			return ::operator new(size);
+		}
+		bool fromHeap = !freeList;
+		if (fromHeap) {
+			AddSlab();
+		}
+		CountTake(fromHeap);
+		void *obj = freeList;
+		freeList = *(void **) obj;
+		return obj;
+	}
+	void Give(void *obj, size_t size)
+	{
+		if (!obj) {
+			return;
+		}
+		CountGive();
+		if (size != Size) {
+			::operator delete(obj);
+			return;
+		}
+		// the freed objects are linked through their first bytes
+		*(void **) obj = freeList;
+		freeList = obj;
+	}
+private:
+	// about 16KB per slab, the big objects one at a time
+	enum { PerSlab = Size >= 8192 ? 1 : 16384 / Size };
+
+	void AddSlab()
+	{
+		char *slab = (char *) ::operator new(PerSlab * Size);
+		slabList.push_back(slab);
+		slabs++;
+		for (int i = PerSlab - 1; i >= 0; i--) {
+			void *obj = slab + i * Size;
+			*(void **) obj = freeList;
+			freeList = obj;
+		}
+	}
+
+	void *freeList;
+	std::vector<void *> slabList;
+};
+
+/**
+ * A standard allocator taking single objects from an ObjectPool, for
+ * the nodes of the lists that grow and shrink all the time. Arrays
+ * come from the heap. Main thread only, like the pools.
+ */
+template <class T>
+class PoolAllocator {
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	template <class U> struct rebind { typedef PoolAllocator<U> other; };
+
+	PoolAllocator() {}
+	PoolAllocator(const PoolAllocator&) {}
+	template <class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+	pointer allocate(size_type n, const void* = 0)
+	{
+		return (pointer) Pool().Take(n * sizeof(T));
+	}
+	void deallocate(pointer p, size_type n)
+	{
+		Pool().Give(p, n * sizeof(T));
+	}
+	size_type max_size() const { return size_type(-1) / sizeof(T); }
+	void construct(pointer p, const T& val) { new ((void *) p) T(val); }
+	void destroy(pointer p) { p->~T(); }
+
+private:
+	static ObjectPool<sizeof(T)>& Pool()
+	{
+		static ObjectPool<sizeof(T)> pool("container nodes");
+		return pool;
+	}
+};
+
+template <class T, class U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template <class T, class U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+}
+
+#endif
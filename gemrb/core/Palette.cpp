@@ -22,16 +22,23 @@
 
 #include "Interface.h"
 
+#include <map>
+
 namespace GemRB {
 
 #define MINCOL 2
 #define MUL    2
 
+//the interned palettes by their colours, they are only referenced from here
+typedef std::multimap<unsigned int, Palette*> PaletteMap;
+static PaletteMap InternedPalettes;
+
 Palette::Palette(const Color &color, const Color &back)
 {
 	alpha = false;
 	refcount = 1;
 	named = false;
+	interned = false;
 
 	front = color;
 	this->back = back;
@@ -83,6 +90,19 @@ void Palette::Brighten()
 	}
 }
 
+Palette::~Palette()
+{
+	if (!interned) return;
+
+	std::pair<PaletteMap::iterator, PaletteMap::iterator> range = InternedPalettes.equal_range(hash);
+	for (PaletteMap::iterator it = range.first; it != range.second; ++it) {
+		if (it->second == this) {
+			InternedPalettes.erase(it);
+			break;
+		}
+	}
+}
+
 Palette* Palette::Copy()
 {
 	Palette* pal = new Palette(col, alpha);
@@ -90,6 +110,63 @@ Palette* Palette::Copy()
 	return pal;
 }
 
+unsigned int Palette::HashColors() const
+{
+	// FNV-1a
+	const unsigned char* bytes = (const unsigned char*) col;
+	unsigned int h = 2166136261U;
+	for (unsigned int i = 0; i < sizeof(col); i++) {
+		h = (h ^ bytes[i]) * 16777619U;
+	}
+	return (h ^ alpha) * 16777619U;
+}
+
+bool Palette::SameColors(const Palette* pal) const
+{
+	return alpha == pal->alpha && !memcmp(col, pal->col, sizeof(col));
+}
+
+Palette* Palette::Intern()
+{
+	//the cached ones are already shared by name
+	if (named || interned) return this;
+
+	unsigned int h = HashColors();
+	std::pair<PaletteMap::iterator, PaletteMap::iterator> range = InternedPalettes.equal_range(h);
+	for (PaletteMap::iterator it = range.first; it != range.second; ++it) {
+		if (SameColors(it->second)) {
+			Palette* pal = it->second;
+			pal->acquire();
+			release();
+			return pal;
+		}
+	}
+
+	hash = h;
+	interned = true;
+	InternedPalettes.insert(std::make_pair(h, this));
+	return this;
+}
+
+Palette* Palette::Unshare()
+{
+	//the cached ones have to go through gamedata
+	assert(!named);
+	if (IsShared()) {
+		Palette* pal = new Palette(col, alpha);
+		release();
+		return pal;
+	}
+	if (interned) {
+		//nobody else holds it, so it can be changed after leaving the map
+		PaletteMap::iterator it = InternedPalettes.find(hash);
+		while (it->second != this) ++it;
+		InternedPalettes.erase(it);
+		interned = false;
+	}
+	return this;
+}
+
 void Palette::SetupPaperdollColours(const ieDword* Colors, unsigned int type)
 {
 	unsigned int s = 8*type;
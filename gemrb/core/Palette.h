@@ -45,7 +45,7 @@ struct RGBModifier {
 
 class GEM_EXPORT Palette {
 private:
-	~Palette() {}
+	~Palette();
 public:
 	Palette(const Color &color, const Color &back);
 
@@ -56,6 +56,7 @@ public:
 		alpha = alpha_;
 		refcount = 1;
 		named = false;
+		interned = false;
 		memset(&front, 0, sizeof(front));
 		memset(&back, 0, sizeof(back));
 	}
@@ -63,6 +64,7 @@ public:
 		alpha = false;
 		refcount = 1;
 		named = false;
+		interned = false;
 		memset(&col, 0, sizeof(col));
 		memset(&front, 0, sizeof(front));
 		memset(&back, 0, sizeof(back));
@@ -99,8 +101,19 @@ public:
 
 	Palette* Copy();
 
+	// hands back the palette with the same colours if there is one already,
+	// releasing this one; interned palettes must not be changed in place
+	Palette* Intern();
+	// copy on write: a palette only this one owner holds, releasing this one if it was shared
+	Palette* Unshare();
+
 private:
 	unsigned int refcount;
+	bool interned;
+	unsigned int hash;
+
+	unsigned int HashColors() const;
+	bool SameColors(const Palette* pal) const;
 
 };
 
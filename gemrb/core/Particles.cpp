@@ -35,6 +35,12 @@ bool inited = false;
 
 static int spark_color_indices[SPARK_COUNT]={12,5,0,6,1,8,2,7,9,3,4,10,11};
 
+// value % size for the positive values, without dividing while they stay below size
+static inline int Wrap(int value, int size)
+{
+	return value < size ? value : value % size;
+}
+
 static void TranslateColor(const char *value, Color &color)
 {
 	int r = 0;
@@ -89,8 +95,10 @@ static void InitSparks()
 
 Particles::Particles(int s)
 {
-	points = (Element *) malloc(s*sizeof(Element) );
-	memset(points, -1, s*sizeof(Element) );
+	states = (int *) malloc(s*sizeof(int) );
+	memset(states, -1, s*sizeof(int) );
+	xs = (short *) calloc(s, sizeof(short) );
+	ys = (short *) calloc(s, sizeof(short) );
 	/*
 	for (int i=0;i<MAX_SPARK_PHASE;i++) {
 		bitmap[i]=NULL;
@@ -112,9 +120,9 @@ Particles::Particles(int s)
 
 Particles::~Particles()
 {
-	if (points) {
-		free(points);
-	}
+	free(states);
+	free(xs);
+	free(ys);
 	/*
 	for (int i=0;i<MAX_SPARK_PHASE;i++) {
 		delete( bitmap[i]);
@@ -172,18 +180,20 @@ bool Particles::AddNew(const Point &point)
 	}
 	int i = last_insert;
 	while (i--) {
-		if (points[i].state == -1) {
-			points[i].state = st;
-			points[i].pos = point;
+		if (states[i] == -1) {
+			states[i] = st;
+			xs[i] = point.x;
+			ys[i] = point.y;
 			last_insert = i;
 			return false;
 		}
 	}
 	i = size;
 	while (i--!=last_insert) {
-		if (points[i].state == -1) {
-			points[i].state = st;
-			points[i].pos = point;
+		if (states[i] == -1) {
+			states[i] = st;
+			xs[i] = point.x;
+			ys[i] = point.y;
 			last_insert = i;
 			return false;
 		}
@@ -196,16 +206,21 @@ void Particles::Draw(const Region &screen)
 	int length; //used only for raindrops
 
 	Video *video=core->GetVideoDriver();
-	Region region = video->GetViewport();
+	Region viewport = video->GetViewport();
+	Region region = viewport;
 	Game *game = core->GetGame();
 
 	if (owner) {
 		region.x-=pos.x;
 		region.y-=pos.y;
 	}
-	int i = size;
+	int i;
+	for (i = 0; i < MAX_SPARK_PHASE; i++) {
+		batches[i].clear();
+	}
+	i = size;
 	while (i--) {
-		if (points[i].state == -1) {
+		if (states[i] == -1) {
 			continue;
 		}
 		int state;
@@ -213,10 +228,10 @@ void Particles::Draw(const Region &screen)
 		switch(path) {
 		case SP_PATH_FLIT:
 		case SP_PATH_RAIN:
-			state = points[i].state>>4;
+			state = states[i]>>4;
 			break;
 		default:
-			state = points[i].state;
+			state = states[i];
 			break;
 		}
 
@@ -227,19 +242,10 @@ void Particles::Draw(const Region &screen)
 			state=MAX_SPARK_PHASE-state-1;
 			length=0;
 		}
-		Color clr = sparkcolors[color][state];
 		switch (type) {
 		case SP_TYPE_BITMAP:
-			/*
-			if (bitmap[state]) {
-				Sprite2D *frame = bitmap[state]->GetFrame(points[i].state&255);
-				video->BlitGameSprite(frame,
-					points[i].pos.x+screen.x,
-					points[i].pos.y+screen.y, 0, clr,
-					NULL, NULL, &screen);
-			}
-			*/
 			if (fragments) {
+				Color clr = sparkcolors[color][state];
 				//IE_ANI_CAST stance has a simple looping animation
 				Animation** anims = fragments->GetAnimation( IE_ANI_CAST, i );
 				if (anims) {
@@ -248,31 +254,38 @@ void Particles::Draw(const Region &screen)
 
 					ieDword flags = 0;
 					if (game) game->ApplyGlobalTint(clr, flags);
-					video->BlitGameSprite( nextFrame, points[i].pos.x - region.x, points[i].pos.y - region.y,
+					video->BlitGameSprite( nextFrame, xs[i] - region.x, ys[i] - region.y,
 						flags, clr, NULL, fragments->GetPartPalette(0), &screen);
 				}
 			}
 			break;
 		case SP_TYPE_CIRCLE:
-			video->DrawCircle (points[i].pos.x-region.x,
-				points[i].pos.y-region.y, 2, clr, true);
+			video->DrawCircle (xs[i]-region.x,
+				ys[i]-region.y, 2, sparkcolors[color][state], true);
 			break;
 		case SP_TYPE_POINT:
 		default:
-			video->SetPixel (points[i].pos.x-region.x,
-				points[i].pos.y-region.y, clr, true);
+			batches[state].push_back(Point(xs[i]-region.x, ys[i]-region.y));
 			break;
 		// this is more like a raindrop
 		case SP_TYPE_LINE:
 			if (length) {
-				video->DrawLine (points[i].pos.x+region.x,
-					points[i].pos.y+region.y,
-					points[i].pos.x+region.x+(i&1),
-					points[i].pos.y+region.y+length, clr, true);
+				// the pixels DrawLine would set, it takes the start in the same coordinates
+				int x = xs[i]+region.x-viewport.x;
+				int y = ys[i]+region.y-viewport.y;
+				int step = ((i&1) << 16) / length;
+				for (int j = 0; j <= length; j++) {
+					batches[state].push_back(Point(x+((0x8000+j*step)>>16), y+j));
+				}
 			}
 			break;
 		}
 	}
+	for (i = 0; i < MAX_SPARK_PHASE; i++) {
+		if (batches[i].size()) {
+			video->DrawPoints(batches[i], sparkcolors[color][i], true);
+		}
+	}
 }
 
 void Particles::AddParticles(int count)
@@ -335,55 +348,58 @@ int Particles::Update()
 	default:
 		grow = size/10;
 	}
+
+	// age the elements, those running out make room for new ones
+	int live = 0;
 	for(i=0;i<size;i++) {
-		if (points[i].state==-1) {
-			continue;
+		int state = states[i];
+		int used = state != -1;
+		live += used;
+		grow += state == 0;
+		states[i] = state - used;
+	}
+	drawn = live != 0;
+
+	// then move them, each path in a loop of its own; the unused elements
+	// are moved too where it saves a branch, AddNew places them anyway
+	switch (path) {
+	case SP_PATH_FALL:
+		for(i=0;i<size;i++) {
+			ys[i] = Wrap(ys[i]+3+((i>>2)&3), pos.h);
 		}
-		drawn=true;
-		if (!points[i].state) {
-			grow++;
+		break;
+	case SP_PATH_RAIN:
+		for(i=0;i<size;i++) {
+			xs[i] = Wrap(xs[i]+(i&1), pos.w);
+			ys[i] = Wrap(ys[i]+3+((i>>2)&3), pos.h);
 		}
-		points[i].state--;
-
-		switch (path) {
-		case SP_PATH_FALL:
-			points[i].pos.y+=3+((i>>2)&3);
-			points[i].pos.y%=pos.h;
-			break;
-		case SP_PATH_RAIN:
-			points[i].pos.x+=pos.w+(i&1);
-			points[i].pos.x%=pos.w;
-			points[i].pos.y+=3+((i>>2)&3);
-			points[i].pos.y%=pos.h;
-			break;
-		case SP_PATH_FLIT:
-			if (points[i].state<=MAX_SPARK_PHASE<<4) {
-				break;
+		break;
+	case SP_PATH_FLIT:
+		for(i=0;i<size;i++) {
+			if (states[i]<=MAX_SPARK_PHASE<<4) {
+				continue;
 			}
-			points[i].pos.x+=core->Roll(1,3,pos.w-2);
-			points[i].pos.x%=pos.w;
-			points[i].pos.y+=(i&3)+1;
-			break;
-		case SP_PATH_EXPL:
-			points[i].pos.y+=1;
-			break;
-		case SP_PATH_FOUNT:
-			if (points[i].state<=MAX_SPARK_PHASE) {
-				break;
+			xs[i] = (xs[i]+core->Roll(1,3,pos.w-2)) % pos.w;
+			ys[i] += (i&3)+1;
+		}
+		break;
+	case SP_PATH_EXPL:
+		for(i=0;i<size;i++) {
+			ys[i] += states[i] != -1;
+		}
+		break;
+	case SP_PATH_FOUNT:
+		for(i=0;i<size;i++) {
+			int state = states[i];
+			if (state<=MAX_SPARK_PHASE) {
+				continue;
 			}
-			if (points[i].state<(MAX_SPARK_PHASE+pos.h)) {
-				if ( (points[i].state&7) == 7) {
-					points[i].pos.x+=(i&3)-1;
-				}
-				points[i].pos.y+=2;
-			} else {
-				if ( (points[i].state&7) == 7) {
-					points[i].pos.x+=(i&3)-1;
-				}
-				points[i].pos.y-=2;
+			if ( (state&7) == 7) {
+				xs[i] += (i&3)-1;
 			}
-			break;
+			ys[i] += state<(MAX_SPARK_PHASE+pos.h) ? 2 : -2;
 		}
+		break;
 	}
 	if (phase==P_GROW) {
 		AddParticles(grow);
@@ -32,6 +32,8 @@
 
 #include "Region.h"
 
+#include <vector>
+
 namespace GemRB {
 
 class CharAnimations;
@@ -42,12 +44,6 @@ class Scriptable;
 #define P_FADE  1
 #define P_EMPTY 2
 
-// this structure holds data for a single particle element
-struct Element {
-	int state;
-	Point pos;
-};
-
 /**
  * @class Particles 
  * Class holding information about particles and rendering them.
@@ -118,7 +114,12 @@ public:
 	int Update();
 	int GetHeight() const { return pos.y+pos.h; }
 private:
-	Element *points;
+	// the elements are kept in separate arrays, so the updates run over
+	// each of them in a tight loop, an unused element has the state -1
+	int *states;
+	short *xs, *ys;
+	// the points and raindrops of each phase, drawn together
+	std::vector<Point> batches[MAX_SPARK_PHASE];
 	ieDword timetolive;
 //	ieDword target;    //could be 0, in that case target is pos
 	ieWord size;       //spark number
@@ -0,0 +1,569 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "PathFinder.h"
+
+#include "globals.h"
+
+#include "SearchMap.h"
+#include "System/Thread.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace GemRB {
+
+enum {
+	NODE_NEW = 0,
+	NODE_OPEN,
+	NODE_CLOSED,
+	NODE_BLOCKED
+};
+
+#define NO_NODE 0xffffffff
+
+// a search giving up past either of these found no path, so an unreachable
+// or enclosed goal doesn't flood the whole searchmap
+#define MAX_PATH_COST 65500
+#define MAX_PATH_NODES 32000
+
+// nodes per pool block, the blocks are kept for the whole run
+#define PATH_POOL_BLOCK 1024
+
+// the path service workers build paths too, hence the lock
+static Mutex PoolLock;
+static PathNode *FreeNodes = NULL; // recycled nodes, linked through Next
+static PathNode *BlockNext = NULL, *BlockEnd = NULL;
+
+// call with the lock held
+static PathNode *TakeNode()
+{
+	if (FreeNodes) {
+		PathNode *node = FreeNodes;
+		FreeNodes = node->Next;
+		return node;
+	}
+	if (BlockNext == BlockEnd) {
+		BlockNext = (PathNode *) malloc(PATH_POOL_BLOCK * sizeof(PathNode));
+		if (!BlockNext) {
+			BlockEnd = NULL;
+			throw std::bad_alloc();
+		}
+		BlockEnd = BlockNext + PATH_POOL_BLOCK;
+	}
+	return BlockNext++;
+}
+
+void *PathNode::operator new(size_t size)
+{
+	if (size != sizeof(PathNode)) {
+		return ::operator new(size);
+	}
+	MutexLock l(PoolLock);
+	return TakeNode();
+}
+
+void PathNode::operator delete(void *node, size_t size)
+{
+	if (!node) {
+		return;
+	}
+	if (size != sizeof(PathNode)) {
+		::operator delete(node);
+		return;
+	}
+	MutexLock l(PoolLock);
+	((PathNode *) node)->Next = FreeNodes;
+	FreeNodes = (PathNode *) node;
+}
+
+PathNode *PathNode::NewRun(unsigned int count, PathNode *&last)
+{
+	last = NULL;
+	if (!count) {
+		return NULL;
+	}
+
+	MutexLock l(PoolLock);
+	PathNode *first = TakeNode();
+	first->Parent = NULL;
+	last = first;
+	while (--count) {
+		PathNode *node = TakeNode();
+		node->Parent = last;
+		last->Next = node;
+		last = node;
+	}
+	last->Next = NULL;
+	return first;
+}
+
+void PathNode::FreePath(PathNode *path)
+{
+	if (!path) {
+		return;
+	}
+
+	MutexLock l(PoolLock);
+	while (path) {
+		PathNode *next = path->Next;
+		path->Next = FreeNodes;
+		FreeNodes = path;
+		path = next;
+	}
+}
+
+PathFinder::PathFinder(unsigned int width, unsigned int height, unsigned int diagonalCost, unsigned int orthogonalCost)
+	: Width(width), Height(height), DiagonalCost(diagonalCost), OrthogonalCost(orthogonalCost)
+{
+	nodes = (Node *) calloc(Width * Height, sizeof(Node));
+	generation = 0;
+	current = NO_NODE;
+	closed = 0;
+	useEstimate = false;
+	slack = 0;
+
+	// octile distance, since the pathfind.2da costs may make either kind
+	// of step the cheaper one, we mustn't ever overestimate
+	StraightCost = OrthogonalCost < DiagonalCost ? OrthogonalCost : DiagonalCost;
+	CrossCost = DiagonalCost < 2 * OrthogonalCost ? DiagonalCost : 2 * OrthogonalCost;
+}
+
+PathFinder::~PathFinder()
+{
+	free(nodes);
+}
+
+PathFinder::Node &PathFinder::Touch(unsigned int index)
+{
+	Node &node = nodes[index];
+	if (node.generation != generation) {
+		node.generation = generation;
+		node.state = NODE_NEW;
+		node.parent = NO_NODE;
+	}
+	return node;
+}
+
+void PathFinder::Reset(const Point &start)
+{
+	open.clear();
+	current = NO_NODE;
+	closed = 0;
+	generation++;
+	if (!generation) {
+		// wrapped around, the old stamps aren't trustworthy anymore
+		memset(nodes, 0, Width * Height * sizeof(Node));
+		generation = 1;
+	}
+
+	if ((unsigned int) start.x >= Width || (unsigned int) start.y >= Height) {
+		return;
+	}
+	unsigned int index = start.y * Width + start.x;
+	Node &node = Touch(index);
+	node.cost = 0;
+	node.total = Estimate(start.x, start.y);
+	node.state = NODE_OPEN;
+	node.heapIndex = 0;
+	open.push_back(index);
+}
+
+void PathFinder::Begin(const Point &start)
+{
+	useEstimate = false;
+	Reset(start);
+}
+
+void PathFinder::Begin(const Point &start, const Point &goal, unsigned int relax)
+{
+	useEstimate = true;
+	target = goal;
+	slack = relax;
+	Reset(start);
+}
+
+unsigned int PathFinder::Octile(unsigned int dx, unsigned int dy) const
+{
+	if (dx < dy) {
+		return StraightCost * (dy - dx) + CrossCost * dx;
+	}
+	return StraightCost * (dx - dy) + CrossCost * dy;
+}
+
+unsigned int PathFinder::GetEstimate(const Point &a, const Point &b) const
+{
+	unsigned int dx = a.x > b.x ? a.x - b.x : b.x - a.x;
+	unsigned int dy = a.y > b.y ? a.y - b.y : b.y - a.y;
+	return Octile(dx, dy);
+}
+
+unsigned int PathFinder::Estimate(unsigned int x, unsigned int y) const
+{
+	if (!useEstimate) {
+		return 0;
+	}
+
+	unsigned int dx = x > (unsigned int) target.x ? x - target.x : target.x - x;
+	unsigned int dy = y > (unsigned int) target.y ? y - target.y : target.y - y;
+	dx = dx > slack ? dx - slack : 0;
+	dy = dy > slack ? dy - slack : 0;
+	return Octile(dx, dy);
+}
+
+// cheaper total first, on ties prefer the node that got further already
+bool PathFinder::Before(unsigned int a, unsigned int b) const
+{
+	const Node &na = nodes[a];
+	const Node &nb = nodes[b];
+	if (na.total != nb.total) {
+		return na.total < nb.total;
+	}
+	return na.cost > nb.cost;
+}
+
+void PathFinder::SiftUp(unsigned int pos)
+{
+	unsigned int index = open[pos];
+	while (pos) {
+		unsigned int parent = (pos - 1) / 2;
+		if (!Before(index, open[parent])) {
+			break;
+		}
+		open[pos] = open[parent];
+		nodes[open[pos]].heapIndex = pos;
+		pos = parent;
+	}
+	open[pos] = index;
+	nodes[index].heapIndex = pos;
+}
+
+void PathFinder::SiftDown(unsigned int pos)
+{
+	unsigned int count = (unsigned int) open.size();
+	unsigned int index = open[pos];
+	while (true) {
+		unsigned int child = pos * 2 + 1;
+		if (child >= count) {
+			break;
+		}
+		if (child + 1 < count && Before(open[child + 1], open[child])) {
+			child++;
+		}
+		if (!Before(open[child], index)) {
+			break;
+		}
+		open[pos] = open[child];
+		nodes[open[pos]].heapIndex = pos;
+		pos = child;
+	}
+	open[pos] = index;
+	nodes[index].heapIndex = pos;
+}
+
+bool PathFinder::Next(Point &p, unsigned int &cost)
+{
+	if (open.empty()) {
+		current = NO_NODE;
+		return false;
+	}
+
+	current = open[0];
+	open[0] = open.back();
+	open.pop_back();
+	if (!open.empty()) {
+		SiftDown(0);
+	}
+
+	Node &node = nodes[current];
+	node.state = NODE_CLOSED;
+	closed++;
+	p.x = (short) (current % Width);
+	p.y = (short) (current / Width);
+	cost = node.cost;
+	return true;
+}
+
+void PathFinder::Relax(PathMapSource &source, unsigned int x, unsigned int y, unsigned int size, unsigned int cost)
+{
+	if (x >= Width || y >= Height) {
+		return;
+	}
+
+	unsigned int index = y * Width + x;
+	Node &node = Touch(index);
+	switch (node.state) {
+		case NODE_CLOSED:
+		case NODE_BLOCKED:
+			return;
+		case NODE_NEW:
+			if (source.IsBlocked(x, y, size)) {
+				node.state = NODE_BLOCKED;
+				return;
+			}
+			node.cost = cost;
+			node.total = cost + Estimate(x, y);
+			node.parent = current;
+			node.state = NODE_OPEN;
+			node.heapIndex = (unsigned int) open.size();
+			open.push_back(index);
+			SiftUp(node.heapIndex);
+			return;
+		default:
+			if (cost >= node.cost) {
+				return;
+			}
+			// the estimate doesn't change, so the total drops just as much
+			node.total -= node.cost - cost;
+			node.cost = cost;
+			node.parent = current;
+			SiftUp(node.heapIndex);
+			return;
+	}
+}
+
+void PathFinder::Expand(PathMapSource &source, unsigned int size)
+{
+	if (current == NO_NODE) {
+		return;
+	}
+
+	unsigned int x = current % Width;
+	unsigned int y = current / Width;
+	unsigned int cost = nodes[current].cost + DiagonalCost;
+
+	// diagonal movements
+	Relax(source, x - 1, y - 1, size, cost);
+	Relax(source, x + 1, y - 1, size, cost);
+	Relax(source, x + 1, y + 1, size, cost);
+	Relax(source, x - 1, y + 1, size, cost);
+
+	// direct movements
+	cost = nodes[current].cost + OrthogonalCost;
+	Relax(source, x, y - 1, size, cost);
+	Relax(source, x + 1, y, size, cost);
+	Relax(source, x, y + 1, size, cost);
+	Relax(source, x - 1, y, size, cost);
+}
+
+bool PathFinder::GetParent(const Point &p, Point &parent) const
+{
+	if ((unsigned int) p.x >= Width || (unsigned int) p.y >= Height) {
+		return false;
+	}
+
+	const Node &node = nodes[p.y * Width + p.x];
+	if (node.generation != generation || node.parent == NO_NODE) {
+		return false;
+	}
+	parent.x = (short) (node.parent % Width);
+	parent.y = (short) (node.parent / Width);
+	return true;
+}
+
+/*
+ * find a path from start to goal, ending at the specified distance from the
+ * target (the goal must be in sight of the end, if 'sight' is specified)
+ */
+PathNode* PathFinder::FindNear(SearchMap &map, const Point &s, const Point &d, unsigned int size, unsigned int MinDistance, bool sight)
+{
+	// adjust the start/goal points to be searchmap locations
+	Point start( s.x/16, s.y/12 );
+	Point goal ( d.x/16, d.y/12 );
+	Point orig_goal = goal;
+
+	// any cell within MinDistance of the goal may end the search, so the
+	// estimate has to be relaxed by that many cells (12 is the smaller
+	// cell dimension) or it could overshoot
+	unsigned int slack = 0;
+	if (MinDistance) {
+		slack = MinDistance/12 + 1;
+	}
+	Begin(start, goal, slack);
+
+	unsigned int squaredmindistance = MinDistance * MinDistance;
+	bool found_path = false;
+	Point p;
+	unsigned int Cost;
+	while (Next(p, Cost)) {
+		if (p == orig_goal) {
+			// we got all the way to the target!
+			found_path = true;
+			break;
+		} else if (MinDistance) {
+			/* check minimum distance:
+			 * as an obvious optimisation we only check squared distance: this is a
+			 * possible overestimate since the sqrt Distance() rounds down
+			 * caller should have already done PersonalDistance adjustments, this is
+			 * simply between the specified points
+			 */
+
+			int distx = (p.x*16 + 8) - d.x;
+			int disty = (p.y*12 + 6) - d.y;
+			if ((unsigned int)(distx*distx + disty*disty) <= squaredmindistance) {
+				// we are within the minimum distance of the goal
+				Point ourpos(p.x*16 + 8, p.y*12 + 6);
+				// sight check is *slow* :(
+				if (!sight || map.IsVisibleLOS(ourpos, d)) {
+					// we got all the way to a suitable goal!
+					goal = p;
+					found_path = true;
+					break;
+				}
+			}
+		}
+
+		if (Cost > MAX_PATH_COST || closed > MAX_PATH_NODES) {
+			// cost is far too high, no path found
+			break;
+		}
+		Expand(map, size);
+	}
+
+	if (!found_path) {
+		// this is not really great, we should be finding the path that
+		// went nearest to where we wanted
+		PathNode* StartNode = new PathNode;
+		StartNode->Next = NULL;
+		StartNode->Parent = NULL;
+		StartNode->x = start.x;
+		StartNode->y = start.y;
+		StartNode->orient = GetOrient( goal, start );
+		return StartNode;
+	}
+
+	// count the steps first, so the path is taken from the pool in one go
+	unsigned int count = 1;
+	Point n;
+	p = goal;
+	while (p != start && GetParent(p, n)) {
+		count++;
+		p = n;
+	}
+	PathNode *StartNode;
+	PathNode *Return = PathNode::NewRun(count, StartNode);
+
+	// find path from goal to start
+	StartNode->x = goal.x;
+	StartNode->y = goal.y;
+	bool fixup_orient = false;
+	if (orig_goal != goal) {
+		StartNode->orient = GetOrient( orig_goal, goal );
+	} else {
+		// we pathed all the way to original goal!
+		// we don't know correct orientation until we find previous step
+		fixup_orient = true;
+		StartNode->orient = GetOrient( goal, start );
+	}
+	p = goal;
+	while (StartNode->Parent) {
+		GetParent(p, n);
+
+		if (fixup_orient) {
+			// don't change orientation at end of path? this seems best
+			StartNode->orient = GetOrient( p, n );
+		}
+
+		StartNode = StartNode->Parent;
+		StartNode->x = n.x;
+		StartNode->y = n.y;
+		StartNode->orient = GetOrient( p, n );
+		p = n;
+	}
+
+	return Return;
+}
+
+// searches a path from start to goal and appends its steps after tail
+// maxCost limits the search further, 0 leaves just the default limits
+bool PathFinder::Trace(PathMapSource &source, PathNode *&tail, const Point &start, const Point &goal, unsigned int size, unsigned int maxCost)
+{
+	// search backwards, so the parent links lead from the start to the goal
+	Begin(goal, start);
+	bool found_path = false;
+	Point p;
+	unsigned int Cost;
+	while (Next(p, Cost)) {
+		if (p == start) {
+			//We've found _a_ path
+			found_path = true;
+			break;
+		}
+		if ((maxCost && Cost > maxCost) || Cost > MAX_PATH_COST || closed > MAX_PATH_NODES) {
+			break;
+		}
+		Expand(source, size);
+	}
+	if (!found_path) {
+		return false;
+	}
+
+	// count the steps first, so they are taken from the pool in one go
+	unsigned int count = 0;
+	Point n, q = p;
+	while (q != goal) {
+		if (!GetParent(q, n))
+			return false;
+		count++;
+		q = n;
+	}
+	if (!count) {
+		return true;
+	}
+
+	PathNode *last;
+	PathNode *node = PathNode::NewRun(count, last);
+	tail->Next = node;
+	node->Parent = tail;
+	while (p != goal) {
+		GetParent(p, n);
+		node->x = n.x;
+		node->y = n.y;
+		node->orient = GetOrient( n, p );
+		tail = node;
+		node = node->Next;
+		p = n;
+	}
+	return true;
+}
+
+// steps back on the path until its end is about MinDistance from d
+void PathFinder::TrimPath(PathNode *&tail, const Point &d, int MinDistance)
+{
+	if (!MinDistance) {
+		return;
+	}
+	while (tail->Parent) {
+		Point tar;
+
+		tar.x=tail->Parent->x*16;
+		tar.y=tail->Parent->y*12;
+		int dist = Distance(tar,d);
+		if (dist+14>=MinDistance) {
+			break;
+		}
+		tail = tail->Parent;
+		delete tail->Next;
+		tail->Next = NULL;
+	}
+}
+
+}
@@ -20,6 +20,13 @@
 #ifndef PATHFINDER_H
 #define PATHFINDER_H
 
+#include "exports.h"
+
+#include "Region.h"
+
+#include <cstddef>
+#include <vector>
+
 namespace GemRB {
 
 //searchmap conversion bits
@@ -43,12 +50,106 @@ enum {
 	PATH_MAP_NOTACTOR = (PATH_MAP_DOOR|PATH_MAP_AREAMASK)
 };
 
-struct PathNode {
+/* a step of a path, the steps are linked both ways
+ * nodes come from a shared pool instead of the heap: they are carved from
+ * big blocks and recycled, so a path is mostly contiguous in memory and
+ * building or dropping one doesn't allocate
+ */
+struct GEM_EXPORT PathNode {
 	PathNode* Parent;
 	PathNode* Next;
 	unsigned short x;
 	unsigned short y;
 	unsigned int orient;
+
+	static void *operator new(size_t size);
+	static void operator delete(void *node, size_t size);
+	/* takes count linked nodes from the pool at once, returns the first
+	 * one and the last one in last */
+	static PathNode *NewRun(unsigned int count, PathNode *&last);
+	/* returns the node and all that follow it to the pool */
+	static void FreePath(PathNode *path);
+};
+
+class SearchMap;
+
+/* passability oracle for the searches, in searchmap coordinates */
+class GEM_EXPORT PathMapSource {
+public:
+	virtual ~PathMapSource() {}
+	/* true if a creature of this size can't stand on the cell */
+	virtual bool IsBlocked(unsigned int x, unsigned int y, unsigned int size) = 0;
+};
+
+/* A* over a searchmap sized grid
+ * the node state is stamped with a search generation, so starting a new
+ * search doesn't need to clear the whole grid. The caller drives the loop:
+ * Begin(), then Next() to pop the cheapest node and Expand() to push its
+ * neighbours, stopping whenever its own goal test is satisfied.
+ */
+class GEM_EXPORT PathFinder {
+public:
+	PathFinder(unsigned int width, unsigned int height, unsigned int diagonalCost, unsigned int orthogonalCost);
+	~PathFinder();
+
+	/* starts a plain Dijkstra flood from start (no goal to estimate towards) */
+	void Begin(const Point &start);
+	/* starts an A* search from start towards target; slack (in searchmap
+	 * cells) relaxes the estimate for searches allowed to stop short of it */
+	void Begin(const Point &start, const Point &target, unsigned int slack = 0);
+	/* pops the cheapest open node, returns false if there are none left */
+	bool Next(Point &p, unsigned int &cost);
+	/* pushes the passable neighbours of the node last returned by Next() */
+	void Expand(PathMapSource &source, unsigned int size);
+	/* returns the node we reached p from, false for the start or unreached nodes */
+	bool GetParent(const Point &p, Point &parent) const;
+	/* the (never overestimating) cost of going from a to b on a free map */
+	unsigned int GetEstimate(const Point &a, const Point &b) const;
+	unsigned int GetDiagonalCost() const { return DiagonalCost; }
+	unsigned int GetOrthogonalCost() const { return OrthogonalCost; }
+	/* how many nodes the current search has popped so far */
+	unsigned int GetClosedCount() const { return closed; }
+
+	/* searches a path from start to goal and appends its steps after tail,
+	 * maxCost limits the search further, 0 leaves just the default limits */
+	bool Trace(PathMapSource &source, PathNode *&tail, const Point &start, const Point &goal, unsigned int size, unsigned int maxCost);
+	/* builds a path (in pixel coordinates) ending MinDistance from d */
+	PathNode *FindNear(SearchMap &map, const Point &s, const Point &d, unsigned int size, unsigned int MinDistance, bool sight);
+	/* steps back from the end of the path until it is MinDistance from d */
+	static void TrimPath(PathNode *&tail, const Point &d, int MinDistance);
+
+	unsigned int GetWidth() const { return Width; }
+	unsigned int GetHeight() const { return Height; }
+private:
+	struct Node {
+		unsigned int generation;
+		unsigned int cost;  // cost from the start
+		unsigned int total; // cost + estimate
+		unsigned int parent;
+		unsigned int heapIndex;
+		unsigned char state;
+	};
+
+	unsigned int Width, Height;
+	unsigned int DiagonalCost, OrthogonalCost;
+	unsigned int StraightCost, CrossCost; // heuristic step costs
+	Node *nodes;
+	std::vector<unsigned int> open; // binary heap of node indices
+	unsigned int generation;
+	unsigned int current;
+	unsigned int closed;
+	bool useEstimate;
+	Point target;
+	unsigned int slack;
+
+	void Reset(const Point &start);
+	Node &Touch(unsigned int index);
+	unsigned int Octile(unsigned int dx, unsigned int dy) const;
+	unsigned int Estimate(unsigned int x, unsigned int y) const;
+	void Relax(PathMapSource &source, unsigned int x, unsigned int y, unsigned int size, unsigned int cost);
+	bool Before(unsigned int a, unsigned int b) const;
+	void SiftUp(unsigned int pos);
+	void SiftDown(unsigned int pos);
 };
 
 }
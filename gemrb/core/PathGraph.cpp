@@ -0,0 +1,441 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "PathGraph.h"
+
+#include "System/DataStream.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+
+namespace GemRB {
+
+//passable runs at least this long get an entrance at both ends
+#define PATH_LONG_ENTRANCE 6
+//the node index is packed in the low byte of the graph node ids
+#define PATH_MAX_CLUSTER_NODES 256
+
+#define NO_ROUTE 0xffffffff
+#define START_NODE 0xfffffffe
+#define GOAL_NODE 0xffffffff
+
+struct GraphVisit {
+	unsigned int cost;
+	unsigned int parent;
+	bool closed;
+};
+
+typedef std::map<unsigned int, GraphVisit> GraphVisits;
+typedef std::pair<unsigned int, unsigned int> GraphEntry; // estimated total, node id
+typedef std::priority_queue<GraphEntry, std::vector<GraphEntry>, std::greater<GraphEntry> > GraphOpenList;
+
+// blocks everything outside of a single cluster
+class ClusterSource : public PathMapSource {
+public:
+	ClusterSource(PathMapSource &base, const Region &rgn) : source(base), bounds(rgn) {}
+	bool IsBlocked(unsigned int x, unsigned int y, unsigned int size)
+	{
+		if (x < (unsigned int) bounds.x || y < (unsigned int) bounds.y) return true;
+		if (x >= (unsigned int) (bounds.x + bounds.w) || y >= (unsigned int) (bounds.y + bounds.h)) return true;
+		return source.IsBlocked(x, y, size);
+	}
+private:
+	PathMapSource &source;
+	Region bounds;
+};
+
+static void PushNode(GraphVisits &visits, GraphOpenList &open, unsigned int id, unsigned int cost, unsigned int parent, unsigned int estimate)
+{
+	GraphVisits::iterator it = visits.find(id);
+	if (it != visits.end()) {
+		if (it->second.closed || it->second.cost <= cost) {
+			return;
+		}
+	} else {
+		it = visits.insert(std::make_pair(id, GraphVisit())).first;
+	}
+	it->second.cost = cost;
+	it->second.parent = parent;
+	it->second.closed = false;
+	open.push(GraphEntry(cost + estimate, id));
+}
+
+PathGraph::PathGraph(PathFinder *pathfinder)
+	: finder(pathfinder)
+{
+	Width = finder->GetWidth();
+	Height = finder->GetHeight();
+	ClustersX = (Width + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	ClustersY = (Height + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+	clusters = new Cluster[ClustersX * ClustersY];
+	for (unsigned int i = 0; i < ClustersX * ClustersY; i++) {
+		clusters[i].dirty = true;
+	}
+	dirty = true;
+}
+
+PathGraph::~PathGraph()
+{
+	delete[] clusters;
+}
+
+Region PathGraph::GetBounds(unsigned int index) const
+{
+	Region rgn;
+	rgn.x = (index % ClustersX) * PATH_CLUSTER_SIZE;
+	rgn.y = (index / ClustersX) * PATH_CLUSTER_SIZE;
+	rgn.w = PATH_CLUSTER_SIZE;
+	rgn.h = PATH_CLUSTER_SIZE;
+	if ((unsigned int) (rgn.x + rgn.w) > Width) {
+		rgn.w = Width - rgn.x;
+	}
+	if ((unsigned int) (rgn.y + rgn.h) > Height) {
+		rgn.h = Height - rgn.y;
+	}
+	return rgn;
+}
+
+unsigned int PathGraph::ClusterAt(const Point &p) const
+{
+	return (p.y / PATH_CLUSTER_SIZE) * ClustersX + p.x / PATH_CLUSTER_SIZE;
+}
+
+int PathGraph::FindNode(unsigned int index, const Point &p, const Point &partner) const
+{
+	const Cluster &cluster = clusters[index];
+	for (size_t i = 0; i < cluster.nodes.size(); i++) {
+		if (cluster.nodes[i] == p && cluster.partners[i] == partner) {
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+// both clusters sharing a border scan it in the same order, so they always
+// agree on where the entrances are
+void PathGraph::ScanBorder(PathMapSource &source, Cluster &cluster, const Point &first, const Point &step, const Point &across, unsigned int length)
+{
+	unsigned int run = 0;
+	for (unsigned int i = 0; i <= length; i++) {
+		Point p(first.x + step.x * i, first.y + step.y * i);
+		Point q = p + across;
+		if (i < length && !source.IsBlocked(p.x, p.y, 0) && !source.IsBlocked(q.x, q.y, 0)) {
+			run++;
+			continue;
+		}
+		if (!run) {
+			continue;
+		}
+
+		unsigned int picks[2];
+		unsigned int count = 0;
+		if (run < PATH_LONG_ENTRANCE) {
+			picks[count++] = i - run + run / 2;
+		} else {
+			picks[count++] = i - run;
+			picks[count++] = i - 1;
+		}
+		for (unsigned int j = 0; j < count; j++) {
+			if (cluster.nodes.size() >= PATH_MAX_CLUSTER_NODES) {
+				break;
+			}
+			Point node(first.x + step.x * picks[j], first.y + step.y * picks[j]);
+			cluster.nodes.push_back(node);
+			cluster.partners.push_back(node + across);
+		}
+		run = 0;
+	}
+}
+
+void PathGraph::RebuildCluster(PathMapSource &source, unsigned int index)
+{
+	Cluster &cluster = clusters[index];
+	Region rgn = GetBounds(index);
+	cluster.nodes.clear();
+	cluster.partners.clear();
+
+	if (rgn.y) {
+		ScanBorder(source, cluster, Point(rgn.x, rgn.y), Point(1, 0), Point(0, -1), rgn.w);
+	}
+	if ((unsigned int) (rgn.y + rgn.h) < Height) {
+		ScanBorder(source, cluster, Point(rgn.x, rgn.y + rgn.h - 1), Point(1, 0), Point(0, 1), rgn.w);
+	}
+	if (rgn.x) {
+		ScanBorder(source, cluster, Point(rgn.x, rgn.y), Point(0, 1), Point(-1, 0), rgn.h);
+	}
+	if ((unsigned int) (rgn.x + rgn.w) < Width) {
+		ScanBorder(source, cluster, Point(rgn.x + rgn.w - 1, rgn.y), Point(0, 1), Point(1, 0), rgn.h);
+	}
+
+	size_t count = cluster.nodes.size();
+	cluster.costs.assign(count * count, NO_ROUTE);
+	std::vector<unsigned int> costs;
+	for (size_t i = 0; i < count; i++) {
+		Connect(source, cluster.nodes[i], index, costs);
+		for (size_t j = 0; j < count; j++) {
+			cluster.costs[i * count + j] = costs[j];
+		}
+	}
+	cluster.dirty = false;
+}
+
+// cost from p to each node of the cluster, without leaving it
+void PathGraph::Connect(PathMapSource &source, const Point &p, unsigned int index, std::vector<unsigned int> &costs)
+{
+	const Cluster &cluster = clusters[index];
+	ClusterSource local(source, GetBounds(index));
+	size_t count = cluster.nodes.size();
+	size_t left = count;
+	costs.assign(count, NO_ROUTE);
+
+	finder->Begin(p);
+	Point q;
+	unsigned int cost;
+	while (left && finder->Next(q, cost)) {
+		for (size_t i = 0; i < count; i++) {
+			if (cluster.nodes[i] == q) {
+				costs[i] = cost;
+				left--;
+			}
+		}
+		finder->Expand(local, 0);
+	}
+}
+
+void PathGraph::Build(PathMapSource &source)
+{
+	for (unsigned int i = 0; i < ClustersX * ClustersY; i++) {
+		RebuildCluster(source, i);
+	}
+	dirty = false;
+}
+
+void PathGraph::Save(DataStream *stream) const
+{
+	ieDword tmpDword = ClustersX * ClustersY;
+	stream->WriteDword(&tmpDword);
+	for (unsigned int i = 0; i < ClustersX * ClustersY; i++) {
+		const Cluster &cluster = clusters[i];
+		ieWord count = (ieWord) cluster.nodes.size();
+		stream->WriteWord(&count);
+		for (ieWord j = 0; j < count; j++) {
+			ieWord tmpWord = (ieWord) cluster.nodes[j].x;
+			stream->WriteWord(&tmpWord);
+			tmpWord = (ieWord) cluster.nodes[j].y;
+			stream->WriteWord(&tmpWord);
+			tmpWord = (ieWord) cluster.partners[j].x;
+			stream->WriteWord(&tmpWord);
+			tmpWord = (ieWord) cluster.partners[j].y;
+			stream->WriteWord(&tmpWord);
+		}
+		for (size_t j = 0; j < cluster.costs.size(); j++) {
+			tmpDword = cluster.costs[j];
+			stream->WriteDword(&tmpDword);
+		}
+	}
+}
+
+bool PathGraph::Load(DataStream *stream)
+{
+	ieDword total;
+	if (stream->ReadDword(&total) != 4 || total != ClustersX * ClustersY) {
+		return false;
+	}
+	bool ok = true;
+	for (unsigned int i = 0; ok && i < total; i++) {
+		Cluster &cluster = clusters[i];
+		ieWord count;
+		if (stream->ReadWord(&count) != 2 || count > PATH_MAX_CLUSTER_NODES) {
+			ok = false;
+			break;
+		}
+		cluster.nodes.resize(count);
+		cluster.partners.resize(count);
+		for (ieWord j = 0; j < count; j++) {
+			ieWord x = 0, y = 0, px = 0, py = 0;
+			stream->ReadWord(&x);
+			stream->ReadWord(&y);
+			stream->ReadWord(&px);
+			ok = stream->ReadWord(&py) == 2;
+			cluster.nodes[j] = Point(x, y);
+			cluster.partners[j] = Point(px, py);
+		}
+		cluster.costs.resize(count * count);
+		for (size_t j = 0; j < cluster.costs.size(); j++) {
+			ieDword cost = NO_ROUTE;
+			ok = stream->ReadDword(&cost) == 4;
+			cluster.costs[j] = cost;
+		}
+		cluster.dirty = false;
+	}
+	if (!ok) {
+		// a truncated file, start over as if nothing was read
+		for (unsigned int i = 0; i < total; i++) {
+			clusters[i].nodes.clear();
+			clusters[i].partners.clear();
+			clusters[i].costs.clear();
+			clusters[i].dirty = true;
+		}
+		return false;
+	}
+	dirty = false;
+	return true;
+}
+
+void PathGraph::Invalidate(unsigned int x, unsigned int y)
+{
+	if (x >= Width || y >= Height) {
+		return;
+	}
+	clusters[ClusterAt(Point(x, y))].dirty = true;
+	dirty = true;
+}
+
+// a changed cluster may move the entrances on its borders, so the neighbours
+// sharing them have to be redone too
+void PathGraph::Refresh(PathMapSource &source)
+{
+	if (!dirty) {
+		return;
+	}
+
+	unsigned int total = ClustersX * ClustersY;
+	std::vector<bool> affected(total, false);
+	for (unsigned int i = 0; i < total; i++) {
+		if (!clusters[i].dirty) {
+			continue;
+		}
+		unsigned int cx = i % ClustersX;
+		unsigned int cy = i / ClustersX;
+		affected[i] = true;
+		if (cx) affected[i - 1] = true;
+		if (cx + 1 < ClustersX) affected[i + 1] = true;
+		if (cy) affected[i - ClustersX] = true;
+		if (cy + 1 < ClustersY) affected[i + ClustersX] = true;
+	}
+	for (unsigned int i = 0; i < total; i++) {
+		if (affected[i]) {
+			RebuildCluster(source, i);
+		}
+	}
+	dirty = false;
+}
+
+bool PathGraph::IsLongRange(const Point &start, const Point &goal) const
+{
+	unsigned int dx = start.x > goal.x ? start.x - goal.x : goal.x - start.x;
+	unsigned int dy = start.y > goal.y ? start.y - goal.y : goal.y - start.y;
+	return dx > 2 * PATH_CLUSTER_SIZE || dy > 2 * PATH_CLUSTER_SIZE;
+}
+
+unsigned int PathGraph::GetDetourLimit() const
+{
+	unsigned int step = finder->GetDiagonalCost();
+	if (step < finder->GetOrthogonalCost()) {
+		step = finder->GetOrthogonalCost();
+	}
+	return 4 * PATH_CLUSTER_SIZE * step;
+}
+
+bool PathGraph::Plan(PathMapSource &source, const Point &start, const Point &goal, std::vector<Point> &waypoints)
+{
+	waypoints.clear();
+	if ((unsigned int) start.x >= Width || (unsigned int) start.y >= Height) {
+		return false;
+	}
+	if ((unsigned int) goal.x >= Width || (unsigned int) goal.y >= Height) {
+		return false;
+	}
+	Refresh(source);
+
+	unsigned int startCluster = ClusterAt(start);
+	unsigned int goalCluster = ClusterAt(goal);
+	std::vector<unsigned int> startCosts, goalCosts;
+	Connect(source, start, startCluster, startCosts);
+	Connect(source, goal, goalCluster, goalCosts);
+
+	GraphVisits visits;
+	GraphOpenList open;
+	const Cluster &first = clusters[startCluster];
+	for (size_t i = 0; i < first.nodes.size(); i++) {
+		if (startCosts[i] != NO_ROUTE) {
+			unsigned int id = startCluster * PATH_MAX_CLUSTER_NODES + (unsigned int) i;
+			PushNode(visits, open, id, startCosts[i], START_NODE, finder->GetEstimate(first.nodes[i], goal));
+		}
+	}
+
+	bool found = false;
+	while (!open.empty()) {
+		unsigned int id = open.top().second;
+		open.pop();
+		GraphVisit &visit = visits[id];
+		if (visit.closed) {
+			continue;
+		}
+		visit.closed = true;
+		if (id == GOAL_NODE) {
+			found = true;
+			break;
+		}
+		unsigned int cost = visit.cost;
+
+		unsigned int index = id / PATH_MAX_CLUSTER_NODES;
+		unsigned int node = id % PATH_MAX_CLUSTER_NODES;
+		const Cluster &cluster = clusters[index];
+		size_t count = cluster.nodes.size();
+		for (size_t j = 0; j < count; j++) {
+			unsigned int step = cluster.costs[node * count + j];
+			if (j == node || step == NO_ROUTE) {
+				continue;
+			}
+			PushNode(visits, open, index * PATH_MAX_CLUSTER_NODES + (unsigned int) j, cost + step, id, finder->GetEstimate(cluster.nodes[j], goal));
+		}
+
+		// cross the border, entrances are always orthogonal neighbours
+		const Point &across = cluster.partners[node];
+		unsigned int other = ClusterAt(across);
+		int partner = FindNode(other, across, cluster.nodes[node]);
+		if (partner >= 0) {
+			PushNode(visits, open, other * PATH_MAX_CLUSTER_NODES + partner, cost + finder->GetOrthogonalCost(), id, finder->GetEstimate(across, goal));
+		}
+
+		if (index == goalCluster && goalCosts[node] != NO_ROUTE) {
+			PushNode(visits, open, GOAL_NODE, cost + goalCosts[node], id, 0);
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	waypoints.push_back(goal);
+	unsigned int id = visits[GOAL_NODE].parent;
+	while (id != START_NODE) {
+		const Cluster &cluster = clusters[id / PATH_MAX_CLUSTER_NODES];
+		waypoints.push_back(cluster.nodes[id % PATH_MAX_CLUSTER_NODES]);
+		id = visits[id].parent;
+	}
+	std::reverse(waypoints.begin(), waypoints.end());
+	return true;
+}
+
+}
@@ -0,0 +1,90 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef PATHGRAPH_H
+#define PATHGRAPH_H
+
+#include "exports.h"
+
+#include "PathFinder.h"
+
+#include <vector>
+
+namespace GemRB {
+
+class DataStream;
+
+//searchmap cells per cluster side
+#define PATH_CLUSTER_SIZE 16
+
+/* Hierarchical (HPA*) abstraction of the searchmap
+ * the map is cut into square clusters, the passable stretches along the
+ * cluster borders become the graph nodes and the costs between the nodes of
+ * a cluster are precomputed. Long routes are planned on this small graph,
+ * then refined between consecutive waypoints with regular searches.
+ * It only knows about the static passability (walls and doors), actors are
+ * left to the refinement.
+ */
+class GEM_EXPORT PathGraph {
+public:
+	PathGraph(PathFinder *finder);
+	~PathGraph();
+
+	/* (re)builds every cluster */
+	void Build(PathMapSource &source);
+	/* writes the built clusters, for the derived data cache of the area */
+	void Save(DataStream *stream) const;
+	/* reads back what Save wrote; false (and nothing built) if it doesn't fit */
+	bool Load(DataStream *stream);
+	/* a searchmap cell changed, its cluster gets rebuilt on the next Plan() */
+	void Invalidate(unsigned int x, unsigned int y);
+	/* true if the route is long enough to be worth planning on the graph */
+	bool IsLongRange(const Point &start, const Point &goal) const;
+	/* fills waypoints with the border crossings leading from start to goal,
+	 * ending with the goal itself; returns false if there is no route */
+	bool Plan(PathMapSource &source, const Point &start, const Point &goal, std::vector<Point> &waypoints);
+	/* highest cost a refinement between two waypoints should need */
+	unsigned int GetDetourLimit() const;
+private:
+	struct Cluster {
+		std::vector<Point> nodes;
+		std::vector<Point> partners; // the cell across the border of each node
+		std::vector<unsigned int> costs; // between the nodes, inside the cluster
+		bool dirty;
+	};
+
+	PathFinder *finder;
+	unsigned int Width, Height;
+	unsigned int ClustersX, ClustersY;
+	Cluster *clusters;
+	bool dirty;
+
+	Region GetBounds(unsigned int index) const;
+	unsigned int ClusterAt(const Point &p) const;
+	void Refresh(PathMapSource &source);
+	void RebuildCluster(PathMapSource &source, unsigned int index);
+	void ScanBorder(PathMapSource &source, Cluster &cluster, const Point &first, const Point &step, const Point &across, unsigned int length);
+	void Connect(PathMapSource &source, const Point &p, unsigned int index, std::vector<unsigned int> &costs);
+	int FindNode(unsigned int index, const Point &p, const Point &partner) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,360 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "PathService.h"
+
+#include "FrameStats.h"
+#include "Game.h"
+#include "Interface.h"
+#include "Map.h"
+#include "PathFinder.h"
+#include "SearchMap.h"
+#include "Scriptable/Actor.h"
+
+#include <algorithm>
+
+namespace GemRB {
+
+// an immutable copy of an area searchmap, shared by the jobs of a tick
+struct PathSnapshot {
+	std::vector<unsigned short> cells;
+	unsigned int width, height;
+	unsigned int maxCircle;
+	unsigned int diagonalCost, orthogonalCost;
+	unsigned int users; // only touched with the service lock held
+};
+
+// the snapshot, with the live cells around the requester pasted over it
+// (its own footprint is already cleared there, see Map::ClearSearchMapFor)
+class PatchedSearchMap : public SearchMap {
+public:
+	PatchedSearchMap(const PathSnapshot *snapshot, const Point &origin, const std::vector<unsigned short> &cells, unsigned int side)
+		: SearchMap(&snapshot->cells[0], snapshot->width, snapshot->height, snapshot->maxCircle),
+		Origin(origin), Patch(cells), Side(side)
+	{
+	}
+protected:
+	unsigned int RawCell(unsigned int x, unsigned int y) const
+	{
+		unsigned int px = x - Origin.x;
+		unsigned int py = y - Origin.y;
+		if (px < Side && py < Side) {
+			return Patch[py * Side + px];
+		}
+		return SearchMap::RawCell(x, y);
+	}
+	bool SpanBlocked(int x0, int x1, int y) const
+	{
+		// only the rows crossing the patch need the cell by cell lookup
+		if ((unsigned int) (y - Origin.y) < Side && x1 >= Origin.x && x0 < Origin.x + (int) Side) {
+			for (int x = x0; x <= x1; x++) {
+				if (CellBlocked(RawCell(x, y))) return true;
+			}
+			return false;
+		}
+		return SearchMap::SpanBlocked(x0, x1, y);
+	}
+private:
+	Point Origin;
+	const std::vector<unsigned short> &Patch;
+	unsigned int Side;
+};
+
+class PathWorker : public Thread {
+public:
+	PathWorker(PathService *owner) : service(owner), finder(NULL) {}
+	~PathWorker()
+	{
+		Join();
+		delete finder;
+	}
+protected:
+	void Run();
+private:
+	PathService *service;
+	PathFinder *finder;
+
+	void Solve(PathService::Job *job);
+};
+
+void PathWorker::Run()
+{
+	PathService::Job *job;
+	while ((job = service->WaitForJob())) {
+		Solve(job);
+		service->Finished(job);
+	}
+}
+
+void PathWorker::Solve(PathService::Job *job)
+{
+	const PathSnapshot *snapshot = job->snapshot;
+	if (!finder || finder->GetWidth() != snapshot->width || finder->GetHeight() != snapshot->height ||
+		finder->GetDiagonalCost() != snapshot->diagonalCost || finder->GetOrthogonalCost() != snapshot->orthogonalCost) {
+		delete finder;
+		finder = new PathFinder(snapshot->width, snapshot->height, snapshot->diagonalCost, snapshot->orthogonalCost);
+	}
+
+	unsigned int side = (unsigned int) snapshot->maxCircle * 2 + 1;
+	PatchedSearchMap map(snapshot, job->patchOrigin, job->patch, side);
+	if (job->MinDistance) {
+		job->path = finder->FindNear(map, job->start, job->dest, job->size, job->MinDistance, true);
+		return;
+	}
+
+	// same as Map::FindPath, minus the cluster graph, which belongs to the area
+	Point start(job->start.x/16, job->start.y/12);
+	PathNode *StartNode = new PathNode;
+	job->path = StartNode;
+	StartNode->Next = NULL;
+	StartNode->Parent = NULL;
+	StartNode->x = start.x;
+	StartNode->y = start.y;
+	StartNode->orient = GetOrient(job->goal, start);
+	finder->Trace(map, StartNode, start, job->goal, job->size, 0);
+}
+
+PathService::PathService(unsigned int threads)
+	: stopping(false), serial(0)
+{
+	if (!threads) {
+		threads = Thread::GetProcessorCount();
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		PathWorker *worker = new PathWorker(this);
+		if (!worker->Start()) {
+			Log(ERROR, "PathService", "Couldn't start pathfinding thread %d!", i);
+			delete worker;
+			break;
+		}
+		workers.push_back(worker);
+	}
+	Log(MESSAGE, "PathService", "Started %d pathfinding threads.", (int) workers.size());
+}
+
+PathService::~PathService()
+{
+	{
+		MutexLock l(lock);
+		stopping = true;
+		wakeup.Broadcast();
+	}
+	for (size_t i = 0; i < workers.size(); i++) {
+		delete workers[i];
+	}
+
+	// nobody is left to race with
+	while (!queue.empty()) {
+		done.push_back(queue.front());
+		queue.pop_front();
+	}
+	for (size_t i = 0; i < done.size(); i++) {
+		PathNode::FreePath(done[i]->path);
+		Release(done[i]->snapshot);
+		delete done[i];
+	}
+	std::map<Map *, AreaSnapshot>::iterator it;
+	for (it = snapshots.begin(); it != snapshots.end(); ++it) {
+		Release(it->second.snapshot);
+	}
+}
+
+// call with the lock held
+void PathService::Release(PathSnapshot *snapshot)
+{
+	if (snapshot && !--snapshot->users) {
+		delete snapshot;
+	}
+}
+
+// call with the lock held
+PathSnapshot *PathService::GetSnapshot(Map *area)
+{
+	ieDword time = core->GetGame()->GameTime;
+	std::map<Map *, AreaSnapshot>::iterator it = snapshots.find(area);
+	if (it != snapshots.end()) {
+		if (it->second.time == time) {
+			return it->second.snapshot;
+		}
+		Release(it->second.snapshot);
+		snapshots.erase(it);
+	}
+
+	SearchMap *map = area->GetSearchMap();
+	PathFinder *finder = area->GetPathFinder();
+	PathSnapshot *snapshot = new PathSnapshot;
+	snapshot->width = map->GetWidth();
+	snapshot->height = map->GetHeight();
+	snapshot->maxCircle = map->GetMaxCircle();
+	snapshot->diagonalCost = finder->GetDiagonalCost();
+	snapshot->orthogonalCost = finder->GetOrthogonalCost();
+	snapshot->cells.assign(map->GetCells(), map->GetCells() + snapshot->width * snapshot->height);
+	snapshot->users = 1; // the table's reference
+
+	AreaSnapshot &entry = snapshots[area];
+	entry.snapshot = snapshot;
+	entry.time = time;
+	return snapshot;
+}
+
+unsigned int PathService::Submit(Map *area, Movable *actor, const Point &start, const Point &goal, unsigned int MinDistance)
+{
+	FrameStats::Count(FRAME_PATHS);
+	Job *job = new Job;
+	job->area = area;
+	job->actorID = actor->GetGlobalID();
+	job->start = start;
+	job->dest = goal;
+	job->goal = Point(goal.x/16, goal.y/12);
+	job->size = actor->size;
+	job->MinDistance = MinDistance;
+	job->path = NULL;
+	job->cancelled = false;
+
+	// the random part of FindPath has to stay on the main thread
+	SearchMap *map = area->GetSearchMap();
+	if (!MinDistance && map->GetBlocked(goal.x, goal.y, actor->size)) {
+		area->AdjustPosition(job->goal);
+	}
+
+	// the requester's own surroundings are taken from the live map
+	int radius = (int) map->GetMaxCircle();
+	job->patchOrigin = Point(actor->Pos.x/16 - radius, actor->Pos.y/12 - radius);
+	int side = radius * 2 + 1;
+	job->patch.resize(side * side);
+	for (int y = 0; y < side; y++) {
+		for (int x = 0; x < side; x++) {
+			job->patch[y * side + x] = area->GetInternalSearchMap(job->patchOrigin.x + x, job->patchOrigin.y + y);
+		}
+	}
+
+	MutexLock l(lock);
+	job->snapshot = GetSnapshot(area);
+	job->snapshot->users++;
+	if (!++serial) {
+		serial = 1;
+	}
+	job->serial = serial;
+	queue.push_back(job);
+	wakeup.Signal();
+	return serial;
+}
+
+PathService::Job *PathService::WaitForJob()
+{
+	MutexLock l(lock);
+	while (queue.empty() && !stopping) {
+		wakeup.Wait(lock);
+	}
+	if (stopping) {
+		return NULL;
+	}
+	Job *job = queue.front();
+	queue.pop_front();
+	running.push_back(job);
+	return job;
+}
+
+void PathService::Finished(Job *job)
+{
+	{
+		MutexLock l(lock);
+		Release(job->snapshot);
+		job->snapshot = NULL;
+		running.erase(std::find(running.begin(), running.end(), job));
+		if (!job->cancelled) {
+			done.push_back(job);
+			return;
+		}
+	}
+	// nobody is waiting for it anymore, the area may even be gone
+	PathNode::FreePath(job->path);
+	delete job;
+}
+
+void PathService::Deliver(Map *area)
+{
+	std::vector<Job *> ready;
+	{
+		MutexLock l(lock);
+		size_t i = done.size();
+		while (i--) {
+			if (done[i]->area == area) {
+				ready.push_back(done[i]);
+				done.erase(done.begin() + i);
+			}
+		}
+	}
+
+	// oldest first, so a superseded path never wins
+	size_t i = ready.size();
+	while (i--) {
+		Job *job = ready[i];
+		Actor *actor = area->GetActorByGlobalID(job->actorID);
+		if (actor && actor->GetPathRequest() == job->serial) {
+			actor->SetQueuedPath(job->path);
+		} else {
+			PathNode::FreePath(job->path);
+		}
+		delete job;
+	}
+}
+
+void PathService::ClearArea(Map *area)
+{
+	std::vector<Job *> dropped;
+	{
+		MutexLock l(lock);
+		std::deque<Job *>::iterator q = queue.begin();
+		while (q != queue.end()) {
+			if ((*q)->area == area) {
+				Release((*q)->snapshot);
+				dropped.push_back(*q);
+				q = queue.erase(q);
+			} else {
+				++q;
+			}
+		}
+		size_t i = done.size();
+		while (i--) {
+			if (done[i]->area == area) {
+				dropped.push_back(done[i]);
+				done.erase(done.begin() + i);
+			}
+		}
+		// the jobs being solved right now are dropped by Finished
+		for (i = 0; i < running.size(); i++) {
+			if (running[i]->area == area) {
+				running[i]->cancelled = true;
+			}
+		}
+		std::map<Map *, AreaSnapshot>::iterator it = snapshots.find(area);
+		if (it != snapshots.end()) {
+			Release(it->second.snapshot);
+			snapshots.erase(it);
+		}
+	}
+	for (size_t i = 0; i < dropped.size(); i++) {
+		PathNode::FreePath(dropped[i]->path);
+		delete dropped[i];
+	}
+}
+
+}
@@ -0,0 +1,103 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef PATHSERVICE_H
+#define PATHSERVICE_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "Region.h"
+#include "System/Thread.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace GemRB {
+
+class Map;
+class Movable;
+class PathWorker;
+struct PathNode;
+struct PathSnapshot;
+
+/* Background pathfinding
+ * requests are solved by a pool of worker threads on a copy of the area
+ * searchmap taken once per game tick, so the workers never touch the live
+ * area. The paths are handed back to the actors on the main thread, from
+ * Map::UpdateScripts, on one of the following ticks; a newer request (or a
+ * ClearPath) supersedes the pending one.
+ */
+class GEM_EXPORT PathService {
+public:
+	PathService(unsigned int threads);
+	~PathService();
+
+	/* queues a search for the actor from start to the pixel position goal,
+	 * the actor's own footprint must be already cleared from the searchmap;
+	 * returns the request id the result will be delivered with */
+	unsigned int Submit(Map *area, Movable *actor, const Point &start, const Point &goal, unsigned int MinDistance);
+	/* hands the finished paths of the area to their actors */
+	void Deliver(Map *area);
+	/* forgets everything about the area, called when it is freed */
+	void ClearArea(Map *area);
+
+private:
+	friend class PathWorker;
+
+	struct Job {
+		Map *area;
+		ieDword actorID;
+		unsigned int serial;
+		PathSnapshot *snapshot;
+		Point start, goal, dest;
+		unsigned int size;
+		unsigned int MinDistance;
+		Point patchOrigin;
+		std::vector<unsigned short> patch;
+		PathNode *path;
+		// its area was cleared while it was being solved
+		bool cancelled;
+	};
+	struct AreaSnapshot {
+		PathSnapshot *snapshot;
+		ieDword time;
+	};
+
+	Mutex lock;
+	ConditionVariable wakeup;
+	bool stopping;
+	unsigned int serial;
+	std::deque<Job *> queue;
+	std::vector<Job *> running;
+	std::vector<Job *> done;
+	std::map<Map *, AreaSnapshot> snapshots;
+	std::vector<PathWorker *> workers;
+
+	PathSnapshot *GetSnapshot(Map *area);
+	void Release(PathSnapshot *snapshot);
+	Job *WaitForJob();
+	void Finished(Job *job);
+};
+
+}
+
+#endif
@@ -40,9 +40,11 @@ namespace GemRB {
 /**
  * @class Plugin
  * Base class for all GemRB plugins
+ * The refcount is atomic, since plugins made on the main thread are
+ * often used and dropped by the worker threads.
  */
 
-class GEM_EXPORT Plugin : public Held<Plugin> {
+class GEM_EXPORT Plugin : public Held<Plugin, AtomicRefCount> {
 public:
 	Plugin(void);
 	virtual ~Plugin(void);
@@ -24,11 +24,14 @@
 #include "Variables.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "System/Thread.h"
 
 #include <cstdio>
 #include <cstdlib>
 #include <list>
 #include <set>
+#include <string>
+#include <vector>
 
 #ifdef WIN32
 #include <io.h>
@@ -134,9 +137,33 @@ bool static FindFiles( char* path, std::list<char*> &files )
 }
 #endif  // ! WIN32
 
+/* Reads the plugin files through while the earlier ones are loaded, so
+ * that on slow storage dlopen finds them in the page cache instead of
+ * waiting for the disk in turn for each one.
+ */
+class PluginReader : public Thread {
+public:
+	PluginReader(const std::vector<std::string> &paths) : paths(paths) {}
+	~PluginReader() { Join(); }
+protected:
+	void Run()
+	{
+		char buffer[65536];
+		for (size_t i = 0; i < paths.size(); i++) {
+			FILE *f = fopen(paths[i].c_str(), "rb");
+			if (!f) continue;
+			while (fread(buffer, 1, sizeof(buffer), f) == sizeof(buffer)) {}
+			fclose(f);
+		}
+	}
+private:
+	std::vector<std::string> paths;
+};
+
 void LoadPlugins(char* pluginpath)
 {
 	std::set<PluginID> libs;
+	unsigned long started = GetTickCount();
 
 	Log(MESSAGE, "PluginMgr", "Loading Plugins from %s", pluginpath);
 
@@ -149,6 +176,21 @@ void LoadPlugins(char* pluginpath)
 		return;
 	}
 
+	std::vector<std::string> paths;
+	std::list<char *>::iterator it;
+	for (it = files.begin(); it != files.end(); ++it) {
+		ieDword flags = 0;
+		core->plugin_flags->Lookup(*it, flags);
+		if (flags != PLF_SKIP) {
+			PathJoin(path, pluginpath, *it, NULL);
+			paths.push_back(path);
+		}
+	}
+	PluginReader reader(paths);
+	if (!reader.Start()) {
+		Log(WARNING, "PluginLoader", "Couldn't start the plugin reading thread.");
+	}
+
 	//Iterate through all the available modules to load
 	int file_count = files.size (); // keeps track of first-pass files
 	while (! files.empty()) {
@@ -177,6 +219,8 @@ void LoadPlugins(char* pluginpath)
 
 
 
+		unsigned long loadStart = GetTickCount();
+
 		// Try to load the Module
 #ifdef WIN32
 		HMODULE hMod = LoadLibrary( path );
@@ -228,11 +272,13 @@ void LoadPlugins(char* pluginpath)
 		}
 		libs.insert(desc.ID);
 
-		Log(MESSAGE, "PluginLoader", "Loaded plugin \"%s\" (%s).", desc.Description, file);
+		Log(MESSAGE, "PluginLoader", "Loaded plugin \"%s\" (%s) in %lums.", desc.Description, file, GetTickCount() - loadStart);
 
 		// We do not need the basename anymore now
 		free( file );
 	}
+
+	Log(MESSAGE, "PluginLoader", "Loaded the plugins from %s in %lums.", pluginpath, GetTickCount() - started);
 }
 
 }
@@ -24,6 +24,7 @@
 #include "Interface.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 
@@ -38,6 +39,7 @@ Gem_Polygon::Gem_Polygon(Point* points, unsigned int cnt, Region *bbox)
 		this->points = NULL;
 	}
 	count = cnt;
+	rowTop = 0;
 	if(bbox) BBox=*bbox;
 	else RecalcBBox();
 
@@ -53,6 +55,7 @@ Gem_Polygon::~Gem_Polygon(void)
 
 void Gem_Polygon::RecalcBBox()
 {
+	outlinePoints.clear();
 	if(!count) {
 		BBox.x=BBox.y=BBox.w=BBox.h=0;
 		return;
@@ -80,12 +83,85 @@ void Gem_Polygon::RecalcBBox()
 	BBox.h-=BBox.y;
 }
 
+// the fixed point stepping of the software DrawLine, so the cached stroke
+// covers exactly the pixels the per edge lines did
+static void RasterizeEdge(std::vector<Point>& out, int x1, int y1, int x2, int y2)
+{
+	bool yLonger = false;
+	int shortLen = y2 - y1;
+	int longLen = x2 - x1;
+	if (abs(shortLen) > abs(longLen)) {
+		std::swap(shortLen, longLen);
+		yLonger = true;
+	}
+	int decInc = longLen ? (shortLen << 16) / longLen : 0;
+	int step = longLen < 0 ? -1 : 1;
+	int steps = abs(longLen);
+
+	int j = 0x8000 + ((yLonger ? x1 : y1) << 16);
+	for (int i = 0; i <= steps; i++) {
+		if (yLonger) {
+			out.push_back(Point(j >> 16, y1 + i * step));
+		} else {
+			out.push_back(Point(x1 + i * step, j >> 16));
+		}
+		j += step * decInc;
+	}
+}
+
+const std::vector<Point>& Gem_Polygon::GetOutlinePoints() const
+{
+	if (outlinePoints.empty() && count) {
+		const Point *last = &points[0];
+		for (unsigned int i = 1; i <= count; i++) {
+			const Point *next = &points[i % count];
+			RasterizeEdge(outlinePoints, last->x, last->y, next->x, next->y);
+			last = next;
+		}
+	}
+	return outlinePoints;
+}
+
 bool Gem_Polygon::PointIn(const Point &p) const
 {
 	if(!BBox.PointInside(p) ) return false;
 	return PointIn(p.x, p.y);
 }
 
+// below this the edge loop is about as quick as the row search
+#define ROW_CROSSINGS_MIN_POINTS 8
+
+// the edge loop below, done for each row up front: an edge crosses the row
+// ty if its ends are on different sides of it, and a point is inside if an
+// odd number of the crossings are at or right of it
+void Gem_Polygon::ComputeRowCrossings() const
+{
+	int top = points[0].y;
+	int bottom = points[0].y;
+	unsigned int i;
+	for (i = 1; i < count; i++) {
+		top = std::min(top, (int) points[i].y);
+		bottom = std::max(bottom, (int) points[i].y);
+	}
+	rowTop = top;
+	rowStart.resize(bottom - top + 2);
+	rowCrossings.clear();
+	for (int ty = top; ty <= bottom; ty++) {
+		rowStart[ty - top] = (unsigned int) rowCrossings.size();
+		const Point *vtx0 = &points[count - 1];
+		for (i = 0; i < count; i++) {
+			const Point *vtx1 = &points[i];
+			if ((vtx0->y >= ty) != (vtx1->y >= ty)) {
+				// the same rounding as the edge loop, which can't leave the edge's span
+				rowCrossings.push_back(vtx1->x - (vtx1->y - ty) * (vtx0->x - vtx1->x) / (vtx0->y - vtx1->y));
+			}
+			vtx0 = vtx1;
+		}
+		std::sort(rowCrossings.begin() + rowStart[ty - top], rowCrossings.end());
+	}
+	rowStart[bottom - top + 1] = (unsigned int) rowCrossings.size();
+}
+
 bool Gem_Polygon::PointIn(int tx, int ty) const
 {
 	int   j, yflag0, yflag1, xflag0 , index;
@@ -95,6 +171,20 @@ bool Gem_Polygon::PointIn(int tx, int ty) const
 	if (count<3) {
 		return false;
 	}
+
+	if (count >= ROW_CROSSINGS_MIN_POINTS) {
+		if (rowStart.empty()) {
+			ComputeRowCrossings();
+		}
+		int row = ty - rowTop;
+		if (row < 0 || row + 1 >= (int) rowStart.size()) {
+			return false;
+		}
+		std::vector<int>::const_iterator first = rowCrossings.begin() + rowStart[row];
+		std::vector<int>::const_iterator last = rowCrossings.begin() + rowStart[row + 1];
+		return ((last - std::lower_bound(first, last, tx)) & 1) != 0;
+	}
+
 	index = 0;
 
 	vtx0 = &points[count - 1];
@@ -223,6 +313,7 @@ struct ScanlineInt {
 
 void Gem_Polygon::ComputeTrapezoids()
 {
+	outlinePoints.clear();
 	if (count < 3) return;
 	//the loader never should load such a large polygon, 
 	//because the polygon count is supposed to be a 16 bit value
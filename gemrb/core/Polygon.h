@@ -26,6 +26,7 @@
 #include "Region.h"
 
 #include <list>
+#include <vector>
 
 namespace GemRB {
 
@@ -47,6 +48,17 @@ public:
 	bool PointIn(int x, int y) const;
 	void RecalcBBox();
 	void ComputeTrapezoids();
+	/** the pixels of the closed outline, rasterized like Video::DrawLine strokes the edges */
+	const std::vector<Point>& GetOutlinePoints() const;
+private:
+	// built on the first stroke, dropped when the shape is recomputed
+	mutable std::vector<Point> outlinePoints;
+	// the x where the edges cross each pixel row, sorted, so PointIn is a
+	// search in a single row; built on the first test of a big polygon
+	mutable std::vector<int> rowCrossings;
+	mutable std::vector<unsigned int> rowStart; // a row's first crossing, one past the last row too
+	mutable int rowTop; // the y of the first row
+	void ComputeRowCrossings() const;
 };
 
 // wall polygons are used to render area wallgroups
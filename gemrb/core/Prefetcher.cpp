@@ -0,0 +1,272 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "Prefetcher.h"
+
+#include "win32def.h"
+
+#include "Game.h"
+#include "GameData.h"
+#include "Interface.h"
+#include "Map.h"
+#include "TileMap.h"
+#include "Scriptable/Actor.h"
+#include "Scriptable/InfoPoint.h"
+#include "System/FileStream.h"
+
+namespace GemRB {
+
+// start reading when a party member is this close to an exit (in pixels)
+#define PREFETCH_RADIUS 320
+// and give up once the closest one is this far again
+#define PREFETCH_CANCEL_RADIUS 640
+#define PREFETCH_CHUNK 65536
+
+// the files Game::LoadMap reads for an area, the small ones first
+static const struct {
+	const char *suffix;
+	SClass_ID type;
+} AreaFiles[] = {
+	{ "", IE_ARE_CLASS_ID },
+	{ "", IE_WED_CLASS_ID },
+	{ "SR", IE_BMP_CLASS_ID },
+	{ "HT", IE_BMP_CLASS_ID },
+	{ "LM", IE_BMP_CLASS_ID },
+	{ "", IE_MOS_CLASS_ID },
+	{ "", IE_TIS_CLASS_ID }
+};
+
+class PrefetchWorker : public Thread {
+public:
+	PrefetchWorker(Prefetcher *owner) : prefetcher(owner) {}
+	~PrefetchWorker() { Join(); }
+protected:
+	void Run();
+private:
+	Prefetcher *prefetcher;
+
+	void Read(Prefetcher::Job *job, unsigned int generation, char *buffer);
+};
+
+void PrefetchWorker::Run()
+{
+	char *buffer = (char *) malloc(PREFETCH_CHUNK);
+	Prefetcher::Job *job;
+	unsigned int generation;
+	while ((job = prefetcher->WaitForJob(generation))) {
+		Read(job, generation, buffer);
+		delete job;
+	}
+	free(buffer);
+}
+
+void PrefetchWorker::Read(Prefetcher::Job *job, unsigned int generation, char *buffer)
+{
+	const ResourceLocation &location = job->location;
+	DataStream *stream;
+	if (location.archived) {
+		// a compressed archive gets expanded right here
+		if (job->archive->OpenArchive(location.path) == GEM_ERROR) {
+			return;
+		}
+		stream = job->archive->GetStream(location.locator, location.type);
+	} else {
+		stream = FileStream::OpenFile(location.path);
+	}
+	if (!stream) {
+		return;
+	}
+
+	if (prefetcher->Charge(stream->Size(), generation)) {
+		unsigned long remains;
+		while ((remains = stream->Remains()) && !prefetcher->IsCancelled(generation)) {
+			unsigned int chunk = remains < PREFETCH_CHUNK ? (unsigned int) remains : PREFETCH_CHUNK;
+			if (stream->Read(buffer, chunk) != (int) chunk) {
+				break;
+			}
+		}
+	}
+	delete stream;
+}
+
+// pixels between the point and the rectangle, 0 if it is inside
+static unsigned int RegionDistance(const Region &r, const Point &p)
+{
+	int dx = 0, dy = 0;
+	if (p.x < r.x) {
+		dx = r.x - p.x;
+	} else if (p.x > r.x + r.w) {
+		dx = p.x - (r.x + r.w);
+	}
+	if (p.y < r.y) {
+		dy = r.y - p.y;
+	} else if (p.y > r.y + r.h) {
+		dy = p.y - (r.y + r.h);
+	}
+	return Distance(Point(0, 0), Point(dx, dy));
+}
+
+Prefetcher::Prefetcher(unsigned long budget)
+	: stopping(false), budget(budget), spent(0), generation(0), nextCheck(0)
+{
+	target[0] = 0;
+	worker = new PrefetchWorker(this);
+	if (!worker->Start()) {
+		Log(ERROR, "Prefetcher", "Couldn't start the prefetching thread!");
+		delete worker;
+		worker = NULL;
+	}
+}
+
+Prefetcher::~Prefetcher()
+{
+	Cancel();
+	{
+		MutexLock l(lock);
+		stopping = true;
+		wakeup.Broadcast();
+	}
+	delete worker;
+}
+
+void Prefetcher::Update(Map *area)
+{
+	Game *game = core->GetGame();
+	if (!worker || !area || game->GameTime < nextCheck) {
+		return;
+	}
+	nextCheck = game->GameTime + AI_UPDATE_TIME;
+
+	// the usable exit closest to a party member
+	const InfoPoint *exit = NULL;
+	unsigned int best = 0;
+	TileMap *tm = area->GetTileMap();
+	for (size_t i = 0; i < tm->GetInfoPointCount(); i++) {
+		const InfoPoint *ip = tm->GetInfoPoint((unsigned int) i);
+		if (ip->Type != ST_TRAVEL || !ip->outline || !ip->Destination[0] || (ip->Flags & TRAP_DEACTIVATED)) {
+			continue;
+		}
+		for (int j = 0; j < game->GetPartySize(false); j++) {
+			const Actor *pc = game->GetPC(j, false);
+			if (pc->GetCurrentArea() != area) {
+				continue;
+			}
+			unsigned int distance = RegionDistance(ip->outline->BBox, pc->Pos);
+			if (!exit || distance < best) {
+				exit = ip;
+				best = distance;
+			}
+		}
+	}
+
+	if (exit && !strnicmp(exit->Destination, target, 8) && best < PREFETCH_CANCEL_RADIUS) {
+		return;
+	}
+	if (target[0]) {
+		Cancel();
+		target[0] = 0;
+	}
+	// nothing to gain if the area is still loaded
+	if (!exit || best > PREFETCH_RADIUS || game->FindMap(exit->Destination) != -1) {
+		return;
+	}
+	strnlwrcpy(target, exit->Destination, 8);
+	QueueArea(target);
+}
+
+void Prefetcher::Cancel()
+{
+	MutexLock l(lock);
+	generation++;
+	while (!queue.empty()) {
+		delete queue.front();
+		queue.pop_front();
+	}
+}
+
+void Prefetcher::QueueArea(const ieResRef area)
+{
+	{
+		MutexLock l(lock);
+		spent = 0;
+	}
+	size_t len = strnlen(area, 8);
+	for (size_t i = 0; i < sizeof(AreaFiles) / sizeof(AreaFiles[0]); i++) {
+		size_t suffix = strlen(AreaFiles[i].suffix);
+		if (len + suffix > 8) {
+			continue;
+		}
+		ieResRef resref;
+		memcpy(resref, area, len);
+		memcpy(resref + len, AreaFiles[i].suffix, suffix + 1);
+		Queue(resref, AreaFiles[i].type);
+	}
+}
+
+void Prefetcher::Queue(const char *resref, SClass_ID type)
+{
+	Job *job = new Job;
+	if (!gamedata->LocateResource(resref, type, job->location)) {
+		delete job;
+		return;
+	}
+	if (job->location.archived) {
+		// plugins are only created on the main thread
+		PluginHolder<IndexedArchive> archive(IE_BIF_CLASS_ID);
+		job->archive.swap(archive);
+	}
+
+	MutexLock l(lock);
+	queue.push_back(job);
+	wakeup.Signal();
+}
+
+Prefetcher::Job *Prefetcher::WaitForJob(unsigned int &jobGeneration)
+{
+	MutexLock l(lock);
+	while (!stopping && queue.empty()) {
+		wakeup.Wait(lock);
+	}
+	if (stopping) {
+		return NULL;
+	}
+	Job *job = queue.front();
+	queue.pop_front();
+	jobGeneration = generation;
+	return job;
+}
+
+// books the bytes against the budget, false if they don't fit (anymore)
+bool Prefetcher::Charge(unsigned long size, unsigned int jobGeneration)
+{
+	MutexLock l(lock);
+	if (jobGeneration != generation || spent + size > budget) {
+		return false;
+	}
+	spent += size;
+	return true;
+}
+
+bool Prefetcher::IsCancelled(unsigned int jobGeneration)
+{
+	MutexLock l(lock);
+	return jobGeneration != generation;
+}
+
+}
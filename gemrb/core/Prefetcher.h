@@ -0,0 +1,84 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "IndexedArchive.h"
+#include "PluginMgr.h"
+#include "ResourceSource.h"
+#include "System/Thread.h"
+
+#include <deque>
+
+namespace GemRB {
+
+class Map;
+class PrefetchWorker;
+
+/* Reads the next area ahead while the party walks up to an exit
+ * the main ARE/WED/TIS/BMP/MOS files of the destination of the nearest
+ * travel region are read by a worker thread, so they sit in the page cache
+ * (and the cache directory, for compressed archives) by the time
+ * Game::LoadMap wants them. Reading stops at the budget and the queue is
+ * dropped as soon as the party turns away from the exit.
+ */
+class GEM_EXPORT Prefetcher {
+public:
+	/* budget: the bytes read ahead for one destination */
+	Prefetcher(unsigned long budget);
+	~Prefetcher();
+
+	/* checks the party's way on the area, called every game tick */
+	void Update(Map *area);
+	/* drops whatever wasn't read yet */
+	void Cancel();
+
+private:
+	friend class PrefetchWorker;
+
+	struct Job {
+		ResourceLocation location;
+		PluginHolder<IndexedArchive> archive;
+	};
+
+	Mutex lock;
+	ConditionVariable wakeup;
+	bool stopping;
+	std::deque<Job *> queue;
+	unsigned long budget, spent;
+	// bumped by Cancel, so the job being read can tell
+	unsigned int generation;
+	ieResRef target;
+	ieDword nextCheck;
+	PrefetchWorker *worker;
+
+	void QueueArea(const ieResRef area);
+	void Queue(const char *resref, SClass_ID type);
+	Job *WaitForJob(unsigned int &jobGeneration);
+	bool Charge(unsigned long size, unsigned int jobGeneration);
+	bool IsCancelled(unsigned int jobGeneration);
+};
+
+}
+
+#endif
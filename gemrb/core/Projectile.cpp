@@ -29,6 +29,7 @@
 #include "GlobalTimer.h"
 #include "Image.h"
 #include "Interface.h"
+#include "ObjectPool.h"
 #include "ProjectileServer.h"
 #include "Sprite2D.h"
 #include "VEFObject.h"
@@ -36,6 +37,7 @@
 #include "RNG/RNG_SFMT.h"
 #include "Scriptable/Actor.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
@@ -50,6 +52,19 @@ static const ieByte SixteenToFive[MAX_ORIENT]={0,1,2,3,4,3,2,1,0,1,2,3,4,3,2,1};
 
 static ProjectileServer *server = NULL;
 
+// a volley or a chain of explosions creates and drops lots of them
+static ObjectPool<sizeof(Projectile)> ProjectilePool("projectiles");
+
+void *Projectile::operator new(size_t size)
+{
+	return ProjectilePool.Take(size);
+}
+
+void Projectile::operator delete(void *obj, size_t size)
+{
+	ProjectilePool.Give(obj, size);
+}
+
 Projectile::Projectile()
 {
 	autofree = false;
@@ -216,7 +231,8 @@ void Projectile::CreateOrientedAnimations(Animation **anims, AnimationFactory *a
 			c=Cycle;
 			break;
 		}
-		Animation* a = af->GetCycle( c );
+		// the factory shares the mirrored frames between the projectiles
+		Animation* a = af->GetCycle( c, mirror, mirrorvert );
 		anims[Cycle] = a;
 		if (!a) continue;
 		//animations are started at a random frame position
@@ -225,12 +241,6 @@ void Projectile::CreateOrientedAnimations(Animation **anims, AnimationFactory *a
 			a->SetPos(0);
 		}
 
-		if (mirror) {
-			a->MirrorAnimation();
-		}
-		if (mirrorvert) {
-			a->MirrorAnimationVert();
-		}
 		a->gameAnimation = true;
 	}
 }
@@ -466,14 +476,14 @@ Actor *Projectile::GetTarget()
 				Target = original->GetGlobalID();
 				target = original;
 			} else {
-				Log(DEBUG, "Projectile", "GetTarget: caster not found, bailing out!");
+				LogDebug("Projectile", "GetTarget: caster not found, bailing out!");
 				return NULL;
 			}
 		}
 		effects->SetOwner(original);
 		return target;
 	} else {
-		Log(DEBUG, "Projectile", "GetTarget: Target not set or dummy, using caster!");
+		LogDebug("Projectile", "GetTarget: Target not set or dummy, using caster!");
 	}
 	target = area->GetActorByGlobalID(Caster);
 	if (target) {
@@ -988,14 +998,10 @@ void Projectile::MoveTo(Map *map, const Point &Des)
 
 void Projectile::ClearPath()
 {
-	PathNode* thisNode = path;
-	while (thisNode) {
-		PathNode* nextNode = thisNode->Next;
-		delete( thisNode );
-		thisNode = nextNode;
-	}
+	PathNode::FreePath(path);
 	path = NULL;
 	step = NULL;
+	linePoints.clear();
 }
 
 int Projectile::CalculateTargetFlag()
@@ -1083,12 +1089,37 @@ void Projectile::LineTarget()
 		return;
 	}
 
+	if (!path) {
+		return;
+	}
+
+	//the actors along the whole path are gathered once instead of per step,
+	//a copy, since applying the effects may query the area again
+	int left = path->x, top = path->y, right = path->x, bottom = path->y;
+	PathNode *iter;
+	for (iter = path->Next; iter; iter = iter->Next) {
+		left = std::min(left, (int) iter->x);
+		top = std::min(top, (int) iter->y);
+		right = std::max(right, (int) iter->x);
+		bottom = std::max(bottom, (int) iter->y);
+	}
+	std::vector<Actor*> candidates = area->GetActorsNear(Region(left, top, right - left, bottom - top), 1);
+
 	Actor *original = area->GetActorByGlobalID(Caster);
 	Actor *prev = NULL;
-	PathNode *iter = path;
+	iter = path;
 	while(iter) {
 		Point pos(iter->x,iter->y);
-		Actor *target = area->GetActorInRadius(pos, CalculateTargetFlag(), 1);
+		//the last candidate within reach, as GetActorInRadius would pick it
+		int flags = CalculateTargetFlag();
+		Actor *target = NULL;
+		size_t i = candidates.size();
+		while (i--) {
+			if (PersonalDistance(pos, candidates[i]) > 1) continue;
+			if (!candidates[i]->ValidTarget(flags)) continue;
+			target = candidates[i];
+			break;
+		}
 		if (target && target->GetGlobalID()!=Caster && prev!=target) {
 			prev = target;
 	 		int res = effects->CheckImmunity ( target );
@@ -1617,21 +1648,36 @@ void Projectile::DrawLine(const Region &screen, int face, ieDword flag)
 {
 	Video *video = core->GetVideoDriver();
 	Game *game = core->GetGame();
-	PathNode *iter = path;
 	Sprite2D *frame = travel[face]->NextFrame();
+	if (!frame) {
+		return;
+	}
 	Color tint2 = tint;
 	if (game) game->ApplyGlobalTint(tint2, flag);
-	while(iter) {
-		Point pos(iter->x, iter->y);
 
-		if (SFlags&PSF_FLYING) {
-			pos.y-=FLY_HEIGHT;
+	//beams are long and dense, so the path is only walked once
+	if (linePoints.empty()) {
+		for (PathNode *iter = path; iter; iter = iter->Next) {
+			Point pos(iter->x, iter->y);
+			if (SFlags&PSF_FLYING) {
+				pos.y-=FLY_HEIGHT;
+			}
+			linePoints.push_back(pos);
 		}
-		pos.x+=screen.x;
-		pos.y+=screen.y;
+	}
 
-		video->BlitGameSprite( frame, pos.x, pos.y, flag, tint2, NULL, palette, &screen);
-		iter = iter->Next;
+	//the parts of the beam off the screen aren't even queued
+	Region vp = video->GetViewport();
+	int left = vp.x + frame->XPos - frame->Width;
+	int top = vp.y + frame->YPos - frame->Height;
+	int right = vp.x + screen.w + frame->XPos;
+	int bottom = vp.y + screen.h + frame->YPos;
+	for (size_t i = 0; i < linePoints.size(); i++) {
+		const Point &pos = linePoints[i];
+		if (pos.x <= left || pos.y <= top || pos.x >= right || pos.y >= bottom) {
+			continue;
+		}
+		video->BlitGameSprite( frame, pos.x + screen.x, pos.y + screen.y, flag, tint2, NULL, palette, &screen);
 	}
 }
 
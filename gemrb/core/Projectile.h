@@ -188,6 +188,9 @@ class GEM_EXPORT Projectile
 public:
 	Projectile();
 	~Projectile();
+	// the finished ones leave their memory for the next ones
+	static void *operator new(size_t size);
+	static void operator delete(void *obj, size_t size);
 	void InitExtension();
 
 	ieWord Speed;
@@ -235,6 +238,8 @@ protected:
 	unsigned char Orientation, NewOrientation;
 	PathNode* path; //whole path
 	PathNode* step; //actual step
+	//the points of the path as DrawLine places them, built on the first draw
+	std::vector<Point> linePoints;
 	//similar to normal actors
 	Map *area;
 	Point Pos;
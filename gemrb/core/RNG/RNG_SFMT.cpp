@@ -6,20 +6,14 @@
 #include <ctime>
 #endif
 
-// This is from gcc sources, namely from fixincludes/inclhack.def
-// On C++11 systems, <cstdint> could be included instead.
-#ifndef UINT64_MAX
-#define UINT64_MAX (~(uint64_t)0)
-#endif
+uint32_t RNG_SFMT::masterSeed = 0;
 
 /**
- * The constructor initializes the random number generator with a 32bit integer seed
- * based on a hashed value of the current timestamp.
- * The singleton implementation guarantees that the constructor is called only once,
- * which means that the RNG is seeded only once which means that it is ok to use the
- * timestamp for seeding (because it can only be used once per second).
+ * Hashes the current timestamp into a 32bit integer seed.
+ * The shared streams are seeded only once this way, which means that it is ok to use
+ * the timestamp for seeding (because it can only be used once per second).
  */
-RNG_SFMT::RNG_SFMT() {
+static uint32_t TimeSeed() {
   time_t now = time(NULL);	// current time
   unsigned char *ptr = (unsigned char *) &now;	// type-punned pointer into now variable
   uint32_t seed = 0;
@@ -33,18 +27,85 @@ RNG_SFMT::RNG_SFMT() {
      */
     seed = seed * (UCHAR_MAX + 2u) + ptr[i];
   }
-  
+  return seed;
+}
+
+/**
+ * The shared streams are left unseeded here, getStream seeds them all together.
+ */
+RNG_SFMT::RNG_SFMT() {
+  blockPos = SFMT_N64;
+}
+
+RNG_SFMT::RNG_SFMT(uint32_t seed) {
+  this->seed(seed);
+}
+
+/**
+ * Starts the sequence over from the given seed, the same seed gives the same numbers.
+ */
+void RNG_SFMT::seed(uint32_t seed) {
   sfmt_init_gen_rand(&sfmt, seed);
+  // drop what is left of the old block
+  blockPos = SFMT_N64;
+}
+
+/**
+ * Every stream gets its own seed, spread out by the golden ratio so that neighbouring
+ * stream numbers don't start from neighbouring seeds.
+ */
+uint32_t RNG_SFMT::streamSeed(int stream) {
+  return masterSeed + (uint32_t) stream * 0x9E3779B9u;
 }
 
 /**
- * This creates an instance of the singleton class RNG_SFMT. Call this instead of the
+ * Returns the shared instance for the given stream. Call this instead of the
  * constructor.
  */
+RNG_SFMT* RNG_SFMT::getStream(int stream) {
+  static RNG_SFMT theStreams[STREAM_COUNT];
+  static bool seeded = false;
+  if (!seeded) {
+    seeded = true;
+    masterSeed = TimeSeed();
+    for (int i = 0; i < STREAM_COUNT; i++) {
+      theStreams[i].seed(streamSeed(i));
+    }
+  }
+  return &theStreams[stream];
+}
+
+/**
+ * The stream used by the game logic.
+ */
 RNG_SFMT* RNG_SFMT::getInstance() {
-  // This is the variable that makes the class singleton. So you better not change it ;-)
-  static RNG_SFMT theInstance;
-  return &theInstance;
+  return getStream(STREAM_GAME);
+}
+
+/**
+ * Reseeds every shared stream from one master seed.
+ */
+void RNG_SFMT::seedStreams(uint32_t seed) {
+  // make sure the time based seeding doesn't come after this
+  getStream(STREAM_GAME);
+  masterSeed = seed;
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    getStream(i)->seed(streamSeed(i));
+  }
+}
+
+/**
+ * SFMT generates a whole block at once, which gives the same sequence as calling
+ * sfmt_genrand_uint64 for each number.
+ */
+uint64_t RNG_SFMT::next() {
+  if (blockPos == SFMT_N64) {
+    sfmt_fill_array64(&sfmt, &block[0].u64[0], SFMT_N64);
+    blockPos = 0;
+  }
+  uint64_t rand = block[blockPos / 2].u64[blockPos % 2];
+  blockPos++;
+  return rand;
 }
 
 /**
@@ -85,7 +146,7 @@ unsigned int RNG_SFMT::rand(int min, int max) {
  * code.
  * Let SFMT() be an alias for sfmt_genrand_uint64() aka SFMT's rand() function.
  *
- * SMFT() returns a uniformly distributed pseudorandom number 0 - UINT64_MAX.
+ * SMFT() returns a uniformly distributed pseudorandom number 0 - 2^64-1.
  * As SFMT() operates on a limited integer range, it is a _discrete_ function.
  *
  * We want a random number from a given interval [min, max] though, so we need
@@ -116,14 +177,16 @@ unsigned int RNG_SFMT::rand(int min, int max) {
  * sides 1-5 show up, while 6 represents something that you don't want. So you
  * basically roll a five sided die.
  *
- * Note: If you replace the SFMT RNG with some other rand() function in the
- * future, then you _need_ to change the UINT64_MAX constant to the largest possible
- * random number which can be created by the new rand() function. This value is often
- * defined in a RAND_MAX constant.
- * Otherwise you will probably skew the outcome of the rand() method or worsen
- * the performance of the application.
+ * Instead of dividing, the buckets are found by multiplying (Lemire's method):
+ * the top 32 bits X of SFMT() times the diameter D form a 64bit product, whose
+ * upper half is the bucket and lower half the position inside it. Of the 2^32
+ * positions, 2^32 % D are one too many for an even split, so products whose lower
+ * half falls below that are rolled again. This test only needs the remainder when
+ * the lower half is smaller than D, which is rare, so nearly every call gets away
+ * with a single multiplication.
  *
- * In threaded environments check the method's code for information on mutexes!
+ * Note: If you replace the SFMT RNG with some other rand() function in the
+ * future, make sure it still gives at least 32 uniformly distributed bits.
  */
 unsigned int RNG_SFMT::cdf(unsigned int min, unsigned int max) {
   // This all makes no sense if min > max, which should never happen.
@@ -133,40 +196,20 @@ unsigned int RNG_SFMT::cdf(unsigned int min, unsigned int max) {
     // basically the exception itself is returned.
   }
 
-  // First compute the diameter (aka size, length) of the [min, max] interval
-  const unsigned int diameter = max - min + 1;
-
-  // Compute how many buckets (each in size of the diameter) will fit into the
-  // universe.
-  // If the division has a remainder, the result is floored automatically.
-  const uint64_t buckets = UINT64_MAX / diameter;
-
-  // Compute the last valid random number. All numbers beyond have to be
-  // ignored.
-  // If there was no remainder in the previous step, limit is equal to
-  // UINT64_MAX.
-  const uint64_t limit = diameter * buckets;
-
-  uint64_t rand;
-  
-  /**
-   * To make the random number generation thread-safe, a mutex should be created
-   * around the number generation. Outside of the loop of course, to avoid locking
-   * overhead.
-   * In this case replace the lock/unlock comment and you probably also want to use
-   * the vectorized functions from SFMT to generate many random numbers at once.
-   */
-
-  /**** call mutex.lock() here ****/
-  
-  do {
-    rand = sfmt_genrand_uint64(&sfmt);
-  } while (rand >= limit);
-  
-  /**** call mutex.unlock() here ****/
+  // First compute the diameter (aka size, length) of the [min, max] interval,
+  // rand() keeps both bounds below INT_MAX, so it always fits
+  const uint32_t diameter = max - min + 1;
+
+  uint64_t product = (next() >> 32) * diameter;
+  uint32_t low = (uint32_t) product;
+  if (low < diameter) {
+    // the number of surplus positions, 2^32 % diameter
+    const uint32_t threshold = (0u - diameter) % diameter;
+    while (low < threshold) {
+      product = (next() >> 32) * diameter;
+      low = (uint32_t) product;
+    }
+  }
 
-  // Now determine the bucket containing the SFMT() random number and after
-  // adding the lower bound, a random number from [min, max] can be returned.
-  return (unsigned int)(rand / buckets + min);
+  return (unsigned int)(product >> 32) + min;
 }
-
@@ -5,6 +5,7 @@
 #include "sfmt/SFMT.h"
 
 #define RAND(min, max) RNG_SFMT::getInstance()->rand(min, max)
+#define VISUAL_RAND(min, max) RNG_SFMT::getStream(RNG_SFMT::STREAM_VISUAL)->rand(min, max)
 
 /**
  * This class encapsulates a state of the art PRNG in a singleton class and can be used
@@ -15,37 +16,60 @@
  * This is the only exception to the rule that !(min > max) and is used as a workaround
  * for some parts of the code where negative modulo could occur.
  *
- * As the class is a singleton, only one instance exists. Access it by using the
- * getInstance() method, e.g. by writing
+ * The game logic uses a shared instance, access it by using the getInstance() method,
+ * e.g. by writing
  * RNG_SFMT::getInstance()->rand(1,6);
  * which may be abbreviated by
  * RAND(1,6);
  *
+ * Purely cosmetic rolls (animation phases, screen shake) use their own stream through
+ * VISUAL_RAND, so how many frames get drawn never shifts the game's dice. All the
+ * shared streams are seeded from one master seed with seedStreams(), which keeps
+ * recorded sessions reproducible.
+ *
  * Technical details:
  * The RNG uses the SIMD-oriented Fast Mersenne Twister code v1.4.1 from
  * http://www.math.sci.hiroshima-u.ac.jp/~%20m-mat/MT/SFMT/index.html
  * The SFMT RNG creates unsigned int 64bit pseudo random numbers.
  *
- * These are mapped to values from the interval [min, max] without bias by using Knuth's
- * "Algorithm S (Selection sampling technique)" from "The Art of Computer Programming 3rd
- * Edition Volume 2 / Seminumerical Algorithms".
+ * They are generated a block at a time with sfmt_fill_array64 and handed out from
+ * that buffer.
+ *
+ * These are mapped to values from the interval [min, max] without bias by a
+ * multiply and shift with rejection of the few uneven products, see cdf().
  *
- * In a threaded environment you probably must use mutexes to make this class thread-safe.
- * There are comments in the cdf-method's code about that.
+ * An instance is not thread-safe. The shared streams belong to the main thread,
+ * any other thread that needs random numbers should own an instance created with
+ * RNG_SFMT(RNG_SFMT::streamSeed(n)) for a stream number n of its own.
  */
 
 class RNG_SFMT {
+public:
+  // the shared streams, other numbers are free for threads with their own instance
+  enum Stream { STREAM_GAME, STREAM_VISUAL, STREAM_COUNT };
+
 private:
-  // only one instance will be allowed, use getInstance
+  // the shared streams are created by getStream
   RNG_SFMT();
 
   // The discrete cumulative distribution function for the RNG
   unsigned int cdf(unsigned int min, unsigned int max);
 
+  // the next 64 bits from the buffer, refilling it when it runs out
+  uint64_t next();
+
   // SFMT's internal state
   sfmt_t sfmt;
 
+  // a block of generated numbers, w128_t keeps it aligned for the SIMD code
+  w128_t block[SFMT_N];
+  int blockPos;
+
+  static uint32_t masterSeed;
+
 public:
+  explicit RNG_SFMT(uint32_t seed);
+
   /* The RNG function to use via
    * RNG_SFMT::getInstance()->rand(min, max);
    * or
@@ -53,6 +77,16 @@ public:
    */
   unsigned int rand(int min = 0, int max = INT_MAX-1);
   static RNG_SFMT* getInstance();
+  static RNG_SFMT* getStream(int stream);
+
+  /* Restarts the sequence of this instance */
+  void seed(uint32_t seed);
+
+  /* Restarts all the shared streams, for replaying a recorded session */
+  static void seedStreams(uint32_t seed);
+
+  /* The seed of the given stream derived from the current master seed */
+  static uint32_t streamSeed(int stream);
 };
 
 #endif
@@ -25,12 +25,46 @@
 #include "Resource.h"
 #include "ResourceDesc.h"
 #include "ResourceSource.h"
+#include "ResourceStats.h"
+#include "StartupTimeline.h"
+#include "Tracer.h"
 #include "System/StringBuffer.h"
 
 namespace GemRB {
 
+// only grows between invalidations, so start generously
+#define MISSES_TABLE_SIZE 1024
+#define MISSES_BLOCK_SIZE 128
+
+// the resource names aren't case sensitive
+static void LowerKey(char *key)
+{
+	for (; *key; key++) {
+		*key = (char) tolower(*key);
+	}
+}
+
+static void MissKey(char *key, const char *ResRef, SClass_ID type)
+{
+	snprintf(key, _MAX_PATH, "%s.%x", ResRef, (unsigned int) type);
+	LowerKey(key);
+}
+
+static void MissKey(char *key, const char *ResRef, const TypeID *type)
+{
+	snprintf(key, _MAX_PATH, "%s:%p", ResRef, (const void *) type);
+	LowerKey(key);
+}
+
+// small enough to keep the bytes around, the tables, icons and short sounds
+#define HOT_RESOURCE_SIZE 16384
+#define HOT_RESOURCE_BUDGET (4*1024*1024)
+
 ResourceManager::ResourceManager()
 {
+	ForgetMisses();
+	hotBytes = hotClock = 0;
+	hotRevision = ResourceSource::GetRevision();
 }
 
 
@@ -56,9 +90,141 @@ bool ResourceManager::AddSource(const char *path, const char *description, Plugi
 	} else {
 		searchPath.push_back(source);
 	}
+	ForgetMisses();
+	ForgetHot();
 	return true;
 }
 
+void ResourceManager::ForgetHot() const
+{
+	MutexLock l(hotLock);
+	hotResources.clear();
+	hotBytes = 0;
+	hotRevision = ResourceSource::GetRevision();
+}
+
+static std::string HotKey(const char *ResRef, const char *ext)
+{
+	std::string key(ResRef);
+	key += '.';
+	key += ext;
+	for (size_t i = 0; i < key.length(); i++) {
+		key[i] = (char) tolower(key[i]);
+	}
+	return key;
+}
+
+//a shared stream of the kept bytes, unless a live source in front of the
+//one they came from has got the resource since
+DataStream* ResourceManager::GetHot(const char *ResRef, const char *ext, SClass_ID type, const ResourceDesc *desc) const
+{
+	std::string key = HotKey(ResRef, ext);
+	Holder<MemoryBlock> bytes;
+	std::string name;
+	size_t source;
+	{
+		MutexLock l(hotLock);
+		if (hotRevision != ResourceSource::GetRevision()) {
+			hotResources.clear();
+			hotBytes = 0;
+			hotRevision = ResourceSource::GetRevision();
+			return NULL;
+		}
+		std::map<std::string, HotResource>::iterator it = hotResources.find(key);
+		if (it == hotResources.end()) {
+			return NULL;
+		}
+		it->second.lastUse = ++hotClock;
+		bytes = it->second.bytes;
+		name = it->second.name;
+		source = it->second.source;
+	}
+
+	for (size_t i = 0; i < source; i++) {
+		if (!searchPath[i]->IsLive()) continue;
+		if (desc ? searchPath[i]->HasResource(ResRef, *desc) : searchPath[i]->HasResource(ResRef, type)) {
+			MutexLock l(hotLock);
+			std::map<std::string, HotResource>::iterator it = hotResources.find(key);
+			if (it != hotResources.end()) {
+				hotBytes -= it->second.bytes->GetSize();
+				hotResources.erase(it);
+			}
+			return NULL;
+		}
+	}
+	return new SharedMemoryStream(bytes.get(), name.c_str());
+}
+
+//reads a small stream into the kept bytes, returning a stream over them instead
+DataStream* ResourceManager::KeepHot(const char *ResRef, const char *ext, size_t source, DataStream *str) const
+{
+	unsigned long size = str->Size();
+	if (searchPath[source]->IsLive() || size > HOT_RESOURCE_SIZE) {
+		return str;
+	}
+	void *data = malloc(size ? size : 1);
+	if (size && str->Read(data, size) != (int) size) {
+		free(data);
+		str->Seek(0, GEM_STREAM_START);
+		return str;
+	}
+	Holder<MemoryBlock> bytes(new MemoryBlock(data, size));
+	SharedMemoryStream *shared = new SharedMemoryStream(bytes.get(), str->originalfile);
+	delete str;
+
+	MutexLock l(hotLock);
+	//the least recently used ones make room
+	while (hotBytes + size > HOT_RESOURCE_BUDGET && !hotResources.empty()) {
+		std::map<std::string, HotResource>::iterator oldest = hotResources.begin();
+		std::map<std::string, HotResource>::iterator it;
+		for (it = hotResources.begin(); it != hotResources.end(); ++it) {
+			if (it->second.lastUse < oldest->second.lastUse) {
+				oldest = it;
+			}
+		}
+		hotBytes -= oldest->second.bytes->GetSize();
+		hotResources.erase(oldest);
+	}
+	std::string key = HotKey(ResRef, ext);
+	std::map<std::string, HotResource>::iterator it = hotResources.find(key);
+	if (it != hotResources.end()) {
+		hotBytes -= it->second.bytes->GetSize();
+	}
+	HotResource &hot = hotResources[key];
+	hot.bytes = bytes;
+	hot.name = shared->originalfile;
+	hot.source = source;
+	hot.lastUse = ++hotClock;
+	hotBytes += size;
+	return shared;
+}
+
+// the workers look resources up too, so the misses are only touched under missLock
+void ResourceManager::ForgetMisses() const
+{
+	MutexLock l(missLock);
+	misses.init(MISSES_TABLE_SIZE, MISSES_BLOCK_SIZE);
+	missRevision = ResourceSource::GetRevision();
+}
+
+bool ResourceManager::IsMissing(const char *key) const
+{
+	MutexLock l(missLock);
+	// a cached directory got rescanned
+	if (missRevision != ResourceSource::GetRevision()) {
+		misses.init(MISSES_TABLE_SIZE, MISSES_BLOCK_SIZE);
+		missRevision = ResourceSource::GetRevision();
+		return false;
+	}
+	return misses.has(key);
+}
+
+void ResourceManager::AddMissing(const char *key) const
+{
+	MutexLock l(missLock);
+	misses.set(key, std::string());
+}
+
 static void PrintPossibleFiles(StringBuffer& buffer, const char* ResRef, const TypeID *type)
 {
 	const std::vector<ResourceDesc>& types = PluginMgr::Get()->GetResourceDesc(type);
@@ -71,12 +237,18 @@ bool ResourceManager::Exists(const char *ResRef, SClass_ID type, bool silent) co
 {
 	if (ResRef[0] == '\0')
 		return false;
-	// TODO: check various caches
+	char key[_MAX_PATH];
+	MissKey(key, ResRef, type);
+	bool missing = IsMissing(key);
 	for (size_t i = 0; i < searchPath.size(); i++) {
+		if (missing && !searchPath[i]->IsLive())
+			continue;
 		if (searchPath[i]->HasResource( ResRef, type )) {
 			return true;
 		}
 	}
+	if (!missing)
+		AddMissing(key);
 	if (!silent) {
 		Log(WARNING, "ResourceManager", "'%s.%s' not found...",
 			ResRef, core->TypeExt(type));
@@ -88,15 +260,21 @@ bool ResourceManager::Exists(const char *ResRef, const TypeID *type, bool silent
 {
 	if (ResRef[0] == '\0')
 		return false;
-	// TODO: check various caches
+	char key[_MAX_PATH];
+	MissKey(key, ResRef, type);
+	bool missing = IsMissing(key);
 	const std::vector<ResourceDesc> &types = PluginMgr::Get()->GetResourceDesc(type);
 	for (size_t j = 0; j < types.size(); j++) {
 		for (size_t i = 0; i < searchPath.size(); i++) {
+			if (missing && !searchPath[i]->IsLive())
+				continue;
 			if (searchPath[i]->HasResource(ResRef, types[j])) {
 				return true;
 			}
 		}
 	}
+	if (!missing)
+		AddMissing(key);
 	if (!silent) {
 		StringBuffer buffer;
 		buffer.appendFormatted("Couldn't find '%s'... ", ResRef);
@@ -109,11 +287,29 @@ bool ResourceManager::Exists(const char *ResRef, const TypeID *type, bool silent
 
 DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, bool silent) const
 {
+	TRACE_SCOPE_DETAIL("ResourceManager::GetResource", ResRef);
 	if (ResRef[0] == '\0')
 		return NULL;
+	DataStream *hot = GetHot(ResRef, core->TypeExt(type), type, NULL);
+	if (hot) {
+		return hot;
+	}
+	ResourceRequest request;
+	request.SetType(type);
+	char key[_MAX_PATH];
+	MissKey(key, ResRef, type);
+	bool missing = IsMissing(key);
+	if (missing)
+		request.SetKnownMissing();
 	for (size_t i = 0; i < searchPath.size(); i++) {
+		if (missing && !searchPath[i]->IsLive())
+			continue;
+		request.BeginSource();
 		DataStream *ds = searchPath[i]->GetResource(ResRef, type);
+		request.EndSource(ds, searchPath[i]->GetDescription());
 		if (ds) {
+			ds = KeepHot(ResRef, core->TypeExt(type), i, ds);
+			StartupTimeline::CountResource();
 			if (!silent) {
 				Log(MESSAGE, "ResourceManager", "Found '%s.%s' in '%s'.",
 					ResRef, core->TypeExt(type), searchPath[i]->GetDescription());
@@ -121,6 +317,8 @@ DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, boo
 			return ds;
 		}
 	}
+	if (!missing)
+		AddMissing(key);
 	if (!silent) {
 		Log(ERROR, "ResourceManager", "Couldn't find '%s.%s'.",
 			ResRef, core->TypeExt(type));
@@ -130,15 +328,42 @@ DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, boo
 
 Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, bool silent, bool useCorrupt) const
 {
+	TRACE_SCOPE_DETAIL("ResourceManager::GetResource", ResRef);
 	if (ResRef[0] == '\0')
 		return NULL;
 	if (!silent) {
 		Log(MESSAGE, "ResourceManager", "Searching for '%s'...", ResRef);
 	}
+	ResourceRequest request;
+	char key[_MAX_PATH];
+	MissKey(key, ResRef, type);
+	bool missing = IsMissing(key);
+	if (missing)
+		request.SetKnownMissing();
+	// a stream that failed to load isn't a miss, it is still there
+	bool found = false;
 	const std::vector<ResourceDesc> &types = PluginMgr::Get()->GetResourceDesc(type);
+	if (types.size())
+		request.SetType(types[0].GetExt());
 	for (size_t j = 0; j < types.size(); j++) {
+		DataStream *hot = GetHot(ResRef, types[j].GetExt(), 0, &types[j]);
+		if (hot) {
+			//a kept one that fails to load is looked up the long way
+			request.SetType(types[j].GetExt());
+			Resource *res = types[j].Create(hot);
+			if (res) {
+				return res;
+			}
+		}
 		for (size_t i = 0; i < searchPath.size(); i++) {
+			if (missing && !searchPath[i]->IsLive())
+				continue;
+			request.BeginSource();
 			DataStream *str = searchPath[i]->GetResource(ResRef, types[j]);
+			request.EndSource(str, searchPath[i]->GetDescription());
+			if (str) {
+				str = KeepHot(ResRef, types[j].GetExt(), i, str);
+			}
 			if (!str && useCorrupt && core->UseCorruptedHack) {
 				// don't look at other paths if requested
 				core->UseCorruptedHack = false;
@@ -146,8 +371,17 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 			}
 			core->UseCorruptedHack = false;
 			if (str) {
-				Resource *res = types[j].Create(str);
+				found = true;
+				request.SetType(types[j].GetExt());
+				request.BeginParse();
+				Resource *res;
+				{
+					TRACE_SCOPE_DETAIL("Import", types[j].GetExt());
+					res = types[j].Create(str);
+				}
+				request.EndParse(res != NULL);
 				if (res) {
+					StartupTimeline::CountResource();
 					if (!silent) {
 						Log(MESSAGE, "ResourceManager", "Found '%s.%s' in '%s'.",
 							ResRef, types[j].GetExt(), searchPath[i]->GetDescription());
@@ -157,6 +391,8 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 			}
 		}
 	}
+	if (!missing && !found)
+		AddMissing(key);
 	if (!silent) {
 		StringBuffer buffer;
 		buffer.appendFormatted("Couldn't find '%s'... ", ResRef);
@@ -167,4 +403,17 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 	return NULL;
 }
 
+bool ResourceManager::LocateResource(const char* ResRef, SClass_ID type, ResourceLocation &location) const
+{
+	if (ResRef[0] == '\0')
+		return false;
+	// the same source GetResource would read it from
+	for (size_t i = 0; i < searchPath.size(); i++) {
+		if (searchPath[i]->HasResource(ResRef, type)) {
+			return searchPath[i]->LocateResource(ResRef, type, location);
+		}
+	}
+	return false;
+}
+
 }
@@ -25,7 +25,12 @@
 #include "exports.h"
 
 #include "Holder.h"
+#include "StringMap.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
 
+#include <map>
+#include <string>
 #include <vector>
 
 #if defined(_MSC_VER) || defined(__sgi) // No SFINAE
@@ -38,6 +43,8 @@ namespace GemRB {
 
 class DataStream;
 class Resource;
+class ResourceDesc;
+struct ResourceLocation;
 #ifndef __sgi
 class ResourceSource;
 #endif
@@ -66,9 +73,37 @@ public:
 	DataStream* GetResource(const char* resname, SClass_ID type, bool silent = false) const;
 	/** Returns Resource object associated to given resource */
 	Resource* GetResource(const char* resname, const TypeID *type, bool silent = false, bool useCorrupt = false) const;
+	/** Tells where the stream of the resource would come from */
+	bool LocateResource(const char* resname, SClass_ID type, ResourceLocation &location) const;
 
 private:
 	std::vector<Holder<ResourceSource> > searchPath;
+	/** lookups no source had an answer for, keyed by the lowercased name
+	 * and type, only the live sources get asked again about these */
+	mutable StringMap misses;
+	mutable unsigned int missRevision;
+	mutable Mutex missLock;
+
+	bool IsMissing(const char *key) const;
+	void AddMissing(const char *key) const;
+	void ForgetMisses() const;
+
+	/** the bytes of a small resource from a source that doesn't change
+	 * behind our back, read once and then handed out as shared streams */
+	struct HotResource {
+		Holder<MemoryBlock> bytes;
+		std::string name;
+		size_t source;
+		unsigned long lastUse;
+	};
+	mutable std::map<std::string, HotResource> hotResources;
+	mutable unsigned long hotBytes, hotClock;
+	mutable unsigned int hotRevision;
+	mutable Mutex hotLock;
+
+	DataStream* GetHot(const char *ResRef, const char *ext, SClass_ID type, const ResourceDesc *desc) const;
+	DataStream* KeepHot(const char *ResRef, const char *ext, size_t source, DataStream *str) const;
+	void ForgetHot() const;
 };
 
 }
@@ -20,8 +20,14 @@
 
 #include "ResourceSource.h"
 
+#include "System/Thread.h"
+
 namespace GemRB {
 
+unsigned int ResourceSource::Revision = 0;
+// the worker threads look resources up too
+static Mutex RevisionLock;
+
 ResourceSource::ResourceSource(void)
 {
 	description = NULL;
@@ -31,4 +37,26 @@ ResourceSource::~ResourceSource(void)
 {
 }
 
+bool ResourceSource::LocateResource(const char* /*resname*/, SClass_ID /*type*/, ResourceLocation &/*location*/)
+{
+	return false;
+}
+
+bool ResourceSource::IsLive() const
+{
+	return false;
+}
+
+unsigned int ResourceSource::GetRevision()
+{
+	MutexLock l(RevisionLock);
+	return Revision;
+}
+
+void ResourceSource::Changed()
+{
+	MutexLock l(RevisionLock);
+	Revision++;
+}
+
 }
@@ -32,6 +32,16 @@ namespace GemRB {
 class DataStream;
 class ResourceDesc;
 
+/** Where a resource is stored, so it can be read without its source. */
+struct ResourceLocation {
+	/** the file holding the resource */
+	char path[_MAX_PATH];
+	/** true if path is an archive, holding it under locator */
+	bool archived;
+	ieDword locator;
+	SClass_ID type;
+};
+
 class GEM_EXPORT ResourceSource : public Plugin {
 public:
 	ResourceSource(void);
@@ -41,9 +51,19 @@ public:
 	virtual bool HasResource(const char* resname, const ResourceDesc &type) = 0;
 	virtual DataStream* GetResource(const char* resname, SClass_ID type) = 0;
 	virtual DataStream* GetResource(const char* resname, const ResourceDesc &type) = 0;
+	/** returns false if the resource is missing or its place can't be told */
+	virtual bool LocateResource(const char* resname, SClass_ID type, ResourceLocation &location);
+	/** true if the source looks at the disk on every lookup, so its
+	 * contents can change behind our back */
+	virtual bool IsLive() const;
 	const char *GetDescription() const { return description; }
+	/** bumped whenever a source rescans its contents, on any thread */
+	static unsigned int GetRevision();
 protected:
 	char *description;
+	static void Changed();
+private:
+	static unsigned int Revision;
 };
 
 }
@@ -0,0 +1,337 @@
+/* GemRB - Infinity Engine Emulator
+* Copyright (C) 2003-2005 The GemRB Project
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*
+*/
+
+#include "ResourceStats.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include "Interface.h"
+#include "System/FileStream.h"
+#include "System/StringBuffer.h"
+#include "System/Thread.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+struct ResourceTally {
+	unsigned long requests, found, missing, knownMissing, failed;
+	unsigned __int64 bytes;
+	unsigned __int64 time[ResourceStats::PHASE_COUNT];
+
+	ResourceTally() : requests(0), found(0), missing(0), knownMissing(0), failed(0), bytes(0)
+	{
+		for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+			time[i] = 0;
+		}
+	}
+	unsigned __int64 Total() const
+	{
+		unsigned __int64 total = 0;
+		for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+			total += time[i];
+		}
+		return total;
+	}
+};
+
+typedef std::map<std::string, ResourceTally> TallyMap;
+typedef std::pair<std::string, ResourceTally> TallyEntry;
+
+bool ResourceStats::enabled = false;
+
+// everything below is only touched by the owner thread
+static ThreadID owner;
+static ResourceRequest *current = NULL;
+static TallyMap types, sources;
+
+static const char *PhaseNames[ResourceStats::PHASE_COUNT] = { "lookup", "read", "decompress", "parse" };
+
+static bool IsOwner()
+{
+	return Thread::IsSameThread(owner, Thread::GetCurrentID());
+}
+
+void ResourceStats::SetEnabled(int enabled)
+{
+	if (enabled) {
+		owner = Thread::GetCurrentID();
+	}
+	ResourceStats::enabled = enabled != 0;
+}
+
+void ResourceStats::Reset()
+{
+	types.clear();
+	sources.clear();
+}
+
+unsigned __int64 ResourceStats::Now()
+{
+#ifdef WIN32
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (unsigned __int64) (count.QuadPart / frequency.QuadPart * 1000000 +
+		count.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (unsigned __int64) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+void ResourceStats::AddDecompressTime(unsigned __int64 microseconds)
+{
+	if (!current || !IsOwner()) {
+		return;
+	}
+	current->time[DECOMPRESS] += microseconds;
+}
+
+static bool SlowerFirst(const TallyEntry &a, const TallyEntry &b)
+{
+	return a.second.Total() > b.second.Total();
+}
+
+static void SortTallies(const TallyMap &tallies, std::vector<TallyEntry> &sorted)
+{
+	sorted.assign(tallies.begin(), tallies.end());
+	std::sort(sorted.begin(), sorted.end(), SlowerFirst);
+}
+
+static void PrintTallies(const char *title, const TallyMap &tallies)
+{
+	std::vector<TallyEntry> sorted;
+	SortTallies(tallies, sorted);
+
+	StringBuffer buffer;
+	buffer.appendFormatted("%s (times in ms):\n", title);
+	buffer.appendFormatted("%-24s %8s %8s %8s %8s %8s %12s", "", "requests", "found", "missing", "known", "failed", "bytes");
+	for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+		buffer.appendFormatted(" %10s", PhaseNames[i]);
+	}
+	for (size_t j = 0; j < sorted.size(); j++) {
+		const ResourceTally &tally = sorted[j].second;
+		buffer.appendFormatted("\n%-24.24s %8lu %8lu %8lu %8lu %8lu %12.0f", sorted[j].first.c_str(),
+			tally.requests, tally.found, tally.missing, tally.knownMissing, tally.failed, (double) tally.bytes);
+		for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+			buffer.appendFormatted(" %10.1f", tally.time[i] / 1000.0);
+		}
+	}
+	Log(MESSAGE, "ResourceStats", buffer);
+}
+
+void ResourceStats::Dump()
+{
+	if (!enabled) {
+		Log(MESSAGE, "ResourceStats", "The resource loads aren't being recorded.");
+	}
+	PrintTallies("Resource loads by type", types);
+	PrintTallies("Resource loads by source", sources);
+}
+
+static void AppendJSONString(StringBuffer &buffer, const std::string &str)
+{
+	buffer.append("\"");
+	for (size_t i = 0; i < str.size(); i++) {
+		unsigned char c = str[i];
+		if (c == '"' || c == '\\') {
+			buffer.appendFormatted("\\%c", c);
+		} else if (c < 0x20) {
+			buffer.appendFormatted("\\u%04x", c);
+		} else {
+			buffer.appendFormatted("%c", c);
+		}
+	}
+	buffer.append("\"");
+}
+
+static void AppendJSONTallies(StringBuffer &buffer, const TallyMap &tallies)
+{
+	buffer.append("{");
+	for (TallyMap::const_iterator it = tallies.begin(); it != tallies.end(); ++it) {
+		const ResourceTally &tally = it->second;
+		buffer.append(it == tallies.begin() ? "\n\t\t" : ",\n\t\t");
+		AppendJSONString(buffer, it->first);
+		buffer.appendFormatted(": {\"requests\": %lu, \"found\": %lu, \"missing\": %lu, \"known_missing\": %lu, \"failed\": %lu, \"bytes\": %.0f",
+			tally.requests, tally.found, tally.missing, tally.knownMissing, tally.failed, (double) tally.bytes);
+		for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+			buffer.appendFormatted(", \"%s_us\": %.0f", PhaseNames[i], (double) tally.time[i]);
+		}
+		buffer.append("}");
+	}
+	buffer.append("\n\t}");
+}
+
+bool ResourceStats::WriteJSON(const char *path)
+{
+	StringBuffer buffer;
+	buffer.append("{\n\t\"types\": ");
+	AppendJSONTallies(buffer, types);
+	buffer.append(",\n\t\"sources\": ");
+	AppendJSONTallies(buffer, sources);
+	buffer.append("\n}\n");
+
+	FileStream out;
+	const std::string &json = buffer.get();
+	if (!out.Create(path) || out.Write(json.c_str(), (unsigned int) json.size()) != (int) json.size()) {
+		Log(ERROR, "ResourceStats", "Cannot write %s.", path);
+		return false;
+	}
+	return true;
+}
+
+ResourceRequest::ResourceRequest()
+	: active(ResourceStats::IsEnabled() && IsOwner())
+{
+	if (!active) {
+		return;
+	}
+	parent = current;
+	current = this;
+	type[0] = 0;
+	source = NULL;
+	knownMissing = found = failed = false;
+	bytes = 0;
+	for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+		time[i] = 0;
+	}
+	nested = 0;
+	start = spanStart = ResourceStats::Now();
+	spanHidden = 0;
+}
+
+ResourceRequest::~ResourceRequest()
+{
+	if (!active) {
+		return;
+	}
+	unsigned __int64 total = ResourceStats::Now() - start;
+	// whatever isn't accounted for went into asking the sources
+	unsigned __int64 accounted = nested + time[ResourceStats::READ] + time[ResourceStats::DECOMPRESS] + time[ResourceStats::PARSE];
+	time[ResourceStats::LOOKUP] = total > accounted ? total - accounted : 0;
+
+	current = parent;
+	if (parent) {
+		parent->nested += total;
+	}
+
+	ResourceTally &tally = types[type[0] ? type : "?"];
+	tally.requests++;
+	if (found) {
+		tally.found++;
+	} else if (failed) {
+		tally.failed++;
+	} else {
+		tally.missing++;
+	}
+	if (knownMissing) {
+		tally.knownMissing++;
+	}
+	tally.bytes += bytes;
+	for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+		tally.time[i] += time[i];
+	}
+
+	if (source) {
+		ResourceTally &bySource = sources[source];
+		bySource.requests++;
+		if (found) {
+			bySource.found++;
+		} else {
+			bySource.failed++;
+		}
+		bySource.bytes += bytes;
+		for (int i = 0; i < ResourceStats::PHASE_COUNT; i++) {
+			bySource.time[i] += time[i];
+		}
+	}
+}
+
+void ResourceRequest::SetType(const char *ext)
+{
+	if (active) {
+		strlcpy(type, ext, sizeof(type));
+	}
+}
+
+void ResourceRequest::SetType(SClass_ID type)
+{
+	if (active) {
+		SetType(core->TypeExt(type));
+	}
+}
+
+void ResourceRequest::SetKnownMissing()
+{
+	if (active) {
+		knownMissing = true;
+	}
+}
+
+// the time since the span started, less what got credited elsewhere meanwhile
+unsigned __int64 ResourceRequest::EndSpan()
+{
+	unsigned __int64 elapsed = ResourceStats::Now() - spanStart;
+	unsigned __int64 hidden = nested + time[ResourceStats::DECOMPRESS] - spanHidden;
+	return elapsed > hidden ? elapsed - hidden : 0;
+}
+
+void ResourceRequest::BeginSource()
+{
+	if (!active) {
+		return;
+	}
+	spanStart = ResourceStats::Now();
+	spanHidden = nested + time[ResourceStats::DECOMPRESS];
+}
+
+void ResourceRequest::EndSource(DataStream *stream, const char *source)
+{
+	if (!active || !stream) {
+		return;
+	}
+	time[ResourceStats::READ] += EndSpan();
+	this->source = source;
+	bytes += stream->Size();
+	found = true;
+}
+
+void ResourceRequest::BeginParse()
+{
+	BeginSource();
+}
+
+void ResourceRequest::EndParse(bool ok)
+{
+	if (!active) {
+		return;
+	}
+	time[ResourceStats::PARSE] += EndSpan();
+	found = ok;
+	failed = !ok;
+}
+
+}
@@ -0,0 +1,116 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef RESOURCESTATS_H
+#define RESOURCESTATS_H
+
+#include "SClassID.h"
+#include "exports.h"
+#include "ie_types.h"
+
+namespace GemRB {
+
+class DataStream;
+
+/* Optional records of the resource loads, to tell where the loading time goes
+ * Every request of ResourceManager::GetResource is counted under its type
+ * and, when found, under the source that had it, with the bytes and the wall
+ * time spent looking it up, opening its stream, expanding compressed data and
+ * parsing it. The reads done by the importers count as parsing and the loads
+ * done while parsing another resource are taken out of its time.
+ * Only the loads of the thread that enabled the records are timed.
+ */
+class GEM_EXPORT ResourceStats {
+public:
+	enum Phase { LOOKUP, READ, DECOMPRESS, PARSE, PHASE_COUNT };
+
+	static void SetEnabled(int enabled);
+	static bool IsEnabled() { return enabled; }
+	static void Reset();
+	/** prints the tables to the log */
+	static void Dump();
+	/** writes the records as JSON, returns false if the file can't be written */
+	static bool WriteJSON(const char *path);
+	/** credits decompression time to the request in progress, if any */
+	static void AddDecompressTime(unsigned __int64 microseconds);
+	/** microseconds since an arbitrary point */
+	static unsigned __int64 Now();
+private:
+	static bool enabled;
+};
+
+/* One request, timed from its creation to its destruction
+ * does nothing unless the records are enabled.
+ */
+class GEM_EXPORT ResourceRequest {
+public:
+	ResourceRequest();
+	~ResourceRequest();
+
+	/** the type the request is counted under */
+	void SetType(const char *ext);
+	void SetType(SClass_ID type);
+	/** the miss cache said the resource isn't there */
+	void SetKnownMissing();
+	/** a source gets asked, for the stream or for the resource */
+	void BeginSource();
+	/** the source answered, stream is NULL if it doesn't have the resource */
+	void EndSource(DataStream *stream, const char *source);
+	void BeginParse();
+	void EndParse(bool ok);
+
+private:
+	friend class ResourceStats;
+
+	bool active;
+	ResourceRequest *parent;
+	char type[8];
+	const char *source;
+	bool knownMissing, found, failed;
+	unsigned long bytes;
+	unsigned __int64 start, spanStart, spanHidden;
+	unsigned __int64 time[ResourceStats::PHASE_COUNT];
+	// spent in the loads started by this one
+	unsigned __int64 nested;
+
+	unsigned __int64 EndSpan();
+	ResourceRequest(const ResourceRequest&);
+	ResourceRequest& operator=(const ResourceRequest&);
+};
+
+/* Credits its lifetime to the request in progress as decompression */
+class GEM_EXPORT DecompressionTimer {
+public:
+	DecompressionTimer() : start(ResourceStats::IsEnabled() ? ResourceStats::Now() : 0) {}
+	~DecompressionTimer()
+	{
+		if (start) {
+			ResourceStats::AddDecompressTime(ResourceStats::Now() - start);
+		}
+	}
+	/** nothing got expanded after all */
+	void Cancel() { start = 0; }
+private:
+	unsigned __int64 start;
+};
+
+}
+
+#endif
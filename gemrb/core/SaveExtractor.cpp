@@ -0,0 +1,212 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "SaveExtractor.h"
+
+#include "win32def.h"
+
+#include "PluginMgr.h"
+#include "ResourceStats.h"
+#include "System/FileStream.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace GemRB {
+
+class ExtractJob : public Job {
+public:
+	ExtractJob(SaveExtractor *owner, const char *path, DataStream *compressed)
+		: Job("SaveExtractor::Extract"), extractor(owner), path(path), compressed(compressed) {}
+
+	SaveExtractor *extractor;
+	std::string path;
+	DataStream *compressed;
+protected:
+	void Run() { extractor->Run(this); }
+};
+
+// the lookups build the path from the cache path, but the resrefs may differ in case
+static std::string JobKey(const char *path)
+{
+	char key[_MAX_PATH];
+	strnlwrcpy(key, path, _MAX_PATH - 1, false);
+	return key;
+}
+
+SaveExtractor::SaveExtractor(JobSystem *jobs)
+	: jobs(jobs), loaded(0)
+{
+	// without it the members are expanded right away, as the save is read
+	if (PluginMgr::Get()->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) {
+		comp = PluginHolder<Compressor>(PLUGIN_COMPRESSION_ZLIB);
+	}
+}
+
+SaveExtractor::~SaveExtractor()
+{
+	// the cache goes too, so whatever is left isn't needed anymore
+	Clear();
+}
+
+bool SaveExtractor::Add(const char *path, DataStream *compressed)
+{
+	if (!comp) {
+		return false;
+	}
+
+	std::string key = JobKey(path);
+	// a member listed twice, the later copy wins
+	Drop(key);
+	ExtractJob *job = new ExtractJob(this, path, compressed);
+	MutexLock l(lock);
+	pending[key] = job;
+	jobs->Submit(job);
+	return true;
+}
+
+void SaveExtractor::Extract(const char *path)
+{
+	Holder<ExtractJob> job;
+	{
+		MutexLock l(lock);
+		// the usual case once everything is out, so keep it cheap
+		if (pending.empty()) {
+			return;
+		}
+		JobMap::iterator it = pending.find(JobKey(path));
+		if (it == pending.end()) {
+			return;
+		}
+		job = it->second;
+	}
+	// expands it right here, unless a worker has taken it already
+	jobs->Wait(job.get());
+	ReportFailures();
+}
+
+void SaveExtractor::Forget(const char *path)
+{
+	Drop(JobKey(path));
+}
+
+void SaveExtractor::Flush()
+{
+	JobMap left;
+	{
+		MutexLock l(lock);
+		left = pending;
+	}
+	for (JobMap::iterator it = left.begin(); it != left.end(); ++it) {
+		jobs->Wait(it->second.get());
+	}
+	ReportFailures();
+}
+
+void SaveExtractor::Clear()
+{
+	JobMap left;
+	{
+		MutexLock l(lock);
+		left.swap(pending);
+	}
+	for (JobMap::iterator it = left.begin(); it != left.end(); ++it) {
+		// the running ones are halfway into the cache, so let them finish
+		if (!jobs->Cancel(it->second.get())) {
+			jobs->Wait(it->second.get());
+		}
+	}
+	{
+		MutexLock l(lock);
+		loaded = time(NULL);
+	}
+	ReportFailures();
+}
+
+// drops the member if it is still queued, after it is done if it is running
+void SaveExtractor::Drop(const std::string &key)
+{
+	Holder<ExtractJob> job;
+	{
+		MutexLock l(lock);
+		JobMap::iterator it = pending.find(key);
+		if (it == pending.end()) {
+			return;
+		}
+		job = it->second;
+		pending.erase(it);
+	}
+	if (!jobs->Cancel(job.get())) {
+		jobs->Wait(job.get());
+	}
+}
+
+void SaveExtractor::Run(ExtractJob *job)
+{
+	bool ok = Write(job);
+
+	MutexLock l(lock);
+	if (!ok) {
+		failed.push_back(job->path);
+	}
+	JobMap::iterator it = pending.find(JobKey(job->path.c_str()));
+	if (it != pending.end() && it->second.get() == job) {
+		pending.erase(it);
+	}
+}
+
+bool SaveExtractor::Write(const ExtractJob *job) const
+{
+	const char *path = job->path.c_str();
+	struct stat buf;
+	// something wrote the file since the load, so the member is out of date
+	if (stat(path, &buf) == 0 && buf.st_mtime >= loaded) {
+		return true;
+	}
+
+	DecompressionTimer timer;
+	FileStream out;
+	if (!out.Create(path)) {
+		return false;
+	}
+	job->compressed->Seek(0, GEM_STREAM_START);
+	if (comp->Decompress(&out, job->compressed, job->compressed->Size()) == GEM_OK) {
+		return true;
+	}
+	// a half expanded member is worse than none
+	out.Close();
+	remove(path);
+	return false;
+}
+
+// only the main thread's records reach the message window, so the workers
+// leave this to the main thread
+void SaveExtractor::ReportFailures()
+{
+	std::vector<std::string> paths;
+	{
+		MutexLock l(lock);
+		paths.swap(failed);
+	}
+	for (size_t i = 0; i < paths.size(); i++) {
+		Log(ERROR, "SaveExtractor", "Cannot write %s.", paths[i].c_str());
+	}
+}
+
+}
@@ -0,0 +1,88 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef SAVEEXTRACTOR_H
+#define SAVEEXTRACTOR_H
+
+#include "exports.h"
+
+#include "Compressor.h"
+#include "Holder.h"
+#include "JobSystem.h"
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+class DataStream;
+class ExtractJob;
+
+/* Expands the members of a loaded save into the cache only as needed
+ * loading a game just reads the SAV and notes where each member goes, a
+ * member is expanded when its file is first looked up in the cache, while
+ * the rest are expanded as background jobs meanwhile, one at a time when
+ * there are no job threads.
+ * Whatever lists the cache for a save flushes it first, and whatever drops
+ * the cache or the compressed data clears it.
+ */
+class GEM_EXPORT SaveExtractor {
+public:
+	SaveExtractor(JobSystem *jobs);
+	~SaveExtractor();
+
+	/* notes a member of the loaded save, to be expanded to the file at path
+	 * when needed; the caller keeps the stream and has to Clear before
+	 * freeing it. False if it can't be put off, so it has to be done now. */
+	bool Add(const char *path, DataStream *compressed);
+	/* expands the file at path now, if it is a member still pending */
+	void Extract(const char *path);
+	/* the file at path is gone or replaced, its member mustn't come back */
+	void Forget(const char *path);
+	/* expands all the members left */
+	void Flush();
+	/* drops all the members left, marking the start of a new load */
+	void Clear();
+
+private:
+	friend class ExtractJob;
+	typedef std::map<std::string, Holder<ExtractJob> > JobMap;
+
+	JobSystem *jobs;
+	Mutex lock;
+	// a file written after the load is newer than its member
+	time_t loaded;
+	// by lowercase path, until they are done
+	JobMap pending;
+	// the paths that couldn't be written, to report on the main thread
+	std::vector<std::string> failed;
+	// stateless, so one instance serves all the threads
+	Holder<Compressor> comp;
+
+	void Drop(const std::string &key);
+	void Run(ExtractJob *job);
+	bool Write(const ExtractJob *job) const;
+	void ReportFailures();
+};
+
+}
+
+#endif
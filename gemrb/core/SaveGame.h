@@ -27,6 +27,8 @@
 #include "ResourceManager.h"
 #include "System/VFS.h"
 
+#include <ctime>
+
 namespace GemRB {
 
 class ImageMgr;
@@ -36,7 +38,9 @@ class GEM_EXPORT SaveGame : public Held<SaveGame> {
 public:
 	static const TypeID ID;
 public:
-	SaveGame(const char* path, const char* name, const char* prefix, const char* slotname, int pCount, int saveID);
+	/* date is the time the save was made, gameTime the game time stored
+	 * in it or -1 if it still has to be read from the save */
+	SaveGame(const char* path, const char* name, const char* prefix, const char* slotname, int pCount, int saveID, time_t date, int gameTime = -1);
 	~SaveGame();
 	int GetPortraitCount() const
 	{
@@ -70,6 +74,8 @@ public:
 
 	Sprite2D* GetPortrait(int index) const;
 	Sprite2D* GetPreview() const;
+	/* has the preview and the portraits decoded in the background */
+	void PrefetchImages() const;
 	DataStream* GetGame() const;
 	DataStream* GetWmap(int idx) const;
 	DataStream* GetSave() const;
@@ -82,7 +88,12 @@ private:
 	char SlotName[_MAX_PATH];
 	int PortraitCount;
 	int SaveID;
-	ResourceManager manager;
+	mutable int GameTime;
+	// the folder is only added as a source once something is read from it
+	mutable ResourceManager manager;
+	mutable bool sourced;
+
+	ResourceManager& GetManager() const;
 };
 
 }
@@ -24,8 +24,10 @@
 #include "strrefs.h"
 #include "win32def.h"
 
+#include "ArchiveImporter.h"
 #include "DisplayMessage.h"
 #include "GameData.h" // For ResourceHolder
+#include "ImageDecoder.h"
 #include "ImageMgr.h"
 #include "ImageWriter.h"
 #include "Interface.h"
@@ -33,9 +35,11 @@
 #include "SaveGameMgr.h"
 #include "Sprite2D.h"
 #include "TableMgr.h"
+#include "Video.h"
 #include "GUI/GameControl.h"
 #include "Scriptable/Actor.h"
 #include "System/FileStream.h"
+#include "System/Thread.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -52,17 +56,25 @@ namespace GemRB {
 
 const TypeID SaveGame::ID = { "SaveGame" };
 
-/** Extract date from save game ds into Date. */
-static void ParseGameDate(DataStream *ds, char *Date)
+/** Read the game time from save game ds, returns false if it is not a game. */
+static bool ReadGameTime(DataStream *ds, ieDword &GameTime)
 {
-	Date[0] = '\0';
-
+	if (!ds) {
+		return false;
+	}
 	char Signature[8];
-	ieDword GameTime;
 	ds->Read(Signature, 8);
 	ds->ReadDword(&GameTime);
 	delete ds;
-	if (memcmp(Signature,"GAME",4) ) {
+	return !memcmp(Signature,"GAME",4);
+}
+
+/** Format the game time of a save game into Date, ERROR if it wasn't read. */
+static void FormatGameDate(int GameTime, char *Date)
+{
+	Date[0] = '\0';
+
+	if (GameTime < 0) {
 		strcpy(Date, "ERROR");
 		return;
 	}
@@ -109,7 +121,7 @@ static void ParseGameDate(DataStream *ds, char *Date)
 	core->FreeString(c);
 }
 
-SaveGame::SaveGame(const char* path, const char* name, const char* prefix, const char* slotname, int pCount, int saveID)
+SaveGame::SaveGame(const char* path, const char* name, const char* prefix, const char* slotname, int pCount, int saveID, time_t date, int gameTime)
 {
 	strlcpy( Prefix, prefix, sizeof( Prefix ) );
 	strlcpy( Path, path, sizeof( Path ) );
@@ -117,22 +129,32 @@ SaveGame::SaveGame(const char* path, const char* name, const char* prefix, const
 	strlcpy( SlotName, slotname, sizeof( SlotName ) );
 	PortraitCount = pCount;
 	SaveID = saveID;
-	char nPath[_MAX_PATH];
-	struct stat my_stat;
-	PathJoinExt(nPath, Path, Prefix, "bmp");
-	memset(&my_stat,0,sizeof(my_stat));
-	if (stat(nPath, &my_stat)) {
+	GameTime = gameTime;
+	if (!date) {
 		Log(ERROR, "SaveGameIterator", "Stat call failed, using dummy time!");
 		strlcpy(Date, "Sun 31 Feb 00:00:01 2099", _MAX_PATH);
 	} else {
-		strftime(Date, _MAX_PATH, "%c", localtime((time_t*)&my_stat.st_mtime));
+		strftime(Date, _MAX_PATH, "%c", localtime(&date));
 	}
-	manager.AddSource(Path, Name, PLUGIN_RESOURCE_DIRECTORY);
+	sourced = false;
 	GameDate[0] = '\0';
 }
 
 SaveGame::~SaveGame()
 {
+	ImageDecoder *decoder = core->GetImageDecoder();
+	if (sourced && decoder) {
+		decoder->Forget(manager);
+	}
+}
+
+ResourceManager& SaveGame::GetManager() const
+{
+	if (!sourced) {
+		manager.AddSource(Path, Name, PLUGIN_RESOURCE_DIRECTORY);
+		sourced = true;
+	}
+	return manager;
 }
 
 Sprite2D* SaveGame::GetPortrait(int index) const
@@ -142,48 +164,194 @@ Sprite2D* SaveGame::GetPortrait(int index) const
 	}
 	char nPath[_MAX_PATH];
 	sprintf( nPath, "PORTRT%d", index );
-	ResourceHolder<ImageMgr> im(nPath, manager, true);
-	if (!im)
-		return NULL;
-	return im->GetSprite2D();
+	return core->GetImageDecoder()->GetSprite2D(nPath, GetManager());
 }
 
 Sprite2D* SaveGame::GetPreview() const
 {
-	ResourceHolder<ImageMgr> im(Prefix, manager, true);
-	if (!im)
-		return NULL;
-	return im->GetSprite2D();
+	return core->GetImageDecoder()->GetSprite2D(Prefix, GetManager());
+}
+
+void SaveGame::PrefetchImages() const
+{
+	ImageDecoder *decoder = core->GetImageDecoder();
+	decoder->Prefetch(Prefix, GetManager());
+	char nPath[_MAX_PATH];
+	for (int i = 0; i < PortraitCount; i++) {
+		sprintf( nPath, "PORTRT%d", i );
+		decoder->Prefetch(nPath, GetManager());
+	}
 }
 
 DataStream* SaveGame::GetGame() const
 {
-	return manager.GetResource(Prefix, IE_GAM_CLASS_ID, true);
+	return GetManager().GetResource(Prefix, IE_GAM_CLASS_ID, true);
 }
 
 DataStream* SaveGame::GetWmap(int idx) const
 {
-	return manager.GetResource(core->WorldMapName[idx], IE_WMP_CLASS_ID, true);
+	return GetManager().GetResource(core->WorldMapName[idx], IE_WMP_CLASS_ID, true);
 }
 
 DataStream* SaveGame::GetSave() const
 {
-	return manager.GetResource(Prefix, IE_SAV_CLASS_ID, true);
+	return GetManager().GetResource(Prefix, IE_SAV_CLASS_ID, true);
 }
 
 const char* SaveGame::GetGameDate() const
 {
-	if (GameDate[0] == '\0')
-		ParseGameDate(GetGame(), GameDate);
+	if (GameDate[0] == '\0') {
+		ieDword gameTime;
+		if (GameTime < 0 && ReadGameTime(GetGame(), gameTime)) {
+			GameTime = (int) gameTime;
+		}
+		FormatGameDate(GameTime, GameDate);
+	}
 	return GameDate;
 }
 
+/* the portraits and the area preview of a save game */
+struct SaveImages {
+	std::vector<Sprite2D*> portraits;
+	Sprite2D* preview;
+
+	SaveImages() : preview(NULL) {}
+	void Release();
+};
+
+void SaveImages::Release()
+{
+	for (size_t i = 0; i < portraits.size(); i++) {
+		Sprite2D::FreeSprite(portraits[i]);
+	}
+	portraits.clear();
+	Sprite2D::FreeSprite(preview);
+}
+
+/* Writes the archive of a save game that was read into memory, so the
+ * game can go on while it is compressed. The images are encoded there
+ * too, but only released again on the main thread. */
+class SaveWriter : public Thread, public ArchiveProgress {
+public:
+	SaveWriter(const char *folder, std::vector<ArchiveMember> &files, SaveImages &imgs);
+	~SaveWriter();
+	void Write();
+	void Progress(int percent);
+	int GetProgress() const;
+protected:
+	void Run();
+private:
+	char dir[_MAX_PATH];
+	char path[_MAX_PATH];
+	std::vector<ArchiveMember> members;
+	SaveImages images;
+	PluginHolder<ArchiveImporter> ai;
+	PluginHolder<ImageWriter> im;
+	mutable Mutex lock;
+	int progress;
+};
+
+static void ReleaseMembers(std::vector<ArchiveMember> &members)
+{
+	for (size_t i = 0; i < members.size(); i++) {
+		delete members[i].stream;
+	}
+	members.clear();
+}
+
+SaveWriter::SaveWriter(const char *folder, std::vector<ArchiveMember> &files, SaveImages &imgs)
+	: ai(IE_SAV_CLASS_ID), im(PLUGIN_IMAGE_WRITER_BMP)
+{
+	strlcpy(dir, folder, sizeof(dir));
+	PathJoinExt(path, folder, core->GameNameResRef, core->TypeExt(IE_SAV_CLASS_ID));
+	members.swap(files);
+	images.portraits.swap(imgs.portraits);
+	images.preview = imgs.preview;
+	imgs.preview = NULL;
+	progress = 0;
+}
+
+SaveWriter::~SaveWriter()
+{
+	Join();
+	ReleaseMembers(members);
+	images.Release();
+}
+
+void SaveWriter::Run()
+{
+	Write();
+}
+
+void SaveWriter::Write()
+{
+	if (!im) {
+		Log(ERROR, "SaveGameIterator", "Couldn't create the BMPWriter!");
+	} else {
+		for (size_t i = 0; i < images.portraits.size(); i++) {
+			if (images.portraits[i]) {
+				char FName[_MAX_PATH];
+				snprintf( FName, sizeof(FName), "PORTRT%d", (int) i );
+				FileStream outfile;
+				outfile.Create( dir, FName, IE_BMP_CLASS_ID );
+				im->PutImage( &outfile, images.portraits[i] );
+			}
+		}
+		if (images.preview) {
+			FileStream outfile;
+			outfile.Create( dir, core->GameNameResRef, IE_BMP_CLASS_ID );
+			im->PutImage( &outfile, images.preview );
+		}
+	}
+
+	FileStream str;
+	if (!ai || !str.Create(path)) {
+		Log(ERROR, "SaveGameIterator", "Cannot write %s.", path);
+		ReleaseMembers(members);
+	} else {
+		ai->CreateArchive(&str);
+		ai->AddMembersToSaveGame(&str, members, this);
+		// the archive deleted the streams
+		members.clear();
+	}
+	Progress(100);
+}
+
+void SaveWriter::Progress(int percent)
+{
+	MutexLock l(lock);
+	progress = percent;
+}
+
+int SaveWriter::GetProgress() const
+{
+	MutexLock l(lock);
+	return progress;
+}
+
 SaveGameIterator::SaveGameIterator(void)
 {
+	indexPath[0] = 0;
+	writer = NULL;
 }
 
 SaveGameIterator::~SaveGameIterator(void)
 {
+	WaitForSave();
+}
+
+void SaveGameIterator::WaitForSave()
+{
+	delete writer;
+	writer = NULL;
+}
+
+int SaveGameIterator::GetSaveProgress() const
+{
+	if (!writer) {
+		return -1;
+	}
+	return writer->GetProgress();
 }
 
 /* mission pack save */
@@ -282,9 +450,105 @@ static bool IsSaveGameSlot(const char* Path, const char* slotname)
 	return true;
 }
 
+// the newest saves, whose images are decoded ahead when the list is fetched
+#define SAVE_IMAGE_PREFETCH 8
+
+#define SAVE_INDEX_NAME ".saveindex"
+#define SAVE_INDEX_SIGNATURE "SAVIDX1"
+
+void SaveGameIterator::LoadIndex(const char *Path)
+{
+	index.clear();
+	PathJoin(indexPath, Path, SAVE_INDEX_NAME, NULL);
+
+	FileStream str;
+	if (!str.Open(indexPath)) {
+		return;
+	}
+	char Signature[8];
+	ieDword count;
+	if (str.Read(Signature, 8) != 8 || memcmp(Signature, SAVE_INDEX_SIGNATURE, 8)) {
+		return;
+	}
+	str.ReadDword(&count);
+	while (count--) {
+		ieDword length;
+		char slotname[_MAX_PATH];
+		SlotInfo info;
+		if (str.ReadDword(&length) != 4 || length >= sizeof(slotname)
+			|| str.Read(slotname, length) != (int) length
+			|| str.Read(&info, sizeof(info)) != (int) sizeof(info)) {
+			Log(WARNING, "SaveGameIterator", "Ignoring broken save game index %s.", indexPath);
+			index.clear();
+			return;
+		}
+		slotname[length] = 0;
+		index[slotname] = info;
+	}
+}
+
+// it's only a shortcut, so failing to write it is no problem
+void SaveGameIterator::SaveIndex() const
+{
+	FileStream str;
+	if (!str.Create(indexPath)) {
+		return;
+	}
+	ieDword count = (ieDword) index.size();
+	str.Write(SAVE_INDEX_SIGNATURE, 8);
+	str.WriteDword(&count);
+	for (SlotIndex::const_iterator i = index.begin(); i != index.end(); i++) {
+		ieDword length = (ieDword) i->first.length();
+		str.WriteDword(&length);
+		str.Write(i->first.c_str(), length);
+		str.Write(&i->second, sizeof(i->second));
+	}
+}
+
+/* looks into the slot folder for what the load screen shows */
+void SaveGameIterator::IndexSlot(const char *Path, const char *slotname, SlotInfo &info)
+{
+	info.date = 0;
+	info.gameTime = -1;
+	info.portraits = 0;
+	info.valid = IsSaveGameSlot(Path, slotname);
+	if (!info.valid) {
+		return;
+	}
+
+	char dtmp[_MAX_PATH];
+	PathJoin(dtmp, Path, slotname, NULL);
+	DirectoryIterator dir(dtmp);
+	if (!dir) {
+		info.valid = false;
+		return;
+	}
+	do {
+		if (strnicmp( dir.GetName(), "PORTRT", 6 ) == 0)
+			info.portraits++;
+	} while (++dir);
+
+	char ftmp[_MAX_PATH];
+	PathJoinExt(ftmp, dtmp, core->GameNameResRef, "bmp");
+	info.date = file_mtime(ftmp);
+
+	PathJoinExt(ftmp, dtmp, core->GameNameResRef, "gam");
+	ieDword gameTime;
+	if (ReadGameTime(FileStream::OpenFile(ftmp), gameTime)) {
+		info.gameTime = (int) gameTime;
+	}
+}
+
 bool SaveGameIterator::RescanSaveGames()
 {
-	// delete old entries
+	// the images of the last save are still being written with it
+	WaitForSave();
+
+	// the slots that didn't change since the last scan are kept as they are
+	std::map<std::string, Holder<SaveGame> > previous;
+	for (charlist::iterator i = save_slots.begin(); i != save_slots.end(); i++) {
+		previous[(*i)->GetSlotName()] = *i;
+	}
 	save_slots.clear();
 
 	char Path[_MAX_PATH];
@@ -303,19 +567,63 @@ bool SaveGameIterator::RescanSaveGames()
 		return false;
 	}
 
+	char ipath[_MAX_PATH];
+	PathJoin(ipath, Path, SAVE_INDEX_NAME, NULL);
+	if (strcmp(ipath, indexPath)) {
+		LoadIndex(Path);
+	}
+
 	std::set<char*,iless> slots;
 	do {
 		const char *name = dir.GetName();
-		if (dir.IsDirectory() && IsSaveGameSlot( Path, name )) {
+		if (dir.IsDirectory() && name[0] != '.') {
 			slots.insert(strdup(name));
 		}
 	} while (++dir);
 
+	// a change in the same second as the indexing wouldn't show in the
+	// folder time, so such entries are looked at again the next time
+	time_t now = time(NULL);
+	SlotIndex current;
+	bool changed = false;
 	for (std::set<char*,iless>::iterator i = slots.begin(); i != slots.end(); i++) {
-		save_slots.push_back(BuildSaveGame(*i));
+		char dtmp[_MAX_PATH];
+		PathJoin(dtmp, Path, *i, NULL);
+		time_t mtime = file_mtime(dtmp);
+
+		SlotIndex::iterator entry = index.find(*i);
+		SlotInfo &info = current[*i];
+		bool fresh = entry != index.end() && entry->second.mtime == mtime && mtime < entry->second.indexed;
+		if (fresh) {
+			info = entry->second;
+		} else {
+			IndexSlot(Path, *i, info);
+			info.mtime = mtime;
+			info.indexed = now;
+			changed = true;
+		}
+
+		if (info.valid) {
+			Holder<SaveGame> save;
+			if (fresh && previous.count(*i)) {
+				save = previous[*i];
+			} else {
+				save = BuildSaveGame(*i, info);
+			}
+			if (save) {
+				save_slots.push_back(save);
+			}
+		}
 		free(*i);
 	}
 
+	if (current.size() != index.size()) {
+		changed = true;
+	}
+	index.swap(current);
+	if (changed) {
+		SaveIndex();
+	}
 	return true;
 }
 
@@ -323,6 +631,13 @@ const std::vector<Holder<SaveGame> >& SaveGameIterator::GetSaveGames()
 {
 	RescanSaveGames();
 
+	// the load screens start out showing the newest saves, at the end
+	size_t i = save_slots.size();
+	size_t first = i > SAVE_IMAGE_PREFETCH ? i - SAVE_IMAGE_PREFETCH : 0;
+	while (i-- > first) {
+		save_slots[i]->PrefetchImages();
+	}
+
 	return save_slots;
 }
 
@@ -337,13 +652,12 @@ Holder<SaveGame> SaveGameIterator::GetSaveGame(const char *name)
 	return NULL;
 }
 
-Holder<SaveGame> SaveGameIterator::BuildSaveGame(const char *slotname)
+Holder<SaveGame> SaveGameIterator::BuildSaveGame(const char *slotname, const SlotInfo &info)
 {
 	if (!slotname) {
 		return NULL;
 	}
 
-	int prtrt = 0;
 	char Path[_MAX_PATH];
 	//lets leave space for the filenames
 	PathJoin(Path, core->SavePath, SaveDir(), slotname, NULL);
@@ -358,16 +672,7 @@ Holder<SaveGame> SaveGameIterator::BuildSaveGame(const char *slotname)
 		return NULL;
 	}
 
-	DirectoryIterator dir(Path);
-	if (!dir) {
-		return NULL;
-	}
-	do {
-		if (strnicmp( dir.GetName(), "PORTRT", 6 ) == 0)
-			prtrt++;
-	} while (++dir);
-
-	SaveGame* sg = new SaveGame( Path, savegameName, core->GameNameResRef, slotname, prtrt, savegameNumber );
+	SaveGame* sg = new SaveGame( Path, savegameName, core->GameNameResRef, slotname, info.portraits, savegameNumber, info.date, info.gameTime );
 	return sg;
 }
 
@@ -415,10 +720,14 @@ void SaveGameIterator::PruneQuickSave(const char *folder)
 	}
 }
 
-/** Save game to given directory */
-static bool DoSaveGame(const char *Path)
+/** Save game to given directory, except for the archive of the cache
+ * files, which are only read into members, and the images */
+static bool DoSaveGame(const char *Path, std::vector<ArchiveMember> &members, SaveImages &images)
 {
 	Game *game = core->GetGame();
+	// the preview is read back while the rest is saved
+	core->GetGameControl()->RequestPreview();
+
 	//saving areas to cache currently in memory
 	unsigned int mc = (unsigned int) game->GetLoadedMapCount();
 	while (mc--) {
@@ -430,9 +739,9 @@ static bool DoSaveGame(const char *Path)
 
 	gamedata->SaveAllStores();
 
-	//compress files in cache named: .STO and .ARE
+	//files in cache named: .STO and .ARE
 	//no .CRE would be saved in cache
-	if (core->CompressSave(Path)) {
+	if (core->SnapshotSave(members)) {
 		return false;
 	}
 
@@ -446,29 +755,13 @@ static bool DoSaveGame(const char *Path)
 		return false;
 	}
 
-	PluginHolder<ImageWriter> im(PLUGIN_IMAGE_WRITER_BMP);
-	if (!im) {
-		Log(ERROR, "SaveGameIterator", "Couldn't create the BMPWriter!");
-		return false;
-	}
-
 	//Create portraits
 	for (int i = 0; i < game->GetPartySize( false ); i++) {
-		Sprite2D* portrait = core->GetGameControl()->GetPortraitPreview( i );
-		if (portrait) {
-			char FName[_MAX_PATH];
-			snprintf( FName, sizeof(FName), "PORTRT%d", i );
-			FileStream outfile;
-			outfile.Create( Path, FName, IE_BMP_CLASS_ID );
-			im->PutImage( &outfile, portrait );
-		}
+		images.portraits.push_back(core->GetGameControl()->GetPortraitPreview( i ));
 	}
 
 	// Create area preview
-	Sprite2D* preview = core->GetGameControl()->GetPreview();
-	FileStream outfile;
-	outfile.Create( Path, core->GameNameResRef, IE_BMP_CLASS_ID );
-	im->PutImage( &outfile, preview );
+	images.preview = core->GetGameControl()->GetPreview();
 
 	return true;
 }
@@ -580,8 +873,32 @@ static bool CreateSavePath(char *Path, int index, const char *slotname)
 	return true;
 }
 
+/* the slow part, compressing the cache files, is left to a thread */
+bool SaveGameIterator::WriteSaveGame(const char *Path)
+{
+	std::vector<ArchiveMember> members;
+	SaveImages images;
+	if (!DoSaveGame(Path, members, images)) {
+		ReleaseMembers(members);
+		images.Release();
+		// drop the screenshot, if it wasn't made into a preview
+		Sprite2D* screenshot = core->GetVideoDriver()->FinishScreenshot();
+		Sprite2D::FreeSprite(screenshot);
+		return false;
+	}
+
+	writer = new SaveWriter(Path, members, images);
+	if (!writer->Start()) {
+		writer->Write();
+	}
+	return true;
+}
+
 int SaveGameIterator::CreateSaveGame(int index, bool mqs)
 {
+	// the last one could still be written, maybe into the same slot
+	WaitForSave();
+
 	AutoTable tab("savegame");
 	const char *slotname = NULL;
 	int qsave = 0;
@@ -618,7 +935,7 @@ int SaveGameIterator::CreateSaveGame(int index, bool mqs)
 		return -1;
 	}
 
-	if (!DoSaveGame(Path)) {
+	if (!WriteSaveGame(Path)) {
 		displaymsg->DisplayConstantString(STR_CANTSAVE, DMC_BG2XPGREEN);
 		if (gc) {
 			gc->SetDisplayText(STR_CANTSAVE, 30);
@@ -650,6 +967,8 @@ int SaveGameIterator::CreateSaveGame(Holder<SaveGame> save, const char *slotname
 	if (int cansave = CanSave())
 		return cansave;
 
+	WaitForSave();
+
 	GameControl *gc = core->GetGameControl();
 	int index;
 
@@ -680,7 +999,7 @@ int SaveGameIterator::CreateSaveGame(Holder<SaveGame> save, const char *slotname
 		return -1;
 	}
 
-	if (!DoSaveGame(Path)) {
+	if (!WriteSaveGame(Path)) {
 		displaymsg->DisplayConstantString(STR_CANTSAVE, DMC_BG2XPGREEN);
 		if (gc) {
 			gc->SetDisplayText(STR_CANTSAVE, 30);
@@ -702,6 +1021,7 @@ void SaveGameIterator::DeleteSaveGame(Holder<SaveGame> game)
 		return;
 	}
 
+	WaitForSave();
 	core->DelTree( game->GetPath(), false ); //remove all files from folder
 	rmdir( game->GetPath() );
 }
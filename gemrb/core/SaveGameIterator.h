@@ -25,10 +25,15 @@
 
 #include "SaveGame.h"
 
+#include <ctime>
+#include <map>
+#include <string>
 #include <vector>
 
 namespace GemRB {
 
+class SaveWriter;
+
 #define SAVEGAME_DIRECTORY_MATCHER "%d - %[A-Za-z0-9- _+*#%&|()=!?':;]"
 
 class GEM_EXPORT SaveGameIterator {
@@ -36,6 +41,21 @@ private:
 	typedef std::vector<Holder<SaveGame> > charlist;
 	charlist save_slots;
 
+	/* what the load screen shows of a slot, kept on disk so the folders
+	 * don't have to be looked into again until they change */
+	struct SlotInfo {
+		time_t mtime; // of the folder
+		time_t indexed;
+		time_t date;
+		int gameTime;
+		int portraits;
+		bool valid;
+	};
+	typedef std::map<std::string, SlotInfo> SlotIndex;
+	SlotIndex index;
+	char indexPath[_MAX_PATH];
+	SaveWriter *writer;
+
 public:
 	SaveGameIterator(void);
 	~SaveGameIterator(void);
@@ -44,9 +64,17 @@ public:
 	int CreateSaveGame(Holder<SaveGame>, const char *slotname);
 	int CreateSaveGame(int index, bool mqs = false);
 	Holder<SaveGame> GetSaveGame(const char *slotname);
+	/* waits for the save game being written in the background, if any */
+	void WaitForSave();
+	/* how far that save got in percent, -1 if there is none */
+	int GetSaveProgress() const;
 private:
 	bool RescanSaveGames();
-	static Holder<SaveGame> BuildSaveGame(const char *slotname);
+	bool WriteSaveGame(const char *Path);
+	static Holder<SaveGame> BuildSaveGame(const char *slotname, const SlotInfo &info);
+	static void IndexSlot(const char *Path, const char *slotname, SlotInfo &info);
+	void LoadIndex(const char *Path);
+	void SaveIndex() const;
 	void PruneQuickSave(const char *folder);
 };
 
@@ -39,6 +39,7 @@
 #include "DisplayMessage.h"
 #include "GameData.h"
 #include "Image.h"
+#include "InputRecord.h"
 #include "Item.h"
 #include "PolymorphCache.h" // stupid polymorph cache hack
 #include "Projectile.h"
@@ -47,6 +48,7 @@
 #include "Spell.h"
 #include "Sprite2D.h"
 #include "TableMgr.h"
+#include "Tracer.h"
 #include "Video.h"
 #include "damages.h"
 #include "GameScript/GSUtils.h" //needed for DisplayStringCore
@@ -430,6 +432,17 @@ void ReleaseMemoryActor()
 	FistRows = -1;
 }
 
+// what the effects made of the stats last time, see RefreshEffects
+struct RefreshCache {
+	ieDword BaseStats[MAX_STATS];
+	ieDword Modified[MAX_STATS];
+	ArmorClass AC;
+	ToHitStats ToHit;
+	ieDword generation;
+	ieDword until; // when the first timed effect triggers or expires
+	bool valid;
+};
+
 Actor::Actor()
 	: Movable( ST_ACTOR )
 {
@@ -451,6 +464,7 @@ Actor::Actor()
 	WeaponRef[0]=0;
 	for (i = 0; i < EXTRA_ACTORCOVERS; ++i)
 		extraCovers[i] = NULL;
+	DrawRank = (unsigned int) -1;
 
 	LongName = NULL;
 	ShortName = NULL;
@@ -533,6 +547,11 @@ Actor::Actor()
 	DifficultyMargin = disarmTrap = 0;
 
 	polymorphCache = NULL;
+	refreshCache = NULL;
+	dualWieldSlot = -1;
+	dualWieldItem = NULL;
+	dualWieldResRef[0] = 0;
+	dualWielding = 0;
 	memset(&wildSurgeMods, 0, sizeof(wildSurgeMods));
 	AC.SetOwner(this);
 	ToHit.SetOwner(this);
@@ -566,6 +585,7 @@ Actor::~Actor(void)
 
 	delete attackProjectile;
 	delete polymorphCache;
+	delete refreshCache;
 
 	free(projectileImmunity);
 }
@@ -692,6 +712,13 @@ CharAnimations* Actor::GetAnims() const
 	return anims;
 }
 
+void Actor::PreloadCombatAnimations()
+{
+	if (anims) {
+		anims->PreloadCombatStances(GetOrientation());
+	}
+}
+
 /** Returns a Stat value (Base Value + Mod) */
 ieDword Actor::GetStat(unsigned int StatIndex) const
 {
@@ -906,7 +933,7 @@ bool Actor::ApplyKit(bool remove, ieDword baseclass, int diff)
 		//kit abilities
 		tm = gamedata->GetTable(gamedata->LoadTable("kitlist"));
 		if (tm) {
-			kitclass = (ieDword) atoi(tm->QueryField(row, 7));
+			kitclass = (ieDword) tm->QueryFieldSigned(row, 7);
 			clab = tm->QueryField(row, 4);
 		}
 	}
@@ -992,12 +1019,16 @@ static void pcf_berserk(Actor *actor, ieDword /*oldValue*/, ieDword /*newValue*/
 	actor->SetCircleSize();
 }
 
-static void pcf_ea (Actor *actor, ieDword /*oldValue*/, ieDword newValue)
+static void pcf_ea (Actor *actor, ieDword oldValue, ieDword newValue)
 {
 	if (actor->Selected && (newValue>EA_GOODCUTOFF) ) {
 		core->GetGame()->SelectActor(actor, false, SELECT_NORMAL);
 	}
 	actor->SetCircleSize();
+	// turned hostile, a fight is likely to follow
+	if (newValue >= EA_EVILCUTOFF && oldValue < EA_EVILCUTOFF) {
+		actor->PreloadCombatAnimations();
+	}
 }
 
 //this is a good place to recalculate level up stuff
@@ -2126,7 +2157,7 @@ static void InitActorTables()
 			buffer.appendFormatted("ToHit: %s ", tohit);
 			buffer.appendFormatted("XPCap: %d", xpcap[classis]);
 
-			Log(DEBUG, "Actor", buffer);
+			LogDebug("Actor", buffer);
 		}
 	} else {
 		AutoTable hptm;
@@ -2155,7 +2186,7 @@ static void InitActorTables()
 			//i.e. barbarians would overwrite fighters in bg2
 			if (levelslots[tmpindex]) {
 				buffer.appendFormatted("Already Found!");
-				Log(DEBUG, "Actor", buffer);
+				LogDebug("Actor", buffer);
 				continue;
 			}
 
@@ -2191,7 +2222,7 @@ static void InitActorTables()
 						if (tmphp) maxLevelForHpRoll[tmpindex] = tmphp;
 					}
 				}
-				Log(DEBUG, "Actor", buffer);
+				LogDebug("Actor", buffer);
 				continue;
 			}
 
@@ -2269,7 +2300,7 @@ static void InitActorTables()
 			buffer.appendFormatted("HPROLLMAXLVL: %d ", maxLevelForHpRoll[tmpindex]);
 			buffer.appendFormatted("DS: %d ", dualswap[tmpindex]);
 			buffer.appendFormatted("MULTI: %d", multi[tmpindex]);
-			Log(DEBUG, "Actor", buffer);
+			LogDebug("Actor", buffer);
 		}
 		/*this could be enabled to ensure all levelslots are filled with at least 0's;
 		*however, the access code should ensure this never happens
@@ -2985,12 +3016,31 @@ void Actor::RefreshEffects(EffectQueue *fx)
 	}
 	PrevStats = &previous[0];
 
-	memcpy( Modified, BaseStats, MAX_STATS * sizeof( ieDword ) );
+	// when only static effects are left and neither they nor the base stats
+	// changed, applying them again would just give the same stats as last time
+	bool reuse = false;
+	if (core->IncrementalRefresh && refreshCache && refreshCache->valid && !fx && !first) {
+		reuse = refreshCache->generation == fxqueue.GetGeneration() &&
+			core->GetGame()->GameTime < refreshCache->until &&
+			!memcmp(refreshCache->BaseStats, BaseStats, sizeof(BaseStats));
+	}
+	bool verify = reuse && core->IncrementalRefresh == 2;
+	if (verify) {
+		reuse = false;
+	}
+
+	if (reuse) {
+		memcpy( Modified, refreshCache->Modified, MAX_STATS * sizeof( ieDword ) );
+		AC = refreshCache->AC;
+		ToHit = refreshCache->ToHit;
+	} else {
+		memcpy( Modified, BaseStats, MAX_STATS * sizeof( ieDword ) );
+		AC.ResetAll();
+		ToHit.ResetAll(); // effects can result in the change of any of the boni, so we need to reset all
+	}
 	if (PCStats) {
 		memset( PCStats->PortraitIcons, -1, sizeof(PCStats->PortraitIcons) );
 	}
-	AC.ResetAll();
-	ToHit.ResetAll(); // effects can result in the change of any of the boni, so we need to reset all
 
 	if (fx) {
 		fx->SetOwner(this);
@@ -3024,7 +3074,7 @@ void Actor::RefreshEffects(EffectQueue *fx)
 	}
 
 	// give the 3ed save bonus before applying the effects, since they may do extra rolls
-	if (third) {
+	if (third && !reuse) {
 		Modified[IE_SAVEWILL] += GetAbilityBonus(IE_WIS);
 		Modified[IE_SAVEREFLEX] += GetAbilityBonus(IE_DEX);
 		Modified[IE_SAVEFORTITUDE] += GetAbilityBonus(IE_CON);
@@ -3036,7 +3086,12 @@ void Actor::RefreshEffects(EffectQueue *fx)
 		}
 	}
 
-	fxqueue.ApplyAllEffects( this );
+	if (!reuse) {
+		fxqueue.ApplyAllEffects( this );
+		if (core->IncrementalRefresh) {
+			CacheRefresh(verify);
+		}
+	}
 
 	if (previous[IE_PUPPETID]) {
 		CheckPuppet(core->GetGame()->GetActorByGlobalID(previous[IE_PUPPETID]), previous[IE_PUPPETTYPE]);
@@ -3045,11 +3100,12 @@ void Actor::RefreshEffects(EffectQueue *fx)
 	//move this further down if needed
 	PrevStats = NULL;
 
-	for (std::list<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
-		m->flags |= TEF_PROCESSED_EFFECTS;
+	// by index, the charm removal below may add triggers
+	for (size_t t = 0; t < triggers.size(); t++) {
+		triggers[t].flags |= TEF_PROCESSED_EFFECTS;
 
 		// snap out of charm if the charmer hurt us
-		if (m->triggerID == trigger_attackedby) {
+		if (triggers[t].triggerID == trigger_attackedby) {
 			Actor *attacker = core->GetGame()->GetActorByGlobalID(LastAttacker);
 			if (attacker) {
 				int revertToEA = 0;
@@ -3139,6 +3195,33 @@ void Actor::RefreshEffects(EffectQueue *fx)
 	}
 }
 
+//remember the result of applying the effects, if it can be reused
+void Actor::CacheRefresh(bool verify)
+{
+	if (!refreshCache) {
+		refreshCache = new RefreshCache();
+	}
+
+	if (verify) {
+		for (unsigned int i = 0; i < MAX_STATS; i++) {
+			if (refreshCache->Modified[i] != Modified[i]) {
+				Log(WARNING, "Actor", "%s: stat %d would have been reused as %d instead of %d",
+					GetName(1), i, refreshCache->Modified[i], Modified[i]);
+			}
+		}
+	}
+
+	refreshCache->valid = fxqueue.OnlyStaticEffects(refreshCache->until);
+	if (!refreshCache->valid) {
+		return;
+	}
+	memcpy( refreshCache->BaseStats, BaseStats, MAX_STATS * sizeof( ieDword ) );
+	memcpy( refreshCache->Modified, Modified, MAX_STATS * sizeof( ieDword ) );
+	refreshCache->AC = AC;
+	refreshCache->ToHit = ToHit;
+	refreshCache->generation = fxqueue.GetGeneration();
+}
+
 int Actor::GetProficiency(int proftype) const
 {
 	switch(proftype) {
@@ -4484,7 +4567,7 @@ void Actor::PlayWalkSound()
 	ieDword thisTime;
 	ieResRef Sound;
 
-	thisTime = GetTickCount();
+	thisTime = InputRecord::GetTicks();
 	if (thisTime<nextWalk) return;
 	int cnt = anims->GetWalkSoundCount();
 	if (!cnt) return;
@@ -4609,7 +4692,7 @@ void Actor::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "Actor", buffer);
+	LogDebug("Actor", buffer);
 }
 
 void Actor::dump(StringBuffer& buffer) const
@@ -5845,6 +5928,10 @@ int Actor::IsDualWielding() const
 	if (!wield || slot == inventory.GetFistSlot() || slot == inventory.GetMagicSlot()) {
 		return 0;
 	}
+	//the answer only depends on the item, the resref catches a reused slot object
+	if (wield == dualWieldItem && slot == dualWieldSlot && !strnicmp(wield->ItemResRef, dualWieldResRef, 8)) {
+		return dualWielding;
+	}
 
 	Item *itm = gamedata->GetItem(wield->ItemResRef, true);
 	if (!itm) {
@@ -5856,7 +5943,11 @@ int Actor::IsDualWielding() const
 	int weapon = core->CanUseItemType( SLOT_WEAPON, itm );
 	gamedata->FreeItem( itm, wield->ItemResRef, false );
 	//is just weapon>0 ok?
-	return (weapon>0)?1:0;
+	dualWieldItem = wield;
+	dualWieldSlot = slot;
+	CopyResRef(dualWieldResRef, wield->ItemResRef);
+	dualWielding = (weapon>0)?1:0;
+	return dualWielding;
 }
 
 //returns weapon header currently used (bow in case of bow+arrow)
@@ -6890,7 +6981,7 @@ void Actor::PerformAttack(ieDword gameTime)
 		BaseStats[IE_CHECKFORBERSERK]=3;
 	}
 
-	Log(DEBUG, "Actor", "Performattack for %s, target is: %s", ShortName, target->ShortName);
+	LogDebug("Actor", "Performattack for %s, target is: %s", ShortName, target->ShortName);
 
 	//which hand is used
 	//we do apr - attacksleft so we always use the main hand first
@@ -7089,7 +7180,7 @@ void Actor::PerformAttack(ieDword gameTime)
 	ModifyWeaponDamage(wi, target, damage, critical);
 
 	if (target->GetStat(IE_MC_FLAGS) & MC_INVULNERABLE) {
-		Log(DEBUG, "Actor", "Attacking invulnerable target, nulifying damage!");
+		LogDebug("Actor", "Attacking invulnerable target, nulifying damage!");
 		damage = 0;
 	}
 
@@ -7254,7 +7345,7 @@ void Actor::ModifyDamage(Scriptable *hitter, int &damage, int &resisted, int dam
 				// avoid buggy data
 				if ((unsigned)abs(resistance) > maximum_values[it->second.resist_stat]) {
 					resistance = 0;
-					Log(DEBUG, "ModifyDamage", "Ignoring bad damage resistance value (%d).", resistance);
+					LogDebug("ModifyDamage", "Ignoring bad damage resistance value (%d).", resistance);
 				}
 				resisted += (int) (damage * resistance/100.0);
 				damage -= resisted;
@@ -7279,16 +7370,24 @@ void Actor::ModifyDamage(Scriptable *hitter, int &damage, int &resisted, int dam
 }
 
 void Actor::UpdateActorState(ieDword gameTime) {
+	TRACE_SCOPE("Actor::UpdateActorState");
 	if (modalTime==gameTime) {
 		return;
 	}
 
-	int roundFraction = (gameTime-roundTime) % GetAdjustedTime(core->Time.round_size);
+	// most actors have nothing to do at the start of a round, so they don't need
+	// to know where in it they are (the haste and slow checks walk the effect queue)
+	bool autoSearch = InParty && core->HasFeature(GF_AUTOSEARCH_HIDDEN);
+	int roundFraction = 1;
+	if (autoSearch || ModalState != MS_NONE || modalSpellLingering || (Modified[IE_STATE_ID] & STATE_CONFUSED)
+		|| BaseStats[IE_CHECKFORBERSERK] || Modified[IE_CHECKFORBERSERK]) {
+		roundFraction = (gameTime-roundTime) % GetAdjustedTime(core->Time.round_size);
+	}
 
 	//actually, iwd2 has autosearch, also, this is useful for dayblindness
 	//apply the modal effect about every second (pst and iwds have round sizes that are not multiples of 15)
 	// FIXME: split dayblindness out of detect.spl and only run that each tick + simplify this check
-	if (InParty && core->HasFeature(GF_AUTOSEARCH_HIDDEN) && (third || ((roundFraction%AI_UPDATE_TIME) == 0))) {
+	if (autoSearch && (third || ((roundFraction%AI_UPDATE_TIME) == 0))) {
 		core->ApplySpell("detect", this, this, 0);
 	}
 
@@ -7730,7 +7829,7 @@ void Actor::DrawActorSprite(const Region &screen, int cx, int cy, const Region&
 					cy, -anims[0]->animArea.x,
 					-anims[0]->animArea.y,
 					anims[0]->animArea.w,
-					anims[0]->animArea.h, WantDither() );
+					anims[0]->animArea.h, WantDither(), false, newsc );
 			}
 			assert(newsc->Covers(cx, cy, nextFrame->XPos, nextFrame->YPos, nextFrame->Width, nextFrame->Height));
 
@@ -7771,6 +7870,25 @@ bool Actor::ShouldHibernate() {
 	return true;
 }
 
+bool Actor::AnimationCanWait() const
+{
+	// something waits for the current stance to end or reach its frame
+	if (InTrap || attackProjectile) {
+		return false;
+	}
+	CharAnimations* ca = GetAnims();
+	if (ca && ca->autoSwitchOnEnd) {
+		return false;
+	}
+	switch (GetStance()) {
+		case IE_ANI_ATTACK: case IE_ANI_ATTACK_JAB: case IE_ANI_ATTACK_SLASH:
+		case IE_ANI_ATTACK_BACKSLASH: case IE_ANI_SHOOT:
+			return false;
+		default:
+			return true;
+	}
+}
+
 void Actor::UpdateAnimations()
 {
 	// TODO: move this
@@ -7892,16 +8010,74 @@ bool Actor::HasBodyHeat() const
 	return true;
 }
 
-void Actor::Draw(const Region &screen)
+void Actor::DrawSelection(const Point &drawPos)
+{
+	Region vp = core->GetVideoDriver()->GetViewport();
+	bool drawcircle = ShouldDrawCircle();
+	GameControl *gc = core->GetGameControl();
+	if (gc->GetScreenFlags()&SF_CUTSCENE) {
+		// ground circles are not drawn in cutscenes
+		drawcircle = false;
+	}
+	// the speaker should get a circle even in cutscenes
+	if ((gc->GetDialogueFlags()&DF_IN_DIALOG) && gc->dialoghandler->IsTarget(this)) {
+		drawcircle = true;
+	}
+	bool drawtarget = false;
+	// we always show circle/target on pause
+	if (drawcircle && !(gc->GetDialogueFlags() & DF_FREEZE_SCRIPTS)) {
+		// check marker feedback level
+		ieDword markerfeedback = 4;
+		core->GetDictionary()->Lookup("GUI Feedback Level", markerfeedback);
+		if (Over) {
+			// picked creature, should always be true
+			drawcircle = true;
+		} else if (Selected) {
+			// selected creature
+			drawcircle = markerfeedback >= 2;
+		} else if (IsPC()) {
+			// selectable
+			drawcircle = markerfeedback >= 3;
+		} else if (Modified[IE_EA] >= EA_EVILCUTOFF) {
+			// hostile
+			drawcircle = markerfeedback >= 4;
+		} else {
+			// all
+			drawcircle = markerfeedback >= 5;
+		}
+	}
+	if (drawcircle) {
+		DrawCircle(drawPos, vp);
+		drawtarget = ((Selected || Over) && !(InternalFlags&IF_NORETICLE) && Modified[IE_EA] <= EA_CONTROLLABLE && GetPathLength());
+	}
+	if (drawtarget) {
+		gc->DrawTargetReticle(Destination, (size - 1) * 4, true, Over, Selected); //we could set this to !paused if we wanted to only animate when not paused
+	}
+}
+
+bool Actor::Draw(const Region &screen)
 {
 	Map* area = GetCurrentArea();
 	if (!area) {
 		InternalFlags &= ~IF_TRIGGER_AP;
-		return;
+		return false;
 	}
 
-	int cx = Pos.x;
-	int cy = Pos.y;
+	//walking actors are drawn where they are between the ticks, not just at them
+	Point drawPos = Pos;
+	bool interpolated = false;
+	Game *game = core->GetGame();
+	if (speed && IsStepping() && !Immobile() && !(GetBase(IE_STATE_ID)&STATE_CANTMOVE)
+		&& !game->TimeStoppedFor(this)) {
+		// the offset keeps changing until the next tick, so keep redrawing
+		interpolated = true;
+		unsigned long tickOffset = core->GetTickOffset();
+		if (tickOffset) {
+			drawPos = GetDrawPosition(speed, game->Ticks + tickOffset);
+		}
+	}
+	int cx = drawPos.x;
+	int cy = drawPos.y;
 	int explored = Modified[IE_DONOTJUMP]&DNJ_UNHINDERED;
 	//check the deactivation condition only if needed
 	//this fixes dead actors disappearing from fog of war (they should be permanently visible)
@@ -7914,7 +8090,7 @@ void Actor::Draw(const Region &screen)
 			// for a while this didn't return (disable drawing) if about to hibernate;
 			// Avenger said (aa10aaed) "we draw the actor now for the last time".
 			InternalFlags &= ~IF_TRIGGER_AP;
-			return;
+			return false;
 		}
 	}
 
@@ -7922,19 +8098,19 @@ void Actor::Draw(const Region &screen)
 	// let us assume not, for now..
 	if (!(InternalFlags & IF_VISIBLE)) {
 		InternalFlags &= ~IF_TRIGGER_AP;
-		return;
+		return false;
 	}
 
 	//iwd has this flag saved in the creature
 	if (Modified[IE_AVATARREMOVAL]) {
-		return;
+		return false;
 	}
 
 	//visual feedback
 	CharAnimations* ca = GetAnims();
 	if (!ca) {
 		InternalFlags &= ~IF_TRIGGER_AP;
-		return;
+		return false;
 	}
 
 	//explored or visibilitymap (bird animations are visible in fog)
@@ -7976,49 +8152,12 @@ void Actor::Draw(const Region &screen)
 	//draw videocells under the actor
 	DrawVideocells(screen, vvcShields, tint);
 
-	Video* video = core->GetVideoDriver();
-	Region vp = video->GetViewport();
-
 	bool shoulddrawcircle = ShouldDrawCircle();
-	bool drawcircle = shoulddrawcircle;
-	GameControl *gc = core->GetGameControl();
-	if (gc->GetScreenFlags()&SF_CUTSCENE) {
-		// ground circles are not drawn in cutscenes
-		drawcircle = false;
-	}
-	// the speaker should get a circle even in cutscenes
-	if ((gc->GetDialogueFlags()&DF_IN_DIALOG) && gc->dialoghandler->IsTarget(this)) {
-		drawcircle = true;
-	}
-	bool drawtarget = false;
-	// we always show circle/target on pause
-	if (drawcircle && !(gc->GetDialogueFlags() & DF_FREEZE_SCRIPTS)) {
-		// check marker feedback level
-		ieDword markerfeedback = 4;
-		core->GetDictionary()->Lookup("GUI Feedback Level", markerfeedback);
-		if (Over) {
-			// picked creature, should always be true
-			drawcircle = true;
-		} else if (Selected) {
-			// selected creature
-			drawcircle = markerfeedback >= 2;
-		} else if (IsPC()) {
-			// selectable
-			drawcircle = markerfeedback >= 3;
-		} else if (Modified[IE_EA] >= EA_EVILCUTOFF) {
-			// hostile
-			drawcircle = markerfeedback >= 4;
-		} else {
-			// all
-			drawcircle = markerfeedback >= 5;
-		}
-	}
-	if (drawcircle) {
-		DrawCircle(vp);
-		drawtarget = ((Selected || Over) && !(InternalFlags&IF_NORETICLE) && Modified[IE_EA] <= EA_CONTROLLABLE && GetPathLength());
-	}
-	if (drawtarget) {
-		gc->DrawTargetReticle(Destination, (size - 1) * 4, true, Over, Selected); //we could set this to !paused if we wanted to only animate when not paused
+	if (game->globalTintPass) {
+		// the circle keeps its colours, so it goes on after the tint
+		area->DeferSelection(this, drawPos);
+	} else {
+		DrawSelection(drawPos);
 	}
 
 	unsigned char StanceID = GetStance();
@@ -8226,6 +8365,7 @@ void Actor::Draw(const Region &screen)
 			core->Autopause(AP_ENEMY, this);
 		}
 	}
+	return interpolated;
 }
 
 /* Handling automatic stance changes */
@@ -8450,9 +8590,9 @@ void Actor::dumpQSlots() const
 		buffer3.appendFormatted("%3d ", Gemrb2IWD2Qslot(tmp, i));
 	}
 	buffer.appendFormatted("(class: %d)", GetStat(IE_CLASS));
-	Log(DEBUG, "Actor", buffer);
-//	Log(DEBUG, "Actor", buffer2);
-//	Log(DEBUG, "Actor", buffer3);
+	LogDebug("Actor", buffer);
+//	LogDebug("Actor", buffer2);
+//	LogDebug("Actor", buffer3);
 
 	buffer.clear();
 	buffer2.clear();
@@ -8466,9 +8606,9 @@ void Actor::dumpQSlots() const
 		buffer2.appendFormatted("%3d ", IWD2GemrbQslot(tmp));
 		buffer3.appendFormatted("%3d ", Gemrb2IWD2Qslot(tmp, i));
 	}
-	Log(DEBUG, "Actor", buffer);
-	Log(DEBUG, "Actor", buffer2);
-	Log(DEBUG, "Actor", buffer3);
+	LogDebug("Actor", buffer);
+	LogDebug("Actor", buffer2);
+	LogDebug("Actor", buffer3);
 }
 
 void Actor::SetPortrait(const char* ResRef, int Which)
@@ -46,6 +46,7 @@ class ScriptedAnimation;
 class StringBuffer;
 class ToHitStats;
 struct PolymorphCache;
+struct RefreshCache;
 
 }
 
@@ -355,10 +356,18 @@ public:
 	PolymorphCache *polymorphCache; // fx_polymorph etc
 	WildSurgeSpellMods wildSurgeMods;
 	ieByte DifficultyMargin;
+	//place in the sorted draw queue of the area last time, where the next sort starts from
+	unsigned int DrawRank;
 private:
 	//this stuff doesn't get saved
 	CharAnimations* anims;
 	CharAnimations *shadowAnimations;
+	RefreshCache *refreshCache;
+	//IsDualWielding for the offhand item it last saw, the attack code asks many times a round
+	mutable int dualWieldSlot;
+	mutable const CREItem *dualWieldItem;
+	mutable ieResRef dualWieldResRef;
+	mutable int dualWielding;
 	SpriteCover* extraCovers[EXTRA_ACTORCOVERS];
 	ieByte SavingThrow[5];
 	// true when command has been played after select
@@ -403,6 +412,7 @@ private:
 	/** Re/Inits the Modified vector for PCs/NPCs */
 	void RefreshPCStats();
 	void RefreshHP();
+	void CacheRefresh(bool verify);
 	bool ShouldHibernate();
 	bool ShouldDrawCircle() const;
 	bool HasBodyHeat() const;
@@ -435,6 +445,10 @@ public:
 	void SetAnimationID(unsigned int AnimID);
 	/** returns the animations */
 	CharAnimations* GetAnims() const;
+	/** reads the attack, casting, damage and death animations ahead of need */
+	void PreloadCombatAnimations();
+	/* whether UpdateAnimations may be skipped for now, the frames follow the clock */
+	bool AnimationCanWait() const;
 	/** returns the gender of actor for cg sound - illusions are tricky */
 	ieDword GetCGGender();
 	/** some hardcoded effects in puppetmaster based on puppet type */
@@ -708,8 +722,11 @@ public:
 
 	/* if necessary, advance animation */
 	void UpdateAnimations();
-	/* if necessary, draw actor */
-	void Draw(const Region &screen);
+	/* if necessary, draw actor, returns true if it was drawn between the
+	 * ticks, so it moves on with the tick offset */
+	bool Draw(const Region &screen);
+	/* draws the ground circle and the target reticle, if they are shown */
+	void DrawSelection(const Point &drawPos);
 	bool DoStep(unsigned int walk_speed, ieDword time = 0);
 
 	/* add mobile vvc (spell effects) to actor's list */
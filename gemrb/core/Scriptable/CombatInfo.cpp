@@ -189,7 +189,7 @@ void ArmorClass::dump() const
 	buffer.appendFormatted("Natural: %d\tGeneric: %d\tDeflection: %d\n", natural, genericBonus, deflectionBonus);
 	buffer.appendFormatted("Armor: %d\tShield: %d\n", armorBonus, shieldBonus);
 	buffer.appendFormatted("Dexterity: %d\tWisdom: %d\n\n", dexterityBonus, wisdomBonus);
-	Log(DEBUG, "ArmorClass", buffer);
+	LogDebug("ArmorClass", buffer);
 }
 
 /*
@@ -325,7 +325,7 @@ void ToHitStats::dump() const
 	buffer.appendFormatted("Base: %2d\tGeneric: %d\tAbility: %d\n", base, genericBonus, abilityBonus);
 	buffer.appendFormatted("Armor: %d\tShield: %d\n", armorBonus, shieldBonus);
 	buffer.appendFormatted("Weapon: %d\tProficiency: %d\n\n", weaponBonus, proficiencyBonus);
-	Log(DEBUG, "ToHit", buffer);
+	LogDebug("ToHit", buffer);
 }
 
 
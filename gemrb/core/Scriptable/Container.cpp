@@ -304,7 +304,7 @@ void Container::dump() const
 	buffer.appendFormatted( "Script: %s, Key: %s\n", name, KeyResRef );
 	// FIXME: const_cast
 	inventory.dump(buffer);
-	Log(DEBUG, "Container", buffer);
+	LogDebug("Container", buffer);
 }
 
 bool Container::TryUnlock(Actor *actor) {
@@ -142,6 +142,7 @@ void Door::ToggleTiles(int State, int playsound)
 	}
 	for (i = 0; i < tilecount; i++) {
 		overlay->tiles[tiles[i]]->tileIndex = (ieByte) state;
+		overlay->TileChanged(tiles[i]);
 	}
 
 	//set door_open as state
@@ -479,7 +480,7 @@ void Door::dump() const
 	}
 	buffer.appendFormatted( "Script: %s, Key (%s) removed: %s, Dialog: %s\n", name, Key?Key:"NONE", YESNO(Flags&DOOR_KEY), Dialog );
 
-	Log(DEBUG, "Door", buffer);
+	LogDebug("Door", buffer);
 }
 
 
@@ -166,6 +166,14 @@ bool InfoPoint::TriggerTrap(int skill, ieDword ID)
 	return false;
 }
 
+// PersonalDistance(point, actor) < MAX_OPERATING_DISTANCE can only hold inside this box,
+// so the actors far away don't need the square root
+static inline bool InOperatingBox(const Point &point, const Actor *actor)
+{
+	int reach = (int) MAX_OPERATING_DISTANCE + actor->size * 10;
+	return abs(point.x - actor->Pos.x) < reach && abs(point.y - actor->Pos.y) < reach;
+}
+
 bool InfoPoint::Entered(Actor *actor)
 {
 	if (outline->PointIn( actor->Pos ) ) {
@@ -182,16 +190,16 @@ bool InfoPoint::Entered(Actor *actor)
 		goto check;
 	}*/
 	// this method is better (fuzzie, 2009) and also works for the iwd ar6002 northeast exit
-	if (Type == ST_TRAVEL && PersonalDistance(TrapLaunch, actor)<MAX_OPERATING_DISTANCE) {
+	if (Type == ST_TRAVEL && InOperatingBox(TrapLaunch, actor) && PersonalDistance(TrapLaunch, actor)<MAX_OPERATING_DISTANCE) {
 		goto check;
 	}
 	// fuzzie can't escape pst's ar1405 without this one, maybe we should really be checking
 	// for distance from the outline for travel regions instead?
-	if (Type == ST_TRAVEL && PersonalDistance(TalkPos, actor)<MAX_OPERATING_DISTANCE) {
+	if (Type == ST_TRAVEL && InOperatingBox(TalkPos, actor) && PersonalDistance(TalkPos, actor)<MAX_OPERATING_DISTANCE) {
 		goto check;
 	}
 	if (Flags&TRAP_USEPOINT) {
-		if (PersonalDistance(UsePoint, actor)<MAX_OPERATING_DISTANCE) {
+		if (InOperatingBox(UsePoint, actor) && PersonalDistance(UsePoint, actor)<MAX_OPERATING_DISTANCE) {
 			goto check;
 		}
 	}
@@ -254,7 +262,7 @@ void InfoPoint::dump() const
 			TrapRemovalDiff );
 		break;
 	case ST_TRIGGER:
-		buffer.appendFormatted ( "InfoString: %ls\n", OverheadText.c_str() );
+		buffer.appendFormatted ( "InfoString: %ls\n", GetOverheadText().c_str() );
 		break;
 	default:;
 	}
@@ -265,7 +273,7 @@ void InfoPoint::dump() const
 	buffer.appendFormatted( "Script: %s, Key: %s, Dialog: %s\n", name, KeyResRef, Dialog );
 	buffer.appendFormatted( "Deactivated: %s\n", YESNO(Flags&TRAP_DEACTIVATED));
 	buffer.appendFormatted( "Active: %s\n", YESNO(InternalFlags&IF_ACTIVE));
-	Log(DEBUG, "InfoPoint", buffer);
+	LogDebug("InfoPoint", buffer);
 }
 
 
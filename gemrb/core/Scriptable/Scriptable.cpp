@@ -27,6 +27,7 @@
 #include "DisplayMessage.h"
 #include "Game.h"
 #include "GameData.h"
+#include "PathService.h"
 #include "Projectile.h"
 #include "Spell.h"
 #include "Sprite2D.h"
@@ -34,6 +35,8 @@
 #include "Video.h"
 #include "GameScript/GSUtils.h"
 #include "GameScript/Matching.h" // MatchActor
+#include "GameScript/ScriptProfiler.h"
+#include "GameScript/ScriptScheduler.h"
 #include "GUI/GameControl.h"
 #include "GUI/TextSystem/Font.h"
 #include "RNG/RNG_SFMT.h"
@@ -94,6 +97,8 @@ Scriptable::Scriptable(ScriptableType type)
 	IdleTicks = 0;
 	AuraTicks = 100;
 	TriggerCountdown = 0;
+	ScriptDelay = 0;
+	FarAway = false;
 	Dialog[0] = 0;
 
 	globalID = ++globalActorCounter;
@@ -214,13 +219,19 @@ void Scriptable::SetOverheadText(const String& text, bool display)
 {
 	overHeadTextPos.empty();
 	if (!text.empty()) {
-		OverheadText = text;
+		OverheadText = SharedString::Intern(text);
 		DisplayOverheadText(display);
 	} else {
 		DisplayOverheadText(false);
 	}
 }
 
+const String& Scriptable::GetOverheadText() const
+{
+	static const String none;
+	return OverheadText ? OverheadText->Get() : none;
+}
+
 bool Scriptable::DisplayOverheadText(bool show)
 {
 	if (show && !overheadTextDisplaying) {
@@ -284,7 +295,7 @@ void Scriptable::DrawOverheadText(const Region &screen)
 
 	core->GetVideoDriver()->ConvertToScreen(x, y);
 	Region rgn( x-100+screen.x, y - cs + screen.y, 200, 400 );
-	core->GetTextFont()->Print( rgn, OverheadText, palette,
+	core->GetTextFont()->Print( rgn, GetOverheadText(), palette,
 							   IE_FONT_ALIGN_CENTER | IE_FONT_ALIGN_TOP );
 
 	palette->release();
@@ -329,8 +340,16 @@ void Scriptable::Update()
 
 void Scriptable::TickScripting()
 {
+	// A round put off by the scheduler is retried until it runs.
+	if (ScriptDelay) {
+		if (ScriptScheduler::Admit(this)) {
+			RunScriptRound();
+		}
+		return;
+	}
+
 	// Stagger script updates.
-	if (Ticks % 16 != globalID % 16)
+	if (Ticks % ScriptPeriod() != globalID % ScriptPeriod())
 		return;
 
 	ieDword actorState = 0;
@@ -362,6 +381,14 @@ void Scriptable::TickScripting()
 		return;
 	}
 
+	if (!ScriptScheduler::Admit(this)) {
+		return;
+	}
+	RunScriptRound();
+}
+
+void Scriptable::RunScriptRound()
+{
 	if (triggers.size())
 		TriggerCountdown = 5;
 	IdleTicks = 0;
@@ -370,7 +397,25 @@ void Scriptable::TickScripting()
 		TriggerCountdown--;
 	// TODO: set TriggerCountdown once we have real triggers
 
+	if (!ScriptScheduler::IsEnabled()) {
+		ExecuteScript(MAX_SCRIPTS);
+		return;
+	}
+	unsigned __int64 start = ScriptProfiler::Now();
 	ExecuteScript(MAX_SCRIPTS);
+	ScriptScheduler::Spend(ScriptProfiler::Now() - start);
+}
+
+void Scriptable::GetDueScripts(std::vector<GameScript*> &scripts) const
+{
+	// the same stagger, Update counts the tick first
+	if ((Ticks + 1) % ScriptPeriod() != globalID % ScriptPeriod())
+		return;
+	for (int i = 0; i < MAX_SCRIPTS; i++) {
+		if (Scripts[i]) {
+			scripts.push_back(Scripts[i]);
+		}
+	}
 }
 
 void Scriptable::ExecuteScript(int scriptCount)
@@ -438,6 +483,19 @@ void Scriptable::ExecuteScript(int scriptCount)
 	}
 }
 
+void ActionQueue::Grow()
+{
+	unsigned int newCapacity = capacity ? capacity * 2 : 4;
+	Action **newItems = (Action **) malloc(newCapacity * sizeof(Action *));
+	for (unsigned int i = 0; i < count; i++) {
+		newItems[i] = items[(head + i) & (capacity - 1)];
+	}
+	free(items);
+	items = newItems;
+	capacity = newCapacity;
+	head = 0;
+}
+
 void Scriptable::AddAction(Action* aC)
 {
 	if (!aC) {
@@ -485,7 +543,7 @@ void Scriptable::AddActionInFront(Action* aC)
 
 Action* Scriptable::GetNextAction() const
 {
-	if (actionQueue.size() == 0) {
+	if (actionQueue.empty()) {
 		return NULL;
 	}
 	return actionQueue.front();
@@ -493,7 +551,7 @@ Action* Scriptable::GetNextAction() const
 
 Action* Scriptable::PopNextAction()
 {
-	if (actionQueue.size() == 0) {
+	if (actionQueue.empty()) {
 		return NULL;
 	}
 	Action* aC = actionQueue.front();
@@ -509,12 +567,11 @@ void Scriptable::ClearActions()
 		ReleaseCurrentAction();
 	} else {
 		ReleaseCurrentAction();
-		for (unsigned int i = 0; i < actionQueue.size(); i++) {
+		while (!actionQueue.empty()) {
 			Action* aC = actionQueue.front();
 			actionQueue.pop_front();
 			aC->Release();
 		}
-		actionQueue.clear();
 	}
 	WaitCounter = 0;
 	LastTarget = 0;
@@ -599,7 +656,8 @@ bool Scriptable::InMove() const
 		return false;
 	}
 	Movable *me = (Movable *) this;
-	return me->GetNextStep()!=NULL;
+	// a path being worked out in the background counts as moving already
+	return me->GetNextStep()!=NULL || me->GetPathRequest();
 }
 
 void Scriptable::SetWait(unsigned long time)
@@ -675,7 +733,19 @@ void Scriptable::InitTriggers()
 
 void Scriptable::AddTrigger(TriggerEntry trigger)
 {
-	triggers.push_back(trigger);
+	// broadcasts often repeat themselves within a round, and an exact copy
+	// matches nothing the first one doesn't
+	size_t i = triggers.size();
+	while (i--) {
+		const TriggerEntry &entry = triggers[i];
+		if (entry.triggerID == trigger.triggerID && entry.param1 == trigger.param1 &&
+			entry.param2 == trigger.param2 && entry.flags == trigger.flags) {
+			break;
+		}
+	}
+	if (i == (size_t) -1) {
+		triggers.push_back(trigger);
+	}
 	ImmediateEvent();
 
 	assert(trigger.triggerID < MAX_TRIGGERS);
@@ -687,7 +757,7 @@ void Scriptable::AddTrigger(TriggerEntry trigger)
 }
 
 bool Scriptable::MatchTrigger(unsigned short id, ieDword param) {
-	for (std::list<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
+	for (std::vector<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
 		TriggerEntry &trigger = *m;
 		if (trigger.triggerID != id)
 			continue;
@@ -700,7 +770,7 @@ bool Scriptable::MatchTrigger(unsigned short id, ieDword param) {
 }
 
 bool Scriptable::MatchTriggerWithObject(unsigned short id, class Object *obj, ieDword param) {
-	for (std::list<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
+	for (std::vector<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
 		TriggerEntry &trigger = *m;
 		if (trigger.triggerID != id)
 			continue;
@@ -715,7 +785,7 @@ bool Scriptable::MatchTriggerWithObject(unsigned short id, class Object *obj, ie
 }
 
 const TriggerEntry *Scriptable::GetMatchingTrigger(unsigned short id, unsigned int notflags) {
-	for (std::list<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
+	for (std::vector<TriggerEntry>::iterator m = triggers.begin(); m != triggers.end (); m++) {
 		TriggerEntry &trigger = *m;
 		if (trigger.triggerID != id)
 			continue;
@@ -786,6 +856,7 @@ void Scriptable::CreateProjectile(const ieResRef SpellResRef, ieDword tgt, int l
 			Actor *newact = NULL;
 			SPLExtHeader *seh = NULL;
 			Effect *fx = NULL;
+			spl->LoadFeatures();
 			switch (caster->wildSurgeMods.target_change_type) {
 				case WSTC_SETTYPE:
 					seh = &spl->ext_headers[SpellHeader];
@@ -1718,7 +1789,7 @@ void Selectable::SetBBox(const Region &newBBox)
 	BBox = newBBox;
 }
 
-void Selectable::DrawCircle(const Region &vp)
+void Selectable::DrawCircle(const Point &center, const Region &vp)
 {
 	/* BG2 colours ground circles as follows:
 	dark green for unselected party members
@@ -1755,13 +1826,13 @@ void Selectable::DrawCircle(const Region &vp)
 	}
 
 	if (sprite) {
-		core->GetVideoDriver()->BlitSprite( sprite, Pos.x - vp.x, Pos.y - vp.y, true );
+		core->GetVideoDriver()->BlitSprite( sprite, center.x - vp.x, center.y - vp.y, true );
 	} else {
 		// for size >= 2, radii are (size-1)*16, (size-1)*12
 		// for size == 1, radii are 12, 9
 		int csize = (size - 1) * 4;
 		if (csize < 4) csize = 3;
-		core->GetVideoDriver()->DrawEllipse( (ieWord) (Pos.x - vp.x), (ieWord) (Pos.y - vp.y),
+		core->GetVideoDriver()->DrawEllipse( (ieWord) (center.x - vp.x), (ieWord) (center.y - vp.y),
 		(ieWord) (csize * 4), (ieWord) (csize * 3), *col );
 	}
 }
@@ -1989,6 +2060,9 @@ Movable::Movable(ScriptableType type)
 	StanceID = 0;
 	path = NULL;
 	step = NULL;
+	pathRequest = 0;
+	pathDistance = 0;
+	blockedSince = 0;
 	timeStartStep = 0;
 	lastFrame = NULL;
 	Area[0] = 0;
@@ -1998,6 +2072,8 @@ Movable::Movable(ScriptableType type)
 	HomeLocation.x = 0;
 	HomeLocation.y = 0;
 	maxWalkDistance = 0;
+	actorIndexCell = -1;
+	actorIndexSlot = -1;
 }
 
 Movable::~Movable(void)
@@ -2187,6 +2263,31 @@ bool Movable::DoStep(unsigned int walk_speed, ieDword time)
 	return true;
 }
 
+bool Movable::IsStepping() const
+{
+	return step && step->Next;
+}
+
+//the same walk as in DoStep, but nothing changes
+Point Movable::GetDrawPosition(unsigned int walk_speed, ieDword time) const
+{
+	if (!step || !step->Next || !walk_speed || time < timeStartStep) {
+		return Pos;
+	}
+	const PathNode *from = step;
+	ieDword start = timeStartStep;
+	while (time - start >= walk_speed) {
+		from = from->Next;
+		start += walk_speed;
+		if (!from->Next) {
+			return Point(( from->x * 16 ) + 8, ( from->y * 12 ) + 6);
+		}
+	}
+	Point pos(( from->x * 16 ) + 8, ( from->y * 12 ) + 6);
+	AdjustPositionTowards(pos, time - start, walk_speed, from->x, from->y, from->Next->x, from->Next->y);
+	return pos;
+}
+
 void Movable::AddWayPoint(const Point &Des)
 {
 	if (!path) {
@@ -2224,6 +2325,7 @@ void Movable::FixPosition()
 	GetCurrentArea()->AdjustPosition(Pos);
 	Pos.x=Pos.x*16+8;
 	Pos.y=Pos.y*12+6;
+	area->UpdateActorIndex(actor);
 }
 
 void Movable::WalkTo(const Point &Des, int distance)
@@ -2236,6 +2338,26 @@ void Movable::WalkTo(const Point &Des, int distance)
 		return;
 	}
 
+	PathService *service = core->GetPathService();
+	if (service) {
+		// keep walking the current step while the new path is worked out,
+		// SetQueuedPath joins them once it arrives
+		if (step && step->Next) {
+			from.x = ( step->Next->x * 16 ) + 8;
+			from.y = ( step->Next->y * 12 ) + 6;
+		} else {
+			ClearPath();
+			FixPosition();
+			from = Pos;
+		}
+		area->ClearSearchMapFor(this);
+		Map::CountPathRequest();
+		Destination = Des;
+		pathDistance = distance;
+		pathRequest = service->Submit(area, this, from, Des, distance);
+		return;
+	}
+
 	// the prev_step stuff is a naive attempt to allow re-pathing while moving
 	PathNode *prev_step = NULL;
 	unsigned char old_stance = StanceID;
@@ -2252,6 +2374,7 @@ void Movable::WalkTo(const Point &Des, int distance)
 		from = Pos;
 	}
 	area->ClearSearchMapFor(this);
+	Map::CountPathRequest();
 	if (distance) {
 		path = area->FindPathNear( from, Des, size, distance );
 	} else {
@@ -2263,27 +2386,7 @@ void Movable::WalkTo(const Point &Des, int distance)
 		Destination = Des;
 
 		if (prev_step) {
-			// we want to smoothly continue, please
-			// this all needs more thought! but it seems to work okay
-			StanceID = old_stance;
-
-			if (path->Next) {
-				// this is a terrible hack to make up for the
-				// pathfinder orienting the first node wrong
-				// should be fixed in pathfinder and not here!
-				Point next, follow;
-				next.x = path->x; next.y = path->y;
-				follow.x = path->Next->x;
-				follow.y = path->Next->y;
-				path->orient = GetOrient(follow, next);
-			}
-
-			// then put the prev_step at the beginning of the path
-			prev_step->Next = path;
-			path->Parent = prev_step;
-			path = prev_step;
-
-			step = path;
+			JoinPath(prev_step, old_stance);
 		}
 	} else {
 		// pathing failed
@@ -2294,6 +2397,72 @@ void Movable::WalkTo(const Point &Des, int distance)
 	}
 }
 
+// puts prev_step (a copy of the step we are walking) in front of the new path
+void Movable::JoinPath(PathNode *prev_step, unsigned char old_stance)
+{
+	// we want to smoothly continue, please
+	// this all needs more thought! but it seems to work okay
+	StanceID = old_stance;
+
+	if (path->Next) {
+		// this is a terrible hack to make up for the
+		// pathfinder orienting the first node wrong
+		// should be fixed in pathfinder and not here!
+		Point next, follow;
+		next.x = path->x; next.y = path->y;
+		follow.x = path->Next->x;
+		follow.y = path->Next->y;
+		path->orient = GetOrient(follow, next);
+	}
+
+	// then put the prev_step at the beginning of the path
+	prev_step->Next = path;
+	path->Parent = prev_step;
+	path = prev_step;
+
+	step = path;
+}
+
+// the path of the last background request arrived
+void Movable::SetQueuedPath(PathNode *newpath)
+{
+	Point dest = Destination;
+	pathRequest = 0;
+
+	if (!step || !step->Next) {
+		// standing (or about to), just start on it
+		ClearPath();
+		path = newpath;
+		Destination = dest;
+		return;
+	}
+
+	// we kept walking meanwhile, continue from the step we are heading to
+	PathNode *join = newpath;
+	while (join && (join->x != step->Next->x || join->y != step->Next->y)) {
+		join = join->Next;
+	}
+	if (!join) {
+		// we strayed off the new path already, ask again from here
+		PathNode::FreePath(newpath);
+		WalkTo(dest, pathDistance);
+		return;
+	}
+	// drop the steps we walked meanwhile
+	if (join != newpath) {
+		join->Parent->Next = NULL;
+		join->Parent = NULL;
+		PathNode::FreePath(newpath);
+	}
+
+	PathNode *prev_step = new PathNode(*step);
+	unsigned char old_stance = StanceID;
+	ClearPath();
+	path = join;
+	Destination = dest;
+	JoinPath(prev_step, old_stance);
+}
+
 void Movable::RunAwayFrom(const Point &Des, int PathLength, int flags)
 {
 	ClearPath();
@@ -2354,6 +2523,9 @@ void Movable::MoveTo(const Point &Des)
 	area->ClearSearchMapFor(this);
 	Pos = Des;
 	Destination = Des;
+	if (Type == ST_ACTOR) {
+		area->UpdateActorIndex((Actor *) this);
+	}
 	if (BlocksSearchMap()) {
 		area->BlockSearchMap( Pos, size, IsPC()?PATH_MAP_PC:PATH_MAP_NPC);
 	}
@@ -2375,17 +2547,44 @@ void Movable::ClearPath()
 		StanceID = IE_ANI_AWAKE;
 	}
 	InternalFlags&=~IF_NORETICLE;
-	PathNode* thisNode = path;
-	while (thisNode) {
-		PathNode* nextNode = thisNode->Next;
-		delete( thisNode );
-		thisNode = nextNode;
-	}
+	PathNode::FreePath(path);
 	path = NULL;
 	step = NULL;
+	// a pending background path is stale now too
+	pathRequest = 0;
+	blockedSince = 0;
 	//don't call ReleaseCurrentAction
 }
 
+// actors mostly block each other only in passing, so a taken step is
+// waited for a while before a new path is asked for; the waits differ
+// by actor, so of two walking into each other one gives way first
+#define STEP_WAIT 250
+#define STEP_WAIT_SPREAD 4
+
+bool Movable::WaitForStep(ieDword time)
+{
+	if (!step) {
+		return false;
+	}
+	if (!blockedSince) {
+		blockedSince = time ? time : 1;
+	}
+	ieDword wait = STEP_WAIT * (1 + GetGlobalID() % STEP_WAIT_SPREAD);
+	if (time - blockedSince >= wait) {
+		blockedSince = 0;
+		return false;
+	}
+	// stand on the current step, the walk goes on from there once it clears
+	Pos.x = ( step->x * 16 ) + 8;
+	Pos.y = ( step->y * 12 ) + 6;
+	timeStartStep = time;
+	if (StanceID==IE_ANI_WALK || StanceID==IE_ANI_RUN) {
+		StanceID = IE_ANI_AWAKE;
+	}
+	return true;
+}
+
 /**********************
  * Tiled Object Class *
  **********************/
@@ -24,9 +24,12 @@
 #include "exports.h"
 
 #include "Variables.h"
+#include "System/SharedString.h"
 
+#include <cstdlib>
 #include <list>
 #include <map>
+#include <vector>
 
 namespace GemRB {
 
@@ -200,6 +203,46 @@ struct TriggerEntry {
 	unsigned int flags;
 };
 
+/* the queued actions of a scriptable, a ring over one array that only
+ * grows, so queueing and popping the actions of every round don't allocate
+ */
+class GEM_EXPORT ActionQueue {
+public:
+	ActionQueue() : items(NULL), head(0), count(0), capacity(0) {}
+	~ActionQueue() { free(items); }
+
+	size_t size() const { return count; }
+	bool empty() const { return !count; }
+	Action *front() const { return items[head]; }
+	void push_back(Action *action)
+	{
+		if (count == capacity) Grow();
+		items[(head + count) & (capacity - 1)] = action;
+		count++;
+	}
+	void push_front(Action *action)
+	{
+		if (count == capacity) Grow();
+		head = (head + capacity - 1) & (capacity - 1);
+		items[head] = action;
+		count++;
+	}
+	void pop_front()
+	{
+		head = (head + 1) & (capacity - 1);
+		count--;
+	}
+	void clear() { head = count = 0; }
+private:
+	Action **items;
+	unsigned int head, count;
+	unsigned int capacity; // a power of two
+	void Grow();
+
+	ActionQueue(const ActionQueue&);
+	ActionQueue& operator=(const ActionQueue&);
+};
+
 //typedef std::list<ieDword *> TriggerObjects;
 
 //#define SEA_RESET		0x00000002
@@ -214,19 +257,21 @@ private:
 	std::map<ieDword,ieDword> script_timers;
 	ieDword globalID;
 protected: //let Actor access this
-	std::list<TriggerEntry> triggers;
+	// a vector, so clearing it every round keeps the room for the next one
+	std::vector<TriggerEntry> triggers;
 	Map *area;
 	ieVariable scriptName;
 	ieDword InternalFlags; //for triggers
 	ieResRef Dialog;
-	std::list< Action*> actionQueue;
+	ActionQueue actionQueue;
 	Action* CurrentAction;
 
 	// Variables for overhead text.
 	Point overHeadTextPos;
 	bool overheadTextDisplaying;
 	unsigned long timeStartDisplaying;
-	String OverheadText;
+	// shared, the same few messages are shown over many heads
+	Holder<SharedString> OverheadText;
 public:
 	// State relating to the currently-running action.
 	int CurrentActionState;
@@ -246,6 +291,10 @@ public:
 	ieDword AuraTicks;
 	// The countdown for forced activation by triggers.
 	ieDword TriggerCountdown;
+	// The ticks the due script round was put off by the ScriptScheduler.
+	ieDword ScriptDelay;
+	// Simulated in less detail, see Map::UpdateFarAway.
+	bool FarAway;
 
 	Variables* locals;
 	ScriptableType Type;
@@ -311,7 +360,7 @@ public:
 	void SetMap(Map *map);
 	void SetScript(int index, GameScript* script);
 	void SetOverheadText(const String& text, bool display = true);
-	const String& GetOverheadText() { return OverheadText; };
+	const String& GetOverheadText() const;
 	bool DisplayOverheadText(bool);
 	bool OverheadTextIsDisplaying() { return overheadTextDisplaying; }
 	void FixHeadTextPos();
@@ -321,6 +370,10 @@ public:
 	bool IsPC() const;
 	virtual void Update();
 	void TickScripting();
+	/* ticks between the script rounds, the far away ones think half as often */
+	unsigned int ScriptPeriod() const { return FarAway ? 32 : 16; }
+	/* the part of TickScripting after the round was found due and admitted */
+	void RunScriptRound();
 	virtual void ExecuteScript(int scriptCount);
 	void AddAction(Action* aC);
 	void AddActionInFront(Action* aC);
@@ -335,6 +388,8 @@ public:
 	//these functions handle clearing of triggers that resulted a
 	//true condition (whole triggerblock returned true)
 	void InitTriggers();
+	/* adds the scripts TickScripting will look at in the next Update */
+	void GetDueScripts(std::vector<GameScript*> &scripts) const;
 	void AddTrigger(TriggerEntry trigger);
 	bool MatchTrigger(unsigned short id, ieDword param = 0);
 	bool MatchTriggerWithObject(unsigned short id, class Object *obj, ieDword param = 0);
@@ -391,7 +446,7 @@ private:
 	SpriteCover* cover;
 public:
 	void SetBBox(const Region &newBBox);
-	void DrawCircle(const Region &vp);
+	void DrawCircle(const Point &center, const Region &vp);
 	bool IsOver(const Point &Pos) const;
 	void SetOver(bool over);
 	bool IsSelected() const;
@@ -455,6 +510,10 @@ private: //these seem to be sensitive, so get protection
 
 	PathNode* path; //whole path
 	PathNode* step; //actual step
+	unsigned int pathRequest; //pending PathService request, 0 if none
+	int pathDistance; //MinDistance of that request
+	ieDword blockedSince; //when the next step was found taken, 0 if it wasn't
+	void JoinPath(PathNode *prev_step, unsigned char old_stance);
 protected:
 	ieDword timeStartStep;
 public:
@@ -465,6 +524,8 @@ public:
 	ieResRef Area;
 	Point HomeLocation;//spawnpoint, return here after rest
 	ieWord maxWalkDistance;//maximum random walk distance from home
+	int actorIndexCell;//the cell of the area's actor index it is filed under, -1 if none
+	int actorIndexSlot;//its entry in that cell
 public:
 	PathNode *GetNextStep(int x);
 	int GetPathLength();
@@ -497,6 +558,10 @@ public:
 	void SetStance(unsigned int arg);
 	void SetAttackMoveChances(ieWord *amc);
 	virtual bool DoStep(unsigned int walk_speed, ieDword time = 0);
+	/* where the path would take us by the given time, for drawing between the ticks */
+	Point GetDrawPosition(unsigned int walk_speed, ieDword time) const;
+	/* there is a step to walk along, unlike GetNextStep it doesn't look for one */
+	bool IsStepping() const;
 	void AddWayPoint(const Point &Des);
 	void RunAwayFrom(const Point &Des, int PathLength, int flags);
 	void RandomWalk(bool can_stop, bool run);
@@ -506,6 +571,15 @@ public:
 	void MoveTo(const Point &Des);
 	void Stop();
 	void ClearPath();
+	/* holds still while the next step is taken, false once we waited long enough */
+	bool WaitForStep(ieDword time);
+	/* the next step is free (again) */
+	void StepCleared() { blockedSince = 0; }
+	bool IsWaitingForStep() const { return blockedSince != 0; }
+	/* the id of the background path request we wait for, 0 if none */
+	unsigned int GetPathRequest() const { return pathRequest; }
+	/* takes the result of that request */
+	void SetQueuedPath(PathNode *newpath);
 
 	/* returns the most likely position of this actor */
 	Point GetMostLikelyPosition();
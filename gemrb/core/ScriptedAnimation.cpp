@@ -32,6 +32,7 @@
 #include "GameData.h"
 #include "Interface.h"
 #include "Map.h"
+#include "ObjectPool.h"
 #include "Sprite2D.h"
 #include "Video.h"
 
@@ -63,6 +64,19 @@ static const ieByte SixteenToFive[3*MAX_ORIENT]={
 	10,10,11,11,12,12,13,13,14,14,13,13,12,12,11,11
 };
 
+// the projectiles and spells create and drop them all the time
+static ObjectPool<sizeof(ScriptedAnimation)> AnimationPool("animations");
+
+void *ScriptedAnimation::operator new(size_t size)
+{
+	return AnimationPool.Take(size);
+}
+
+void ScriptedAnimation::operator delete(void *obj, size_t size)
+{
+	AnimationPool.Give(obj, size);
+}
+
 ScriptedAnimation::ScriptedAnimation()
 {
 	Init();
@@ -120,15 +134,10 @@ void ScriptedAnimation::Override(ScriptedAnimation *templ)
 	}
 }
 
-//prepare the animation before doing anything
-void ScriptedAnimation::PrepareAnimation(Animation *anim, ieDword Transparency)
+//the mirrored frames come from the factory, so all the instances share them
+Animation *ScriptedAnimation::GetCycle(AnimationFactory *af, unsigned char cycle, ieDword Transparency)
 {
-	if (Transparency&IE_VVC_MIRRORX) {
-		anim->MirrorAnimation();
-	}
-	if (Transparency&IE_VVC_MIRRORY) {
-		anim->MirrorAnimationVert();
-	}
+	return af->GetCycle(cycle, (Transparency&IE_VVC_MIRRORX) != 0, (Transparency&IE_VVC_MIRRORY) != 0);
 }
 
 /* Creating animation from BAM */
@@ -194,12 +203,9 @@ void ScriptedAnimation::LoadAnimationFactory(AnimationFactory *af, int gettwin)
 			p*=MAX_ORIENT;
 		}
 
-		anims[p] = af->GetCycle( (ieByte) c );
+		anims[p] = af->GetCycle( (ieByte) c, mirror );
 		if (anims[p]) {
 			anims[p]->pos=0;
-			if (mirror) {
-				anims[p]->MirrorAnimation();
-			}
 			anims[p]->gameAnimation=true;
 		}
 	}
@@ -327,9 +333,8 @@ ScriptedAnimation::ScriptedAnimation(DataStream* stream)
 					if ( (int) af->GetCycleCount()>i) c=i;
 					break;
 				}
-				anims[p_onset] = af->GetCycle( c );
+				anims[p_onset] = GetCycle( af, ( unsigned char ) c, Transparency );
 				if (anims[p_onset]) {
-					PrepareAnimation(anims[p_onset], Transparency);
 					//creature anims may start at random position, vvcs always start on 0
 					anims[p_onset]->pos=0;
 					//vvcs are always paused
@@ -353,9 +358,8 @@ ScriptedAnimation::ScriptedAnimation(DataStream* stream)
 					if ((int) af->GetCycleCount()>i) c=i;
 					break;
 				}
-				anims[p_hold] = af->GetCycle( c );
+				anims[p_hold] = GetCycle( af, ( unsigned char ) c, Transparency );
 				if (anims[p_hold]) {
-					PrepareAnimation(anims[p_hold], Transparency);
 
 					anims[p_hold]->pos=0;
 					anims[p_hold]->gameAnimation=true;
@@ -380,9 +384,8 @@ ScriptedAnimation::ScriptedAnimation(DataStream* stream)
 					if ( (int) af->GetCycleCount()>i) c=i;
 					break;
 				}
-				anims[p_release] = af->GetCycle( ( unsigned char ) c );
+				anims[p_release] = GetCycle( af, ( unsigned char ) c, Transparency );
 				if (anims[p_release]) {
-					PrepareAnimation(anims[p_release], Transparency);
 
 					anims[p_release]->pos=0;
 					anims[p_release]->gameAnimation=true;
@@ -704,8 +707,9 @@ bool ScriptedAnimation::Draw(const Region &screen, const Point &Pos, const Color
 		if (!cover || (Dither!=dither) || (!cover->Covers(cx, cy, frame->XPos, frame->YPos, frame->Width, frame->Height)) ) {
 			Dither = dither;
 			Animation *anim = anims[Phase*MAX_ORIENT+Orientation];
-			SetSpriteCover(area->BuildSpriteCover(cx, cy, -anim->animArea.x,
-			-anim->animArea.y, anim->animArea.w, anim->animArea.h, dither) );
+			SpriteCover* newcover = area->BuildSpriteCover(cx, cy, -anim->animArea.x,
+				-anim->animArea.y, anim->animArea.w, anim->animArea.h, dither, false, cover);
+			if (newcover != cover) SetSpriteCover(newcover);
 		}
 		assert(cover->Covers(cx, cy, frame->XPos, frame->YPos, frame->Width, frame->Height));
 	}
@@ -78,6 +78,9 @@ class GEM_EXPORT ScriptedAnimation {
 public:
 	ScriptedAnimation();
 	~ScriptedAnimation(void);
+	// the finished ones leave their memory for the next ones
+	static void *operator new(size_t size);
+	static void operator delete(void *obj, size_t size);
 	ScriptedAnimation(DataStream* stream);
 	void Init();
 	void LoadAnimationFactory(AnimationFactory *af, int gettwin = 0);
@@ -152,7 +155,7 @@ public:
 	/* returns possible twin after altering it to become underlay */
 	ScriptedAnimation *DetachTwin();
 private:
-	void PrepareAnimation(Animation *anim, ieDword Transparency);
+	Animation *GetCycle(AnimationFactory *af, unsigned char cycle, ieDword Transparency);
 	void PreparePalette();
 	bool HandlePhase(Sprite2D *&frame);
 	void GetPaletteCopy();
@@ -0,0 +1,178 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "SearchMap.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace GemRB {
+
+// the half widths of the rows of the cells (i, j) with i, j < extent and i*i+j*j <= r
+static void BuildFootprint(int *rows, unsigned int extent, unsigned int r)
+{
+	unsigned int j;
+	for (j = 0; j < extent; j++) {
+		int width = -1;
+		for (unsigned int i = 0; i < extent && i*i+j*j <= r; i++) {
+			width = (int) i;
+		}
+		if (width < 0) break;
+		rows[j] = width;
+	}
+	rows[j] = -1;
+}
+
+SearchMap::SearchMap(const unsigned short *cells, unsigned int width, unsigned int height, unsigned int maxCircle)
+	: Cells(cells), Width(width), Height(height), MaxCircle(maxCircle)
+{
+	if (MaxCircle < 2) MaxCircle = 2;
+	Footprints.resize((MaxCircle+1) * (MaxCircle+2), -1);
+	BlockFootprints.resize((MaxCircle+1) * (MaxCircle+2), -1);
+	for (unsigned int size = 2; size <= MaxCircle; size++) {
+		// see GetBlocked and Map::BlockSearchMap for the circles
+		unsigned int r = (size-2)*(size-2)+1;
+		if (size == 2) r = 0;
+		BuildFootprint(&Footprints[size * (MaxCircle+2)], size-1, r);
+		BuildFootprint(&BlockFootprints[size * (MaxCircle+2)], size, (size-1)*(size-1)+1);
+	}
+}
+
+const int *SearchMap::GetFootprint(unsigned int size, bool blocking) const
+{
+	if (size > MaxCircle) size = MaxCircle;
+	if (size < 2) size = 2;
+	const std::vector<int> &footprints = blocking ? BlockFootprints : Footprints;
+	return &footprints[size * (MaxCircle+2)];
+}
+
+unsigned int SearchMap::RawCell(unsigned int x, unsigned int y) const
+{
+	if (y>=Height || x>=Width) {
+		return 0;
+	}
+	return Cells[y*Width+x];
+}
+
+unsigned int SearchMap::GetCell(unsigned int x, unsigned int y) const
+{
+	unsigned int ret = RawCell(x, y);
+	if (ret&(PATH_MAP_DOOR_IMPASSABLE|PATH_MAP_ACTOR)) {
+		ret&=~PATH_MAP_PASSABLE;
+	}
+	if (ret&PATH_MAP_DOOR_OPAQUE) {
+		ret=PATH_MAP_SIDEWALL;
+	}
+	return ret;
+}
+
+bool SearchMap::SpanBlocked(int x0, int x1, int y) const
+{
+	// the outside is impassable
+	if (y < 0 || y >= (int) Height || x0 < 0 || x1 >= (int) Width) {
+		return true;
+	}
+	const unsigned short *cell = Cells + y*Width + x0;
+	const unsigned short *end = cell + (x1 - x0) + 1;
+	for (; cell < end; cell++) {
+		if (CellBlocked(*cell)) return true;
+	}
+	return false;
+}
+
+bool SearchMap::GetBlocked(unsigned int px, unsigned int py, unsigned int size) const
+{
+	// We check a circle of radius size-2 around (px,py)
+	// Note that this does not exactly match BG2. BG2's approximations of
+	// these circles are slightly different for sizes 7 and up.
+	const int *rows = GetFootprint(size, false);
+
+	int ppx = (int) (px/16);
+	int ppy = (int) (py/12);
+	for (int j = 0; rows[j] >= 0; j++) {
+		if (SpanBlocked(ppx-rows[j], ppx+rows[j], ppy+j)) return true;
+		if (j && SpanBlocked(ppx-rows[j], ppx+rows[j], ppy-j)) return true;
+	}
+	return false;
+}
+
+bool SearchMap::IsBlocked(unsigned int x, unsigned int y, unsigned int size)
+{
+	return GetBlocked(x*16+8, y*12+6, size);
+}
+
+bool SearchMap::IsVisibleLOS(const Point &s, const Point &d) const
+{
+	return !LineBlocked(s, d, PATH_MAP_SIDEWALL);
+}
+
+bool SearchMap::LineBlocked(const Point &s, const Point &d, unsigned int mask) const
+{
+	Point from(s.x/16, s.y/12);
+	Point to(d.x/16, d.y/12);
+	int steps = std::max(abs(to.x - from.x), abs(to.y - from.y));
+
+	LineWalker line(from, to, steps, true);
+	Point p;
+	while (line.Next(p)) {
+		if (GetCell(p.x, p.y) & mask) {
+			return true;
+		}
+	}
+	return false;
+}
+
+LineWalker::LineWalker(const Point &start, const Point &end, int steps, bool inclusive)
+	: start(start), offsetX(0), offsetY(0), restX(0), restY(0), steps(steps), step(0)
+{
+	int dx = end.x - start.x;
+	int dy = end.y - start.y;
+	signX = dx < 0 ? -1 : 1;
+	signY = dy < 0 ? -1 : 1;
+	lengthX = abs(dx);
+	lengthY = abs(dy);
+	last = inclusive ? steps : steps - 1;
+}
+
+bool LineWalker::Next(Point &p)
+{
+	if (step > last) {
+		return false;
+	}
+	// step the quotients of length*step/steps along instead of dividing
+	if (step) {
+		restX += lengthX;
+		while (restX >= steps) {
+			restX -= steps;
+			offsetX++;
+		}
+		restY += lengthY;
+		while (restY >= steps) {
+			restY -= steps;
+			offsetY++;
+		}
+	}
+	p.x = (short) (start.x + signX * offsetX);
+	p.y = (short) (start.y + signY * offsetY);
+	step++;
+	return true;
+}
+
+}
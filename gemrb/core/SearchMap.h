@@ -0,0 +1,104 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef SEARCHMAP_H
+#define SEARCHMAP_H
+
+#include "exports.h"
+
+#include "PathFinder.h"
+
+#include <vector>
+
+namespace GemRB {
+
+/* walks the points of a straight line in even steps, without allocating
+ * the k-th one is start + (end-start)*k/steps, truncated like the division,
+ * for k from 0 up to steps-1, or up to steps itself if the end is included
+ */
+class GEM_EXPORT LineWalker {
+public:
+	LineWalker(const Point &start, const Point &end, int steps, bool inclusive);
+
+	/* the next point, false past the last one */
+	bool Next(Point &p);
+	/* the points walked so far */
+	int GetStep() const { return step; }
+private:
+	Point start;
+	int signX, signY;
+	int lengthX, lengthY; // the absolute offsets to the end
+	int offsetX, offsetY; // the absolute offsets of the current point
+	int restX, restY; // what the truncation dropped, in steps
+	int steps, last, step;
+};
+
+/* read access to a searchmap (16x12 pixel cells)
+ * the area reads its own live map through this, the path service workers
+ * read their private copies, so both answer the same questions the same way
+ */
+class GEM_EXPORT SearchMap : public PathMapSource {
+public:
+	SearchMap(const unsigned short *cells, unsigned int width, unsigned int height, unsigned int maxCircle);
+	virtual ~SearchMap() {}
+
+	/* the cell flags, with doors and actors folded into the passability */
+	unsigned int GetCell(unsigned int x, unsigned int y) const;
+	/* true if a creature of this size can't stand at the pixel position */
+	bool GetBlocked(unsigned int px, unsigned int py, unsigned int size) const;
+	/* true if no wall is between the two pixel positions */
+	bool IsVisibleLOS(const Point &s, const Point &d) const;
+	/* true if a cell on the line between the two pixel positions has any of
+	 * the GetCell flags in the mask, the cells are walked along the longer axis */
+	bool LineBlocked(const Point &s, const Point &d, unsigned int mask) const;
+	/* PathMapSource, probes the footprint centered on the cell */
+	bool IsBlocked(unsigned int x, unsigned int y, unsigned int size);
+
+	unsigned int GetWidth() const { return Width; }
+	unsigned int GetHeight() const { return Height; }
+	unsigned int GetMaxCircle() const { return MaxCircle; }
+	/* the raw cells, Width*Height of them */
+	const unsigned short *GetCells() const { return Cells; }
+	/* the footprint of a creature of this size (2 to MaxCircle) as the half
+	 * widths of its rows, the first being the center row and the ones above
+	 * and below mirrored, ended by -1; the blocking one is what it stamps
+	 * as an actor, the other what GetBlocked tests */
+	const int *GetFootprint(unsigned int size, bool blocking) const;
+protected:
+	const unsigned short *Cells;
+	unsigned int Width, Height;
+	unsigned int MaxCircle;
+	// MaxCircle+2 rows per size, tested and blocking
+	std::vector<int> Footprints, BlockFootprints;
+
+	/* the stored flags, 0 outside of the map */
+	virtual unsigned int RawCell(unsigned int x, unsigned int y) const;
+	/* true if a creature can't stand on any cell of the row from x0 to x1 */
+	virtual bool SpanBlocked(int x0, int x1, int y) const;
+	/* the GetCell passability of a stored cell, in a single compare */
+	static bool CellBlocked(unsigned int cell)
+	{
+		return (cell & (PATH_MAP_PASSABLE|PATH_MAP_DOOR|PATH_MAP_ACTOR)) != PATH_MAP_PASSABLE;
+	}
+};
+
+}
+
+#endif
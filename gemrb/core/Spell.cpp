@@ -26,6 +26,7 @@
 
 #include "Audio.h"
 #include "Game.h"
+#include "GameData.h"
 #include "Interface.h"
 #include "Projectile.h"
 #include "ProjectileServer.h"
@@ -100,6 +101,16 @@ Spell::Spell(void)
 	FeatureBlockOffset = CastingFeatureOffset = CastingFeatureCount = 0;
 	TimePerLevel = TimeConstant = 0;
 	SpellName = SpellNameIdentified = Flags = SpellType = ExclusionSchool = PriestType = 0;
+	FeaturesLoaded = true;
+}
+
+void Spell::LoadFeatures() const
+{
+	if (FeaturesLoaded) {
+		return;
+	}
+	FeaturesLoaded = true;
+	gamedata->LoadSpellFeatures(const_cast<Spell *>(this));
 }
 
 Spell::~Spell(void)
@@ -193,6 +204,8 @@ EffectQueue *Spell::GetEffectBlock(Scriptable *self, const Point &pos, int block
 	Effect *features;
 	int count;
 
+	LoadFeatures();
+
 	//iwd2 has this hack
 	if (block_index>=0) {
 		if (Flags & SF_SIMPLIFIED_DURATION) {
@@ -337,6 +350,7 @@ static EffectRef fx_damage_ref = { "Damage", -1 };
 bool Spell::ContainsDamageOpcode() const
 {
 	ieDword damage_opcode = EffectQueue::ResolveEffect(fx_damage_ref);
+	LoadFeatures();
 	for (int h=0; h< ExtHeaderCount; h++) {
 		for (int i=0; i< ext_headers[h].FeatureCount; i++) {
 			Effect *fx = ext_headers[h].features+i;
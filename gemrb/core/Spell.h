@@ -178,6 +178,12 @@ public:
 	Projectile *GetProjectile(Scriptable *self, int headerindex, int level, const Point &pos) const;
 	unsigned int GetCastingDistance(Scriptable *Sender) const;
 	bool ContainsDamageOpcode() const;
+	//the feature blocks (casting_features and those of the ext_headers) are only
+	//read when first needed, the spellbooks and the AI selection mostly don't
+	void LoadFeatures() const;
+	void SetFeaturesPending() { FeaturesLoaded = false; }
+private:
+	mutable bool FeaturesLoaded;
 };
 
 }
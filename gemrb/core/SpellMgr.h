@@ -43,7 +43,9 @@ public:
 	SpellMgr(void);
 	virtual ~SpellMgr(void);
 	virtual bool Open(DataStream* stream) = 0;
+	/** reads the header data, the feature blocks are left for GetSpellFeatures */
 	virtual Spell* GetSpell(Spell *spl, bool silent=false) = 0;
+	virtual bool GetSpellFeatures(Spell *spl) = 0;
 };
 
 }
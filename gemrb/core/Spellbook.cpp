@@ -50,6 +50,9 @@ Spellbook::Spellbook()
 		InitializeSpellbook();
 	}
 	spells = new std::vector<CRESpellMemorization*> [NUM_BOOK_TYPES];
+	customspellinfo = false;
+	totalknown = totalcharged = 0;
+	indexvalid = false;
 	sorcerer = 0;
 	if (IWD2Style) {
 		innate = 1<<IE_IWD2_SPELL_INNATE;
@@ -122,7 +125,7 @@ void Spellbook::CopyFrom(const Actor *source)
 		}
 		spells[i].clear();
 	}
-	ClearSpellInfo();
+	SpellsChanged();
 
 	const Spellbook &wikipedia = source->spellbook;
 
@@ -213,6 +216,19 @@ bool Spellbook::HaveSpell(int spellid, ieDword flags)
 }
 bool Spellbook::HaveSpell(int spellid, int type, ieDword flags)
 {
+	UpdateIndex();
+	bool found = false;
+	for (unsigned int i = indexstart[type]; i < indexstart[type+1]; i++) {
+		if (spellindex[i].charged && spellindex[i].spellid == spellid) {
+			found = true;
+			break;
+		}
+	}
+	if (!found || !(flags&HS_DEPLETE)) {
+		return found;
+	}
+
+	//look up the memorization to deplete
 	for (unsigned int j = 0; j < GetSpellLevelCount(type); j++) {
 		CRESpellMemorization* sm = spells[type][j];
 		for (unsigned int k = 0; k < sm->memorized_spells.size(); k++) {
@@ -220,7 +236,7 @@ bool Spellbook::HaveSpell(int spellid, int type, ieDword flags)
 			if (ms->Flags) {
 				if (atoi(ms->SpellResRef+4)==spellid) {
 					if (flags&HS_DEPLETE) {
-						if (DepleteSpell(ms) && (sorcerer & (1<<type) ) ) {
+						if (DepleteSpell(sm, ms) && (sorcerer & (1<<type) ) ) {
 							DepleteLevel (sm, ms->SpellResRef);
 						}
 					}
@@ -235,30 +251,18 @@ bool Spellbook::HaveSpell(int spellid, int type, ieDword flags)
 //returns count of memorized spells of a given name/type
 int Spellbook::CountSpells(const char *resref, unsigned int type, int flag) const
 {
-	int i, max;
 	int count = 0;
 
-	if (type==0xffffffff) {
-		i=0;
-		max = NUM_BOOK_TYPES;
-	} else {
-		i = type;
-		max = i+1;
+	if (!resref[0]) {
+		return 0;
 	}
-
-	while(i < max) {
-		for (unsigned int j = 0; j < spells[i].size(); j++) {
-			CRESpellMemorization* sm = spells[i][j];
-			for (unsigned int k = 0; k < sm->memorized_spells.size(); k++) {
-				CREMemorizedSpell* ms = sm->memorized_spells[k];
-				if (resref[0] && !stricmp(ms->SpellResRef, resref) ) {
-					if (flag || ms->Flags) {
-						count++;
-					}
-				}
-			}
+	UpdateIndex();
+	for (int i = FindIndexEntry(resref); i != -1; i = spellindex[i].next) {
+		const SpellIndexEntry &entry = spellindex[i];
+		if (type != 0xffffffff && entry.Type != type) {
+			continue;
 		}
-		i++;
+		count += flag ? entry.memorized : entry.charged;
 	}
 	return count;
 }
@@ -287,13 +291,10 @@ bool Spellbook::KnowSpell(int spellid) const
 
 bool Spellbook::KnowSpell(int spellid, int type) const
 {
-	for (unsigned int j = 0; j < GetSpellLevelCount(type); j++) {
-		CRESpellMemorization* sm = spells[type][j];
-		for (unsigned int k = 0; k < sm->known_spells.size(); k++) {
-			CREKnownSpell* ks = sm->known_spells[k];
-			if (atoi(ks->SpellResRef+4)==spellid) {
-				return true;
-			}
+	UpdateIndex();
+	for (unsigned int i = indexstart[type]; i < indexstart[type+1]; i++) {
+		if (spellindex[i].known && spellindex[i].spellid == spellid) {
+			return true;
 		}
 	}
 	return false;
@@ -302,16 +303,13 @@ bool Spellbook::KnowSpell(int spellid, int type) const
 //if resref=="" then it is a knownanyspell
 bool Spellbook::KnowSpell(const char *resref) const
 {
-	for (int i = 0; i < NUM_BOOK_TYPES; i++) {
-		for (unsigned int j = 0; j < spells[i].size(); j++) {
-			CRESpellMemorization* sm = spells[i][j];
-			for (unsigned int k = 0; k < sm->known_spells.size(); k++) {
-				CREKnownSpell* ks = sm->known_spells[k];
-				if (resref[0] && stricmp(ks->SpellResRef, resref) ) {
-					continue;
-				}
-				return true;
-			}
+	UpdateIndex();
+	if (!resref[0]) {
+		return totalknown > 0;
+	}
+	for (int i = FindIndexEntry(resref); i != -1; i = spellindex[i].next) {
+		if (spellindex[i].known) {
+			return true;
 		}
 	}
 	return false;
@@ -320,6 +318,23 @@ bool Spellbook::KnowSpell(const char *resref) const
 //if resref=="" then it is a haveanyspell
 bool Spellbook::HaveSpell(const char *resref, ieDword flags)
 {
+	UpdateIndex();
+	bool found = false;
+	if (!resref[0]) {
+		found = totalcharged > 0;
+	} else {
+		for (int i = FindIndexEntry(resref); i != -1; i = spellindex[i].next) {
+			if (spellindex[i].charged) {
+				found = true;
+				break;
+			}
+		}
+	}
+	if (!found || !(flags&HS_DEPLETE)) {
+		return found;
+	}
+
+	//look up the memorization to deplete
 	for (int i = 0; i < NUM_BOOK_TYPES; i++) {
 		for (unsigned int j = 0; j < spells[i].size(); j++) {
 			CRESpellMemorization* sm = spells[i][j];
@@ -330,7 +345,7 @@ bool Spellbook::HaveSpell(const char *resref, ieDword flags)
 						continue;
 					}
 					if (flags&HS_DEPLETE) {
-						if (DepleteSpell(ms) && (sorcerer & (1<<i) ) ) {
+						if (DepleteSpell(sm, ms) && (sorcerer & (1<<i) ) ) {
 							DepleteLevel (sm, ms->SpellResRef);
 						}
 					}
@@ -430,7 +445,7 @@ bool Spellbook::RemoveSpell(CREKnownSpell* spell)
 					delete *ks;
 					(*sm)->known_spells.erase(ks);
 					RemoveMemorization(*sm, ResRef);
-					ClearSpellInfo();
+					SpellsChanged();
 					return true;
 				}
 			}
@@ -476,7 +491,7 @@ void Spellbook::RemoveSpell(int spellid, int type)
 				(*sm)->known_spells.erase(ks);
 				RemoveMemorization(*sm, ResRef);
 				ks--;
-				ClearSpellInfo();
+				SpellsChanged();
 			}
 		}
 	}
@@ -498,7 +513,7 @@ void Spellbook::RemoveSpell(const ieResRef ResRef, bool onlyknown)
 				(*sm)->known_spells.erase(ks);
 				if (!onlyknown) RemoveMemorization(*sm, ResRef);
 				ks--;
-				ClearSpellInfo();
+				SpellsChanged();
 			}
 		}
 	}
@@ -571,6 +586,7 @@ bool Spellbook::AddKnownSpell(CREKnownSpell *spl, int flg)
 	}
 
 	spells[type][level]->known_spells.push_back(spl);
+	SpellsChanged();
 	if (1<<type == innate || 1<<type == 1<<IE_IWD2_SPELL_SONG) {
 		spells[type][level]->SlotCount++;
 		spells[type][level]->SlotCountWithBonus++;
@@ -694,7 +710,7 @@ void Spellbook::BonusSpells(int type, int count, int *bonuses)
 	int level = GetSpellLevelCount(type);
 	if (level>count) level=count;
 	for (int i = 0; i < level; i++) {
-		CRESpellMemorization* sm = GetSpellMemorization(type, i);
+		CRESpellMemorization* sm = spells[type][i];
 		// don't give access to new spell levels through these boni
 		if (sm->SlotCountWithBonus) {
 			sm->SlotCountWithBonus+=bonuses[i];
@@ -711,13 +727,20 @@ void Spellbook::ClearBonus()
 	for (type = 0; type < NUM_BOOK_TYPES; type++) {
 		int level = GetSpellLevelCount(type);
 		for (int i = 0; i < level; i++) {
-			CRESpellMemorization* sm = GetSpellMemorization(type, i);
+			CRESpellMemorization* sm = spells[type][i];
 			sm->SlotCountWithBonus=sm->SlotCount;
 		}
 	}
 }
 
+// the caller may change the spell lists of the page
 CRESpellMemorization *Spellbook::GetSpellMemorization(unsigned int type, unsigned int level)
+{
+	SpellsChanged();
+	return GetSpellPage(type, level);
+}
+
+CRESpellMemorization *Spellbook::GetSpellPage(unsigned int type, unsigned int level)
 {
 	if (type >= (unsigned int)NUM_BOOK_TYPES)
 		return NULL;
@@ -750,7 +773,7 @@ void Spellbook::SetMemorizableSpellsCount(int Value, int type, unsigned int leve
 		return;
 	}
 
-	CRESpellMemorization* sm = GetSpellMemorization(type, level);
+	CRESpellMemorization* sm = GetSpellPage(type, level);
 	if (bonus) {
 		if (!Value) {
 			Value=sm->SlotCountWithBonus;
@@ -791,7 +814,7 @@ bool Spellbook::MemorizeSpell(CREKnownSpell* spell, bool usable)
 	mem_spl->Flags = usable ? 1 : 0; // FIXME: is it all it's used for?
 
 	sm->memorized_spells.push_back( mem_spl );
-	ClearSpellInfo();
+	SpellsChanged();
 	return true;
 }
 
@@ -805,7 +828,7 @@ bool Spellbook::UnmemorizeSpell(CREMemorizedSpell* spell)
 				if (*s == spell) {
 					delete *s;
 					(*sm)->memorized_spells.erase( s );
-					ClearSpellInfo();
+					SpellsChanged();
 					return true;
 				}
 			}
@@ -829,12 +852,15 @@ bool Spellbook::UnmemorizeSpell(const ieResRef ResRef, bool deplete, bool onlyde
 					continue;
 				}
 				if (deplete) {
-					(*s)->Flags = 0;
+					if ((*s)->Flags) {
+						(*s)->Flags = 0;
+						UpdateCharges(*sm, (*s)->SpellResRef, -1);
+					}
 				} else {
 					delete *s;
 					(*sm)->memorized_spells.erase( s );
+					SpellsChanged();
 				}
-				ClearSpellInfo();
 				return true;
 			}
 		}
@@ -883,6 +909,7 @@ void Spellbook::CreateSorcererMemory(int type)
 			delete sm->memorized_spells[cnt];
 		}
 		sm->memorized_spells.clear();
+		SpellsChanged();
 		for (unsigned int k = 0; k < sm->known_spells.size(); k++) {
 			CREKnownSpell *ck = sm->known_spells[k];
 			cnt = sm->SlotCountWithBonus;
@@ -906,8 +933,13 @@ void Spellbook::ChargeAllSpells()
 		for (unsigned int j = 0; j < spells[i].size(); j++) {
 			CRESpellMemorization* sm = spells[i][j];
 
-			for (unsigned int k = 0; k < sm->memorized_spells.size(); k++)
-				ChargeSpell( sm->memorized_spells[k] );
+			for (unsigned int k = 0; k < sm->memorized_spells.size(); k++) {
+				CREMemorizedSpell* ms = sm->memorized_spells[k];
+				if (!ms->Flags) {
+					ms->Flags = 1;
+					UpdateCharges(sm, ms->SpellResRef, 1);
+				}
+			}
 		}
 	}
 }
@@ -924,7 +956,7 @@ bool Spellbook::DepleteSpell(int type)
 		CRESpellMemorization* sm = spells[type][j];
 
 		for (unsigned int k = 0; k < sm->memorized_spells.size(); k++) {
-			if (DepleteSpell( sm->memorized_spells[k] )) {
+			if (DepleteSpell( sm, sm->memorized_spells[k] )) {
 				if (sorcerer & (1<<type) ) {
 					DepleteLevel (sm, sm->memorized_spells[k]->SpellResRef);
 				}
@@ -946,6 +978,7 @@ void Spellbook::DepleteLevel(CRESpellMemorization* sm, const ieResRef except)
 		if (cms->Flags && strncmp(last,cms->SpellResRef,8) && strncmp(except,cms->SpellResRef,8)) {
 			memcpy(last, cms->SpellResRef, sizeof(ieResRef) );
 			cms->Flags=0;
+			UpdateCharges(sm, cms->SpellResRef, -1);
 /*
 			delete cms;
 			sm->memorized_spells.erase(sm->memorized_spells.begin()+i);
@@ -972,7 +1005,7 @@ bool Spellbook::DepleteSpell(int type, unsigned int page, unsigned int slot)
 	}
 
 	CREMemorizedSpell* cms = sm->memorized_spells[slot];
-	ret = DepleteSpell(cms);
+	ret = DepleteSpell(sm, cms);
 	if (ret && (sorcerer & (1<<type) ) ) {
 		DepleteLevel (sm, cms->SpellResRef);
 	}
@@ -983,15 +1016,16 @@ bool Spellbook::DepleteSpell(int type, unsigned int page, unsigned int slot)
 bool Spellbook::ChargeSpell(CREMemorizedSpell* spl)
 {
 	spl->Flags = 1;
-	ClearSpellInfo();
+	// we don't know its page
+	SpellsChanged();
 	return true;
 }
 
-bool Spellbook::DepleteSpell(CREMemorizedSpell* spl)
+bool Spellbook::DepleteSpell(CRESpellMemorization* sm, CREMemorizedSpell* spl)
 {
 	if (spl->Flags) {
 		spl->Flags = 0;
-		ClearSpellInfo();
+		UpdateCharges(sm, spl->SpellResRef, -1);
 		return true;
 	}
 	return false;
@@ -1004,6 +1038,141 @@ void Spellbook::ClearSpellInfo()
 		delete spellinfo[i];
 	}
 	spellinfo.clear();
+	customspellinfo = false;
+}
+
+void Spellbook::SpellsChanged()
+{
+	indexvalid = false;
+	ClearSpellInfo();
+}
+
+int Spellbook::FindIndexEntry(const char *resref) const
+{
+	const int *first = indexbyname.get(resref);
+	return first ? *first : -1;
+}
+
+void Spellbook::UpdateIndex() const
+{
+	if (indexvalid) {
+		return;
+	}
+	indexvalid = true;
+
+	spellindex.clear();
+	indexstart.assign(NUM_BOOK_TYPES+1, 0);
+	totalknown = totalcharged = 0;
+
+	unsigned int count = 0;
+	for (int i = 0; i < NUM_BOOK_TYPES; i++) {
+		for (unsigned int j = 0; j < spells[i].size(); j++) {
+			count += spells[i][j]->known_spells.size() + spells[i][j]->memorized_spells.size();
+		}
+	}
+
+	for (int i = 0; i < NUM_BOOK_TYPES; i++) {
+		indexstart[i] = spellindex.size();
+		for (unsigned int j = 0; j < spells[i].size(); j++) {
+			const CRESpellMemorization* sm = spells[i][j];
+			size_t first = spellindex.size();
+			size_t known = sm->known_spells.size();
+			size_t total = known + sm->memorized_spells.size();
+
+			for (size_t k = 0; k < total; k++) {
+				const char *name;
+				if (k < known) {
+					name = sm->known_spells[k]->SpellResRef;
+				} else {
+					name = sm->memorized_spells[k-known]->SpellResRef;
+				}
+
+				size_t e;
+				for (e = first; e < spellindex.size(); e++) {
+					if (!strnicmp(spellindex[e].SpellResRef, name, sizeof(ieResRef))) {
+						break;
+					}
+				}
+				if (e == spellindex.size()) {
+					SpellIndexEntry entry;
+					CopyResRef(entry.SpellResRef, name);
+					entry.spellid = atoi(name+4);
+					entry.Type = sm->Type;
+					entry.Level = sm->Level;
+					entry.known = entry.memorized = entry.charged = 0;
+					entry.next = -1;
+					spellindex.push_back(entry);
+				}
+
+				SpellIndexEntry &entry = spellindex[e];
+				if (k < known) {
+					entry.known++;
+					totalknown++;
+				} else {
+					entry.memorized++;
+					if (sm->memorized_spells[k-known]->Flags) {
+						entry.charged++;
+						totalcharged++;
+					}
+				}
+			}
+		}
+	}
+	indexstart[NUM_BOOK_TYPES] = spellindex.size();
+
+	// chain the entries of the same resref, the first one is hashed
+	indexbyname.init(count + 16, count + 16);
+	size_t i = spellindex.size();
+	while (i--) {
+		const int *next = indexbyname.get(spellindex[i].SpellResRef);
+		spellindex[i].next = next ? *next : -1;
+		indexbyname.set(spellindex[i].SpellResRef, (int) i);
+	}
+}
+
+void Spellbook::UpdateCharges(CRESpellMemorization* sm, const ieResRef name, int diff)
+{
+	if (indexvalid) {
+		int i = FindIndexEntry(name);
+		while (i != -1 && (spellindex[i].Type != sm->Type || spellindex[i].Level != sm->Level)) {
+			i = spellindex[i].next;
+		}
+		if (i == -1) {
+			indexvalid = false;
+		} else {
+			spellindex[i].charged += diff;
+			totalcharged += diff;
+		}
+	}
+
+	// a new entry would have to be sorted in and custom lists aren't ours to update
+	if (diff > 0 || customspellinfo) {
+		ClearSpellInfo();
+		return;
+	}
+	SpellExtHeader *seh = FindSpellInfo(sm->Level, sm->Type, name);
+	if (!seh) {
+		return;
+	}
+	if (--seh->count) {
+		// the first charged memorization may have changed
+		for (unsigned int k = 0; k < sm->memorized_spells.size(); k++) {
+			CREMemorizedSpell *cms = sm->memorized_spells[k];
+			if (cms->Flags && !strnicmp(cms->SpellResRef, name, sizeof(ieResRef))) {
+				seh->slot = k;
+				break;
+			}
+		}
+		return;
+	}
+	std::vector<SpellExtHeader*>::iterator it;
+	for (it = spellinfo.begin(); it != spellinfo.end(); it++) {
+		if (*it == seh) {
+			spellinfo.erase(it);
+			break;
+		}
+	}
+	delete seh;
 }
 
 bool Spellbook::GetSpellInfo(SpellExtHeader *array, int type, int startindex, int count)
@@ -1134,6 +1303,7 @@ void Spellbook::AddSpellInfo(unsigned int sm_level, unsigned int sm_type, const
 void Spellbook::SetCustomSpellInfo(ieResRef *data, ieResRef spell, int type)
 {
 	ClearSpellInfo();
+	customspellinfo = true;
 	if (data) {
 		for(int i = 0; i<type;i++) {
 			AddSpellInfo(0,0,data[i],-1);
@@ -1185,7 +1355,7 @@ void Spellbook::dump() const
 {
 	StringBuffer buffer;
 	dump(buffer);
-	Log(DEBUG, "Spellbook", buffer);
+	LogDebug("Spellbook", buffer);
 }
 
 void Spellbook::dump(StringBuffer& buffer) const
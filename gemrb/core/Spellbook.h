@@ -31,6 +31,7 @@
 #include "exports.h"
 #include "ie_types.h"
 #include "win32def.h"
+#include "StringMap.h"
 
 #include <vector>
 
@@ -108,6 +109,18 @@ struct CRESpellMemorization {
 	std::vector<CREMemorizedSpell*> memorized_spells;
 };
 
+// flat summary of a spell on a spellbook page, for the frequent queries
+struct SpellIndexEntry {
+	ieResRef SpellResRef;
+	int spellid; // the numeric part of the resref
+	ieWord Type;
+	ieWord Level;
+	ieWord known;
+	ieWord memorized;
+	ieWord charged;
+	int next; // next entry of the same resref or -1
+};
+
 struct SpellExtHeader {
 	ieDword level;
 	ieDword count;
@@ -136,11 +149,32 @@ class GEM_EXPORT Spellbook {
 private:
 	std::vector<CRESpellMemorization*> *spells;
 	std::vector<SpellExtHeader*> spellinfo;
+	// spellinfo was set up by SetCustomSpellInfo
+	bool customspellinfo;
 	int sorcerer;
 	int innate;
 
+	// one entry for each spell of each page, ordered by type and level
+	mutable std::vector<SpellIndexEntry> spellindex;
+	// the first entry of each type, NUM_BOOK_TYPES+1 elements
+	mutable std::vector<unsigned int> indexstart;
+	// resref -> its first entry
+	mutable StringHashMap<int> indexbyname;
+	mutable unsigned int totalknown, totalcharged;
+	mutable bool indexvalid;
+
+	/** rebuilds the spell index if the book changed since */
+	void UpdateIndex() const;
+	/** returns the first index entry of a resref or -1 */
+	int FindIndexEntry(const char *resref) const;
+	/** drops the spell index and the spellinfo list after the pages changed */
+	void SpellsChanged();
+	/** keeps the index and spellinfo up to date when a memorized spell is (de)charged */
+	void UpdateCharges(CRESpellMemorization* sm, const ieResRef name, int diff);
 	/** Sets spell from memorized as 'already-cast' */
-	bool DepleteSpell(CREMemorizedSpell* spl);
+	bool DepleteSpell(CRESpellMemorization* sm, CREMemorizedSpell* spl);
+	/** returns a page, creating it if needed */
+	CRESpellMemorization *GetSpellPage(unsigned int type, unsigned int level);
 	/** Depletes a sorcerer type spellpage by one */
 	void DepleteLevel(CRESpellMemorization* sm, const ieResRef except);
 	/** Adds a single spell to the spell info list */
@@ -36,6 +36,7 @@ Sprite2D::Sprite2D(int Width, int Height, int Bpp, const void* pixels)
 	YPos = 0;
 	RefCount = 1;
 	renderFlags = 0;
+	rleRows = NULL;
 }
 
 Sprite2D::Sprite2D(const Sprite2D &obj)
@@ -43,6 +44,7 @@ Sprite2D::Sprite2D(const Sprite2D &obj)
 	BAM = false;
 	RLE = false;
 	RefCount = 1;
+	rleRows = NULL;
 
 	XPos = obj.XPos;
 	YPos = obj.YPos;
@@ -57,6 +59,7 @@ Sprite2D::Sprite2D(const Sprite2D &obj)
 
 Sprite2D::~Sprite2D()
 {
+	free(rleRows);
 	if (freePixels) {
 		// FIXME: casting away const.
 		free((void*)pixels);
@@ -69,6 +72,35 @@ bool Sprite2D::IsPixelTransparent(unsigned short x, unsigned short y) const
 	return GetPixel(x, y).a == 0;
 }
 
+const ieDword* Sprite2D::GetRLERows() const
+{
+	if (!RLE || !pixels || Height <= 0) return NULL;
+	if (rleRows) return rleRows;
+
+	const ieByte* start = (const ieByte*) pixels;
+	const ieByte* rle = start;
+	ieByte colorkey = (ieByte) GetColorKey();
+	ieDword* rows = (ieDword*) malloc(Height * sizeof(ieDword));
+	int pixel = 0;
+	for (int y = 0; y < Height; y++) {
+		int rowstart = y * Width;
+		while (pixel < rowstart) {
+			if (*rle++ == colorkey)
+				pixel += (*rle++) + 1;
+			else
+				pixel++;
+		}
+		// runs are at most 256 long, so what spills over fits the low byte
+		if (rle - start >= 0x1000000) {
+			free(rows);
+			return NULL;
+		}
+		rows[y] = ((ieDword) (rle - start) << 8) | (ieDword) (pixel - rowstart);
+	}
+	rleRows = rows;
+	return rleRows;
+}
+
 void Sprite2D::release()
 {
 	assert(RefCount > 0);
@@ -53,6 +53,8 @@ public:
 	static const TypeID ID;
 private:
 	int RefCount;
+	// made on the first partial blit, see GetRLERows
+	mutable ieDword* rleRows;
 protected:
 	bool freePixels;
 public:
@@ -69,6 +71,10 @@ public:
 	virtual ~Sprite2D();
 
 	bool IsPixelTransparent(unsigned short x, unsigned short y) const;
+	/* GetRLERows: for RLE sprites where each row starts in the data, so blits can jump in.
+	 * Every entry is the offset of the first code of the row, shifted left by 8,
+	 * with the pixels the run of the row before already covers in the low byte. */
+	const ieDword* GetRLERows() const;
 	virtual Palette *GetPalette() const = 0;
 	virtual const Color* GetPaletteColors() const = 0;
 	virtual void SetPalette(Palette *pal) = 0;
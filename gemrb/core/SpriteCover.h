@@ -31,6 +31,7 @@ public:
 	int worldx, worldy; // world coords for which the cover has been computed
 	int XPos, YPos, Width, Height;
 	int flags;
+	unsigned int wallCount; // the walls drawn into it, an empty cover can just be moved
 	SpriteCover(void);
 	~SpriteCover(void);
 
@@ -0,0 +1,152 @@
+/* GemRB - Infinity Engine Emulator
+* Copyright (C) 2003-2005 The GemRB Project
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+*
+*/
+
+#include "StartupTimeline.h"
+
+#include "win32def.h"
+
+#include "ResourceStats.h"
+#include "System/FileStream.h"
+#include "System/StringBuffer.h"
+#include "System/Thread.h"
+
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+struct StartupPhase {
+	std::string name;
+	unsigned __int64 start, time;
+	unsigned __int64 bytes;
+	unsigned long resources;
+};
+
+bool StartupTimeline::recording = false;
+
+// only touched by the owner thread
+static ThreadID owner;
+static std::vector<StartupPhase> phases;
+static unsigned __int64 started;
+
+static bool IsOwner()
+{
+	return Thread::IsSameThread(owner, Thread::GetCurrentID());
+}
+
+static void EndPhase(unsigned __int64 now)
+{
+	if (phases.size()) {
+		StartupPhase &last = phases.back();
+		last.time = now - last.start;
+	}
+}
+
+void StartupTimeline::Begin()
+{
+	owner = Thread::GetCurrentID();
+	phases.clear();
+	started = ResourceStats::Now();
+	recording = true;
+}
+
+void StartupTimeline::Phase(const char *name)
+{
+	if (!recording || !IsOwner()) {
+		return;
+	}
+	unsigned __int64 now = ResourceStats::Now();
+	EndPhase(now);
+
+	StartupPhase phase;
+	phase.name = name;
+	phase.start = now;
+	phase.time = 0;
+	phase.bytes = 0;
+	phase.resources = 0;
+	phases.push_back(phase);
+}
+
+void StartupTimeline::End()
+{
+	if (!recording || !IsOwner()) {
+		return;
+	}
+	EndPhase(ResourceStats::Now());
+	recording = false;
+}
+
+void StartupTimeline::AddRead(unsigned long bytes)
+{
+	if (phases.size() && IsOwner()) {
+		phases.back().bytes += bytes;
+	}
+}
+
+void StartupTimeline::AddResource()
+{
+	if (phases.size() && IsOwner()) {
+		phases.back().resources++;
+	}
+}
+
+void StartupTimeline::Dump()
+{
+	unsigned __int64 total = 0, bytes = 0;
+	unsigned long resources = 0;
+
+	StringBuffer buffer;
+	buffer.appendFormatted("Startup timeline (times in ms):\n");
+	buffer.appendFormatted("%-40s %10s %12s %10s", "", "time", "bytes read", "resources");
+	for (size_t i = 0; i < phases.size(); i++) {
+		const StartupPhase &phase = phases[i];
+		buffer.appendFormatted("\n%-40.40s %10.1f %12.0f %10lu", phase.name.c_str(),
+			phase.time / 1000.0, (double) phase.bytes, phase.resources);
+		total += phase.time;
+		bytes += phase.bytes;
+		resources += phase.resources;
+	}
+	buffer.appendFormatted("\n%-40s %10.1f %12.0f %10lu", "total", total / 1000.0, (double) bytes, resources);
+	Log(MESSAGE, "StartupTimeline", buffer);
+}
+
+bool StartupTimeline::WriteJSON(const char *path)
+{
+	StringBuffer buffer;
+	buffer.append("{\n\t\"version\": \"" VERSION_GEMRB "\",\n\t\"phases\": [");
+	for (size_t i = 0; i < phases.size(); i++) {
+		const StartupPhase &phase = phases[i];
+		// the names are our own string literals, nothing to escape
+		buffer.appendFormatted("%s\n\t\t{\"name\": \"%s\", \"start_us\": %.0f, \"time_us\": %.0f, \"bytes\": %.0f, \"resources\": %lu}",
+			i ? "," : "", phase.name.c_str(), (double) (phase.start - started), (double) phase.time,
+			(double) phase.bytes, phase.resources);
+	}
+	buffer.append("\n\t]\n}\n");
+
+	FileStream out;
+	const std::string &json = buffer.get();
+	if (!out.Create(path) || out.Write(json.c_str(), (unsigned int) json.size()) != (int) json.size()) {
+		Log(ERROR, "StartupTimeline", "Cannot write %s.", path);
+		return false;
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,63 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include "exports.h"
+#include "globals.h"
+
+namespace GemRB {
+
+/* The phases of the engine initialization, each with its wall time, the
+ * bytes read from files and the resources found while it ran
+ * Only the thread that began the timeline is counted, so the reads of the
+ * worker threads started meanwhile don't blur the phases.
+ */
+class GEM_EXPORT StartupTimeline {
+public:
+	/** starts the timeline on the calling thread */
+	static void Begin();
+	/** ends the current phase, if any, and starts the named one */
+	static void Phase(const char *name);
+	/** ends the last phase and stops counting */
+	static void End();
+	/** prints the phases to the log */
+	static void Dump();
+	/** writes the phases as JSON, returns false if the file can't be written */
+	static bool WriteJSON(const char *path);
+
+	static void CountRead(unsigned long bytes)
+	{
+		if (recording) AddRead(bytes);
+	}
+	static void CountResource()
+	{
+		if (recording) AddResource();
+	}
+private:
+	static bool recording;
+	static void AddRead(unsigned long bytes);
+	static void AddResource();
+};
+
+}
+
+#endif
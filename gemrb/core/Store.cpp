@@ -29,6 +29,7 @@
 #include "GameData.h"
 #include "Interface.h"
 #include "Item.h"
+#include "Variables.h"
 #include "GameScript/GameScript.h"
 
 namespace GemRB {
@@ -51,6 +52,8 @@ Store::Store(void)
 	SellMarkup = BuyMarkup = DepreciationRate = StealFailureChance = 0;
 	PurchasedCategoriesOffset = DrinksOffset = CuresOffset = ItemsOffset = 0;
 	PurchasedCategoriesCount = DrinksCount = CuresCount = ItemsCount = 0;
+	availableValid = false;
+	availableShopper = availableChanges = availableGold = availableTime = 0;
 }
 
 Store::~Store(void)
@@ -83,18 +86,38 @@ bool Store::IsItemAvailable(unsigned int slot) const
 	return true;
 }
 
-int Store::GetRealStockSize()
+//the triggers mostly check variables, the shopper or the gold,
+//the stock only changes here, so it isn't evaluated for every row
+void Store::UpdateAvailable()
 {
-	int count=ItemsCount;
-	if (!HasTriggers) {
-		return count;
+	Game *game = core->GetGame();
+	Scriptable *shopper = game->GetSelectedPCSingle(false);
+	ieDword shopperID = shopper ? shopper->GetGlobalID() : 0;
+	if (availableValid && availableShopper == shopperID && availableChanges == Variables::GetChangeCount()
+		&& availableGold == game->PartyGold && availableTime == game->GameTime) {
+		return;
 	}
+
+	availableSlots.clear();
 	for (unsigned int i=0;i<ItemsCount;i++) {
-		if (!IsItemAvailable(i) ) {
-			count--;
+		if (IsItemAvailable(i)) {
+			availableSlots.push_back(i);
 		}
 	}
-	return count;
+	availableValid = true;
+	availableShopper = shopperID;
+	availableChanges = Variables::GetChangeCount();
+	availableGold = game->PartyGold;
+	availableTime = game->GameTime;
+}
+
+int Store::GetRealStockSize()
+{
+	if (!HasTriggers) {
+		return ItemsCount;
+	}
+	UpdateAvailable();
+	return (int) availableSlots.size();
 }
 
 bool Store::IsBag() const
@@ -182,15 +205,11 @@ STOItem *Store::GetItem(unsigned int idx, bool usetrigger)
 		return items[idx];
 	}
 
-	for (unsigned int i=0;i<ItemsCount;i++) {
-		if (IsItemAvailable(i)) {
-			if (!idx) {
-				return items[i];
-			}
-			idx--;
-		}
+	UpdateAvailable();
+	if (idx >= availableSlots.size()) {
+		return NULL;
 	}
-	return NULL;
+	return items[availableSlots[idx]];
 }
 
 unsigned int Store::FindItem(const ieResRef itemname, bool usetrigger) const
@@ -322,6 +341,7 @@ void Store::AddItem(CREItem *item)
 	}
 	items.push_back (temp );
 	ItemsCount++;
+	availableValid = false;
 }
 
 void Store::RemoveItem( STOItem *itm )
@@ -331,6 +351,7 @@ void Store::RemoveItem( STOItem *itm )
 		if (items[i]==itm) {
 			items.erase(items.begin()+i);
 			ItemsCount--;
+			availableValid = false;
 			break;
 		}
 	}
@@ -181,6 +181,18 @@ private:
 	/** Finds a mergeable item in the stock, if exact is set, it checks for usage counts too */
 	STOItem *FindItem(CREItem *item, bool exact);
 	bool IsItemAvailable(unsigned int slot) const;
+	/** Evaluates the triggers again, if the stock or what they see changed */
+	void UpdateAvailable();
+
+	//the slots of the items the triggers allow, in order, the GUI asks
+	//for them by their position among these, one row after the other
+	std::vector<unsigned int> availableSlots;
+	//what they were evaluated with
+	bool availableValid;
+	ieDword availableShopper;
+	unsigned int availableChanges;
+	ieDword availableGold;
+	ieDword availableTime;
 };
 
 }
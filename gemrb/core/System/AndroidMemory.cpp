@@ -0,0 +1,49 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+// the onTrimMemory levels of the activity, SDL only passes on onLowMemory
+
+// the autotools build lists it everywhere, it only does something on Android
+#ifdef ANDROID
+
+#include "Interface.h"
+#include "MemoryStats.h"
+
+#include <jni.h>
+
+// android.content.ComponentCallbacks2
+#define TRIM_MEMORY_RUNNING_CRITICAL 15
+#define TRIM_MEMORY_COMPLETE 80
+
+using namespace GemRB;
+
+extern "C" JNIEXPORT void JNICALL Java_net_sourceforge_gemrb_GemRB_nativeTrimMemory(JNIEnv* /*env*/, jclass /*cls*/, jint level)
+{
+	if (!core) {
+		return;
+	}
+	// the in between background levels only mean we are further down
+	// the list of what gets killed, the caches are enough for them
+	if (level == TRIM_MEMORY_RUNNING_CRITICAL || level >= TRIM_MEMORY_COMPLETE) {
+		core->RequestTrimMemory(TRIM_COMPLETE);
+	} else {
+		core->RequestTrimMemory(TRIM_MODERATE);
+	}
+}
+
+#endif
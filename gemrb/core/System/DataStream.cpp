@@ -183,6 +183,50 @@ int DataStream::ReadResRef(ieResRef dest)
 	return len;
 }
 
+// plain loops, so the compiler can vectorize them
+static void SwapWords(ieWord *words, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		words[i] = (ieWord) ((words[i] >> 8) | (words[i] << 8));
+	}
+}
+
+static void SwapDwords(ieDword *dwords, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		ieDword v = dwords[i];
+		dwords[i] = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+	}
+}
+
+int DataStream::ReadWords(ieWord *dest, unsigned int count)
+{
+	int len = Read(dest, count * sizeof(ieWord));
+	if (EndianSwitch && len > 0) {
+		SwapWords(dest, count);
+	}
+	return len;
+}
+
+int DataStream::ReadDwords(ieDword *dest, unsigned int count)
+{
+	int len = Read(dest, count * sizeof(ieDword));
+	if (EndianSwitch && len > 0) {
+		SwapDwords(dest, count);
+	}
+	return len;
+}
+
+int DataStream::ReadPoints(Point *dest, unsigned int count)
+{
+	// the files store the coordinates like Point, as two words
+	int len = Read(dest, count * sizeof(Point));
+	if (EndianSwitch && len > 0) {
+		SwapWords((ieWord *) dest, count * 2);
+	}
+	return len;
+}
+
 int DataStream::WriteResRef(const ieResRef src)
 {
 	return Write( src, 8);
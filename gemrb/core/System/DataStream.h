@@ -58,6 +58,12 @@ public:
 	int ReadWordSigned (ieWordSigned* dest);
 	int ReadDword(ieDword* dest);
 	int ReadResRef(ieResRef dest);
+	/** Bulk readers, they read count elements in one go and return the
+	 * bytes read, like Read */
+	int ReadWords(ieWord* dest, unsigned int count);
+	int ReadDwords(ieDword* dest, unsigned int count);
+	/** reads count x, y pairs of words */
+	int ReadPoints(Point* dest, unsigned int count);
 	virtual int Write(const void* src, unsigned int len) = 0;
 	int WriteWord(const ieWord* src);
 	int WriteDword(const ieDword* src);
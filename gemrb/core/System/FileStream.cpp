@@ -23,6 +23,7 @@
 #include "win32def.h"
 
 #include "Interface.h"
+#include "StartupTimeline.h"
 
 namespace GemRB {
 
@@ -30,6 +31,9 @@ namespace GemRB {
 int FileStream::FileStreamPtrCount = 0;
 #endif
 
+// the importers read a field at a time, so serve them from memory
+unsigned int FileStream::ReadAhead = 16 * 1024;
+
 #ifdef WIN32
 struct FileStream::File {
 private:
@@ -148,6 +152,10 @@ FileStream::FileStream(void)
 	opened = false;
 	created = false;
 	str = new File();
+	window = 0;
+	buffer = NULL;
+	bufferStart = bufferFill = 0;
+	filePos = realPos = 0;
 }
 
 DataStream* FileStream::Clone()
@@ -171,6 +179,16 @@ void FileStream::Close()
 	}
 	opened = false;
 	created = false;
+	free(buffer);
+	window = 0;
+	buffer = NULL;
+	bufferStart = bufferFill = 0;
+	filePos = realPos = 0;
+}
+
+void FileStream::SetReadAhead(int kilobytes)
+{
+	ReadAhead = kilobytes > 0 ? kilobytes * 1024 : 0;
 }
 
 void FileStream::FindLength()
@@ -196,6 +214,7 @@ bool FileStream::Open(const char* fname)
 	opened = true;
 	created = false;
 	FindLength();
+	window = ReadAhead;
 	ExtractFileFromPath( filename, fname );
 	strlcpy( originalfile, fname, _MAX_PATH);
 	return true;
@@ -263,7 +282,12 @@ int FileStream::Read(void* dest, unsigned int length)
 	if (Pos+length>size ) {
 		return GEM_ERROR;
 	}
-	size_t c = str->Read(dest, length);
+	size_t c;
+	if (IsBuffered()) {
+		c = ReadBuffered((char *) dest, length);
+	} else {
+		c = str->Read(dest, length);
+	}
 	if (c != length) {
 		return GEM_ERROR;
 	}
@@ -271,9 +295,74 @@ int FileStream::Read(void* dest, unsigned int length)
 		ReadDecrypted( dest, c );
 	}
 	Pos += c;
+	StartupTimeline::CountRead(c);
 	return c;
 }
 
+// positions are those of the file, the encryption header included
+// when buffered, the file itself is only moved by the next read that needs it
+void FileStream::MoveTo(unsigned long pos)
+{
+	if (IsBuffered()) {
+		filePos = pos;
+	} else {
+		str->SeekStart(pos);
+	}
+}
+
+void FileStream::MoveBy(int offset)
+{
+	if (IsBuffered()) {
+		filePos += offset;
+	} else {
+		str->SeekCurrent(offset);
+	}
+}
+
+void FileStream::Sync()
+{
+	if (realPos != filePos) {
+		str->SeekStart(filePos);
+		realPos = filePos;
+	}
+}
+
+size_t FileStream::ReadBuffered(char* dest, size_t length)
+{
+	size_t done = 0;
+	while (done < length) {
+		if (filePos >= bufferStart && filePos < bufferStart + bufferFill) {
+			size_t c = bufferStart + bufferFill - filePos;
+			if (c > length - done) {
+				c = length - done;
+			}
+			memcpy(dest + done, buffer + (filePos - bufferStart), c);
+			filePos += c;
+			done += c;
+			continue;
+		}
+		Sync();
+		// no point in copying big reads twice
+		if (length - done >= window) {
+			size_t c = str->Read(dest + done, length - done);
+			filePos += c;
+			realPos = filePos;
+			done += c;
+			break;
+		}
+		if (!buffer) {
+			buffer = (char *) malloc(window);
+		}
+		bufferStart = filePos;
+		bufferFill = str->Read(buffer, window);
+		realPos = filePos + bufferFill;
+		if (!bufferFill) {
+			break;
+		}
+	}
+	return done;
+}
+
 int FileStream::Write(const void* src, unsigned int length)
 {
 	if (!created) {
@@ -299,16 +388,16 @@ int FileStream::Seek(int newpos, int type)
 	}
 	switch (type) {
 		case GEM_STREAM_END:
-			str->SeekStart(size - newpos);
+			MoveTo(size - newpos);
 			Pos = size - newpos;
 			break;
 		case GEM_CURRENT_POS:
-			str->SeekCurrent(newpos);
+			MoveBy(newpos);
 			Pos += newpos;
 			break;
 
 		case GEM_STREAM_START:
-			str->SeekStart(newpos);
+			MoveTo(newpos);
 			Pos = newpos;
 			break;
 
@@ -48,6 +48,13 @@ private:
 	struct File;
 	File* str;
 	bool opened, created;
+	// read-ahead window of files opened for reading
+	static unsigned int ReadAhead;
+	unsigned int window;
+	char *buffer;
+	unsigned long bufferStart, bufferFill;
+	// where the next read starts and where the file really is
+	unsigned long filePos, realPos;
 public:
 	FileStream(void);
 	~FileStream(void);
@@ -63,6 +70,8 @@ public:
 	int Seek(int pos, int startpos);
 
 	void Close();
+	/** Sets the read-ahead window in kilobytes, 0 reads straight from the file. */
+	static void SetReadAhead(int kilobytes);
 public:
 	/** Opens the specifed file.
 	 *
@@ -71,6 +80,11 @@ public:
 	static FileStream* OpenFile(const char* filename);
 private:
 	void FindLength();
+	bool IsBuffered() const { return window != 0; }
+	size_t ReadBuffered(char* dest, size_t length);
+	void MoveTo(unsigned long pos);
+	void MoveBy(int offset);
+	void Sync();
 };
 
 }
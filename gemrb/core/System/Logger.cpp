@@ -42,6 +42,7 @@ bool Logger::SetLogLevel(log_level level)
 {
 	if (level > INTERNAL) {
 		myLevel = level;
+		UpdateLogLevel();
 		static const char* fmt = "Log Level set to %d";
 		char msg[25];
 		snprintf(msg, 25, fmt, level);
@@ -59,7 +59,11 @@ public:
 	virtual void destroy();
 
 	bool SetLogLevel(log_level);
+	log_level GetLogLevel() const { return myLevel; }
 	void log(log_level, const char* owner, const char* message, log_color color);
+	/** false for the loggers that have to stay on the main thread,
+	 * they only get its records and the log thread leaves them alone */
+	virtual bool CanDefer() const { return true; }
 protected:
 	virtual void LogInternal(log_level, const char*, const char*, log_color)=0;
 };
@@ -20,56 +20,365 @@
 
 #include "System/Logger.h"
 #include "System/StringBuffer.h"
+#include "System/Thread.h"
 
 #if defined(__sgi)
 #  include <stdarg.h>
 #else
 #  include <cstdarg>
 #endif
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
 #include <vector>
 
+// the functions themselves are always there
+#undef LogDebug
+
 namespace GemRB {
 
+// the loggers that can run anywhere, guarded by loggersLock
 static std::vector<Logger*> theLogger;
+// the ones that can't, only the main thread adds, removes and calls them
+static std::vector<Logger*> mainLoggers;
+static ThreadID mainThread;
+
+log_level logLevelMax = DEBUG;
+int logOwnerCount = 0;
+
+#define LOG_OWNERS 32
+struct LogOwner {
+	char name[32];
+	log_level level;
+};
+// changed from the console while any thread may be logging
+static LogOwner logOwners[LOG_OWNERS];
+static Mutex ownersLock;
+// held by whoever writes to or changes theLogger
+static Mutex loggersLock;
+
+// the loggers that can run anywhere, from the log thread or the callers
+static void LogDeferred(log_level level, const char* owner, const char* message, log_color color)
+{
+	MutexLock l(loggersLock);
+	for (size_t i = 0; i < theLogger.size(); ++i) {
+		theLogger[i]->log(level, owner, message, color);
+	}
+}
+
+struct LogRecord {
+	log_level level;
+	log_color color;
+	std::string owner;
+	std::string message;
+};
+
+/* The log thread: any thread pushes its formatted records into a bounded
+ * ring and this one writes them to the loggers, so the callers don't wait
+ * for the terminal or the disk. When the ring is full the records up to
+ * warnings wait for room, the chatty levels are dropped and counted.
+ * The slots keep their strings, so after a while pushing doesn't allocate.
+ */
+class LogQueue : public Thread {
+public:
+	LogQueue(unsigned int size)
+		: ring(size), size(size), head(0), tail(0), stopping(false), busy(false),
+		queued(0), dropped(0), reportedDrops(0), deepest(0) {}
+
+	void Push(log_level level, const char* owner, const char* message, log_color color)
+	{
+		MutexLock l(lock);
+		while (head - tail >= size) {
+			if (level > WARNING) {
+				dropped++;
+				return;
+			}
+			notFull.Wait(lock);
+		}
+		LogRecord &slot = ring[head % size];
+		slot.level = level;
+		slot.color = color;
+		slot.owner.assign(owner);
+		slot.message.assign(message);
+		head++;
+		queued++;
+		if (head - tail > deepest) deepest = head - tail;
+		notEmpty.Signal();
+	}
+
+	void Flush()
+	{
+		MutexLock l(lock);
+		while (head != tail || busy) {
+			drained.Wait(lock);
+		}
+	}
+
+	// writes what is left and ends the thread
+	void Stop()
+	{
+		{
+			MutexLock l(lock);
+			stopping = true;
+			notEmpty.Signal();
+		}
+		Join();
+		if (queued) {
+			char buf[128];
+			snprintf(buf, sizeof(buf), "Log queue: %lu records, %lu dropped, %u at most waiting.",
+				queued, dropped, deepest);
+			LogDeferred(MESSAGE, "Logger", buf, WHITE);
+		}
+	}
+protected:
+	void Run()
+	{
+		LogRecord record;
+		lock.Lock();
+		while (true) {
+			while (head == tail && !stopping) {
+				notEmpty.Wait(lock);
+			}
+			if (head == tail) break;
+			// swap the strings out, the slot gets the old buffers back
+			LogRecord &slot = ring[tail % size];
+			record.level = slot.level;
+			record.color = slot.color;
+			record.owner.swap(slot.owner);
+			record.message.swap(slot.message);
+			tail++;
+			unsigned long drops = dropped - reportedDrops;
+			reportedDrops = dropped;
+			busy = true;
+			notFull.Signal();
+			lock.Unlock();
+
+			if (drops) {
+				char buf[64];
+				snprintf(buf, sizeof(buf), "%lu messages were dropped.", drops);
+				LogDeferred(WARNING, "Logger", buf, YELLOW);
+			}
+			LogDeferred(record.level, record.owner.c_str(), record.message.c_str(), record.color);
+
+			lock.Lock();
+			busy = false;
+			if (head == tail) {
+				drained.Broadcast();
+			}
+		}
+		busy = false;
+		drained.Broadcast();
+		lock.Unlock();
+	}
+private:
+	std::vector<LogRecord> ring;
+	unsigned int size;
+	unsigned int head, tail; // the next slot to fill and to write, they wrap around
+	bool stopping, busy;
+	unsigned long queued, dropped, reportedDrops;
+	unsigned int deepest;
+	Mutex lock;
+	ConditionVariable notEmpty, notFull, drained;
+};
+
+static LogQueue* logQueue = NULL;
+// held while logQueue is read or replaced, so it can't go away under a Push
+static Mutex queueLock;
+
+static void StopLogQueue()
+{
+	LogQueue* queue;
+	{
+		MutexLock l(queueLock);
+		queue = logQueue;
+		// the callers write themselves again from now on
+		logQueue = NULL;
+	}
+	if (!queue) return;
+	queue->Stop();
+	delete queue;
+}
+
+void SetLogQueueSize(int size)
+{
+	StopLogQueue();
+	if (size <= 0) return;
+
+	LogQueue* queue = new LogQueue(size);
+	if (!queue->Start()) {
+		delete queue;
+		Log(WARNING, "Logger", "Couldn't start the log thread, logging directly.");
+		return;
+	}
+	MutexLock l(queueLock);
+	logQueue = queue;
+}
+
+void FlushLogging()
+{
+	MutexLock l(queueLock);
+	if (logQueue) {
+		logQueue->Flush();
+	}
+}
 
 void ShutdownLogging()
 {
+	StopLogQueue();
+	MutexLock l(loggersLock);
 	for (size_t i = 0; i < theLogger.size(); ++i) {
 		theLogger[i]->destroy();
 	}
 	theLogger.clear();
+	for (size_t i = 0; i < mainLoggers.size(); ++i) {
+		mainLoggers[i]->destroy();
+	}
+	mainLoggers.clear();
+	UpdateLogLevel();
+}
+
+static void UpdateLogLevel(const std::vector<Logger*> &loggers, log_level &level)
+{
+	for (size_t i = 0; i < loggers.size(); ++i) {
+		if (loggers[i]->GetLogLevel() > level) {
+			level = loggers[i]->GetLogLevel();
+		}
+	}
+}
+
+void UpdateLogLevel()
+{
+	log_level level = INTERNAL;
+	UpdateLogLevel(theLogger, level);
+	UpdateLogLevel(mainLoggers, level);
+	logLevelMax = level;
+}
+
+bool OwnerLogEnabled(log_level level, const char* owner)
+{
+	MutexLock l(ownersLock);
+	for (int i = 0; i < logOwnerCount; ++i) {
+		if (!strcmp(logOwners[i].name, owner)) {
+			return level <= logOwners[i].level;
+		}
+	}
+	return true;
+}
+
+void SetOwnerLogLevel(const char* owner, int level)
+{
+	{
+		MutexLock l(ownersLock);
+		int i;
+		for (i = 0; i < logOwnerCount; ++i) {
+			if (!strcmp(logOwners[i].name, owner)) break;
+		}
+		if (level < FATAL) {
+			if (i < logOwnerCount) {
+				logOwners[i] = logOwners[logOwnerCount - 1];
+				logOwnerCount--;
+			}
+			return;
+		}
+		if (i < LOG_OWNERS) {
+			strlcpy(logOwners[i].name, owner, sizeof(logOwners[i].name));
+			logOwners[i].level = (log_level) level;
+			if (i == logOwnerCount) {
+				logOwnerCount++;
+			}
+			return;
+		}
+	}
+	// not under the lock, the warning checks the owners too
+	Log(WARNING, "Logger", "Too many owners with their own log level, ignoring %s.", owner);
 }
 
 void InitializeLogging()
 {
+	mainThread = Thread::GetCurrentID();
 	AddLogger(createDefaultLogger());
 }
 
+static bool OnMainThread()
+{
+	return Thread::IsSameThread(Thread::GetCurrentID(), mainThread);
+}
+
 void AddLogger(Logger* logger)
 {
-	if (logger)
-		theLogger.push_back(logger);
+	MutexLock l(loggersLock);
+	if (logger) {
+		if (logger->CanDefer()) {
+			theLogger.push_back(logger);
+		} else {
+			assert(OnMainThread());
+			mainLoggers.push_back(logger);
+		}
+	}
+	UpdateLogLevel();
+}
+
+static void EraseLogger(std::vector<Logger*> &loggers, Logger* logger)
+{
+	std::vector<Logger*>::iterator itr = loggers.begin();
+	while (itr != loggers.end()) {
+		if (*itr == logger) {
+			itr = loggers.erase(itr);
+		} else {
+			itr++;
+		}
+	}
 }
 
 void RemoveLogger(Logger* logger)
 {
 	if (logger) {
-		std::vector<Logger*>::iterator itr = theLogger.begin();
-		while (itr != theLogger.end()) {
-			if (*itr == logger) {
-				itr = theLogger.erase(itr);
-			} else {
-				itr++;
-			}
+		FlushLogging();
+		MutexLock l(loggersLock);
+		if (logger->CanDefer()) {
+			EraseLogger(theLogger, logger);
+		} else {
+			assert(OnMainThread());
+			EraseLogger(mainLoggers, logger);
 		}
 		logger->destroy();
 		logger = NULL;
+		UpdateLogLevel();
 	}
 }
 
+/* Any thread may log. The loggers that have to stay on the main thread (the
+ * message window) only get its records, the others get everyone's: through
+ * the log thread if there is one, or under loggersLock. So a failure the
+ * player should see is best reported from the main thread.
+ */
+static void LogMessage(log_level level, const char* owner, const char* message, log_color color)
+{
+	if (OnMainThread() && !mainLoggers.empty()) {
+		for (size_t i = 0; i < mainLoggers.size(); ++i) {
+			mainLoggers[i]->log(level, owner, message, color);
+		}
+	}
+
+	{
+		MutexLock l(queueLock);
+		if (logQueue) {
+			logQueue->Push(level, owner, message, color);
+			// a fatal error is likely the last thing we get to say
+			if (level == FATAL) {
+				logQueue->Flush();
+			}
+			return;
+		}
+	}
+	LogDeferred(level, owner, message, color);
+}
+
 static void vLog(log_level level, const char* owner, const char* message, log_color color, va_list ap)
 {
-	if (theLogger.empty())
+	// no loggers at all
+	if (logLevelMax < FATAL)
 		return;
 
 	// Copied from System/StringBuffer.cpp
@@ -92,9 +401,7 @@ static void vLog(log_level level, const char* owner, const char* message, log_co
 #endif
 	char buf[len+1];
 	vsnprintf(buf, len + 1, message, ap);
-	for (size_t i = 0; i < theLogger.size(); ++i) {
-		theLogger[i]->log(level, owner, buf, color);
-	}
+	LogMessage(level, owner, buf, color);
 }
 
 void print(const char *message, ...)
@@ -119,6 +426,9 @@ void error(const char* owner, const char* message, ...)
 
 void Log(log_level level, const char* owner, const char* message, ...)
 {
+	if (!LogEnabled(level, owner)) {
+		return;
+	}
 	va_list ap;
 	va_start(ap, message);
 	vLog(level, owner, message, WHITE, ap);
@@ -127,9 +437,26 @@ void Log(log_level level, const char* owner, const char* message, ...)
 
 void Log(log_level level, const char* owner, StringBuffer const& buffer)
 {
-	for (size_t i = 0; i < theLogger.size(); ++i) {
-		theLogger[i]->log(level, owner, buffer.get().c_str(), WHITE);
+	if (!LogEnabled(level, owner)) {
+		return;
+	}
+	LogMessage(level, owner, buffer.get().c_str(), WHITE);
+}
+
+void LogDebug(const char* owner, const char* message, ...)
+{
+	if (!LogEnabled(DEBUG, owner)) {
+		return;
 	}
+	va_list ap;
+	va_start(ap, message);
+	vLog(DEBUG, owner, message, WHITE, ap);
+	va_end(ap);
+}
+
+void LogDebug(const char* owner, StringBuffer const& buffer)
+{
+	Log(DEBUG, owner, buffer);
 }
 
 }
@@ -48,10 +48,18 @@ enum log_level {
 class Logger;
 class StringBuffer;
 
+/** Call it from the main thread: any thread may log, but only the main
+ * thread's records reach the loggers that can't be deferred */
 GEM_EXPORT void InitializeLogging();
+/** the loggers that can't be deferred are added and removed on the main thread */
 GEM_EXPORT void AddLogger(Logger*);
 GEM_EXPORT void RemoveLogger(Logger*);
 GEM_EXPORT void ShutdownLogging();
+/** Hands the records to a thread writing them, through a queue of size
+ * records; 0 writes them on the calling thread again */
+GEM_EXPORT void SetLogQueueSize(int size);
+/** Waits until the queued records were written */
+GEM_EXPORT void FlushLogging();
 
 #if defined(__GNUC__)
 # define PRINTF_FORMAT(x, y) \
@@ -81,9 +89,42 @@ GEM_EXPORT void Log(log_level, const char* owner, const char* message, ...)
 
 GEM_EXPORT void Log(log_level, const char* owner, StringBuffer const&);
 
+/** Log(DEBUG, ...), but with DISABLE_DEBUG_LOG the calls aren't compiled in */
+GEM_EXPORT void LogDebug(const char* owner, const char* message, ...)
+	PRINTF_FORMAT(2, 3);
+
+GEM_EXPORT void LogDebug(const char* owner, StringBuffer const&);
+
 #undef PRINTF_FORMAT
 #undef NORETURN
 
+/** the most verbose level any of the loggers writes */
+extern GEM_EXPORT log_level logLevelMax;
+/** the number of owners with a level of their own */
+extern GEM_EXPORT int logOwnerCount;
+/** Recomputes logLevelMax, after a logger changed its level */
+GEM_EXPORT void UpdateLogLevel();
+/** Sets the most verbose level logged for the owner, any lower level
+ * (like -1) goes back to the level of the loggers */
+GEM_EXPORT void SetOwnerLogLevel(const char* owner, int level);
+GEM_EXPORT bool OwnerLogEnabled(log_level, const char* owner);
+
+// the DEBUG lines can be compiled out: the loop keeps the call (and its
+// arguments) checked by the compiler, but its body never runs
+#ifdef DISABLE_DEBUG_LOG
+#define GEM_LOG_LEVEL_MAX COMBAT
+#define LogDebug while (false) LogDebug
+#else
+#define GEM_LOG_LEVEL_MAX DEBUG
+#endif
+
+/** true if a logger would write this, Log checks it before the formatting */
+inline bool LogEnabled(log_level level, const char* owner)
+{
+	return level <= GEM_LOG_LEVEL_MAX && level <= logLevelMax
+		&& (!logOwnerCount || OwnerLogEnabled(level, owner));
+}
+
 }
 
 // poison printf
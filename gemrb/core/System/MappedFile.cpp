@@ -0,0 +1,176 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "System/MappedFile.h"
+
+#include "win32def.h"
+#include "errors.h"
+
+#include "Interface.h"
+
+#if !defined(WIN32) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace GemRB {
+
+MappedFile::MappedFile()
+	: data(NULL), size(0)
+{
+#ifdef WIN32
+	file = NULL;
+	mapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle((HANDLE) mapping);
+	}
+	if (file) {
+		CloseHandle((HANDLE) file);
+	}
+#elif defined(HAVE_MMAP)
+	if (data) {
+		munmap(data, size);
+	}
+#endif
+}
+
+MappedFile* MappedFile::Open(const char* filename)
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	DWORD size = GetFileSize(file, NULL);
+	if (size == INVALID_FILE_SIZE || !size) {
+		CloseHandle(file);
+		return NULL;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return NULL;
+	}
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return NULL;
+	}
+	MappedFile* mf = new MappedFile();
+	mf->file = file;
+	mf->mapping = mapping;
+	mf->data = (char *) data;
+	mf->size = size;
+	return mf;
+#elif defined(HAVE_MMAP)
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping stays valid without the descriptor
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+	MappedFile* mf = new MappedFile();
+	mf->data = (char *) data;
+	mf->size = (unsigned long) st.st_size;
+	return mf;
+#else
+	(void) filename;
+	return NULL;
+#endif
+}
+
+MappedStream::MappedStream(MappedFile* file, unsigned long offset, unsigned long size, const char* name)
+	: file(file), offset(offset)
+{
+	assert(offset + size <= file->GetSize());
+	this->size = size;
+	strlcpy(originalfile, name, _MAX_PATH);
+	ExtractFileFromPath(filename, name);
+}
+
+DataStream* MappedStream::Clone()
+{
+	return new MappedStream(file.get(), offset, size, originalfile);
+}
+
+int MappedStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	memcpy(dest, GetData(), length);
+	if (Encrypted) {
+		ReadDecrypted( dest, length );
+	}
+	Pos += length;
+	return length;
+}
+
+int MappedStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	error("MappedStream", "Attempted to use unimplemented MappedStream::Write method!");
+}
+
+int MappedStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position: %ld(limit: %ld)", Pos, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
+}
@@ -0,0 +1,82 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * @file MappedFile.h
+ * Declares MappedFile, a read-only memory mapping of a whole file,
+ * and MappedStream, a stream over a part of it.
+ * @author The GemRB Project
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include "System/DataStream.h"
+
+#include "exports.h"
+#include "Holder.h"
+
+namespace GemRB {
+
+/**
+ * @class MappedFile
+ * A file mapped into memory for reading. It is refcounted, so the streams
+ * handed out over it can outlive whoever mapped it, on whichever thread.
+ */
+
+class GEM_EXPORT MappedFile : public Held<MappedFile, AtomicRefCount> {
+public:
+	~MappedFile();
+	/** Maps the file, returns NULL if it (or mapping at all) isn't possible. */
+	static MappedFile* Open(const char* filename);
+	const char* GetData() const { return data; }
+	unsigned long GetSize() const { return size; }
+private:
+	MappedFile();
+	char* data;
+	unsigned long size;
+#ifdef WIN32
+	void* file;
+	void* mapping;
+#endif
+};
+
+/**
+ * @class MappedStream
+ * Reads a part of a MappedFile straight from the mapping.
+ */
+
+class GEM_EXPORT MappedStream : public DataStream {
+private:
+	Holder<MappedFile> file;
+	unsigned long offset;
+public:
+	MappedStream(MappedFile* file, unsigned long offset, unsigned long size, const char* name);
+	DataStream* Clone();
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+
+	/** The bytes from the current position on, Remains() of them. */
+	const char* GetData() const { return file->GetData() + offset + Pos; }
+};
+
+}
+
+#endif
@@ -100,4 +100,72 @@ int MemoryStream::Seek(int newpos, int type)
 	return GEM_OK;
 }
 
+MemoryBlock::MemoryBlock(void* data, unsigned long size)
+	: data((char*) data), size(size)
+{
+}
+
+MemoryBlock::~MemoryBlock()
+{
+	free(data);
+}
+
+SharedMemoryStream::SharedMemoryStream(MemoryBlock* block, const char* name)
+	: block(block)
+{
+	size = block->GetSize();
+	strlcpy(originalfile, name, _MAX_PATH);
+	ExtractFileFromPath(filename, name);
+}
+
+DataStream* SharedMemoryStream::Clone()
+{
+	return new SharedMemoryStream(block.get(), originalfile);
+}
+
+int SharedMemoryStream::Read(void* dest, unsigned int length)
+{
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	memcpy(dest, block->GetData() + Pos + (Encrypted ? 2 : 0), length);
+	if (Encrypted) {
+		ReadDecrypted( dest, length );
+	}
+	Pos += length;
+	return length;
+}
+
+int SharedMemoryStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	error("SharedMemoryStream", "The shared bytes can't be written to!");
+}
+
+int SharedMemoryStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position: %ld(limit: %ld)", Pos, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
 }
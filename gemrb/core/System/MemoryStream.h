@@ -24,6 +24,7 @@
 #include "System/DataStream.h"
 
 #include "exports.h"
+#include "Holder.h"
 
 namespace GemRB {
 
@@ -35,6 +36,41 @@ public:
 	MemoryStream(char *name, void* data, unsigned long size);
 	~MemoryStream();
 	DataStream* Clone();
+	const char* GetData() const { return data; }
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+};
+
+/**
+ * @class MemoryBlock
+ * Bytes shared by any number of streams, freed with the last holder.
+ */
+
+class GEM_EXPORT MemoryBlock : public Held<MemoryBlock, AtomicRefCount> {
+public:
+	/** takes over the malloc'd data */
+	MemoryBlock(void* data, unsigned long size);
+	~MemoryBlock();
+	const char* GetData() const { return data; }
+	unsigned long GetSize() const { return size; }
+private:
+	char* data;
+	unsigned long size;
+};
+
+/**
+ * @class SharedMemoryStream
+ * Reads a MemoryBlock without copying it, each stream with its own position.
+ */
+
+class GEM_EXPORT SharedMemoryStream : public DataStream {
+private:
+	Holder<MemoryBlock> block;
+public:
+	SharedMemoryStream(MemoryBlock* block, const char* name);
+	DataStream* Clone();
 
 	int Read(void* dest, unsigned int length);
 	int Write(const void* src, unsigned int length);
@@ -0,0 +1,42 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "System/SharedString.h"
+
+namespace GemRB {
+
+SharedString::Pool SharedString::pool;
+
+// the text lives only as the pool key, so interning allocates once
+Holder<SharedString> SharedString::Intern(const String& text)
+{
+	Pool::iterator it = pool.lower_bound(text);
+	if (it != pool.end() && it->first == text) {
+		return Holder<SharedString>(it->second);
+	}
+	SharedString *shared = new SharedString();
+	shared->pos = pool.insert(it, Pool::value_type(text, shared));
+	return Holder<SharedString>(shared);
+}
+
+SharedString::~SharedString()
+{
+	pool.erase(pos);
+}
+
+}
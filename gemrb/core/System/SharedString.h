@@ -0,0 +1,60 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * @file SharedString.h
+ * Interned, refcounted immutable strings.
+ * @author The GemRB Project
+ */
+
+#ifndef SHAREDSTRING_H
+#define SHAREDSTRING_H
+
+#include "exports.h"
+#include "Holder.h"
+#include "System/String.h"
+
+#include <map>
+
+namespace GemRB {
+
+/**
+ * @class SharedString
+ * One copy of a piece of text, shared by everyone holding the same text.
+ * Used for messages that repeat a lot, like the overhead damage numbers.
+ * Only for the main thread, the pool isn't locked.
+ */
+
+class GEM_EXPORT SharedString : public Held<SharedString> {
+public:
+	/** Returns the pooled copy of text, making it if needed. */
+	static Holder<SharedString> Intern(const String& text);
+	const String& Get() const { return pos->first; }
+private:
+	typedef std::map<String, SharedString*> Pool;
+	static Pool pool;
+	Pool::iterator pos;
+
+	SharedString() {}
+	~SharedString();
+	friend class Held<SharedString>;
+};
+
+}
+
+#endif
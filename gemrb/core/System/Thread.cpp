@@ -0,0 +1,234 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "System/Thread.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+namespace GemRB {
+
+#ifdef WIN32
+
+Mutex::Mutex()
+{
+	InitializeCriticalSection(&mutex);
+}
+
+Mutex::~Mutex()
+{
+	DeleteCriticalSection(&mutex);
+}
+
+void Mutex::Lock()
+{
+	EnterCriticalSection(&mutex);
+}
+
+void Mutex::Unlock()
+{
+	LeaveCriticalSection(&mutex);
+}
+
+ConditionVariable::ConditionVariable()
+{
+	InitializeConditionVariable(&cond);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+}
+
+void ConditionVariable::Wait(Mutex &m)
+{
+	SleepConditionVariableCS(&cond, &m.mutex, INFINITE);
+}
+
+void ConditionVariable::Signal()
+{
+	WakeConditionVariable(&cond);
+}
+
+void ConditionVariable::Broadcast()
+{
+	WakeAllConditionVariable(&cond);
+}
+
+Thread::Thread()
+	: thread(NULL), started(false)
+{
+}
+
+Thread::~Thread()
+{
+	Join();
+}
+
+DWORD WINAPI Thread::Entry(LPVOID arg)
+{
+	((Thread *) arg)->Run();
+	return 0;
+}
+
+bool Thread::Start()
+{
+	if (started) {
+		return true;
+	}
+	thread = CreateThread(NULL, 0, Entry, this, 0, NULL);
+	started = thread != NULL;
+	return started;
+}
+
+void Thread::Join()
+{
+	if (!started) {
+		return;
+	}
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	thread = NULL;
+	started = false;
+}
+
+unsigned int Thread::GetProcessorCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	if (info.dwNumberOfProcessors < 1) {
+		return 1;
+	}
+	return (unsigned int) info.dwNumberOfProcessors;
+}
+
+ThreadID Thread::GetCurrentID()
+{
+	return GetCurrentThreadId();
+}
+
+bool Thread::IsSameThread(ThreadID a, ThreadID b)
+{
+	return a == b;
+}
+
+#else // ! WIN32
+
+Mutex::Mutex()
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+Mutex::~Mutex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::Lock()
+{
+	pthread_mutex_lock(&mutex);
+}
+
+void Mutex::Unlock()
+{
+	pthread_mutex_unlock(&mutex);
+}
+
+ConditionVariable::ConditionVariable()
+{
+	pthread_cond_init(&cond, NULL);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+	pthread_cond_destroy(&cond);
+}
+
+void ConditionVariable::Wait(Mutex &m)
+{
+	pthread_cond_wait(&cond, &m.mutex);
+}
+
+void ConditionVariable::Signal()
+{
+	pthread_cond_signal(&cond);
+}
+
+void ConditionVariable::Broadcast()
+{
+	pthread_cond_broadcast(&cond);
+}
+
+Thread::Thread()
+	: started(false)
+{
+}
+
+Thread::~Thread()
+{
+	Join();
+}
+
+void *Thread::Entry(void *arg)
+{
+	((Thread *) arg)->Run();
+	return NULL;
+}
+
+bool Thread::Start()
+{
+	if (started) {
+		return true;
+	}
+	started = pthread_create(&thread, NULL, Entry, this) == 0;
+	return started;
+}
+
+void Thread::Join()
+{
+	if (!started) {
+		return;
+	}
+	pthread_join(thread, NULL);
+	started = false;
+}
+
+unsigned int Thread::GetProcessorCount()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count > 0) {
+		return (unsigned int) count;
+	}
+#endif
+	return 1;
+}
+
+ThreadID Thread::GetCurrentID()
+{
+	return pthread_self();
+}
+
+bool Thread::IsSameThread(ThreadID a, ThreadID b)
+{
+	return pthread_equal(a, b) != 0;
+}
+
+#endif // ! WIN32
+
+}
@@ -0,0 +1,124 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * @file Thread.h
+ * Minimal threading primitives for the core.
+ * @author The GemRB Project
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "exports.h"
+
+#ifdef WIN32
+# include "win32def.h"
+#else
+# include <pthread.h>
+#endif
+
+namespace GemRB {
+
+#ifdef WIN32
+typedef DWORD ThreadID;
+#else
+typedef pthread_t ThreadID;
+#endif
+
+/** A plain (non recursive) mutex. */
+class GEM_EXPORT Mutex {
+public:
+	Mutex();
+	~Mutex();
+	void Lock();
+	void Unlock();
+private:
+	friend class ConditionVariable;
+#ifdef WIN32
+	CRITICAL_SECTION mutex;
+#else
+	pthread_mutex_t mutex;
+#endif
+	Mutex(const Mutex&);
+	Mutex& operator=(const Mutex&);
+};
+
+/** Holds the mutex for its own lifetime. */
+class GEM_EXPORT MutexLock {
+public:
+	MutexLock(Mutex &m) : mutex(m) { mutex.Lock(); }
+	~MutexLock() { mutex.Unlock(); }
+private:
+	Mutex &mutex;
+	MutexLock(const MutexLock&);
+	MutexLock& operator=(const MutexLock&);
+};
+
+/** Condition variable, always waited on with its mutex locked. */
+class GEM_EXPORT ConditionVariable {
+public:
+	ConditionVariable();
+	~ConditionVariable();
+	void Wait(Mutex &m);
+	void Signal();
+	void Broadcast();
+private:
+#ifdef WIN32
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+	ConditionVariable(const ConditionVariable&);
+	ConditionVariable& operator=(const ConditionVariable&);
+};
+
+/** A thread running the Run() method of the subclass. */
+class GEM_EXPORT Thread {
+public:
+	Thread();
+	virtual ~Thread();
+	/** Returns false if the thread couldn't be created. */
+	bool Start();
+	/** Waits for Run() to return. */
+	void Join();
+	bool IsStarted() const { return started; }
+
+	/** The number of processors available, at least 1. */
+	static unsigned int GetProcessorCount();
+	/** Identifies the calling thread, any thread may ask. */
+	static ThreadID GetCurrentID();
+	static bool IsSameThread(ThreadID a, ThreadID b);
+protected:
+	virtual void Run() = 0;
+private:
+#ifdef WIN32
+	HANDLE thread;
+	static DWORD WINAPI Entry(LPVOID arg);
+#else
+	pthread_t thread;
+	static void *Entry(void *arg);
+#endif
+	bool started;
+	Thread(const Thread&);
+	Thread& operator=(const Thread&);
+};
+
+}
+
+#endif
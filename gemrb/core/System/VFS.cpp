@@ -183,6 +183,16 @@ bool file_exists(const char* path)
 	return true;
 }
 
+time_t file_mtime(const char* path)
+{
+	struct stat buf;
+
+	if (stat(path, &buf) < 0) {
+		return 0;
+	}
+	return buf.st_mtime;
+}
+
 
 /**
  * Appends 'name' to path 'target' and returns 'target'.
@@ -39,6 +39,8 @@
 #include "globals.h"
 #include "Predicates.h"
 
+#include <ctime>
+
 #include <string>
 #include <sys/stat.h>
 
@@ -93,6 +95,8 @@ const char SPathListSeparator[] = { PathListSeparator, '\0' };
 GEM_EXPORT bool FileGlob(char *target, const char* Dir, const char* glob);
 GEM_EXPORT bool dir_exists(const char* path);
 GEM_EXPORT bool file_exists(const char* path);
+/** Returns the modification time of path, 0 if it can't be read */
+GEM_EXPORT time_t file_mtime(const char* path);
 
 /**
  * Joins NULL-terminated list of directories and copies it to 'target'.
@@ -56,6 +56,9 @@ public:
 	 * uses column name and row name to search the field,
 	 * may return NULL */
 	virtual const char* QueryField(const char* row, const char* column) const = 0;
+	/** Returns a 2da element parsed as a number (like atoi), or the default */
+	virtual int QueryFieldSigned(unsigned int row, unsigned int column) const = 0;
+	virtual int QueryFieldSigned(const char* row, const char* column) const = 0;
 	/** Returns default value of table. */
 	virtual const char* QueryDefault() const = 0;
 	virtual int GetColumnIndex(const char* colname) const = 0;
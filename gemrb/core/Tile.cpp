@@ -20,6 +20,8 @@
 
 #include "Tile.h"
 
+#include "MemoryStats.h"
+
 namespace GemRB {
 
 Tile::Tile(Animation* anim, Animation* sec)
@@ -27,16 +29,48 @@ Tile::Tile(Animation* anim, Animation* sec)
 	tileIndex = om = 0;
 	this->anim[0] = anim;
 	this->anim[1] = sec;
+	indices = NULL;
+	count = 0;
+	secondary = 0xffff;
+	fps = 0;
+	memset(SearchMap, 0, sizeof(SearchMap));
+	memset(HeightMap, 0, sizeof(HeightMap));
+	memset(LightMap, 0, sizeof(LightMap));
+	memset(NLightMap, 0, sizeof(NLightMap));
+	MemoryStats::Add(MEM_TILES, sizeof(Tile));
+}
+
+Tile::Tile(unsigned short* indices, int count, unsigned short secondary, unsigned char fps)
+{
+	tileIndex = om = 0;
+	anim[0] = anim[1] = NULL;
+	this->indices = indices;
+	this->count = count;
+	this->secondary = secondary;
+	this->fps = fps;
 	memset(SearchMap, 0, sizeof(SearchMap));
 	memset(HeightMap, 0, sizeof(HeightMap));
 	memset(LightMap, 0, sizeof(LightMap));
 	memset(NLightMap, 0, sizeof(NLightMap));
+	MemoryStats::Add(MEM_TILES, sizeof(Tile));
 }
 
 Tile::~Tile(void)
 {
+	MemoryStats::Remove(MEM_TILES, sizeof(Tile));
+	delete( anim[0] );
+	delete( anim[1] );
+	free( indices );
+}
+
+void Tile::Unload()
+{
+	if (!indices) {
+		return;
+	}
 	delete( anim[0] );
 	delete( anim[1] );
+	anim[0] = anim[1] = NULL;
 }
 
 }
@@ -31,6 +31,8 @@ namespace GemRB {
 class GEM_EXPORT Tile {
 public:
 	Tile(Animation* anim, Animation* sec = NULL);
+	/** A streamed tile, only decoded once it is in view (takes the indices) */
+	Tile(unsigned short* indices, int count, unsigned short secondary, unsigned char fps);
 	~Tile(void);
 	unsigned char tileIndex;
 	unsigned char om;
@@ -39,6 +41,17 @@ public:
 	Color LightMap[16];
 	Color NLightMap[16];
 	Animation* anim[2];
+
+	//what a streamed tile is decoded from again, NULL indices otherwise
+	unsigned short* indices;
+	int count;
+	unsigned short secondary;
+	unsigned char fps;
+
+	bool IsStreamed() const { return indices != NULL; }
+	bool IsLoaded() const { return anim[0] != NULL; }
+	/* drops the animations of a streamed tile */
+	void Unload();
 };
 
 }
@@ -34,6 +34,7 @@ TileMap::TileMap(void)
 	XCellCount = 0;
 	YCellCount = 0;
 	LargeMap = !core->HasFeature(GF_SMALL_FOG);
+	shownValid = false;
 }
 
 TileMap::~TileMap(void)
@@ -108,6 +109,8 @@ Door* TileMap::AddDoor(const char *ID, const char* Name, unsigned int Flags,
 	door->SetName( ID );
 	door->SetScriptName( Name );
 	doors.push_back( door );
+	doorsByID[door->GetGlobalID()] = door;
+	shownValid = false;
 	return door;
 }
 
@@ -119,30 +122,37 @@ Door* TileMap::GetDoor(unsigned int idx) const
 	return doors[idx];
 }
 
-Door* TileMap::GetDoor(const Point &p) const
+static bool InBox(const Region &box, const Point &p)
 {
-	for (size_t i = 0; i < doors.size(); i++) {
-		Gem_Polygon *doorpoly;
+	return box.x <= p.x && box.y <= p.y && box.x + box.w >= p.x && box.y + box.h >= p.y;
+}
 
-		Door* door = doors[i];
-		if (door->Flags&DOOR_HIDDEN) {
-			continue;
-		}
-		if (door->Flags&DOOR_OPEN)
-			doorpoly = door->open;
-		else
-			doorpoly = door->closed;
+static bool Overlaps(const Region &a, const Region &b)
+{
+	return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
 
-		if (doorpoly->BBox.x > p.x)
-			continue;
-		if (doorpoly->BBox.y > p.y)
-			continue;
-		if (doorpoly->BBox.x + doorpoly->BBox.w < p.x)
-			continue;
-		if (doorpoly->BBox.y + doorpoly->BBox.h < p.y)
-			continue;
-		if (doorpoly->PointIn( p ))
-			return door;
+static bool DoorAt(Door *door, const Point &p)
+{
+	if (door->Flags&DOOR_HIDDEN) {
+		return false;
+	}
+	Gem_Polygon *doorpoly;
+	if (door->Flags&DOOR_OPEN)
+		doorpoly = door->open;
+	else
+		doorpoly = door->closed;
+
+	if (!InBox(doorpoly->BBox, p))
+		return false;
+	return doorpoly->PointIn( p );
+}
+
+Door* TileMap::GetDoor(const Point &p) const
+{
+	for (size_t i = 0; i < doors.size(); i++) {
+		if (DoorAt(doors[i], p))
+			return doors[i];
 	}
 	return NULL;
 }
@@ -162,6 +172,15 @@ Door* TileMap::GetDoorByPosition(const Point &p) const
 	return NULL;
 }
 
+Door* TileMap::GetDoorByGlobalID(ieDword objectID) const
+{
+	std::map<ieDword, Door*>::const_iterator it = doorsByID.find(objectID);
+	if (it == doorsByID.end()) {
+		return NULL;
+	}
+	return it->second;
+}
+
 Door* TileMap::GetDoor(const char* Name) const
 {
 	if (!Name) {
@@ -175,6 +194,18 @@ Door* TileMap::GetDoor(const char* Name) const
 	return NULL;
 }
 
+void TileMap::TrimOverlays()
+{
+	size_t i;
+
+	for (i = 0; i < overlays.size(); i++) {
+		if (overlays[i]) overlays[i]->Trim();
+	}
+	for (i = 0; i < rain_overlays.size(); i++) {
+		if (rain_overlays[i]) rain_overlays[i]->Trim();
+	}
+}
+
 void TileMap::UpdateDoors()
 {
 	for (size_t i = 0; i < doors.size(); i++) {
@@ -261,6 +292,13 @@ void TileMap::DrawFogOfWar(ieByte* explored_mask, ieByte* visible_mask, Region v
 	if (vp.y < 0) {
 		vp.y = 0;
 	}
+	if (core->SmoothFog) {
+		// the driver has its own copy of the bitmaps from Map::UploadFog
+		int half = LargeMap ? CELL_SIZE / 2 : 0;
+		if (vid->DrawFogOfWar(viewport, viewport.x - vp.x - half, viewport.y - vp.y - half, CELL_SIZE)) {
+			return;
+		}
+	}
 	int sx = ( vp.x ) / CELL_SIZE;
 	int sy = ( vp.y ) / CELL_SIZE;
 	int dx = sx + vp.w / CELL_SIZE + 2;
@@ -419,6 +457,8 @@ void TileMap::DrawFogOfWar(ieByte* explored_mask, ieByte* visible_mask, Region v
 void TileMap::AddContainer(Container *c)
 {
 	containers.push_back(c);
+	containersByID[c->GetGlobalID()] = c;
+	shownValid = false;
 }
 
 Container* TileMap::GetContainer(unsigned int idx) const
@@ -429,6 +469,15 @@ Container* TileMap::GetContainer(unsigned int idx) const
 	return containers[idx];
 }
 
+Container* TileMap::GetContainerByGlobalID(ieDword objectID) const
+{
+	std::map<ieDword, Container*>::const_iterator it = containersByID.find(objectID);
+	if (it == containersByID.end()) {
+		return NULL;
+	}
+	return it->second;
+}
+
 Container* TileMap::GetContainer(const char* Name) const
 {
 	for (size_t i = 0; i < containers.size(); i++) {
@@ -442,35 +491,33 @@ Container* TileMap::GetContainer(const char* Name) const
 //look for a container at position
 //use type = IE_CONTAINER_PILE if you want to find ground piles only
 //in this case, empty piles won't be found!
-Container* TileMap::GetContainer(const Point &position, int type) const
+static bool ContainerAt(Container *c, const Point &position, int type)
 {
-	for (size_t i = 0; i < containers.size(); i++) {
-		Container* c = containers[i];
-		if (type!=-1) {
-			if (c->Type!=type) {
-				continue;
-			}
+	if (type!=-1) {
+		if (c->Type!=type) {
+			return false;
 		}
-		if (c->outline->BBox.x > position.x)
-			continue;
-		if (c->outline->BBox.y > position.y)
-			continue;
-		if (c->outline->BBox.x + c->outline->BBox.w < position.x)
-			continue;
-		if (c->outline->BBox.y + c->outline->BBox.h < position.y)
-			continue;
+	}
+	if (!InBox(c->outline->BBox, position))
+		return false;
 
-		//IE piles don't have polygons, the bounding box is enough for them
-		if (c->Type == IE_CONTAINER_PILE) {
-			//don't find empty piles if we look for any container
-			//if we looked only for piles, then we still return them
-			if ((type==-1) && !c->inventory.GetSlotCount()) {
-				continue;
-			}
-			return c;
+	//IE piles don't have polygons, the bounding box is enough for them
+	if (c->Type == IE_CONTAINER_PILE) {
+		//don't find empty piles if we look for any container
+		//if we looked only for piles, then we still return them
+		if ((type==-1) && !c->inventory.GetSlotCount()) {
+			return false;
 		}
-		if (c->outline->PointIn( position ))
-			return c;
+		return true;
+	}
+	return c->outline->PointIn( position );
+}
+
+Container* TileMap::GetContainer(const Point &position, int type) const
+{
+	for (size_t i = 0; i < containers.size(); i++) {
+		if (ContainerAt(containers[i], position, type))
+			return containers[i];
 	}
 	return NULL;
 }
@@ -513,6 +560,8 @@ int TileMap::CleanupContainer(Container *container)
 	for (size_t i = 0; i < containers.size(); i++) {
 		if (containers[i]==container) {
 			containers.erase(containers.begin()+i);
+			containersByID.erase(container->GetGlobalID());
+			shownValid = false;
 			delete container;
 			return 1;
 		}
@@ -548,43 +597,116 @@ InfoPoint* TileMap::AddInfoPoint(const char* Name, unsigned short Type,
 	ip->outline = outline;
 	//ip->Active = true; //set active on creation
 	infoPoints.push_back( ip );
+	infoPointsByID[ip->GetGlobalID()] = ip;
+	shownValid = false;
 	return ip;
 }
 
 //if detectable is set, then only detectable infopoints will be returned
+static bool InfoPointAt(InfoPoint *ip, const Point &p, bool detectable)
+{
+	//these flags disable any kind of user interaction
+	//scripts can still access an infopoint by name
+	if (ip->Flags&(INFO_DOOR|TRAP_DEACTIVATED) )
+		return false;
+
+	if (detectable) {
+		if ((ip->Type==ST_PROXIMITY) && !ip->VisibleTrap(0) ) {
+			return false;
+		}
+		if (ip->IsPortal()) {
+			// skip portals without PORTAL_CURSOR set
+			if (!(ip->Trapped & PORTAL_CURSOR)) {
+				return false;
+			}
+		}
+	}
+
+	if (!(ip->GetInternalFlag()&IF_ACTIVE))
+		return false;
+	if (!InBox(ip->outline->BBox, p))
+		return false;
+	return ip->outline->PointIn( p );
+}
+
 InfoPoint* TileMap::GetInfoPoint(const Point &p, bool detectable) const
 {
 	for (size_t i = 0; i < infoPoints.size(); i++) {
-		InfoPoint* ip = infoPoints[i];
-		//these flags disable any kind of user interaction
-		//scripts can still access an infopoint by name
-		if (ip->Flags&(INFO_DOOR|TRAP_DEACTIVATED) )
-			continue;
+		if (InfoPointAt(infoPoints[i], p, detectable))
+			return infoPoints[i];
+	}
+	return NULL;
+}
 
-		if (detectable) {
-			if ((ip->Type==ST_PROXIMITY) && !ip->VisibleTrap(0) ) {
-				continue;
-			}
-			if (ip->IsPortal()) {
-				// skip portals without PORTAL_CURSOR set
-				if (!(ip->Trapped & PORTAL_CURSOR)) {
-					continue;
-				}
-			}
+//the viewport of the last frame is all the pointer can reach, so the
+//hover and click tests only need to look at what intersects it
+void TileMap::CollectShown(const Region &viewport)
+{
+	size_t i;
+
+	shownDoors.clear();
+	for (i = 0; i < doors.size(); i++) {
+		Door *door = doors[i];
+		//both outlines, so a door toggled before the next frame stays pickable
+		if ((door->open && Overlaps(door->open->BBox, viewport)) ||
+			(door->closed && Overlaps(door->closed->BBox, viewport))) {
+			shownDoors.push_back(door);
+		}
+	}
+	shownContainers.clear();
+	for (i = 0; i < containers.size(); i++) {
+		if (Overlaps(containers[i]->outline->BBox, viewport)) {
+			shownContainers.push_back(containers[i]);
+		}
+	}
+	shownInfoPoints.clear();
+	for (i = 0; i < infoPoints.size(); i++) {
+		if (Overlaps(infoPoints[i]->outline->BBox, viewport)) {
+			shownInfoPoints.push_back(infoPoints[i]);
 		}
+	}
+	shownViewport = viewport;
+	shownValid = true;
+}
 
-		if (!(ip->GetInternalFlag()&IF_ACTIVE))
-			continue;
-		if (ip->outline->BBox.x > p.x)
-			continue;
-		if (ip->outline->BBox.y > p.y)
-			continue;
-		if (ip->outline->BBox.x + ip->outline->BBox.w < p.x)
-			continue;
-		if (ip->outline->BBox.y + ip->outline->BBox.h < p.y)
-			continue;
-		if (ip->outline->PointIn( p ))
-			return ip;
+//the lists are only trusted for points in the viewport they were made for
+bool TileMap::CanPick(const Point &p) const
+{
+	return shownValid && InBox(shownViewport, p);
+}
+
+Door* TileMap::PickDoor(const Point &p) const
+{
+	if (!CanPick(p)) {
+		return GetDoor(p);
+	}
+	for (size_t i = 0; i < shownDoors.size(); i++) {
+		if (DoorAt(shownDoors[i], p))
+			return shownDoors[i];
+	}
+	return NULL;
+}
+
+Container* TileMap::PickContainer(const Point &p, int type) const
+{
+	if (!CanPick(p)) {
+		return GetContainer(p, type);
+	}
+	for (size_t i = 0; i < shownContainers.size(); i++) {
+		if (ContainerAt(shownContainers[i], p, type))
+			return shownContainers[i];
+	}
+	return NULL;
+}
+
+InfoPoint* TileMap::PickInfoPoint(const Point &p, bool detectable) const
+{
+	if (!CanPick(p)) {
+		return GetInfoPoint(p, detectable);
+	}
+	for (size_t i = 0; i < shownInfoPoints.size(); i++) {
+		if (InfoPointAt(shownInfoPoints[i], p, detectable))
+			return shownInfoPoints[i];
 	}
 	return NULL;
 }
@@ -599,6 +721,15 @@ InfoPoint* TileMap::GetInfoPoint(const char* Name) const
 	return NULL;
 }
 
+InfoPoint* TileMap::GetInfoPointByGlobalID(ieDword objectID) const
+{
+	std::map<ieDword, InfoPoint*>::const_iterator it = infoPointsByID.find(objectID);
+	if (it == infoPointsByID.end()) {
+		return NULL;
+	}
+	return it->second;
+}
+
 InfoPoint* TileMap::GetInfoPoint(unsigned int idx) const
 {
 	if (idx >= infoPoints.size()) {
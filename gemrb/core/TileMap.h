@@ -26,6 +26,8 @@
 #include "Polygon.h"
 #include "TileOverlay.h"
 
+#include <map>
+
 namespace GemRB {
 
 //special container types
@@ -44,7 +46,19 @@ private:
 	std::vector< Container*> containers;
 	std::vector< InfoPoint*> infoPoints;
 	std::vector< TileObject*> tiles;
+	//the same by their global id, for the object resolution
+	std::map<ieDword, Door*> doorsByID;
+	std::map<ieDword, Container*> containersByID;
+	std::map<ieDword, InfoPoint*> infoPointsByID;
+	//what intersected the viewport on the last drawn frame
+	std::vector< Door*> shownDoors;
+	std::vector< Container*> shownContainers;
+	std::vector< InfoPoint*> shownInfoPoints;
+	Region shownViewport;
+	bool shownValid;
 	bool LargeMap;
+
+	bool CanPick(const Point &p) const;
 public:
 	TileMap(void);
 	~TileMap(void);
@@ -58,6 +72,7 @@ public:
 	Door* GetDoorByPosition(const Point &position) const;
 	Door* GetDoor(unsigned int idx) const;
 	Door* GetDoor(const char* Name) const;
+	Door* GetDoorByGlobalID(ieDword objectID) const;
 	size_t GetDoorCount() { return doors.size(); }
 	//update doors for a new overlay
 	void UpdateDoors();
@@ -70,6 +85,7 @@ public:
 	Container* GetContainerByPosition(const Point &position, int type=-1) const;
 	Container* GetContainer(const char* Name) const;
 	Container* GetContainer(unsigned int idx) const;
+	Container* GetContainerByGlobalID(ieDword objectID) const;
 	/* cleans up empty heaps, returns 1 if container removed*/
 	int CleanupContainer(Container *container);
 	size_t GetContainerCount() const { return containers.size(); }
@@ -79,6 +95,13 @@ public:
 	InfoPoint* GetInfoPoint(const Point &position, bool detectable) const;
 	InfoPoint* GetInfoPoint(const char* Name) const;
 	InfoPoint* GetInfoPoint(unsigned int idx) const;
+	InfoPoint* GetInfoPointByGlobalID(ieDword objectID) const;
+	//notes the objects within the viewport, once a frame
+	void CollectShown(const Region &viewport);
+	//the same as the point lookups above, but only among the shown objects
+	Door* PickDoor(const Point &position) const;
+	Container* PickContainer(const Point &position, int type=-1) const;
+	InfoPoint* PickInfoPoint(const Point &position, bool detectable) const;
 	InfoPoint* GetTravelTo(const char* Destination) const;
 	InfoPoint* AdjustNearestTravel(Point &p);
 	size_t GetInfoPointCount() const { return infoPoints.size(); }
@@ -90,6 +113,8 @@ public:
 	size_t GetTileCount() { return tiles.size(); }
 
 	void ClearOverlays();
+	//frees what the overlays can rebuild on the next draw
+	void TrimOverlays();
 	void AddOverlay(TileOverlay* overlay);
 	void AddRainOverlay(TileOverlay* overlay);
 	void DrawOverlays(Region screen, int rain, int flags);
@@ -32,6 +32,8 @@ public:
 	TileMapMgr(void);
 	virtual ~TileMapMgr(void);
 	virtual bool Open(DataStream* stream) = 0;
+	/** Starts decoding the tiles in the background, GetTileMap picks them up */
+	virtual void PreloadTileSets() = 0;
 	virtual TileMap* GetTileMap(TileMap *tm) = 0;
 	virtual ieWord* GetDoorIndices(char* ResRef, int* count,
 		bool& BaseClosed) = 0;
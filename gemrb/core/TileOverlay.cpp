@@ -20,31 +20,338 @@
 
 #include "TileOverlay.h"
 
-//#include "Game.h" // needed only for TILE_GREY below
+#include "Game.h" // for GetSpriteTint
 #include "GlobalTimer.h"
 #include "Interface.h"
+#include "Sprite2D.h"
 #include "Video.h"
 
+#include <algorithm>
+
 namespace GemRB {
 
 bool RedrawTile = false;
 
+//door tiles if there are any
+static Animation* GetTileAnimation(Tile* tile)
+{
+	Animation* anim = tile->anim[tile->tileIndex];
+	if (!anim && tile->tileIndex) {
+		anim = tile->anim[0];
+	}
+	assert(anim);
+	return anim;
+}
+
+//the frames of the tile as it is now, streamed tiles don't have to be decoded for it
+static int GetTileFrameCount(Tile* tile)
+{
+	if (tile->IsLoaded()) {
+		return GetTileAnimation(tile)->GetFrameCount();
+	}
+	//an open door shows the single secondary frame
+	if (tile->tileIndex && tile->secondary != 0xffff) {
+		return 1;
+	}
+	return tile->count;
+}
+
+//drawn under the half transparent overlays (water), every frame
+static bool IsOverlaidTile(Tile* tile)
+{
+	return tile->om && !tile->tileIndex;
+}
+
+//neither animated nor under an overlay, so it can be composited once
+static bool IsStaticTile(Tile* tile)
+{
+	return GetTileFrameCount(tile) <= 1 && !IsOverlaidTile(tile);
+}
+
 TileOverlay::TileOverlay(int Width, int Height)
 {
 	w = Width;
 	h = Height;
 	count = 0;
 	tiles = ( Tile * * ) malloc( w * h * sizeof( Tile * ) );
+	chunkFlags = 0;
+	chunkTint = ColorWhite;
+	chunkTinted = false;
+	noChunks = false;
+	budget = resident = 0;
+	lastX = lastY = -1;
+	scheduled = false;
 }
 
 TileOverlay::~TileOverlay(void)
 {
+	ClearChunks();
 	for (int i = 0; i < count; i++) {
 		delete( tiles[i] );
 	}
 	free( tiles );
 }
 
+void TileOverlay::ClearChunks()
+{
+	for (size_t i = 0; i < chunks.size(); i++) {
+		Sprite2D::FreeSprite( chunks[i] );
+	}
+}
+
+void TileOverlay::Trim()
+{
+	ClearChunks();
+	if (!source) {
+		return;
+	}
+	for (int i = 0; i < w * h; i++) {
+		Tile* tile = tiles[i];
+		if (tile->IsStreamed() && tile->IsLoaded()) {
+			tile->Unload();
+		}
+	}
+	resident = 0;
+}
+
+void TileOverlay::SetTileSource(PluginHolder<TileSetMgr> tis, int budget)
+{
+	source = tis;
+	this->budget = budget;
+}
+
+void TileOverlay::LoadTile(Tile* tile)
+{
+	if (tile->IsLoaded() || !source) {
+		return;
+	}
+	Tile* decoded;
+	if (tile->secondary == 0xffff) {
+		decoded = source->GetTile( tile->indices, tile->count );
+	} else {
+		decoded = source->GetTile( tile->indices, 1, &tile->secondary );
+		decoded->anim[1]->fps = tile->fps;
+	}
+	decoded->anim[0]->fps = tile->fps;
+	tile->anim[0] = decoded->anim[0];
+	tile->anim[1] = decoded->anim[1];
+	decoded->anim[0] = decoded->anim[1] = NULL;
+	delete decoded;
+	resident++;
+}
+
+/** Decodes the streamed tiles around the view and ahead of the scrolling,
+ * then drops the farther ones if there are more than the budget allows.
+ * They are decoded again from the tileset when they come back in view. */
+void TileOverlay::StreamTiles(int sx, int sy, int dx, int dy)
+{
+	int kx = sx - TILE_MARGIN, ky = sy - TILE_MARGIN;
+	int kdx = dx + TILE_MARGIN, kdy = dy + TILE_MARGIN;
+	if (lastX >= 0) {
+		if (sx > lastX) kdx += TILE_PREFETCH;
+		if (sx < lastX) kx -= TILE_PREFETCH;
+		if (sy > lastY) kdy += TILE_PREFETCH;
+		if (sy < lastY) ky -= TILE_PREFETCH;
+	}
+	lastX = sx;
+	lastY = sy;
+	if (kx < 0) kx = 0;
+	if (ky < 0) ky = 0;
+	if (kdx > w) kdx = w;
+	if (kdy > h) kdy = h;
+
+	for (int y = ky; y < kdy; y++) {
+		for (int x = kx; x < kdx; x++) {
+			LoadTile( tiles[y * w + x] );
+		}
+	}
+	//never drop what was just decoded, even if the view needs more than the budget
+	if (resident <= budget || resident <= ( kdx - kx ) * ( kdy - ky )) {
+		return;
+	}
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			if (x >= kx && x < kdx && y >= ky && y < kdy) {
+				continue;
+			}
+			Tile* tile = tiles[y * w + x];
+			if (tile->IsStreamed() && tile->IsLoaded()) {
+				tile->Unload();
+				resident--;
+			}
+		}
+	}
+}
+
+void TileOverlay::TileChanged(int index)
+{
+	//a door tile may be animated on one side only
+	scheduled = false;
+	if (chunks.empty() || index < 0 || index >= w * h) {
+		return;
+	}
+	int chunksPerRow = ( w + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	int cx = ( index % w ) / TILE_CHUNK;
+	int cy = ( index / w ) / TILE_CHUNK;
+	Sprite2D::FreeSprite( chunks[cy * chunksPerRow + cx] );
+}
+
+/** Sorts out the tiles which can't just stay in the composited chunks once,
+ * so the drawing only has to look at these. The animations keep their own
+ * clocks, so the chunks are only redrawn where a frame actually changed. */
+void TileOverlay::ScheduleTiles()
+{
+	animatedTiles.clear();
+	overlaidTiles.clear();
+	for (int i = 0; i < w * h; i++) {
+		Tile* tile = tiles[i];
+		if (IsOverlaidTile(tile)) {
+			overlaidTiles.push_back(i);
+		} else if (GetTileFrameCount(tile) > 1) {
+			animatedTiles.push_back(i);
+		}
+	}
+	//nothing is in the chunks yet
+	shownFrames.assign(animatedTiles.size(), NULL);
+	scheduled = true;
+}
+
+void TileOverlay::NoteFrame(int index, Sprite2D* frame)
+{
+	std::vector<int>::iterator it = std::lower_bound(animatedTiles.begin(), animatedTiles.end(), index);
+	if (it != animatedTiles.end() && *it == index) {
+		shownFrames[it - animatedTiles.begin()] = frame;
+	}
+}
+
+//draws the animated tiles in view into their chunks, where the frame moved on
+void TileOverlay::UpdateAnimatedTiles(int sx, int sy, int dx, int dy, int flags)
+{
+	Video* vid = core->GetVideoDriver();
+	int chunksPerRow = ( w + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	//the list is by index, so the rows in view are a single stretch
+	size_t i = std::lower_bound(animatedTiles.begin(), animatedTiles.end(), sy * w) - animatedTiles.begin();
+	for (; i < animatedTiles.size(); i++) {
+		int index = animatedTiles[i];
+		int x = index % w;
+		int y = index / w;
+		if (y >= dy) {
+			break;
+		}
+		if (x < sx || x >= dx) {
+			continue;
+		}
+		Tile* tile = tiles[index];
+		LoadTile( tile );
+		Sprite2D* frame = GetTileAnimation(tile)->NextFrame();
+		if (frame == shownFrames[i]) {
+			continue;
+		}
+		Sprite2D* chunk = chunks[( y / TILE_CHUNK ) * chunksPerRow + x / TILE_CHUNK];
+		if (!chunk) {
+			continue;
+		}
+		vid->BlitTileToCache( chunk, frame, 0, ( x % TILE_CHUNK ) * 64, ( y % TILE_CHUNK ) * 64, flags );
+		shownFrames[i] = frame;
+	}
+}
+
+Sprite2D* TileOverlay::ComposeChunk(int cx, int cy, int flags)
+{
+	Video* vid = core->GetVideoDriver();
+	int tx = cx * TILE_CHUNK;
+	int ty = cy * TILE_CHUNK;
+	int tw = ( w - tx < TILE_CHUNK ) ? w - tx : TILE_CHUNK;
+	int th = ( h - ty < TILE_CHUNK ) ? h - ty : TILE_CHUNK;
+
+	Sprite2D* chunk = vid->CreateTileCache( tw * 64, th * 64 );
+	if (!chunk) {
+		return NULL;
+	}
+	for (int y = 0; y < th; y++) {
+		for (int x = 0; x < tw; x++) {
+			Tile* tile = tiles[( ( ty + y ) * w ) + tx + x];
+			LoadTile( tile );
+			//these are drawn over the chunk every frame
+			if (IsOverlaidTile(tile)) {
+				continue;
+			}
+			Sprite2D* frame = GetTileAnimation(tile)->NextFrame();
+			vid->BlitTileToCache( chunk, frame, 0, x * 64, y * 64, flags );
+			if (!IsStaticTile(tile)) {
+				NoteFrame( ( ( ty + y ) * w ) + tx + x, frame );
+			}
+		}
+	}
+	return chunk;
+}
+
+bool TileOverlay::DrawChunks(const Region &viewport, int sx, int sy, int dx, int dy, int flags)
+{
+	if (noChunks) {
+		return false;
+	}
+
+	//the global tint is blended into the chunks too
+	const Color* tint = NULL;
+	Game* game = core->GetGame();
+	if (game) {
+		tint = game->GetSpriteTint();
+	}
+	if (flags != chunkFlags || (tint != NULL) != chunkTinted || (tint && memcmp(tint, &chunkTint, sizeof(Color)))) {
+		ClearChunks();
+		chunkFlags = flags;
+		chunkTinted = tint != NULL;
+		if (tint) {
+			chunkTint = *tint;
+		}
+	}
+
+	int chunksPerRow = ( w + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	int chunkRows = ( h + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	if (chunks.empty()) {
+		chunks.resize( chunksPerRow * chunkRows, NULL );
+	}
+	int csx = sx / TILE_CHUNK;
+	int csy = sy / TILE_CHUNK;
+	int cdx = ( dx + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	int cdy = ( dy + TILE_CHUNK - 1 ) / TILE_CHUNK;
+	if (cdx > chunksPerRow) cdx = chunksPerRow;
+	if (cdy > chunkRows) cdy = chunkRows;
+
+	//keep a ring around the view for scrolling, drop the rest
+	for (int cy = 0; cy < chunkRows; cy++) {
+		for (int cx = 0; cx < chunksPerRow; cx++) {
+			if (cx < csx - 1 || cx > cdx || cy < csy - 1 || cy > cdy) {
+				Sprite2D::FreeSprite( chunks[cy * chunksPerRow + cx] );
+			}
+		}
+	}
+
+	for (int cy = csy; cy < cdy; cy++) {
+		for (int cx = csx; cx < cdx; cx++) {
+			Sprite2D*& chunk = chunks[cy * chunksPerRow + cx];
+			if (!chunk) {
+				chunk = ComposeChunk( cx, cy, flags );
+				if (!chunk) {
+					noChunks = true;
+					return false;
+				}
+			}
+		}
+	}
+	UpdateAnimatedTiles(sx, sy, dx, dy, flags);
+
+	Video* vid = core->GetVideoDriver();
+	for (int cy = csy; cy < cdy; cy++) {
+		for (int cx = csx; cx < cdx; cx++) {
+			vid->BlitSprite( chunks[cy * chunksPerRow + cx], viewport.x + ( cx * TILE_CHUNK * 64 ),
+				viewport.y + ( cy * TILE_CHUNK * 64 ), false, &viewport );
+		}
+	}
+	return true;
+}
+
 void TileOverlay::AddTile(Tile* tile)
 {
 	tiles[count++] = tile;
@@ -89,50 +396,76 @@ void TileOverlay::Draw(Region viewport, std::vector< TileOverlay*> &overlays, in
 	int dx = ( vp.x + vp.w + 63 ) / 64;
 	int dy = ( vp.y + vp.h + 63 ) / 64;
 
-	for (int y = sy; y < dy && y < h; y++) {
-		for (int x = sx; x < dx && x < w; x++) {
-			Tile* tile = tiles[( y* w ) + x];
+	if (source) {
+		StreamTiles(sx, sy, dx, dy);
+	}
+
+	if (!scheduled) {
+		ScheduleTiles();
+	}
+	if (dx > w) dx = w;
+	if (dy > h) dy = h;
 
-			//draw door tiles if there are any
-			Animation* anim = tile->anim[tile->tileIndex];
-			if (!anim && tile->tileIndex) {
-				anim = tile->anim[0];
+	//the static and animated tiles come from the composited chunks, if the driver can make them
+	if (DrawChunks(viewport, sx, sy, dx, dy, flags)) {
+		size_t i = std::lower_bound(overlaidTiles.begin(), overlaidTiles.end(), sy * w) - overlaidTiles.begin();
+		for (; i < overlaidTiles.size(); i++) {
+			int x = overlaidTiles[i] % w;
+			int y = overlaidTiles[i] / w;
+			if (y >= dy) {
+				break;
 			}
-			assert(anim);
-			vid->BlitTile( anim->NextFrame(), 0, viewport.x + ( x * 64 ),
-				viewport.y + ( y * 64 ), &viewport, flags );
-			if (!tile->om || tile->tileIndex) {
-				continue;
+			if (x >= sx && x < dx) {
+				DrawTile(viewport, x, y, overlays, flags);
 			}
+		}
+		return;
+	}
+
+	for (int y = sy; y < dy; y++) {
+		for (int x = sx; x < dx; x++) {
+			DrawTile(viewport, x, y, overlays, flags);
+		}
+	}
+}
+
+void TileOverlay::DrawTile(const Region &viewport, int x, int y, std::vector< TileOverlay*> &overlays, int flags)
+{
+	Video* vid = core->GetVideoDriver();
+	Tile* tile = tiles[( y* w ) + x];
+	Animation* anim = GetTileAnimation(tile);
+	vid->BlitTile( anim->NextFrame(), 0, viewport.x + ( x * 64 ),
+		viewport.y + ( y * 64 ), &viewport, flags );
+	if (!IsOverlaidTile(tile)) {
+		return;
+	}
 
-			//draw overlay tiles, they should be half transparent
-			int mask = 2;
-			for (size_t z = 1;z<overlays.size();z++) {
-				TileOverlay * ov = overlays[z];
-				if (ov && ov->count > 0) {
-					Tile *ovtile = ov->tiles[0]; //allow only 1x1 tiles now
-					if (tile->om & mask) {
-						if (RedrawTile) {
-							vid->BlitTile( ovtile->anim[0]->NextFrame(),
-						                   tile->anim[0]->NextFrame(),
-							               viewport.x + ( x * 64 ),
-							               viewport.y + ( y * 64 ),
-							               &viewport, flags );
-						} else {
-							Sprite2D* mask = 0;
-							if (tile->anim[1])
-								mask = tile->anim[1]->NextFrame();
-							vid->BlitTile( ovtile->anim[0]->NextFrame(),
-						                   mask,
-							               viewport.x + ( x * 64 ),
-							               viewport.y + ( y * 64 ),
-							               &viewport, TILE_HALFTRANS | flags );
-						}
-					}
+	//draw overlay tiles, they should be half transparent
+	int mask = 2;
+	for (size_t z = 1;z<overlays.size();z++) {
+		TileOverlay * ov = overlays[z];
+		if (ov && ov->count > 0) {
+			Tile *ovtile = ov->tiles[0]; //allow only 1x1 tiles now
+			if (tile->om & mask) {
+				if (RedrawTile) {
+					vid->BlitTile( ovtile->anim[0]->NextFrame(),
+					               tile->anim[0]->NextFrame(),
+					               viewport.x + ( x * 64 ),
+					               viewport.y + ( y * 64 ),
+					               &viewport, flags );
+				} else {
+					Sprite2D* mask = 0;
+					if (tile->anim[1])
+						mask = tile->anim[1]->NextFrame();
+					vid->BlitTile( ovtile->anim[0]->NextFrame(),
+					               mask,
+					               viewport.x + ( x * 64 ),
+					               viewport.y + ( y * 64 ),
+					               &viewport, TILE_HALFTRANS | flags );
 				}
-				mask<<=1;
 			}
 		}
+		mask<<=1;
 	}
 }
 
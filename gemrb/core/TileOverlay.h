@@ -23,26 +23,76 @@
 
 #include "exports.h"
 
+#include "PluginMgr.h"
 #include "Tile.h"
+#include "TileSetMgr.h"
 
 #include <vector>
 
 namespace GemRB {
 
+class Sprite2D;
+
 extern bool RedrawTile;
 
+// cells on each side of the composited background chunks
+#define TILE_CHUNK 8
+// streamed tiles decoded around the view, and ahead in the scroll direction
+#define TILE_MARGIN 1
+#define TILE_PREFETCH 4
+
 class GEM_EXPORT TileOverlay {
 public:
 	int w, h;
 	//std::vector<Tile*> tiles;
 	Tile** tiles;
 	int count;
+private:
+	//the static tiles composited a chunk at a time, NULL if not drawn yet
+	std::vector<Sprite2D*> chunks;
+	//what the chunks were drawn with
+	int chunkFlags;
+	Color chunkTint;
+	bool chunkTinted;
+	//the video driver can't composite tiles
+	bool noChunks;
+	//decodes the streamed tiles, NULL if they were all decoded on load
+	PluginHolder<TileSetMgr> source;
+	//the most streamed tiles kept decoded and how many are now
+	int budget;
+	int resident;
+	//the first visible tile when last drawn, for the scroll direction
+	int lastX, lastY;
+	//the animated tiles drawn into the chunks, by index, and the frame each shows there
+	std::vector<int> animatedTiles;
+	std::vector<Sprite2D*> shownFrames;
+	//the tiles under an overlay, blitted every frame
+	std::vector<int> overlaidTiles;
+	//the lists above are up to date
+	bool scheduled;
 public:
 	TileOverlay(int Width, int Height);
 	~TileOverlay(void);
 	void AddTile(Tile* tile);
 	void Draw(Region viewport, std::vector< TileOverlay*> &overlays, int flags);
 	void BumpViewport(const Region &viewport, Region &vp);
+	/* the tile at index changed (a door), its chunk is composited again */
+	void TileChanged(int index);
+	/* drops all the composited chunks */
+	void ClearChunks();
+	/* also unloads the streamed tiles, for low memory, they come back when drawn */
+	void Trim();
+	/* the streamed tiles are decoded from tis, keeping at most budget */
+	void SetTileSource(PluginHolder<TileSetMgr> tis, int budget);
+private:
+	void LoadTile(Tile* tile);
+	void StreamTiles(int sx, int sy, int dx, int dy);
+	void ScheduleTiles();
+	void NoteFrame(int index, Sprite2D* frame);
+	void UpdateAnimatedTiles(int sx, int sy, int dx, int dy, int flags);
+	bool DrawChunks(const Region &viewport, int sx, int sy, int dx, int dy, int flags);
+	Sprite2D* ComposeChunk(int cx, int cy, int flags);
+	void DrawTile(const Region &viewport, int x, int y, std::vector< TileOverlay*> &overlays, int flags);
 };
 
 }
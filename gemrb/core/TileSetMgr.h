@@ -34,6 +34,14 @@ public:
 	virtual bool Open(DataStream* stream) = 0;
 	virtual Tile* GetTile(unsigned short* indexes, int count,
 		unsigned short* secondary = NULL) = 0;
+	/** Returns the number of tiles in the set */
+	virtual unsigned int GetTilesCount() = 0;
+	/** Returns a private copy of the tileset stream for DecodeTiles.
+	 * Create and delete these on the main thread, copies may share data. */
+	virtual DataStream* CloneStream() = 0;
+	/** Decodes the tiles [first, first+count) from 'tiles' ahead of GetTile.
+	 * Worker threads may run it on disjoint ranges at the same time. */
+	virtual void DecodeTiles(DataStream* tiles, unsigned int first, unsigned int count) = 0;
 };
 
 }
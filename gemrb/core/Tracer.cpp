@@ -0,0 +1,171 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "Tracer.h"
+
+#include "System/FileStream.h"
+#include "System/Logging.h"
+#include "System/Thread.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace GemRB {
+
+volatile bool Tracer::enabled = false;
+
+#ifdef USE_TRACING
+
+// events per thread, a power of two
+#define TRACE_RING_SIZE 65536
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+struct TraceEvent {
+	const char *name;
+	char detail[9];
+	unsigned __int64 start;
+	unsigned __int64 duration;
+};
+
+// written by its own thread only, the head just grows
+struct TraceRing {
+	TraceEvent events[TRACE_RING_SIZE];
+	volatile unsigned int head;
+	unsigned int tid;
+};
+
+// the rings live as long as the process, a thread may end with events left to write
+static std::vector<TraceRing*> rings;
+static Mutex ringsLock;
+static TRACE_THREAD_LOCAL TraceRing *threadRing = NULL;
+
+static TraceRing *RegisterThread()
+{
+	TraceRing *ring = new TraceRing();
+	ring->head = 0;
+	MutexLock l(ringsLock);
+	ring->tid = (unsigned int) rings.size() + 1;
+	rings.push_back(ring);
+	return ring;
+}
+
+bool Tracer::Start()
+{
+	enabled = false;
+	{
+		MutexLock l(ringsLock);
+		for (size_t i = 0; i < rings.size(); i++) {
+			rings[i]->head = 0;
+		}
+	}
+	enabled = true;
+	return true;
+}
+
+void Tracer::Add(const char *name, const char *detail, unsigned __int64 start, unsigned __int64 duration)
+{
+	TraceRing *ring = threadRing;
+	if (!ring) {
+		ring = threadRing = RegisterThread();
+	}
+	TraceEvent &event = ring->events[ring->head & (TRACE_RING_SIZE - 1)];
+	event.name = name;
+	event.detail[0] = 0;
+	if (detail) {
+		// the names go into the JSON as they are, keep them plain
+		int j = 0;
+		for (int i = 0; i < 8 && detail[i]; i++) {
+			if (detail[i] != '"' && detail[i] != '\\' && (unsigned char) detail[i] >= ' ') {
+				event.detail[j++] = detail[i];
+			}
+		}
+		event.detail[j] = 0;
+	}
+	event.start = start;
+	event.duration = duration;
+	ring->head++;
+}
+
+bool Tracer::Stop(const char *path)
+{
+	enabled = false;
+
+	FileStream out;
+	if (!out.Create(path)) {
+		Log(ERROR, "Tracer", "Couldn't create '%s'!", path);
+		return false;
+	}
+
+	char line[256];
+	bool first = true;
+	unsigned int written = 0;
+	out.Write("{\"traceEvents\":[\n", 17);
+	MutexLock l(ringsLock);
+	for (size_t r = 0; r < rings.size(); r++) {
+		const TraceRing *ring = rings[r];
+		unsigned int head = ring->head;
+		unsigned int count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+		for (unsigned int i = head - count; i != head; i++) {
+			const TraceEvent &event = ring->events[i & (TRACE_RING_SIZE - 1)];
+			// chrome wants microseconds
+			int len = snprintf(line, sizeof(line),
+				"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+				first ? "" : ",\n", event.name, ring->tid,
+				event.start / 1000.0, event.duration / 1000.0);
+			if (event.detail[0]) {
+				len += snprintf(line + len, sizeof(line) - len, ",\"args\":{\"detail\":\"%s\"}}", event.detail);
+			} else {
+				len += snprintf(line + len, sizeof(line) - len, "}");
+			}
+			out.Write(line, (unsigned int) len);
+			first = false;
+			written++;
+		}
+	}
+	out.Write("\n],\"displayTimeUnit\":\"ms\"}\n", 27);
+	Log(MESSAGE, "Tracer", "Wrote %u events from %d threads to '%s'.", written, (int) rings.size(), path);
+	return true;
+}
+
+#else
+
+bool Tracer::Start()
+{
+	Log(WARNING, "Tracer", "Not compiled in, rebuild with USE_TRACING.");
+	return false;
+}
+
+bool Tracer::Stop(const char * /*path*/)
+{
+	return false;
+}
+
+void Tracer::Add(const char * /*name*/, const char * /*detail*/, unsigned __int64 /*start*/, unsigned __int64 /*duration*/)
+{
+}
+
+#endif
+
+}
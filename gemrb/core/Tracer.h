@@ -0,0 +1,79 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "exports.h"
+#include "ie_types.h"
+
+#include "GameScript/ScriptProfiler.h"
+
+#include <cstddef>
+
+namespace GemRB {
+
+/* Timeline of the engine, written as Chrome trace JSON (chrome://tracing, Perfetto)
+ * Each thread records the scopes it leaves into its own ring buffer, so the
+ * recording takes no locks; a full ring drops its oldest events. Only compiled
+ * in with USE_TRACING, otherwise the TRACE_SCOPE macros expand to nothing and
+ * Start refuses.
+ */
+class GEM_EXPORT Tracer {
+public:
+	/** forgets the earlier events and starts recording */
+	static bool Start();
+	/** stops recording and writes the events to path, keeping them until the next Start */
+	static bool Stop(const char *path);
+	static bool IsEnabled() { return enabled; }
+	/** a finished scope, name has to be a literal, detail is copied */
+	static void Add(const char *name, const char *detail, unsigned __int64 start, unsigned __int64 duration);
+private:
+	static volatile bool enabled;
+};
+
+/* One scope, timed from its creation to its destruction */
+class TraceScope {
+public:
+	TraceScope(const char *name, const char *detail = NULL)
+		: name(name), detail(detail), start(Tracer::IsEnabled() ? ScriptProfiler::Now() : 0) {}
+	~TraceScope()
+	{
+		if (start) {
+			Tracer::Add(name, detail, start, ScriptProfiler::Now() - start);
+		}
+	}
+private:
+	const char *name;
+	const char *detail;
+	unsigned __int64 start;
+};
+
+#ifdef USE_TRACING
+#define TRACE_SCOPE(name) TraceScope traceScope(name)
+#define TRACE_SCOPE_DETAIL(name, detail) TraceScope traceScope(name, detail)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_DETAIL(name, detail)
+#endif
+
+}
+
+#endif
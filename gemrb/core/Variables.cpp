@@ -22,12 +22,16 @@
 
 #include "Interface.h" // for LoadInitialValues
 #include "System/FileStream.h" // for LoadInitialValues
+#include "System/Thread.h"
+
+#include <map>
+#include <string>
 
 namespace GemRB {
 
 /////////////////////////////////////////////////////////////////////////////
 // private inlines 
-inline bool Variables::MyCopyKey(char*& dest, const char* key) const
+inline bool Variables::MyCopyKey(char*& dest, const char* key)
 {
 	int i, j;
 
@@ -49,16 +53,15 @@ inline bool Variables::MyCopyKey(char*& dest, const char* key) const
 	return true;
 }
 
+// key is a stored one, those are already lowercase and without spaces
 inline unsigned int Variables::MyCompareKey(const char* key, const char *str) const
 {
 	int i,j;
 
 	for (i = 0, j = 0; str[j] && key[i] && i < MAX_VARIABLE_LENGTH - 1 && j < MAX_VARIABLE_LENGTH - 1;) {
-		char c1 = tolower(key[i]);
-		if (c1 == ' ') { i++; continue; }
-		char c2 = tolower(str[j]);
+		char c2 = str[j];
 		if (c2 ==' ')  { j++; continue; }
-		if (c1!=c2) return 1;
+		if (key[i] != tolower(c2)) return 1;
 		i++;
 		j++;
 	}
@@ -66,7 +69,7 @@ inline unsigned int Variables::MyCompareKey(const char* key, const char *str) co
 	return 0;
 }
 
-inline unsigned int Variables::MyHashKey(const char* key) const
+inline unsigned int Variables::MyHashKey(const char* key)
 {
 	unsigned int nHash = 0;
 	for (int i = 0; key[i] && i < MAX_VARIABLE_LENGTH; i++) {
@@ -76,6 +79,45 @@ inline unsigned int Variables::MyHashKey(const char* key) const
 	}
 	return nHash;
 }
+
+inline ieDword Variables::GetAssocValue(const Variables::MyAssoc* pAssoc) const
+{
+	if (m_lUseSlots) {
+		return m_slotValues[pAssoc->nSlot];
+	}
+	return pAssoc->Value.nValue;
+}
+
+inline void Variables::SetAssocValue(Variables::MyAssoc* pAssoc, ieDword value)
+{
+	if (!m_lUseSlots) {
+		pAssoc->Value.nValue = value;
+		return;
+	}
+	unsigned int slot = pAssoc->nSlot;
+	if (slot >= m_slotValues.size()) {
+		m_slotValues.resize(slot + 1, 0);
+		m_slotUsed.resize(slot + 1, 0);
+	}
+	m_slotValues[slot] = value;
+	m_slotUsed[slot] = 1;
+}
+inline bool Variables::IsLive(const Variables::MyAssoc* pAssoc)
+{
+	return pAssoc->key && pAssoc->key != DeletedKey;
+}
+
+// the tables start small and grow, there is one for the locals of every actor
+#define INITIAL_CAPACITY_LIMIT 64
+
+static unsigned int InitialCapacity(unsigned int hint)
+{
+	unsigned int capacity = 16;
+	while (capacity < hint && capacity < INITIAL_CAPACITY_LIMIT) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
 /////////////////////////////////////////////////////////////////////////////
 // functions
 Variables::iterator Variables::GetNextAssoc(iterator rNextPosition, const char*& rKey,
@@ -83,29 +125,60 @@ Variables::iterator Variables::GetNextAssoc(iterator rNextPosition, const char*&
 {
 	assert( m_pHashTable != NULL ); // never call on empty map
 
-	Variables::MyAssoc* pAssocRet = ( Variables::MyAssoc* ) rNextPosition;
+	Variables::MyAssoc* pAssocRet = rNextPosition;
+	Variables::MyAssoc* pEnd = m_pHashTable + m_nHashTableSize;
 
 	if (pAssocRet == NULL) {
 		// find the first association
-		for (unsigned int nBucket = 0; nBucket < m_nHashTableSize; nBucket++)
-			if (( pAssocRet = m_pHashTable[nBucket] ) != NULL)
+		for (pAssocRet = m_pHashTable; pAssocRet < pEnd; pAssocRet++)
+			if (IsLive(pAssocRet))
 				break;
-		assert( pAssocRet != NULL ); // must find something
+		assert( pAssocRet < pEnd ); // must find something
 	}
+	// the entries are stored next to each other, so this is a plain scan
 	Variables::MyAssoc* pAssocNext;
-	if (( pAssocNext = pAssocRet->pNext ) == NULL) {
-		// go to next bucket
-		for (unsigned int nBucket = pAssocRet->nHashValue + 1;
-			nBucket < m_nHashTableSize;
-			nBucket++)
-			if (( pAssocNext = m_pHashTable[nBucket] ) != NULL)
-				break;
+	for (pAssocNext = pAssocRet + 1; pAssocNext < pEnd; pAssocNext++)
+		if (IsLive(pAssocNext))
+			break;
+	if (pAssocNext == pEnd) {
+		pAssocNext = NULL;
 	}
 
 	// fill in return data
 	rKey = pAssocRet->key;
-	rValue = pAssocRet->Value.nValue;
-	return ( iterator ) pAssocNext;
+	rValue = GetAssocValue(pAssocRet);
+	return pAssocNext;
+}
+
+unsigned int Variables::changeCount = 0;
+char Variables::DeletedKey[1];
+
+// the keys are shared by all the tables, so a slot means the same name everywhere
+static std::map<std::string, VariableKey> InternedKeys;
+static Mutex InternedKeysLock;
+
+const VariableKey* Variables::InternKey(const char* key)
+{
+	char *name;
+	if (!MyCopyKey(name, key)) {
+		return NULL;
+	}
+	MutexLock lock(InternedKeysLock);
+	std::map<std::string, VariableKey>::iterator it = InternedKeys.find(name);
+	if (it == InternedKeys.end()) {
+		VariableKey newKey;
+		newKey.hash = MyHashKey(name);
+		newKey.slot = (unsigned int) InternedKeys.size();
+		it = InternedKeys.insert(std::make_pair(std::string(name), newKey)).first;
+		it->second.name = it->first.c_str();
+	}
+	free(name);
+	return &it->second;
+}
+
+unsigned int Variables::HashKey(const char* key)
+{
+	return MyHashKey(key);
 }
 
 Variables::Variables(int nBlockSize, int nHashTableSize)
@@ -115,12 +188,11 @@ Variables::Variables(int nBlockSize, int nHashTableSize)
 
 	m_pHashTable = NULL;
 	m_nHashTableSize = nHashTableSize; // default size
+	m_nUsed = 0;
 	m_nCount = 0;
 	m_lParseKey = false;
-	m_pFreeList = NULL;
-	m_pBlocks = NULL;
-	m_nBlockSize = nBlockSize;
 	m_type = GEM_VARIABLES_INT;
+	m_lUseSlots = false;
 }
 
 void Variables::InitHashTable(unsigned int nHashSize, bool bAllocNow)
@@ -136,37 +208,64 @@ void Variables::InitHashTable(unsigned int nHashSize, bool bAllocNow)
 		free(m_pHashTable);
 		m_pHashTable = NULL;
 	}
+	m_nHashTableSize = nHashSize;
+	m_nUsed = 0;
 
 	if (bAllocNow) {
-		m_pHashTable =(Variables::MyAssoc **) malloc(sizeof( Variables::MyAssoc *) * nHashSize);
-		memset( m_pHashTable, 0, sizeof( Variables::MyAssoc * ) * nHashSize );
+		Rehash(InitialCapacity(nHashSize));
 	}
-	m_nHashTableSize = nHashSize;
+}
+
+// moves the live entries into a new table, the removed ones are left behind
+void Variables::Rehash(unsigned int capacity)
+{
+	Variables::MyAssoc* pOld = m_pHashTable;
+	unsigned int nOldSize = m_nHashTableSize;
+
+	m_pHashTable = (Variables::MyAssoc *) calloc(capacity, sizeof(Variables::MyAssoc));
+	assert( m_pHashTable != NULL );
+	m_nHashTableSize = capacity;
+	m_nUsed = m_nCount;
+	if (pOld == NULL) {
+		return;
+	}
+
+	unsigned int mask = capacity - 1;
+	for (unsigned int i = 0; i < nOldSize; i++) {
+		if (!IsLive(pOld + i)) {
+			continue;
+		}
+		// the stored hash spares hashing the keys again
+		unsigned int n = pOld[i].nHash & mask;
+		while (m_pHashTable[n].key) {
+			n = (n + 1) & mask;
+		}
+		m_pHashTable[n] = pOld[i];
+	}
+	free(pOld);
 }
 
 void Variables::RemoveAll(ReleaseFun fun)
 {
+	changeCount++;
 	if (m_pHashTable != NULL) {
 		// destroy elements (values and keys)
 		for (unsigned int nHash = 0; nHash < m_nHashTableSize; nHash++) {
-			Variables::MyAssoc* pAssoc;
-			for (pAssoc = m_pHashTable[nHash];
-				pAssoc != NULL;
-				pAssoc = pAssoc->pNext) {
-				if (fun) {
-					fun((void *) pAssoc->Value.sValue);
-				}
-				else if (m_type == GEM_VARIABLES_STRING) {
-					if (pAssoc->Value.sValue) {
-						free( pAssoc->Value.sValue );
-						pAssoc->Value.sValue = NULL;
-					}
-				}
-				if (pAssoc->key) {
-					free(pAssoc->key);
-					pAssoc->key = NULL;
+			Variables::MyAssoc* pAssoc = m_pHashTable + nHash;
+			if (!IsLive(pAssoc)) {
+				continue;
+			}
+			if (fun) {
+				fun((void *) pAssoc->Value.sValue);
+			}
+			else if (m_type == GEM_VARIABLES_STRING) {
+				if (pAssoc->Value.sValue) {
+					free( pAssoc->Value.sValue );
+					pAssoc->Value.sValue = NULL;
 				}
 			}
+			free(pAssoc->key);
+			pAssoc->key = NULL;
 		}
 	}
 
@@ -175,14 +274,9 @@ void Variables::RemoveAll(ReleaseFun fun)
 	m_pHashTable = NULL;
 
 	m_nCount = 0;
-	m_pFreeList = NULL;
-	MemBlock* p = m_pBlocks;
-	while (p != NULL) {
-		MemBlock* pNext = p->pNext;
-		free(p);
-		p = pNext;
-	}
-	m_pBlocks = NULL;
+	m_nUsed = 0;
+	m_slotValues.clear();
+	m_slotUsed.clear();
 }
 
 Variables::~Variables()
@@ -190,25 +284,30 @@ Variables::~Variables()
 	RemoveAll(NULL);
 }
 
-Variables::MyAssoc* Variables::NewAssoc(const char* key)
+// the key must not be in the table yet
+Variables::MyAssoc* Variables::NewAssoc(const char* key, unsigned int nHash)
 {
-	if (m_pFreeList == NULL) {
-		// add another block
-		Variables::MemBlock* newBlock = ( Variables::MemBlock* ) malloc( m_nBlockSize*sizeof( Variables::MyAssoc ) + sizeof( Variables::MemBlock ));
-		assert( newBlock != NULL ); // we must have something
-		newBlock->pNext = m_pBlocks;
-		m_pBlocks = newBlock;
-
-		// chain them into free list
-		Variables::MyAssoc* pAssoc = ( Variables::MyAssoc* ) ( newBlock + 1 );
-		for (int i = 0; i < m_nBlockSize; i++) {
-			pAssoc->pNext = m_pFreeList;
-			m_pFreeList = pAssoc++;
+	if (m_pHashTable == NULL) {
+		Rehash(InitialCapacity(m_nHashTableSize));
+	} else if ((m_nUsed + 1) * 4 > m_nHashTableSize * 3) {
+		// grow, unless it is mostly removed entries that fill the table
+		unsigned int capacity = m_nHashTableSize;
+		if ((unsigned int) (m_nCount + 1) * 2 > capacity) {
+			capacity <<= 1;
 		}
+		Rehash(capacity);
+	}
+
+	unsigned int mask = m_nHashTableSize - 1;
+	unsigned int n = nHash & mask;
+	// a removed entry is as good as a free one here
+	while (IsLive(m_pHashTable + n)) {
+		n = (n + 1) & mask;
+	}
+	Variables::MyAssoc* pAssoc = m_pHashTable + n;
+	if (!pAssoc->key) {
+		m_nUsed++;
 	}
-	
-	Variables::MyAssoc* pAssoc = m_pFreeList;
-	m_pFreeList = m_pFreeList->pNext;
 	m_nCount++;
 	assert( m_nCount > 0 ); // make sure we don't overflow
 	if (m_lParseKey) {
@@ -222,21 +321,22 @@ Variables::MyAssoc* Variables::NewAssoc(const char* key)
 			pAssoc->key[len] = 0;
 		}
 	}
-#ifdef _DEBUG
-	pAssoc->Value.nValue = 0xcccccccc; //invalid value
-	pAssoc->nHashValue = 0xcccccccc; //invalid value
-#endif
+	pAssoc->nHash = nHash;
+	pAssoc->Value.nValue = 0;
+	if (m_lUseSlots && pAssoc->key) {
+		pAssoc->nSlot = InternKey(pAssoc->key)->slot;
+	}
 	return pAssoc;
 }
 
 void Variables::FreeAssoc(Variables::MyAssoc* pAssoc)
 {
-	if (pAssoc->key) {
-		free(pAssoc->key);
-		pAssoc->key = NULL;
+	if (m_lUseSlots && pAssoc->nSlot < m_slotUsed.size()) {
+		m_slotUsed[pAssoc->nSlot] = 0;
 	}
-	pAssoc->pNext = m_pFreeList;
-	m_pFreeList = pAssoc;
+	free(pAssoc->key);
+	// keeps the probe sequences running through it intact
+	pAssoc->key = DeletedKey;
 	m_nCount--;
 	assert( m_nCount >= 0 ); // make sure we don't underflow
 
@@ -249,17 +349,26 @@ void Variables::FreeAssoc(Variables::MyAssoc* pAssoc)
 Variables::MyAssoc* Variables::GetAssocAt(const char* key, unsigned int& nHash) const
 	// find association (or return NULL)
 {
-	nHash = MyHashKey( key ) % m_nHashTableSize;
+	nHash = MyHashKey( key );
+	return FindAssoc( key, nHash );
+}
 
+Variables::MyAssoc* Variables::FindAssoc(const char* key, unsigned int nHash) const
+{
 	if (m_pHashTable == NULL) {
 		return NULL;
 	}
 
-	// see if it exists
-	Variables::MyAssoc* pAssoc;
-	for (pAssoc = m_pHashTable[nHash];
-		pAssoc != NULL;
-		pAssoc = pAssoc->pNext) {
+	// see if it exists, there is always a free entry to stop at
+	unsigned int mask = m_nHashTableSize - 1;
+	for (unsigned int n = nHash & mask; ; n = (n + 1) & mask) {
+		Variables::MyAssoc* pAssoc = m_pHashTable + n;
+		if (!pAssoc->key) {
+			return NULL;
+		}
+		if (pAssoc->key == DeletedKey || pAssoc->nHash != nHash) {
+			continue;
+		}
 		if (m_lParseKey) {
 			if (!MyCompareKey( pAssoc->key, key) ) {
 				return pAssoc;
@@ -270,8 +379,6 @@ Variables::MyAssoc* Variables::GetAssocAt(const char* key, unsigned int& nHash)
 			}
 		}
 	}
-
-	return NULL;
 }
 
 int Variables::GetValueLength(const char* key) const
@@ -334,10 +441,42 @@ bool Variables::Lookup(const char* key, ieDword& rValue) const
 		return false;
 	} // not in map
 
+	rValue = GetAssocValue(pAssoc);
+	return true;
+}
+
+bool Variables::Lookup(const VariableKey& key, ieDword& rValue) const
+{
+	assert(m_type==GEM_VARIABLES_INT);
+	if (m_lUseSlots) {
+		if (key.slot >= m_slotUsed.size() || !m_slotUsed[key.slot]) {
+			return false;
+		}
+		rValue = m_slotValues[key.slot];
+		return true;
+	}
+	// the name is already normalized and hashed
+	Variables::MyAssoc* pAssoc = FindAssoc( key.name, key.hash );
+	if (pAssoc == NULL) {
+		return false;
+	}
+
 	rValue = pAssoc->Value.nValue;
 	return true;
 }
 
+bool Variables::Lookup(const char* key, unsigned int hash, ieDword& rValue) const
+{
+	assert(m_type==GEM_VARIABLES_INT);
+	Variables::MyAssoc* pAssoc = FindAssoc( key, hash );
+	if (pAssoc == NULL) {
+		return false;
+	}
+
+	rValue = GetAssocValue(pAssoc);
+	return true;
+}
+
 void Variables::SetAtCopy(const char* key, const char* value)
 {
 	size_t len = strlen(value)+1;
@@ -367,14 +506,8 @@ void Variables::SetAt(const char* key, char* value)
 
 	assert( m_type == GEM_VARIABLES_STRING );
 	if (( pAssoc = GetAssocAt( key, nHash ) ) == NULL) {
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssoc( key, nHash );
 	} else {
 		if (pAssoc->Value.sValue) {
 			free( pAssoc->Value.sValue );
@@ -385,7 +518,6 @@ void Variables::SetAt(const char* key, char* value)
 	//set value only if we have a key
 	if (pAssoc->key) {
 		pAssoc->Value.sValue = value;
-		pAssoc->nHashValue = nHash;
 	}
 }
 
@@ -396,14 +528,8 @@ void Variables::SetAt(const char* key, void* value)
 
 	assert( m_type == GEM_VARIABLES_POINTER );
 	if (( pAssoc = GetAssocAt( key, nHash ) ) == NULL) {
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssoc( key, nHash );
 	} else {
 		if (pAssoc->Value.sValue) {
 			free( pAssoc->Value.sValue );
@@ -414,7 +540,6 @@ void Variables::SetAt(const char* key, void* value)
 	//set value only if we have a key
 	if (pAssoc->key) {
 		pAssoc->Value.pValue = value;
-		pAssoc->nHashValue = nHash;
 	}
 
 }
@@ -432,22 +557,28 @@ void Variables::SetAt(const char* key, ieDword value, bool nocreate)
 			return;
 		}
 
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssoc( key, nHash );
 	}
 	//set value only if we have a key
 	if (pAssoc->key) {
-		pAssoc->Value.nValue = value;
-		pAssoc->nHashValue = nHash;
+		SetAssocValue(pAssoc, value);
+		changeCount++;
 	}
 }
 
+void Variables::SetAt(const VariableKey& key, ieDword value, bool nocreate)
+{
+	assert( m_type == GEM_VARIABLES_INT );
+	if (m_lUseSlots && key.slot < m_slotUsed.size() && m_slotUsed[key.slot]) {
+		m_slotValues[key.slot] = value;
+		changeCount++;
+		return;
+	}
+	// new variables (and the tables without slots) go through the index
+	SetAt( key.name, value, nocreate );
+}
+
 void Variables::Remove(const char* key)
 {
 	unsigned int nHash;
@@ -455,23 +586,7 @@ void Variables::Remove(const char* key)
 
 	pAssoc = GetAssocAt( key, nHash );
 	if (!pAssoc) return; // not in there
-
-	if (pAssoc == m_pHashTable[nHash]) {
-		// head
-		m_pHashTable[nHash] = pAssoc->pNext;
-	} else {
-		Variables::MyAssoc* prev = m_pHashTable[nHash];
-		// Room for optimization: make each bucket a doubly linked
-		// list to make removes from a bucket O(1).
-		// (This will have limited use in gemrb's case, because we
-		// use relatively large tables and small buckets.)
-		while (prev->pNext != pAssoc) {
-			prev = prev->pNext;
-			assert( prev != NULL );
-		}
-		prev->pNext = pAssoc->pNext;		
-	}
-	pAssoc->pNext = 0;
+	changeCount++;
 	FreeAssoc(pAssoc);
 }
 
@@ -524,20 +639,24 @@ void Variables::DebugDump()
 	default:
 		poi = "invalid";
 	}
-	Log (DEBUG, "Variables", "Item type: %s", poi);
-	Log (DEBUG, "Variables", "Item count: %d", m_nCount);
-	Log (DEBUG, "Variables", "HashTableSize: %d\n", m_nHashTableSize);
+	LogDebug ("Variables", "Item type: %s", poi);
+	LogDebug ("Variables", "Item count: %d", m_nCount);
+	LogDebug ("Variables", "HashTableSize: %d\n", m_nHashTableSize);
+	if (!m_pHashTable) {
+		return;
+	}
 	for (unsigned int nHash = 0; nHash < m_nHashTableSize; nHash++) {
-		Variables::MyAssoc* pAssoc;
-		for (pAssoc = m_pHashTable[nHash]; pAssoc != NULL; pAssoc = pAssoc->pNext) {
-			switch(m_type) {
-			case GEM_VARIABLES_STRING:
-				Log (DEBUG, "Variables", "%s = %s", pAssoc->key, pAssoc->Value.sValue);
-				break;
-			default:
-				Log (DEBUG, "Variables", "%s = %d", pAssoc->key, pAssoc->Value.nValue);
-				break;
-			}
+		Variables::MyAssoc* pAssoc = m_pHashTable + nHash;
+		if (!IsLive(pAssoc)) {
+			continue;
+		}
+		switch(m_type) {
+		case GEM_VARIABLES_STRING:
+			LogDebug ("Variables", "%s = %s", pAssoc->key, pAssoc->Value.sValue);
+			break;
+		default:
+			LogDebug ("Variables", "%s = %d", pAssoc->key, GetAssocValue(pAssoc));
+			break;
 		}
 	}
 }
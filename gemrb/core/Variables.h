@@ -28,6 +28,7 @@
 #include "win32def.h"
 
 #include <cassert>
+#include <vector>
 
 namespace GemRB {
 
@@ -39,28 +40,37 @@ typedef void (*ReleaseFun)(void *);
 #define GEM_VARIABLES_STRING   1
 #define GEM_VARIABLES_POINTER  2
 
+// an interned (normalized) variable name, resolved once by the scripts
+struct VariableKey {
+	const char* name;
+	unsigned int hash;
+	// index into the dense values of the tables using slots
+	unsigned int slot;
+};
+
 class GEM_EXPORT Variables {
 protected:
-	// Association
+	// Association, one entry of the open addressing table
+	// a NULL key marks a free entry, DeletedKey a removed one
 	class MyAssoc {
-		MyAssoc* pNext;
 		char* key;
+		// the full hash, compared before the keys are
+		unsigned int nHash;
+		unsigned int nSlot;
 		union {
 			ieDword nValue;
 			char* sValue;
 			void* pValue;
 		} Value;
-		unsigned long nHashValue;
 		friend class Variables;
 	};
-	struct MemBlock {
-		MemBlock* pNext;
-	};
 public:
 	// abstract iteration position
 	typedef MyAssoc *iterator;
 public:
 	// Construction
+	//the block size is unused, the table size is the initial capacity (up to a small limit),
+	//the table grows as needed
 	Variables(int nBlockSize = 10, int nHashTableSize = 2049);
 	void LoadInitialValues(const char* name);
 
@@ -78,6 +88,14 @@ public:
 	{
 		m_type = type;
 	}
+	//keeps the values of the (parsed, ieDword) keys in a dense array indexed by VariableKey::slot,
+	//the hash table stays as the index for the name based access
+	//you should set this only on an empty mapping
+	inline void UseSlots()
+	{
+		assert( m_nCount == 0 && m_lParseKey && m_type == GEM_VARIABLES_INT );
+		m_lUseSlots = true;
+	}
 	inline int GetCount() const
 	{
 		return m_nCount;
@@ -93,6 +111,9 @@ public:
 	bool Lookup(const char* key, ieDword& rValue) const;
 	bool Lookup(const char* key, char*& dest) const;
 	bool Lookup(const char* key, void*& dest) const;
+	bool Lookup(const VariableKey& key, ieDword& rValue) const;
+	//hash is what HashKey returned for the key
+	bool Lookup(const char* key, unsigned int hash, ieDword& rValue) const;
 
 	// Operations
 	void SetAtCopy(const char* key, const char* newValue);
@@ -100,6 +121,7 @@ public:
 	void SetAt(const char* key, char* newValue);
 	void SetAt(const char* key, void* newValue);
 	void SetAt(const char* key, ieDword newValue, bool nocreate=false);
+	void SetAt(const VariableKey& key, ieDword newValue, bool nocreate=false);
 	void Remove(const char* key);
 	void RemoveAll(ReleaseFun fun);
 	void InitHashTable(unsigned int hashSize, bool bAllocNow = true);
@@ -107,25 +129,41 @@ public:
 	iterator GetNextAssoc(iterator rNextPosition, const char*& rKey,
 		ieDword& rValue) const;
 
+	// bumped whenever a value changes in any of the mappings, for the checks done in advance
+	static unsigned int GetChangeCount() { return changeCount; }
+	// the shared key of a variable name, its slot is the same in every table
+	static const VariableKey* InternKey(const char* key);
+	// the hash of a name, to be done once for names looked up often
+	static unsigned int HashKey(const char* key);
+
 	// Debugging
 	void DebugDump();
 	// Implementation
 protected:
-	Variables::MyAssoc** m_pHashTable;
-	unsigned int m_nHashTableSize;
+	Variables::MyAssoc* m_pHashTable;
+	unsigned int m_nHashTableSize; //a power of two once allocated
+	unsigned int m_nUsed; //live and removed entries, the probes stop only at free ones
 	bool m_lParseKey;
 	int m_nCount;
-	Variables::MyAssoc* m_pFreeList;
-	MemBlock* m_pBlocks;
-	int m_nBlockSize;
 	int m_type; //could be string or ieDword 
+	bool m_lUseSlots;
+	std::vector<ieDword> m_slotValues;
+	std::vector<unsigned char> m_slotUsed;
+	static unsigned int changeCount;
+
+	static char DeletedKey[1];
 
-	Variables::MyAssoc* NewAssoc(const char* key);
+	Variables::MyAssoc* NewAssoc(const char* key, unsigned int nHash);
 	void FreeAssoc(Variables::MyAssoc*);
+	void Rehash(unsigned int capacity);
+	static inline bool IsLive(const Variables::MyAssoc*);
 	Variables::MyAssoc* GetAssocAt(const char*, unsigned int&) const;
-	inline bool MyCopyKey(char*& dest, const char* key) const;
+	Variables::MyAssoc* FindAssoc(const char*, unsigned int) const;
+	static inline bool MyCopyKey(char*& dest, const char* key);
 	inline unsigned int MyCompareKey(const char* key, const char *str) const;
-	inline unsigned int MyHashKey(const char*) const;
+	static inline unsigned int MyHashKey(const char*);
+	inline ieDword GetAssocValue(const Variables::MyAssoc* pAssoc) const;
+	inline void SetAssocValue(Variables::MyAssoc* pAssoc, ieDword value);
 
 public:
 	~Variables();
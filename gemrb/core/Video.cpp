@@ -26,6 +26,7 @@
 #include "Palette.h"
 #include "Sprite2D.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace GemRB {
@@ -41,6 +42,7 @@ Video::Video(void)
 	Cursor[VID_CUR_DRAG] = NULL;
 
 	EvntManager = NULL;
+	drawingOverlays = false;
 	// MOUSE_GRAYED and MOUSE_DISABLED are the first 2 bits so shift the config value away from those.
 	// we care only about 2 bits at the moment so mask out the remainder
 	MouseFlags = ((core->MouseFeedback & 0x3) << 2);
@@ -56,6 +58,7 @@ Video::Video(void)
 	fullscreen = false;
 	subtitlefont = NULL;
 	subtitlepal = NULL;
+	pendingScreenshot = NULL;
 }
 
 Region Video::ClippedDrawingRect(const Region& target, const Region* clip) const
@@ -73,6 +76,13 @@ Region Video::ClippedDrawingRect(const Region& target, const Region* clip) const
 	return r;
 }
 
+void Video::DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped)
+{
+	for (size_t i = 0; i < points.size(); i++) {
+		SetPixel(points[i].x, points[i].y, color, clipped);
+	}
+}
+
 void Video::SetScreenClip(const Region* clip)
 {
 	screenClip = Region(0,0, width, height);
@@ -81,6 +91,67 @@ void Video::SetScreenClip(const Region* clip)
 	}
 }
 
+// more separate regions than this aren't worth the bookkeeping, they are
+// merged into their bounding box
+#define MAX_DIRTY_REGIONS 16
+
+static Region EnclosingRegion(const Region& a, const Region& b)
+{
+	int x = std::min(a.x, b.x);
+	int y = std::min(a.y, b.y);
+	return Region(x, y, std::max(a.x + a.w, b.x + b.w) - x, std::max(a.y + a.h, b.y + b.h) - y);
+}
+
+void Video::MarkDirty(const Region& rgn)
+{
+	Region r = rgn.Intersect(Region(0, 0, width, height));
+	if (r.w <= 0 || r.h <= 0) {
+		return;
+	}
+	if (drawingOverlays) {
+		overlayRegions.push_back(r);
+	}
+
+	// fold in everything the new region touches, until nothing does
+	std::vector<Region>::iterator it = dirtyRegions.begin();
+	while (it != dirtyRegions.end()) {
+		if (it->IntersectsRegion(r)) {
+			r = EnclosingRegion(r, *it);
+			dirtyRegions.erase(it);
+			it = dirtyRegions.begin();
+		} else {
+			++it;
+		}
+	}
+	dirtyRegions.push_back(r);
+
+	if (dirtyRegions.size() > MAX_DIRTY_REGIONS) {
+		r = Region::RegionEnclosingRegions(dirtyRegions);
+		dirtyRegions.assign(1, r);
+	}
+}
+
+void Video::MarkScreenDirty()
+{
+	MarkDirty(Region(0, 0, width, height));
+}
+
+bool Video::IsDirty(const Region& rgn) const
+{
+	std::vector<Region>::const_iterator it;
+	for (it = dirtyRegions.begin(); it != dirtyRegions.end(); ++it) {
+		if (it->IntersectsRegion(rgn)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void Video::ClearDirty()
+{
+	dirtyRegions.clear();
+}
+
 bool Video::ToggleFullscreenMode()
 {
 	return SetFullscreenMode(!fullscreen);
@@ -259,6 +330,19 @@ Sprite2D* Video::CreateAlpha( const Sprite2D *sprite)
 		0x00FF0000, 0x0000FF00, 0x000000FF, pixels );
 }
 
+void Video::StartScreenshot(const Region& r)
+{
+	Sprite2D::FreeSprite(pendingScreenshot);
+	pendingScreenshot = GetScreenshot(r);
+}
+
+Sprite2D* Video::FinishScreenshot()
+{
+	Sprite2D* screenshot = pendingScreenshot;
+	pendingScreenshot = NULL;
+	return screenshot;
+}
+
 Sprite2D* Video::SpriteScaleDown( const Sprite2D* sprite, unsigned int ratio )
 {
 	unsigned int Width = sprite->Width / ratio;
@@ -33,6 +33,8 @@
 #include "Polygon.h"
 #include "ScriptedAnimation.h"
 
+#include <vector>
+
 namespace GemRB {
 
 class EventMgr;
@@ -108,8 +110,17 @@ protected:
 	Palette *subtitlepal;
 	Region subtitleregion;
 	Color fadeColor;
+	// damage tracking: the parts of the back buffer changed since the last SwapBuffers
+	std::vector<Region> dirtyRegions;
+	// the parts of the presented frame the cursor and tooltips were drawn over
+	std::vector<Region> overlayRegions;
+	bool drawingOverlays;
+	// the screenshot StartScreenshot took for the drivers that can't defer it
+	Sprite2D* pendingScreenshot;
 protected:
 	Region ClippedDrawingRect(const Region& target, const Region* clip = NULL) const;
+	/** Forgets the dirty regions, once they were presented */
+	void ClearDirty();
 public:
 	Video(void);
 	virtual ~Video(void) {};
@@ -130,7 +141,8 @@ public:
 
 	void InitSpriteCover(SpriteCover* sc, int flags);
 	void AddPolygonToSpriteCover(SpriteCover* sc, Wall_Polygon* poly);
-	void DestroySpriteCover(SpriteCover* sc);
+	/** drivers that draw later have to finish with the cover first */
+	virtual void DestroySpriteCover(SpriteCover* sc);
 
 	virtual Sprite2D* CreateSprite(int w, int h, int bpp, ieDword rMask,
 		ieDword gMask, ieDword bMask, ieDword aMask, void* pixels,
@@ -143,6 +155,13 @@ public:
 
 	virtual void BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, int y,
 						  const Region* clip, unsigned int flags) = 0;
+	/** Creates a sprite in the screen's format for compositing tiles into,
+	 * so areas can keep their static background. NULL if the driver can't,
+	 * the tiles are blitted one by one then */
+	virtual Sprite2D* CreateTileCache(int /*w*/, int /*h*/) { return NULL; }
+	/** BlitTile into a sprite from CreateTileCache, x and y are inside it */
+	virtual void BlitTileToCache(Sprite2D* /*cache*/, const Sprite2D* /*spr*/, const Sprite2D* /*mask*/,
+								 int /*x*/, int /*y*/, unsigned int /*flags*/) {}
 	virtual void BlitSprite(const Sprite2D* spr, int x, int y, bool anchor = false,
 							const Region* clip = NULL, Palette* palette = NULL) = 0;
 	virtual void BlitSprite(const Sprite2D* spr, const Region& src, const Region& dst,
@@ -157,12 +176,23 @@ public:
 	/** Return GemRB window screenshot.
 	 * It's generated from the momentary back buffer */
 	virtual Sprite2D* GetScreenshot( Region r ) = 0;
+	/** Starts a screenshot of the back buffer as it is now, which
+	 * FinishScreenshot returns. Drivers that can read it back without
+	 * waiting for the drawing to finish do so in between */
+	virtual void StartScreenshot(const Region& r);
+	/** Returns the screenshot StartScreenshot started, or NULL */
+	virtual Sprite2D* FinishScreenshot();
+	/** Whether the back buffer holds exactly what was drawn, so a region
+	 * read back with GetScreenshot can later be blitted in its place */
+	virtual bool CanCacheRegions() const { return false; }
 	/** This function Draws the Border of a Rectangle as described by the Region parameter. The Color used to draw the rectangle is passes via the Color parameter. */
 	virtual void DrawRect(const Region& rgn, const Color& color, bool fill = true, bool clipped = false) = 0;
 	/** this function draws a clipped sprite */
 	virtual void DrawRectSprite(const Region& rgn, const Color& color, const Sprite2D* sprite) = 0;
 	virtual void SetPixel(short x, short y, const Color& color, bool clipped = false) = 0;
 	virtual void GetPixel(short x, short y, Color& color) = 0;
+	/** Sets all the pixels in one go, the coordinates are taken as by SetPixel */
+	virtual void DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped = false);
 	/** Draws a circle */
 	virtual void DrawCircle(short cx, short cy, unsigned short r, const Color& color, bool clipped = true) = 0;
 	/** Draws an Ellipse Segment */
@@ -177,6 +207,27 @@ public:
 	/** Draws a line segment */
 	virtual void DrawLine(short x1, short y1, short x2, short y2,
 		const Color& color, bool clipped = false) = 0;
+	/** Copies rowCount rows of the fog of war bitmaps (a bit per cell, width
+	 * cells per row) from firstRow on, for DrawFogOfWar */
+	virtual void UpdateFogOfWar(const ieByte* /*explored*/, const ieByte* /*visible*/,
+		int /*width*/, int /*height*/, int /*firstRow*/, int /*rowCount*/) {}
+	/** Draws the fog of war over rgn from the copied bitmaps, cell (0,0)
+	 * starting at originX, originY. False if the driver can't, the fog
+	 * sprites are drawn then */
+	virtual bool DrawFogOfWar(const Region& /*rgn*/, int /*originX*/, int /*originY*/, int /*cellSize*/) { return false; }
+	/** True if TintGameArea works, the sprites don't apply the global tint then */
+	virtual bool CanTintGameArea() const { return false; }
+	/** Multiplies the colours drawn so far over rgn with the tint (its alpha
+	 * is ignored), once for the whole area instead of sprite by sprite */
+	virtual void TintGameArea(const Region& /*rgn*/, const Color& /*tint*/) {}
+	/** Reports a part of the screen the drawing code changed, SwapBuffers
+	 * composites and presents only those */
+	void MarkDirty(const Region& rgn);
+	/** The whole screen needs presenting again */
+	void MarkScreenDirty();
+	/** true if anything (or anything inside rgn) changed since the last SwapBuffers */
+	bool IsDirty() const { return !dirtyRegions.empty(); }
+	bool IsDirty(const Region& rgn) const;
 	/** Blits a Sprite filling the Region */
 	void BlitTiled(Region rgn, const Sprite2D* img, bool anchor = false);
 	/** Sets Event Manager */
@@ -202,6 +253,8 @@ public:
 	const Region& GetScreenClip() { return screenClip; }
 	/** returns the current mouse coordinates */
 	void GetMousePos(int &x, int &y);
+	/** moves the engine cursor without warping the system one, for replayed input */
+	void SetCursorPos(int x, int y) { CursorPos.x = x; CursorPos.y = y; }
 	/** clicks the mouse forcibly */
 	virtual void ClickMouse(unsigned int button) = 0;
 	/** moves the mouse forcibly */
@@ -44,8 +44,11 @@ class GEM_EXPORT WindowMgr : public Plugin {
 public: 
 	WindowMgr();
 	virtual ~WindowMgr();
-	/** This function loads all available windows from the 'stream' parameter. */
-	virtual bool Open(DataStream* stream) = 0;
+	/** This function loads all available windows from the 'stream' parameter
+	 * and keeps them around under 'name'. */
+	virtual bool Open(DataStream* stream, const char* name) = 0;
+	/** Switches to an already loaded window pack, false if there is none */
+	virtual bool Select(const char* name) = 0;
 	/** Returns the i-th window in the Previously Loaded Stream */
 	virtual Window* GetWindow(unsigned int i) = 0;
 	/** Returns the number of available windows */
@@ -28,7 +28,9 @@
 #include "Video.h"
 #include "RNG/RNG_SFMT.h"
 
+#include <functional>
 #include <list>
+#include <queue>
 
 namespace GemRB {
 
@@ -140,8 +142,6 @@ ieDword WMPAreaEntry::GetAreaStatus()
 WorldMap::WorldMap(void)
 {
 	MapMOS = NULL;
-	Distances = NULL;
-	GotHereFrom = NULL;
 	bam = NULL;
 	encounterArea = -1;
 	Width = Height = 0;
@@ -154,11 +154,13 @@ WorldMap::WorldMap(void)
 void WorldMap::AddAreaEntry(WMPAreaEntry *ae)
 {
 	area_entries.push_back(ae);
+	distanceCache.clear();
 }
 
 void WorldMap::AddAreaLink(WMPAreaLink *al)
 {
 	area_links.push_back(al);
+	distanceCache.clear();
 }
 
 WMPAreaEntry *WorldMap::GetNewAreaEntry() const
@@ -172,6 +174,7 @@ void WorldMap::SetAreaEntry(unsigned int x, WMPAreaEntry *ae)
 	if (x>area_entries.size()) {
 		error("WorldMap", "Trying to set invalid entry (%d/%d)\n", x, (int)area_entries.size());
 	}
+	distanceCache.clear();
 	//altering an existing entry
 	if (x<area_entries.size()) {
 		if (area_entries[x]) {
@@ -191,6 +194,7 @@ void WorldMap::InsertAreaLink(unsigned int areaidx, unsigned int dir, WMPAreaLin
 
 	WMPAreaLink *al = new WMPAreaLink();
 	memcpy(al, arealink, sizeof(WMPAreaLink) );
+	distanceCache.clear();
 	unsigned int idx = area_entries[areaidx]->AreaLinksIndex[dir];
 	area_links.insert(area_links.begin()+idx,al);
 
@@ -220,6 +224,7 @@ void WorldMap::SetAreaLink(unsigned int x, WMPAreaLink *arealink)
 	if (x>area_links.size()) {
 		error("WorldMap", "Trying to set invalid link (%d/%d)", x, (int)area_links.size());
 	}
+	distanceCache.clear();
 	//altering an existing link
 	if (x<area_links.size()) {
 		if (area_links[x]) {
@@ -245,12 +250,6 @@ WorldMap::~WorldMap(void)
 	if (MapMOS) {
 		Sprite2D::FreeSprite(MapMOS);
 	}
-	if (Distances) {
-		free(Distances);
-	}
-	if (GotHereFrom) {
-		free(GotHereFrom);
-	}
 	if (bam) bam = NULL;
 }
 
@@ -323,32 +322,46 @@ int WorldMap::CalculateDistances(const ieResRef AreaName, int direction)
 		Log(ERROR, "WorldMap", "CalculateDistances for invalid Area: %s", AreaName);
 		return -1;
 	}
-	if (Distances) {
-		free(Distances);
+	Log(MESSAGE, "WorldMap", "CalculateDistances for Area: %s", AreaName);
+
+	// the tables only depend on the links and on which areas are walkable
+	size_t count = area_entries.size();
+	std::vector<bool> walkable(count);
+	for (size_t k = 0; k < count; k++) {
+		walkable[k] = (area_entries[k]->GetAreaStatus() & WMP_ENTRY_WALKABLE) == WMP_ENTRY_WALKABLE;
 	}
-	if (GotHereFrom) {
-		free(GotHereFrom);
+	if (walkable != cachedWalkable) {
+		distanceCache.clear();
+		cachedWalkable.swap(walkable);
+	}
+	std::map<unsigned int, DistanceTable>::const_iterator cached = distanceCache.find(i);
+	if (cached != distanceCache.end()) {
+		Distances = cached->second.distances;
+		GotHereFrom = cached->second.gotHereFrom;
+		return 0;
 	}
 
-	Log(MESSAGE, "WorldMap", "CalculateDistances for Area: %s", AreaName);
-
-	size_t memsize =sizeof(int) * area_entries.size();
-	Distances = (int *) malloc( memsize );
-	GotHereFrom = (int *) malloc( memsize );
-	memset( Distances, -1, memsize );
-	memset( GotHereFrom, -1, memsize );
+	unsigned int source = i;
+	Distances.assign(count, -1);
+	GotHereFrom.assign(count, -1);
 	Distances[i] = 0; //setting our own distance
 	GotHereFrom[i] = -1; //we didn't move
 
-	int *seen_entry = (int *) malloc( memsize );
-
-	std::list<int> pending;
-	pending.push_back(i);
-	while(pending.size()) {
-		i=pending.front();
-		pending.pop_front();
+	// the area whose links last reached each area
+	std::vector<int> seen_entry(count, -1);
+
+	// Dijkstra, the stale queue entries are skipped when they come up
+	typedef std::pair<unsigned int, unsigned int> DistanceEntry;
+	std::priority_queue<DistanceEntry, std::vector<DistanceEntry>, std::greater<DistanceEntry> > pending;
+	pending.push(DistanceEntry(0, i));
+	while (!pending.empty()) {
+		DistanceEntry top = pending.top();
+		pending.pop();
+		i = top.second;
+		if (top.first != (unsigned int) Distances[i]) {
+			continue;
+		}
 		WMPAreaEntry* ae=area_entries[i];
-		memset( seen_entry, -1, memsize );
 		//all directions should be used
 		for(int d=0;d<4;d++) {
 			int j=ae->AreaLinksIndex[d];
@@ -360,31 +373,32 @@ int WorldMap::CalculateDistances(const ieResRef AreaName, int direction)
 			}
 			for(;j<k;j++) {
 				WMPAreaLink* al = area_links[j];
-				WMPAreaEntry* ae2 = area_entries[al->AreaIndex];
 				unsigned int mydistance = (unsigned int) Distances[i];
 
 				// we must only process the FIRST seen link to each area from this one
-				if (seen_entry[al->AreaIndex] != -1) continue;
-				seen_entry[al->AreaIndex] = 0;
+				if (seen_entry[al->AreaIndex] == (int) i) continue;
+				seen_entry[al->AreaIndex] = i;
 /*
 				if ( ( (ae->GetAreaStatus() & WMP_ENTRY_PASSABLE) == WMP_ENTRY_PASSABLE) &&
 				( (ae2->GetAreaStatus() & WMP_ENTRY_WALKABLE) == WMP_ENTRY_WALKABLE)
 */
-				if ( (ae2->GetAreaStatus() & WMP_ENTRY_WALKABLE) == WMP_ENTRY_WALKABLE) {
+				if (cachedWalkable[al->AreaIndex]) {
 					// al->Flags is the entry direction
 					mydistance += al->DistanceScale * 4;
 					//nonexisting distance is the biggest!
 					if ((unsigned) Distances[al->AreaIndex] > mydistance) {
 						Distances[al->AreaIndex] = mydistance;
 						GotHereFrom[al->AreaIndex] = j;
-						pending.push_back(al->AreaIndex);
+						pending.push(DistanceEntry(mydistance, al->AreaIndex));
 					}
 				}
 			}
 		}
 	}
 
-	free(seen_entry);
+	DistanceTable &table = distanceCache[source];
+	table.distances = Distances;
+	table.gotHereFrom = GotHereFrom;
 	return 0;
 }
 
@@ -437,12 +451,12 @@ WMPAreaLink *WorldMap::GetLink(const ieResRef A, const ieResRef B) const
 //if it isn't the same, then a random encounter happened!
 WMPAreaLink *WorldMap::GetEncounterLink(const ieResRef AreaName, bool &encounter) const
 {
-	if (!GotHereFrom) {
+	if (GotHereFrom.empty()) {
 		return NULL;
 	}
 	unsigned int i;
 	WMPAreaEntry *ae=GetArea( AreaName, i ); //target area
-	if (!ae) {
+	if (!ae || i >= GotHereFrom.size()) {
 		Log(ERROR, "WorldMap", "No such area: %s", AreaName);
 		return NULL;
 	}
@@ -568,15 +582,17 @@ void WorldMap::ClearEncounterArea()
 
 	delete ea;
 	encounterArea = -1;
+	distanceCache.clear();
 }
 
 int WorldMap::GetDistance(const ieResRef AreaName) const
 {
-	if (!Distances) {
+	if (Distances.empty()) {
 		return -1;
 	}
 	unsigned int i;
-	if (GetArea( AreaName, i )) {
+	// the tables may predate an encounter area
+	if (GetArea( AreaName, i ) && i < Distances.size()) {
 		return Distances[i];
 	}
 	return -1;
@@ -34,6 +34,7 @@
 #include "AnimationFactory.h"
 #include "Sprite2D.h"
 
+#include <map>
 #include <vector>
 
 namespace GemRB {
@@ -138,9 +139,17 @@ private: //non-struct members
 	Sprite2D* MapMOS;
 	std::vector< WMPAreaEntry*> area_entries;
 	std::vector< WMPAreaLink*> area_links;
-	int *Distances;
-	int *GotHereFrom;
+	std::vector<int> Distances;
+	std::vector<int> GotHereFrom;
 	int encounterArea;
+	struct DistanceTable {
+		std::vector<int> distances;
+		std::vector<int> gotHereFrom;
+	};
+	/* the tables by starting area, kept while the links and the walkable
+	 * areas they were calculated for stay the same */
+	std::map<unsigned int, DistanceTable> distanceCache;
+	std::vector<bool> cachedWalkable;
 public:
 	void SetMapIcons(AnimationFactory *bam);
 	Sprite2D* GetMapMOS() const { return MapMOS; }
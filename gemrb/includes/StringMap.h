@@ -102,6 +102,29 @@ public:
 	}
 };
 
+// Use "StringHashMap" for mapping strings case insensitively to other values.
+// It can also be looked up without std::string construction.
+template<typename Value>
+class StringHashMap : public HashMap<std::string, Value> {
+	typedef HashMap<std::string, Value> Base;
+public:
+	using Base::get;
+
+	const Value *get(const char *key) const
+	{
+		if (!this->isInitialized())
+			return NULL;
+
+		this->incAccesses();
+
+		for (typename Base::Entry *e = this->getBucketByHash(HashKey<std::string>::hash(key)); e; e = e->next)
+			if (HashKey<std::string>::equals(e->key, key))
+				return &e->value;
+
+		return NULL;
+	}
+};
+
 // disabled, msvc6 hates it
 #if 0
 template<unsigned int size>
@@ -25,6 +25,8 @@
 #include "Interface.h"
 #include "System/FileStream.h"
 
+#include <algorithm>
+
 using namespace GemRB;
 
 #define MAXLENGTH 8192      //if a 2da has longer lines, change this
@@ -32,6 +34,9 @@ using namespace GemRB;
 
 p2DAImporter::p2DAImporter(void)
 {
+	defVal[0] = 0;
+	defNumber = 0;
+	maxColumns = 0;
 }
 
 p2DAImporter::~p2DAImporter(void)
@@ -104,9 +109,146 @@ bool p2DAImporter::Open(DataStream* str)
 		}
 	}
 	delete str;
+	BuildIndex();
 	return true;
 }
 
+void p2DAImporter::BuildIndex()
+{
+	defNumber = atoi(defVal);
+	maxColumns = 0;
+	for (unsigned int i = 0; i < rows.size(); i++) {
+		if (rows[i].size() > maxColumns) {
+			maxColumns = (unsigned int) rows[i].size();
+		}
+	}
+	numbers.resize(maxColumns);
+	numberIndex.resize(maxColumns);
+	stringIndex.resize(maxColumns);
+
+	// keep the first occurrence of duplicate names, like the old linear search
+	if (rowNames.size()) {
+		rowIndex.init(rowNames.size() * 2, rowNames.size());
+		for (unsigned int i = rowNames.size(); i--; ) {
+			rowIndex.set(rowNames[i], i);
+		}
+	}
+	if (colNames.size()) {
+		colIndex.init(colNames.size() * 2, colNames.size());
+		for (unsigned int i = colNames.size(); i--; ) {
+			colIndex.set(colNames[i], i);
+		}
+	}
+}
+
+const std::vector<int>& p2DAImporter::GetNumberColumn(unsigned int column) const
+{
+	std::vector<int> &values = numbers[column];
+	if (values.empty() && !rows.empty()) {
+		values.reserve(rows.size());
+		for (unsigned int row = 0; row < rows.size(); row++) {
+			values.push_back(atoi(QueryField(row, column)));
+		}
+	}
+	return values;
+}
+
+const std::vector< std::pair<long, int> >& p2DAImporter::GetNumberIndex(unsigned int column) const
+{
+	std::vector< std::pair<long, int> > &index = numberIndex[column];
+	if (index.empty()) {
+		for (unsigned int row = 0; row < rows.size(); row++) {
+			long value;
+			if (valid_number(QueryField(row, column), value)) {
+				index.push_back(std::make_pair(value, (int) row));
+			}
+		}
+		std::sort(index.begin(), index.end());
+	}
+	return index;
+}
+
+namespace {
+
+// orders rows by their field in one column, case insensitively, then by row
+struct FieldLess {
+	const p2DAImporter *table;
+	unsigned int column;
+
+	FieldLess(const p2DAImporter *table, unsigned int column)
+		: table(table), column(column) {}
+
+	bool operator()(int a, int b) const
+	{
+		int cmp = stricmp(table->QueryField(a, column), table->QueryField(b, column));
+		return cmp < 0 || (cmp == 0 && a < b);
+	}
+	bool operator()(int a, const std::pair<const char*, int> &b) const
+	{
+		int cmp = stricmp(table->QueryField(a, column), b.first);
+		return cmp < 0 || (cmp == 0 && a < b.second);
+	}
+};
+
+}
+
+const std::vector<int>& p2DAImporter::GetStringIndex(unsigned int column) const
+{
+	std::vector<int> &index = stringIndex[column];
+	if (index.empty() && !rows.empty()) {
+		index.reserve(rows.size());
+		for (unsigned int row = 0; row < rows.size(); row++) {
+			index.push_back(row);
+		}
+		std::sort(index.begin(), index.end(), FieldLess(this, column));
+	}
+	return index;
+}
+
+int p2DAImporter::FindTableValue(unsigned int col, long val, int start) const
+{
+	if (start < 0) {
+		return -1;
+	}
+	if (col >= maxColumns) {
+		// every row holds the default here
+		long value;
+		if ((ieDword) start < GetRowCount() && valid_number(defVal, value) && value == val) {
+			return start;
+		}
+		return -1;
+	}
+
+	const std::vector< std::pair<long, int> > &index = GetNumberIndex(col);
+	std::vector< std::pair<long, int> >::const_iterator it;
+	it = std::lower_bound(index.begin(), index.end(), std::make_pair(val, start));
+	if (it != index.end() && it->first == val) {
+		return it->second;
+	}
+	return -1;
+}
+
+int p2DAImporter::FindTableValue(unsigned int col, const char* val, int start) const
+{
+	if (start < 0) {
+		return -1;
+	}
+	if (col >= maxColumns) {
+		if ((ieDword) start < GetRowCount() && stricmp(defVal, val) == 0) {
+			return start;
+		}
+		return -1;
+	}
+
+	const std::vector<int> &index = GetStringIndex(col);
+	std::vector<int>::const_iterator it;
+	it = std::lower_bound(index.begin(), index.end(), std::make_pair(val, start), FieldLess(this, col));
+	if (it != index.end() && stricmp(QueryField(*it, col), val) == 0) {
+		return *it;
+	}
+	return -1;
+}
+
 #include "plugindef.h"
 
 GEMRB_PLUGIN(0xB22F938, "2DA File Importer")
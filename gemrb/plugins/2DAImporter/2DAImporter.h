@@ -24,6 +24,7 @@
 #include "TableMgr.h"
 
 #include "globals.h"
+#include "StringMap.h"
 
 #include <cstring>
 #include <vector>
@@ -39,6 +40,21 @@ private:
 	std::vector< char*> ptrs;
 	std::vector< RowEntry> rows;
 	char defVal[32];
+	int defNumber;
+	// the widest row, every column past it is all default
+	unsigned int maxColumns;
+	// name -> index of its first occurrence
+	StringHashMap<int> rowIndex;
+	StringHashMap<int> colIndex;
+	// lazily parsed columns and value indexes (sorted, so FindTableValue's start works)
+	mutable std::vector< std::vector<int> > numbers;
+	mutable std::vector< std::vector< std::pair<long, int> > > numberIndex;
+	mutable std::vector< std::vector<int> > stringIndex;
+
+	void BuildIndex();
+	const std::vector<int>& GetNumberColumn(unsigned int column) const;
+	const std::vector< std::pair<long, int> >& GetNumberIndex(unsigned int column) const;
+	const std::vector<int>& GetStringIndex(unsigned int column) const;
 public:
 	p2DAImporter(void);
 	~p2DAImporter(void);
@@ -98,6 +114,25 @@ public:
 		return QueryField((unsigned int) rowi, (unsigned int) coli);
 	}
 
+	/** Returns a 2da element as a number, parsed like atoi only once per column */
+	inline int QueryFieldSigned(unsigned int row, unsigned int column) const
+	{
+		if (rows.size() <= row || maxColumns <= column) {
+			return defNumber;
+		}
+		return GetNumberColumn(column)[row];
+	}
+
+	inline int QueryFieldSigned(const char* row, const char* column) const
+	{
+		int rowi = GetRowIndex(row);
+		int coli = GetColumnIndex(column);
+		if (rowi < 0 || coli < 0) {
+			return defNumber;
+		}
+		return QueryFieldSigned((unsigned int) rowi, (unsigned int) coli);
+	}
+
 	virtual const char* QueryDefault() const
 	{
 		return defVal;
@@ -105,22 +140,14 @@ public:
 
 	inline int GetRowIndex(const char* string) const
 	{
-		for (unsigned int index = 0; index < rowNames.size(); index++) {
-			if (stricmp( rowNames[index], string ) == 0) {
-				return (int) index;
-			}
-		}
-		return -1;
+		const int *index = rowIndex.get(string);
+		return index ? *index : -1;
 	}
 
 	inline int GetColumnIndex(const char* string) const
 	{
-		for (unsigned int index = 0; index < colNames.size(); index++) {
-			if (stricmp( colNames[index], string ) == 0) {
-				return (int) index;
-			}
-		}
-		return -1;
+		const int *index = colIndex.get(string);
+		return index ? *index : -1;
 	}
 
 	inline const char* GetColumnName(unsigned int index) const
@@ -139,32 +166,8 @@ public:
 		return "";
 	}
 
-	inline int FindTableValue(unsigned int col, long val, int start) const
-	{
-		ieDword row, max;
-		
-		max = GetRowCount();
-		for (row = start; row < max; row++) {
-			const char* ret = QueryField( row, col );
-			long Value;
-			if (valid_number( ret, Value ) && (Value == val) )
-				return (int) row;
-		}
-		return -1;
-	}
-
-	inline int FindTableValue(unsigned int col, const char* val, int start) const
-	{
-		ieDword row, max;
-
-		max = GetRowCount();
-		for (row = start; row < max; row++) {
-			const char* ret = QueryField( row, col );
-			if (stricmp(ret, val) == 0)
-				return (int) row;
-		}
-		return -1;
-	}
+	int FindTableValue(unsigned int col, long val, int start) const;
+	int FindTableValue(unsigned int col, const char* val, int start) const;
 
 	inline int FindTableValue(const char* col, long val, int start) const
 	{
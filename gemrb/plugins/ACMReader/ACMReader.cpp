@@ -102,11 +102,17 @@ int ACMReader::read_samples(short* buffer, int count)
 			if (!make_new_samples())
 				break;
 		}
-		*buffer = ( short ) ( ( *values ) >> levels );
-		values++;
-		buffer++;
-		res += 1;
-		samples_ready--;
+		// copy out as much of the decoded block as fits in one go
+		int chunk = count - res;
+		if (chunk > samples_ready)
+			chunk = samples_ready;
+		for (int i = 0; i < chunk; i++) {
+			buffer[i] = ( short ) ( values[i] >> levels );
+		}
+		values += chunk;
+		buffer += chunk;
+		res += chunk;
+		samples_ready -= chunk;
 	}
 	return res;
 }
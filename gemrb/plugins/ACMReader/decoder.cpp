@@ -29,6 +29,10 @@ int CSubbandDecoder::init_decoder()
 		memory_buffer = ( int * ) calloc( memory_size, sizeof( int ) );
 		if (!memory_buffer)
 			return 0;
+		// full precision copy of the first level's short memory
+		state_buffer = ( int * ) calloc( block_size, sizeof( int ) );
+		if (!state_buffer)
+			return 0;
 	}
 	return 1;
 }
@@ -58,120 +62,83 @@ void CSubbandDecoder::decode_data(int* buffer, int blocks)
 		blocks <<= 1;
 	}
 }
+
+// Runs the synthesis filter over groups of four rows. Every column is
+// independent, so the rows are walked one at a time and the inner loops
+// touch contiguous memory, which lets the compiler vectorize them.
+// d0 and d1 hold the last two rows of the previous block for each column.
+static void filter_rows(int* buffer, int sb_size, int groups, int* d0, int* d1)
+{
+	for (int j = 0; j < groups; j++) {
+		int* row_0 = buffer;
+		int* row_1 = row_0 + sb_size;
+		int* row_2 = row_1 + sb_size;
+		int* row_3 = row_2 + sb_size;
+
+		for (int i = 0; i < sb_size; i++) {
+			int r0 = row_0[i], r1 = row_1[i], r2 = row_2[i], r3 = row_3[i];
+
+			row_0[i] = d0[i] + 2 * d1[i] + r0;
+			row_1[i] = -d1[i] + 2 * r0 - r1;
+			row_2[i] = r0 + 2 * r1 + r2;
+			row_3[i] = -r1 + 2 * r2 - r3;
+
+			d0[i] = r2;
+			d1[i] = r3;
+		}
+		buffer += sb_size << 2;
+	}
+}
+
+// the first level keeps its memory as shorts: the first sb_size entries
+// hold the older row, the next sb_size the newer one
 void CSubbandDecoder::sub_4d3fcc(short* memory, int* buffer, int sb_size,
 	int blocks)
 {
-	int row_0, row_1, row_2 = 0, row_3 = 0, db_0, db_1;
+	short* mem_0 = memory, * mem_1 = memory + sb_size;
 	int i;
-	int sb_size_2 = sb_size * 2, sb_size_3 = sb_size * 3;
+
 	if (blocks == 2) {
+		int* row_1 = buffer + sb_size;
 		for (i = 0; i < sb_size; i++) {
-			row_0 = buffer[0];
-			row_1 = buffer[sb_size];
-			buffer[0] = buffer[0] + memory[0] + 2 * memory[1];
-			buffer[sb_size] = 2 * row_0 - memory[1] - buffer[sb_size];
-			memory[0] = ( short ) row_0;
-			memory[1] = ( short ) row_1;
-
-			memory += 2;
-			buffer++;
-		}
-	} else if (blocks == 4) {
-		for (i = 0; i < sb_size; i++) {
-			row_0 = buffer[0];
-			row_1 = buffer[sb_size];
-			row_2 = buffer[sb_size_2];
-			row_3 = buffer[sb_size_3];
+			int r0 = buffer[i], r1 = row_1[i];
 
-			buffer[0] = memory[0] + 2 * memory[1] + row_0;
-			buffer[sb_size] = -memory[1] + 2 * row_0 - row_1;
-			buffer[sb_size_2] = row_0 + 2 * row_1 + row_2;
-			buffer[sb_size_3] = -row_1 + 2 * row_2 - row_3;
+			buffer[i] = r0 + mem_0[i] + 2 * mem_1[i];
+			row_1[i] = 2 * r0 - mem_1[i] - r1;
+			mem_0[i] = ( short ) r0;
+			mem_1[i] = ( short ) r1;
+		}
+		return;
+	}
 
-			memory[0] = ( short ) row_2;
-			memory[1] = ( short ) row_3;
+	int* d0 = state_buffer, * d1 = state_buffer + sb_size;
+	if (( blocks >> 1 ) & 1) {
+		int* row_1 = buffer + sb_size;
+		for (i = 0; i < sb_size; i++) {
+			int r0 = buffer[i], r1 = row_1[i];
 
-			memory += 2;
-			buffer++;
+			buffer[i] = mem_0[i] + 2 * mem_1[i] + r0;
+			row_1[i] = -mem_1[i] + 2 * r0 - r1;
+			d0[i] = r0;
+			d1[i] = r1;
 		}
+		buffer += sb_size << 1;
 	} else {
 		for (i = 0; i < sb_size; i++) {
-			int* buff_ptr = buffer;
-			if (( blocks >> 1 ) & 1) {
-				row_0 = buff_ptr[0];
-				row_1 = buff_ptr[sb_size];
-
-				buff_ptr[0] = memory[0] + 2 * memory[1] + row_0;
-				buff_ptr[sb_size] = -memory[1] + 2 * row_0 - row_1;
-				buff_ptr += sb_size_2;
-
-				db_0 = row_0;
-				db_1 = row_1;
-			} else {
-				db_0 = memory[0];
-				db_1 = memory[1];
-			}
-
-			for (int j = 0; j < blocks >> 2; j++) {
-				row_0 = buff_ptr[0];  buff_ptr[0] = db_0 + 2 * db_1 + row_0;  buff_ptr += sb_size;
-				row_1 = buff_ptr[0];  buff_ptr[0] = -db_1 + 2 * row_0 - row_1;  buff_ptr += sb_size;
-				row_2 = buff_ptr[0];  buff_ptr[0] = row_0 + 2 * row_1 + row_2;  buff_ptr += sb_size;
-				row_3 = buff_ptr[0];  buff_ptr[0] = -row_1 + 2 * row_2 -
-					row_3;  buff_ptr += sb_size;
-
-				db_0 = row_2;
-				db_1 = row_3;
-			}
-			memory[0] = ( short ) row_2;
-			memory[1] = ( short ) row_3;
-			memory += 2;
-			buffer++;
+			d0[i] = mem_0[i];
+			d1[i] = mem_1[i];
 		}
 	}
+
+	filter_rows( buffer, sb_size, blocks >> 2, d0, d1 );
+
+	for (i = 0; i < sb_size; i++) {
+		mem_0[i] = ( short ) d0[i];
+		mem_1[i] = ( short ) d1[i];
+	}
 }
 void CSubbandDecoder::sub_4d420c(int* memory, int* buffer, int sb_size,
 	int blocks)
 {
-	int row_0, row_1, row_2 = 0, row_3 = 0, db_0, db_1;
-	int i;
-	int sb_size_2 = sb_size * 2, sb_size_3 = sb_size * 3;
-	if (blocks == 4) {
-		for (i = 0; i < sb_size; i++) {
-			row_0 = buffer[0];
-			row_1 = buffer[sb_size];
-			row_2 = buffer[sb_size_2];
-			row_3 = buffer[sb_size_3];
-
-			buffer[0] = memory[0] + 2 * memory[1] + row_0;
-			buffer[sb_size] = -memory[1] + 2 * row_0 - row_1;
-			buffer[sb_size_2] = row_0 + 2 * row_1 + row_2;
-			buffer[sb_size_3] = -row_1 + 2 * row_2 - row_3;
-
-			memory[0] = row_2;
-			memory[1] = row_3;
-
-			memory += 2;
-			buffer++;
-		}
-	} else {
-		for (i = 0; i < sb_size; i++) {
-			int* buff_ptr = buffer;
-			db_0 = memory[0]; db_1 = memory[1];
-			for (int j = 0; j < blocks >> 2; j++) {
-				row_0 = buff_ptr[0];  buff_ptr[0] = db_0 + 2 * db_1 + row_0;  buff_ptr += sb_size;
-				row_1 = buff_ptr[0];  buff_ptr[0] = -db_1 + 2 * row_0 - row_1;  buff_ptr += sb_size;
-				row_2 = buff_ptr[0];  buff_ptr[0] = row_0 + 2 * row_1 + row_2;  buff_ptr += sb_size;
-				row_3 = buff_ptr[0];  buff_ptr[0] = -row_1 + 2 * row_2 -
-					row_3;  buff_ptr += sb_size;
-
-				db_0 = row_2;
-				db_1 = row_3;
-			}
-			memory[0] = row_2;
-			memory[1] = row_3;
-
-			memory += 2;
-			buffer++;
-		}
-	}
+	filter_rows( buffer, sb_size, blocks >> 2, memory, memory + sb_size );
 }
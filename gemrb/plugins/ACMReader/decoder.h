@@ -30,11 +30,12 @@ class CSubbandDecoder {
 private:
 	int levels, block_size;
 	int* memory_buffer;
+	int* state_buffer;
 	void sub_4d3fcc(short* memory, int* buffer, int sb_size, int blocks);
 	void sub_4d420c(int* memory, int* buffer, int sb_size, int blocks);
 public:
 	CSubbandDecoder(int lev_cnt)
-		: levels( lev_cnt ), block_size( 1 << lev_cnt ), memory_buffer( NULL )
+		: levels( lev_cnt ), block_size( 1 << lev_cnt ), memory_buffer( NULL ), state_buffer( NULL )
 	{
 	}
 	virtual ~CSubbandDecoder()
@@ -42,6 +43,9 @@ public:
 		if (memory_buffer) {
 			free( memory_buffer );
 		}
+		if (state_buffer) {
+			free( state_buffer );
+		}
 	}
 
 	int init_decoder();
@@ -273,21 +273,7 @@ bool AREImporter::ChangeMap(Map *map, bool day_or_night)
 	DataStream* wedfile = gamedata->GetResource( TmpResRef, IE_WED_CLASS_ID );
 	tmm->Open( wedfile );
 	tmm->SetExtendedNight( !day_or_night );
-
-	//alter the tilemap object, not all parts of that object are coming from the wed/tis
-	//this is why we have to be careful
-	//TODO: consider refactoring TileMap so invariable data coming from the .ARE file
-	//are not handled by it, then TileMap could be simply swapped
-	TileMap* tm = map->GetTileMap();
-
-	if (tm) {
-		tm->ClearOverlays();
-	}
-	tm = tmm->GetTileMap(tm);
-	if (!tm) {
-		Log(ERROR, "AREImporter", "No tile map available.");
-		return false;
-	}
+	tmm->PreloadTileSets();
 
 	// Small map for MapControl
 	ResourceHolder<ImageMgr> sm(TmpResRef);
@@ -298,9 +284,6 @@ bool AREImporter::ChangeMap(Map *map, bool day_or_night)
 		sm = ResourceHolder<ImageMgr> (map->WEDResRef);
 	}
 
-	//the map state was altered, no need to hold this off for any later
-	map->DayNight = day_or_night;
-
 	//get the lightmap name
 	if (day_or_night) {
 		snprintf( TmpResRef, 9, "%.6sLM", map->WEDResRef);
@@ -314,6 +297,24 @@ bool AREImporter::ChangeMap(Map *map, bool day_or_night)
 		return false;
 	}
 
+	//alter the tilemap object, not all parts of that object are coming from the wed/tis
+	//this is why we have to be careful
+	//TODO: consider refactoring TileMap so invariable data coming from the .ARE file
+	//are not handled by it, then TileMap could be simply swapped
+	TileMap* tm = map->GetTileMap();
+
+	if (tm) {
+		tm->ClearOverlays();
+	}
+	tm = tmm->GetTileMap(tm);
+	if (!tm) {
+		Log(ERROR, "AREImporter", "No tile map available.");
+		return false;
+	}
+
+	//the map state was altered, no need to hold this off for any later
+	map->DayNight = day_or_night;
+
 	//alter the lightmap and the minimap (the tileset was already swapped)
 	map->ChangeTileMap(lm->GetImage(), sm?sm->GetSprite2D():NULL);
 
@@ -357,7 +358,7 @@ inline ieDword FixIWD2DoorFlags(ieDword Flags, bool reverse)
 
 Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 {
-	unsigned int i,x;
+	unsigned int i;
 
 	// if this area does not have extended night, force it to day mode
 	if (!(AreaFlags & AT_EXTENDED_NIGHT))
@@ -410,14 +411,11 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	PluginHolder<TileMapMgr> tmm(IE_WED_CLASS_ID);
 	DataStream* wedfile = gamedata->GetResource( WEDResRef, IE_WED_CLASS_ID );
 	tmm->Open( wedfile );
-
-	//there was no tilemap set yet, so lets just send a NULL
-	TileMap* tm = tmm->GetTileMap(NULL);
-	if (!tm) {
-		Log(ERROR, "AREImporter", "No tile map available.");
-		delete map;
-		return NULL;
-	}
+	// the tiles are decoded in the background while the bitmaps load,
+	// GetTileMap below waits for them
+	tmm->PreloadTileSets();
+	// the tiles and bitmaps fill the bar up to 70%, where a loading game already is
+	core->LoadProgress(0, 70, 1, 4);
 
 	// Small map for MapControl
 	ResourceHolder<ImageMgr> sm(TmpResRef);
@@ -466,6 +464,16 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		Log(ERROR, "AREImporter", "No heightmap available.");
 		return NULL;
 	}
+	core->LoadProgress(0, 70, 2, 4);
+
+	//there was no tilemap set yet, so lets just send a NULL
+	TileMap* tm = tmm->GetTileMap(NULL);
+	if (!tm) {
+		Log(ERROR, "AREImporter", "No tile map available.");
+		delete map;
+		return NULL;
+	}
+	core->LoadProgress(0, 70, 3, 4);
 
 	map->AddTileMap( tm, lm->GetImage(), sr->GetBitmap(), sm ? sm->GetSprite2D() : NULL, hm->GetBitmap() );
 
@@ -503,7 +511,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	str->ReadWord( &map->RestHeader.DayChance );
 	str->ReadWord( &map->RestHeader.NightChance );
 
-	Log(DEBUG, "AREImporter", "Loading regions");
+	LogDebug("AREImporter", "Loading regions");
 	core->LoadProgress(70);
 	//Loading InfoPoints
 	for (i = 0; i < InfoPointsCount; i++) {
@@ -579,10 +587,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 
 		str->Seek( VerticesOffset + ( FirstVertex * 4 ), GEM_STREAM_START );
 		Point* points = ( Point* ) malloc( VertexCount*sizeof( Point ) );
-		for (x = 0; x < VertexCount; x++) {
-			str->ReadWord( (ieWord*) &points[x].x );
-			str->ReadWord( (ieWord*) &points[x].y );
-		}
+		str->ReadPoints( points, VertexCount );
 		Gem_Polygon* poly = new Gem_Polygon( points, VertexCount, &bbox);
 		free( points );
 		InfoPoint* ip = tm->AddInfoPoint( Name, Type, poly );
@@ -638,7 +643,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		}
 	}
 
-	Log(DEBUG, "AREImporter", "Loading containers");
+	LogDebug("AREImporter", "Loading containers");
 	for (i = 0; i < ContainersCount; i++) {
 		str->Seek( ContainersOffset + ( i * 0xC0 ), GEM_STREAM_START );
 		ieVariable Name;
@@ -692,13 +697,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 
 		str->Seek( VerticesOffset + ( firstIndex * 4 ), GEM_STREAM_START );
 		Point* points = ( Point* ) malloc( vertCount*sizeof( Point ) );
-		for (x = 0; x < vertCount; x++) {
-			ieWord tmp;
-			str->ReadWord( &tmp );
-			points[x].x = tmp;
-			str->ReadWord( &tmp );
-			points[x].y = tmp;
-		}
+		str->ReadPoints( points, vertCount );
 		if (vertCount == 0 && bbox.w == 0 && bbox.h == 0) {
 			/* piles have no polygons and no bounding box in some areas,
 			 * but bg2 gives them this bounding box at first load,
@@ -744,7 +743,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		c->OpenFail = OpenFail;
 	}
 
-	Log(DEBUG, "AREImporter", "Loading doors");
+	LogDebug("AREImporter", "Loading doors");
 	for (i = 0; i < DoorsCount; i++) {
 		str->Seek( DoorsOffset + ( i * 0xc8 ), GEM_STREAM_START );
 		int count;
@@ -843,12 +842,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		str->Seek( VerticesOffset + ( OpenFirstVertex * 4 ), GEM_STREAM_START );
 		Point* points = ( Point* )
 			malloc( OpenVerticesCount*sizeof( Point ) );
-		for (x = 0; x < OpenVerticesCount; x++) {
-			str->ReadWord( &minX );
-			points[x].x = minX;
-			str->ReadWord( &minY );
-			points[x].y = minY;
-		}
+		str->ReadPoints( points, OpenVerticesCount );
 		Gem_Polygon* open = new Gem_Polygon( points, OpenVerticesCount, &BBOpen );
 		free( points );
 
@@ -856,12 +850,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		str->Seek( VerticesOffset + ( ClosedFirstVertex * 4 ),
 				GEM_STREAM_START );
 		points = ( Point * ) malloc( ClosedVerticesCount * sizeof( Point ) );
-		for (x = 0; x < ClosedVerticesCount; x++) {
-			str->ReadWord( &minX );
-			points[x].x = minX;
-			str->ReadWord( &minY );
-			points[x].y = minY;
-		}
+		str->ReadPoints( points, ClosedVerticesCount );
 		Gem_Polygon* closed = new Gem_Polygon( points, ClosedVerticesCount, &BBClosed );
 		free( points );
 
@@ -883,12 +872,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		str->Seek( VerticesOffset + ( OpenFirstImpeded * 4 ),
 				GEM_STREAM_START );
 		points = ( Point * ) malloc( OpenImpededCount * sizeof( Point ) );
-		for (x = 0; x < OpenImpededCount; x++) {
-			str->ReadWord( &minX );
-			points[x].x = minX;
-			str->ReadWord( &minY );
-			points[x].y = minY;
-		}
+		str->ReadPoints( points, OpenImpededCount );
 		door->open_ib = points;
 		door->oibcount = OpenImpededCount;
 
@@ -896,12 +880,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		str->Seek( VerticesOffset + ( ClosedFirstImpeded * 4 ),
 				GEM_STREAM_START );
 		points = ( Point * ) malloc( ClosedImpededCount * sizeof( Point ) );
-		for (x = 0; x < ClosedImpededCount; x++) {
-			str->ReadWord( &minX );
-			points[x].x = minX;
-			str->ReadWord( &minY );
-			points[x].y = minY;
-		}
+		str->ReadPoints( points, ClosedImpededCount );
 		door->closed_ib = points;
 		door->cibcount = ClosedImpededCount;
 		door->SetMap(map);
@@ -952,7 +931,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		door->SetDialog(Dialog);
 	}
 
-	Log(DEBUG, "AREImporter", "Loading spawnpoints");
+	LogDebug("AREImporter", "Loading spawnpoints");
 	for (i = 0; i < SpawnCount; i++) {
 		str->Seek( SpawnOffset + (i*0xc8), GEM_STREAM_START );
 		ieVariable Name;
@@ -1006,7 +985,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	}
 
 	core->LoadProgress(75);
-	Log(DEBUG, "AREImporter", "Loading actors");
+	LogDebug("AREImporter", "Loading actors");
 	str->Seek( ActorOffset, GEM_STREAM_START );
 	if (!core->IsAvailable( IE_CRE_CLASS_ID )) {
 		Log(WARNING, "AREImporter", "No Actor Manager Available, skipping actors");
@@ -1023,6 +1002,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 			ieDword Flags;
 			ieByte DifficultyMargin;
 
+			core->LoadProgress(75, 90, i, ActorCount);
 			str->Read( DefaultName, 32);
 			DefaultName[32]=0;
 			str->ReadWord( &XPos );
@@ -1133,12 +1113,13 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	}
 
 	core->LoadProgress(90);
-	Log(DEBUG, "AREImporter", "Loading animations");
+	LogDebug("AREImporter", "Loading animations");
 	str->Seek( AnimOffset, GEM_STREAM_START );
 	if (!core->IsAvailable( IE_BAM_CLASS_ID )) {
 		Log(WARNING, "AREImporter", "No Animation Manager Available, skipping animations");
 	} else {
 		for (i = 0; i < AnimCount; i++) {
+			core->LoadProgress(90, 100, i, AnimCount);
 			AreaAnimation* anim = new AreaAnimation();
 			str->Read(anim->Name, 32);
 			ieWord animX, animY, startFrameRange;
@@ -1175,7 +1156,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		}
 	}
 
-	Log(DEBUG, "AREImporter", "Loading entrances");
+	LogDebug("AREImporter", "Loading entrances");
 	str->Seek( EntrancesOffset, GEM_STREAM_START );
 	for (i = 0; i < EntrancesCount; i++) {
 		ieVariable Name;
@@ -1189,7 +1170,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		map->AddEntrance( Name, XPos, YPos, Face );
 	}
 
-	Log(DEBUG, "AREImporter", "Loading variables");
+	LogDebug("AREImporter", "Loading variables");
 	map->locals->LoadInitialValues(ResRef);
 	str->Seek( VariablesOffset, GEM_STREAM_START );
 	for (i = 0; i < VariablesCount; i++) {
@@ -1203,7 +1184,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		map->locals->SetAt( Name, Value );
 	}
 
-	Log(DEBUG, "AREImporter", "Loading ambients");
+	LogDebug("AREImporter", "Loading ambients");
 	str->Seek( AmbiOffset, GEM_STREAM_START );
 	for (i = 0; i < AmbiCount; i++) {
 		int j;
@@ -1244,7 +1225,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		map->AddAmbient(ambi);
 	}
 
-	Log(DEBUG, "AREImporter", "Loading automap notes");
+	LogDebug("AREImporter", "Loading automap notes");
 	str->Seek( NoteOffset, GEM_STREAM_START );
 
 	Point point;
@@ -1310,7 +1291,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	}
 
 	//this is a ToB feature (saves the unexploded projectiles)
-	Log(DEBUG, "AREImporter", "Loading traps");
+	LogDebug("AREImporter", "Loading traps");
 	for (i = 0; i < TrapCount; i++) {
 		ieResRef TrapResRef;
 		ieDword TrapEffOffset;
@@ -1359,7 +1340,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		map->AddProjectile( pro, pos, pos);
 	}
 
-	Log(DEBUG, "AREImporter", "Loading tiles");
+	LogDebug("AREImporter", "Loading tiles");
 	//Loading Tiled objects (if any)
 	str->Seek( TileOffset, GEM_STREAM_START );
 	for (i = 0; i < TileCount; i++) {
@@ -1395,7 +1376,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 		map->TMap->AddTile( ID, Name, Flags, NULL,0, NULL, 0 );
 	}
 
-	Log(DEBUG, "AREImporter", "Loading explored bitmap");
+	LogDebug("AREImporter", "Loading explored bitmap");
 	i = map->GetExploredMapSize();
 	if (ExploredBitmapSize==i) {
 		map->ExploredBitmap = (ieByte *) malloc(i);
@@ -1412,7 +1393,7 @@ Map* AREImporter::GetMap(const char *ResRef, bool day_or_night)
 	}
 	map->VisibleBitmap = (ieByte *) calloc(i, 1);
 
-	Log(DEBUG, "AREImporter", "Loading wallgroups");
+	LogDebug("AREImporter", "Loading wallgroups");
 	map->SetWallGroups( tmm->GetPolygonsCount(),tmm->GetWallGroups() );
 	//setting up doors
 	for (i=0;i<DoorsCount;i++) {
@@ -2251,7 +2232,7 @@ int AREImporter::PutEffects( DataStream *stream, EffectQueue *fxqueue)
 	PluginHolder<EffectMgr> eM(IE_EFF_CLASS_ID);
 	assert(eM != NULL);
 
-	std::list< Effect* >::const_iterator f=fxqueue->GetFirstEffect();
+	EffectList::const_iterator f=fxqueue->GetFirstEffect();
 	ieDword EffectsCount = fxqueue->GetSavedEffectsCount();
 	for(unsigned int i=0;i<EffectsCount;i++) {
 		const Effect *fx = fxqueue->GetNextSavedEffect(f);
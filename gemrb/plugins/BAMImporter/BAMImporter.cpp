@@ -19,7 +19,6 @@
  */
 
 #ifdef ANDROID
-#include "swab.h"
 #endif
 
 #include "BAMImporter.h"
@@ -106,10 +105,8 @@ bool BAMImporter::Open(DataStream* stream)
 			DataStart = (frames[i].FrameData & 0x7FFFFFFF);
 	}
 	cycles = new CycleEntry[CyclesCount];
-	for (i = 0; i < CyclesCount; i++) {
-		str->ReadWord( &cycles[i].FramesCount );
-		str->ReadWord( &cycles[i].FirstFrame );
-	}
+	// two words each
+	str->ReadWords( (ieWord *) cycles, CyclesCount * 2 );
 	str->Seek( PaletteOffset, GEM_STREAM_START );
 	palette = new Palette();
 	// no need to switch this
@@ -245,11 +242,7 @@ ieWord * BAMImporter::CacheFLT(unsigned int &count)
 
 	ieWord * FLT = ( ieWord * ) calloc( count, sizeof(ieWord) );
 	str->Seek( FLTOffset, GEM_STREAM_START );
-	str->Read( FLT, count * sizeof(ieWord) );
-	if( DataStream::IsEndianSwitch() ) {
-		//msvc likes it as char *
-		swab( (char*) FLT, (char*) FLT, count * sizeof(ieWord) );
-	}
+	str->ReadWords( FLT, count );
 	return FLT;
 }
 
@@ -269,7 +262,7 @@ AnimationFactory* BAMImporter::GetAnimationFactory(const char* ResRef, unsigned
 		//data = new unsigned char[length];
 		data = (unsigned char *) malloc(length);
 		str->Read( data, length );
-		af->SetFrameData(data);
+		af->SetFrameData(data, length);
 	}
 
 	for (i = 0; i < FramesCount; ++i) {
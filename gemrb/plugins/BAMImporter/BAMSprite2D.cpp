@@ -97,6 +97,11 @@ Color BAMSprite2D::GetPixel(unsigned short x, unsigned short y) const
 	int skipcount = y * Width + x;
 
 	const ieByte *rle = (const ieByte*)pixels;
+	const ieDword *rows = GetRLERows();
+	if (rows) {
+		rle += rows[y] >> 8;
+		skipcount = x - (int) (rows[y] & 0xff);
+	}
 	if (RLE) {
 		while (skipcount > 0) {
 			if (*rle++ == colorkey)
@@ -22,10 +22,8 @@
 
 #include "win32def.h"
 
-#include "Compressor.h"
-#include "FileCache.h"
+#include "DecompressionService.h"
 #include "Interface.h"
-#include "PluginMgr.h"
 #include "System/SlicedStream.h"
 #include "System/FileStream.h"
 
@@ -52,68 +50,13 @@ BIFImporter::~BIFImporter(void)
 	}
 }
 
-DataStream* BIFImporter::DecompressBIFC(DataStream* compressed, const char* path)
-{
-	print("Decompressing");
-	if (!core->IsAvailable( PLUGIN_COMPRESSION_ZLIB ))
-		return NULL;
-	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
-	ieDword unCompBifSize;
-	compressed->ReadDword( &unCompBifSize );
-	//print( "\nDecompressing file: [..........]" );
-	fflush(stdout);
-	FileStream out;
-	if (!out.Create(path)) {
-		Log(ERROR, "BIFImporter", "Cannot write %s.", path);
-		return NULL;
-	}
-	ieDword finalsize = 0;
-	int laststep = 0;
-	while (finalsize < unCompBifSize) {
-		ieDword complen, declen;
-		compressed->ReadDword( &declen );
-		compressed->ReadDword( &complen );
-		if (comp->Decompress( &out, compressed, complen ) != GEM_OK) {
-			return NULL;
-		}
-		finalsize = out.GetPos();
-		if (( int ) ( finalsize * ( 10.0 / unCompBifSize ) ) != laststep) {
-			laststep++;
-			/*
-			print( "\b\b\b\b\b\b\b\b\b\b\b" );
-			int l;
-
-			for (l = 0; l < laststep; l++)
-				print( "|" );
-			for (; l < 10; l++)//l starts from laststep
-				print( "." );
-			print( "]" );
-			fflush(stdout);
-			*/
-		}
-	}
-	//print("\n");
-	out.Close(); // This is necesary, since windows won't open the file otherwise.
-	return FileStream::OpenFile(path);
-}
-
-DataStream* BIFImporter::DecompressBIF(DataStream* compressed, const char* /*path*/)
-{
-	ieDword fnlen, complen, declen;
-	compressed->ReadDword( &fnlen );
-	compressed->Seek(fnlen, GEM_CURRENT_POS);
-	compressed->ReadDword(&declen);
-	compressed->ReadDword(&complen);
-	print("Decompressing");
-	return CacheCompressedStream(compressed, compressed->filename, complen);
-}
-
 int BIFImporter::OpenArchive(const char* path)
 {
 	if (stream) {
 		delete( stream );
 		stream = NULL;
 	}
+	mapping = NULL;
 
 	char filename[_MAX_PATH];
 	ExtractFileFromPath(filename, path);
@@ -133,12 +76,10 @@ int BIFImporter::OpenArchive(const char* path)
 			return GEM_ERROR;
 		}
 
-		if (strncmp(Signature, "BIF V1.0", 8) == 0) {
-			stream = DecompressBIF(file, cachePath);
-			delete file;
-		} else if (strncmp(Signature, "BIFCV1.0", 8) == 0) {
-			stream = DecompressBIFC(file, cachePath);
+		if (strncmp(Signature, "BIF V1.0", 8) == 0 || strncmp(Signature, "BIFCV1.0", 8) == 0) {
 			delete file;
+			// waits only if this very archive is still being expanded
+			stream = core->GetDecompressionService()->Expand(path);
 		} else if (strncmp( Signature, "BIFFV1  ", 8 ) == 0) {
 			file->Seek(0, GEM_STREAM_START);
 			stream = file;
@@ -157,25 +98,64 @@ int BIFImporter::OpenArchive(const char* path)
 		return GEM_ERROR;
 	}
 
+	MapArchive();
 	ReadBIF();
 	return GEM_OK;
 }
 
+// swaps the file stream for one reading from a mapping of the same file,
+// if the platform can do it; the entries are then handed out without copies
+void BIFImporter::MapArchive(void)
+{
+	MappedFile* mf = MappedFile::Open(stream->originalfile);
+	if (!mf) {
+		return;
+	}
+	if (mf->GetSize() != stream->Size()) {
+		delete mf;
+		return;
+	}
+	mapping = mf;
+
+	unsigned long pos = stream->GetPos();
+	DataStream* mapped = new MappedStream(mf, 0, mf->GetSize(), stream->originalfile);
+	mapped->Seek(pos, GEM_STREAM_START);
+	delete stream;
+	stream = mapped;
+}
+
+DataStream* BIFImporter::GetEntryStream(unsigned long offset, unsigned long size)
+{
+	if (!mapping) {
+		return SliceStream( stream, offset, size );
+	}
+	if (offset > mapping->GetSize() || size > mapping->GetSize() - offset) {
+		Log(ERROR, "BIFImporter", "Entry out of bounds in %s.", stream->originalfile);
+		return NULL;
+	}
+	return new MappedStream(mapping.get(), offset, size, stream->originalfile);
+}
+
 DataStream* BIFImporter::GetStream(unsigned long Resource, unsigned long Type)
 {
 	if (Type == IE_TIS_CLASS_ID) {
 		unsigned int srcResLoc = Resource & 0xFC000;
 		for (unsigned int i = 0; i < tentcount; i++) {
 			if (( tentries[i].resLocator & 0xFC000 ) == srcResLoc) {
-				return SliceStream( stream, tentries[i].dataOffset,
+				return GetEntryStream( tentries[i].dataOffset,
 							tentries[i].tileSize * tentries[i].tilesCount );
 			}
 		}
 	} else {
 		ieDword srcResLoc = Resource & 0x3FFF;
+		// the entries are normally in locator order, so try the direct index first
+		if (srcResLoc < fentcount && ( fentries[srcResLoc].resLocator & 0x3FFF ) == srcResLoc) {
+			return GetEntryStream( fentries[srcResLoc].dataOffset,
+						fentries[srcResLoc].fileSize );
+		}
 		for (ieDword i = 0; i < fentcount; i++) {
 			if (( fentries[i].resLocator & 0x3FFF ) == srcResLoc) {
-				return SliceStream( stream, fentries[i].dataOffset,
+				return GetEntryStream( fentries[i].dataOffset,
 							fentries[i].fileSize );
 			}
 		}
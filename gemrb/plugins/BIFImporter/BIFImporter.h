@@ -25,7 +25,9 @@
 
 #include "globals.h"
 
+#include "Holder.h"
 #include "System/DataStream.h"
+#include "System/MappedFile.h"
 
 namespace GemRB {
 
@@ -52,15 +54,17 @@ private:
 	TileEntry* tentries;
 	ieDword fentcount, tentcount;
 	DataStream* stream;
+	// the whole archive, if it could be mapped into memory
+	Holder<MappedFile> mapping;
 public:
 	BIFImporter(void);
 	~BIFImporter(void);
 	int OpenArchive(const char* filename);
 	DataStream* GetStream(unsigned long Resource, unsigned long Type);
 private:
-	static DataStream* DecompressBIF(DataStream* compressed, const char* path);
-	static DataStream* DecompressBIFC(DataStream* compressed, const char* path);
 	void ReadBIF(void);
+	void MapArchive(void);
+	DataStream* GetEntryStream(unsigned long offset, unsigned long size);
 };
 
 }
@@ -54,6 +54,48 @@ static int g_truecolor;
 static ieDword *cbAtFrame = NULL;
 static ieDword *strRef = NULL;
 
+namespace GemRB {
+
+class BIKWorker : public Thread {
+public:
+	typedef void (BIKPlayer::*Job)();
+	BIKWorker(BIKPlayer *owner, Job what) : player(owner), job(what) {}
+	~BIKWorker() { Join(); }
+protected:
+	void Run() { (player->*job)(); }
+private:
+	BIKPlayer *player;
+	Job job;
+};
+
+}
+
+static inline void release_buffer(AVFrame *p)
+{
+	int i;
+
+	for(i=0;i<3;i++) {
+		av_freep((void **) &p->data[i]);
+	}
+}
+
+static inline void ff_fill_linesize(AVFrame *picture, int width)
+{
+	memset(picture->linesize, 0, sizeof(picture->linesize));
+	int w2 = (width + (1 << 1) - 1) >> 1;
+	picture->linesize[0] = width;
+	picture->linesize[1] = w2;
+	picture->linesize[2] = w2;
+}
+
+static inline void get_buffer(AVFrame *p, int width, int height)
+{
+	ff_fill_linesize(p, width);
+	for(int plane=0;plane<3;plane++) {
+		p->data[plane] = (uint8_t *) av_malloc(p->linesize[plane]*height);
+	}
+}
+
 static const int ff_wma_critical_freqs[25] = {
 	100,   200,  300, 400,   510,  630,  770,    920,
 	1080, 1270, 1480, 1720, 2000, 2320, 2700,   3150,
@@ -86,6 +128,9 @@ BIKPlayer::BIKPlayer(void)
 	video_rendered_frame = done = validVideo = s_audio = false;
 	s_channels = s_first = s_stream = s_root = 0;
 	s_bands = NULL;
+	videoWorker = audioWorker = NULL;
+	decodeCount = 0;
+	decodeEnded = stopDecoding = false;
 }
 
 BIKPlayer::~BIKPlayer(void)
@@ -291,27 +336,201 @@ void BIKPlayer::timer_wait()
 	timer_start();
 }
 
-bool BIKPlayer::next_frame()
+/* reads the next frame, hands its audio to the audio worker and queues
+ * a copy of the decoded picture, returns false at the end of the movie
+ */
+bool BIKPlayer::DecodeNextFrame()
 {
-	if (timer_last_sec) {
-		timer_wait();
-	}
-	if(frameCount>=header.framecount) {
+	if (decodeCount >= header.framecount) {
 		return false;
 	}
-	binkframe frame = frames[frameCount++];
+	binkframe frame = frames[decodeCount++];
 	str->Seek(frame.pos, GEM_STREAM_START);
 	ieDword audframesize;
 	str->ReadDword(&audframesize);
 	frame.size = str->Read( inbuff, frame.size - 4 );
-	if (s_stream > -1 && DecodeAudioFrame(inbuff, audframesize)) {
-		//buggy frame, we stop immediately
-		//return false;
+	if (audframesize > frame.size) {
+		return false;
+	}
+	if (s_stream > -1 && audframesize) {
+		binkaudiopacket packet;
+		packet.size = audframesize;
+		packet.data = (ieByte *) malloc(audframesize);
+		memcpy(packet.data, inbuff, audframesize);
+		if (audioWorker) {
+			MutexLock l(queueLock);
+			audioPackets.push_back(packet);
+			audioQueued.Signal();
+		} else {
+			//buggy audio frames are ignored
+			DecodeAudioFrame(packet.data, packet.size);
+			free(packet.data);
+		}
 	}
 	if (DecodeVideoFrame(inbuff+audframesize, frame.size-audframesize)) {
 		//buggy frame, we stop immediately
 		return false;
 	}
+
+	AVFrame out;
+	memset(&out, 0, sizeof(AVFrame));
+	{
+		MutexLock l(queueLock);
+		if (freeFrames.size()) {
+			out = freeFrames.back();
+			freeFrames.pop_back();
+		}
+	}
+	if (!out.data[0]) {
+		get_buffer(&out, header.width, header.height);
+	}
+	for (int plane = 0; plane < 3; plane++) {
+		//the chroma planes have half the rows
+		int rows = plane ? (header.height + 1) >> 1 : header.height;
+		memcpy(out.data[plane], c_last.data[plane], c_last.linesize[plane]*rows);
+	}
+
+	MutexLock l(queueLock);
+	readyFrames.push_back(out);
+	frameDecoded.Signal();
+	return true;
+}
+
+void BIKPlayer::VideoLoop()
+{
+	while (true) {
+		{
+			MutexLock l(queueLock);
+			while (!stopDecoding && readyFrames.size() >= VIDEO_QUEUE_FRAMES) {
+				frameShown.Wait(queueLock);
+			}
+			if (stopDecoding) {
+				break;
+			}
+		}
+		if (!DecodeNextFrame()) {
+			break;
+		}
+	}
+
+	MutexLock l(queueLock);
+	decodeEnded = true;
+	frameDecoded.Signal();
+	audioQueued.Signal();
+}
+
+void BIKPlayer::AudioLoop()
+{
+	while (true) {
+		binkaudiopacket packet;
+		{
+			MutexLock l(queueLock);
+			while (!stopDecoding && !decodeEnded && audioPackets.empty()) {
+				audioQueued.Wait(queueLock);
+			}
+			if (stopDecoding || audioPackets.empty()) {
+				return;
+			}
+			packet = audioPackets.front();
+			audioPackets.pop_front();
+		}
+		//buggy audio frames are ignored
+		DecodeAudioFrame(packet.data, packet.size);
+		free(packet.data);
+	}
+}
+
+void BIKPlayer::StartWorkers()
+{
+	decodeCount = 0;
+	decodeEnded = stopDecoding = false;
+
+	//the audio worker must exist before the video worker hands out packets
+	if (s_stream > -1) {
+		audioWorker = new BIKWorker(this, &BIKPlayer::AudioLoop);
+		if (!audioWorker->Start()) {
+			Log(WARNING, "BIKPlayer", "Couldn't start the audio thread, decoding the audio inline.");
+			delete audioWorker;
+			audioWorker = NULL;
+		}
+	}
+	videoWorker = new BIKWorker(this, &BIKPlayer::VideoLoop);
+	if (!videoWorker->Start()) {
+		Log(WARNING, "BIKPlayer", "Couldn't start the video thread, decoding the frames inline.");
+		delete videoWorker;
+		videoWorker = NULL;
+	}
+}
+
+void BIKPlayer::StopWorkers()
+{
+	{
+		MutexLock l(queueLock);
+		stopDecoding = true;
+		frameShown.Broadcast();
+		audioQueued.Broadcast();
+	}
+	//the destructors join them
+	delete videoWorker;
+	videoWorker = NULL;
+	delete audioWorker;
+	audioWorker = NULL;
+
+	while (readyFrames.size()) {
+		release_buffer(&readyFrames.front());
+		readyFrames.pop_front();
+	}
+	for (size_t i = 0; i < freeFrames.size(); i++) {
+		release_buffer(&freeFrames[i]);
+	}
+	freeFrames.clear();
+	while (audioPackets.size()) {
+		free(audioPackets.front().data);
+		audioPackets.pop_front();
+	}
+}
+
+bool BIKPlayer::next_frame()
+{
+	if (timer_last_sec) {
+		timer_wait();
+	}
+
+	AVFrame frame;
+	{
+		//without the video worker this thread decodes on demand
+		if (!videoWorker && readyFrames.empty() && !DecodeNextFrame()) {
+			MutexLock l(queueLock);
+			decodeEnded = true;
+			audioQueued.Signal();
+		}
+		MutexLock l(queueLock);
+		while (readyFrames.empty() && !decodeEnded) {
+			frameDecoded.Wait(queueLock);
+		}
+		if (readyFrames.empty()) {
+			return false;
+		}
+		frame = readyFrames.front();
+		readyFrames.pop_front();
+	}
+	frameCount++;
+
+	if (video_frameskip) {
+		video_frameskip--;
+		video_skippedframes++;
+	} else {
+		unsigned int dest_x = (outputwidth - header.width) >> 1;
+		unsigned int dest_y = (outputheight - header.height) >> 1;
+		showFrame((ieByte **) frame.data, (unsigned int *) frame.linesize, header.width, header.height, header.width, header.height, dest_x, dest_y);
+	}
+
+	{
+		MutexLock l(queueLock);
+		freeFrames.push_back(frame);
+		frameShown.Signal();
+	}
+
 	if (!timer_last_sec) {
 		timer_start();
 	}
@@ -343,9 +562,11 @@ int BIKPlayer::doPlay()
 		return 2;
 	}
 
+	StartWorkers();
 	while (!done && next_frame()) {
 		done = video->PollMovieEvents();
 	}
+	StopWorkers();
 
 	video->DestroyMovieScreen();
 	return 0;
@@ -559,32 +780,6 @@ int BIKPlayer::EndAudio()
 	return 0;
 }
 
-static inline void release_buffer(AVFrame *p)
-{
-	int i;
-
-	for(i=0;i<3;i++) {
-		av_freep((void **) &p->data[i]);
-	}
-}
-
-static inline void ff_fill_linesize(AVFrame *picture, int width)
-{
-	memset(picture->linesize, 0, sizeof(picture->linesize));
-	int w2 = (width + (1 << 1) - 1) >> 1;
-	picture->linesize[0] = width;
-	picture->linesize[1] = w2;
-	picture->linesize[2] = w2;
-}
-
-static inline void get_buffer(AVFrame *p, int width, int height)
-{
-	ff_fill_linesize(p, width);
-	for(int plane=0;plane<3;plane++) {
-		p->data[plane] = (uint8_t *) av_malloc(p->linesize[plane]*height);
-	}
-}
-
 int BIKPlayer::EndVideo()
 {
 	int i;
@@ -1235,25 +1430,6 @@ inline int BIKPlayer::get_value(int bundle)
 	dst[(x)*2 +     ((y)*2 + 1) * stride] = \
 	dst[(x)*2 + 1 + ((y)*2 + 1) * stride] = pix;
 
-static void get_pixels(DCTELEM *block, const uint8_t *pixels, int line_size)
-{
-	int i;
-
-	/* read the pixels */
-	for(i=0;i<8;i++) {
-		block[0] = pixels[0];
-		block[1] = pixels[1];
-		block[2] = pixels[2];
-		block[3] = pixels[3];
-		block[4] = pixels[4];
-		block[5] = pixels[5];
-		block[6] = pixels[6];
-		block[7] = pixels[7];
-		pixels += line_size;
-		block += 8;
-	}
-}
-
 static void put_pixels_nonclamped(const DCTELEM *block, uint8_t *pixels, int line_size)
 {
 	int i;
@@ -1291,10 +1467,12 @@ static void add_pixels_nonclamped(const DCTELEM *block, uint8_t *pixels, int lin
 	}
 }
 
-static inline void copy_block(DCTELEM block[64], const uint8_t *src, uint8_t *dst, int stride)
+//the source is always the previous frame, so the rows never overlap
+static inline void copy_block(const uint8_t *src, uint8_t *dst, int stride)
 {
-	get_pixels(block, src, stride);
-	put_pixels_nonclamped(block, dst, stride);
+	for (int i = 0; i < 8; i++) {
+		memcpy(dst + i*stride, src + i*stride, 8);
+	}
 }
 
 #define clear_block(block) memset( (block), 0, sizeof(DCTELEM)*64);
@@ -1306,6 +1484,12 @@ static void bink_idct(DCTELEM *block)
 	int tblock[64];
 
 	for (i = 0; i < 8; i++) {
+		//most columns have no AC coefficients, those stay flat
+		if (!(block[i+8] | block[i+16] | block[i+24] | block[i+32] | block[i+40] | block[i+48] | block[i+56])) {
+			tblock[i+ 0] = tblock[i+ 8] = tblock[i+16] = tblock[i+24] =
+			tblock[i+32] = tblock[i+40] = tblock[i+48] = tblock[i+56] = block[i];
+			continue;
+		}
 		t0 = block[i+ 0] + block[i+32];
 		t1 = block[i+ 0] - block[i+32];
 		t2 = block[i+16] + block[i+48];
@@ -1341,6 +1525,12 @@ static void bink_idct(DCTELEM *block)
 	}
 
 	for (i = 0; i < 64; i += 8) {
+		if (!(tblock[i+1] | tblock[i+2] | tblock[i+3] | tblock[i+4] | tblock[i+5] | tblock[i+6] | tblock[i+7])) {
+			DCTELEM v = (tblock[i] + 0x7F) >> 8;
+			block[i+0] = block[i+1] = block[i+2] = block[i+3] =
+			block[i+4] = block[i+5] = block[i+6] = block[i+7] = v;
+			continue;
+		}
 		t0 = tblock[i+0] + tblock[i+4];
 		t1 = tblock[i+0] - tblock[i+4];
 		t2 = tblock[i+2] + tblock[i+6];
@@ -1458,7 +1648,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				}
 				switch (blk) {
 				case SKIP_BLOCK:
-					copy_block(block, prev, dst, stride);
+					copy_block(prev, dst, stride);
 					break;
 				case SCALED_BLOCK:
 					blk = get_value(BINK_SRC_SUB_BLOCK_TYPES);
@@ -1532,7 +1722,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case MOTION_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					copy_block(prev + xoff + yoff*stride, dst, stride);
 					break;
 				case RUN_BLOCK:
 					scan = bink_patterns[v_gb.get_bits(4)];
@@ -1561,7 +1751,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case RESIDUE_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					copy_block(prev + xoff + yoff*stride, dst, stride);
 					clear_block(block);
 					v = v_gb.get_bits(7);
 					read_residue(block, v);
@@ -1582,7 +1772,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 				case INTER_BLOCK:
 					xoff = get_value(BINK_SRC_X_OFF);
 					yoff = get_value(BINK_SRC_Y_OFF);
-					copy_block(block, prev + xoff + yoff*stride, dst, stride);
+					copy_block(prev + xoff + yoff*stride, dst, stride);
 					clear_block(block);
 					block[0] = get_value(BINK_SRC_INTER_DC);
 					read_dct_coeffs(block, c_scantable.permutated,false);
@@ -1613,16 +1803,7 @@ int BIKPlayer::DecodeVideoFrame(void *data, int data_size)
 		v_gb.get_bits_align32();
 	}
 
-	if (video_frameskip) {
-		video_frameskip--;
-		video_skippedframes++;
-	} else {
-		unsigned int dest_x = (outputwidth - header.width) >> 1;
-		unsigned int dest_y = (outputheight - header.height) >> 1;
-		showFrame((ieByte **) c_pic.data, (unsigned int *) c_pic.linesize, header.width, header.height, header.width, header.height, dest_x, dest_y);
-	}
-
-	//release the old frame even when frame is skipped
+	//the frame is presented from a copy, this one is kept as the reference
 	release_buffer(&c_last);
 	memcpy(&c_last, &c_pic, sizeof(AVFrame));
 	memset(&c_pic, 0, sizeof(AVFrame));
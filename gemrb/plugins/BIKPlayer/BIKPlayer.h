@@ -27,6 +27,9 @@
 #include "win32def.h"
 
 #include "Interface.h"
+#include "System/Thread.h"
+
+#include <deque>
 
 // FIXME: This has to be included last, since it defines int*_t, which causes
 // mingw g++ 4.5.0 to choke.
@@ -41,6 +44,8 @@ namespace GemRB {
 #define BIK_SIGNATURE_DATA "BIKi"
 
 #define MAX_CHANNELS 2
+// video frames decoded ahead of their presentation
+#define VIDEO_QUEUE_FRAMES 4
 #define BINK_BLOCK_MAX_SIZE (MAX_CHANNELS << 11)
 
 #if defined(__arm__)
@@ -144,6 +149,11 @@ typedef struct {
 	ieDword size;
 } binkframe;
 
+typedef struct {
+	ieByte *data;
+	int size;
+} binkaudiopacket;
+
 typedef struct Bundle {
 	  int     len;       ///< length of number of entries to decode (in bits)
 	  Tree    tree;      ///< Huffman tree-related data
@@ -153,7 +163,10 @@ typedef struct Bundle {
 	  uint8_t *cur_ptr;  ///< pointer to the data that is not read from buffer yet
 } Bundle;
 
+class BIKWorker;
+
 class BIKPlayer : public MoviePlayer {
+	friend class BIKWorker;
 private:
 	Video *video;
 	bool validVideo;
@@ -213,6 +226,21 @@ private:
 	GetBitContext v_gb;
 	AVFrame c_pic, c_last;
 
+	//the frames are read and decoded ahead on the video worker, the audio
+	//is decoded on its own worker; the main thread only presents them
+	BIKWorker *videoWorker;
+	BIKWorker *audioWorker;
+	Mutex queueLock;
+	ConditionVariable frameDecoded;
+	ConditionVariable frameShown;
+	ConditionVariable audioQueued;
+	std::deque<AVFrame> readyFrames;
+	std::vector<AVFrame> freeFrames;
+	std::deque<binkaudiopacket> audioPackets;
+	ieDword decodeCount;
+	bool decodeEnded;
+	bool stopDecoding;
+
 private:
 	void timer_start();
 	void timer_wait();
@@ -248,6 +276,11 @@ private:
 	void read_bundle(int bundle_num);
 	void init_lengths(int width, int bw);
 	int DecodeVideoFrame(void *data, int data_size);
+	bool DecodeNextFrame();
+	void VideoLoop();
+	void AudioLoop();
+	void StartWorkers();
+	void StopWorkers();
 	int EndAudio();
 	int EndVideo();
 public:
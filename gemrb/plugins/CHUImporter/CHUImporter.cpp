@@ -35,88 +35,167 @@
 #include "GUI/TextArea.h"
 #include "GUI/TextEdit.h"
 #include "GUI/Window.h"
+#include "System/MemoryStream.h"
 
 using namespace GemRB;
 
 CHUImporter::CHUImporter()
 {
-	str = NULL;
-	WindowCount = CTOffset = WEOffset = 0;
+	pack = NULL;
 }
 
 CHUImporter::~CHUImporter()
 {
-	delete str;
+	std::map<std::string, CHUPack*>::iterator p;
+	for (p = packs.begin(); p != packs.end(); ++p) {
+		delete p->second->str;
+		delete p->second;
+	}
+	std::map<std::string, Sprite2D*>::iterator i;
+	for (i = images.begin(); i != images.end(); ++i) {
+		Sprite2D::FreeSprite(i->second);
+	}
+}
+
+static std::string PackKey(const char* name)
+{
+	ieResRef key;
+	strnlwrcpy(key, name, 8);
+	return key;
+}
+
+/** Switches to an already loaded window pack */
+bool CHUImporter::Select(const char* name)
+{
+	std::map<std::string, CHUPack*>::iterator p = packs.find(PackKey(name));
+	if (p == packs.end()) {
+		return false;
+	}
+	pack = p->second;
+	return true;
 }
 
 /** This function loads all available windows from the 'stream' parameter. */
-bool CHUImporter::Open(DataStream* stream)
+bool CHUImporter::Open(DataStream* stream, const char* name)
 {
 	if (stream == NULL) {
 		return false;
 	}
-	delete str;
-	str = stream;
+	// keep the whole file in memory, instead of an open handle per pack
+	unsigned long length = stream->Size();
+	void* data = malloc(length);
+	if (stream->Read(data, length) != (int) length) {
+		Log(ERROR, "CHUImporter", "Cannot read %s", stream->originalfile);
+		free(data);
+		delete stream;
+		return false;
+	}
+	DataStream* str = new MemoryStream(stream->originalfile, data, length);
+	delete stream;
+
 	char Signature[8];
+	ieDword WindowCount, WEOffset;
 	str->Read( Signature, 8 );
 	if (strncmp( Signature, "CHUIV1  ", 8 ) != 0) {
 		Log(ERROR, "CHUImporter", "Not a Valid CHU File");
+		delete str;
 		return false;
 	}
+	CHUPack* newPack = new CHUPack();
+	newPack->str = str;
 	str->ReadDword( &WindowCount );
-	str->ReadDword( &CTOffset );
+	str->ReadDword( &newPack->CTOffset );
 	str->ReadDword( &WEOffset );
+
+	newPack->windows.resize(WindowCount);
+	for (unsigned int c = 0; c < WindowCount; c++) {
+		CHUWindow& window = newPack->windows[c];
+		str->Seek( WEOffset + ( 0x1c * c ), GEM_STREAM_START );
+		str->ReadWord( &window.WindowID );
+		str->Seek( 2, GEM_CURRENT_POS );
+		str->ReadWord( &window.XPos );
+		str->ReadWord( &window.YPos );
+		str->ReadWord( &window.Width );
+		str->ReadWord( &window.Height );
+		str->ReadWord( &window.BackGround );
+		str->ReadWord( &window.ControlsCount );
+		str->ReadResRef( window.MosFile );
+		str->ReadWord( &window.FirstControl );
+	}
+
+	std::string key = PackKey(name);
+	std::map<std::string, CHUPack*>::iterator p = packs.find(key);
+	if (p != packs.end()) {
+		delete p->second->str;
+		delete p->second;
+	}
+	packs[key] = newPack;
+	pack = newPack;
 	return true;
 }
 
+/** Returns a new reference to the decoded MOS image, NULL if it is missing */
+Sprite2D* CHUImporter::GetImage(const ieResRef resref)
+{
+	std::string key = PackKey(resref);
+	std::map<std::string, Sprite2D*>::iterator i = images.find(key);
+	if (i != images.end()) {
+		if (i->second) {
+			i->second->acquire();
+		}
+		return i->second;
+	}
+
+	Sprite2D* img = NULL;
+	ResourceHolder<ImageMgr> mos(resref);
+	if (mos) {
+		img = mos->GetSprite2D();
+	}
+	images[key] = img;
+	if (img) {
+		img->acquire();
+	}
+	return img;
+}
+
 /** Returns the i-th window in the Previously Loaded Stream */
 Window* CHUImporter::GetWindow(unsigned int wid)
 {
-	ieWord WindowID, XPos, YPos, Width, Height, BackGround;
-	ieWord ControlsCount, FirstControl;
-	ieResRef MosFile;
 	unsigned int i;
 
-	if (!str) {
+	if (!pack) {
 		Log(ERROR, "CHUImporter", "No data stream to read from, skipping controls");
 		return NULL;
 	}
 
-	bool found = false;
-	for (unsigned int c = 0; c < WindowCount; c++) {
-		str->Seek( WEOffset + ( 0x1c * c ), GEM_STREAM_START );
-		str->ReadWord( &WindowID );
-		if (WindowID == wid) {
-			found = true;
+	const CHUWindow* window = NULL;
+	for (unsigned int c = 0; c < pack->windows.size(); c++) {
+		if (pack->windows[c].WindowID == wid) {
+			window = &pack->windows[c];
 			break;
 		}
 	}
-	if (!found) {
+	if (!window) {
 		return NULL;
 	}
-	str->Seek( 2, GEM_CURRENT_POS );
-	str->ReadWord( &XPos );
-	str->ReadWord( &YPos );
-	str->ReadWord( &Width );
-	str->ReadWord( &Height );
-	str->ReadWord( &BackGround );
-	str->ReadWord( &ControlsCount );
-	str->ReadResRef( MosFile );
-	str->ReadWord( &FirstControl );
-
-	Window* win = new Window( WindowID, XPos, YPos, Width, Height );
-	if (BackGround == 1) {
-		ResourceHolder<ImageMgr> mos(MosFile);
-		if (mos != NULL) {
-			win->SetBackGround( mos->GetSprite2D(), true );
+	DataStream* str = pack->str;
+	ieDword CTOffset = pack->CTOffset;
+	ieWord WindowID = window->WindowID;
+	ieWord Width = window->Width;
+
+	Window* win = new Window( WindowID, window->XPos, window->YPos, Width, window->Height );
+	if (window->BackGround == 1) {
+		Sprite2D* img = GetImage(window->MosFile);
+		if (img) {
+			win->SetBackGround( img, true );
 		}
 	}
 	if (!core->IsAvailable( IE_BAM_CLASS_ID )) {
 		Log(ERROR, "CHUImporter", "No BAM Importer Available, skipping controls");
 		return win;
 	}
-	for (i = 0; i < ControlsCount; i++) {
-		str->Seek( CTOffset + ( ( FirstControl + i ) * 8 ), GEM_STREAM_START );
+	for (i = 0; i < window->ControlsCount; i++) {
+		str->Seek( CTOffset + ( ( window->FirstControl + i ) * 8 ), GEM_STREAM_START );
 		ieDword COffset, CLength, ControlID;
 		Region ctrlFrame;
 		ieWord tmp;
@@ -237,12 +316,10 @@ Window* CHUImporter::GetWindow(unsigned int wid)
 				Sprite2D* img = NULL;
 				Sprite2D* img2 = NULL;
 				if ( MOSFile[0] ) {
-					ResourceHolder<ImageMgr> mos(MOSFile);
-					img = mos->GetSprite2D();
+					img = GetImage(MOSFile);
 				}
 				if ( MOSFile2[0] ) {
-					ResourceHolder<ImageMgr> mos(MOSFile2);
-					img2 = mos->GetSprite2D();
+					img2 = GetImage(MOSFile2);
 				}
 
 				pbar->SetImage( img, img2 );
@@ -258,9 +335,7 @@ Window* CHUImporter::GetWindow(unsigned int wid)
 					}
 				}
 				else {
-					ResourceHolder<ImageMgr> mos(BAMFile);
-					Sprite2D* img3 = mos->GetSprite2D();
-					pbar->SetBarCap( img3 );
+					pbar->SetBarCap( GetImage(BAMFile) );
 				}
 				win->AddControl( pbar );
 			}
@@ -282,8 +357,7 @@ Window* CHUImporter::GetWindow(unsigned int wid)
 				str->ReadWord( &KnobStepsCount );
 				Slider* sldr = new Slider( ctrlFrame, KnobXPos, KnobYPos, KnobStep, KnobStepsCount, true );
 				sldr->ControlID = ControlID;
-				ResourceHolder<ImageMgr> mos(MOSFile);
-				Sprite2D* img = mos->GetSprite2D();
+				Sprite2D* img = GetImage(MOSFile);
 				sldr->SetImage( IE_GUI_SLIDER_BACKGROUND, img);
 
 				AnimationFactory* bam = ( AnimationFactory* )
@@ -344,11 +418,7 @@ Window* CHUImporter::GetWindow(unsigned int wid)
 					cursor = bam->GetFrame( CurCycle, CurFrame );
 				}
 
-				ResourceHolder<ImageMgr> mos(BGMos);
-				Sprite2D *img = NULL;
-				if(mos) {
-					img = mos->GetSprite2D();
-				}
+				Sprite2D *img = GetImage(BGMos);
 
 				TextEdit* te = new TextEdit( ctrlFrame, maxInput, PosX, PosY );
 				te->ControlID = ControlID;
@@ -482,7 +552,10 @@ endalign:
 /** Returns the number of available windows */
 unsigned int CHUImporter::GetWindowsCount()
 {
-	return WindowCount;
+	if (!pack) {
+		return 0;
+	}
+	return (unsigned int) pack->windows.size();
 }
 
 #include "plugindef.h"
@@ -25,17 +25,40 @@
 
 #include "System/DataStream.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace GemRB {
 
+class Sprite2D;
+
+struct CHUWindow {
+	ieWord WindowID, XPos, YPos, Width, Height, BackGround;
+	ieWord ControlsCount, FirstControl;
+	ieResRef MosFile;
+};
+
+/** A parsed window table and the in-memory file holding the control records */
+struct CHUPack {
+	DataStream* str;
+	ieDword CTOffset;
+	std::vector<CHUWindow> windows;
+};
+
 /**CHU File Importer Class
   *@author GemRB Developement Team
   */
 
 class CHUImporter : public WindowMgr {
 private:
-	DataStream* str;
-//	bool autoFree;
-	ieDword WindowCount, CTOffset, WEOffset;
+	// every opened pack stays parsed, the same screens are opened over and over
+	std::map<std::string, CHUPack*> packs;
+	CHUPack* pack;
+	// decoded MOS images, shared by all the windows using them
+	std::map<std::string, Sprite2D*> images;
+
+	Sprite2D* GetImage(const ieResRef resref);
 public: 
 	CHUImporter();
 	~CHUImporter();
@@ -44,7 +67,9 @@ public:
 	/** Returns the i-th window in the Previously Loaded Stream */
 	Window* GetWindow(unsigned int i);
 	/** This function loads all available windows from the 'stream' parameter. */
-	bool Open(DataStream* stream);
+	bool Open(DataStream* stream, const char* name);
+	/** Switches to an already loaded window pack */
+	bool Select(const char* name);
 };
 
 }
@@ -382,11 +382,11 @@ static const ieResRef *ResolveSpellIndex(int index, int level, ieIWD2SpellType t
 		int level2 = spllist[index].FindSpell(type);
 		// grrr, some rows have no levels set - they're all 0, but with a valid resref, so just return that
 		if (level2 == -1) {
-			Log(DEBUG, "CREImporter", "Spell entry (%d) without any levels set!", index);
+			LogDebug("CREImporter", "Spell entry (%d) without any levels set!", index);
 			return spllist[index].GetSpell();
 		}
 		ret = spllist[index].FindSpell(level2, type);
-		if (ret) Log(DEBUG, "CREImporter", "The spell was found at level %d!", level2);
+		if (ret) LogDebug("CREImporter", "The spell was found at level %d!", level2);
 	}
 	if (ret || (kit==-1) ) {
 		return ret;
@@ -543,6 +543,7 @@ CREImporter::CREImporter(void)
 	CREOffset = ItemSlotsOffset = ItemsOffset = ItemsCount = VariablesCount = 0;
 	OverlayOffset = OverlayMemorySize = QWPCount = QSPCount = QITCount = 0;
 	IsCharacter = false;
+	effectsDecoded = false;
 }
 
 CREImporter::~CREImporter(void)
@@ -557,6 +558,12 @@ bool CREImporter::Open(DataStream* stream)
 	}
 	delete str;
 	str = stream;
+	decodedEffects.clear();
+	effectsDecoded = false;
+	// plugins are only created on the main thread, so this is done here
+	if (!fxImporter && core->IsAvailable(IE_EFF_CLASS_ID)) {
+		fxImporter = PluginHolder<EffectMgr>(IE_EFF_CLASS_ID);
+	}
 	char Signature[8];
 	str->Read( Signature, 8 );
 	IsCharacter = false;
@@ -1380,10 +1387,70 @@ void CREImporter::ReadInventory(Actor *act, unsigned int Inventory_Size)
 	free(memorized_spells);
 }
 
+/** Reads the effect table before GetActor gets to it. Only the header of
+ * the original versions is known without reading the rest of it, the
+ * effect table offsets are right before the dialog resref at its end. */
+void CREImporter::DecodeEffects()
+{
+	ieDword headersize;
+	switch (CREVersion) {
+		case IE_CRE_V1_0:
+		case IE_CRE_V1_1:
+			headersize = 0x2d4;
+			break;
+		case IE_CRE_V1_2:
+			headersize = 0x378;
+			break;
+		case IE_CRE_V2_2:
+			headersize = 0x62e;
+			break;
+		case IE_CRE_V9_0:
+			headersize = 0x33c;
+			break;
+		default:
+			return;
+	}
+	if (!fxImporter) {
+		return;
+	}
+
+	unsigned long pos = str->GetPos();
+	ieByte fxVersion;
+	ieDword offset, count;
+	str->Seek( CREOffset + 0x33, GEM_STREAM_START );
+	str->Read( &fxVersion, 1 );
+	str->Seek( CREOffset + headersize - 16, GEM_STREAM_START );
+	str->ReadDword( &offset );
+	str->ReadDword( &count );
+
+	str->Seek( CREOffset + offset, GEM_STREAM_START );
+	decodedEffects.resize(count);
+	fxImporter->Open( str, false );
+	for (unsigned int i = 0; i < count; i++) {
+		if (fxVersion) {
+			fxImporter->GetEffectV20( &decodedEffects[i] );
+		} else {
+			fxImporter->GetEffectV1( &decodedEffects[i] );
+		}
+	}
+	effectsDecoded = true;
+	// GetActor goes on from right after the signature
+	str->Seek( pos, GEM_STREAM_START );
+}
+
 void CREImporter::ReadEffects(Actor *act)
 {
 	unsigned int i;
 
+	if (effectsDecoded) {
+		for (i = 0; i < decodedEffects.size(); i++) {
+			act->fxqueue.AddEffect( &decodedEffects[i] );
+		}
+		decodedEffects.clear();
+		effectsDecoded = false;
+		return;
+	}
+
 	str->Seek( EffectsOffset+CREOffset, GEM_STREAM_START );
 
 	for (i = 0; i < EffectsCount; i++) {
@@ -1396,13 +1463,11 @@ void CREImporter::ReadEffects(Actor *act)
 
 void CREImporter::GetEffect(Effect *fx)
 {
-	PluginHolder<EffectMgr> eM(IE_EFF_CLASS_ID);
-
-	eM->Open( str, false );
+	fxImporter->Open( str, false );
 	if (TotSCEFF) {
-		eM->GetEffectV20( fx );
+		fxImporter->GetEffectV20( fx );
 	} else {
-		eM->GetEffectV1( fx );
+		fxImporter->GetEffectV1( fx );
 	}
 }
 
@@ -3008,7 +3073,7 @@ int CREImporter::PutEffects( DataStream *stream, Actor *actor)
 	PluginHolder<EffectMgr> eM(IE_EFF_CLASS_ID);
 	assert(eM != NULL);
 
-	std::list< Effect* >::const_iterator f=actor->fxqueue.GetFirstEffect();
+	EffectList::const_iterator f=actor->fxqueue.GetFirstEffect();
 	for(unsigned int i=0;i<EffectsCount;i++) {
 		const Effect *fx = actor->fxqueue.GetNextSavedEffect(f);
 
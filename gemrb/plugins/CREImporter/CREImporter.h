@@ -22,8 +22,12 @@
 #define CREIMPORTER_H
 
 #include "ActorMgr.h"
+#include "EffectMgr.h"
+#include "PluginMgr.h"
 #include "Spellbook.h"
 
+#include <vector>
+
 namespace GemRB {
 
 class CREItem;
@@ -63,11 +67,16 @@ private:
 	int QWPCount; //weapons
 	int QSPCount; //spells
 	int QITCount; //items
+	PluginHolder<EffectMgr> fxImporter;
+	// the saved effects read by DecodeEffects, if it was called
+	std::vector<Effect> decodedEffects;
+	bool effectsDecoded;
 public:
 	CREImporter(void);
 	~CREImporter(void);
 	bool Open(DataStream* stream);
 	Actor* GetActor(unsigned char is_in_party);
+	void DecodeEffects();
 
 	int FindSpellType(char *name, unsigned short &level, unsigned int clsmsk, unsigned int kit) const;
 
@@ -177,7 +177,8 @@ Condition* DLGImporter::GetCondition(char* string) const
 		if (!trigger) {
 			Log(WARNING, "DLGImporter", "Can't compile trigger: %s", lines[i]);
 		} else {
-			condition->triggers.push_back(trigger);
+			condition->triggers.push_back(*trigger);
+			trigger->Release();
 		}
 		free( lines[i] );
 	}
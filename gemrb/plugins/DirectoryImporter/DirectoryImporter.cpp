@@ -23,10 +23,18 @@
 
 #include "Interface.h"
 #include "ResourceDesc.h"
+#include "SaveExtractor.h"
 #include "System/FileStream.h"
 
+#include <ctime>
+
 using namespace GemRB;
 
+// how often the directories are checked for new files, in ms
+#define WATCH_INTERVAL 1000
+
+static const char SnapshotSignature[] = "DIRSNAP1";
+
 DirectoryImporter::DirectoryImporter(void)
 {
 	description = NULL;
@@ -51,6 +59,15 @@ bool DirectoryImporter::Open(const char *dir, const char *desc)
 	return true;
 }
 
+// the members of a loaded save only reach the cache once they are looked for
+static void ExtractPending(const char *path)
+{
+	SaveExtractor *extractor = core->GetSaveExtractor();
+	if (extractor) {
+		extractor->Extract(path);
+	}
+}
+
 static bool FindIn(const char *Path, const char *ResRef, const char *Type)
 {
 	char p[_MAX_PATH], f[_MAX_PATH] = {0};
@@ -60,7 +77,10 @@ static bool FindIn(const char *Path, const char *ResRef, const char *Type)
 	}
 	strlwr(f);
 
-	return PathJoinExt(p, Path, f, Type);
+	if (!PathJoinExt(p, Path, f, Type))
+		return false;
+	ExtractPending(p);
+	return true;
 }
 
 static FileStream *SearchIn(const char * Path,const char * ResRef, const char *Type)
@@ -74,6 +94,7 @@ static FileStream *SearchIn(const char * Path,const char * ResRef, const char *T
 
 	if (!PathJoinExt(p, Path, f, Type))
 		return NULL;
+	ExtractPending(p);
 
 	return FileStream::OpenFile(p);
 }
@@ -98,8 +119,32 @@ DataStream* DirectoryImporter::GetResource(const char* resname, const ResourceDe
 	return SearchIn( path, resname, type.GetExt() );
 }
 
+bool DirectoryImporter::LocateResource(const char* resname, SClass_ID type, ResourceLocation &location)
+{
+	char f[_MAX_PATH] = {0};
+	if (strlcpy(f, resname, _MAX_PATH) >= _MAX_PATH) {
+		return false;
+	}
+	strlwr(f);
+
+	if (!PathJoinExt(location.path, path, f, core->TypeExt(type)))
+		return false;
+	ExtractPending(location.path);
+	location.archived = false;
+	location.locator = 0;
+	location.type = type;
+	return true;
+}
+
+bool DirectoryImporter::IsLive() const
+{
+	return true;
+}
+
 CachedDirectoryImporter::CachedDirectoryImporter()
 {
+	lastPoll = 0;
+	listed = hashed = 0;
 }
 
 CachedDirectoryImporter::~CachedDirectoryImporter()
@@ -111,18 +156,56 @@ bool CachedDirectoryImporter::Open(const char *dir, const char *desc)
 	if (!DirectoryImporter::Open(dir, desc))
 		return false;
 
-	Refresh();
+	// before listing, so nothing slips between the two
+	watch.Watch(path);
+	lastPoll = GetTickCount();
+	if (!LoadSnapshot()) {
+		Refresh();
+	}
 
 	return true;
 }
 
+void CachedDirectoryImporter::InitCache(unsigned int count)
+{
+	// limit to 4k buckets
+	// less than 1% of the bg2+fixpack override are of bucket length >4
+	// an empty directory still gets a table, files may show up later
+	cache.init(count > 4 * 1024 ? 4 * 1024 : (count ? count : 1), count);
+	listed = hashed = 0;
+}
+
+void CachedDirectoryImporter::AddFile(const char *name)
+{
+	char buf[_MAX_PATH];
+	strnlwrcpy(buf, name, _MAX_PATH, false);
+	if (cache.set(buf, name)) {
+		Log(ERROR, "CachedDirectoryImporter", "Duplicate '%s' files in '%s' directory", buf, path);
+	} else {
+		listed++;
+	}
+}
+
+void CachedDirectoryImporter::RemoveFile(const char *name)
+{
+	char buf[_MAX_PATH];
+	strnlwrcpy(buf, name, _MAX_PATH, false);
+	if (cache.remove(buf)) {
+		listed--;
+	}
+}
+
 void CachedDirectoryImporter::Refresh()
 {
 	cache.clear();
+	// forget the misses the old listing answered
+	Changed();
 
 	DirectoryIterator it(path);
-	if (!it)
+	if (!it) {
+		InitCache(0);
 		return;
+	}
 
 	unsigned int count = 0;
 	do {
@@ -131,22 +214,121 @@ void CachedDirectoryImporter::Refresh()
 		count++;
 	} while (++it);
 
-	// limit to 4k buckets
-	// less than 1% of the bg2+fixpack override are of bucket length >4
-	cache.init(count > 4 * 1024 ? 4 * 1024 : count, count);
+	InitCache(count);
+	hashed = count;
 
 	it.Rewind();
 
-	char buf[_MAX_PATH];
+	// the snapshot starts with the directory itself
+	std::string names(path, strlen(path) + 1);
 	do {
 		if (it.IsDirectory())
 			continue;
 		const char *name = it.GetName();
-		strnlwrcpy(buf, name, _MAX_PATH, false);
-		if (cache.set(buf, name)) {
-			Log(ERROR, "CachedDirectoryImporter", "Duplicate '%s' files in '%s' directory", buf, path);
-		}
+		AddFile(name);
+		names.append(name, strlen(name) + 1);
 	} while (++it);
+
+	SaveSnapshot(names, count);
+}
+
+void CachedDirectoryImporter::Update()
+{
+	unsigned long now = GetTickCount();
+	if (now - lastPoll < WATCH_INTERVAL)
+		return;
+	lastPoll = now;
+
+	std::vector<DirectoryChange> changes;
+	switch (watch.Poll(changes)) {
+		case WATCH_UNCHANGED:
+			return;
+		case WATCH_RESCAN:
+			Refresh();
+			return;
+		case WATCH_CHANGED:
+			break;
+	}
+	for (size_t i = 0; i < changes.size(); i++) {
+		// a file may also get replaced in place
+		RemoveFile(changes[i].name.c_str());
+		if (!changes[i].removed) {
+			AddFile(changes[i].name.c_str());
+		}
+	}
+	// the table doesn't grow, so start over once the chains get long
+	if (listed > 2 * hashed + 16) {
+		Refresh();
+		return;
+	}
+	Changed();
+}
+
+void CachedDirectoryImporter::GetSnapshotPath(char *file) const
+{
+	ieDword hash = 2166136261u;
+	for (const char *c = path; *c; c++) {
+		hash = (hash ^ (unsigned char) *c) * 16777619u;
+	}
+	char name[16];
+	snprintf(name, sizeof(name), "%08x", hash);
+	PathJoinExt(file, core->CachePath, name, "dir");
+}
+
+// the file is only a cache, so it is kept in the native layout
+// it is trusted as long as the directory wasn't modified since
+bool CachedDirectoryImporter::LoadSnapshot()
+{
+	time_t mtime = DirectoryWatch::GetModificationTime(path);
+	if (!mtime)
+		return false;
+
+	char file[_MAX_PATH];
+	GetSnapshotPath(file);
+	FileStream *f = FileStream::OpenFile(file);
+	if (!f)
+		return false;
+
+	char signature[8];
+	ieDword header[3];
+	std::vector<char> names;
+	bool ok = f->Read(signature, 8) == 8 && !memcmp(signature, SnapshotSignature, 8) &&
+		f->Read(header, sizeof(header)) == (int) sizeof(header) &&
+		header[0] == (ieDword) mtime && header[2] && f->Remains() == header[2];
+	if (ok) {
+		names.resize(header[2]);
+		ok = f->Read(&names[0], header[2]) == (int) header[2] && names.back() == '\0';
+	}
+	delete f;
+	if (!ok || strcmp(&names[0], path))
+		return false;
+
+	Changed();
+	InitCache(header[1]);
+	hashed = header[1];
+	const char *end = &names[0] + names.size();
+	for (const char *name = &names[0] + strlen(path) + 1; name < end; name += strlen(name) + 1) {
+		AddFile(name);
+	}
+	return true;
+}
+
+void CachedDirectoryImporter::SaveSnapshot(const std::string &names, unsigned int count) const
+{
+	time_t mtime = DirectoryWatch::GetModificationTime(path);
+	// changes within the same second wouldn't show
+	if (!mtime || mtime + 1 >= time(NULL))
+		return;
+
+	char file[_MAX_PATH];
+	GetSnapshotPath(file);
+	FileStream out;
+	if (!out.Create(file))
+		return;
+	ieDword header[3] = { (ieDword) mtime, count, (ieDword) names.size() };
+	out.Write(SnapshotSignature, 8);
+	out.Write(header, sizeof(header));
+	out.Write(names.data(), names.size());
 }
 
 static const char *ConstructFilename(const char* resname, const char* ext)
@@ -161,18 +343,21 @@ static const char *ConstructFilename(const char* resname, const char* ext)
 
 bool CachedDirectoryImporter::HasResource(const char* resname, SClass_ID type)
 {
+	Update();
 	const char* filename = ConstructFilename(resname, core->TypeExt(type));
 	return cache.has(filename);
 }
 
 bool CachedDirectoryImporter::HasResource(const char* resname, const ResourceDesc &type)
 {
+	Update();
 	const char* filename = ConstructFilename(resname, type.GetExt());
 	return cache.has(filename);
 }
 
 DataStream* CachedDirectoryImporter::GetResource(const char* resname, SClass_ID type)
 {
+	Update();
 	const char* filename = ConstructFilename(resname, core->TypeExt(type));
 	const std::string *s = cache.get(filename);
 	if (!s)
@@ -185,6 +370,7 @@ DataStream* CachedDirectoryImporter::GetResource(const char* resname, SClass_ID
 
 DataStream* CachedDirectoryImporter::GetResource(const char* resname, const ResourceDesc &type)
 {
+	Update();
 	const char* filename = ConstructFilename(resname, type.GetExt());
 	const std::string *s = cache.get(filename);
 	if (!s)
@@ -195,6 +381,26 @@ DataStream* CachedDirectoryImporter::GetResource(const char* resname, const Reso
 	return FileStream::OpenFile(buf);
 }
 
+bool CachedDirectoryImporter::LocateResource(const char* resname, SClass_ID type, ResourceLocation &location)
+{
+	Update();
+	const char* filename = ConstructFilename(resname, core->TypeExt(type));
+	const std::string *s = cache.get(filename);
+	if (!s)
+		return false;
+	strcpy(location.path, path);
+	PathAppend(location.path, s->c_str());
+	location.archived = false;
+	location.locator = 0;
+	location.type = type;
+	return true;
+}
+
+bool CachedDirectoryImporter::IsLive() const
+{
+	return false;
+}
+
 #include "plugindef.h"
 
 GEMRB_PLUGIN(0xAB4534, "Directory Importer")
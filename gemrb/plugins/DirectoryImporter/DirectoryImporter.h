@@ -22,6 +22,8 @@
 #include "ResourceSource.h"
 #include "StringMap.h"
 
+#include "DirectoryWatch.h"
+
 namespace GemRB {
 
 class Resource;
@@ -41,11 +43,26 @@ public:
 	/** returns resource */
 	DataStream* GetResource(const char* resname, SClass_ID type);
 	DataStream* GetResource(const char* resname, const ResourceDesc &type);
+	bool LocateResource(const char* resname, SClass_ID type, ResourceLocation &location);
+	bool IsLive() const;
 };
 
 class CachedDirectoryImporter : public DirectoryImporter {
 protected:
 	StringMap cache;
+	DirectoryWatch watch;
+	unsigned long lastPoll;
+	// files in the cache now and when its table was sized
+	unsigned int listed, hashed;
+
+	void InitCache(unsigned int count);
+	void AddFile(const char *name);
+	void RemoveFile(const char *name);
+	/** picks up the files that came or went since the last look */
+	void Update();
+	void GetSnapshotPath(char *file) const;
+	bool LoadSnapshot();
+	void SaveSnapshot(const std::string &names, unsigned int count) const;
 
 public:
 	CachedDirectoryImporter();
@@ -59,6 +76,8 @@ public:
 	/** returns resource */
 	DataStream* GetResource(const char* resname, SClass_ID type);
 	DataStream* GetResource(const char* resname, const ResourceDesc &type);
+	bool LocateResource(const char* resname, SClass_ID type, ResourceLocation &location);
+	bool IsLive() const;
 };
 
 
@@ -0,0 +1,127 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "DirectoryWatch.h"
+
+#include <sys/stat.h>
+
+#ifdef HAVE_INOTIFY_INIT1
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace GemRB;
+
+#ifdef HAVE_INOTIFY_INIT1
+#define WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#define WATCH_BUFFER_SIZE 4096
+#endif
+
+DirectoryWatch::DirectoryWatch()
+{
+	path[0] = 0;
+	mtime = 0;
+	fd = -1;
+}
+
+DirectoryWatch::~DirectoryWatch()
+{
+	Close();
+}
+
+void DirectoryWatch::Close()
+{
+#ifdef HAVE_INOTIFY_INIT1
+	if (fd != -1) {
+		close(fd);
+	}
+#endif
+	fd = -1;
+}
+
+void DirectoryWatch::Watch(const char *dir)
+{
+	Close();
+	strlcpy(path, dir, _MAX_PATH);
+	mtime = GetModificationTime(path);
+#ifdef HAVE_INOTIFY_INIT1
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd != -1 && inotify_add_watch(fd, path, WATCH_EVENTS) == -1) {
+		// out of watches, the modification time will have to do
+		Close();
+	}
+#endif
+}
+
+WatchResult DirectoryWatch::Poll(std::vector<DirectoryChange> &changes)
+{
+#ifdef HAVE_INOTIFY_INIT1
+	if (fd != -1) {
+		union {
+			struct inotify_event event;
+			char bytes[WATCH_BUFFER_SIZE];
+		} buffer;
+		WatchResult result = WATCH_UNCHANGED;
+		ssize_t length;
+		while ((length = read(fd, &buffer, sizeof(buffer))) > 0) {
+			const char *p = buffer.bytes;
+			while (p < buffer.bytes + length) {
+				const struct inotify_event *event = (const struct inotify_event *) p;
+				p += sizeof(struct inotify_event) + event->len;
+				if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+					// the watch is gone with the directory
+					Close();
+					mtime = GetModificationTime(path);
+					changes.clear();
+					return WATCH_RESCAN;
+				}
+				if (event->mask & IN_Q_OVERFLOW) {
+					result = WATCH_RESCAN;
+				}
+				if (result == WATCH_RESCAN || !event->len || (event->mask & IN_ISDIR)) {
+					continue;
+				}
+				DirectoryChange change;
+				change.name = event->name;
+				change.removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+				changes.push_back(change);
+				result = WATCH_CHANGED;
+			}
+		}
+		if (result == WATCH_RESCAN) {
+			changes.clear();
+		}
+		return result;
+	}
+#endif
+	time_t now = GetModificationTime(path);
+	if (now == mtime) {
+		return WATCH_UNCHANGED;
+	}
+	mtime = now;
+	return WATCH_RESCAN;
+}
+
+time_t DirectoryWatch::GetModificationTime(const char *dir)
+{
+	struct stat buf;
+	if (stat(dir, &buf) < 0) {
+		return 0;
+	}
+	return buf.st_mtime;
+}
@@ -0,0 +1,65 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DIRECTORYWATCH_H
+#define DIRECTORYWATCH_H
+
+#include "globals.h"
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+struct DirectoryChange {
+	std::string name;
+	bool removed;
+};
+
+enum WatchResult {
+	WATCH_UNCHANGED,
+	WATCH_CHANGED, // the changes were reported one by one
+	WATCH_RESCAN // something happened, list the directory again
+};
+
+/* Tells which files came and went in a directory
+ * where inotify is available the single files are reported, elsewhere a
+ * new modification time of the directory asks for a full rescan
+ */
+class DirectoryWatch {
+public:
+	DirectoryWatch();
+	~DirectoryWatch();
+
+	void Watch(const char *dir);
+	WatchResult Poll(std::vector<DirectoryChange> &changes);
+
+	/* 0 if the directory can't be looked at */
+	static time_t GetModificationTime(const char *dir);
+private:
+	char path[_MAX_PATH];
+	time_t mtime;
+	int fd;
+
+	void Close();
+};
+
+}
+
+#endif
@@ -437,7 +437,7 @@ int fx_unknown (Scriptable* Owner, Actor* target, Effect* fx);//???
 // FIXME: Make this an ordered list, so we could use bsearch!
 static EffectDesc effectnames[] = {
 	{ "*Crash*", fx_crash, EFFECT_NO_ACTOR, -1 },
-	{ "AcidResistanceModifier", fx_acid_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "AcidResistanceModifier", fx_acid_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "ACVsCreatureType", fx_generic_effect, 0, -1 }, //0xdb
 	{ "ACVsDamageTypeModifier", fx_ac_vs_damage_type_modifier, 0, -1 },
 	{ "ACVsDamageTypeModifier2", fx_ac_vs_damage_type_modifier, 0, -1 }, // used in IWD
@@ -491,7 +491,7 @@ static EffectDesc effectnames[] = {
 	{ "ChaosShieldModifier", fx_chaos_shield_modifier, 0, -1 },
 	{ "CharismaModifier", fx_charisma_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "CheckForBerserkModifier", fx_checkforberserk_modifier, 0, -1 },
-	{ "ColdResistanceModifier", fx_cold_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "ColdResistanceModifier", fx_cold_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "Color:BriefRGB", fx_brief_rgb, 0, -1 },
 	{ "Color:GlowRGB", fx_glow_rgb, 0, -1 },
 	{ "Color:DarkenRGB", fx_darken_rgb, 0, -1 },
@@ -504,7 +504,7 @@ static EffectDesc effectnames[] = {
 	{ "ControlCreature", fx_set_charmed_state, 0, -1 }, //0xf1 same as charm
 	{ "CreateContingency", fx_create_contingency, 0, -1 },
 	{ "CriticalHitModifier", fx_critical_hit_modifier, 0, -1 },
-	{ "CrushingResistanceModifier", fx_crushing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "CrushingResistanceModifier", fx_crushing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "Cure:Berserk", fx_cure_berserk_state, 0, -1 },
 	{ "Cure:Blind", fx_cure_blind_state, 0, -1 },
 	{ "Cure:CasterHold", fx_unpause_caster, 0, -1 },
@@ -541,7 +541,7 @@ static EffectDesc effectnames[] = {
 	{ "Death2", fx_death, 0, -1 }, //(iwd2 effect)
 	{ "Death3", fx_death, 0, -1 }, //(iwd2 effect too, Banish)
 	{ "DetectAlignment", fx_detect_alignment, 0, -1 },
-	{ "DetectIllusionsModifier", fx_detect_illusion_modifier, 0, -1 },
+	{ "DetectIllusionsModifier", fx_detect_illusion_modifier, EFFECT_STATIC, -1 },
 	{ "DexterityModifier", fx_dexterity_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "DimensionDoor", fx_dimension_door, 0, -1 },
 	{ "DisableButton", fx_disable_button, 0, -1 }, //sets disable button flag
@@ -560,7 +560,7 @@ static EffectDesc effectnames[] = {
 	{ "DrainItems", fx_drain_items, 0, -1 },
 	{ "DrainSpells", fx_drain_spells, 0, -1 },
 	{ "DropWeapon", fx_drop_weapon, 0, -1 },
-	{ "ElectricityResistanceModifier", fx_electricity_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "ElectricityResistanceModifier", fx_electricity_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "ExistanceDelayModifier", fx_existance_delay_modifier , 0, -1 }, //unknown
 	{ "ExperienceModifier", fx_experience_modifier, 0, -1 },
 	{ "ExploreModifier", fx_explore_modifier, 0, -1 },
@@ -570,8 +570,8 @@ static EffectDesc effectnames[] = {
 	{ "FatigueModifier", fx_fatigue_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "FindFamiliar", fx_find_familiar, 0, -1 },
 	{ "FindTraps", fx_find_traps, 0, -1 },
-	{ "FindTrapsModifier", fx_find_traps_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "FireResistanceModifier", fx_fire_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "FindTrapsModifier", fx_find_traps_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "FireResistanceModifier", fx_fire_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "FistDamageModifier", fx_fist_damage_modifier, 0, -1 },
 	{ "FistHitModifier", fx_fist_to_hit_modifier, 0, -1 },
 	{ "ForceSurgeModifier", fx_force_surge_modifier, 0, -1 },
@@ -579,7 +579,7 @@ static EffectDesc effectnames[] = {
 	{ "FreeAction", fx_cure_slow_state, 0, -1 },
 	{ "GenerateWish", fx_generate_wish, 0, -1 },
 	{ "GoldModifier", fx_gold_modifier, 0, -1 },
-	{ "HideInShadowsModifier", fx_hide_in_shadows_modifier, 0, -1 },
+	{ "HideInShadowsModifier", fx_hide_in_shadows_modifier, EFFECT_STATIC, -1 },
 	{ "HLA", fx_generic_effect, 0, -1 },
 	{ "HolyNonCumulative", fx_set_holy_state, 0, -1 },
 	{ "Icon:Disable", fx_disable_portrait_icon, 0, -1 },
@@ -600,14 +600,14 @@ static EffectDesc effectnames[] = {
 	{ "KillCreatureType", fx_kill_creature_type, 0, -1 },
 	{ "LevelModifier", fx_level_modifier, 0, -1 },
 	{ "LevelDrainModifier", fx_leveldrain_modifier, 0, -1 },
-	{ "LoreModifier", fx_lore_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "LoreModifier", fx_lore_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "LuckModifier", fx_luck_modifier, EFFECT_NO_LEVEL_CHECK|EFFECT_SPECIAL_UNDO, -1 },
 	{ "LuckCumulative", fx_luck_cumulative, 0, -1 },
 	{ "LuckNonCumulative", fx_luck_non_cumulative, 0, -1 },
-	{ "MagicalColdResistanceModifier", fx_magical_cold_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "MagicalFireResistanceModifier", fx_magical_fire_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "MagicalColdResistanceModifier", fx_magical_cold_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "MagicalFireResistanceModifier", fx_magical_fire_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "MagicalRest", fx_magical_rest, 0, -1 },
-	{ "MagicDamageResistanceModifier", fx_magic_damage_resistance_modifier, 0, -1 },
+	{ "MagicDamageResistanceModifier", fx_magic_damage_resistance_modifier, EFFECT_STATIC, -1 },
 	{ "MagicResistanceModifier", fx_magic_resistance_modifier, 0, -1 },
 	{ "MassRaiseDead", fx_mass_raise_dead, EFFECT_NO_ACTOR, -1 },
 	{ "MaximumHPModifier", fx_maximum_hp_modifier, EFFECT_DICED|EFFECT_SPECIAL_UNDO, -1 },
@@ -618,7 +618,7 @@ static EffectDesc effectnames[] = {
 	{ "MiscastMagicModifier", fx_miscast_magic_modifier, 0, -1 },
 	{ "MissileDamageModifier", fx_missile_damage_modifier, 0, -1 },
 	{ "MissileHitModifier", fx_missile_to_hit_modifier, 0, -1 },
-	{ "MissilesResistanceModifier", fx_missiles_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "MissilesResistanceModifier", fx_missiles_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "MirrorImage", fx_mirror_image, 0, -1 },
 	{ "MirrorImageModifier", fx_mirror_image_modifier, 0, -1 },
 	{ "ModifyGlobalVariable", fx_modify_global_variable, EFFECT_NO_ACTOR, -1 },
@@ -635,7 +635,7 @@ static EffectDesc effectnames[] = {
 	{ "NPCBump", fx_npc_bump, 0, -1 },
 	{ "OffscreenAIModifier", fx_offscreenai_modifier, 0, -1 },
 	{ "OffhandHitModifier", fx_left_to_hit_modifier, 0, -1 },
-	{ "OpenLocksModifier", fx_open_locks_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "OpenLocksModifier", fx_open_locks_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "Overlay:Entangle", fx_set_entangle_state, 0, -1 },
 	{ "Overlay:Grease", fx_set_grease_state, 0, -1 },
 	{ "Overlay:MinorGlobe", fx_set_minorglobe_state, 0, -1 },
@@ -643,12 +643,12 @@ static EffectDesc effectnames[] = {
 	{ "Overlay:ShieldGlobe", fx_set_shieldglobe_state, 0, -1 },
 	{ "Overlay:Web", fx_set_web_state, 0, -1 },
 	{ "PauseTarget", fx_pause_target, 0, -1 }, //also known as casterhold
-	{ "PickPocketsModifier", fx_pick_pockets_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "PiercingResistanceModifier", fx_piercing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "PickPocketsModifier", fx_pick_pockets_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "PiercingResistanceModifier", fx_piercing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "PlayMovie", fx_play_movie, EFFECT_NO_ACTOR, -1 },
 	{ "PlaySound", fx_playsound, EFFECT_NO_ACTOR, -1 },
 	{ "PlayVisualEffect", fx_play_visual_effect, EFFECT_REINIT_ON_LOAD, -1 },
-	{ "PoisonResistanceModifier", fx_poison_resistance_modifier, 0, -1 },
+	{ "PoisonResistanceModifier", fx_poison_resistance_modifier, EFFECT_STATIC, -1 },
 	{ "Polymorph", fx_polymorph, 0, -1 },
 	{ "PortraitChange", fx_portrait_change, 0, -1 },
 	{ "PowerWordKill", fx_power_word_kill, 0, -1 },
@@ -692,11 +692,11 @@ static EffectDesc effectnames[] = {
 	{ "RestoreSpells", fx_restore_spell_level, 0, -1 },
 	{ "RetreatFrom2", fx_turn_undead, 0, -1 },
 	{ "RightHitModifier", fx_right_to_hit_modifier, 0, -1 },
-	{ "SaveVsBreathModifier", fx_save_vs_breath_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsDeathModifier", fx_save_vs_death_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsPolyModifier", fx_save_vs_poly_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsSpellsModifier", fx_save_vs_spell_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsWandsModifier", fx_save_vs_wands_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "SaveVsBreathModifier", fx_save_vs_breath_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "SaveVsDeathModifier", fx_save_vs_death_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "SaveVsPolyModifier", fx_save_vs_poly_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "SaveVsSpellsModifier", fx_save_vs_spell_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
+	{ "SaveVsWandsModifier", fx_save_vs_wands_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "ScreenShake", fx_screenshake, EFFECT_NO_ACTOR, -1 },
 	{ "ScriptingState", fx_scripting_state, 0, -1 },
 	{ "Sequencer:Activate", fx_activate_spell_sequencer, EFFECT_PRESET_TARGET, -1 },
@@ -708,9 +708,9 @@ static EffectDesc effectnames[] = {
 	{ "SetMeleeEffect", fx_generic_effect, 0, -1 },
 	{ "SetRangedEffect", fx_generic_effect, 0, -1 },
 	{ "SetTrap", fx_set_area_effect, 0, -1 },
-	{ "SetTrapsModifier", fx_set_traps_modifier, 0, -1 },
+	{ "SetTrapsModifier", fx_set_traps_modifier, EFFECT_STATIC, -1 },
 	{ "SexModifier", fx_sex_modifier, 0, -1 },
-	{ "SlashingResistanceModifier", fx_slashing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "SlashingResistanceModifier", fx_slashing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "Sparkle", fx_sparkle, 0, -1 },
 	{ "SpellDurationModifier", fx_spell_duration_modifier, 0, -1 },
 	{ "Spell:Add", fx_add_innate, 0, -1 },
@@ -751,7 +751,7 @@ static EffectDesc effectnames[] = {
 	{ "State:Sleep", fx_set_unconscious_state, 0, -1 },
 	{ "State:Slowed", fx_set_slowed_state, 0, -1 },
 	{ "State:Stun", fx_set_stun_state, 0, -1 },
-	{ "StealthModifier", fx_stealth_modifier, 0, -1 },
+	{ "StealthModifier", fx_stealth_modifier, EFFECT_STATIC, -1 },
 	{ "StoneSkinModifier", fx_stoneskin_modifier, 0, -1 },
 	{ "StoneSkin2Modifier", fx_golem_stoneskin_modifier, 0, -1 },
 	{ "StrengthModifier", fx_strength_modifier, EFFECT_SPECIAL_UNDO, -1 },
@@ -762,7 +762,7 @@ static EffectDesc effectnames[] = {
 	{ "TimelessState", fx_timeless_modifier, 0, -1 },
 	{ "Timestop", fx_timestop, 0, -1 },
 	{ "TitleModifier", fx_title_modifier, 0, -1 },
-	{ "ToHitModifier", fx_to_hit_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "ToHitModifier", fx_to_hit_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STATIC, -1 },
 	{ "ToHitBonusModifier", fx_to_hit_bonus_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "ToHitVsCreature", fx_generic_effect, 0, -1 },
 	{ "TrackingModifier", fx_tracking_modifier, EFFECT_SPECIAL_UNDO, -1 },
@@ -842,6 +842,29 @@ static EffectRef fx_str_ref = { "StrengthModifier", -1 };
 static EffectRef fx_int_ref = { "IntelligenceModifier", -1 };
 static EffectRef fx_wis_ref = { "WisdomModifier", -1 };
 static EffectRef fx_dex_ref = { "DexterityModifier", -1 };
+// the opcodes that only STAT_MOD their stat once queued
+static EffectStatDesc statmods[] = {
+	{ "AcidResistanceModifier", IE_RESISTACID },
+	{ "ColdResistanceModifier", IE_RESISTCOLD },
+	{ "CrushingResistanceModifier", IE_RESISTCRUSHING },
+	{ "DetectIllusionsModifier", IE_DETECTILLUSIONS },
+	{ "ElectricityResistanceModifier", IE_RESISTELECTRICITY },
+	{ "FindTrapsModifier", IE_TRAPS },
+	{ "FireResistanceModifier", IE_RESISTFIRE },
+	{ "HideInShadowsModifier", IE_HIDEINSHADOWS },
+	{ "MagicalColdResistanceModifier", IE_RESISTMAGICCOLD },
+	{ "MagicalFireResistanceModifier", IE_RESISTMAGICFIRE },
+	{ "MagicDamageResistanceModifier", IE_MAGICDAMAGERESISTANCE },
+	{ "MissilesResistanceModifier", IE_RESISTMISSILE },
+	{ "OpenLocksModifier", IE_LOCKPICKING },
+	{ "PickPocketsModifier", IE_PICKPOCKET },
+	{ "PiercingResistanceModifier", IE_RESISTPIERCING },
+	{ "PoisonResistanceModifier", IE_RESISTPOISON },
+	{ "SetTrapsModifier", IE_SETTRAPS },
+	{ "SlashingResistanceModifier", IE_RESISTSLASHING },
+	{ "StealthModifier", IE_STEALTH },
+};
+
 static EffectRef fx_con_ref = { "ConstitutionModifier", -1 };
 static EffectRef fx_chr_ref = { "CharismaModifier", -1 };
 
@@ -858,6 +881,7 @@ static void Cleanup()
 static void RegisterCoreOpcodes()
 {
 	core->RegisterOpcodes( sizeof( effectnames ) / sizeof( EffectDesc ) - 1, effectnames );
+	core->RegisterStatModifiers( sizeof( statmods ) / sizeof( EffectStatDesc ), statmods );
 	default_spell_hit.SequenceFlags|=IE_VVC_BAM;
 }
 
@@ -1369,7 +1393,7 @@ int fx_damage (Scriptable* /*Owner*/, Actor* target, Effect* fx)
 	}
 
 	if (target->GetStat(IE_MC_FLAGS) & MC_INVULNERABLE) {
-		Log(DEBUG, "fx_damage", "Attacking invulnerable target, skipping!");
+		LogDebug("fx_damage", "Attacking invulnerable target, skipping!");
 		return FX_NOT_APPLIED;
 	}
 
@@ -4957,12 +4981,12 @@ int fx_apply_effect (Scriptable* Owner, Actor* target, Effect* fx)
 
 	//apply effect, if the effect is a goner, then kill
 	//this effect too
-	Effect *newfx = core->GetEffect(fx->Resource, fx->Power, p);
-	if (!newfx)
+	//a private copy of the file effect, the queues copy it again
+	Effect newfx;
+	if (!core->GetEffect(fx->Resource, fx->Power, p, newfx))
 		return FX_NOT_APPLIED;
 
-	Effect *myfx = new Effect;
-	memcpy(myfx, newfx, sizeof(Effect));
+	Effect *myfx = &newfx;
 	myfx->random_value = core->Roll(1,100,-1);
 	myfx->Target = FX_TARGET_PRESET;
 	myfx->TimingMode = fx->TimingMode;
@@ -4977,7 +5001,6 @@ int fx_apply_effect (Scriptable* Owner, Actor* target, Effect* fx)
 			//that must be put directly in the effect queue to have any impact (to be counted by BonusAgainstCreature, etc)
 			CopyResRef(myfx->Source, fx->Source); // more?
 			target->fxqueue.AddEffect(myfx);
-			delete myfx;
 			return FX_NOT_APPLIED;
 		}
 		ret = target->fxqueue.ApplyEffect(target, myfx, fx->FirstApply, !fx->Parameter3);
@@ -4988,7 +5011,6 @@ int fx_apply_effect (Scriptable* Owner, Actor* target, Effect* fx)
 	}
 
 	fx->Parameter3 = 1;
-	delete myfx;
 	return ret;
 }
 
@@ -6836,9 +6858,9 @@ int fx_apply_effect_repeat (Scriptable* /*Owner*/, Actor* target, Effect* fx)
 	if(0) print("fx_apply_effect_repeat(%2d): Mod: %d, Type: %d", fx->Opcode, fx->Parameter1, fx->Parameter2);
 
 	Point p(fx->PosX, fx->PosY);
-	Effect *newfx = core->GetEffect(fx->Resource, fx->Power, p);
-	//core->GetEffect is a borrowed reference, don't delete it
-	if (!newfx) {
+	//copied once, the same copy is applied every time
+	Effect newfx;
+	if (!core->GetEffect(fx->Resource, fx->Power, p, newfx)) {
 		return FX_NOT_APPLIED;
 	}
 
@@ -6853,25 +6875,25 @@ int fx_apply_effect_repeat (Scriptable* /*Owner*/, Actor* target, Effect* fx)
 		case 0: //once per second
 		case 1: //crash???
 			if (!(core->GetGame()->GameTime%AI_UPDATE_TIME)) {
-				core->ApplyEffect(newfx, target, caster);
+				core->ApplyEffect(&newfx, target, caster);
 			}
 			break;
 		case 2://param1 times every second
 			if (!(core->GetGame()->GameTime%AI_UPDATE_TIME)) {
 				for (i=0;i<fx->Parameter1;i++) {
-					core->ApplyEffect(newfx, target, caster);
+					core->ApplyEffect(&newfx, target, caster);
 				}
 			}
 			break;
 		case 3: //once every Param1 second
 			if (fx->Parameter1 && !(core->GetGame()->GameTime%(fx->Parameter1*AI_UPDATE_TIME))) {
-				core->ApplyEffect(newfx, target, caster);
+				core->ApplyEffect(&newfx, target, caster);
 			}
 			break;
 		case 4: //param3 times every Param1 second
 			if (fx->Parameter1 && !(core->GetGame()->GameTime%(fx->Parameter1*AI_UPDATE_TIME))) {
 				for (i=0;i<fx->Parameter3;i++) {
-					core->ApplyEffect(newfx, target, caster);
+					core->ApplyEffect(&newfx, target, caster);
 				}
 			}
 			break;
@@ -7050,19 +7072,15 @@ int fx_apply_effect_curse (Scriptable* /*Owner*/, Actor* target, Effect* fx)
 
 		//apply effect, if the effect is a goner, then kill
 		//this effect too
-		Effect *newfx = core->GetEffect(fx->Resource, fx->Power, p);
-		if (newfx) {
-			Effect *myfx = new Effect;
-			memcpy(myfx, newfx, sizeof(Effect));
-			myfx->random_value = fx->random_value;
-			myfx->TimingMode=fx->TimingMode;
-			myfx->Duration=fx->Duration;
-			myfx->Target = FX_TARGET_PRESET;
-			myfx->CasterID = fx->CasterID;
-			ret = target->fxqueue.ApplyEffect(target, myfx, fx->FirstApply, 0);
-			delete myfx;
+		Effect myfx;
+		if (core->GetEffect(fx->Resource, fx->Power, p, myfx)) {
+			myfx.random_value = fx->random_value;
+			myfx.TimingMode=fx->TimingMode;
+			myfx.Duration=fx->Duration;
+			myfx.Target = FX_TARGET_PRESET;
+			myfx.CasterID = fx->CasterID;
+			ret = target->fxqueue.ApplyEffect(target, &myfx, fx->FirstApply, 0);
 		}
-		//newfx is a borrowed reference don't delete it
 	}
 	return ret;
 }
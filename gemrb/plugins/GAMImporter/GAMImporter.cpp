@@ -30,7 +30,8 @@
 #include "PluginMgr.h"
 #include "TableMgr.h"
 #include "Scriptable/Actor.h"
-#include "System/SlicedStream.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
 
 #include <cassert>
 
@@ -39,6 +40,47 @@ using namespace GemRB;
 #define FAMILIAR_FILL_SIZE 324
 // if your compiler chokes on this, use -1 or 0xff whichever works for you
 #define UNINITIALIZED_CHAR '\xff'
+// the most threads decoding the creatures of a save
+#define MAX_CREATURE_DECODERS 4
+
+namespace GemRB {
+
+/** The opened creatures of the save still waiting for a decoder */
+struct CreatureJobs {
+	Mutex lock;
+	std::vector<Holder<ActorMgr> > *creatures;
+	size_t next;
+
+	// decodes creatures until there are none left
+	void Run()
+	{
+		while (true) {
+			ActorMgr *cre;
+			{
+				MutexLock l(lock);
+				if (next >= creatures->size()) {
+					return;
+				}
+				cre = (*creatures)[next++].get();
+			}
+			if (cre) {
+				cre->DecodeEffects();
+			}
+		}
+	}
+};
+
+class CreatureDecoder : public Thread {
+public:
+	CreatureDecoder(CreatureJobs *jobs) : jobs(jobs) {}
+	~CreatureDecoder() { Join(); }
+protected:
+	void Run() { jobs->Run(); }
+private:
+	CreatureJobs *jobs;
+};
+
+}
 
 GAMImporter::GAMImporter(void)
 {
@@ -201,20 +243,26 @@ Game* GAMImporter::LoadGame(Game *newGame, int ver_override)
 		strnlwrcpy( newGame->CurrentArea, resref, 8 );
 	}
 
+	//the embedded creatures are decoded together, only the rest is serial
+	std::vector<Holder<ActorMgr> > creatures;
+	OpenCreatures( PCOffset, PCCount, creatures );
+	OpenCreatures( NPCOffset, NPCCount, creatures );
+	DecodeCreatures( creatures );
+
 	//Loading PCs
-	PluginHolder<ActorMgr> aM(IE_CRE_CLASS_ID);
 	for (i = 0; i < PCCount; i++) {
 		str->Seek( PCOffset + ( i * PCSize ), GEM_STREAM_START );
-		Actor *actor = GetActor( aM, true );
+		Actor *actor = GetActor( creatures[i], true );
 		newGame->JoinParty( actor, actor->Selected?JP_SELECT:0 );
 	}
 
 	//Loading NPCs
 	for (i = 0; i < NPCCount; i++) {
 		str->Seek( NPCOffset + ( i * PCSize ), GEM_STREAM_START );
-		Actor *actor = GetActor( aM, false );
+		Actor *actor = GetActor( creatures[PCCount + i], false );
 		newGame->AddNPC( actor );
 	}
+	creatures.clear();
 
 	//apparently BG1/IWD2 relies on this, if chapter is unset, it is
 	//set to -1, hopefully it won't break anything
@@ -337,7 +385,65 @@ static void SanityCheck(ieWord a,ieWord &b,const char *message)
 	}
 }
 
-Actor* GAMImporter::GetActor(Holder<ActorMgr> aM, bool is_in_party )
+/** Opens the creatures embedded in the entries, each through its own copy
+ * of the data, so they can be decoded at once. Entries referring to a CRE
+ * file get an empty holder. */
+void GAMImporter::OpenCreatures(ieDword offset, ieDword count, std::vector<Holder<ActorMgr> > &creatures)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		ieDword creOffset, creSize;
+		str->Seek( offset + i * PCSize + 4, GEM_STREAM_START );
+		str->ReadDword( &creOffset );
+		str->ReadDword( &creSize );
+		if (!creOffset) {
+			creatures.push_back(Holder<ActorMgr>());
+			continue;
+		}
+
+		str->Seek( creOffset, GEM_STREAM_START );
+		char *data = (char *) malloc(creSize);
+		str->Read( data, creSize );
+		PluginHolder<ActorMgr> cre(IE_CRE_CLASS_ID);
+		if (!cre->Open(new MemoryStream(str->originalfile, data, creSize))) {
+			cre = PluginHolder<ActorMgr>();
+		}
+		creatures.push_back(cre);
+	}
+}
+
+/** Decodes the saved effects of the creatures on a few threads, which is
+ * the bulk of the creatures in a late save. The main thread helps. */
+void GAMImporter::DecodeCreatures(std::vector<Holder<ActorMgr> > &creatures)
+{
+	CreatureJobs jobs;
+	jobs.creatures = &creatures;
+	jobs.next = 0;
+
+	std::vector<CreatureDecoder *> decoders;
+	size_t count = Thread::GetProcessorCount();
+	if (count > MAX_CREATURE_DECODERS) {
+		count = MAX_CREATURE_DECODERS;
+	}
+	if (count >= creatures.size()) {
+		count = creatures.size() ? creatures.size() - 1 : 0;
+	}
+	for (size_t i = 0; i < count; i++) {
+		CreatureDecoder *decoder = new CreatureDecoder(&jobs);
+		if (!decoder->Start()) {
+			Log(WARNING, "GAMImporter", "Couldn't start a creature decoding thread.");
+			delete decoder;
+			break;
+		}
+		decoders.push_back(decoder);
+	}
+
+	jobs.Run();
+	for (size_t i = 0; i < decoders.size(); i++) {
+		delete decoders[i];
+	}
+}
+
+Actor* GAMImporter::GetActor(Holder<ActorMgr> cre, bool is_in_party )
 {
 	unsigned int i;
 	PCStruct pcInfo;
@@ -471,10 +577,8 @@ Actor* GAMImporter::GetActor(Holder<ActorMgr> aM, bool is_in_party )
 	tmpWord = is_in_party ? (pcInfo.PartyOrder + 1) : 0;
 
 	if (pcInfo.OffsetToCRE) {
-		DataStream* ms = SliceStream( str, pcInfo.OffsetToCRE, pcInfo.CRESize );
-		if (ms) {
-			aM->Open(ms);
-			actor = aM->GetActor(tmpWord);
+		if (cre) {
+			actor = cre->GetActor(tmpWord);
 		}
 
 		//torment has them as 0 or -1
@@ -488,6 +592,7 @@ Actor* GAMImporter::GetActor(Holder<ActorMgr> aM, bool is_in_party )
 		//another plugin cannot free memory stream from this plugin
 		//so auto free is a no-no
 		if (ds) {
+			PluginHolder<ActorMgr> aM(IE_CRE_CLASS_ID);
 			aM->Open(ds);
 			actor = aM->GetActor(pcInfo.PartyOrder);
 		}
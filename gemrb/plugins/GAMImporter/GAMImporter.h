@@ -25,6 +25,8 @@
 
 #include "ActorMgr.h"
 
+#include <vector>
+
 namespace GemRB {
 
 #define GAM_VER_GEMRB  0 
@@ -59,7 +61,9 @@ public:
 	/* stores a gane in the savegame folder */
 	int PutGame(DataStream *stream, Game *game);
 private:
-	Actor* GetActor(Holder<ActorMgr> aM, bool is_in_party );
+	void OpenCreatures(ieDword offset, ieDword count, std::vector<Holder<ActorMgr> > &creatures);
+	void DecodeCreatures(std::vector<Holder<ActorMgr> > &creatures);
+	Actor* GetActor(Holder<ActorMgr> cre, bool is_in_party );
 	void GetPCStats(PCStatsStruct* ps, bool extended);
 	GAMJournalEntry* GetJournalEntry();
 
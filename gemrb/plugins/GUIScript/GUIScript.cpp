@@ -29,6 +29,7 @@
 #include "DialogHandler.h"
 #include "DisplayMessage.h"
 #include "EffectQueue.h"
+#include "FrameStats.h"
 #include "Game.h"
 #include "GameData.h"
 #include "ImageFactory.h"
@@ -36,17 +37,23 @@
 #include "Interface.h"
 #include "Item.h"
 #include "Map.h"
+#include "MemoryStats.h"
 #include "MusicMgr.h"
+#include "ObjectPool.h"
 #include "Palette.h"
 #include "PalettedImageMgr.h"
 #include "ResourceDesc.h"
+#include "ResourceStats.h"
 #include "SaveGameIterator.h"
 #include "Spell.h"
 #include "TableMgr.h"
 #include "TileMap.h"
+#include "Tracer.h"
 #include "Video.h"
 #include "WorldMap.h"
 #include "GameScript/GSUtils.h" //checkvariable
+#include "GameScript/ScriptProfiler.h"
+#include "GameScript/ScriptScheduler.h"
 #include "GUI/Button.h"
 #include "GUI/EventMgr.h"
 #include "GUI/GameControl.h"
@@ -5369,7 +5376,7 @@ static PyObject* SetButtonBAM(int wi, int ci, const char *ResRef, int CycleIndex
 		Picture = old->copy();
 		Sprite2D::FreeSprite(old);
 
-		Palette* newpal = Picture->GetPalette()->Copy();
+		Palette* newpal = Picture->GetPalette()->Unshare();
 		core->GetPalette( col1, 12, &newpal->col[4]);
 		Picture->SetPalette( newpal );
 		newpal->release();
@@ -6027,7 +6034,7 @@ static PyObject* GemRB_CheckVar(PyObject * /*self*/, PyObject* args)
 		return NULL;
 	}
 	long value =(long) CheckVariable(Sender, Variable, Context);
-	Log(DEBUG, "GUISCript", "%s %s=%ld",
+	LogDebug("GUISCript", "%s %s=%ld",
 		Context, Variable, value);
 	return PyInt_FromLong( value );
 }
@@ -6187,6 +6194,361 @@ static PyObject* GemRB_DumpActor(PyObject * /*self*/, PyObject * args)
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR( GemRB_DumpMemoryStats__doc,
+"===== DumpMemoryStats =====\n\
+\n\
+**Prototype:** GemRB.DumpMemoryStats ([reset])\n\
+\n\
+**Description:** Prints the memory held per subsystem: the sprite pixels of \n\
+each video backend, the BAM frames, tiles, font pages, sound buffers, effects, \n\
+the GameData caches and the compiled scripts, with the objects, the kilobytes \n\
+and their high water marks. The MemoryStatsInterval option also logs them \n\
+regularly.\n\
+\n\
+**Parameters:**\n\
+  * reset - if nonzero, the high water marks start over afterwards\n\
+\n\
+**Return value:** N/A"
+);
+static PyObject* GemRB_DumpMemoryStats(PyObject * /*self*/, PyObject * args)
+{
+	int reset = 0;
+
+	if (!PyArg_ParseTuple( args, "|i", &reset )) {
+		return AttributeError( GemRB_DumpMemoryStats__doc );
+	}
+
+	MemoryStats::Dump();
+	if (reset) {
+		MemoryStats::ResetPeaks();
+	}
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_TrimMemory__doc,
+"===== TrimMemory =====\n\
+\n\
+**Prototype:** GemRB.TrimMemory ([level])\n\
+\n\
+**Description:** Frees what can be rebuilt, as on the low memory signals of \n\
+the system. Level 1 drops the unreferenced GameData cache entries and the \n\
+least played sounds, level 2 also every idle sound buffer and the decoded \n\
+tiles of the loaded areas.\n\
+\n\
+**Parameters:**\n\
+  * level - 1 or 2, defaults to 2\n\
+\n\
+**Return value:** the bytes freed"
+);
+static PyObject* GemRB_TrimMemory(PyObject * /*self*/, PyObject * args)
+{
+	int level = TRIM_COMPLETE;
+
+	if (!PyArg_ParseTuple( args, "|i", &level )) {
+		return AttributeError( GemRB_TrimMemory__doc );
+	}
+
+	return PyInt_FromLong( (long) core->TrimMemory(level) );
+}
+
+PyDoc_STRVAR( GemRB_DumpPoolStats__doc,
+"===== DumpPoolStats =====\n\
+\n\
+**Prototype:** GemRB.DumpPoolStats ([reset])\n\
+\n\
+**Description:** Prints the allocation counts of the object pools (effects, \n\
+their queue nodes, projectiles, animations): how many objects were taken, \n\
+how many of those needed new memory, how many were given back and how many \n\
+are alive. The counting is enabled with the PoolStats option.\n\
+\n\
+**Parameters:**\n\
+  * reset - if nonzero, the counts start over afterwards\n\
+\n\
+**Return value:** N/A"
+);
+static PyObject* GemRB_DumpPoolStats(PyObject * /*self*/, PyObject * args)
+{
+	int reset = 0;
+
+	if (!PyArg_ParseTuple( args, "|i", &reset )) {
+		return AttributeError( GemRB_DumpPoolStats__doc );
+	}
+
+	PoolStats::Dump();
+	if (reset) {
+		PoolStats::Reset();
+	}
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_DumpPathStats__doc,
+"===== DumpPathStats =====\n\
+\n\
+**Prototype:** GemRB.DumpPathStats ([reset])\n\
+\n\
+**Description:** Prints how many paths were requested, how often walkers \n\
+found their next step taken by someone, and how many of those could go on \n\
+after waiting instead of looking for a new path.\n\
+\n\
+**Parameters:**\n\
+  * reset - if nonzero, the counts start over afterwards\n\
+\n\
+**Return value:** N/A"
+);
+static PyObject* GemRB_DumpPathStats(PyObject * /*self*/, PyObject * args)
+{
+	int reset = 0;
+
+	if (!PyArg_ParseTuple( args, "|i", &reset )) {
+		return AttributeError( GemRB_DumpPathStats__doc );
+	}
+
+	Map::DumpPathStats(reset != 0);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_DumpResourceStats__doc,
+"===== DumpResourceStats =====\n\
+\n\
+**Prototype:** GemRB.DumpResourceStats ([filename])\n\
+\n\
+**Description:** Prints the recorded resource loads, per type and per source, \n\
+with their counts, bytes and the time spent looking them up, reading, \n\
+decompressing and parsing them. The recording is enabled with the ResourceStats \n\
+option or with ResetResourceStats.\n\
+\n\
+**Parameters:**\n\
+  * filename - if given, the records are also written there as JSON\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:ResetResourceStats]]"
+);
+static PyObject* GemRB_DumpResourceStats(PyObject * /*self*/, PyObject * args)
+{
+	const char *filename = NULL;
+
+	if (!PyArg_ParseTuple( args, "|s", &filename )) {
+		return AttributeError( GemRB_DumpResourceStats__doc );
+	}
+
+	ResourceStats::Dump();
+	if (filename && !ResourceStats::WriteJSON(filename)) {
+		return RuntimeError( "Cannot write the resource stats!" );
+	}
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_ResetResourceStats__doc,
+"===== ResetResourceStats =====\n\
+\n\
+**Prototype:** GemRB.ResetResourceStats ([enable])\n\
+\n\
+**Description:** Forgets the recorded resource loads, to start measuring afresh.\n\
+\n\
+**Parameters:**\n\
+  * enable - 1 (default) records the loads from now on, 0 stops recording\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:DumpResourceStats]]"
+);
+static PyObject* GemRB_ResetResourceStats(PyObject * /*self*/, PyObject * args)
+{
+	int enable = 1;
+
+	if (!PyArg_ParseTuple( args, "|i", &enable )) {
+		return AttributeError( GemRB_ResetResourceStats__doc );
+	}
+
+	ResourceStats::Reset();
+	ResourceStats::SetEnabled(enable);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_DumpSoundStats__doc,
+"===== DumpSoundStats =====\n\
+\n\
+**Prototype:** GemRB.DumpSoundStats ()\n\
+\n\
+**Description:** Prints how the audio driver's cache of decoded sounds is \n\
+used: the sounds and bytes held against the SoundCacheBudget, the hits, \n\
+misses and evictions, and the most played sounds. It also prints how often \n\
+the music and the other streams ran dry before they were refilled, and how \n\
+many sounds took over or missed a source when all were playing. Drivers \n\
+without such records print nothing.\n\
+\n\
+**Return value:** N/A"
+);
+static PyObject* GemRB_DumpSoundStats(PyObject * /*self*/, PyObject * args)
+{
+	if (!PyArg_ParseTuple( args, "" )) {
+		return AttributeError( GemRB_DumpSoundStats__doc );
+	}
+
+	core->GetAudioDrv()->DumpStats();
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_DumpScriptProfile__doc,
+"===== DumpScriptProfile =====\n\
+\n\
+**Prototype:** GemRB.DumpScriptProfile ()\n\
+\n\
+**Description:** Prints the recorded script runs, the slowest first: the time \n\
+spent per script resource, per response block with how often its condition was \n\
+true, and per trigger and action. The recording is started with \n\
+ResetScriptProfile.\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:ResetScriptProfile]]"
+);
+static PyObject* GemRB_DumpScriptProfile(PyObject * /*self*/, PyObject * args)
+{
+	if (!PyArg_ParseTuple( args, "" )) {
+		return AttributeError( GemRB_DumpScriptProfile__doc );
+	}
+
+	ScriptProfiler::Dump();
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_ResetScriptProfile__doc,
+"===== ResetScriptProfile =====\n\
+\n\
+**Prototype:** GemRB.ResetScriptProfile ([enable])\n\
+\n\
+**Description:** Forgets the recorded script runs, to start measuring afresh.\n\
+\n\
+**Parameters:**\n\
+  * enable - 1 (default) records the script runs from now on, 0 stops recording\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:DumpScriptProfile]]"
+);
+static PyObject* GemRB_ResetScriptProfile(PyObject * /*self*/, PyObject * args)
+{
+	int enable = 1;
+
+	if (!PyArg_ParseTuple( args, "|i", &enable )) {
+		return AttributeError( GemRB_ResetScriptProfile__doc );
+	}
+
+	ScriptProfiler::Reset();
+	ScriptProfiler::SetEnabled(enable);
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_StartTrace__doc,
+"===== StartTrace =====\n\
+\n\
+**Prototype:** GemRB.StartTrace ()\n\
+\n\
+**Description:** Forgets the earlier timeline and starts recording the engine \n\
+scopes: the main loop phases, script and effect updates, resource loading and \n\
+the video driver calls. Only works in builds configured with USE_TRACING.\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:StopTrace]]"
+);
+static PyObject* GemRB_StartTrace(PyObject * /*self*/, PyObject * args)
+{
+	if (!PyArg_ParseTuple( args, "" )) {
+		return AttributeError( GemRB_StartTrace__doc );
+	}
+
+	if (!Tracer::Start()) {
+		return RuntimeError( "Tracing isn't compiled in!" );
+	}
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_StopTrace__doc,
+"===== StopTrace =====\n\
+\n\
+**Prototype:** GemRB.StopTrace ([filename])\n\
+\n\
+**Description:** Stops recording the timeline and writes it as Chrome trace \n\
+JSON, to be opened in chrome://tracing or the Perfetto UI.\n\
+\n\
+**Parameters:**\n\
+  * filename - the file to write, gemrb-trace.json in the working directory by default\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:StartTrace]]"
+);
+static PyObject* GemRB_StopTrace(PyObject * /*self*/, PyObject * args)
+{
+	const char *filename = "gemrb-trace.json";
+
+	if (!PyArg_ParseTuple( args, "|s", &filename )) {
+		return AttributeError( GemRB_StopTrace__doc );
+	}
+
+	if (!Tracer::Stop(filename)) {
+		return RuntimeError( "Couldn't write the trace!" );
+	}
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_DumpScriptSchedule__doc,
+"===== DumpScriptSchedule =====\n\
+\n\
+**Prototype:** GemRB.DumpScriptSchedule ()\n\
+\n\
+**Description:** Prints how the creatures fared under the ScriptBudget, the \n\
+most deferred first: their script rounds, how many of them were put off and \n\
+the average and longest wait in ticks.\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:ResetScriptSchedule]]"
+);
+static PyObject* GemRB_DumpScriptSchedule(PyObject * /*self*/, PyObject * args)
+{
+	if (!PyArg_ParseTuple( args, "" )) {
+		return AttributeError( GemRB_DumpScriptSchedule__doc );
+	}
+
+	ScriptScheduler::Dump();
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR( GemRB_ResetScriptSchedule__doc,
+"===== ResetScriptSchedule =====\n\
+\n\
+**Prototype:** GemRB.ResetScriptSchedule ([budget])\n\
+\n\
+**Description:** Forgets the recorded script rounds and optionally sets a \n\
+new ScriptBudget, to tune it while playing.\n\
+\n\
+**Parameters:**\n\
+  * budget - microseconds per tick for the script rounds, 0 runs them all, \n\
+-1 (default) keeps the current one\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:DumpScriptSchedule]]"
+);
+static PyObject* GemRB_ResetScriptSchedule(PyObject * /*self*/, PyObject * args)
+{
+	int budget = -1;
+
+	if (!PyArg_ParseTuple( args, "|i", &budget )) {
+		return AttributeError( GemRB_ResetScriptSchedule__doc );
+	}
+
+	ScriptScheduler::Reset();
+	if (budget >= 0) {
+		ScriptScheduler::SetBudget(budget);
+	}
+	Py_RETURN_NONE;
+}
+
 PyDoc_STRVAR( GemRB_SaveCharacter__doc,
 "===== SaveCharacter =====\n\
 \n\
@@ -11140,6 +11502,7 @@ static PyObject* GemRB_GetItem(PyObject * /*self*/, PyObject* args)
 		if (eh->FeatureCount<1) {
 			goto not_a_scroll;
 		}
+		item->LoadFeatures();
 		f = eh->features; //+0
 
 		//normally the learn spell opcode is 147
@@ -14466,6 +14829,26 @@ static PyObject* GemRB_SwapPCs(PyObject * /*self*/, PyObject* args)
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR( GemRB_ToggleFrameStats__doc,
+"===== ToggleFrameStats =====\n\
+\n\
+**Prototype:** GemRB.ToggleFrameStats ()\n\
+\n\
+**Description:** Shows or hides the frame time overlay: the recent frame \n\
+times with their percentiles, the time spent on input, game logic, area \n\
+drawing, gui drawing and the buffer swap, and the draw calls, blits, path \n\
+searches and script runs per frame.\n\
+\n\
+**Return value:** N/A"
+);
+
+static PyObject* GemRB_ToggleFrameStats(PyObject * /*self*/, PyObject* /*args*/)
+{
+	FrameStats::SetEnabled(!FrameStats::IsEnabled());
+
+	Py_RETURN_NONE;
+}
+
 PyDoc_STRVAR( GemRB_SetRepeatClickFlags__doc,
 "===== SetRepeatClickFlags =====\n\
 \n\
@@ -15276,6 +15659,40 @@ static PyObject* GemRB_Log(PyObject* /*self*/, PyObject* args)
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR( GemRB_SetLogOwnerLevel__doc,
+"===== SetLogOwnerLevel =====\n\
+\n\
+**Prototype:** GemRB.SetLogOwnerLevel (owner, level)\n\
+\n\
+**Description:** Limits the log lines of one owner (the part in brackets \n\
+before the message, like PathFinder or GameScript) to the given level, so \n\
+a chatty part can be muted without losing the debug output of the rest. \n\
+The lines filtered out this way aren't even formatted. It can't make an \n\
+owner more verbose than the loggers are.\n\
+\n\
+**Parameters:**\n\
+  * owner - the name of the owner, case sensitive\n\
+  * level - the most verbose LOG_xxx level kept (from GUIDefines.py), \n\
+LOG_NONE goes back to the level of the loggers\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**See also:** [[guiscript:Log]]"
+);
+
+static PyObject* GemRB_SetLogOwnerLevel(PyObject* /*self*/, PyObject* args)
+{
+	char* owner;
+	int level;
+
+	if (!PyArg_ParseTuple(args, "si", &owner, &level)) {
+		return AttributeError( GemRB_SetLogOwnerLevel__doc );
+	}
+
+	SetOwnerLogLevel(owner, level);
+	Py_RETURN_NONE;
+}
+
 
 PyDoc_STRVAR( GemRB_SetFeature__doc,
 "===== SetFeature =====\n\
@@ -15364,6 +15781,13 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(DrawWindows, METH_NOARGS),
 	METHOD(DropDraggedItem, METH_VARARGS),
 	METHOD(DumpActor, METH_VARARGS),
+	METHOD(DumpMemoryStats, METH_VARARGS),
+	METHOD(DumpPathStats, METH_VARARGS),
+	METHOD(DumpPoolStats, METH_VARARGS),
+	METHOD(DumpResourceStats, METH_VARARGS),
+	METHOD(DumpScriptProfile, METH_VARARGS),
+	METHOD(DumpScriptSchedule, METH_VARARGS),
+	METHOD(DumpSoundStats, METH_VARARGS),
 	METHOD(EnableCheatKeys, METH_VARARGS),
 	METHOD(EndCutSceneMode, METH_NOARGS),
 	METHOD(EnterGame, METH_NOARGS),
@@ -15493,6 +15917,9 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(RemoveItem, METH_VARARGS),
 	METHOD(RemoveSpell, METH_VARARGS),
 	METHOD(RemoveEffects, METH_VARARGS),
+	METHOD(ResetResourceStats, METH_VARARGS),
+	METHOD(ResetScriptProfile, METH_VARARGS),
+	METHOD(ResetScriptSchedule, METH_VARARGS),
 	METHOD(RestParty, METH_VARARGS),
 	METHOD(RevealArea, METH_VARARGS),
 	METHOD(Roll, METH_VARARGS),
@@ -15509,6 +15936,7 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(SetGlobal, METH_VARARGS),
 	METHOD(SetInfoTextColor, METH_VARARGS),
 	METHOD(SetJournalEntry, METH_VARARGS),
+	METHOD(SetLogOwnerLevel, METH_VARARGS),
 	METHOD(SetMapAnimation, METH_VARARGS),
 	METHOD(SetMapDoor, METH_VARARGS),
 	METHOD(SetMapExit, METH_VARARGS),
@@ -15539,9 +15967,13 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(SetVar, METH_VARARGS),
 	METHOD(SoftEndPL, METH_NOARGS),
 	METHOD(SpellCast, METH_VARARGS),
+	METHOD(StartTrace, METH_VARARGS),
 	METHOD(StatComment, METH_VARARGS),
 	METHOD(StealFailed, METH_NOARGS),
+	METHOD(StopTrace, METH_VARARGS),
 	METHOD(SwapPCs, METH_VARARGS),
+	METHOD(ToggleFrameStats, METH_NOARGS),
+	METHOD(TrimMemory, METH_VARARGS),
 	METHOD(UnhideGUI, METH_NOARGS),
 	METHOD(UnmemorizeSpell, METH_VARARGS),
 	METHOD(UpdateAmbientsVolume, METH_NOARGS),
@@ -15655,11 +16087,13 @@ GUIScript::GUIScript(void)
 	pModule = NULL; //should decref it
 	pMainDic = NULL; //borrowed, but used outside a function
 	pGUIClasses = NULL;
+	intArgs = pointArgs = NULL;
 }
 
 GUIScript::~GUIScript(void)
 {
 	if (Py_IsInitialized()) {
+		ClearCaches();
 		if (pModule) {
 			Py_DECREF( pModule );
 		}
@@ -15729,6 +16163,28 @@ PyDoc_STRVAR( GemRB_internal__doc,
 "This module is only for implementing GUIClass.py."
 "It's implemented in gemrb/plugins/GUIScript/GUIScript.cpp" );
 
+// the modification time of the newest loose script in dir
+static time_t NewestScript(const char *dir)
+{
+	time_t newest = 0;
+	DirectoryIterator iter(dir);
+	if (!iter) {
+		return newest;
+	}
+
+	do {
+		const char *name = iter.GetName();
+		size_t len = strlen(name);
+		if (iter.IsDirectory() || len < 3 || stricmp(name + len - 3, ".py")) {
+			continue;
+		}
+		char file[_MAX_PATH];
+		PathJoin(file, dir, name, NULL);
+		newest = std::max(newest, file_mtime(file));
+	} while (++iter);
+	return newest;
+}
+
 /** Initialization Routine */
 
 bool GUIScript::Init(void)
@@ -15790,11 +16246,11 @@ bool GUIScript::Init(void)
 	}
 
 	// use the iwd guiscripts for how, but leave its override
+	const char *scriptDir = core->GameType;
 	if (stricmp( core->GameType, "how" ) == 0) {
-		PathJoin(path2, path, "iwd", NULL);
-	} else {
-		PathJoin(path2, path, core->GameType, NULL);
+		scriptDir = "iwd";
 	}
+	PathJoin(path2, path, scriptDir, NULL);
 
 	// GameType-specific import path must have a higher priority than
 	// the generic one, so insert it before it
@@ -15803,6 +16259,26 @@ bool GUIScript::Init(void)
 		Log(ERROR, "GUIScript", "Error running: %s", string );
 		return false;
 	}
+
+	// a precompiled bundle of both (admin/bundle_guiscripts.py) goes first,
+	// but only while it is newer than all the loose scripts, so edits still work
+	char bundle[_MAX_PATH];
+	char bundleName[_MAX_PATH];
+	snprintf(bundleName, sizeof(bundleName), "%s.zip", scriptDir);
+	PathJoin(bundle, path, bundleName, NULL);
+	if (file_exists(bundle)) {
+		time_t bundleTime = file_mtime(bundle);
+		if (bundleTime >= NewestScript(path) && bundleTime >= NewestScript(path2)) {
+			sprintf(string, "sys.path.insert(0, \"%s\")", QuotePath(quoted, bundle));
+			if (PyRun_SimpleString(string) == -1) {
+				Log(ERROR, "GUIScript", "Error running: %s", string);
+				return false;
+			}
+			Log(MESSAGE, "GUIScript", "Using the precompiled scripts from %s", bundle);
+		} else {
+			Log(WARNING, "GUIScript", "Ignoring %s, the loose scripts are newer.", bundle);
+		}
+	}
 	sprintf( string, "GemRB.GameType = \"%s\"", core->GameType);
 	if (PyRun_SimpleString( string ) == -1) {
 		Log(ERROR, "GUIScript", "Error running: %s", string );
@@ -15920,6 +16396,82 @@ bool GUIScript::LoadScript(const char* filename)
 	return true;
 }
 
+/* the module imported under that name, a borrowed reference
+ * it is imported again only when sys.modules no longer holds the same one,
+ * after a reload or if a script dropped it
+ */
+PyObject* GUIScript::GetModule(const char* moduleName)
+{
+	std::map<std::string, CachedModule>::iterator it = modules.find(moduleName);
+	if (it != modules.end()) {
+		CachedModule &cached = it->second;
+		if (PyDict_GetItem(PyImport_GetModuleDict(), cached.name) == cached.module) {
+			return cached.module;
+		}
+		Py_DECREF(cached.module);
+		Py_DECREF(cached.name);
+		modules.erase(it);
+	}
+
+	PyObject *module = PyImport_ImportModule(const_cast<char*>(moduleName));
+	if (module == NULL) {
+		return NULL;
+	}
+	CachedModule entry = { PyString_InternFromString(moduleName), module };
+	modules[moduleName] = entry;
+	return module;
+}
+
+/* the function names stay interned, so the lookups don't create strings */
+PyObject* GUIScript::GetFunctionName(const char* functionName)
+{
+	std::map<std::string, PyObject*>::iterator it = functionNames.find(functionName);
+	if (it != functionNames.end()) {
+		return it->second;
+	}
+	PyObject *name = PyString_InternFromString(functionName);
+	functionNames[functionName] = name;
+	return name;
+}
+
+/* a new reference to a tuple of count arguments for the caller to set
+ * the cached one is handed out again only if no call kept a reference
+ */
+PyObject* GUIScript::GetArgs(PyObject *&cached, int count)
+{
+	if (!cached || Py_REFCNT(cached) > 1) {
+		Py_XDECREF(cached);
+		cached = PyTuple_New(count);
+	}
+	Py_INCREF(cached);
+	return cached;
+}
+
+static void SetIntArg(PyObject *args, int pos, long value)
+{
+	PyObject *old = PyTuple_GET_ITEM(args, pos);
+	PyTuple_SET_ITEM(args, pos, PyInt_FromLong(value));
+	Py_XDECREF(old);
+}
+
+void GUIScript::ClearCaches()
+{
+	std::map<std::string, CachedModule>::iterator m;
+	for (m = modules.begin(); m != modules.end(); ++m) {
+		Py_DECREF(m->second.module);
+		Py_DECREF(m->second.name);
+	}
+	modules.clear();
+	std::map<std::string, PyObject*>::iterator f;
+	for (f = functionNames.begin(); f != functionNames.end(); ++f) {
+		Py_DECREF(f->second);
+	}
+	functionNames.clear();
+	Py_XDECREF(intArgs);
+	Py_XDECREF(pointArgs);
+	intArgs = pointArgs = NULL;
+}
+
 /* Similar to RunFunction, but with parameters, and doesn't necessarily fail */
 PyObject *GUIScript::RunFunction(const char* moduleName, const char* functionName, PyObject* pArgs, bool report_error)
 {
@@ -15929,18 +16481,19 @@ PyObject *GUIScript::RunFunction(const char* moduleName, const char* functionNam
 
 	PyObject *module;
 	if (moduleName) {
-		module = PyImport_ImportModule(const_cast<char*>(moduleName));
+		module = GetModule(moduleName);
 	} else {
 		module = pModule;
-		Py_XINCREF(module);
 	}
 	if (module == NULL) {
 		PyErr_Print();
 		return NULL;
 	}
+	// the call might drop the module from the cache
+	Py_INCREF(module);
 	PyObject *dict = PyModule_GetDict(module);
 
-	PyObject *pFunc = PyDict_GetItemString(dict, const_cast<char*>(functionName));
+	PyObject *pFunc = PyDict_GetItem(dict, GetFunctionName(functionName));
 	/* pFunc: Borrowed reference */
 	if (!pFunc || !PyCallable_Check(pFunc)) {
 		if (report_error) {
@@ -15965,7 +16518,8 @@ bool GUIScript::RunFunction(const char *moduleName, const char* functionName, bo
 	if (intparam == -1) {
 		pArgs = NULL;
 	} else {
-		pArgs = Py_BuildValue("(i)", intparam);
+		pArgs = GetArgs(intArgs, 1);
+		SetIntArg(pArgs, 0, intparam);
 	}
 	PyObject *pValue = RunFunction(moduleName, functionName, pArgs, report_error);
 	Py_XDECREF(pArgs);
@@ -15981,7 +16535,9 @@ bool GUIScript::RunFunction(const char *moduleName, const char* functionName, bo
 
 bool GUIScript::RunFunction(const char *moduleName, const char* functionName, bool report_error, Point param)
 {
-	PyObject *pArgs = Py_BuildValue("(ii)", param.x, param.y);
+	PyObject *pArgs = GetArgs(pointArgs, 2);
+	SetIntArg(pArgs, 0, param.x);
+	SetIntArg(pArgs, 1, param.y);
 	PyObject *pValue = RunFunction(moduleName, functionName, pArgs, report_error);
 	Py_XDECREF(pArgs);
 	if (pValue == NULL) {
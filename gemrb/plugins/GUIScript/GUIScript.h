@@ -33,6 +33,9 @@
 
 #include "ScriptEngine.h"
 
+#include <map>
+#include <string>
+
 namespace GemRB {
 
 #define SV_BPP 0
@@ -66,6 +69,22 @@ public:
 	PyObject *RunFunction(const char* moduleName, const char* fname, PyObject* pArgs, bool report_error = true);
 	PyObject* ConstructObject(const char* classname, int arg);
 	PyObject* ConstructObject(const char* classname, PyObject* pArgs);
+private:
+	struct CachedModule {
+		PyObject *name; // interned, the key in sys.modules
+		PyObject *module;
+	};
+	// what RunFunction resolved so far, so the callbacks don't import
+	// their module and build the function name on every call
+	std::map<std::string, CachedModule> modules;
+	std::map<std::string, PyObject*> functionNames;
+	// argument tuples of the int and Point callbacks, reused while unshared
+	PyObject *intArgs, *pointArgs;
+
+	PyObject* GetModule(const char* moduleName);
+	PyObject* GetFunctionName(const char* functionName);
+	PyObject* GetArgs(PyObject *&cached, int count);
+	void ClearCaches();
 };
 
 extern GUIScript *gs;
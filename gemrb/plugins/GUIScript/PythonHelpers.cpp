@@ -58,10 +58,13 @@ bool PythonObjectCallback<Control>::operator() (Control* ctrl)
 	}
 
 	PyObject *args = NULL;
-	PyObject* func_code = PyObject_GetAttrString(Function, "func_code");
-	PyObject* co_argcount = PyObject_GetAttrString(func_code, "co_argcount");
-	const int count = PyInt_AsLong(co_argcount);
 	if (/*count*/ false) { // FIXME: this code is incomplete and would break things without being finished
+		// only look the argument count up once this is in use, every event pays for it
+		PyObject* func_code = PyObject_GetAttrString(Function, "func_code");
+		PyObject* co_argcount = PyObject_GetAttrString(func_code, "co_argcount");
+		const int count = PyInt_AsLong(co_argcount);
+		Py_DECREF(func_code);
+		Py_DECREF(co_argcount);
 		assert(count == 1);
 		const char* type = "Control";
 		switch(ctrl->ControlType) {
@@ -93,8 +96,6 @@ bool PythonObjectCallback<Control>::operator() (Control* ctrl)
 		Py_DECREF(ctrltuple);
 		args = Py_BuildValue("(i)", obj);
 	}
-	Py_DECREF(func_code);
-	Py_DECREF(co_argcount);
 	return CallPython(Function, args);
 }
 
@@ -81,27 +81,53 @@ bool IDSImporter::Open(DataStream* str)
 	}
 
 	delete str;
+	BuildIndex();
 	return true;
 }
 
-int IDSImporter::GetValue(const char* txt) const
+// the lookups by value return the first pair, FindString and FindValue the last
+void IDSImporter::BuildIndex()
 {
-	for (unsigned int i = 0; i < pairs.size(); i++) {
-		if (stricmp( pairs[i].str, txt ) == 0) {
-			return pairs[i].val;
+	unsigned int size = pairs.size();
+	firstByString.init(size, size);
+	lastByHead.init(size, size);
+	firstByValue.init(size, size);
+	lastByValue.init(size, size);
+
+	for (unsigned int i = 0; i < size; i++) {
+		const char *str = pairs[i].str;
+		if (!firstByString.has(str)) {
+			firstByString.set(str, i);
+		}
+		const char *paren = strchr(str, '(');
+		if (paren) {
+			lastByHead.set(std::string(str, paren - str + 1), i);
+		} else {
+			lastByHead.set(str, i);
 		}
+		if (!firstByValue.has(pairs[i].val)) {
+			firstByValue.set(pairs[i].val, i);
+		}
+		lastByValue.set(pairs[i].val, i);
 	}
-	return -1;
+}
+
+int IDSImporter::GetValue(const char* txt) const
+{
+	const int *i = firstByString.get(txt);
+	if (!i) {
+		return -1;
+	}
+	return pairs[*i].val;
 }
 
 char* IDSImporter::GetValue(int val) const
 {
-	for (unsigned int i = 0; i < pairs.size(); i++) {
-		if (pairs[i].val == val) {
-			return pairs[i].str;
-		}
+	const int *i = firstByValue.get(val);
+	if (!i) {
+		return NULL;
 	}
-	return NULL;
+	return pairs[*i].str;
 }
 
 char* IDSImporter::GetStringIndex(unsigned int Index) const
@@ -122,6 +148,13 @@ int IDSImporter::GetValueIndex(unsigned int Index) const
 
 int IDSImporter::FindString(char *str, int len) const
 {
+	// the scripts look up "name(" or a whole symbol, both of which are indexed
+	int slen = strlen(str);
+	if (len == slen + 1 || (len > 0 && len <= slen && str[len - 1] == '(')) {
+		const int *i = lastByHead.get(std::string(str, len == slen + 1 ? slen : len));
+		return i ? *i : -1;
+	}
+
 	int i=pairs.size();
 	while(i--) {
 		if (strnicmp(pairs[i].str, str, len) == 0) {
@@ -133,13 +166,8 @@ int IDSImporter::FindString(char *str, int len) const
 
 int IDSImporter::FindValue(int val) const
 {
-	int i=pairs.size();
-	while(i--) {
-		if(pairs[i].val==val) {
-			return i;
-		}
-	}
-	return -1;
+	const int *i = lastByValue.get(val);
+	return i ? *i : -1;
 }
 
 
@@ -23,6 +23,8 @@
 
 #include "SymbolMgr.h"
 
+#include "StringMap.h"
+
 #include <vector>
 
 namespace GemRB {
@@ -36,6 +38,13 @@ class IDSImporter : public SymbolMgr {
 private:
 	std::vector< Pair> pairs;
 	std::vector< char*> ptrs;
+	// built once the file is read, the tables of some mods run into thousands
+	StringHashMap<int> firstByString;
+	StringHashMap<int> lastByHead; // the symbol up to the '(' of the action and trigger tables
+	HashMap<int, int> firstByValue;
+	HashMap<int, int> lastByValue;
+
+	void BuildIndex();
 
 public:
 	IDSImporter(void);
@@ -282,6 +282,19 @@ Item* ITMImporter::GetItem(Item *s)
 		}
 	}
 
+	s->SetFeaturesPending();
+
+	if (!core->IsAvailable( IE_BAM_CLASS_ID )) {
+		Log(ERROR, "ITMImporter", "No BAM Importer available!");
+		return NULL;
+	}
+	return s;
+}
+
+bool ITMImporter::GetItemFeatures(Item *s)
+{
+	unsigned int i;
+
 	// handle iwd1 weapon "peculiarity"
 	bool zzWeapon = false;
 	int extraFeatureCount = 0;
@@ -305,11 +318,15 @@ Item* ITMImporter::GetItem(Item *s)
 		AddZZFeatures(s);
 	}
 
-	if (!core->IsAvailable( IE_BAM_CLASS_ID )) {
-		Log(ERROR, "ITMImporter", "No BAM Importer available!");
-		return NULL;
+	for (i = 0; i < s->ExtHeaderCount; i++) {
+		ITMExtHeader* eh = &s->ext_headers[i];
+		eh->features = core->GetFeatures(eh->FeatureCount);
+		str->Seek( s->FeatureBlockOffset + 48*eh->FeatureOffset, GEM_STREAM_START );
+		for (unsigned int j = 0; j < eh->FeatureCount; j++) {
+			GetFeature(eh->features+j, s);
+		}
 	}
-	return s;
+	return true;
 }
 
 //unfortunately, i couldn't avoid this hack, unless adding another array
@@ -389,13 +406,6 @@ void ITMImporter::GetExtHeader(Item *s, ITMExtHeader* eh)
 		i|=(1<<ProjectileType)>>1;
 	}
 	eh->ProjectileQualifier=i;
-
-	//48 is the size of the feature block
-	eh->features = core->GetFeatures(eh->FeatureCount);
-	str->Seek( s->FeatureBlockOffset + 48*eh->FeatureOffset, GEM_STREAM_START );
-	for (i = 0; i < eh->FeatureCount; i++) {
-		GetFeature(eh->features+i, s);
-	}
 }
 
 void ITMImporter::GetFeature(Effect *fx, Item *s)
@@ -43,6 +43,7 @@ public:
 	~ITMImporter(void);
 	bool Open(DataStream* stream);
 	Item* GetItem(Item *s);
+	bool GetItemFeatures(Item *s);
 private:
 	void GetExtHeader(Item *s, ITMExtHeader* eh);
 	void GetFeature(Effect *f, Item *s);
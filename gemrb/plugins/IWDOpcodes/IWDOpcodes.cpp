@@ -858,7 +858,7 @@ int fx_slow_poison (Scriptable* /*Owner*/, Actor* target, Effect* fx)
 	if (fx->Parameter2) my_opcode = EffectQueue::ResolveEffect(fx_wound_ref);
 	else my_opcode = EffectQueue::ResolveEffect(fx_poison_ref);
 	if(0) print("fx_slow_poison(%2d): Damage %d", fx->Opcode, fx->Parameter1);
-	std::list< Effect* >::const_iterator f=target->fxqueue.GetFirstEffect();
+	EffectList::const_iterator f=target->fxqueue.GetFirstEffect();
 	Effect *poison;
 	//this is intentionally an assignment
 	while( (poison = target->fxqueue.GetNextEffect(f)) ) {
@@ -2179,7 +2179,7 @@ int fx_resist_spell (Scriptable* Owner, Actor* target, Effect *fx)
 	}
 	//this has effect only on first apply, it will stop applying the spell
 	// FIXME: should probably return FX_NOT_APPLIED instead
-	Log(DEBUG, "IWDOpcodes", "fx_resist_spell: blatantly resisted spell %s!", fx->Source);
+	LogDebug("IWDOpcodes", "fx_resist_spell: blatantly resisted spell %s!", fx->Source);
 	return FX_ABORT;
 }
 
@@ -2418,6 +2418,7 @@ int fx_alter_animation (Scriptable* Owner, Actor* /*target*/, Effect* fx)
 			}
 			an->frame = 0;
 			an->InitAnimation();
+			map->AnimationChanged();
 		}
 	}
 	return FX_NOT_APPLIED;
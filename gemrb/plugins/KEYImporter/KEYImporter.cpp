@@ -33,6 +33,7 @@ using namespace GemRB;
 KEYImporter::KEYImporter(void)
 {
 	description = NULL;
+	archiveClock = 0;
 }
 
 KEYImporter::~KEYImporter(void)
@@ -176,25 +177,35 @@ bool KEYImporter::Open(const char *resfile, const char *desc)
 	}
 	f->Seek( ResOffset, GEM_STREAM_START );
 
-	MapKey key;
-	ieDword ResLocator;
-
-	// limit to 32k buckets
-	// only ~1% of the bg2 entries are of bucket lenght >4
-	resources.init(ResCount > 32 * 1024 ? 32 * 1024 : ResCount, ResCount);
-
-	for (i = 0; i < ResCount; i++) {
-		f->ReadResRef(key.ref);
-		f->ReadWord(&key.type);
-		f->ReadDword(&ResLocator);
+	// the table is read in one go, the index decodes it
+	unsigned int TableSize = ResCount * 14;
+	char *records = (char *) malloc(TableSize);
+	if (!records || f->Read(records, TableSize) != (int) TableSize) {
+		Log(ERROR, "KEYImporter", "Cannot read the resource table.");
+		free(records);
+		delete( f );
+		return false;
+	}
+	delete( f );
 
-		// seems to be always the last entry?
-		if (key.ref[0] != 0)
-			resources.set(key, ResLocator);
+	// reuse the index of the last launch if the table is the same
+	char keyname[_MAX_PATH], IndexPath[_MAX_PATH];
+	ExtractFileFromPath(keyname, resfile);
+	PathJoinExt(IndexPath, core->CachePath, keyname, "idx");
+	ieDword checksum = KEYIndex::Checksum(records, TableSize);
+	if (resources.Load(IndexPath, checksum)) {
+		Log(MESSAGE, "KEYImporter", "Reusing the resource index from %s.", IndexPath);
+	} else {
+		if (!resources.Build(records, ResCount)) {
+			Log(ERROR, "KEYImporter", "Cannot index the resources.");
+			free(records);
+			return false;
+		}
+		resources.Save(IndexPath, checksum);
 	}
+	free(records);
 
 	Log(MESSAGE, "KEYImporter", "Resources Loaded...");
-	delete( f );
 	return true;
 }
 
@@ -225,13 +236,16 @@ DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 		return NULL;
 	}
 
-	PluginHolder<IndexedArchive> ai(IE_BIF_CLASS_ID);
-	if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
-		print("Cannot open archive %s", biffiles[bifnum].path);
-		return NULL;
+	DataStream* ret;
+	{
+		// the archive reads from its one stream, the slices have their own
+		MutexLock lock(archiveLock);
+		IndexedArchive *ai = GetArchive(bifnum);
+		if (!ai) {
+			return NULL;
+		}
+		ret = ai->GetStream( *ResLocator, type );
 	}
-
-	DataStream* ret = ai->GetStream( *ResLocator, type );
 	if (ret) {
 		strnlwrcpy( ret->filename, resname, 8 );
 		strcat( ret->filename, "." );
@@ -242,6 +256,35 @@ DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 	return NULL;
 }
 
+IndexedArchive *KEYImporter::GetArchive(unsigned int bifnum)
+{
+	size_t slot = 0;
+	for (size_t i = 0; i < archives.size(); i++) {
+		if (archives[i].bifnum == bifnum) {
+			archives[i].lastUse = ++archiveClock;
+			return archives[i].plugin.get();
+		}
+		if (archives[i].lastUse < archives[slot].lastUse) {
+			slot = i;
+		}
+	}
+
+	PluginHolder<IndexedArchive> ai(IE_BIF_CLASS_ID);
+	if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
+		print("Cannot open archive %s", biffiles[bifnum].path);
+		return NULL;
+	}
+	// the longest unused one makes room
+	if (archives.size() < KEY_OPEN_ARCHIVES) {
+		slot = archives.size();
+		archives.push_back(KEYCache());
+	}
+	archives[slot].bifnum = bifnum;
+	archives[slot].plugin = ai;
+	archives[slot].lastUse = ++archiveClock;
+	return archives[slot].plugin.get();
+}
+
 DataStream* KEYImporter::GetResource(const char* resname, SClass_ID type)
 {
 	//the word masking is a hack for synonyms, currently used for bcs==bs
@@ -253,6 +296,24 @@ DataStream* KEYImporter::GetResource(const char* resname, const ResourceDesc &ty
 	return GetStream(resname, type.GetKeyType());
 }
 
+bool KEYImporter::LocateResource(const char* resname, SClass_ID type, ResourceLocation &location)
+{
+	type &= 0xFFFF;
+	const ieDword *ResLocator = resources.get(resname, type);
+	if (!ResLocator)
+		return false;
+
+	unsigned int bifnum = ( *ResLocator & 0xFFF00000 ) >> 20;
+	if (!biffiles[bifnum].found)
+		return false;
+
+	strlcpy(location.path, biffiles[bifnum].path, _MAX_PATH);
+	location.archived = true;
+	location.locator = *ResLocator;
+	location.type = type;
+	return true;
+}
+
 #include "plugindef.h"
 
 GEMRB_PLUGIN(0x1DFDEF80, "KEY File Importer")
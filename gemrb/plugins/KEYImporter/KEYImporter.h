@@ -24,9 +24,9 @@
 #include "ResourceSource.h"
 
 #include "IndexedArchive.h"
+#include "KEYIndex.h"
 #include "PluginMgr.h"
-
-#include "StringMap.h"
+#include "System/Thread.h"
 
 #include <vector>
 
@@ -44,96 +44,31 @@ struct BIFEntry {
 	bool found;
 };
 
+// how many archives are kept open with their entry tables
+#define KEY_OPEN_ARCHIVES 8
+
 struct KEYCache {
-	KEYCache() { bifnum = 0xffffffff; }
+	KEYCache() { bifnum = 0xffffffff; lastUse = 0; }
 
 	unsigned int bifnum;
 	PluginHolder<IndexedArchive> plugin;
-};
-
-// the key for this specific hashmap
-struct MapKey {
-	ieResRef ref;
-	ieWord type;
-
-	MapKey() : type(0)
-	{
-	}
-};
-
-// hash template for the above key for this hashmap
-template<>
-struct HashKey<MapKey> {
-	// hash without MapKey construction
-	static inline unsigned int hash(const ieResRef ref, SClass_ID type)
-	{
-		unsigned int h = type;
-		const char *c = ref;
-
-		for (unsigned int i = 0; *c && i < sizeof(ieResRef); ++i)
-			h = (h << 5) + h + tolower(*c++);
-
-		return h;
-	}
-
-	static inline unsigned int hash(const MapKey &key)
-	{
-		return hash(key.ref, key.type);
-	}
-
-	// equal check without MapKey construction
-	static inline bool equals(const MapKey &a, const ieResRef ref, SClass_ID type)
-	{
-		if (a.type != type)
-			return false;
-
-		return stricmp(a.ref, ref) == 0;
-	}
-
-	static inline bool equals(const MapKey &a, const MapKey &b)
-	{
-		return equals(a, b.ref, b.type);
-	}
-
-	static inline void copy(MapKey &a, const MapKey &b)
-	{
-		a.type = b.type;
-		strncpy(a.ref, b.ref, sizeof(ieResRef));
-	}
-};
-
-// FIXME: The captialization of KEYMap is important, since there is also a KeyMap defined in core.
-class KEYMap : public HashMap<MapKey, ieDword> {
-public:
-	// lookup without MapKey construction
-	const ieDword *get(const ieResRef ref, SClass_ID type) const
-	{
-		if (!isInitialized())
-			return NULL;
-
-		incAccesses();
-
-		for (Entry *e = getBucketByHash(HashKey<MapKey>::hash(ref, type)); e; e = e->next)
-			if (HashKey<MapKey>::equals(e->key, ref, type))
-				return &e->value;
-
-		return NULL;
-	}
-
-	// lookup without MapKey construction
-	bool has(const ieResRef ref, SClass_ID type) const
-	{
-		return get(ref, type) != NULL;
-	}
+	unsigned long lastUse;
 };
 
 class KEYImporter : public ResourceSource {
 private:
 	std::vector< BIFEntry> biffiles;
-	KEYMap resources;
+	KEYIndex resources;
+	// the recently used archives, an area pulls most of its resources from a few
+	std::vector<KEYCache> archives;
+	unsigned long archiveClock;
+	// the loader threads fetch resources too
+	Mutex archiveLock;
 
 	/** Gets the stream assoicated to a RESKey */
 	DataStream *GetStream(const char *resname, ieWord type);
+	/** The opened archive, from the cache if it is there (archiveLock held) */
+	IndexedArchive *GetArchive(unsigned int bifnum);
 public:
 	KEYImporter(void);
 	~KEYImporter(void);
@@ -144,6 +79,7 @@ public:
 	/* returns resource */
 	DataStream* GetResource(const char* resname, SClass_ID type);
 	DataStream* GetResource(const char* resname, const ResourceDesc &type);
+	bool LocateResource(const char* resname, SClass_ID type, ResourceLocation &location);
 };
 
 }
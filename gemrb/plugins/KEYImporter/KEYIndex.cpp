@@ -0,0 +1,318 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "KEYIndex.h"
+
+#include "win32def.h"
+
+#include "System/FileStream.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace GemRB {
+
+// size of a resource record in the KEY file
+#define KEY_RECORD_SIZE 14
+// average keys per bucket
+#define KEY_INDEX_LOAD 2
+// reseeding is practically never needed, this only bounds the worst case
+#define KEY_INDEX_SEEDS 16
+
+static const char IndexSignature[8] = { 'K', 'E', 'Y', 'I', 'D', 'X', '0', '1' };
+
+// the murmur3 finalizer
+static inline ieDword Mix(ieDword h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+// lowercases the (up to 8 chars) resref into key and hashes it with the
+// type: hash[0] picks the bucket, hash[1] and hash[2] the slot;
+// returns false if the name is too long to be in a KEY
+static bool HashResource(const char *resref, ieWord type, ieDword seed, char key[8], ieDword hash[3])
+{
+	unsigned int i;
+	for (i = 0; i < 8 && resref[i]; i++) {
+		key[i] = (char) tolower(resref[i]);
+	}
+	if (i == 8 && resref[8]) {
+		return false;
+	}
+	for (; i < 8; i++) {
+		key[i] = 0;
+	}
+
+	const unsigned char *k = (const unsigned char *) key;
+	ieDword a = k[0] | (k[1] << 8) | (k[2] << 16) | ((ieDword) k[3] << 24);
+	ieDword b = k[4] | (k[5] << 8) | (k[6] << 16) | ((ieDword) k[7] << 24);
+	// two hashes mixed independently, so no two keys share both
+	hash[0] = Mix(Mix(a ^ Mix(seed * 2 + 1)) ^ b ^ ((ieDword) type << 16));
+	hash[1] = Mix((Mix(b ^ Mix(seed * 2 + 2)) + a * 0x9e3779b1u) ^ type);
+	hash[2] = Mix(hash[0] ^ hash[1]) | 1;
+	return true;
+}
+
+KEYIndex::KEYIndex()
+	: entries(NULL), count(0), displacements(NULL), buckets(0), seed(0)
+{
+}
+
+KEYIndex::~KEYIndex()
+{
+	Clear();
+}
+
+void KEYIndex::Clear()
+{
+	free(entries);
+	free(displacements);
+	entries = NULL;
+	displacements = NULL;
+	count = buckets = 0;
+}
+
+// the displacement encodes the pair (d0, d1) as d0 * count + d1; the
+// products wrap around on purpose, spreading the keys for every d0
+unsigned int KEYIndex::Slot(ieDword f1, ieDword f2, ieDword displacement) const
+{
+	ieDword d0 = displacement / count;
+	ieDword d1 = displacement % count;
+	return ((f1 + d0 * f2) % count + d1) % count;
+}
+
+bool KEYIndex::KeyLess(const Entry &a, const Entry &b)
+{
+	int cmp = memcmp(a.ref, b.ref, 8);
+	if (cmp) {
+		return cmp < 0;
+	}
+	return a.type < b.type;
+}
+
+static bool BucketLarger(const std::pair<unsigned int, unsigned int> &a, const std::pair<unsigned int, unsigned int> &b)
+{
+	return a.first > b.first;
+}
+
+bool KEYIndex::Build(const char *records, unsigned int total)
+{
+	Clear();
+
+	// decode the records, dropping the unnamed ones
+	std::vector<Entry> keys;
+	keys.reserve(total);
+	for (unsigned int i = 0; i < total; i++) {
+		const unsigned char *r = (const unsigned char *) records + i * KEY_RECORD_SIZE;
+		if (!r[0]) {
+			continue;
+		}
+		Entry e;
+		unsigned int j;
+		for (j = 0; j < 8 && r[j]; j++) {
+			e.ref[j] = (char) tolower(r[j]);
+		}
+		for (; j < 8; j++) {
+			e.ref[j] = 0;
+		}
+		e.type = (ieWord) (r[8] | (r[9] << 8));
+		e.locator = r[10] | (r[11] << 8) | (r[12] << 16) | ((ieDword) r[13] << 24);
+		e.unused = 0;
+		keys.push_back(e);
+	}
+
+	// the stable sort keeps duplicates in file order, the last one stays
+	std::stable_sort(keys.begin(), keys.end(), KeyLess);
+	size_t unique = 0;
+	for (size_t i = 0; i < keys.size(); i++) {
+		if (unique && !KeyLess(keys[unique - 1], keys[i])) {
+			keys[unique - 1] = keys[i];
+		} else {
+			keys[unique++] = keys[i];
+		}
+	}
+	keys.resize(unique);
+	if (keys.empty()) {
+		return true;
+	}
+
+	count = (unsigned int) keys.size();
+	buckets = count / KEY_INDEX_LOAD + 1;
+	entries = (Entry *) malloc(count * sizeof(Entry));
+	displacements = (ieDword *) calloc(buckets, sizeof(ieDword));
+
+	std::vector<ieDword> hashes(count * 3);
+	std::vector<unsigned int> slotOf(count);
+	std::vector<char> taken(count);
+	std::vector<unsigned int> members;
+	char key[8], ref[9];
+	ref[8] = 0;
+	for (seed = 0; seed < KEY_INDEX_SEEDS; seed++) {
+		// gather the keys of each bucket
+		std::vector<std::pair<unsigned int, unsigned int> > order(buckets); // size, bucket
+		std::vector<std::vector<unsigned int> > contents(buckets);
+		for (unsigned int i = 0; i < count; i++) {
+			memcpy(ref, keys[i].ref, 8);
+			HashResource(ref, keys[i].type, seed, key, &hashes[i * 3]);
+			contents[hashes[i * 3] % buckets].push_back(i);
+		}
+		for (unsigned int b = 0; b < buckets; b++) {
+			order[b] = std::make_pair((unsigned int) contents[b].size(), b);
+		}
+		// the crowded buckets are the hard ones, place them while it's empty
+		std::stable_sort(order.begin(), order.end(), BucketLarger);
+
+		std::fill(taken.begin(), taken.end(), 0);
+		bool placed = true;
+		unsigned int o, freeSlot = 0;
+		// enough to try a few dozen d0
+		ieDword tries = count < 16384 ? 1 << 20 : count * 64;
+		for (o = 0; o < buckets && order[o].first > 1; o++) {
+			const std::vector<unsigned int> &bucket = contents[order[o].second];
+			ieDword displacement;
+			for (displacement = 0; displacement < tries; displacement++) {
+				size_t k;
+				for (k = 0; k < bucket.size(); k++) {
+					const ieDword *h = &hashes[bucket[k] * 3];
+					unsigned int slot = Slot(h[1], h[2], displacement);
+					if (taken[slot]) {
+						break;
+					}
+					// collisions inside the bucket
+					taken[slot] = 1;
+					slotOf[bucket[k]] = slot;
+				}
+				if (k == bucket.size()) {
+					break;
+				}
+				while (k--) {
+					taken[slotOf[bucket[k]]] = 0;
+				}
+			}
+			if (displacement == tries) {
+				placed = false;
+				break;
+			}
+			displacements[order[o].second] = displacement;
+		}
+		// single keys go straight into the free slots: with d0 = 0 the
+		// slot is f1 + d1, so d1 follows from the slot
+		for (; placed && o < buckets && order[o].first; o++) {
+			unsigned int i = contents[order[o].second][0];
+			while (taken[freeSlot]) {
+				freeSlot++;
+			}
+			taken[freeSlot] = 1;
+			slotOf[i] = freeSlot;
+			displacements[order[o].second] = (freeSlot + count - hashes[i * 3 + 1] % count) % count;
+		}
+		if (placed) {
+			for (unsigned int i = 0; i < count; i++) {
+				entries[slotOf[i]] = keys[i];
+			}
+			return true;
+		}
+		memset(displacements, 0, buckets * sizeof(ieDword));
+	}
+
+	Clear();
+	return false;
+}
+
+const ieDword *KEYIndex::get(const char *resref, SClass_ID type) const
+{
+	if (!count) {
+		return NULL;
+	}
+	char key[8];
+	ieDword hash[3];
+	if (!HashResource(resref, (ieWord) type, seed, key, hash)) {
+		return NULL;
+	}
+	const Entry &e = entries[Slot(hash[1], hash[2], displacements[hash[0] % buckets])];
+	if (e.type != (ieWord) type || memcmp(e.ref, key, 8)) {
+		return NULL;
+	}
+	return &e.locator;
+}
+
+ieDword KEYIndex::Checksum(const char *records, unsigned int size)
+{
+	ieDword h = 2166136261u;
+	for (unsigned int i = 0; i < size; i++) {
+		h = (h ^ (unsigned char) records[i]) * 16777619u;
+	}
+	return h ^ size;
+}
+
+// the file is only a cache, so it is kept in the native layout
+bool KEYIndex::Load(const char *path, ieDword checksum)
+{
+	Clear();
+	FileStream *f = FileStream::OpenFile(path);
+	if (!f) {
+		return false;
+	}
+	char signature[8];
+	ieDword header[4];
+	bool ok = f->Read(signature, 8) == 8 && !memcmp(signature, IndexSignature, 8) &&
+		f->Read(header, sizeof(header)) == (int) sizeof(header) && header[0] == checksum;
+	if (ok) {
+		count = header[1];
+		buckets = header[2];
+		seed = header[3];
+		unsigned long entriesSize = count * sizeof(Entry);
+		unsigned long displacementsSize = buckets * sizeof(ieDword);
+		ok = count && buckets && f->Remains() == entriesSize + displacementsSize;
+		if (ok) {
+			entries = (Entry *) malloc(entriesSize);
+			displacements = (ieDword *) malloc(displacementsSize);
+			ok = f->Read(displacements, displacementsSize) == (int) displacementsSize &&
+				f->Read(entries, entriesSize) == (int) entriesSize;
+		}
+	}
+	delete f;
+	if (!ok) {
+		Clear();
+	}
+	return ok;
+}
+
+bool KEYIndex::Save(const char *path, ieDword checksum) const
+{
+	if (!count) {
+		return false;
+	}
+	FileStream out;
+	if (!out.Create(path)) {
+		return false;
+	}
+	ieDword header[4] = { checksum, count, buckets, seed };
+	return out.Write(IndexSignature, 8) == 8 &&
+		out.Write(header, sizeof(header)) == (int) sizeof(header) &&
+		out.Write(displacements, buckets * sizeof(ieDword)) == (int) (buckets * sizeof(ieDword)) &&
+		out.Write(entries, count * sizeof(Entry)) == (int) (count * sizeof(Entry));
+}
+
+}
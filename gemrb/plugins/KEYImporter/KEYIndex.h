@@ -0,0 +1,80 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef KEYINDEX_H
+#define KEYINDEX_H
+
+#include "SClassID.h"
+#include "ie_types.h"
+
+#include <cstddef>
+
+namespace GemRB {
+
+/* Read-only minimal perfect hash over the (resref, type) pairs of a KEY
+ * every resource of the key lands in its own slot (hash and displace: the
+ * keys are spread over small buckets, each bucket remembers the
+ * displacement that puts all of its keys into free slots), so a lookup is
+ * two hashes and one comparison. The table can be stored in the cache dir,
+ * so later launches don't have to rebuild it.
+ */
+class KEYIndex {
+public:
+	KEYIndex();
+	~KEYIndex();
+
+	/* builds the index from the raw 14 byte resource records of a KEY,
+	 * the last of duplicate entries wins */
+	bool Build(const char *records, unsigned int count);
+	/* restores an index saved from the same records */
+	bool Load(const char *path, ieDword checksum);
+	bool Save(const char *path, ieDword checksum) const;
+
+	const ieDword *get(const char *resref, SClass_ID type) const;
+	bool has(const char *resref, SClass_ID type) const
+	{
+		return get(resref, type) != NULL;
+	}
+	unsigned int size() const { return count; }
+
+	/* fingerprint of the records, to tell if a saved index still fits */
+	static ieDword Checksum(const char *records, unsigned int size);
+
+private:
+	struct Entry {
+		char ref[8]; // lowercase, zero padded
+		ieDword locator;
+		ieWord type;
+		ieWord unused;
+	};
+
+	Entry *entries;
+	unsigned int count;
+	ieDword *displacements;
+	unsigned int buckets;
+	ieDword seed;
+
+	void Clear();
+	static bool KeyLess(const Entry &a, const Entry &b);
+	unsigned int Slot(ieDword f1, ieDword f2, ieDword displacement) const;
+};
+
+}
+
+#endif
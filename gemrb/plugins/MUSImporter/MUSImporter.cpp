@@ -31,6 +31,108 @@ using namespace GemRB;
 
 static char musicsubfolder[6] = "music";
 
+// seconds of the next segment decoded ahead
+#define PREFETCH_SECONDS 1
+
+namespace GemRB {
+
+/* A segment opened ahead, handing out the samples decoded in advance
+ * before reading on from the segment itself.
+ */
+class PrefetchedSound : public SoundMgr {
+public:
+	PrefetchedSound(Holder<SoundMgr> s) : sound(s), head(NULL), headCount(0), headPos(0)
+	{
+		samples = sound->get_length();
+		channels = sound->get_channels();
+		samplerate = sound->get_samplerate();
+		int count = samplerate * channels * PREFETCH_SECONDS;
+		if (count > samples) count = samples;
+		if (count > 0) {
+			head = (short *) malloc(count * sizeof(short));
+			headCount = sound->read_samples(head, count);
+		}
+	}
+	~PrefetchedSound()
+	{
+		free(head);
+	}
+	bool Open(DataStream* /*stream*/)
+	{
+		return false;
+	}
+	int read_samples(short* memory, int cnt)
+	{
+		int res = 0;
+		if (headPos < headCount) {
+			res = headCount - headPos;
+			if (res > cnt) res = cnt;
+			memcpy(memory, head + headPos, res * sizeof(short));
+			headPos += res;
+		}
+		if (res < cnt) {
+			res += sound->read_samples(memory + res, cnt - res);
+		}
+		return res;
+	}
+private:
+	Holder<SoundMgr> sound;
+	short *head;
+	int headCount, headPos;
+};
+
+class SegmentLoader : public Thread {
+public:
+	SegmentLoader(MUSImporter *owner) : importer(owner)
+	{
+		char path[_MAX_PATH];
+		PathJoin(path, core->GamePath, musicsubfolder, NULL);
+		// the resource managers aren't thread safe, so it gets its own
+		manager.AddSource(path, "Music", PLUGIN_RESOURCE_DIRECTORY);
+	}
+	~SegmentLoader() { Join(); }
+protected:
+	void Run();
+private:
+	MUSImporter *importer;
+	ResourceManager manager;
+};
+
+void SegmentLoader::Run()
+{
+	char name[_MAX_PATH];
+	while (true) {
+		{
+			MutexLock l(importer->prefetchLock);
+			while (!importer->stopping && (!importer->wantedFile[0] || !stricmp(importer->wantedFile, importer->readyFile))) {
+				importer->prefetchWakeup.Wait(importer->prefetchLock);
+			}
+			if (importer->stopping) {
+				return;
+			}
+			strlcpy(name, importer->wantedFile, sizeof(name));
+		}
+
+		Holder<SoundMgr> sound;
+		ResourceHolder<SoundMgr> file(name, manager, true);
+		if (file) {
+			sound = new PrefetchedSound(file);
+		}
+
+		MutexLock l(importer->prefetchLock);
+		// keep it unless another segment was asked for meanwhile
+		if (!stricmp(importer->wantedFile, name)) {
+			strlcpy(importer->readyFile, name, sizeof(importer->readyFile));
+			importer->ready = sound;
+		}
+		// the reference counts aren't atomic, drop ours while locked
+		sound.release();
+		file.release();
+	}
+}
+
+}
+
 MUSImporter::MUSImporter()
 {
 	Initialized = false;
@@ -44,10 +146,22 @@ MUSImporter::MUSImporter()
 	char path[_MAX_PATH];
 	PathJoin(path, core->GamePath, musicsubfolder, NULL);
 	manager.AddSource(path, "Music", PLUGIN_RESOURCE_DIRECTORY);
+	stopping = false;
+	wantedFile[0] = '\0';
+	readyFile[0] = '\0';
+	loader = NULL;
 }
 
 MUSImporter::~MUSImporter()
 {
+	if (loader) {
+		{
+			MutexLock l(prefetchLock);
+			stopping = true;
+			prefetchWakeup.Broadcast();
+		}
+		delete loader;
+	}
 	if (str) {
 		delete( str );
 	}
@@ -200,6 +314,7 @@ void MUSImporter::Start()
 		core->GetAudioDrv()->Play();
 		lastSound = playlist[PLpos].soundID;
 		Playing = true;
+		Prefetch( PLnext );
 	}
 }
 /** Ends the Current PlayList Execution */
@@ -276,6 +391,7 @@ void MUSImporter::PlayNext()
 				PLnext = 0;
 			}
 		}
+		Prefetch( PLnext );
 	} else {
 		Playing = false;
 		core->GetAudioDrv()->Stop();
@@ -294,9 +410,8 @@ void MUSImporter::PlayMusic(int pos)
 	PlayMusic( playlist[pos].PLFile );
 }
 
-void MUSImporter::PlayMusic(char* name)
+void MUSImporter::GetSegmentPath(const char* name, char* FName) const
 {
-	char FName[_MAX_PATH];
 	if (strnicmp( name, "mx9000", 6 ) == 0) { //iwd2
 		PathJoin(FName, "mx9000", name, NULL);
 	} else if (strnicmp( name, "mx0000", 6 ) == 0) { //iwd
@@ -308,8 +423,53 @@ void MUSImporter::PlayMusic(char* name)
 	} else {
 		strlcpy(FName, name, _MAX_PATH);
 	}
+}
 
-	ResourceHolder<SoundMgr> sound(FName, manager);
+/** Asks the loader to open the segment at pos ahead of its time */
+void MUSImporter::Prefetch(int pos)
+{
+	if (pos < 0 || (unsigned int) pos >= playlist.size()) {
+		return;
+	}
+	char FName[_MAX_PATH];
+	GetSegmentPath(playlist[pos].PLFile, FName);
+
+	MutexLock l(prefetchLock);
+	if (!loader) {
+		loader = new SegmentLoader(this);
+		if (!loader->Start()) {
+			delete loader;
+			loader = NULL;
+			return;
+		}
+	}
+	strlcpy(wantedFile, FName, sizeof(wantedFile));
+	prefetchWakeup.Signal();
+}
+
+/** Returns the segment if the loader has it ready, it is only used once */
+Holder<SoundMgr> MUSImporter::TakePrefetched(const char* FName)
+{
+	Holder<SoundMgr> sound;
+	MutexLock l(prefetchLock);
+	if (ready && !stricmp(readyFile, FName)) {
+		sound = ready;
+		ready.release();
+		readyFile[0] = '\0';
+		wantedFile[0] = '\0';
+	}
+	return sound;
+}
+
+void MUSImporter::PlayMusic(char* name)
+{
+	char FName[_MAX_PATH];
+	GetSegmentPath(name, FName);
+
+	Holder<SoundMgr> sound = TakePrefetched(FName);
+	if (!sound) {
+		sound = ResourceHolder<SoundMgr>(FName, manager);
+	}
 	if (sound) {
 		int soundID = core->GetAudioDrv()->CreateStream( sound );
 		if (soundID == -1) {
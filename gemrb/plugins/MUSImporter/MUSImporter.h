@@ -24,7 +24,9 @@
 #include "MusicMgr.h"
 
 #include "ResourceManager.h"
+#include "SoundMgr.h"
 #include "System/FileStream.h"
+#include "System/Thread.h"
 
 #include <cstdio>
 
@@ -42,6 +44,8 @@ struct PLString {
 	unsigned int soundID;
 };
 
+class SegmentLoader;
+
 class MUSImporter : public MusicMgr {
 private:
 	bool Initialized;
@@ -53,9 +57,23 @@ private:
 	std::vector< PLString> playlist;
 	unsigned int lastSound;
 	ResourceManager manager;
+
+	// the next segment is opened and its start decoded ahead by a worker,
+	// so the music thread doesn't wait on the disk between segments
+	friend class SegmentLoader;
+	Mutex prefetchLock;
+	ConditionVariable prefetchWakeup;
+	bool stopping;
+	char wantedFile[_MAX_PATH];
+	char readyFile[_MAX_PATH];
+	Holder<SoundMgr> ready;
+	SegmentLoader *loader;
 private:
 	void PlayMusic(int pos);
 	void PlayMusic(char* name);
+	void GetSegmentPath(const char* name, char* FName) const;
+	void Prefetch(int pos);
+	Holder<SoundMgr> TakePrefetched(const char* FName);
 public:
 	MUSImporter();
 	~MUSImporter();
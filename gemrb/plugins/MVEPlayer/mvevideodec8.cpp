@@ -147,6 +147,19 @@ ipvideo_decode_0x5 (const GstMveDemuxStream * s, unsigned char *frame,
 			frame + ((guint8 *) s->back_buf2 - (guint8 *) s->back_buf1) + offset, offset);
 }
 
+/* writes count pixels, P1 where the flag bit is set and P0 elsewhere,
+ * without a branch per pixel */
+static inline void
+ipvideo_put_pixels2 (unsigned char *frame, unsigned int flags, int count,
+		unsigned char P0, unsigned char P1)
+{
+	int x;
+	unsigned char diff = P0 ^ P1;
+
+	for (x = 0; x < count; ++x)
+		frame[x] = P0 ^ (diff & -(int) ((flags >> x) & 1));
+}
+
 static int
 ipvideo_decode_0x7 (const GstMveDemuxStream * s, unsigned char *frame,
 		const unsigned char **data, unsigned short *len)
@@ -168,14 +181,8 @@ ipvideo_decode_0x7 (const GstMveDemuxStream * s, unsigned char *frame,
 		CHECK_STREAM (len, 8 - 2);
 
 		for (y = 0; y < 8; ++y) {
-			flags = *(*data)++;
-			for (x = 0x01; x <= 0x80; x <<= 1) {
-				if (flags & x)
-					*frame++ = P1;
-				else
-					*frame++ = P0;
-			}
-			frame += s->width - 8;
+			ipvideo_put_pixels2 (frame, *(*data)++, 8, P0, P1);
+			frame += s->width;
 		}
 
 	} else {
@@ -209,7 +216,7 @@ static int
 ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 		const unsigned char **data, unsigned short *len)
 {
-	int x, y;
+	int y;
 	unsigned char P[8];
 	unsigned char B[8];
 	unsigned int flags = 0;
@@ -251,7 +258,6 @@ ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 				((B[0] & 0x0F)) | ((B[4] & 0x0F) << 4) |
 				((B[1] & 0xF0) << 20) | ((B[5] & 0xF0) << 24) |
 				((B[1] & 0x0F) << 16) | ((B[5] & 0x0F) << 20);
-		bitmask = 0x00000001;
 		lower_half = 0; /* still on top half */
 
 		for (y = 0; y < 8; ++y) {
@@ -263,26 +269,16 @@ ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 						((B[2] & 0x0F)) | ((B[6] & 0x0F) << 4) |
 						((B[3] & 0xF0) << 20) | ((B[7] & 0xF0) << 24) |
 						((B[3] & 0x0F) << 16) | ((B[7] & 0x0F) << 20);
-				bitmask = 0x00000001;
 				lower_half = 2;
 			}
 
-			/* get the pixel values ready for this quadrant */
-			P0 = P[lower_half + 0];
-			P1 = P[lower_half + 1];
-
-			for (x = 0; x < 8; ++x, bitmask <<= 1) {
-				if (x == 4) {
-					P0 = P[lower_half + 4];
-					P1 = P[lower_half + 5];
-				}
-
-				if (flags & bitmask)
-					*frame++ = P1;
-				else
-					*frame++ = P0;
-			}
-			frame += s->width - 8;
+			/* each row takes the next 8 flags, 4 for either quadrant */
+			bitmask = flags >> ((y & 3) * 8);
+			ipvideo_put_pixels2 (frame, bitmask, 4,
+					P[lower_half + 0], P[lower_half + 1]);
+			ipvideo_put_pixels2 (frame + 4, bitmask >> 4, 4,
+					P[lower_half + 4], P[lower_half + 5]);
+			frame += s->width;
 		}
 
 	} else {
@@ -306,7 +302,6 @@ ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 				((B[0] & 0x0F)) | ((B[4] & 0x0F) << 4) |
 				((B[1] & 0xF0) << 20) | ((B[5] & 0xF0) << 24) |
 				((B[1] & 0x0F) << 16) | ((B[5] & 0x0F) << 20);
-			bitmask = 0x00000001;
 
 			for (y = 0; y < 8; ++y) {
 
@@ -316,25 +311,12 @@ ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 						((B[2] & 0x0F)) | ((B[6] & 0x0F) << 4) |
 						((B[3] & 0xF0) << 20) | ((B[7] & 0xF0) << 24) |
 						((B[3] & 0x0F) << 16) | ((B[7] & 0x0F) << 20);
-					bitmask = 0x00000001;
 				}
 
-				/* get the pixel values ready for this half */
-				P0 = P[0];
-				P1 = P[1];
-
-				for (x = 0; x < 8; ++x, bitmask <<= 1) {
-					if (x == 4) {
-						P0 = P[2];
-						P1 = P[3];
-					}
-
-					if (flags & bitmask)
-						*frame++ = P1;
-					else
-						*frame++ = P0;
-				}
-				frame += s->width - 8;
+				bitmask = flags >> ((y & 3) * 8);
+				ipvideo_put_pixels2 (frame, bitmask, 4, P[0], P[1]);
+				ipvideo_put_pixels2 (frame + 4, bitmask >> 4, 4, P[2], P[3]);
+				frame += s->width;
 			}
 
 		} else {
@@ -346,20 +328,13 @@ ipvideo_decode_0x8 (const GstMveDemuxStream * s, unsigned char *frame,
 
 			for (y = 0; y < 8; ++y) {
 
-				flags = B[y];
 				if (y == 4) {
 					P0 = P[2];
 					P1 = P[3];
 				}
 
-				for (bitmask = 0x01; bitmask <= 0x80; bitmask <<= 1) {
-
-					if (flags & bitmask)
-						*frame++ = P1;
-					else
-						*frame++ = P0;
-				}
-				frame += s->width - 8;
+				ipvideo_put_pixels2 (frame, B[y], 8, P0, P1);
+				frame += s->width;
 			}
 		}
 	}
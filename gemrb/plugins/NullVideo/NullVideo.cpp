@@ -0,0 +1,219 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#include "NullVideo.h"
+
+#include "win32def.h"
+
+#include "Palette.h"
+
+#include <cstring>
+
+using namespace GemRB;
+
+static size_t PixelBytes(int Width, int Height, int Bpp)
+{
+	return ((size_t) Width * Height * Bpp + 7) / 8;
+}
+
+NullSprite2D::NullSprite2D(int Width, int Height, int Bpp, void* pixels)
+	: Sprite2D(Width, Height, Bpp, pixels)
+{
+	pal = NULL;
+	colorkey = 0;
+}
+
+NullSprite2D::NullSprite2D(const NullSprite2D &obj)
+	: Sprite2D(obj)
+{
+	if (obj.pixels) {
+		size_t size = PixelBytes(Width, Height, Bpp);
+		void *copied = malloc(size);
+		memcpy(copied, obj.pixels, size);
+		pixels = copied;
+		freePixels = true;
+	}
+	pal = obj.pal;
+	if (pal) {
+		pal->acquire();
+	}
+	colorkey = obj.colorkey;
+}
+
+NullSprite2D* NullSprite2D::copy() const
+{
+	return new NullSprite2D(*this);
+}
+
+NullSprite2D::~NullSprite2D()
+{
+	if (pal) {
+		pal->release();
+	}
+}
+
+Palette* NullSprite2D::GetPalette() const
+{
+	if (pal) {
+		pal->acquire();
+	}
+	return pal;
+}
+
+void NullSprite2D::SetPalette(Palette* palette)
+{
+	if (palette) {
+		palette->acquire();
+	}
+	if (pal) {
+		pal->release();
+	}
+	pal = palette;
+}
+
+Color NullSprite2D::GetPixel(unsigned short x, unsigned short y) const
+{
+	Color c = { 0, 0, 0, 0 };
+	if (!pixels || x >= Width || y >= Height) return c;
+
+	size_t offset = (size_t) y * Width + x;
+	if (Bpp == 8) {
+		ieByte index = ((const ieByte *) pixels)[offset];
+		if (pal && index != colorkey) {
+			c = pal->col[index];
+			c.a = 0xff;
+		}
+	} else if (Bpp == 32) {
+		ieDword value = ((const ieDword *) pixels)[offset];
+		if (value != colorkey) {
+			// the masks aren't kept, assume the usual RGBA order
+			c.r = (ieByte) value;
+			c.g = (ieByte) (value >> 8);
+			c.b = (ieByte) (value >> 16);
+			c.a = (ieByte) (value >> 24);
+		}
+	}
+	return c;
+}
+
+NullVideoDriver::NullVideoDriver(void)
+{
+}
+
+NullVideoDriver::~NullVideoDriver(void)
+{
+}
+
+int NullVideoDriver::Init(void)
+{
+	return GEM_OK;
+}
+
+int NullVideoDriver::CreateDisplay(int w, int h, int b, bool fs, const char* /*title*/)
+{
+	width = w;
+	height = h;
+	bpp = b;
+	fullscreen = fs;
+	Viewport.w = width;
+	Viewport.h = height;
+	SetScreenClip(NULL);
+	return GEM_OK;
+}
+
+bool NullVideoDriver::SetFullscreenMode(bool set)
+{
+	fullscreen = set;
+	return true;
+}
+
+int NullVideoDriver::SwapBuffers(void)
+{
+	// nothing was presented, but the next frame mustn't think it still is
+	ClearDirty();
+	return GEM_OK;
+}
+
+Sprite2D* NullVideoDriver::CreateSprite(int w, int h, int bpp, ieDword /*rMask*/,
+	ieDword /*gMask*/, ieDword /*bMask*/, ieDword /*aMask*/, void* pixels, bool cK, int index)
+{
+	NullSprite2D* spr = new NullSprite2D(w, h, bpp, pixels);
+	if (cK) {
+		spr->SetColorKey(index);
+	}
+	return spr;
+}
+
+Sprite2D* NullVideoDriver::CreateSprite8(int w, int h, void* pixels,
+	Palette* palette, bool cK, int index)
+{
+	return CreatePalettedSprite(w, h, 8, pixels, palette->col, cK, index);
+}
+
+Sprite2D* NullVideoDriver::CreatePalettedSprite(int w, int h, int bpp, void* pixels,
+	Color* palette, bool cK, int index)
+{
+	if (palette == NULL) return NULL;
+
+	NullSprite2D* spr = new NullSprite2D(w, h, bpp, pixels);
+	Palette* pal = new Palette(palette);
+	spr->SetPalette(pal);
+	pal->release();
+	if (cK) {
+		spr->SetColorKey(index);
+	}
+	return spr;
+}
+
+Sprite2D* NullVideoDriver::GetScreenshot(Region r)
+{
+	unsigned int w = r.w ? r.w : width;
+	unsigned int h = r.h ? r.h : height;
+	void* pixels = calloc(w * h, 4);
+	return CreateSprite(w, h, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000, pixels);
+}
+
+void NullVideoDriver::GetPixel(short /*x*/, short /*y*/, Color& color)
+{
+	color.r = color.g = color.b = color.a = 0;
+}
+
+void NullVideoDriver::MoveMouse(unsigned int x, unsigned int y)
+{
+	CursorPos.x = x;
+	CursorPos.y = y;
+}
+
+void NullVideoDriver::InitMovieScreen(int &w, int &h, bool /*yuv*/)
+{
+	w = width;
+	h = height;
+}
+
+int NullVideoDriver::PollMovieEvents()
+{
+	// nobody can watch, so the movies end at once
+	return 1;
+}
+
+#include "plugindef.h"
+
+GEMRB_PLUGIN(0x2E7D1C4, "Null Video Driver")
+PLUGIN_DRIVER(NullVideoDriver, "none")
+END_PLUGIN()
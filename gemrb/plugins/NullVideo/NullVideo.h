@@ -0,0 +1,123 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef NULLVIDEO_H
+#define NULLVIDEO_H
+
+#include "Video.h"
+
+#include "Sprite2D.h"
+
+namespace GemRB {
+
+/* Keeps the pixels, so the engine can still look at them, but draws nothing */
+class NullSprite2D : public Sprite2D {
+private:
+	Palette* pal;
+	ieDword colorkey;
+public:
+	NullSprite2D(int Width, int Height, int Bpp, void* pixels);
+	NullSprite2D(const NullSprite2D &obj);
+	NullSprite2D* copy() const;
+	~NullSprite2D();
+
+	Palette *GetPalette() const;
+	const Color* GetPaletteColors() const { return pal ? pal->col : NULL; }
+	void SetPalette(Palette *pal);
+	Color GetPixel(unsigned short x, unsigned short y) const;
+	ieDword GetColorKey() const { return colorkey; }
+	void SetColorKey(ieDword ck) { colorkey = ck; }
+};
+
+/* Video driver without a display, for running the game headless
+ * (benchmarks, automated runs). There is no input either.
+ */
+class NullVideoDriver : public Video {
+public:
+	NullVideoDriver(void);
+	~NullVideoDriver(void);
+	int Init(void);
+	int CreateDisplay(int width, int height, int bpp, bool fullscreen, const char* title);
+	bool SetFullscreenMode(bool set);
+	int SwapBuffers(void);
+	bool ToggleGrabInput() { return false; }
+	short GetWidth() { return (short) width; }
+	short GetHeight() { return (short) height; }
+	void ShowSoftKeyboard() {}
+	void HideSoftKeyboard() {}
+
+	Sprite2D* CreateSprite(int w, int h, int bpp, ieDword rMask,
+		ieDword gMask, ieDword bMask, ieDword aMask, void* pixels,
+		bool cK = false, int index = 0);
+	Sprite2D* CreateSprite8(int w, int h, void* pixels,
+		Palette* palette, bool cK = false, int index = 0);
+	Sprite2D* CreatePalettedSprite(int w, int h, int bpp, void* pixels,
+		Color* palette, bool cK = false, int index = 0);
+
+	void BlitTile(const Sprite2D*, const Sprite2D*, int, int, const Region*, unsigned int) {}
+	void BlitSprite(const Sprite2D*, int, int, bool = false, const Region* = NULL, Palette* = NULL) {}
+	void BlitSprite(const Sprite2D*, const Region&, const Region&, Palette* = NULL) {}
+	void BlitGameSprite(const Sprite2D*, int, int, unsigned int, Color, SpriteCover*,
+		Palette* = NULL, const Region* = NULL, bool = false) {}
+	Sprite2D* GetScreenshot(Region r);
+	void DrawRect(const Region&, const Color&, bool = true, bool = false) {}
+	void DrawRectSprite(const Region&, const Color&, const Sprite2D*) {}
+	void SetPixel(short, short, const Color&, bool = false) {}
+	void GetPixel(short, short, Color& color);
+	void DrawCircle(short, short, unsigned short, const Color&, bool = true) {}
+	void DrawEllipseSegment(short, short, unsigned short, unsigned short, const Color&,
+		double, double, bool = true, bool = true) {}
+	void DrawEllipse(short, short, unsigned short, unsigned short, const Color&, bool = true) {}
+	void DrawPolyline(Gem_Polygon*, const Color&, bool = false) {}
+	void DrawLine(short, short, short, short, const Color&, bool = false) {}
+
+	void ConvertToGame(short& x, short& y)
+	{
+		x += Viewport.x;
+		y += Viewport.y;
+	}
+	void ConvertToScreen(short& x, short& y)
+	{
+		x -= Viewport.x;
+		y -= Viewport.y;
+	}
+	void SetFadeColor(int, int, int) {}
+	void SetFadePercent(int) {}
+	void ClickMouse(unsigned int) {}
+	void MoveMouse(unsigned int x, unsigned int y);
+	bool TouchInputEnabled() const { return false; }
+
+	void InitMovieScreen(int &w, int &h, bool yuv = false);
+	void DestroyMovieScreen() {}
+	void showFrame(unsigned char*, unsigned int, unsigned int, unsigned int, unsigned int,
+		unsigned int, unsigned int, unsigned int, unsigned int, int, unsigned char*, ieDword) {}
+	void showYUVFrame(unsigned char**, unsigned int*, unsigned int, unsigned int,
+		unsigned int, unsigned int, unsigned int, unsigned int, ieDword) {}
+	void DrawMovieSubtitle(ieStrRef) {}
+	int PollMovieEvents();
+	void SetGamma(int, int) {}
+
+	void DrawBackgroundBuffer() {}
+	void FreeBackgroundBuffer() {}
+	void TakeBackgroundBuffer() {}
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "Game.h"
 #include "Interface.h"
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cmath>
@@ -33,6 +34,16 @@
 
 using namespace GemRB;
 
+// how often disabled ambients are checked for being enabled again
+#define DISABLED_RECHECK 5000
+// the out of range ambients wait this many ms per pixel they are away
+#define FAR_DELAY_PER_PIXEL 2
+#define FAR_DELAY_MAX 10000
+// moving the listener further than this checks every ambient again
+#define LISTENER_SLACK 200
+// and the listener is looked at this often, however quiet the area
+#define LISTENER_POLL 500
+
 // TODO: no more dependency on OpenAL, rename and move it?
 
 // legal nop if already reset
@@ -45,6 +56,7 @@ void AmbientMgrAL::reset()
 		delete (*it);
 	}
 	ambientSources.clear();
+	schedule.clear();
 	AmbientMgr::reset();
 	if (NULL != player) {
 		SDL_CondSignal(cond);
@@ -63,6 +75,7 @@ void AmbientMgrAL::setAmbients(const std::vector<Ambient *> &a)
 	for (std::vector<Ambient *>::const_iterator it = a.begin(); it != a.end(); ++it) {
 		ambientSources.push_back(new AmbientSource(*it));
 	}
+	rescheduleAll = true;
 	core->GetAudioDrv()->UpdateVolume( GEM_SND_VOL_AMBIENTS );
 
 #if	SDL_VERSION_ATLEAST(1, 3, 0)
@@ -78,6 +91,7 @@ void AmbientMgrAL::activate(const std::string &name)
 	if (NULL != player)
 		SDL_mutexP(mutex);
 	AmbientMgr::activate(name);
+	rescheduleAll = true;
 	if (NULL != player) {
 		SDL_CondSignal(cond);
 		SDL_mutexV(mutex);
@@ -89,6 +103,7 @@ void AmbientMgrAL::activate()
 	if (NULL != player)
 		SDL_mutexP(mutex);
 	AmbientMgr::activate();
+	rescheduleAll = true;
 	if (NULL != player) {
 		SDL_CondSignal(cond);
 		SDL_mutexV(mutex);
@@ -100,6 +115,7 @@ void AmbientMgrAL::deactivate(const std::string &name)
 	if (NULL != player)
 		SDL_mutexP(mutex);
 	AmbientMgr::deactivate(name);
+	rescheduleAll = true;
 	if (NULL != player) {
 		SDL_CondSignal(cond);
 		SDL_mutexV(mutex);
@@ -139,6 +155,25 @@ int AmbientMgrAL::play(void *am)
 	return 0;
 }
 
+bool AmbientMgrAL::LaterFirst(const ScheduleEntry &a, const ScheduleEntry &b)
+{
+	return (int) (a.first - b.first) > 0;
+}
+
+// makes every source due now
+void AmbientMgrAL::reschedule(unsigned int ticks)
+{
+	schedule.clear();
+	schedule.reserve(ambientSources.size());
+	for (std::vector<AmbientSource *>::iterator it = ambientSources.begin(); it != ambientSources.end(); ++it) {
+		(*it)->due = ticks;
+		schedule.push_back(ScheduleEntry(ticks, *it));
+	}
+	// all equal, so it already is a heap
+}
+
+// only the sources that are due are ticked, so the far and the waiting
+// ones cost nothing until their time comes
 unsigned int AmbientMgrAL::tick(unsigned int ticks)
 {
 	unsigned int delay = 60000; // wait one minute if all sources are off
@@ -152,12 +187,42 @@ unsigned int AmbientMgrAL::tick(unsigned int ticks)
 	listener.x = (short) xpos;
 	listener.y = (short) ypos;
 
+	// the far sources wait for longer, so check them again when the
+	// listener has moved (or jumped) noticeably since
+	if (rescheduleAll || Distance(listener, scheduledListener) > LISTENER_SLACK) {
+		reschedule(ticks);
+		scheduledListener = listener;
+		rescheduleAll = false;
+	}
+
 	ieDword timeslice = SCHEDULE_MASK(core->GetGame()->GameTime);
 
-	for (std::vector<AmbientSource *>::iterator it = ambientSources.begin(); it != ambientSources.end(); ++it) {
-		unsigned int newdelay = (*it)->tick(ticks, listener, timeslice);
-		if (newdelay < delay)
-			delay = newdelay;
+	while (!schedule.empty()) {
+		ScheduleEntry next = schedule.front();
+		if (next.first == next.second->due && (int) (next.first - ticks) > 0) {
+			break;
+		}
+		std::pop_heap(schedule.begin(), schedule.end(), LaterFirst);
+		schedule.pop_back();
+		if (next.first != next.second->due) {
+			continue; // stale
+		}
+
+		unsigned int newdelay = next.second->tick(ticks, listener, timeslice);
+		if (newdelay == UINT_MAX) {
+			// disabled, scripts or the time of day may enable it
+			newdelay = DISABLED_RECHECK;
+		}
+		next.second->due = ticks + newdelay;
+		schedule.push_back(ScheduleEntry(next.second->due, next.second));
+		std::push_heap(schedule.begin(), schedule.end(), LaterFirst);
+	}
+
+	if (!schedule.empty()) {
+		delay = schedule.front().first - ticks;
+	}
+	if (delay > LISTENER_POLL) {
+		delay = LISTENER_POLL;
 	}
 	return delay;
 }
@@ -173,7 +238,7 @@ void AmbientMgrAL::UpdateVolume(unsigned short volume)
 
 
 AmbientMgrAL::AmbientSource::AmbientSource(const Ambient *a)
-: stream(-1), ambient(a), lastticks(0), nextdelay(0), nextref(0), totalgain(0)
+: due(0), stream(-1), ambient(a), lastticks(0), nextdelay(0), nextref(0), totalgain(0)
 {
 }
 
@@ -236,10 +301,16 @@ unsigned int AmbientMgrAL::AmbientSource::tick(unsigned int ticks, Point listene
 	}
 
 	if (!(ambient->getFlags() & IE_AMBI_MAIN) && !isHeard(listener)) { // we are out of range
-		// release stream if we're inactive for a while
-		core->GetAudioDrv()->ReleaseStream(stream);
-		stream = -1;
-		return nextdelay;
+		// release stream if we're inactive for a while, so only the
+		// audible ambients hold sources
+		if (stream >= 0) {
+			core->GetAudioDrv()->ReleaseStream(stream);
+			stream = -1;
+		}
+		// and the further away, the less often it needs a look
+		unsigned int far = (Distance(listener, ambient->getOrigin()) - ambient->getRadius()) * FAR_DELAY_PER_PIXEL;
+		if (far > FAR_DELAY_MAX) far = FAR_DELAY_MAX;
+		return far > nextdelay ? far : nextdelay;
 	}
 
 	unsigned int v = 100;
@@ -22,6 +22,7 @@
 #define AMBIENTMGRAL_H
 
 #include "AmbientMgr.h"
+#include "Region.h"
 
 #include <vector>
 #include <string>
@@ -34,7 +35,7 @@ class Ambient;
 
 class AmbientMgrAL : public AmbientMgr {
 public:
-	AmbientMgrAL() : AmbientMgr(), mutex(SDL_CreateMutex()), 
+	AmbientMgrAL() : AmbientMgr(), rescheduleAll(true), mutex(SDL_CreateMutex()),
 			player(NULL), cond(SDL_CreateCond()) { }
 	~AmbientMgrAL() { reset(); SDL_DestroyMutex(mutex); SDL_DestroyCond(cond); }
 	void reset();
@@ -52,6 +53,8 @@ private:
 		unsigned int tick(unsigned int ticks, Point listener, ieDword timeslice);
 		void hardStop();
 		void SetVolume(unsigned short volume);
+		// when the manager calls tick next
+		unsigned int due;
 	private:
 		int stream;
 		const Ambient* ambient;
@@ -64,9 +67,18 @@ private:
 		int enqueue();
 	};
 	std::vector<AmbientSource *> ambientSources;
-	
+	// min-heap of the sources by due time; an entry is stale once its
+	// time no longer matches the source's due
+	typedef std::pair<unsigned int, AmbientSource *> ScheduleEntry;
+	std::vector<ScheduleEntry> schedule;
+	// where the listener was when every source was last checked
+	Point scheduledListener;
+	bool rescheduleAll;
+
 	static int play(void *am);
 	unsigned int tick(unsigned int ticks);
+	void reschedule(unsigned int ticks);
+	static bool LaterFirst(const ScheduleEntry &a, const ScheduleEntry &b);
 	void hardStop();
 	
 	SDL_mutex *mutex;
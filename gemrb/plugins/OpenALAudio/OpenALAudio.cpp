@@ -21,9 +21,15 @@
 #include "OpenALAudio.h"
 
 #include "GameData.h"
+#include "MemoryStats.h"
+#include "System/StringBuffer.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
+#include <string>
+#include <vector>
 
 using namespace GemRB;
 
@@ -76,6 +82,8 @@ void OpenALSoundHandle::SetPos(int XPos, int YPos) {
 
 	alSourcefv(parent->Source, AL_POSITION, SourcePos);
 	checkALError("Unable to set source position", WARNING);
+	parent->XPos = XPos;
+	parent->YPos = YPos;
 }
 
 bool OpenALSoundHandle::Playing() {
@@ -110,19 +118,8 @@ void AudioStream::ClearProcessedBuffers()
 		checkALError("Failed to unqueue buffers", WARNING);
 
 		if (delete_buffers) {
-#ifdef __APPLE__ // mac os x and iOS
-			/* FIXME: hackish
-				somebody with more knowledge than me could perhapps figure out
-				why Apple's implementation of alSourceUnqueueBuffers seems to delay (threading thing?)
-				and possible how better to deal with this.
-			*/
-			do{
-				alDeleteBuffers(processed, b);
-			}while(alGetError() != AL_NO_ERROR);
-#else
-			alDeleteBuffers(processed, b);
-			checkALError("Failed to delete buffers", WARNING);
-#endif
+			// refilled by QueueBuffer instead of generating new ones for each chunk
+			spareBuffers.insert(spareBuffers.end(), b, b + processed);
 		}
 
 		delete[] b;
@@ -130,6 +127,26 @@ void AudioStream::ClearProcessedBuffers()
 
 }
 
+void AudioStream::DeleteSpareBuffers()
+{
+	if (spareBuffers.empty()) return;
+
+#ifdef __APPLE__ // mac os x and iOS
+	/* FIXME: hackish
+		somebody with more knowledge than me could perhapps figure out
+		why Apple's implementation of alSourceUnqueueBuffers seems to delay (threading thing?)
+		and possible how better to deal with this.
+	*/
+	do{
+		alDeleteBuffers((ALsizei) spareBuffers.size(), &spareBuffers[0]);
+	}while(alGetError() != AL_NO_ERROR);
+#else
+	alDeleteBuffers((ALsizei) spareBuffers.size(), &spareBuffers[0]);
+	checkALError("Failed to delete buffers", WARNING);
+#endif
+	spareBuffers.clear();
+}
+
 void AudioStream::ClearIfStopped()
 {
 	if (free || locked) return;
@@ -145,6 +162,7 @@ void AudioStream::ClearIfStopped()
 			state == AL_STOPPED)
 	{
 		ClearProcessedBuffers();
+		DeleteSpareBuffers();
 		alDeleteSources( 1, &Source );
 		checkALError("Failed to delete source", WARNING);
 		Source = 0;
@@ -175,6 +193,11 @@ OpenALAudioDriver::OpenALAudioDriver(void)
 	MusicSource = num_streams = 0;
 	memset(MusicBuffer, 0, MUSICBUFFERS*sizeof(ALuint));
 	musicMutex = SDL_CreateMutex();
+	bufferMutex = SDL_CreateMutex();
+	cacheBytes = cacheBudget = 0;
+	cacheHits = cacheMisses = cacheEvictions = 0;
+	musicUnderruns = streamUnderruns = 0;
+	streamSteals = streamsDenied = 0;
 	ambim = NULL;
 	musicThread = NULL;
 	stayAlive = false;
@@ -253,6 +276,10 @@ bool OpenALAudioDriver::Init(void)
 		Log(MESSAGE, "OpenAL", "EFX not available.");
 	}
 
+	if (core->SoundCacheBudget > 0) {
+		cacheBudget = (unsigned long) core->SoundCacheBudget * 1024;
+	}
+
 	ambim = new AmbientMgrAL;
 	speech.free = true;
 	speech.ambient = false;
@@ -379,6 +406,8 @@ OpenALAudioDriver::~OpenALAudioDriver(void)
 
 	SDL_DestroyMutex(musicMutex);
 	musicMutex = NULL;
+	SDL_DestroyMutex(bufferMutex);
+	bufferMutex = NULL;
 
 	free(music_memory);
 
@@ -390,19 +419,23 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 	ALuint Buffer = 0;
 
 	CacheEntry *e;
-	void* p;
 
 	if (!ResRef[0]) {
 		return 0;
 	}
-	if(buffercache.Lookup(ResRef, p))
-	{
-		e = (CacheEntry*) p;
+	// the ambient manager loads its sounds from its own thread
+	StackLock l(bufferMutex, "bufferMutex in loadSound()");
+	unsigned int hash = buffercache.HashKey(ResRef);
+	e = buffercache.Use(ResRef, hash);
+	if (e) {
+		e->Hits++;
+		cacheHits++;
 		time_length = e->Length;
 		return e->Buffer;
 	}
 
 	//no cache entry...
+	cacheMisses++;
 	alGenBuffers(1, &Buffer);
 	if (checkALError("Unable to create sound buffer", ERROR)) {
 		return 0;
@@ -434,15 +467,19 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 		return 0;
 	}
 
-	e = new CacheEntry;
-	e->Buffer = Buffer;
-	e->Length = ((cnt / riff_chans) * 1000) / samplerate;
+	CacheEntry entry;
+	entry.Buffer = Buffer;
+	entry.Length = ((cnt / riff_chans) * 1000) / samplerate;
+	entry.Size = cnt1;
+	entry.Hits = 1;
 
-	buffercache.SetAt(ResRef, (void*)e);
-	//print("LoadSound: added %s to cache: %d. Cache size now %d", ResRef, e->Buffer, buffercache.GetCount());
+	buffercache.SetAt(ResRef, hash, entry);
+	cacheBytes += entry.Size;
+	MemoryStats::Add(MEM_SOUNDS, entry.Size);
+	//print("LoadSound: added %s to cache: %d. Cache size now %d", ResRef, entry.Buffer, buffercache.GetCount());
 
-	if (buffercache.GetCount() > BUFFER_CACHE_SIZE) {
-		evictBuffer();
+	while (cacheBudget && cacheBytes > cacheBudget && buffercache.GetCount() > 1) {
+		if (!evictBuffer()) break;
 	}
 	return Buffer;
 }
@@ -502,21 +539,26 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 		loop = 0; // Speech ignores GEM_SND_LOOPING
 	} else {
 		// do we want to be able to queue sfx too? not so far. How would we?
-		for (int i = 0; i < num_streams; i++) {
-			streams[i].ClearIfStopped();
-			if (streams[i].free) {
-				stream = &streams[i];
-				break;
-			}
+		int priority = (flags & GEM_SND_RELATIVE) ? PRIORITY_UI : PRIORITY_SFX;
+		int i = FindFreeStream();
+		if (i == -1) {
+			// in a big fight: drop the least important of the sounds
+			// playing, if it is less important than this one
+			i = StealStream(priority, GetListenerDistance(XPos, YPos, flags & GEM_SND_RELATIVE));
 		}
 
 		core->GetDictionary()->Lookup( "Volume SFX", volume );
 
-		if (stream == NULL) {
+		if (i == -1) {
 			// Failed to assign new sound.
 			// The buffercache will handle deleting Buffer.
 			return Holder<SoundHandle>();
 		}
+		stream = &streams[i];
+		stream->priority = priority;
+		stream->relative = flags & GEM_SND_RELATIVE;
+		stream->XPos = XPos;
+		stream->YPos = YPos;
 	}
 
 	assert(stream);
@@ -734,6 +776,65 @@ void OpenALAudioDriver::GetListenerPos(int &XPos, int &YPos )
 	YPos = (int) listen[1];
 }
 
+// returns a free stream, or -1 if all are playing
+int OpenALAudioDriver::FindFreeStream()
+{
+	// the sources known to be free don't need asking OpenAL
+	for (int i = 0; i < num_streams; i++) {
+		if (streams[i].free) {
+			return i;
+		}
+	}
+	for (int i = 0; i < num_streams; i++) {
+		streams[i].ClearIfStopped();
+		if (streams[i].free) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+double OpenALAudioDriver::GetListenerDistance(int XPos, int YPos, bool relative)
+{
+	if (!relative) {
+		int lx, ly;
+		GetListenerPos(lx, ly);
+		XPos -= lx;
+		YPos -= ly;
+	}
+	return sqrt((double) XPos * XPos + (double) YPos * YPos);
+}
+
+// stops the least important unlocked sound to free its stream for one of
+// the given priority and distance: lower priorities go first, then the
+// ones further away from the listener, so the audible fighting is kept
+int OpenALAudioDriver::StealStream(int priority, double distance)
+{
+	int victim = -1;
+	int victimPriority = priority;
+	double victimDistance = distance;
+	for (int i = 0; i < num_streams; i++) {
+		const AudioStream &s = streams[i];
+		if (s.free || s.locked || s.priority > victimPriority) continue;
+		double d = GetListenerDistance(s.XPos, s.YPos, s.relative);
+		if (s.priority == victimPriority && d <= victimDistance) continue;
+		victim = i;
+		victimPriority = s.priority;
+		victimDistance = d;
+	}
+	if (victim == -1) {
+		streamsDenied++;
+		return -1;
+	}
+
+	streams[victim].ForceClear();
+	if (!streams[victim].free) {
+		return -1;
+	}
+	streamSteals++;
+	return victim;
+}
+
 bool OpenALAudioDriver::ReleaseStream(int stream, bool HardStop)
 {
 	if (streams[stream].free || !streams[stream].locked)
@@ -756,13 +857,10 @@ int OpenALAudioDriver::SetupNewStream( ieWord x, ieWord y, ieWord z,
 		            ieWord gain, bool point, bool Ambient )
 {
 	// Find a free (or finished) stream for this sound
-	int stream = -1;
-	for (int i = 0; i < num_streams; i++) {
-		streams[i].ClearIfStopped();
-		if (streams[i].free) {
-			stream = i;
-			break;
-		}
+	int stream = FindFreeStream();
+	if (stream == -1 && !Ambient) {
+		// a movie's soundtrack is worth more than any effect
+		stream = StealStream(PRIORITY_MOVIE, 0);
 	}
 	if (stream == -1) {
 		Log(ERROR, "OpenAL", "No available audio streams out of %d", num_streams);
@@ -789,6 +887,10 @@ int OpenALAudioDriver::SetupNewStream( ieWord x, ieWord y, ieWord z,
 	streams[stream].free = false;
 	streams[stream].ambient = Ambient;
 	streams[stream].locked = true;
+	streams[stream].priority = Ambient ? 0 : PRIORITY_MOVIE;
+	streams[stream].relative = !point;
+	streams[stream].XPos = x;
+	streams[stream].YPos = y;
 
 	return stream;
 }
@@ -841,53 +943,130 @@ void OpenALAudioDriver::SetAmbientStreamPitch(int stream, int pitch)
 	checkALError("Unable to set ambient pitch", WARNING);
 }
 
-bool OpenALAudioDriver::evictBuffer()
+// deletes the buffer unless it is still attached to a source
+bool OpenALAudioDriver::dropBuffer(LRUCache<CacheEntry>::Entry* e)
 {
-	// Note: this function assumes the caller holds bufferMutex
+	alDeleteBuffers(1, &e->value.Buffer);
+	if (alGetError() != AL_NO_ERROR) {
+		return false;
+	}
+	cacheBytes -= e->value.Size;
+	MemoryStats::Remove(MEM_SOUNDS, e->value.Size);
+	cacheEvictions++;
+	buffercache.Remove(e);
+	return true;
+}
 
-	// Room for optimization: this is O(n^2) in the number of buffers
-	// at the tail that are used. It can be O(n) if LRUCache supports it.
+bool OpenALAudioDriver::evictBuffer()
+{
+	// Note: this function assumes the caller holds bufferMutex.
+	// The most recent buffer is the one just loaded for playing, it is
+	// never dropped.
+
+	// Of the few least recently used buffers, drop the least played one,
+	// so a burst of one-off sounds doesn't push out the footsteps and
+	// clicks. The survivors have their counts halved, so sounds that were
+	// only popular long ago age out eventually.
+	typedef LRUCache<CacheEntry>::Entry Entry;
+	Entry* candidates[EVICTION_CANDIDATES];
+	unsigned int count = 0;
+	Entry* newest = buffercache.Newest();
+	Entry* e = buffercache.Oldest();
+
+	for (; count < EVICTION_CANDIDATES && e != newest; e = e->Newer()) {
+		// keep them ordered by plays, the older first among equals
+		unsigned int i = count++;
+		while (i > 0 && candidates[i - 1]->value.Hits > e->value.Hits) {
+			candidates[i] = candidates[i - 1];
+			i--;
+		}
+		candidates[i] = e;
+	}
 
-	unsigned int n = 0;
-	void* p;
-	const char* k;
-	bool res;
+	for (unsigned int i = 0; i < count; i++) {
+		if (!dropBuffer(candidates[i])) continue;
+		for (unsigned int j = 0; j < count; j++) {
+			if (j != i) candidates[j]->value.Hits >>= 1;
+		}
+		return true;
+	}
 
-	while ((res = buffercache.getLRU(n, k, p)) == true) {
-		CacheEntry* e = (CacheEntry*)p;
-		alDeleteBuffers(1, &e->Buffer);
-		if (alGetError() == AL_NO_ERROR) {
-			// Buffer was unused. An error would have indicated
-			// the buffer was still attached to a source.
+	// all of them are playing, fall back to the more recent ones
+	while (e && e != newest) {
+		Entry* next = e->Newer();
+		if (dropBuffer(e)) {
+			return true;
+		}
+		e = next;
+	}
+	return false;
+}
 
-			delete e;
-			buffercache.Remove(k);
+void OpenALAudioDriver::clearBufferCache(bool force)
+{
+	StackLock l(bufferMutex, "bufferMutex in clearBufferCache()");
+	LRUCache<CacheEntry>::Entry* e = buffercache.Oldest();
+	while (e) {
+		LRUCache<CacheEntry>::Entry* next = e->Newer();
+		alDeleteBuffers(1, &e->value.Buffer);
+		if (force || alGetError() == AL_NO_ERROR) {
+			cacheBytes -= e->value.Size;
+			MemoryStats::Remove(MEM_SOUNDS, e->value.Size);
+			buffercache.Remove(e);
+		}
+		e = next;
+	}
+}
 
-			//print("Removed buffer %s from ACMImp cache", k);
-			break;
+unsigned long OpenALAudioDriver::TrimMemory(int level)
+{
+	StackLock l(bufferMutex, "bufferMutex in TrimMemory()");
+	unsigned long before = cacheBytes;
+
+	if (level >= TRIM_COMPLETE) {
+		// everything that isn't playing right now
+		LRUCache<CacheEntry>::Entry* e = buffercache.Oldest();
+		while (e) {
+			LRUCache<CacheEntry>::Entry* next = e->Newer();
+			dropBuffer(e);
+			e = next;
 		}
-		++n;
+	} else {
+		// down to half the budget, keeping the most played sounds
+		unsigned long target = (cacheBudget ? cacheBudget : cacheBytes) / 2;
+		while (cacheBytes > target && evictBuffer()) ;
 	}
+	return before - cacheBytes;
+}
 
-	return res;
+static bool MorePlayed(const std::pair<unsigned int, std::string> &a, const std::pair<unsigned int, std::string> &b)
+{
+	return a.first > b.first;
 }
 
-void OpenALAudioDriver::clearBufferCache(bool force)
+void OpenALAudioDriver::DumpStats()
 {
-	// Room for optimization: any method of iterating over the buffers
-	// would suffice. It doesn't have to be in LRU-order.
-	void* p;
-	const char* k;
-	int n = 0;
-	while (buffercache.getLRU(n, k, p)) {
-		CacheEntry* e = (CacheEntry*)p;
-		alDeleteBuffers(1, &e->Buffer);
-		if (force || alGetError() == AL_NO_ERROR) {
-			delete e;
-			buffercache.Remove(k);
-		} else
-			++n;
+	StackLock l(bufferMutex, "bufferMutex in DumpStats()");
+
+	std::vector<std::pair<unsigned int, std::string> > played;
+	for (LRUCache<CacheEntry>::Entry* e = buffercache.Oldest(); e; e = e->Newer()) {
+		played.push_back(std::make_pair(e->value.Hits, std::string(e->Key())));
+	}
+	std::sort(played.begin(), played.end(), MorePlayed);
+
+	StringBuffer buffer;
+	unsigned long lookups = cacheHits + cacheMisses;
+	buffer.appendFormatted("%u sounds in %lu KB of %lu KB", buffercache.GetCount(), cacheBytes / 1024, cacheBudget / 1024);
+	buffer.appendFormatted("\n%lu hits, %lu misses (%.1f%% hit rate), %lu evictions", cacheHits, cacheMisses,
+		lookups ? cacheHits * 100.0 / lookups : 0.0, cacheEvictions);
+	for (size_t i = 0; i < played.size() && i < 10; i++) {
+		buffer.appendFormatted("\n%-8s %6u", played[i].second.c_str(), played[i].first);
 	}
+	buffer.appendFormatted("\nUnderruns: %lu music (%d buffers of %d bytes), %lu other streams",
+		musicUnderruns, MUSICBUFFERS, ACM_BUFFERSIZE, streamUnderruns);
+	buffer.appendFormatted("\nSources: %d streams, %lu sounds took the source of a less important one, %lu were dropped",
+		num_streams, streamSteals, streamsDenied);
+	Log(MESSAGE, "OpenAL", buffer);
 }
 
 ALenum OpenALAudioDriver::GetFormatEnum(int channels, int bits)
@@ -964,6 +1143,7 @@ int OpenALAudioDriver::MusicManager(void* arg)
 					break;
 				case AL_STOPPED:
 					Log(MESSAGE, "OpenAL", "WARNING: Buffer Underrun. AutoRestarting Stream Playback");
+					driver->musicUnderruns++;
 					if (driver->MusicSource && alIsSource( driver->MusicSource )) {
 						alSourcePlay( driver->MusicSource );
 						checkALError("Error playing music source", ERROR);
@@ -1031,13 +1211,19 @@ void OpenALAudioDriver::QueueBuffer(int stream, unsigned short bits,
 		        int channels, short* memory,
 		        int size, int samplerate)
 {
-	streams[stream].delete_buffers = true;
-	streams[stream].ClearProcessedBuffers();
+	AudioStream &s = streams[stream];
+	s.delete_buffers = true;
+	s.ClearProcessedBuffers();
 
 	ALuint Buffer;
-	alGenBuffers(1, &Buffer);
-	if (checkALError("Unable to create buffer", ERROR)) {
-		return;
+	if (!s.spareBuffers.empty()) {
+		Buffer = s.spareBuffers.back();
+		s.spareBuffers.pop_back();
+	} else {
+		alGenBuffers(1, &Buffer);
+		if (checkALError("Unable to create buffer", ERROR)) {
+			return;
+		}
 	}
 
 	alBufferData(Buffer, GetFormatEnum(channels, bits), memory, size, samplerate);
@@ -1046,7 +1232,15 @@ void OpenALAudioDriver::QueueBuffer(int stream, unsigned short bits,
 		return;
 	}
 
-	QueueALBuffer(streams[stream].Source, Buffer);
+	// the movie chunks should follow each other without a gap, so a
+	// source that has stopped ran out before this one came
+	ALint state;
+	alGetSourcei(s.Source, AL_SOURCE_STATE, &state);
+	if (!checkALError("Unable to query source state", WARNING) && state == AL_STOPPED) {
+		streamUnderruns++;
+	}
+
+	QueueALBuffer(s.Source, Buffer);
 }
 
 // !!!!!!!!!!!!!!!
@@ -1061,7 +1255,7 @@ int OpenALAudioDriver::QueueALBuffer(ALuint source, ALuint buffer)
 	alGetBufferi(buffer, AL_BITS, &bits);
 	alGetBufferi(buffer, AL_CHANNELS, &channels);
 	checkALError("Error querying buffer properties.", WARNING);
-	Log(DEBUG, "OpenAL", "Attempting to buffer audio source:%d\nFrequency:%d\nBits:%d\nChannels:%d",
+	LogDebug("OpenAL", "Attempting to buffer audio source:%d\nFrequency:%d\nBits:%d\nChannels:%d",
 		source, frequency, bits, channels);
 #endif
 	ALint type;
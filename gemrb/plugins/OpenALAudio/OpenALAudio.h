@@ -37,6 +37,8 @@
 
 #include <SDL.h>
 
+#include <vector>
+
 #ifndef WIN32
 #ifdef __APPLE_CC__
 #include <OpenAL/al.h>
@@ -65,7 +67,7 @@
 #endif
 
 #define RETRY 5
-#define BUFFER_CACHE_SIZE 100
+#define EVICTION_CANDIDATES 8
 #define MAX_STREAMS 30
 #define MUSICBUFFERS 10
 #define REFERENCE_DISTANCE 50
@@ -73,6 +75,12 @@
 
 #define LISTENER_HEIGHT 100.0f
 
+// which sounds may take the source of another when none is free;
+// speech has its own and ambients and movies keep theirs while locked
+#define PRIORITY_SFX 1 // positioned in the area, eg. combat
+#define PRIORITY_UI 2 // relative to the listener
+#define PRIORITY_MOVIE 3
+
 namespace GemRB {
 
 class OpenALSoundHandle : public SoundHandle {
@@ -90,7 +98,8 @@ public:
 };
 
 struct AudioStream {
-	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false) { }
+	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false),
+		priority(0), relative(false), XPos(0), YPos(0) { }
 
 	ALuint Buffer;
 	ALuint Source;
@@ -99,9 +108,15 @@ struct AudioStream {
 	bool ambient;
 	bool locked;
 	bool delete_buffers;
+	int priority;
+	bool relative;
+	int XPos, YPos;
+	// played buffers of a stream that owns them, kept for the next QueueBuffer
+	std::vector<ALuint> spareBuffers;
 
 	void ClearIfStopped();
 	void ClearProcessedBuffers();
+	void DeleteSpareBuffers();
 	void ForceClear();
 
 	Holder<OpenALSoundHandle> handle;
@@ -110,6 +125,8 @@ struct AudioStream {
 struct CacheEntry {
 	ALuint Buffer;
 	unsigned int Length;
+	unsigned int Size; // bytes of decoded samples
+	unsigned int Hits; // plays, halved whenever it survives an eviction
 };
 
 class OpenALAudioDriver : public Audio {
@@ -140,6 +157,8 @@ public:
 				int channels, short* memory,
 				int size, int samplerate);
 	void UpdateMapAmbient(MapReverb&);
+	void DumpStats();
+	unsigned long TrimMemory(int level);
 private:
 	int QueueALBuffer(ALuint source, ALuint buffer);
 
@@ -150,13 +169,23 @@ private:
 	SDL_mutex* musicMutex;
 	ALuint MusicBuffer[MUSICBUFFERS];
 	Holder<SoundMgr> MusicReader;
-	LRUCache buffercache;
+	LRUCache<CacheEntry> buffercache;
+	SDL_mutex* bufferMutex;
+	unsigned long cacheBytes, cacheBudget;
+	unsigned long cacheHits, cacheMisses, cacheEvictions;
+	// times the music or a queued stream had played all its buffers
+	unsigned long musicUnderruns, streamUnderruns;
 	AudioStream speech;
 	AudioStream streams[MAX_STREAMS];
 	ALuint loadSound(const char* ResRef, unsigned int &time_length);
 	int num_streams;
+	int FindFreeStream();
+	int StealStream(int priority, double distance);
+	double GetListenerDistance(int XPos, int YPos, bool relative);
+	unsigned long streamSteals, streamsDenied;
 	int CountAvailableSources(int limit);
 	bool evictBuffer();
+	bool dropBuffer(LRUCache<CacheEntry>::Entry* e);
 	void clearBufferCache(bool force);
 	ALenum GetFormatEnum(int channels, int bits);
 	static int MusicManager(void* args);
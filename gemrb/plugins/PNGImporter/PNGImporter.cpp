@@ -60,6 +60,7 @@ PNGImporter::PNGImporter(void)
 	inf->end_info = 0;
 	Width = Height = 0;
 	hasPalette = false;
+	buffer = NULL;
 }
 
 PNGImporter::~PNGImporter(void)
@@ -70,6 +71,8 @@ PNGImporter::~PNGImporter(void)
 
 void PNGImporter::Close()
 {
+	free(buffer);
+	buffer = NULL;
 	if (inf) {
 		if (inf->png_ptr) {
 			png_destroy_read_struct(&inf->png_ptr, &inf->info_ptr,
@@ -154,10 +157,14 @@ bool PNGImporter::Open(DataStream* stream)
 	return true;
 }
 
-Sprite2D* PNGImporter::GetSprite2D()
+bool PNGImporter::Decode()
 {
-	Sprite2D* spr = 0;
-	unsigned char* buffer = 0;
+	if (buffer) {
+		return true;
+	}
+	if (!inf->png_ptr) {
+		return false;
+	}
 	png_bytep* row_pointers = new png_bytep[Height];
 	buffer = (unsigned char *) malloc((hasPalette?1:4)*Width*Height);
 	for (unsigned int i = 0; i < Height; ++i)
@@ -166,8 +173,9 @@ Sprite2D* PNGImporter::GetSprite2D()
 	if (setjmp(png_jmpbuf(inf->png_ptr))) {
 		delete[] row_pointers;
 		free( buffer );
+		buffer = NULL;
 		png_destroy_read_struct(&inf->png_ptr, &inf->info_ptr, &inf->end_info);
-		return NULL;
+		return false;
 	}
 
 	png_read_image(inf->png_ptr, row_pointers);
@@ -177,6 +185,15 @@ Sprite2D* PNGImporter::GetSprite2D()
 
 	// the end_info struct isn't used, but passing it anyway for now
 	png_read_end(inf->png_ptr, inf->end_info);
+	return true;
+}
+
+Sprite2D* PNGImporter::GetSprite2D()
+{
+	Sprite2D* spr = 0;
+	if (!Decode()) {
+		return NULL;
+	}
 
 	if (hasPalette) {
 		Color pal[256];
@@ -189,6 +206,8 @@ Sprite2D* PNGImporter::GetSprite2D()
 												   blue_mask, alpha_mask,
 												   buffer, false, 0);
 	}
+	// the sprite owns the pixels now
+	buffer = NULL;
 
 	png_destroy_read_struct(&inf->png_ptr, &inf->info_ptr, &inf->end_info);
 
@@ -33,11 +33,14 @@ private:
 
 	ieDword Width, Height;
 	bool hasPalette;
+	// the pixels read by Decode, until a sprite takes them
+	unsigned char* buffer;
 public:
 	PNGImporter(void);
 	~PNGImporter(void);
 	void Close();
 	bool Open(DataStream* stream);
+	bool Decode();
 	Sprite2D* GetSprite2D();
 	void GetPalette(int colors, Color* pal);
 	int GetWidth() { return (int) Width; }
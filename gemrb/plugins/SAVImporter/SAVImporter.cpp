@@ -24,9 +24,181 @@
 #include "FileCache.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "SaveExtractor.h"
+#include "System/FileStream.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
+
+#include <ctime>
+#include <map>
+#include <sys/stat.h>
 
 using namespace GemRB;
 
+// a file compressed ahead of its turn to be written
+struct SaveMember {
+	std::string path;
+	DataStream *source; // if it was read ahead, otherwise path is opened
+	char filename[16];
+	ieDword declen;
+	time_t mtime;
+	time_t read; // when the contents were taken
+	DataStream *compressed;
+	bool reused;
+	bool done;
+};
+
+// the members of the last save game written or loaded, by lowercase name
+// a file not modified since it was stored can be written as it is
+struct StoredMember {
+	ieDword declen;
+	time_t mtime;
+	time_t stored;
+	DataStream *compressed;
+};
+
+typedef std::map<std::string, StoredMember> StoredMembers;
+static StoredMembers stored;
+
+static std::string MemberKey(const char *filename)
+{
+	char key[16];
+	strlcpy(key, filename, sizeof(key));
+	strlwr(key);
+	return key;
+}
+
+static void ReleaseStored(StoredMembers &members)
+{
+	StoredMembers::iterator it;
+	for (it = members.begin(); it != members.end(); ++it) {
+		delete it->second.compressed;
+	}
+	members.clear();
+}
+
+static void StoreMember(StoredMembers &members, const char *filename, ieDword declen, time_t mtime, time_t now, DataStream *compressed)
+{
+	StoredMember &member = members[MemberKey(filename)];
+	if (member.compressed != compressed) {
+		delete member.compressed;
+	}
+	member.declen = declen;
+	member.mtime = mtime;
+	member.stored = now;
+	member.compressed = compressed;
+}
+
+static bool GetFileStamp(const char *path, ieDword &size, time_t &mtime)
+{
+	struct stat buf;
+	if (stat(path, &buf) < 0) {
+		return false;
+	}
+	size = (ieDword) buf.st_size;
+	mtime = buf.st_mtime;
+	return true;
+}
+
+// a write in the same second as the last one wouldn't show in the stamp,
+// so only members stored at least a second after their last change count
+static bool IsUnchanged(const StoredMember &member, ieDword size, time_t mtime)
+{
+	return size == member.declen && mtime == member.mtime && mtime < member.stored;
+}
+
+struct SaveBatch {
+	const Compressor *comp;
+	std::vector<SaveMember> members;
+	size_t next;
+	Mutex lock;
+	ConditionVariable finished;
+};
+
+// zlib's compressBound, deflate never needs more
+static unsigned long CompressBound(unsigned long size)
+{
+	return size + (size >> 12) + (size >> 14) + (size >> 25) + 13;
+}
+
+static void CompressMember(const Compressor *comp, SaveMember &member)
+{
+	FileStream fs;
+	DataStream *in = member.source;
+	if (!in) {
+		if (!fs.Open(member.path.c_str())) {
+			return;
+		}
+		in = &fs;
+	}
+	member.declen = in->Size();
+	unsigned long bound = CompressBound(member.declen);
+	MemoryStream out(member.filename, malloc(bound), bound);
+	if (comp->Compress(&out, in) != GEM_OK) {
+		return;
+	}
+	// kept for the next save, so don't hold on to the slack
+	unsigned long complen = out.GetPos();
+	void *data = malloc(complen);
+	out.Seek(0, GEM_STREAM_START);
+	out.Read(data, complen);
+	member.compressed = new MemoryStream(member.filename, data, complen);
+}
+
+// returns false once every member was taken
+static bool CompressNext(SaveBatch &batch)
+{
+	size_t i;
+	{
+		MutexLock l(batch.lock);
+		while (batch.next < batch.members.size() && batch.members[batch.next].done) {
+			batch.next++;
+		}
+		if (batch.next == batch.members.size()) {
+			return false;
+		}
+		i = batch.next++;
+	}
+	CompressMember(batch.comp, batch.members[i]);
+	{
+		MutexLock l(batch.lock);
+		batch.members[i].done = true;
+	}
+	batch.finished.Broadcast();
+	return true;
+}
+
+class SaveCompressionWorker : public Thread {
+public:
+	SaveCompressionWorker(SaveBatch &batch) : batch(batch) {}
+protected:
+	void Run()
+	{
+		while (CompressNext(batch)) {}
+	}
+private:
+	SaveBatch &batch;
+};
+
+static void WriteMember(DataStream *str, const char *filename, ieDword declen, DataStream *compressed)
+{
+	ieDword fnlen = strlen(filename)+1;
+	ieDword complen = compressed->Size();
+	str->WriteDword( &fnlen);
+	str->Write( filename, fnlen);
+	str->WriteDword( &declen);
+	str->WriteDword( &complen);
+
+	char buffer[8192];
+	compressed->Seek(0, GEM_STREAM_START);
+	while (complen) {
+		unsigned int chunk = complen < sizeof(buffer) ? complen : (unsigned int) sizeof(buffer);
+		compressed->Read(buffer, chunk);
+		str->Write(buffer, chunk);
+		complen -= chunk;
+	}
+}
+
 SAVImporter::SAVImporter()
 {
 }
@@ -35,6 +207,16 @@ SAVImporter::~SAVImporter()
 {
 }
 
+//starting at 20% going up to 70%
+static void ReportProgress(DataStream *compressed, int All, int &last_percent)
+{
+	int percent = 20 + (All - compressed->Remains()) * 50 / All;
+	if (percent - last_percent > 5) {
+		core->LoadProgress(percent);
+		last_percent = percent;
+	}
+}
+
 int SAVImporter::DecompressSaveGame(DataStream *compressed)
 {
 	char Signature[8];
@@ -43,9 +225,14 @@ int SAVImporter::DecompressSaveGame(DataStream *compressed)
 		return GEM_ERROR;
 	}
 	int All = compressed->Remains();
-	int Current;
-	int percent, last_percent = 20;
+	int last_percent = 20;
 	if (!All) return GEM_ERROR;
+	// the cache is refilled from this save, nothing else can be reused
+	// and the pending members of the last one point into the stored copies
+	SaveExtractor *extractor = core->GetSaveExtractor();
+	extractor->Clear();
+	ReleaseStored(stored);
+	time_t now = time(NULL);
 	do {
 		ieDword fnlen, complen, declen;
 		compressed->ReadDword( &fnlen );
@@ -58,21 +245,43 @@ int SAVImporter::DecompressSaveGame(DataStream *compressed)
 		strlwr(fname);
 		compressed->ReadDword( &declen );
 		compressed->ReadDword( &complen );
+		// keep the member around, the next save can write it back as it is
+		void *data = malloc(complen);
+		if (compressed->Read(data, complen) != (int) complen) {
+			free(data);
+			free(fname);
+			return GEM_ERROR;
+		}
+		DataStream *member = new MemoryStream(fname, data, complen);
+		// most members are only expanded once something looks for them
+		char path[_MAX_PATH];
+		PathJoin(path, core->CachePath, fname, NULL);
+		if (extractor->Add(path, member)) {
+			// the file isn't there yet, so the next save compresses it anew
+			StoreMember(stored, fname, declen, 0, now, member);
+			free(fname);
+			ReportProgress(compressed, All, last_percent);
+			continue;
+		}
 		print("Decompressing %s", fname);
-		DataStream* cached = CacheCompressedStream(compressed, fname, complen, true);
-		free( fname );
-		if (!cached)
+		DataStream* cached = CacheCompressedStream(member, fname, complen, true);
+		if (!cached) {
+			delete member;
+			free(fname);
 			return GEM_ERROR;
-		delete cached;
-		Current = compressed->Remains();
-		//starting at 20% going up to 70%
-		percent = (20 + (All - Current) * 50 / All);
-		if (percent - last_percent > 5) {
-			core->LoadProgress(percent);
-			last_percent = percent;
 		}
+		ieDword size;
+		time_t mtime;
+		if (GetFileStamp(cached->originalfile, size, mtime) && size == declen) {
+			StoreMember(stored, fname, declen, mtime, now, member);
+		} else {
+			delete member;
+		}
+		free( fname );
+		delete cached;
+		ReportProgress(compressed, All, last_percent);
 	}
-	while(Current);
+	while(compressed->Remains());
 	return GEM_OK;
 }
 
@@ -117,8 +326,146 @@ int SAVImporter::AddToSaveGame(DataStream *str, DataStream *uncompressed)
 	return GEM_OK;
 }
 
+// takes the stored copy of a member that didn't change since
+// returns false if it has to be compressed
+static bool ReuseMember(SaveMember &member, ieDword size)
+{
+	StoredMembers::iterator it = stored.find(MemberKey(member.filename));
+	if (!member.mtime || it == stored.end() || !IsUnchanged(it->second, size, member.mtime)) {
+		return false;
+	}
+	member.declen = it->second.declen;
+	member.compressed = it->second.compressed;
+	member.reused = true;
+	member.done = true;
+	return true;
+}
+
+// every member is compressed on its own, so they can be done in parallel,
+// only the writes have to keep the order
+static void WriteBatch(DataStream *str, SaveBatch &batch, size_t pending, ArchiveProgress *progress)
+{
+	// this thread helps too
+	unsigned int threads = Thread::GetProcessorCount();
+	if (threads > pending) {
+		threads = (unsigned int) pending;
+	}
+	std::vector<SaveCompressionWorker *> workers;
+	for (unsigned int i = 1; i < threads; i++) {
+		SaveCompressionWorker *worker = new SaveCompressionWorker(batch);
+		if (!worker->Start()) {
+			delete worker;
+			break;
+		}
+		workers.push_back(worker);
+	}
+
+	StoredMembers kept;
+	for (size_t i = 0; i < batch.members.size(); i++) {
+		SaveMember &member = batch.members[i];
+		bool done;
+		do {
+			MutexLock l(batch.lock);
+			done = member.done;
+		} while (!done && CompressNext(batch));
+		{
+			MutexLock l(batch.lock);
+			while (!member.done) {
+				batch.finished.Wait(batch.lock);
+			}
+		}
+		if (member.compressed) {
+			WriteMember(str, member.filename, member.declen, member.compressed);
+			if (member.reused) {
+				stored.erase(MemberKey(member.filename));
+			}
+			StoreMember(kept, member.filename, member.declen, member.mtime, member.read, member.compressed);
+		} else {
+			Log(ERROR, "SAVImporter", "Failed to compress \"%s\".", member.path.c_str());
+		}
+		delete member.source;
+		member.source = NULL;
+		if (progress) {
+			progress->Progress((int) ((i + 1) * 100 / batch.members.size()));
+		}
+	}
+
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i]->Join();
+		delete workers[i];
+	}
+	// whatever wasn't part of this save is gone from the cache
+	ReleaseStored(stored);
+	stored.swap(kept);
+}
+
+static void InitMember(SaveMember &member, const char *path, const char *filename, DataStream *source, time_t read)
+{
+	member.path = path;
+	member.source = source;
+	strlcpy(member.filename, filename, sizeof(member.filename));
+	member.mtime = 0;
+	member.read = read;
+	member.compressed = NULL;
+	member.reused = false;
+	member.done = false;
+}
+
+int SAVImporter::AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &files)
+{
+	SaveBatch batch;
+	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
+	// the plugin is stateless, so one instance serves all the threads
+	batch.comp = comp.get();
+	batch.next = 0;
+	batch.members.resize(files.size());
+	time_t now = time(NULL);
+	size_t pending = 0;
+	for (size_t i = 0; i < files.size(); i++) {
+		SaveMember &member = batch.members[i];
+		char filename[_MAX_PATH];
+		ExtractFileFromPath(filename, files[i].c_str());
+		InitMember(member, files[i].c_str(), filename, NULL, now);
+
+		ieDword size;
+		// failures are left for CompressMember to report
+		if (!GetFileStamp(member.path.c_str(), size, member.mtime) || !ReuseMember(member, size)) {
+			pending++;
+		}
+	}
+	WriteBatch(str, batch, pending, NULL);
+	return GEM_OK;
+}
+
+int SAVImporter::AddMembersToSaveGame(DataStream *str, const std::vector<ArchiveMember> &members, ArchiveProgress *progress)
+{
+	SaveBatch batch;
+	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
+	batch.comp = comp.get();
+	batch.next = 0;
+	batch.members.resize(members.size());
+	size_t pending = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		SaveMember &member = batch.members[i];
+		DataStream *stream = members[i].stream;
+		InitMember(member, stream->originalfile, stream->filename, stream, members[i].read);
+		member.mtime = members[i].mtime;
+		if (!ReuseMember(member, stream->Size())) {
+			pending++;
+		}
+	}
+	WriteBatch(str, batch, pending, progress);
+	return GEM_OK;
+}
+
 #include "plugindef.h"
 
+static void ReleaseMemory()
+{
+	ReleaseStored(stored);
+}
+
 GEMRB_PLUGIN(0xCDF132C, "SAV File Importer")
 PLUGIN_CLASS(IE_SAV_CLASS_ID, SAVImporter)
+PLUGIN_CLEANUP(ReleaseMemory)
 END_PLUGIN()
@@ -35,6 +35,8 @@ public:
 	~SAVImporter(void);
 	int DecompressSaveGame(DataStream *compressed);
 	int AddToSaveGame(DataStream *str, DataStream *uncompressed);
+	int AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &files);
+	int AddMembersToSaveGame(DataStream *str, const std::vector<ArchiveMember> &members, ArchiveProgress *progress);
 	int CreateArchive(DataStream *compressed);
 };
 
@@ -33,6 +33,52 @@
 
 using namespace GemRB;
 
+// frames resampled per block, so the inner loops stay in the cache
+#define RESAMPLE_BLOCK 256
+
+// maps interleaved 16 bit frames from one channel count to another (1 or 2)
+static void MapChannels(const short* in, short* out, int frames, int inChannels, int outChannels)
+{
+	int i;
+	if (inChannels == outChannels) {
+		memcpy(out, in, frames * inChannels * sizeof(short));
+	} else if (inChannels == 1) {
+		for (i = 0; i < frames; i++) {
+			out[2 * i] = out[2 * i + 1] = in[i];
+		}
+	} else {
+		for (i = 0; i < frames; i++) {
+			out[i] = (short) ((in[2 * i] + in[2 * i + 1]) >> 1);
+		}
+	}
+}
+
+// resamples interleaved frames in 16.16 fixed point steps, interpolating
+// linearly unless fast is set, then it takes the nearest earlier sample
+static void Resample(const short* in, int inFrames, short* out, int outFrames, int channels, unsigned int step, bool fast)
+{
+	int last = inFrames - 1;
+	for (int start = 0; start < outFrames; start += RESAMPLE_BLOCK) {
+		int end = start + RESAMPLE_BLOCK < outFrames ? start + RESAMPLE_BLOCK : outFrames;
+		for (int c = 0; c < channels; c++) {
+			const short* src = in + c;
+			short* dst = out + c;
+			for (int i = start; i < end; i++) {
+				unsigned long pos = (unsigned long) i * step;
+				int idx = (int) (pos >> 16);
+				int s0 = src[idx * channels];
+				if (fast) {
+					dst[i * channels] = (short) s0;
+					continue;
+				}
+				int s1 = src[(idx < last ? idx + 1 : last) * channels];
+				int frac = (int) (pos & 0xffff);
+				dst[i * channels] = (short) (s0 + (((s1 - s0) * frac) >> 16));
+			}
+		}
+	}
+}
+
 SDLAudio::SDLAudio(void)
 {
 	XPos = 0;
@@ -164,19 +210,17 @@ Holder<SoundHandle> SDLAudio::Play(const char* ResRef, int XPos, int YPos, unsig
 	}
 
 	// convert our buffer, if necessary
-	SDL_AudioCVT cvt;
-	SDL_BuildAudioCVT(&cvt, AUDIO_S16SYS, riff_chans, samplerate,
-			audio_format, audio_channels, audio_rate);
-	cvt.buf = (Uint8*)malloc(cnt1*cvt.len_mult);
-	memcpy(cvt.buf, (char*)memory, cnt1);
-	cvt.len = cnt1;
-	SDL_ConvertAudio(&cvt);
+	unsigned int size = cnt1;
+	char *buf = ConvertSamples(memory, 16, riff_chans, samplerate, size);
 
 	// free old buffer
 	free(memory);
+	if (!buf) {
+		return Holder<SoundHandle>();
+	}
 
 	// make SDL_mixer chunk
-	Mix_Chunk *chunk = Mix_QuickLoad_RAW(cvt.buf, cvt.len*cvt.len_ratio);
+	Mix_Chunk *chunk = Mix_QuickLoad_RAW((Uint8 *) buf, size);
 	if (!chunk) {
 		print("error loading chunk");
 		return Holder<SoundHandle>();
@@ -196,7 +240,7 @@ Holder<SoundHandle> SDLAudio::Play(const char* ResRef, int XPos, int YPos, unsig
 	}
 
 	assert((unsigned int)channel < channel_data.size());
-	channel_data[channel] = cvt.buf;
+	channel_data[channel] = buf;
 	SDL_mutexV(OurMutex);
 
 	// TODO
@@ -270,8 +314,7 @@ void SDLAudio::buffer_callback(void *udata, char *stream, int len) {
 			memcpy(stream, driver->buffers[0].buf + driver->curr_buffer_offset, avail);
 			driver->curr_buffer_offset = 0;
 			free(driver->buffers[0].buf);
-			// TODO: inefficient
-			driver->buffers.erase(driver->buffers.begin());
+			driver->buffers.pop_front();
 		}
 		remaining -= avail;
 		stream = stream + avail;
@@ -331,6 +374,45 @@ bool SDLAudio::ReleaseStream(int stream, bool HardStop)
 	return true;
 }
 
+/* returns a new buffer with the samples in the mixer's format, NULL on
+ * failure; size is the byte count, in and out.
+ * 16 bit mono and stereo go through our own loops, which the compiler
+ * can vectorize, everything else through SDL's converter
+ */
+char* SDLAudio::ConvertSamples(short* memory, int bits, int channels, int samplerate, unsigned int &size)
+{
+	if (bits == 16 && audio_format == AUDIO_S16SYS && channels >= 1 && channels <= 2 &&
+			audio_channels >= 1 && audio_channels <= 2 && samplerate > 0) {
+		int frames = size / (2 * channels);
+		int outFrames = (int) ((double) frames * audio_rate / samplerate);
+		short* mapped = (short *) malloc(frames * audio_channels * sizeof(short));
+		MapChannels(memory, mapped, frames, channels, audio_channels);
+		if (samplerate == audio_rate || !frames) {
+			size = frames * audio_channels * sizeof(short);
+			return (char *) mapped;
+		}
+
+		short* out = (short *) malloc(outFrames * audio_channels * sizeof(short));
+		unsigned int step = (unsigned int) (((unsigned long long) samplerate << 16) / audio_rate);
+		Resample(mapped, frames, out, outFrames, audio_channels, step, core->FastResampler != 0);
+		free(mapped);
+		size = outFrames * audio_channels * sizeof(short);
+		return (char *) out;
+	}
+
+	SDL_AudioCVT cvt;
+	if (SDL_BuildAudioCVT(&cvt, (bits == 8 ? AUDIO_S8 : AUDIO_S16SYS), channels, samplerate,
+			audio_format, audio_channels, audio_rate) < 0) {
+		return NULL;
+	}
+	cvt.buf = (Uint8*)malloc(size*cvt.len_mult);
+	memcpy(cvt.buf, memory, size);
+	cvt.len = size;
+	SDL_ConvertAudio(&cvt);
+	size = (unsigned int) (cvt.len*cvt.len_ratio);
+	return (char *) cvt.buf;
+}
+
 void SDLAudio::FreeBuffers()
 {
 	SDL_mutexP(OurMutex);
@@ -361,27 +443,12 @@ void SDLAudio::QueueBuffer(int stream, unsigned short bits,
 	assert(!MusicPlaying);
 
 	BufferedData d;
-
-	// convert our buffer, if necessary
-	if (bits != 16 || channels != audio_channels || samplerate != audio_rate) {
-		SDL_AudioCVT cvt;
-		if (SDL_BuildAudioCVT(&cvt, (bits == 8 ? AUDIO_S8 : AUDIO_S16SYS), channels, samplerate,
-				audio_format, audio_channels, audio_rate) == 0) {
-			Log(ERROR, "SDLAudio", "Couldn't convert video stream! trying to convert %d bits, %d channels, %d rate",
-				bits, channels, samplerate);
-			return;
-		}
-		cvt.buf = (Uint8*)malloc(size*cvt.len_mult);
-		memcpy(cvt.buf, memory, size);
-		cvt.len = size;
-		SDL_ConvertAudio(&cvt);
-
-		d.size = cvt.len*cvt.len_ratio;
-		d.buf = (char *)cvt.buf;
-	} else {
-		d.size = size;
-		d.buf = (char *)malloc(d.size);
-		memcpy(d.buf, memory, d.size);
+	d.size = size;
+	d.buf = ConvertSamples(memory, bits, channels, samplerate, d.size);
+	if (!d.buf) {
+		Log(ERROR, "SDLAudio", "Couldn't convert video stream! trying to convert %d bits, %d channels, %d rate",
+			bits, channels, samplerate);
+		return;
 	}
 
 	SDL_mutexP(OurMutex);
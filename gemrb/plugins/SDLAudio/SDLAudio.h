@@ -23,6 +23,7 @@
 
 #include "Audio.h"
 
+#include <deque>
 #include <vector>
 
 struct SDL_mutex;
@@ -61,6 +62,7 @@ public:
 
 private:
 	void FreeBuffers();
+	char* ConvertSamples(short* memory, int bits, int channels, int samplerate, unsigned int &size);
 
 	static void music_callback(void *udata, unsigned short *stream, int len);
 	static void buffer_callback(void *udata, char *stream, int len);
@@ -73,7 +75,7 @@ private:
 
 	bool MusicPlaying;
 	unsigned int curr_buffer_offset;
-	std::vector<BufferedData> buffers;
+	std::deque<BufferedData> buffers;
 
 	int audio_rate;
 	unsigned short audio_format;
@@ -8,175 +8,207 @@
 
 using namespace GemRB;
 
-GLuint GLPaletteManager::CreatePaletteTexture(Palette* palette, unsigned int colorKey, bool attached)
+unsigned int GLPaletteManager::HashColors(const Color* colors)
 {
-	const PaletteKey key(palette, colorKey);
-	std::map<PaletteKey, GLuint, PaletteKey> *currentTextures;
-	std::map<GLuint, PaletteKey> *currentIndexes;
-	if (attached)
+	// FNV-1a over the bytes
+	const unsigned char* bytes = (const unsigned char*) colors;
+	unsigned int hash = 2166136261U;
+	for (unsigned int i=0; i<sizeof(Color)*256; i++)
 	{
-		currentTextures = &a_textures;
-		currentIndexes = &a_indexes;
-	}
-	else
-	{
-		currentTextures = &textures;
-		currentIndexes = &indexes;
+		hash = (hash ^ bytes[i]) * 16777619U;
 	}
+	return hash;
+}
 
-	if (currentTextures->find(key) == currentTextures->end())
-	{
-		// not found, we need to create it
-		GLuint texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		Color* colors = new Color[256];
-		memcpy(colors, palette->col, sizeof(Color)*256);
-		if (!palette->alpha)
-		{
-			for (unsigned int i=0; i<256; i++)
-			{
-				colors[i].a = 0xFF;
-			}
-		}
-		if (PALETTE_INVALID_INDEX != colorKey) {
-			colors[colorKey].a = 0;
-		}
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+void GLPaletteManager::Grow()
+{
+	unsigned int oldCount = rowCount;
+	rowCount = rowCount ? rowCount*2 : PALETTE_ROWS;
+	colors.resize(rowCount*256);
+	rowUsers.resize(rowCount, 0);
+	// hand out the first rows first
+	for (unsigned int row = rowCount; row > oldCount; row--)
+	{
+		freeRows.push_back(row - 1);
+	}
+
+	// the rows keep their place, so only the texture changes
+	if (texture != 0) glDeleteTextures(1, &texture);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 #ifdef USE_GL
-		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 #endif
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) colors);
-		delete[] colors;
-		palette->acquire();
-		currentTextures->insert(std::make_pair(key, texture));
-		currentIndexes->insert(std::make_pair(texture, key));
-	}
-	return currentTextures->at(key);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, rowCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) &colors[0]);
 }
 
-void GLPaletteManager::RemovePaletteTexture(Palette* palette, unsigned int colorKey, bool attached)
+unsigned int GLPaletteManager::AcquireRow(const Color* rowColors)
 {
-	const PaletteKey key(palette, colorKey);
-
-	std::map<PaletteKey, GLuint, PaletteKey> *currentTextures;
-	std::map<GLuint, PaletteKey> *currentIndexes;
-	if (attached)
+	unsigned int hash = HashColors(rowColors);
+	std::multimap<unsigned int, unsigned int>::iterator it = rowsByHash.lower_bound(hash);
+	for (; it != rowsByHash.end() && it->first == hash; ++it)
 	{
-		currentTextures = &a_textures;
-		currentIndexes = &a_indexes;
+		if (!memcmp(&colors[it->second*256], rowColors, sizeof(Color)*256))
+		{
+			rowUsers[it->second]++;
+			return it->second;
+		}
 	}
-	else
+
+	if (freeRows.empty())
 	{
-		currentTextures = &textures;
-		currentIndexes = &indexes;
+		Grow();
 	}
+	unsigned int row = freeRows.back();
+	freeRows.pop_back();
+	memcpy(&colors[row*256], rowColors, sizeof(Color)*256);
+	rowUsers[row] = 1;
+	rowsByHash.insert(std::make_pair(hash, row));
 
-	if (currentTextures->find(key) == currentTextures->end())
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+#ifdef USE_GL
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) rowColors);
+	return row;
+}
+
+void GLPaletteManager::ReleaseRow(unsigned int row)
+{
+	if (--rowUsers[row] == 0)
 	{
-		// nothing found
+		// a queued blit may still need it
+		releasedRows.push_back(row);
 	}
-	else
+}
+
+void GLPaletteManager::RecycleRows()
+{
+	for (unsigned int i=0; i<releasedRows.size(); i++)
 	{
-		if (!palette->IsShared())
+		unsigned int row = releasedRows[i];
+		// taken again by the same colors since
+		if (rowUsers[row]) continue;
+
+		unsigned int hash = HashColors(&colors[row*256]);
+		std::multimap<unsigned int, unsigned int>::iterator it = rowsByHash.lower_bound(hash);
+		for (; it != rowsByHash.end() && it->first == hash; ++it)
 		{
-			palette->release();
-			currentIndexes->erase(currentTextures->at(key));
-			glDeleteTextures(1, &(currentTextures->at(key)));
-			currentTextures->erase(key);
+			if (it->second == row)
+			{
+				rowsByHash.erase(it);
+				break;
+			}
 		}
+		freeRows.push_back(row);
 	}
+	releasedRows.clear();
 }
 
-void GLPaletteManager::RemovePaletteTexture(GLuint texture, bool attached)
+unsigned int GLPaletteManager::CreatePaletteTexture(Palette* palette, unsigned int colorKey, bool attached)
 {
-	std::map<PaletteKey, GLuint, PaletteKey> *currentTextures;
-	std::map<GLuint, PaletteKey> *currentIndexes;
-	if (attached)
-	{
-		currentTextures = &a_textures;
-		currentIndexes = &a_indexes;
-	}
-	else
+	const PaletteKey key(palette, colorKey);
+	std::map<PaletteKey, unsigned int, PaletteKey> *currentRows = attached ? &a_rows : &rows;
+
+	if (currentRows->find(key) == currentRows->end())
 	{
-		currentTextures = &textures;
-		currentIndexes = &indexes;
+		// not found, we need to create it
+		Color* rowColors = new Color[256];
+		memcpy(rowColors, palette->col, sizeof(Color)*256);
+		if (!palette->alpha)
+		{
+			for (unsigned int i=0; i<256; i++)
+			{
+				rowColors[i].a = 0xFF;
+			}
+		}
+		if (PALETTE_INVALID_INDEX != colorKey) {
+			rowColors[colorKey].a = 0;
+		}
+		unsigned int row = AcquireRow(rowColors);
+		delete[] rowColors;
+		palette->acquire();
+		currentRows->insert(std::make_pair(key, row));
 	}
+	return currentRows->at(key);
+}
+
+void GLPaletteManager::RemovePaletteTexture(Palette* palette, unsigned int colorKey, bool attached)
+{
+	const PaletteKey key(palette, colorKey);
+	std::map<PaletteKey, unsigned int, PaletteKey> *currentRows = attached ? &a_rows : &rows;
 
-	if (currentIndexes->find(texture) == currentIndexes->end())
+	std::map<PaletteKey, unsigned int, PaletteKey>::iterator it = currentRows->find(key);
+	if (it == currentRows->end())
 	{
 		// nothing found
 	}
 	else
 	{
-		PaletteKey key = currentIndexes->at(texture);
-		if (!key.palette->IsShared())
+		if (!palette->IsShared())
 		{
-			key.palette->release();
-			currentIndexes->erase(texture);
-			glDeleteTextures(1, &texture);
-			currentTextures->erase(key);
+			palette->release();
+			ReleaseRow(it->second);
+			currentRows->erase(it);
 		}
 	}
 }
 
 void GLPaletteManager::ClearUnused(bool attached)
 {
-	std::map<PaletteKey, GLuint, PaletteKey> *currentTextures;
-	std::map<GLuint, PaletteKey> *currentIndexes;
-	if (attached)
-	{
-		currentTextures = &a_textures;
-		currentIndexes = &a_indexes;
-	}
-	else
-	{
-		currentTextures = &textures;
-		currentIndexes = &indexes;
-	}
-	std::map<PaletteKey, GLuint, PaletteKey>::iterator it = currentTextures->begin();
-	while(it != currentTextures->end())
+	std::map<PaletteKey, unsigned int, PaletteKey> *currentRows = attached ? &a_rows : &rows;
+	std::map<PaletteKey, unsigned int, PaletteKey>::iterator it = currentRows->begin();
+	while(it != currentRows->end())
 	{
 		if (!it->first.palette->IsShared())
 		{
 			it->first.palette->release();
-			glDeleteTextures(1, &(currentTextures->at(it->first)));
-			currentIndexes->erase(it->second);
-			currentTextures->erase(it++);
+			ReleaseRow(it->second);
+			currentRows->erase(it++);
 		}
 		else
 		{
 			++it;
 		}
 	}
+	RecycleRows();
 }
 
 void GLPaletteManager::Clear()
 {
-	for(std::map<PaletteKey, GLuint, PaletteKey>::iterator it = textures.begin(); it != textures.end(); ++it)
+	for(std::map<PaletteKey, unsigned int, PaletteKey>::iterator it = rows.begin(); it != rows.end(); ++it)
 	{
 		it->first.palette->release();
-		glDeleteTextures(1, &(textures[it->first]));
 	}
-	textures.clear();
-	indexes.clear();
+	rows.clear();
 
-	for(std::map<PaletteKey, GLuint, PaletteKey>::iterator it = a_textures.begin(); it != a_textures.end(); ++it)
+	for(std::map<PaletteKey, unsigned int, PaletteKey>::iterator it = a_rows.begin(); it != a_rows.end(); ++it)
 	{
 		it->first.palette->release();
-		glDeleteTextures(1, &(a_textures[it->first]));
 	}
-	a_textures.clear();
-	a_indexes.clear();
+	a_rows.clear();
+
+	if (texture != 0) glDeleteTextures(1, &texture);
+	texture = 0;
+	rowCount = 0;
+	colors.clear();
+	rowUsers.clear();
+	rowsByHash.clear();
+	freeRows.clear();
+	releasedRows.clear();
 }
 
 
 GLPaletteManager::GLPaletteManager()
 {
+	rowCount = 0;
+	texture = 0;
 }
 
 GLPaletteManager::~GLPaletteManager()
@@ -2,8 +2,14 @@
 #define GLPALETTEMANAGER_H
 
 #include <map>
+#include <vector>
+
+#include "RGBAColor.h"
 
 #define PALETTE_INVALID_INDEX 256
+#define PALETTE_NO_ROW 0xFFFFFFFFU
+// the palette texture starts out this tall and doubles when full
+#define PALETTE_ROWS 256
 
 namespace GemRB
 {
@@ -13,8 +19,8 @@ namespace GemRB
 	{
 		Palette* palette;
 		unsigned int colorKey;
-		bool operator () (const PaletteKey& lhs, const PaletteKey& rhs) const 
-		{ 
+		bool operator () (const PaletteKey& lhs, const PaletteKey& rhs) const
+		{
 			if (lhs.palette < rhs.palette) return true;
 			else
 			if (rhs.palette < lhs.palette) return false;
@@ -27,24 +33,42 @@ namespace GemRB
 		PaletteKey() {}
 	};
 
+	// all the palettes are rows of one texture, so switching palettes needs no texture switch
+	// palettes with the same colors share their row
 	class GLPaletteManager
 	{
 		private:
 
 			// sprite-owned palettes
-			std::map<PaletteKey, GLuint, PaletteKey> textures;
-			std::map<GLuint, PaletteKey> indexes;
+			std::map<PaletteKey, unsigned int, PaletteKey> rows;
 
 			// attached palettes
-			std::map<PaletteKey, GLuint, PaletteKey> a_textures;
-			std::map<GLuint, PaletteKey> a_indexes;
+			std::map<PaletteKey, unsigned int, PaletteKey> a_rows;
+
+			// the colors of every row, as uploaded
+			std::vector<Color> colors;
+			std::vector<unsigned int> rowUsers;
+			std::multimap<unsigned int, unsigned int> rowsByHash;
+			std::vector<unsigned int> freeRows;
+			// only reused in ClearUnused, once the batched blits are drawn
+			std::vector<unsigned int> releasedRows;
+			unsigned int rowCount;
+			GLuint texture;
+
+			static unsigned int HashColors(const Color* colors);
+			unsigned int AcquireRow(const Color* colors);
+			void ReleaseRow(unsigned int row);
+			void Grow();
+			void RecycleRows();
 
 		public:
-			GLuint CreatePaletteTexture(Palette* palette, unsigned int colorKey, bool attached = false);
+			// the row holding the palette
+			unsigned int CreatePaletteTexture(Palette* palette, unsigned int colorKey, bool attached = false);
 			void RemovePaletteTexture(Palette* palette, unsigned int colorKey, bool attached = false);
-			void RemovePaletteTexture(GLuint texture, bool attached = false);
 			void ClearUnused(bool attached = false);
 			void Clear();
+			GLuint GetTexture() const { return texture; }
+			unsigned int GetRowCount() const { return rowCount; }
 			~GLPaletteManager();
 			GLPaletteManager();
 	};
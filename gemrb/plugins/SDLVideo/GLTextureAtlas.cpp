@@ -0,0 +1,160 @@
+
+#include "OpenGLEnv.h"
+
+#include <cstddef>
+
+#include "GLTextureAtlas.h"
+
+using namespace GemRB;
+
+int GLTextureAtlas::CellSize(int size)
+{
+	int cell = ATLAS_MIN_CELL;
+	while (cell < size) cell <<= 1;
+	return cell;
+}
+
+unsigned int GLTextureAtlas::PageKey(GLenum format, int cellWidth, int cellHeight)
+{
+	// the cells are at most ATLAS_MAX_SPRITE big, so 16 bits are plenty for both sides
+	return (format == GL_ALPHA ? 0x80000000U : 0) | (cellWidth << 16) | cellHeight;
+}
+
+GLTextureAtlas::Page* GLTextureAtlas::CreatePage(GLenum format, int cellWidth, int cellHeight)
+{
+	Page* page = new Page();
+	page->key = PageKey(format, cellWidth, cellHeight);
+	page->cellWidth = cellWidth;
+	page->cellHeight = cellHeight;
+	page->used = 0;
+	int cells = (ATLAS_PAGE_SIZE/cellWidth) * (ATLAS_PAGE_SIZE/cellHeight);
+	// hand out the first cells first
+	for (int i = cells - 1; i >= 0; i--)
+	{
+		page->freeCells.push_back(i);
+	}
+
+	glGenTextures(1, &page->texture);
+	glBindTexture(GL_TEXTURE_2D, page->texture);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 0, format, GL_UNSIGNED_BYTE, NULL);
+
+	pages[page->key].push_back(page);
+	owners[page->texture] = page;
+	return page;
+}
+
+bool GLTextureAtlas::Allocate(int w, int h, GLenum format, AtlasSlot& slot)
+{
+	slot = AtlasSlot();
+	if (w <= 0 || h <= 0 || w > ATLAS_MAX_SPRITE || h > ATLAS_MAX_SPRITE) return false;
+
+	int cellWidth = CellSize(w);
+	int cellHeight = CellSize(h);
+	std::vector<Page*>& candidates = pages[PageKey(format, cellWidth, cellHeight)];
+	Page* page = NULL;
+	for (unsigned int i = 0; i < candidates.size(); i++)
+	{
+		if (!candidates[i]->freeCells.empty())
+		{
+			page = candidates[i];
+			break;
+		}
+	}
+	if (page == NULL)
+	{
+		page = CreatePage(format, cellWidth, cellHeight);
+	}
+
+	int cell = page->freeCells.back();
+	page->freeCells.pop_back();
+	page->used++;
+	int perRow = ATLAS_PAGE_SIZE/cellWidth;
+	slot.texture = page->texture;
+	slot.x = (cell % perRow) * cellWidth;
+	slot.y = (cell / perRow) * cellHeight;
+	return true;
+}
+
+void GLTextureAtlas::Upload(const AtlasSlot& slot, int w, int h, GLenum format, const GLvoid* pixels)
+{
+	if (slot.texture == 0) return;
+	glBindTexture(GL_TEXTURE_2D, slot.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, format == GL_ALPHA ? 1 : 4);
+#ifdef USE_GL
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+	glTexSubImage2D(GL_TEXTURE_2D, 0, slot.x, slot.y, w, h, format, GL_UNSIGNED_BYTE, pixels);
+}
+
+void GLTextureAtlas::Release(AtlasSlot& slot)
+{
+	if (slot.texture == 0) return;
+	releasedSlots.push_back(slot);
+	slot = AtlasSlot();
+}
+
+void GLTextureAtlas::DeleteTexture(GLuint texture)
+{
+	if (texture != 0) deletedTextures.push_back(texture);
+}
+
+void GLTextureAtlas::FreeSlot(const AtlasSlot& slot)
+{
+	std::map<GLuint, Page*>::iterator it = owners.find(slot.texture);
+	if (it == owners.end()) return;
+
+	Page* page = it->second;
+	int perRow = ATLAS_PAGE_SIZE/page->cellWidth;
+	page->freeCells.push_back((slot.y / page->cellHeight) * perRow + slot.x / page->cellWidth);
+	if (--page->used) return;
+
+	// evict the page with its last sprite
+	std::vector<Page*>& list = pages[page->key];
+	for (unsigned int i = 0; i < list.size(); i++)
+	{
+		if (list[i] == page)
+		{
+			list.erase(list.begin() + i);
+			break;
+		}
+	}
+	owners.erase(it);
+	glDeleteTextures(1, &page->texture);
+	delete page;
+}
+
+void GLTextureAtlas::Recycle()
+{
+	for (unsigned int i = 0; i < releasedSlots.size(); i++)
+	{
+		FreeSlot(releasedSlots[i]);
+	}
+	releasedSlots.clear();
+	if (!deletedTextures.empty())
+	{
+		glDeleteTextures(deletedTextures.size(), &deletedTextures[0]);
+		deletedTextures.clear();
+	}
+}
+
+void GLTextureAtlas::Clear()
+{
+	Recycle();
+	std::map<GLuint, Page*>::iterator it;
+	for (it = owners.begin(); it != owners.end(); ++it)
+	{
+		glDeleteTextures(1, &it->second->texture);
+		delete it->second;
+	}
+	owners.clear();
+	pages.clear();
+}
+
+GLTextureAtlas::~GLTextureAtlas()
+{
+	Clear();
+}
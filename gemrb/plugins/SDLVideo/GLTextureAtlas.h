@@ -0,0 +1,63 @@
+#ifndef GLTEXTUREATLAS_H
+#define GLTEXTUREATLAS_H
+
+#include <map>
+#include <vector>
+
+// shared textures are this big, sprites up to a quarter of it on each side go there
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_SPRITE 256
+#define ATLAS_MIN_CELL 16
+
+namespace GemRB
+{
+	// a place in one of the shared textures
+	struct AtlasSlot
+	{
+		GLuint texture;
+		int x, y;
+		AtlasSlot() { texture = 0; x = y = 0; }
+	};
+
+	// packs the small sprites into shared large textures, so consecutive blits don't have to switch textures
+	// the pages are split into cells of one power of two size each, so freeing a sprite frees its cell
+	// and a page is dropped as soon as its last sprite goes
+	// the queued blits may still use what the sprites let go of, so that is only freed in Recycle
+	class GLTextureAtlas
+	{
+		private:
+			struct Page
+			{
+				GLuint texture;
+				unsigned int key;
+				int cellWidth, cellHeight;
+				std::vector<int> freeCells;
+				unsigned int used;
+			};
+
+			// pages by format and cell size
+			std::map<unsigned int, std::vector<Page*> > pages;
+			std::map<GLuint, Page*> owners;
+			std::vector<AtlasSlot> releasedSlots;
+			std::vector<GLuint> deletedTextures;
+
+			static int CellSize(int size);
+			static unsigned int PageKey(GLenum format, int cellWidth, int cellHeight);
+			Page* CreatePage(GLenum format, int cellWidth, int cellHeight);
+			void FreeSlot(const AtlasSlot& slot);
+
+		public:
+			// false if the sprite is too big to share a texture, the slot is left empty then
+			bool Allocate(int w, int h, GLenum format, AtlasSlot& slot);
+			void Upload(const AtlasSlot& slot, int w, int h, GLenum format, const GLvoid* pixels);
+			void Release(AtlasSlot& slot);
+			// for the textures of their own, so they outlive the batch too
+			void DeleteTexture(GLuint texture);
+			// once nothing queued refers to them anymore
+			void Recycle();
+			void Clear();
+			~GLTextureAtlas();
+	};
+}
+
+#endif
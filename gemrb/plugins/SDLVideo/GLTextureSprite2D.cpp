@@ -4,6 +4,9 @@
 #include "SDLVideo.h"
 #include "GLTextureSprite2D.h"
 #include "GLPaletteManager.h"
+#include "GLTileCompressor.h"
+#include "MemoryStats.h"
+#include "Palette.h"
 
 using namespace GemRB;
 
@@ -21,13 +24,19 @@ GLTextureSprite2D::GLTextureSprite2D (int Width, int Height, int Bpp, void* pixe
 {
 	currentPalette = NULL;
 	glTexture = 0;
-	glPaletteTexture = 0;
+	paletteRow = PALETTE_NO_ROW;
 	glMaskTexture = 0;
+	glCompressedTexture = 0;
+	compressible = true;
+	paletteManager = NULL;
+	atlas = NULL;
 	colorKeyIndex = PALETTE_INVALID_INDEX;
 	rMask = rmask;
 	gMask = gmask;
 	bMask = bmask;
 	aMask = amask;
+	pixelBytes = freePixels ? Width * Height * (Bpp / 8) : 0;
+	MemoryStats::Add(MEM_SPRITES_GL, pixelBytes);
 }
 
 GLTextureSprite2D::~GLTextureSprite2D()
@@ -35,6 +44,7 @@ GLTextureSprite2D::~GLTextureSprite2D()
 	if (currentPalette != NULL)
 		currentPalette->release();
 	MakeUnused();
+	MemoryStats::Remove(MEM_SPRITES_GL, pixelBytes);
 }
 
 GLTextureSprite2D::GLTextureSprite2D(const GLTextureSprite2D &obj) : Sprite2D(obj)
@@ -42,14 +52,20 @@ GLTextureSprite2D::GLTextureSprite2D(const GLTextureSprite2D &obj) : Sprite2D(ob
 	// copies only 8 bit sprites
 	glTexture = 0;
 	glMaskTexture = 0;
-	glPaletteTexture = 0;
+	glCompressedTexture = 0;
+	compressible = true;
+	paletteRow = PALETTE_NO_ROW;
 	currentPalette = NULL;
 	colorKeyIndex = obj.colorKeyIndex;
 	paletteManager = obj.paletteManager;
+	atlas = obj.atlas;
 	rMask = obj.rMask;
 	gMask = obj.bMask;
 	bMask = obj.bMask;
 	aMask = obj.aMask;
+	// the pixels stay with the original
+	pixelBytes = 0;
+	MemoryStats::Add(MEM_SPRITES_GL, 0);
 	SetPalette(obj.currentPalette);
 }
 
@@ -62,12 +78,13 @@ void GLTextureSprite2D::SetPalette(Palette *pal)
 {
 	if (!IsPaletted() || pal == NULL || currentPalette == pal) return;
 	pal->acquire();
+	disposeCompressedTexture();
 	if (currentPalette != NULL) 
 	{
 		currentPalette->release();
+		if (paletteRow != PALETTE_NO_ROW) paletteManager->RemovePaletteTexture(currentPalette, colorKeyIndex);
 	}
-	if (glPaletteTexture != 0) paletteManager->RemovePaletteTexture(glPaletteTexture);
-	glPaletteTexture = 0;
+	paletteRow = PALETTE_NO_ROW;
 	currentPalette = pal;
 }
 
@@ -81,19 +98,18 @@ Palette* GLTextureSprite2D::GetPalette() const
 void GLTextureSprite2D::SetColorKey(ieDword index)
 {
 	if (colorKeyIndex == index) return;
-	colorKeyIndex = index;
 	if(IsPaletted())
 	{
-		glDeleteTextures(1, &glMaskTexture);
-		if (glPaletteTexture != 0) paletteManager->RemovePaletteTexture(glPaletteTexture);
-		glPaletteTexture = 0;
-		glMaskTexture = 0;
+		disposeCompressedTexture();
+		disposeTexture(glMaskTexture);
+		if (paletteRow != PALETTE_NO_ROW) paletteManager->RemovePaletteTexture(currentPalette, colorKeyIndex);
+		paletteRow = PALETTE_NO_ROW;
 	}
 	else
 	{
-		glDeleteTextures(1, &glTexture);
-		glTexture = 0;
+		deleteGlTexture();
 	}
+	colorKeyIndex = index;
 }
 
 Color GLTextureSprite2D::GetPixel(unsigned short x, unsigned short y) const
@@ -122,16 +138,14 @@ Color GLTextureSprite2D::GetPixel(unsigned short x, unsigned short y) const
 void GLTextureSprite2D::createGlTexture()
 {
 	if (Bpp != 32 && Bpp != 8) return;
-	if (glTexture != 0) glDeleteTextures(1, &glTexture);
-	glGenTextures(1, &glTexture);
-	glBindTexture(GL_TEXTURE_2D, glTexture);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	deleteGlTexture();
+	GLenum format = GL_ALPHA; // indexed
+	const GLvoid* data = pixels;
+	int* buffer = NULL;
 	if(Bpp == 32) // true color textures
 	{
-		int* buffer = new int[Width * Height];
+		format = GL_RGBA;
+		buffer = new int[Width * Height];
 		for(int i = 0; i < Width*Height; i++)
 		{
 			Uint32 src = ((Uint32*) pixels)[i];
@@ -143,31 +157,62 @@ void GLTextureSprite2D::createGlTexture()
 			if (src == colorKeyIndex) a = 0x00; // transparent
 			buffer[i] = r | (g << 8) | (b << 16) | (a << 24);
 		}
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-#ifdef USE_GL
-		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-#endif
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*) buffer);
-		delete[] buffer;
+		data = buffer;
 	}
-	else if(Bpp == 8) // indexed
+
+	// small sprites share a texture with others
+	if (atlas && atlas->Allocate(Width, Height, format, atlasSlot))
 	{
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexture = atlasSlot.texture;
+		atlas->Upload(atlasSlot, Width, Height, format, data);
+		delete[] buffer;
+		return;
+	}
+
+	glGenTextures(1, &glTexture);
+	glBindTexture(GL_TEXTURE_2D, glTexture);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, format == GL_ALPHA ? 1 : 4);
 #ifdef USE_GL
-		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 #endif
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, Width, Height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, (GLvoid*) pixels);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, Width, Height, 0, format, GL_UNSIGNED_BYTE, data);
+	delete[] buffer;
+}
+
+void GLTextureSprite2D::deleteGlTexture()
+{
+	if (atlasSlot.texture != 0)
+	{
+		// the texture is shared, only give back our part of it
+		atlas->Release(atlasSlot);
+		glTexture = 0;
 	}
+	disposeTexture(glTexture);
 }
 
-void GLTextureSprite2D::createGlTextureForPalette()
+void GLTextureSprite2D::disposeTexture(GLuint& texture)
 {
-	glPaletteTexture = paletteManager->CreatePaletteTexture(currentPalette, colorKeyIndex);
+	if (texture == 0) return;
+	// a queued blit may still need it
+	if (atlas)
+		atlas->DeleteTexture(texture);
+	else
+		glDeleteTextures(1, &texture);
+	texture = 0;
+}
+
+void GLTextureSprite2D::createPaletteRow()
+{
+	paletteRow = paletteManager->CreatePaletteTexture(currentPalette, colorKeyIndex);
 }
 
 void GLTextureSprite2D::createGLMaskTexture()
 {
-	glDeleteTextures(1, &glMaskTexture);
+	disposeTexture(glMaskTexture);
 	glGenTextures(1, &glMaskTexture);
 	glBindTexture(GL_TEXTURE_2D, glMaskTexture);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -188,12 +233,56 @@ void GLTextureSprite2D::createGLMaskTexture()
 	delete[] mask;
 }
 
-GLuint GLTextureSprite2D::GetPaletteTexture()
+void GLTextureSprite2D::createCompressedTexture(GLenum format)
+{
+	compressible = false;
+	if (!IsPaletted() || currentPalette == NULL || Width % 4 || Height % 4) return;
+
+	// only opaque pixels, the compressed formats have no alpha
+	Color* colors = new Color[Width*Height];
+	for (int i = 0; i < Width*Height; i++)
+	{
+		Uint8 index = ((Uint8*) pixels)[i];
+		colors[i] = currentPalette->col[index];
+		if (index == colorKeyIndex || (currentPalette->alpha && colors[i].a != 0xFF))
+		{
+			delete[] colors;
+			return;
+		}
+	}
+	std::vector<unsigned char> blocks;
+	CompressETC1(colors, Width, Height, blocks);
+	delete[] colors;
+
+	glGenTextures(1, &glCompressedTexture);
+	glBindTexture(GL_TEXTURE_2D, glCompressedTexture);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, Width, Height, 0, (GLsizei) blocks.size(), &blocks[0]);
+	compressible = true;
+}
+
+void GLTextureSprite2D::disposeCompressedTexture()
+{
+	disposeTexture(glCompressedTexture);
+	compressible = true;
+}
+
+GLuint GLTextureSprite2D::GetCompressedTexture(GLenum format)
+{
+	if (glCompressedTexture != 0 || !compressible) return glCompressedTexture;
+	createCompressedTexture(format);
+	return glCompressedTexture;
+}
+
+unsigned int GLTextureSprite2D::GetPaletteRow()
 {
 	if (!IsPaletted()) return 0;
-	if (glPaletteTexture != 0) return glPaletteTexture;
-	createGlTextureForPalette();
-	return glPaletteTexture;
+	if (paletteRow != PALETTE_NO_ROW) return paletteRow;
+	createPaletteRow();
+	return paletteRow;
 }
 
 GLuint GLTextureSprite2D::GetMaskTexture()
@@ -214,21 +303,28 @@ GLuint GLTextureSprite2D::GetTexture()
 	return glTexture;
 }
 
-void GLTextureSprite2D::MakeUnused()
+void GLTextureSprite2D::GetTextureCoords(const Region& src, GLfloat* coords) const
 {
-	if (glTexture != 0) 
+	GLfloat textureWidth = (GLfloat)Width;
+	GLfloat textureHeight = (GLfloat)Height;
+	if (atlasSlot.texture != 0)
 	{
-		glDeleteTextures(1, &glTexture);
-		glTexture = 0;
-	}
-	if (glMaskTexture != 0) 
-	{
-		glDeleteTextures(1, &glMaskTexture);
-		glMaskTexture = 0;
+		textureWidth = textureHeight = (GLfloat)ATLAS_PAGE_SIZE;
 	}
-	if (glPaletteTexture != 0)
+	coords[0] = (GLfloat)(atlasSlot.x + src.x)/textureWidth;
+	coords[1] = (GLfloat)(atlasSlot.y + src.y)/textureHeight;
+	coords[2] = (GLfloat)src.w/textureWidth;
+	coords[3] = (GLfloat)src.h/textureHeight;
+}
+
+void GLTextureSprite2D::MakeUnused()
+{
+	deleteGlTexture();
+	disposeTexture(glMaskTexture);
+	disposeTexture(glCompressedTexture);
+	if (paletteRow != PALETTE_NO_ROW)
 	{
-		paletteManager->RemovePaletteTexture(glPaletteTexture);
-		glPaletteTexture = 0;
+		paletteManager->RemovePaletteTexture(currentPalette, colorKeyIndex);
+		paletteRow = PALETTE_NO_ROW;
 	}
 }
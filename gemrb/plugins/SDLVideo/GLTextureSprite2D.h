@@ -2,6 +2,7 @@
 #define GLTEXTURESPRITE2D_H
 
 #include "Sprite2D.h"
+#include "GLTextureAtlas.h"
 
 namespace GemRB 
 {
@@ -11,21 +12,36 @@ namespace GemRB
 	{
 	private:
 		GLuint glTexture;
-		GLuint glPaletteTexture;
+		unsigned int paletteRow;
 		GLuint glMaskTexture;
+		// the opaque tiles may also have a compressed texture, without the palette
+		GLuint glCompressedTexture;
+		bool compressible;
 		Palette* currentPalette;
 		Uint32 rMask, gMask, bMask, aMask;
 		ieDword colorKeyIndex;
 		GLPaletteManager* paletteManager;
+		GLTextureAtlas* atlas;
+		AtlasSlot atlasSlot;
+		// the pixels this sprite owns, for the MemoryStats
+		unsigned long pixelBytes;
 
 		void createGlTexture();
-		void createGlTextureForPalette();
+		void deleteGlTexture();
+		void disposeTexture(GLuint& texture);
+		void createPaletteRow();
 		void createGLMaskTexture();
+		void createCompressedTexture(GLenum format);
+		void disposeCompressedTexture();
 	public:
 		GLuint GetTexture();
-		GLuint GetPaletteTexture();
+		// where src is inside GetTexture(), as x, y, w and h in texture coordinates
+		void GetTextureCoords(const Region& src, GLfloat* coords) const;
+		// the row of the palette texture of the GLPaletteManager
+		unsigned int GetPaletteRow();
 		GLuint GetMaskTexture();
-		void SetPaletteTexture(int texture);
+		// 0 if the sprite has transparent pixels, or isn't in 4x4 blocks
+		GLuint GetCompressedTexture(GLenum format);
 		Palette* GetPalette() const;
 		const Color* GetPaletteColors() const { return currentPalette->col; }
 		void SetPalette(Palette *pal);
@@ -34,6 +50,7 @@ namespace GemRB
 		void SetColorKey(ieDword);
 		bool IsPaletted() const { return Bpp == 8; }
 		void SetPaletteManager(GLPaletteManager* manager) { paletteManager = manager; }
+		void SetAtlas(GLTextureAtlas* textureAtlas) { atlas = textureAtlas; }
 		GLTextureSprite2D (int Width, int Height, int Bpp, void* pixels, Uint32 rmask=0, Uint32 gmask=0, Uint32 bmask=0, Uint32 amask=0);
 		~GLTextureSprite2D();
 		GLTextureSprite2D(const GLTextureSprite2D &obj);
@@ -0,0 +1,158 @@
+
+#include "GLTileCompressor.h"
+
+using namespace GemRB;
+
+// the intensity modifiers of the codewords, the negative ones mirror these
+static const int ETC1Modifiers[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static inline int Clamp255(int value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// the best codeword for the subblock around base, with its pixel indices in the etc1 bit order
+static unsigned int FitSubblock(const Color* block[16], const bool inSubblock[16], const int base[3],
+	unsigned int& table, unsigned int& msbs, unsigned int& lsbs)
+{
+	unsigned int bestError = ~0U;
+	for (unsigned int t = 0; t < 8; t++)
+	{
+		const int modifiers[4] = { ETC1Modifiers[t][0], ETC1Modifiers[t][1], -ETC1Modifiers[t][0], -ETC1Modifiers[t][1] };
+		unsigned int error = 0, tMsbs = 0, tLsbs = 0;
+		for (unsigned int i = 0; i < 16 && error < bestError; i++)
+		{
+			if (!inSubblock[i]) continue;
+			const Color& c = *block[i];
+			unsigned int bestPixel = ~0U, bestIndex = 0;
+			for (unsigned int m = 0; m < 4; m++)
+			{
+				int dr = Clamp255(base[0] + modifiers[m]) - c.r;
+				int dg = Clamp255(base[1] + modifiers[m]) - c.g;
+				int db = Clamp255(base[2] + modifiers[m]) - c.b;
+				unsigned int pixelError = dr*dr + dg*dg + db*db;
+				if (pixelError < bestPixel)
+				{
+					bestPixel = pixelError;
+					bestIndex = m;
+				}
+			}
+			error += bestPixel;
+			tMsbs |= (bestIndex >> 1) << i;
+			tLsbs |= (bestIndex & 1) << i;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			table = t;
+			msbs = tMsbs;
+			lsbs = tLsbs;
+		}
+	}
+	return bestError;
+}
+
+// one 4x4 block, block[] is in the etc1 pixel order: down the columns
+static void CompressBlock(const Color* block[16], unsigned char* out)
+{
+	unsigned int bestError = ~0U;
+	unsigned int bestHigh = 0, bestLow = 0;
+	for (unsigned int flip = 0; flip < 2; flip++)
+	{
+		// without flip the subblocks are the left and right halves, with it the top and bottom ones
+		bool inFirst[16], inSecond[16];
+		int sums[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int x = i / 4, y = i % 4;
+			inFirst[i] = flip ? y < 2 : x < 2;
+			inSecond[i] = !inFirst[i];
+			int *sum = sums[inFirst[i] ? 0 : 1];
+			sum[0] += block[i]->r;
+			sum[1] += block[i]->g;
+			sum[2] += block[i]->b;
+		}
+
+		// the differential mode is more precise, if the averages are close enough for it
+		int q5[2][3], q4[2][3];
+		bool differential = true;
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			for (unsigned int s = 0; s < 2; s++)
+			{
+				int average = (sums[s][c] + 4) / 8;
+				q5[s][c] = (average * 31 + 127) / 255;
+				q4[s][c] = (average * 15 + 127) / 255;
+			}
+			int delta = q5[1][c] - q5[0][c];
+			if (delta < -4 || delta > 3) differential = false;
+		}
+		int bases[2][3];
+		for (unsigned int s = 0; s < 2; s++)
+		{
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				bases[s][c] = differential ? (q5[s][c] << 3) | (q5[s][c] >> 2) : (q4[s][c] << 4) | q4[s][c];
+			}
+		}
+
+		unsigned int table1 = 0, table2 = 0, msbs1 = 0, msbs2 = 0, lsbs1 = 0, lsbs2 = 0;
+		unsigned int error = FitSubblock(block, inFirst, bases[0], table1, msbs1, lsbs1);
+		if (error >= bestError) continue;
+		error += FitSubblock(block, inSecond, bases[1], table2, msbs2, lsbs2);
+		if (error >= bestError) continue;
+
+		bestError = error;
+		unsigned int high = 0;
+		if (differential)
+		{
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				unsigned int delta = (unsigned int) (q5[1][c] - q5[0][c]) & 7;
+				high |= ((q5[0][c] << 3) | delta) << (24 - c*8);
+			}
+		}
+		else
+		{
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				high |= ((q4[0][c] << 4) | q4[1][c]) << (24 - c*8);
+			}
+		}
+		high |= table1 << 5 | table2 << 2 | (differential ? 2 : 0) | flip;
+		bestHigh = high;
+		bestLow = (msbs1 | msbs2) << 16 | (lsbs1 | lsbs2);
+	}
+
+	// big endian
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		out[i] = (unsigned char) (bestHigh >> (24 - i*8));
+		out[4 + i] = (unsigned char) (bestLow >> (24 - i*8));
+	}
+}
+
+namespace GemRB
+{
+	void CompressETC1(const Color* pixels, int width, int height, std::vector<unsigned char>& blocks)
+	{
+		blocks.resize((width / 4) * (height / 4) * 8);
+		if (blocks.empty()) return;
+		unsigned char* out = &blocks[0];
+		const Color* block[16];
+		for (int by = 0; by < height; by += 4)
+		{
+			for (int bx = 0; bx < width; bx += 4)
+			{
+				for (unsigned int i = 0; i < 16; i++)
+				{
+					block[i] = &pixels[(by + i % 4) * width + bx + i / 4];
+				}
+				CompressBlock(block, out);
+				out += 8;
+			}
+		}
+	}
+}
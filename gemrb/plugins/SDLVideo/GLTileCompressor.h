@@ -0,0 +1,23 @@
+#ifndef GLTILECOMPRESSOR_H
+#define GLTILECOMPRESSOR_H
+
+#include <vector>
+
+#include "RGBAColor.h"
+
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+namespace GemRB
+{
+	// encodes opaque pixels as etc1 blocks, which the etc2 formats read as well
+	// width and height must be multiples of 4, the blocks are 8 bytes for each 4x4 pixels
+	// this is a single pass over the candidate tables, quick enough to run while the tiles load
+	void CompressETC1(const Color* pixels, int width, int height, std::vector<unsigned char>& blocks);
+}
+
+#endif
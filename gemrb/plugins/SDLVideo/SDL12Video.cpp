@@ -90,6 +90,7 @@ int SDL12VideoDriver::CreateDisplay(int w, int h, int b, bool fs, const char* ti
 	SDL_FillRect( extra, NULL, val );
 	SDL_UnlockSurface( extra );
 	SDL_FreeSurface( tmp );
+	MarkScreenDirty();
 
 	return GEM_OK;
 }
@@ -121,6 +122,8 @@ void SDL12VideoDriver::DestroyMovieScreen()
 		SDL_FreeYUVOverlay(overlay);
 		overlay = NULL;
 	}
+	// the movie drew right onto the display
+	MarkScreenDirty();
 }
 
 void SDL12VideoDriver::showFrame(unsigned char* buf, unsigned int bufw,
@@ -172,6 +175,7 @@ bool SDL12VideoDriver::SetFullscreenMode(bool set)
 		fullscreen=set;
 		// FIXME: SDL_WM_ToggleFullScreen only works on X11. use SDL_SetVideoMode()
 		SDL_WM_ToggleFullScreen( disp );
+		MarkScreenDirty();
 		//readjust mouse to original position
 		MoveMouse(CursorPos.x, CursorPos.y);
 		//synchronise internal variable
@@ -183,7 +187,18 @@ bool SDL12VideoDriver::SetFullscreenMode(bool set)
 
 int SDL12VideoDriver::SwapBuffers(void)
 {
-	SDL_BlitSurface( backBuf, NULL, disp, NULL );
+	FlushBlits();
+	LimitFrameRate();
+	if (fadeColor.a) {
+		MarkScreenDirty();
+	}
+	UpdateOverlays();
+
+	std::vector<Region>::const_iterator it;
+	for (it = dirtyRegions.begin(); it != dirtyRegions.end(); ++it) {
+		SDL_Rect rect = RectFromRegion(*it);
+		SDL_BlitSurface( backBuf, &rect, disp, &rect );
+	}
 	if (fadeColor.a) {
 		SDL_SetAlpha( extra, SDL_SRCALPHA, fadeColor.a );
 		SDL_Rect src = {
@@ -198,11 +213,19 @@ int SDL12VideoDriver::SwapBuffers(void)
 	/** This causes the tooltips/cursors to be rendered directly to display */
 	SDL_Surface* tmp = backBuf;
 	backBuf = disp; // FIXME: UGLY HACK!
-	int ret = SDLVideoDriver::SwapBuffers();
+	DrawOverlays();
 	backBuf = tmp;
 
-	SDL_Flip( disp );
-	return ret;
+	// nothing changed, the last frame is still on the screen
+	if (IsDirty()) {
+		std::vector<SDL_Rect> rects;
+		for (it = dirtyRegions.begin(); it != dirtyRegions.end(); ++it) {
+			rects.push_back(RectFromRegion(*it));
+		}
+		SDL_UpdateRects( disp, (int) rects.size(), &rects[0] );
+	}
+	ClearDirty();
+	return PollEvents();
 }
 
 bool SDL12VideoDriver::ToggleGrabInput()
@@ -263,6 +286,9 @@ void SDL12VideoDriver::showYUVFrame(unsigned char** buf, unsigned int *strides,
 int SDL12VideoDriver::ProcessEvent(const SDL_Event & event)
 {
 	switch (event.type) {
+		case SDL_VIDEOEXPOSE:
+			MarkScreenDirty();
+			break;
 		case SDL_ACTIVEEVENT:
 			if (core->ConsolePopped) {
 				break;
@@ -11,13 +11,18 @@
 #endif
 
 #include <algorithm>
+#include <cstring>
 #include "SDL20GLVideo.h"
 #include "Interface.h"
-#include "Game.h" // for GetGlobalTint
+#include "FrameStats.h"
+#include "Game.h" // for GetSpriteTint
 #include "GLTextureSprite2D.h"
 #include "GLPaletteManager.h"
+#include "GLTextureAtlas.h"
+#include "GLTileCompressor.h"
 #include "GLSLProgram.h"
 #include "Matrix.h"
+#include "Tracer.h"
 
 using namespace GemRB;
 
@@ -29,8 +34,16 @@ GLVideoDriver::~GLVideoDriver()
 	if (programPalSepia) programPalSepia->Release();
 	if (programRect) programRect->Release();
 	if (programEllipse) programEllipse->Release();
-	delete paletteManager;
+	if (programFog) programFog->Release();
+	if (programYUV) programYUV->Release();
+	if (fogTexture) glDeleteTextures(1, &fogTexture);
+	freeMovieTextures();
+	if (moviePixelBuffers[0]) glDeleteBuffers(3, moviePixelBuffers);
+	if (screenshotBuffer) glDeleteBuffers(1, &screenshotBuffer);
+	glDeleteBuffers(1, &batchBuffer);
 	FreeBackgroundBuffer();
+	delete paletteManager;
+	delete textureAtlas;
 	SDL_GL_DeleteContext(context);
 }
 
@@ -124,13 +137,39 @@ int GLVideoDriver::CreateDisplay(int w, int h, int bpp, bool fs, const char* tit
 
 #ifdef USE_GL
 	glewInit();
+#endif
+	fogTexture = 0;
+	fogWidth = fogHeight = 0;
+	movieTextures[0] = movieTextures[1] = movieTextures[2] = 0;
+	moviePixelBuffers[0] = moviePixelBuffers[1] = moviePixelBuffers[2] = 0;
+	movieWidth = movieHeight = 0;
+	movieYUV = false;
+	screenshotBuffer = 0;
+	screenshotPending = false;
+#ifdef USE_GL
+	if (GLEW_VERSION_2_1) glGenBuffers(3, moviePixelBuffers);
+	if (GLEW_VERSION_2_1) glGenBuffers(1, &screenshotBuffer);
 #endif
 	if (!createPrograms()) return GEM_ERROR;
 	paletteManager = new GLPaletteManager();
+	textureAtlas = new GLTextureAtlas();
+	tileFormat = 0;
+	if (core->CompressTiles) {
+		// etc2 reads the etc1 blocks too
+#ifdef USE_GL
+		if (GLEW_ARB_ES3_compatibility) tileFormat = GL_COMPRESSED_RGB8_ETC2;
+#else
+		const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+		if (extensions && strstr(extensions, "GL_OES_compressed_ETC1_RGB8_texture")) tileFormat = GL_ETC1_RGB8_OES;
+#endif
+		if (!tileFormat) Log(WARNING, "SDL 2 GL Driver", "No etc texture compression, the tiles stay uncompressed.");
+	}
 	glViewport(GLViewport.x, GLViewport.y, GLViewport.w, GLViewport.h);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_SCISSOR_TEST);
+	glGenBuffers(1, &batchBuffer);
+	batchState.program = NULL;
 	spritesPerFrame = 0;
 	return GEM_OK;
 }
@@ -217,6 +256,30 @@ bool GLVideoDriver::createPrograms()
 	}
 	programRect->Use();
 	programRect->SetUniformMatrixValue("u_matrix", 4, 1, matrix);
+
+	programFog = GLSLProgram::CreateFromFiles("Shaders/Fog.glslv", "Shaders/Fog.glslf");
+	if (!programFog)
+	{
+		msg = GLSLProgram::GetLastError();
+		Log(FATAL, "SDL 2 GL Driver", "Can't build shader program: %s", msg.c_str());
+		return false;
+	}
+	programFog->Use();
+	programFog->SetUniformValue("s_texture", 1, 0);
+	programFog->SetUniformMatrixValue("u_matrix", 4, 1, matrix);
+
+	programYUV = GLSLProgram::CreateFromFiles("Shaders/YUV.glslv", "Shaders/YUV.glslf");
+	if (!programYUV)
+	{
+		msg = GLSLProgram::GetLastError();
+		Log(FATAL, "SDL 2 GL Driver", "Can't build shader program: %s", msg.c_str());
+		return false;
+	}
+	programYUV->Use();
+	programYUV->SetUniformValue("s_texY", 1, 0);
+	programYUV->SetUniformValue("s_texU", 1, 1);
+	programYUV->SetUniformValue("s_texV", 1, 2);
+	programYUV->SetUniformMatrixValue("u_matrix", 4, 1, matrix);
 	
 	lastUsedProgram = NULL;
 	return true;
@@ -225,6 +288,7 @@ bool GLVideoDriver::createPrograms()
 Sprite2D* GLVideoDriver::CreateSprite(int w, int h, int bpp, ieDword rMask, ieDword gMask, ieDword bMask, ieDword aMask, void* pixels, bool cK, int index)
 {
 	GLTextureSprite2D* spr = new GLTextureSprite2D(w, h, bpp, pixels, rMask, gMask, bMask, aMask);
+	spr->SetAtlas(textureAtlas);
 	if (cK) spr->SetColorKey(index);
 	return spr;
 }
@@ -235,6 +299,7 @@ Sprite2D* GLVideoDriver::CreatePalettedSprite(int w, int h, int bpp, void* pixel
 
 	GLTextureSprite2D* spr = new GLTextureSprite2D(w, h, bpp, pixels);
 	spr->SetPaletteManager(paletteManager);
+	spr->SetAtlas(textureAtlas);
 	Palette* pal = new Palette(palette);
 	spr->SetPalette(pal);
 	pal->release();
@@ -247,18 +312,50 @@ Sprite2D* GLVideoDriver::CreateSprite8(int w, int h, void* pixels, Palette* pale
 	return CreatePalettedSprite(w, h, 8, pixels, palette->col, cK, index);
 }
 
+// spreads x, y, w, h over the corners of the blit as laid out in GLBlitSprite, applying the mirroring
+static void MapTextureCoords(const GLfloat* rect, unsigned int flags, GLfloat* coords)
+{
+	GLfloat x = rect[0], y = rect[1], w = rect[2], h = rect[3];
+	/* lower left */
+	coords[0] = x, coords[1] = y;
+	/* lower right */
+	coords[2] = x + w, coords[3] = y;
+	/* top left */
+	coords[4] = x, coords[5] = y + h;
+	/* top right */
+	coords[6] = x + w, coords[7] = y + h;
+
+	// FIXME: are there constants for accessing these coordinate indices?
+	GLfloat tmp;
+	if (flags&BLIT_MIRRORX) {
+		// swap lower left X with lower right X
+		tmp = coords[0];
+		coords[0] = coords[2];
+		coords[2] = tmp;
+		// swap top left X with top right X
+		tmp = coords[4];
+		coords[4] = coords[6];
+		coords[6] = tmp;
+	}
+	if (flags&BLIT_MIRRORY) {
+		// swap lower left Y with top left Y
+		tmp = coords[1];
+		coords[1] = coords[5];
+		coords[5] = tmp;
+		// swap lower right Y with top right Y
+		tmp = coords[3];
+		coords[3] = coords[7];
+		coords[7] = tmp;
+	}
+}
+
 void GLVideoDriver::GLBlitSprite(GLTextureSprite2D* spr, const Region& src, const Region& dst, Palette* attachedPal,
-								 unsigned int flags, const Color* tint, GLTextureSprite2D* mask)
+								 unsigned int flags, const Color* tint, GLuint maskTexture, GLuint compressedTexture)
 {
 	// TODO: clip dst to the screen?
 	if (dst.w <= 0 || dst.h <= 0 || src.w <= 0 || src.h <= 0)
 		return; // we already know blit fails
-
-	glViewport(dst.x, height - (dst.y + dst.h), dst.w, dst.h);
-	Region scissorRect = ClippedDrawingRect(dst);
-	glScissor(scissorRect.x, height - (scissorRect.y + scissorRect.h), scissorRect.w, scissorRect.h);
-	float hscale = 2.0f/(float)dst.w;
-	float vscale = 2.0f/(float)dst.h;
+	FrameStats::Count(FRAME_BLITS);
 
 	// color tint
 	Color colorTint;
@@ -271,124 +368,165 @@ void GLVideoDriver::GLBlitSprite(GLTextureSprite2D* spr, const Region& src, cons
 	// I think this way makes more sense, but I need to examine the behavior of the the functions passing flag parameters
 	flags |= spr->renderFlags;
 
-	GLfloat x = (GLfloat)src.x/(GLfloat)spr->Width;
-	GLfloat y = (GLfloat)src.y/(GLfloat)spr->Height;
-	GLfloat w = (GLfloat)src.w/(GLfloat)spr->Width;
-	GLfloat h = (GLfloat)src.h/(GLfloat)spr->Height;
-	GLfloat textureCoords[] = { /* lower left */ x, y, /* lower right */x + w, y,
-								/* top left */ x, y + h, /* top right */ x + w, y + h };
-
-	// FIXME: are there constants for accessing these coordinate indices?
-	GLfloat tmp;
-	if (flags&BLIT_MIRRORX) {
-		// swap lower left X with lower right X
-		tmp = textureCoords[0];
-		textureCoords[0] = textureCoords[2];
-		textureCoords[2] = tmp;
-		// swap top left X with top right X
-		tmp = textureCoords[4];
-		textureCoords[4] = textureCoords[6];
-		textureCoords[6] = tmp;
-	}
-	if (flags&BLIT_MIRRORY) {
-		// swap lower left Y with top left Y
-		tmp = textureCoords[1];
-		textureCoords[1] = textureCoords[5];
-		textureCoords[5] = tmp;
-		// swap lower right Y with top right Y
-		tmp = textureCoords[3];
-		textureCoords[3] = textureCoords[7];
-		textureCoords[7] = tmp;
-	}
-
+	GLBatchState state;
+	state.mode = GL_TRIANGLES;
+	state.vertexSize = VERTEX_SIZE + TEX_SIZE + TEX_SIZE + PALETTE_SIZE;
+	state.scissor = ClippedDrawingRect(Region(0, 0, width, height));
+	state.color[0] = (GLfloat)colorTint.r/255;
+	state.color[1] = (GLfloat)colorTint.g/255;
+	state.color[2] = (GLfloat)colorTint.b/255;
+	state.color[3] = (GLfloat)colorTint.a/255;
 	// alpha modifier
-	GLfloat alphaModifier = flags & BLIT_HALFTRANS ? 0.5f : 1.0f;
-
-	// data
-	GLfloat data[] = 
-	{	    
-		-1.0f, 1.0f, textureCoords[0], textureCoords[1],
-		-1.0f + dst.w*hscale, 1.0f, textureCoords[2], textureCoords[3],
-		-1.0f, 1.0f - dst.h*vscale, textureCoords[4], textureCoords[5],
-		-1.0f + dst.w*hscale, 1.0f - dst.h*vscale, textureCoords[6], textureCoords[7]
-	};
+	state.alphaModifier = flags & BLIT_HALFTRANS ? 0.5f : 1.0f;
+	state.shadowMode = 1;
+	if (flags & BLIT_NOSHADOW) {
+		state.shadowMode = 0;
+	} else if (flags & BLIT_TRANSSHADOW) {
+		state.shadowMode = 2;
+	}
 
 	// shader program selection
-	GLSLProgram* program;
-	GLuint palTexture;
-	if(spr->IsPaletted())
+	GLfloat paletteRow = 0.0f;
+	if (compressedTexture)
+	{
+		// the palette is already applied
+		state.program = program32;
+	}
+	else if(spr->IsPaletted())
 	{
 		if (flags & BLIT_GREY)
-			program = programPalGrayed;
+			state.program = programPalGrayed;
 		else if (flags & BLIT_SEPIA)
-			program = programPalSepia;
+			state.program = programPalSepia;
 		else
-			program = programPal;
+			state.program = programPal;
 
-		glActiveTexture(GL_TEXTURE1);
 		if (attachedPal) 
-			palTexture = paletteManager->CreatePaletteTexture(attachedPal, spr->GetColorKey(), true);
+			paletteRow = (GLfloat)paletteManager->CreatePaletteTexture(attachedPal, spr->GetColorKey(), true);
 		else 
-			palTexture = spr->GetPaletteTexture();		
-		glBindTexture(GL_TEXTURE_2D, palTexture);
+			paletteRow = (GLfloat)spr->GetPaletteRow();
 	}
 	else
 	{
-		program = program32;
+		state.program = program32;
 	}
+	state.textures[0] = compressedTexture ? compressedTexture : spr->GetTexture();
+	state.textures[1] = maskTexture;
+
+	// the masks cover the whole sprite, while the sprite may only be a part of its texture
+	GLfloat maskCoords[4] = {
+		(GLfloat)src.x/(GLfloat)spr->Width, (GLfloat)src.y/(GLfloat)spr->Height,
+		(GLfloat)src.w/(GLfloat)spr->Width, (GLfloat)src.h/(GLfloat)spr->Height
+	};
+	GLfloat spriteCoords[4];
+	// only known once the texture exists
+	if (compressedTexture)
+		memcpy(spriteCoords, maskCoords, sizeof(spriteCoords)); // covers the whole texture too
+	else
+		spr->GetTextureCoords(src, spriteCoords);
+
+	GLfloat textureCoords[8], maskTextureCoords[8];
+	MapTextureCoords(spriteCoords, flags, textureCoords);
+	MapTextureCoords(maskCoords, flags, maskTextureCoords);
+
+	GLfloat left = -1.0f + (GLfloat)dst.x*2/width;
+	GLfloat right = -1.0f + (GLfloat)(dst.x + dst.w)*2/width;
+	GLfloat top = 1.0f - (GLfloat)dst.y*2/height;
+	GLfloat bottom = 1.0f - (GLfloat)(dst.y + dst.h)*2/height;
+
+	// data, the quad as two triangles
+	GLfloat data[] = 
+	{	    
+		left, top, textureCoords[0], textureCoords[1], maskTextureCoords[0], maskTextureCoords[1], paletteRow,
+		right, top, textureCoords[2], textureCoords[3], maskTextureCoords[2], maskTextureCoords[3], paletteRow,
+		left, bottom, textureCoords[4], textureCoords[5], maskTextureCoords[4], maskTextureCoords[5], paletteRow,
+		right, top, textureCoords[2], textureCoords[3], maskTextureCoords[2], maskTextureCoords[3], paletteRow,
+		left, bottom, textureCoords[4], textureCoords[5], maskTextureCoords[4], maskTextureCoords[5], paletteRow,
+		right, bottom, textureCoords[6], textureCoords[7], maskTextureCoords[6], maskTextureCoords[7], paletteRow
+	};
+	addToBatch(state, data, 6);
+	spritesPerFrame++;
+}
+
+void GLVideoDriver::addToBatch(const GLBatchState& state, const GLfloat* vertices, unsigned int count)
+{
+	if (!(state == batchState) || batchVertices.size() >= GL_BATCH_MAX_FLOATS)
+	{
+		flushBatch();
+		batchState = state;
+	}
+	batchVertices.insert(batchVertices.end(), vertices, vertices + count*state.vertexSize);
+}
+
+void GLVideoDriver::flushBatch()
+{
+	if (batchVertices.empty()) return;
+	TRACE_SCOPE("GLVideo::flushBatch");
+	const GLBatchState& state = batchState;
+	GLSLProgram* program = state.program;
 	useProgram(program);
+	glViewport(GLViewport.x, GLViewport.y, GLViewport.w, GLViewport.h);
+	glScissor(state.scissor.x, height - (state.scissor.y + state.scissor.h), state.scissor.w, state.scissor.h);
 
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture = spr->GetTexture();
-	glBindTexture(GL_TEXTURE_2D, texture);
-	
-	if (mask)
+	GLint a_position = program->GetAttribLocation("a_position");
+	GLint a_texCoord = -1, a_maskCoord = -1, a_paletteRow = -1;
+	if (program == programRect)
 	{
-		glActiveTexture(GL_TEXTURE2);
-		GLuint maskTexture = ((GLTextureSprite2D*)mask)->GetMaskTexture();
-		glBindTexture(GL_TEXTURE_2D, maskTexture);
+		program->SetUniformValue("u_color", COLOR_SIZE, state.color[0], state.color[1], state.color[2], state.color[3]);
 	}
 	else
-	if(flags & BLIT_EXTERNAL_MASK) {} // used with external mask
-	else
 	{
-		// disable 3rd texture
+		// the palette and the mask are only used by the paletted programs
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, paletteManager->GetTexture());
 		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
-
-	program->SetUniformValue("u_tint", COLOR_SIZE, (GLfloat)colorTint.r/255, (GLfloat)colorTint.g/255, (GLfloat)colorTint.b/255, (GLfloat)colorTint.a/255);
-	program->SetUniformValue("u_alphaModifier", 1, alphaModifier);
-
-	GLint shadowMode = 1;
-	if (flags & BLIT_NOSHADOW) {
-		shadowMode = 0;
-	} else if (flags & BLIT_TRANSSHADOW) {
-		shadowMode = 2;
+		glBindTexture(GL_TEXTURE_2D, state.textures[1]);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, state.textures[0]);
+
+		program->SetUniformValue("u_tint", COLOR_SIZE, state.color[0], state.color[1], state.color[2], state.color[3]);
+		program->SetUniformValue("u_alphaModifier", 1, state.alphaModifier);
+		program->SetUniformValue("u_shadowMode", 1, state.shadowMode);
+		// the palette texture may have grown since the blits were queued, the rows stayed
+		GLfloat paletteRows = paletteManager->GetRowCount() ? (GLfloat)paletteManager->GetRowCount() : 1.0f;
+		program->SetUniformValue("u_paletteRows", 1, paletteRows);
+
+		a_texCoord = program->GetAttribLocation("a_texCoord");
+		// optimized away by the shaders not using a mask
+		a_maskCoord = program->GetAttribLocation("a_maskCoord");
+		a_paletteRow = program->GetAttribLocation("a_paletteRow");
 	}
-	program->SetUniformValue("u_shadowMode", 1, shadowMode);
 
-	GLint a_position = program->GetAttribLocation("a_position");
-	GLint a_texCoord = program->GetAttribLocation("a_texCoord");
-
-	GLuint buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(data), data, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(a_position, VERTEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*(VERTEX_SIZE + TEX_SIZE), 0);
-	glVertexAttribPointer(a_texCoord, TEX_SIZE, GL_FLOAT, GL_FALSE, sizeof(GLfloat)*(VERTEX_SIZE + TEX_SIZE), BUFFER_OFFSET(sizeof(GLfloat)*VERTEX_SIZE));
+	glBindBuffer(GL_ARRAY_BUFFER, batchBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*batchVertices.size(), &batchVertices[0], GL_STREAM_DRAW);
 
+	GLsizei stride = sizeof(GLfloat)*state.vertexSize;
+	glVertexAttribPointer(a_position, VERTEX_SIZE, GL_FLOAT, GL_FALSE, stride, 0);
 	glEnableVertexAttribArray(a_position);
-	glEnableVertexAttribArray(a_texCoord);
+	if (a_texCoord >= 0)
+	{
+		glVertexAttribPointer(a_texCoord, TEX_SIZE, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(sizeof(GLfloat)*VERTEX_SIZE));
+		glEnableVertexAttribArray(a_texCoord);
+	}
+	if (a_maskCoord >= 0)
+	{
+		glVertexAttribPointer(a_maskCoord, TEX_SIZE, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(sizeof(GLfloat)*(VERTEX_SIZE + TEX_SIZE)));
+		glEnableVertexAttribArray(a_maskCoord);
+	}
+	if (a_paletteRow >= 0)
+	{
+		glVertexAttribPointer(a_paletteRow, PALETTE_SIZE, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(sizeof(GLfloat)*(VERTEX_SIZE + TEX_SIZE + TEX_SIZE)));
+		glEnableVertexAttribArray(a_paletteRow);
+	}
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	FrameStats::Count(FRAME_DRAWS);
+	glDrawArrays(state.mode, 0, batchVertices.size()/state.vertexSize);
 
-	glDisableVertexAttribArray(a_texCoord);
 	glDisableVertexAttribArray(a_position);
-	
-	glDeleteBuffers(1, &buffer);
-	spritesPerFrame++;
+	if (a_texCoord >= 0) glDisableVertexAttribArray(a_texCoord);
+	if (a_maskCoord >= 0) glDisableVertexAttribArray(a_maskCoord);
+	if (a_paletteRow >= 0) glDisableVertexAttribArray(a_paletteRow);
+	batchVertices.clear();
 }
 
 void GLVideoDriver::BlitSprite(const Sprite2D* spr, const Region& src, const Region& dst, Palette* palette)
@@ -396,51 +534,63 @@ void GLVideoDriver::BlitSprite(const Sprite2D* spr, const Region& src, const Reg
 	GLBlitSprite((GLTextureSprite2D*)spr, src, dst, palette);
 }
 
-void GLVideoDriver::clearRect(const Region& rgn, const Color& color)
-{
-	if (SDL_ALPHA_TRANSPARENT == color.a) return;
-	Region scissorRect = ClippedDrawingRect(rgn);
-	glScissor(scissorRect.x, height - scissorRect.y - scissorRect.h, scissorRect.w, scissorRect.h);
-	glClearColor(color.r/255, color.g/255, color.b/255, color.a/255);
-	glClear(GL_COLOR_BUFFER_BIT);
-}
-
 void GLVideoDriver::drawPolygon(Point* points, unsigned int count, const Color& color, PointDrawingMode mode)
 {
-	if (SDL_ALPHA_TRANSPARENT == color.a) return;
-	useProgram(programRect);
-	glViewport(GLViewport.x, GLViewport.y, GLViewport.w, GLViewport.h);
-	Region scissorRect = ClippedDrawingRect(Region(0, 0, width, height));
-	glScissor(scissorRect.x, height - scissorRect.y - scissorRect.h, scissorRect.w, scissorRect.h);
-	GLfloat* data = new GLfloat[count*VERTEX_SIZE];
-	for(unsigned int i=0; i<count; i++)
+	if (SDL_ALPHA_TRANSPARENT == color.a || count < 2) return;
+
+	GLBatchState state;
+	state.program = programRect;
+	state.vertexSize = VERTEX_SIZE;
+	state.scissor = ClippedDrawingRect(Region(0, 0, width, height));
+	state.color[0] = (GLfloat)color.r/255;
+	state.color[1] = (GLfloat)color.g/255;
+	state.color[2] = (GLfloat)color.b/255;
+	state.color[3] = (GLfloat)color.a/255;
+
+	// the strips, loops and fans are split up, so consecutive shapes can be drawn together
+	std::vector<unsigned int> order;
+	if (mode == LineLoop || mode == LineStrip)
 	{
-		data[i*VERTEX_SIZE] = -1.0f + (GLfloat)points[i].x*2/width;
-		data[i*VERTEX_SIZE + 1] = 1.0f - (GLfloat)points[i].y*2/height;
+		state.mode = GL_LINES;
+		for(unsigned int i=0; i+1<count; i++)
+		{
+			order.push_back(i);
+			order.push_back(i+1);
+		}
+		if (mode == LineLoop && count > 2)
+		{
+			order.push_back(count-1);
+			order.push_back(0);
+		}
 	}
-
-	GLuint buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*VERTEX_SIZE*count, data, GL_STATIC_DRAW);
-	delete[] data;
-
-	GLint a_position = programRect->GetAttribLocation("a_position");			
-	glVertexAttribPointer(a_position, VERTEX_SIZE, GL_FLOAT, GL_FALSE, 0, 0);
-	programRect->SetUniformValue("u_color", COLOR_SIZE, (GLfloat)color.r/255, (GLfloat)color.g/255, (GLfloat)color.b/255, (GLfloat)color.a/255);
-
-	glEnableVertexAttribArray(a_position);
-	if (mode == LineLoop)
-		glDrawArrays(GL_LINE_LOOP, 0, count);
-	else if (mode == LineStrip)
-		glDrawArrays(GL_LINE_STRIP, 0, count);
 	else if (mode == ConvexFilledPolygon)
-		glDrawArrays(GL_TRIANGLE_FAN, 0, count);
-	else if (mode == FilledTriangulation)
-		glDrawArrays(GL_TRIANGLES, 0, count);
-	glDisableVertexAttribArray(a_position);
+	{
+		state.mode = GL_TRIANGLES;
+		for(unsigned int i=1; i+1<count; i++)
+		{
+			order.push_back(0);
+			order.push_back(i);
+			order.push_back(i+1);
+		}
+	}
+	else
+	{
+		state.mode = GL_TRIANGLES;
+		for(unsigned int i=0; i<count; i++)
+		{
+			order.push_back(i);
+		}
+	}
+	if (order.empty()) return;
 
-	glDeleteBuffers(1, &buffer);
+	GLfloat* data = new GLfloat[order.size()*VERTEX_SIZE];
+	for(unsigned int i=0; i<order.size(); i++)
+	{
+		data[i*VERTEX_SIZE] = -1.0f + (GLfloat)points[order[i]].x*2/width;
+		data[i*VERTEX_SIZE + 1] = 1.0f - (GLfloat)points[order[i]].y*2/height;
+	}
+	addToBatch(state, data, order.size());
+	delete[] data;
 }
 
 void GLVideoDriver::SetPixel(short x, short y, const Color& color, bool clipped) {
@@ -462,12 +612,38 @@ void GLVideoDriver::SetPixel(short x, short y, const Color& color, bool clipped)
 		}
 	}
 
-	Region region(x, y, 1, 1);
-	clearRect(region, color);
+	Point pt[] = { Point(x, y), Point(x + 1, y), Point(x + 1, y + 1), Point(x, y + 1) };
+	drawPolygon(pt, 4, color, ConvexFilledPolygon);
+}
+
+void GLVideoDriver::DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped)
+{
+	// the pixels become the triangles of one polygon
+	Region clip = clipped ? Region(xCorr, yCorr, Viewport.w, Viewport.h) : Region(0, 0, disp->w, disp->h);
+	short dx = clipped ? xCorr : 0;
+	short dy = clipped ? yCorr : 0;
+	std::vector<Point> triangles;
+	triangles.reserve(points.size()*6);
+	for (unsigned int i=0; i<points.size(); i++)
+	{
+		short x = points[i].x + dx;
+		short y = points[i].y + dy;
+		if (x < clip.x || y < clip.y || x >= clip.x + clip.w || y >= clip.y + clip.h) continue;
+		triangles.push_back(Point(x, y));
+		triangles.push_back(Point(x + 1, y));
+		triangles.push_back(Point(x + 1, y + 1));
+		triangles.push_back(Point(x, y));
+		triangles.push_back(Point(x + 1, y + 1));
+		triangles.push_back(Point(x, y + 1));
+	}
+	if (triangles.empty()) return;
+	drawPolygon(&triangles[0], triangles.size(), color, FilledTriangulation);
 }
 
 void GLVideoDriver::drawEllipse(int cx /*center*/, int cy /*center*/, unsigned short xr, unsigned short yr, float thickness, const Color& color)
 {
+	// the ellipses are drawn right away, each needs its own viewport and uniforms
+	flushBatch();
 	glDisable(GL_SCISSOR_TEST);
 	const float support = 0.75;
 	useProgram(programEllipse);
@@ -501,6 +677,7 @@ void GLVideoDriver::drawEllipse(int cx /*center*/, int cy /*center*/, unsigned s
 	
 	glEnableVertexAttribArray(a_position);
 	glEnableVertexAttribArray(a_texCoord);
+	FrameStats::Count(FRAME_DRAWS);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	glDisableVertexAttribArray(a_texCoord);
 	glDisableVertexAttribArray(a_position);
@@ -558,15 +735,20 @@ void GLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, i
 	Color tileTint;
 
 	if (core->GetGame()) {
-		totint = core->GetGame()->GetGlobalTint();
+		totint = core->GetGame()->GetSpriteTint();
 		if (totint) {
 			tileTint = *totint;
 			tileTint.a = 0xFF;
 		}
 	}
 
+	GLuint maskTexture = mask ? ((GLTextureSprite2D*)mask)->GetMaskTexture() : 0;
+	// the compressed tiles are drawn without the palette, so they can't be masked or recolored
+	GLuint compressedTexture = 0;
+	if (tileFormat && !mask && !(blitFlags & (BLIT_GREY|BLIT_SEPIA)))
+		compressedTexture = ((GLTextureSprite2D*)spr)->GetCompressedTexture(tileFormat);
 	GLBlitSprite((GLTextureSprite2D*)spr, src, dst,
-						NULL, blitFlags, (totint ? &tileTint : NULL), (GLTextureSprite2D*)mask);
+						NULL, blitFlags, (totint ? &tileTint : NULL), maskTexture, compressedTexture);
 }
 
 void GLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned int flags, Color tint,
@@ -614,7 +796,6 @@ void GLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned i
 #endif
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, glSprite->Width, glSprite->Height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, (GLvoid*) data);
 			delete[] data;
-			flags |= BLIT_EXTERNAL_MASK;
 		}
 	}
 
@@ -631,25 +812,21 @@ void GLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned i
 	Region dst(tx + dx, ty + dy, w, h);
 
 	if (!(flags & BLIT_TINTED) || (tint.r == 0 && tint.g == 0 && tint.b == 0))
-		GLBlitSprite(glSprite, src, dst, palette, flags);
+		GLBlitSprite(glSprite, src, dst, palette, flags, NULL, coverTexture);
 	else
-		GLBlitSprite(glSprite, src, dst, palette, flags, &tint);
+		GLBlitSprite(glSprite, src, dst, palette, flags, &tint, coverTexture);
 	if (coverTexture != 0)
 	{
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glDeleteTextures(1, &coverTexture);
+		// the blit may still be waiting in the batch
+		textureAtlas->DeleteTexture(coverTexture);
 	}
 }
 
 void GLVideoDriver::DrawRect(const Region& rgn, const Color& color, bool fill, bool clipped)
 {
-	if (fill && SDL_ALPHA_OPAQUE == color.a)
-	{
-		return clearRect(rgn, color); // possible to work faster than shader but a lot... may be disable in future
-	}
 	Point pt[] = { Point(rgn.x, rgn.y), Point(rgn.x + rgn.w, rgn.y), Point(rgn.x + rgn.w, rgn.y + rgn.h), Point(rgn.x, rgn.y + rgn.h) };
-	if (clipped)
+	// the opaque fills were screen clears once, they never took the viewport into account
+	if (clipped && !(fill && SDL_ALPHA_OPAQUE == color.a))
 	{
 		for(int i=0; i<4; i++)
 		{
@@ -776,44 +953,380 @@ void GLVideoDriver::DrawCircle(short cx, short cy, unsigned short r, const Color
 
 int GLVideoDriver::SwapBuffers()
 {	
+	// everything is redrawn each frame, so there is no damage to track
+	MarkScreenDirty();
+	UpdateOverlays();
 	int val = SDLVideoDriver::SwapBuffers();
+	ClearDirty();
+	flushBatch();
 	SDL_GL_SwapWindow(window);
 	paletteManager->ClearUnused(true);
+	textureAtlas->Recycle();
 	core->RedrawAll();
 	spritesPerFrame = 0;
 	return val;
 }
 
+void GLVideoDriver::UpdateFogOfWar(const ieByte* explored, const ieByte* visible, int w, int h, int firstRow, int rowCount)
+{
+	if (w <= 0 || h <= 0) return;
+	// the queued fog was drawn from the old cells
+	flushBatch();
+	if (fogTexture == 0 || w != fogWidth || h != fogHeight)
+	{
+		if (fogTexture != 0) glDeleteTextures(1, &fogTexture);
+		fogWidth = w;
+		fogHeight = h;
+		// everything outside the map counts as explored and visible
+		std::vector<GLubyte> border((w + 2)*(h + 2)*2, 0xFF);
+		glGenTextures(1, &fogTexture);
+		glBindTexture(GL_TEXTURE_2D, fogTexture);
+		// the filtering blends the cells into each other
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, w + 2, h + 2, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, (GLvoid*) &border[0]);
+		firstRow = 0;
+		rowCount = h;
+	}
+	if (firstRow < 0) firstRow = 0;
+	if (firstRow + rowCount > h) rowCount = h - firstRow;
+	if (rowCount <= 0) return;
+
+	// explored in the luminance, visible in the alpha
+	std::vector<GLubyte> cells(w*rowCount*2);
+	for (int y = 0; y < rowCount; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			int bit = (firstRow + y)*w + x;
+			int mask = 1 << (bit % 8);
+			cells[(y*w + x)*2] = (explored[bit/8] & mask) ? 0xFF : 0;
+			cells[(y*w + x)*2 + 1] = (visible[bit/8] & mask) ? 0xFF : 0;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, fogTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+#ifdef USE_GL
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 1, firstRow + 1, w, rowCount, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, (GLvoid*) &cells[0]);
+}
+
+bool GLVideoDriver::DrawFogOfWar(const Region& rgn, int originX, int originY, int cellSize)
+{
+	if (fogTexture == 0 || cellSize <= 0) return false;
+
+	GLBatchState state;
+	state.program = programFog;
+	state.mode = GL_TRIANGLES;
+	state.vertexSize = VERTEX_SIZE + TEX_SIZE;
+	state.scissor = ClippedDrawingRect(rgn);
+	state.textures[0] = fogTexture;
+
+	// texel i+1 holds cell i, so the texel centers are the cell centers
+	GLfloat texLeft = ((GLfloat)(rgn.x - originX)/cellSize + 1)/(fogWidth + 2);
+	GLfloat texRight = ((GLfloat)(rgn.x + rgn.w - originX)/cellSize + 1)/(fogWidth + 2);
+	GLfloat texTop = ((GLfloat)(rgn.y - originY)/cellSize + 1)/(fogHeight + 2);
+	GLfloat texBottom = ((GLfloat)(rgn.y + rgn.h - originY)/cellSize + 1)/(fogHeight + 2);
+
+	GLfloat left = -1.0f + (GLfloat)rgn.x*2/width;
+	GLfloat right = -1.0f + (GLfloat)(rgn.x + rgn.w)*2/width;
+	GLfloat top = 1.0f - (GLfloat)rgn.y*2/height;
+	GLfloat bottom = 1.0f - (GLfloat)(rgn.y + rgn.h)*2/height;
+
+	GLfloat data[] =
+	{
+		left, top, texLeft, texTop,
+		right, top, texRight, texTop,
+		left, bottom, texLeft, texBottom,
+		right, top, texRight, texTop,
+		left, bottom, texLeft, texBottom,
+		right, bottom, texRight, texBottom
+	};
+	addToBatch(state, data, 6);
+	return true;
+}
+
+void GLVideoDriver::TintGameArea(const Region& rgn, const Color& tint)
+{
+	// a quad in the tint colour, the blending multiplies it into the frame
+	flushBatch();
+
+	GLBatchState state;
+	state.program = programRect;
+	state.mode = GL_TRIANGLES;
+	state.vertexSize = VERTEX_SIZE;
+	state.scissor = ClippedDrawingRect(rgn);
+	state.color[0] = (GLfloat)tint.r/255;
+	state.color[1] = (GLfloat)tint.g/255;
+	state.color[2] = (GLfloat)tint.b/255;
+	state.color[3] = 1.0f;
+
+	GLfloat left = -1.0f + (GLfloat)rgn.x*2/width;
+	GLfloat right = -1.0f + (GLfloat)(rgn.x + rgn.w)*2/width;
+	GLfloat top = 1.0f - (GLfloat)rgn.y*2/height;
+	GLfloat bottom = 1.0f - (GLfloat)(rgn.y + rgn.h)*2/height;
+
+	GLfloat data[] =
+	{
+		left, top,
+		right, top,
+		left, bottom,
+		right, top,
+		left, bottom,
+		right, bottom
+	};
+	addToBatch(state, data, 6);
+	glBlendFunc(GL_DST_COLOR, GL_ZERO);
+	flushBatch();
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void GLVideoDriver::InitMovieScreen(int &w, int &h, bool yuv)
+{
+	movieYUV = yuv;
+	if (!yuv)
+	{
+		SDL20VideoDriver::InitMovieScreen(w, h, yuv);
+		return;
+	}
+
+	// the frames are converted in the shader, so the SDL renderer isn't needed
+	flushBatch();
+	createMovieTextures(w, h);
+	glDisable(GL_BLEND);
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	w = width;
+	h = height;
+	//setting the subtitle region to the bottom 1/4th of the screen
+	subtitleregion.w = w;
+	subtitleregion.h = h/4;
+	subtitleregion.x = 0;
+	subtitleregion.y = h-h/4;
+}
+
+void GLVideoDriver::createMovieTextures(int w, int h)
+{
+	freeMovieTextures();
+	movieWidth = w;
+	movieHeight = h;
+	glGenTextures(3, movieTextures);
+	for (int i = 0; i < 3; i++)
+	{
+		// the chroma planes are subsampled in both directions
+		int planeWidth = i ? (w + 1)/2 : w;
+		int planeHeight = i ? (h + 1)/2 : h;
+		glBindTexture(GL_TEXTURE_2D, movieTextures[i]);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, planeWidth, planeHeight, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+	}
+}
+
+void GLVideoDriver::freeMovieTextures()
+{
+	if (movieTextures[0]) glDeleteTextures(3, movieTextures);
+	movieTextures[0] = movieTextures[1] = movieTextures[2] = 0;
+	movieWidth = movieHeight = 0;
+	moviePlane.clear();
+}
+
+void GLVideoDriver::uploadMoviePlane(int plane, const unsigned char* data, unsigned int stride, int w, int h)
+{
+	glBindTexture(GL_TEXTURE_2D, movieTextures[plane]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+#ifdef USE_GL
+	if (moviePixelBuffers[plane])
+	{
+		// orphaning the buffer lets the driver copy the frame while the last one is still in use
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, moviePixelBuffers[plane]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, w*h, NULL, GL_STREAM_DRAW);
+		GLubyte* mapped = (GLubyte*) glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+		if (mapped)
+		{
+			for (int row = 0; row < h; row++)
+			{
+				memcpy(mapped + row*w, data + row*stride, w);
+			}
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#else
+	if (stride != (unsigned int) w)
+	{
+		moviePlane.resize(w*h);
+		for (int row = 0; row < h; row++)
+		{
+			memcpy(&moviePlane[row*w], data + row*stride, w);
+		}
+		data = &moviePlane[0];
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
+#endif
+}
+
+void GLVideoDriver::showYUVFrame(unsigned char** buf, unsigned int *strides,
+				  unsigned int bufw, unsigned int bufh,
+				  unsigned int w, unsigned int h,
+				  unsigned int dstx, unsigned int dsty,
+				  ieDword titleref)
+{
+	if (!movieYUV)
+	{
+		SDL20VideoDriver::showYUVFrame(buf, strides, bufw, bufh, w, h, dstx, dsty, titleref);
+		return;
+	}
+	if ((int) w != movieWidth || (int) h != movieHeight)
+	{
+		createMovieTextures(w, h);
+	}
+
+	// the planes are swapped the same way as in SDL20VideoDriver::showYUVFrame
+	uploadMoviePlane(0, buf[0], strides[0], w, h);
+	uploadMoviePlane(1, buf[2], strides[2], (w + 1)/2, (h + 1)/2);
+	uploadMoviePlane(2, buf[1], strides[1], (w + 1)/2, (h + 1)/2);
+
+	GLfloat left = -1.0f + (GLfloat)dstx*2/width;
+	GLfloat right = -1.0f + (GLfloat)(dstx + w)*2/width;
+	GLfloat top = 1.0f - (GLfloat)dsty*2/height;
+	GLfloat bottom = 1.0f - (GLfloat)(dsty + h)*2/height;
+	GLfloat data[] =
+	{
+		left, top, 0.0f, 0.0f,
+		right, top, 1.0f, 0.0f,
+		left, bottom, 0.0f, 1.0f,
+		right, bottom, 1.0f, 1.0f
+	};
+
+	useProgram(programYUV);
+	glViewport(GLViewport.x, GLViewport.y, GLViewport.w, GLViewport.h);
+	for (int i = 2; i >= 0; i--)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, movieTextures[i]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, batchBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(data), data, GL_STREAM_DRAW);
+	GLint a_position = programYUV->GetAttribLocation("a_position");
+	GLint a_texCoord = programYUV->GetAttribLocation("a_texCoord");
+	GLsizei stride = sizeof(GLfloat)*(VERTEX_SIZE + TEX_SIZE);
+	glVertexAttribPointer(a_position, VERTEX_SIZE, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(a_position);
+	glVertexAttribPointer(a_texCoord, TEX_SIZE, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(sizeof(GLfloat)*VERTEX_SIZE));
+	glEnableVertexAttribArray(a_texCoord);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	FrameStats::Count(FRAME_DRAWS);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glDisableVertexAttribArray(a_position);
+	glDisableVertexAttribArray(a_texCoord);
+	SDL_GL_SwapWindow(window);
+}
+
 void GLVideoDriver::DestroyMovieScreen()
 {
+	if (movieYUV)
+	{
+		freeMovieTextures();
+		movieYUV = false;
+	}
 	SDL20VideoDriver::DestroyMovieScreen();
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_SCISSOR_TEST);
 }
 
+GLTextureSprite2D* GLVideoDriver::createScreenshot(const Uint32* glPixels, unsigned int w, unsigned int h)
+{
+	Uint32* pixels = (Uint32*)malloc( w * h * 4 );
+	// flip pixels vertical
+	Uint32* pixelDstPointer = pixels;
+	const Uint32* pixelSrcPointer = glPixels + (h-1)*w;
+	for(unsigned int i=0; i<h; i++)
+	{
+		memcpy(pixelDstPointer, pixelSrcPointer, w*4);
+		pixelDstPointer += w;
+		pixelSrcPointer -= w;
+	}
+	GLTextureSprite2D* screenshot = new GLTextureSprite2D(w, h, 32, pixels, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
+	screenshot->SetAtlas(textureAtlas);
+	return screenshot;
+}
+
 Sprite2D* GLVideoDriver::GetScreenshot(Region r)
 {
 	unsigned int w = r.w ? r.w : width - r.x;
 	unsigned int h = r.h ? r.h : height - r.y;
 	
+	// read what was drawn so far
+	flushBatch();
 	Uint32* glPixels = (Uint32*)malloc( w * h * 4 );
-	Uint32* pixels = (Uint32*)malloc( w * h * 4 );
 #ifdef USE_GL
 	glReadBuffer(GL_BACK);
 #endif
 	glReadPixels(r.x, r.y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, glPixels);
-	// flip pixels vertical
-	Uint32* pixelDstPointer = pixels;
-	Uint32* pixelSrcPointer = glPixels + (h-1)*w;
-	for(unsigned int i=0; i<h; i++)
+	GLTextureSprite2D* screenshot = createScreenshot(glPixels, w, h);
+	free(glPixels);
+	return screenshot;
+}
+
+void GLVideoDriver::StartScreenshot(const Region& r)
+{
+	if (!screenshotBuffer)
 	{
-		memcpy(pixelDstPointer, pixelSrcPointer, w*4);
-		pixelDstPointer += w;
-		pixelSrcPointer -= w;
+		SDL20VideoDriver::StartScreenshot(r);
+		return;
 	}
-	free(glPixels);
-	Sprite2D* screenshot = new GLTextureSprite2D(w, h, 32, pixels, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
+#ifdef USE_GL
+	screenshotRegion = r;
+	if (!screenshotRegion.w) screenshotRegion.w = width - r.x;
+	if (!screenshotRegion.h) screenshotRegion.h = height - r.y;
+	flushBatch();
+	// into the pixel buffer the copy is queued like the drawing, nothing waits for it until it is mapped
+	glReadBuffer(GL_BACK);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, screenshotBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, screenshotRegion.w * screenshotRegion.h * 4, NULL, GL_STREAM_READ);
+	glReadPixels(r.x, r.y, screenshotRegion.w, screenshotRegion.h, GL_RGBA, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	screenshotPending = true;
+#endif
+}
+
+Sprite2D* GLVideoDriver::FinishScreenshot()
+{
+	if (!screenshotPending)
+	{
+		return SDL20VideoDriver::FinishScreenshot();
+	}
+	screenshotPending = false;
+	GLTextureSprite2D* screenshot = NULL;
+#ifdef USE_GL
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, screenshotBuffer);
+	const Uint32* glPixels = (const Uint32*) glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (glPixels)
+	{
+		screenshot = createScreenshot(glPixels, screenshotRegion.w, screenshotRegion.h);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!screenshot) Log(WARNING, "SDL 2 GL Driver", "Couldn't map the screenshot pixel buffer.");
+#endif
 	return screenshot;
 }
 
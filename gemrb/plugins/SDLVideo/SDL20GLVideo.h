@@ -8,15 +8,51 @@
 #define VERTEX_SIZE 2
 #define TEX_SIZE 2
 #define COLOR_SIZE 4
+#define PALETTE_SIZE 1
 
-#define BLIT_EXTERNAL_MASK 0x100
+// flush the batch before it gets this big, about a thousand sprites
+#define GL_BATCH_MAX_FLOATS 36864
 
 namespace GemRB 
 {
 	class GLTextureSprite2D;
 	class GLPaletteManager;
+	class GLTextureAtlas;
 	class GLSLProgram;
 
+	// everything the queued vertices are drawn with, the batch is flushed when it changes
+	struct GLBatchState
+	{
+		GLSLProgram* program;
+		GLenum mode;
+		GLsizei vertexSize; // in floats
+		GLuint textures[2]; // sprite and mask, the palettes all share one
+		GLfloat color[COLOR_SIZE]; // the tint of the sprites, the color of the primitives
+		GLfloat alphaModifier;
+		GLint shadowMode;
+		Region scissor;
+
+		GLBatchState()
+		{
+			program = NULL;
+			mode = GL_TRIANGLES;
+			vertexSize = VERTEX_SIZE;
+			textures[0] = textures[1] = 0;
+			color[0] = color[1] = color[2] = color[3] = 1.0f;
+			alphaModifier = 1.0f;
+			shadowMode = 1;
+		}
+		bool operator==(const GLBatchState& other) const
+		{
+			return program == other.program && mode == other.mode && vertexSize == other.vertexSize
+				&& textures[0] == other.textures[0] && textures[1] == other.textures[1]
+				&& color[0] == other.color[0] && color[1] == other.color[1] && color[2] == other.color[2] && color[3] == other.color[3]
+				&& alphaModifier == other.alphaModifier && shadowMode == other.shadowMode
+				&& scissor.x == other.scissor.x && scissor.y == other.scissor.y
+				&& scissor.w == other.scissor.w && scissor.h == other.scissor.h;
+		}
+	};
+
 	enum PointDrawingMode
 	{
 		LineStrip,
@@ -36,21 +72,48 @@ namespace GemRB
 		GLSLProgram* programPalSepia; // shader program for paletted sprites  with sepia effect
 		GLSLProgram* programRect; // shader program for drawing rects and lines
 		GLSLProgram* programEllipse; // shader program for drawing ellipses and circles
+		GLSLProgram* programFog; // shader program for the fog of war
+		GLSLProgram* programYUV; // shader program for converting the movie frames
 
 		Uint32 spritesPerFrame; // sprites counter
 		GLSLProgram* lastUsedProgram; // stores last used program to prevent switching if possible (switching may cause performance lack)
 
 		GLPaletteManager* paletteManager; // palette manager instance
+		GLTextureAtlas* textureAtlas; // shared textures for the small sprites
+		GLenum tileFormat; // the compressed format of the opaque area tiles, 0 keeps them paletted
 
 		GLTextureSprite2D *backgroundBuffer;
+		// explored and visible cells of the fog of war, with a border of explored and visible ones
+		GLuint fogTexture;
+		int fogWidth, fogHeight;
+		// the Y, U and V planes of the movie frames, streamed through the pixel buffers where there are any
+		GLuint movieTextures[3];
+		GLuint moviePixelBuffers[3];
+		int movieWidth, movieHeight;
+		bool movieYUV;
+		std::vector<GLubyte> moviePlane; // for packing the rows without pixel buffers or a row length
 		Region GLViewport;
+		// the screenshot being read back into the pixel buffer, without waiting for the drawing
+		GLuint screenshotBuffer;
+		Region screenshotRegion;
+		bool screenshotPending;
+
+		// the draws are queued up and sent together while nothing else changes
+		GLBatchState batchState;
+		std::vector<GLfloat> batchVertices;
+		GLuint batchBuffer;
 
 		void useProgram(GLSLProgram* program); // use this instead program->Use()
 		bool createPrograms();
-		void GLBlitSprite(GLTextureSprite2D* spr, const Region& src, const Region& dst, Palette* attachedPal = NULL, unsigned int flags = 0, const Color* tint = NULL, GLTextureSprite2D* mask = NULL);
-		void clearRect(const Region& rgn, const Color& color);
+		void GLBlitSprite(GLTextureSprite2D* spr, const Region& src, const Region& dst, Palette* attachedPal = NULL, unsigned int flags = 0, const Color* tint = NULL, GLuint maskTexture = 0, GLuint compressedTexture = 0);
+		void addToBatch(const GLBatchState& state, const GLfloat* vertices, unsigned int count);
+		void flushBatch();
 		void drawEllipse(int cx, int cy, unsigned short xr, unsigned short yr, float thickness, const Color& color);
 		void drawPolygon(Point* points, unsigned int count, const Color& color, PointDrawingMode mode);
+		void createMovieTextures(int w, int h);
+		void freeMovieTextures();
+		void uploadMoviePlane(int plane, const unsigned char* data, unsigned int stride, int w, int h);
+		GLTextureSprite2D* createScreenshot(const Uint32* glPixels, unsigned int w, unsigned int h);
 
 	public:
 		~GLVideoDriver();
@@ -60,6 +123,8 @@ namespace GemRB
 		void BlitSprite(const Sprite2D* spr, const Region& src, const Region& dst, Palette* palette);
 		void BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned int flags, Color tint, SpriteCover* cover, Palette *palette = NULL,	const Region* clip = NULL, bool anchor = false);
 		void BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, int y, const Region* clip, unsigned int flags);
+		// the tiles are batched and share textures already
+		Sprite2D* CreateTileCache(int /*w*/, int /*h*/) { return NULL; }
 		Sprite2D* CreateSprite(int w, int h, int bpp, ieDword rMask, ieDword gMask, ieDword bMask, ieDword aMask, void* pixels,	bool cK = false, int index = 0);
 		Sprite2D* CreateSprite8(int w, int h, void* pixels,	Palette* palette, bool cK, int index);
 		Sprite2D* CreatePalettedSprite(int w, int h, int bpp, void* pixels, Color* palette, bool cK = false, int index = 0);
@@ -71,9 +136,21 @@ namespace GemRB
 		void DrawEllipse(short cx, short cy, unsigned short xr, unsigned short yr, const Color& color, bool clipped = true);
 		void DrawCircle(short cx, short cy, unsigned short r, const Color& color, bool clipped = true);
 		void SetPixel(short x, short y, const Color& color, bool clipped = true);
+		void DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped = false);
 		/*void DrawEllipseSegment(short cx, short cy, unsigned short xr, unsigned short yr, const Color& color, double anglefrom, double angleto, bool drawlines = true, bool clipped = true);*/
+		void UpdateFogOfWar(const ieByte* explored, const ieByte* visible, int width, int height, int firstRow, int rowCount);
+		bool DrawFogOfWar(const Region& rgn, int originX, int originY, int cellSize);
+		bool CanTintGameArea() const { return true; }
+		void TintGameArea(const Region& rgn, const Color& tint);
+		void InitMovieScreen(int &w, int &h, bool yuv);
 		void DestroyMovieScreen();
+		void showYUVFrame(unsigned char** buf, unsigned int *strides, unsigned int bufw, unsigned int bufh,
+			unsigned int w, unsigned int h, unsigned int dstx, unsigned int dsty, ieDword titleref);
 		Sprite2D* GetScreenshot(Region r);
+		// reading back the framebuffer stalls the pipeline
+		bool CanCacheRegions() const { return false; }
+		void StartScreenshot(const Region& r);
+		Sprite2D* FinishScreenshot();
 
 		void DrawBackgroundBuffer();
 		void FreeBackgroundBuffer();
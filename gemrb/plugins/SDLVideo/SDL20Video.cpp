@@ -20,7 +20,10 @@
 
 #include "SDL20Video.h"
 
+#include "FrameStats.h"
 #include "Interface.h"
+#include "MemoryStats.h"
+#include "Tracer.h"
 
 #include "GUI/Button.h"
 #include "GUI/Console.h"
@@ -150,7 +153,7 @@ doneFormat:
 		width, height, SDL_GetPixelFormatName(format));
 	backBuf = SDL_CreateRGBSurface( 0, width, height,
 									bpp, r, g, b, a );
-	// tmpBuf is here as a truly ugly hack, so we can copy backBuf to tmpBuf before blitting cursors, and then back again after the screen is presented.
+	// tmpBuf is the composited frame: the damaged parts of backBuf with the cursors and tooltips on top
 	tmpBuf = SDL_CreateRGBSurface( 0, width, height, bpp, r, g, b, a );
 	this->bpp = bpp;
 
@@ -160,6 +163,7 @@ doneFormat:
 		return GEM_ERROR;
 	}
 	disp = backBuf;
+	MarkScreenDirty();
 
 	return GEM_OK;
 }
@@ -197,6 +201,8 @@ void SDL20VideoDriver::DestroyMovieScreen()
 	screenTexture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, width, height);
 	// destroy any events that took place during the movies
 	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+	// the new texture holds nothing yet
+	MarkScreenDirty();
 	SDL_RenderClear(renderer); // I guess the videos can potentially be a larger size then the game.
 }
 
@@ -235,22 +241,21 @@ void SDL20VideoDriver::showFrame(unsigned char* buf, unsigned int bufw,
 		}
 	} else {
 		Uint8 *src = buf;
-		SDL_Palette* palette;
-		palette = SDL_AllocPalette(256);
+		// expand the palette once, so every pixel is a single lookup
+		Uint32 colors[256];
 		for (int i = 0; i < 256; i++) {
-			palette->colors[i].r = ( *pal++ ) << 2;
-			palette->colors[i].g = ( *pal++ ) << 2;
-			palette->colors[i].b = ( *pal++ ) << 2;
+			color.r = ( *pal++ ) << 2;
+			color.g = ( *pal++ ) << 2;
+			color.b = ( *pal++ ) << 2;
+			// video player texture is of ARGB format
+			colors[i] = 0xFF000000|(color.r << 16)|(color.g << 8)|(color.b);
 		}
 		for (row = 0; row < bufh; ++row) {
 			dst = (Uint32*)((Uint8*)pixels + row * pitch);
 			for (col = 0; col < bufw; ++col) {
-				color = palette->colors[*src++];
-				// video player texture is of ARGB format
-				*dst++ = (0xFF000000|(color.r << 16)|(color.g << 8)|(color.b));
+				*dst++ = colors[*src++];
 			}
 		}
-		SDL_FreePalette(palette);
 	}
 	SDL_UnlockTexture(screenTexture);
 
@@ -331,16 +336,35 @@ void SDL20VideoDriver::showYUVFrame(unsigned char** buf, unsigned int *strides,
 
 int SDL20VideoDriver::SwapBuffers(void)
 {
-	//this is not pretty. We make a complete copy of the backBuf into tmpBuf, then copy it back after SDLVideoDriver::SwapBuffers has blitted cursors and tooltips, and SDL_UpdateTexture has copied it to the screentexture.
-	if (Cursor[CursorIndex] && !(MouseFlags & (MOUSE_DISABLED | MOUSE_HIDDEN))) {
-		SDL_BlitSurface(backBuf, NULL, tmpBuf, NULL);
+	TRACE_SCOPE("SDL20Video::SwapBuffers");
+	FlushBlits();
+	LimitFrameRate();
+	UpdateOverlays();
+
+	// tmpBuf holds what is on the screen: the damaged parts of backBuf are copied over
+	// and the cursors and tooltips are blitted on top, so backBuf itself stays clean
+	std::vector<Region>::const_iterator it;
+	for (it = dirtyRegions.begin(); it != dirtyRegions.end(); ++it) {
+		SDL_Rect rect = RectFromRegion(*it);
+		SDL_BlitSurface(backBuf, &rect, tmpBuf, &rect);
+	}
+	SDL_Surface* tmp = backBuf;
+	backBuf = tmpBuf; // FIXME: UGLY HACK!
+	DrawOverlays();
+	backBuf = tmp;
+
+	// nothing changed, the last frame is still on the screen
+	if (!IsDirty()) {
+		return PollEvents();
 	}
-	int ret = SDLVideoDriver::SwapBuffers();
 
-	SDL_UpdateTexture(screenTexture, NULL, backBuf->pixels, backBuf->pitch);
-	if (Cursor[CursorIndex] && !(MouseFlags & (MOUSE_DISABLED | MOUSE_HIDDEN))) {
-		SDL_BlitSurface(tmpBuf, NULL, backBuf, NULL);
+	int bytes = tmpBuf->format->BytesPerPixel;
+	for (it = dirtyRegions.begin(); it != dirtyRegions.end(); ++it) {
+		SDL_Rect rect = RectFromRegion(*it);
+		ieByte* pixels = (ieByte*) tmpBuf->pixels + rect.y * tmpBuf->pitch + rect.x * bytes;
+		SDL_UpdateTexture(screenTexture, &rect, pixels, tmpBuf->pitch);
 	}
+	ClearDirty();
 	/*
 	 Commenting this out because I get better performance (on iOS) with SDL_UpdateTexture
 	 Don't know how universal it is yet so leaving this in commented out just in case
@@ -372,9 +396,10 @@ int SDL20VideoDriver::SwapBuffers(void)
 	 }
 	 */
 	SDL_RenderClear(renderer);
+	FrameStats::Count(FRAME_DRAWS);
 	SDL_RenderCopy(renderer, screenTexture, NULL, NULL);
 	SDL_RenderPresent( renderer );
-	return ret;
+	return PollEvents();
 }
 
 int SDL20VideoDriver::PollEvents()
@@ -686,6 +711,12 @@ int SDL20VideoDriver::ProcessEvent(const SDL_Event & event)
 			}
 			break;
 		/* not user input events */
+		case SDL_APP_LOWMEMORY:
+			core->RequestTrimMemory(TRIM_COMPLETE);
+			break;
+		case SDL_APP_WILLENTERBACKGROUND:
+			core->RequestTrimMemory(TRIM_MODERATE);
+			break;
 		case SDL_WINDOWEVENT://SDL 1.2
 			switch (event.window.event) {
 				case SDL_WINDOWEVENT_MINIMIZED://SDL 1.3
@@ -712,6 +743,10 @@ int SDL20VideoDriver::ProcessEvent(const SDL_Event & event)
 					sleep(1);
 #endif
 					core->GetAudioDrv()->Resume();//this is for ANDROID mostly
+					MarkScreenDirty();
+					break;
+				case SDL_WINDOWEVENT_EXPOSED:
+					MarkScreenDirty();
 					break;
 					/*
 				case SDL_WINDOWEVENT_RESIZED: //SDL 1.2
@@ -805,6 +840,7 @@ bool SDL20VideoDriver::SetFullscreenMode(bool set)
 	}
 	if (SDL_SetWindowFullscreen(window, flags) == GEM_OK) {
 		fullscreen = set;
+		MarkScreenDirty();
 		return true;
 	}
 	return false;
@@ -21,18 +21,26 @@
 #include "SDLSurfaceSprite2D.h"
 #include "SDLVideo.h"
 
+#include "MemoryStats.h"
 #include "System/Logging.h"
 
 #include <SDL.h>
 
 namespace GemRB {
 
+static unsigned long SurfaceBytes(const SDL_Surface* surface)
+{
+	return surface ? surface->pitch * surface->h : 0;
+}
+
 SDLSurfaceSprite2D::SDLSurfaceSprite2D (int Width, int Height, int Bpp, void* pixels,
 										Uint32 rmask, Uint32 gmask, Uint32 bmask, Uint32 amask)
 	: Sprite2D(Width, Height, Bpp, pixels)
 {
 	surface = SDL_CreateRGBSurfaceFrom( pixels, Width, Height, Bpp < 8 ? 8 : Bpp, Width * ( Bpp / 8 ),
 									   rmask, gmask, bmask, amask );
+	palette = NULL;
+	MemoryStats::Add(MEM_SPRITES_SDL, SurfaceBytes(surface));
 }
 
 SDLSurfaceSprite2D::SDLSurfaceSprite2D(const SDLSurfaceSprite2D &obj)
@@ -41,6 +49,12 @@ SDLSurfaceSprite2D::SDLSurfaceSprite2D(const SDLSurfaceSprite2D &obj)
 	// SDL_ConvertSurface should copy colorkey/palette/pixels/surface RLE
 	surface = SDL_ConvertSurface(obj.surface, obj.surface->format, obj.surface->flags);
 	pixels = surface->pixels;
+	// the copy shares the palette until one of them is given another
+	palette = obj.palette;
+	if (palette) {
+		palette->acquire();
+	}
+	MemoryStats::Add(MEM_SPRITES_SDL, SurfaceBytes(surface));
 }
 
 SDLSurfaceSprite2D* SDLSurfaceSprite2D::copy() const
@@ -50,7 +64,11 @@ SDLSurfaceSprite2D* SDLSurfaceSprite2D::copy() const
 
 SDLSurfaceSprite2D::~SDLSurfaceSprite2D()
 {
+	MemoryStats::Remove(MEM_SPRITES_SDL, SurfaceBytes(surface));
 	SDL_FreeSurface(surface);
+	if (palette) {
+		palette->release();
+	}
 }
 
 /** Get the Palette of a Sprite */
@@ -59,10 +77,15 @@ Palette* SDLSurfaceSprite2D::GetPalette() const
 	if (surface->format->BytesPerPixel != 1) {
 		return NULL;
 	}
-	assert(surface->format->palette->ncolors <= 256);
-	Palette* pal = new Palette();
-	memcpy(pal->col, surface->format->palette->colors, surface->format->palette->ncolors * 4);
-	return pal;
+	if (!palette) {
+		// set through SDL alone, so the surface colours are all there is
+		assert(surface->format->palette->ncolors <= 256);
+		Palette* pal = new Palette();
+		memcpy(pal->col, surface->format->palette->colors, surface->format->palette->ncolors * 4);
+		return pal;
+	}
+	palette->acquire();
+	return palette;
 }
 
 const Color* SDLSurfaceSprite2D::GetPaletteColors() const
@@ -72,11 +95,25 @@ const Color* SDLSurfaceSprite2D::GetPaletteColors() const
 
 void SDLSurfaceSprite2D::SetPalette(Palette* pal)
 {
-	SetPalette(pal->col);
+	if (pal) {
+		pal->acquire();
+	}
+	if (palette) {
+		palette->release();
+	}
+	palette = pal;
+	if (pal) {
+		SDLVideoDriver::SetSurfacePalette(surface, (SDL_Color*)pal->col, 0x01 << Bpp);
+	}
 }
 
 void SDLSurfaceSprite2D::SetPalette(Color* pal)
 {
+	// loose colours, so no Palette matches the surface anymore
+	if (palette) {
+		palette->release();
+		palette = NULL;
+	}
 	SDLVideoDriver::SetSurfacePalette(surface, (SDL_Color*)pal, 0x01 << Bpp);
 }
 
@@ -132,6 +169,8 @@ bool SDLSurfaceSprite2D::ConvertFormatTo(int bpp, ieDword rmask, ieDword gmask,
 			SDL_FreeSurface(tmp);
 #endif
 			if (ns) {
+				MemoryStats::Remove(MEM_SPRITES_SDL, SurfaceBytes(surface), 0);
+				MemoryStats::Add(MEM_SPRITES_SDL, SurfaceBytes(ns), 0);
 				SDL_FreeSurface(surface);
 				if (freePixels) {
 					free((void*)pixels);
@@ -140,6 +179,11 @@ bool SDLSurfaceSprite2D::ConvertFormatTo(int bpp, ieDword rmask, ieDword gmask,
 				surface = ns;
 				pixels = surface->pixels;
 				Bpp = bpp;
+				// the colours are in the pixels now
+				if (palette) {
+					palette->release();
+					palette = NULL;
+				}
 				return true;
 			} else {
 				Log(MESSAGE, "SDLSurfaceSprite2D",
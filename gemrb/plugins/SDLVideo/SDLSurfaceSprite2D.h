@@ -28,9 +28,16 @@ struct SDL_Color;
 
 namespace GemRB {
 
+/* The indexed surfaces keep their pixels as they are and hold on to the
+ * Palette they were given, so handing it out or swapping it is only a
+ * matter of references and the 256 colours SDL keeps with the surface;
+ * the software blitters expand the pixels through it as they draw.
+ */
 class SDLSurfaceSprite2D : public Sprite2D {
 private:
 	SDL_Surface* surface;
+	// only for the indexed surfaces
+	Palette* palette;
 public:
 	SDLSurfaceSprite2D(int Width, int Height, int Bpp, void* pixels,
 					   ieDword rmask = 0, ieDword gmask = 0, ieDword bmask = 0, ieDword amask = 0);
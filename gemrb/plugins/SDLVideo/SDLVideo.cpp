@@ -21,14 +21,16 @@
 #include "SDLVideo.h"
 #include "SDLSurfaceSprite2D.h"
 
-#include "TileRenderer.inl"
 #include "SpriteRenderer.inl"
+#include "TileRenderer.inl" // uses the vector support of the sprite renderer
 
 #include "AnimationFactory.h"
-#include "Game.h" // for GetGlobalTint
+#include "FrameStats.h"
+#include "Game.h" // for GetSpriteTint
 #include "GameData.h"
 #include "Interface.h"
 #include "Palette.h"
+#include "Tracer.h"
 
 #include "GUI/Button.h"
 #include "GUI/Console.h"
@@ -62,22 +64,55 @@ using namespace GemRB;
 typedef Sint32 SDL_Keycode;
 #endif
 
+namespace GemRB {
+
+// draws its band of every queued game sprite, the main thread draws the first one
+class BandWorker : public Thread {
+public:
+	BandWorker(SDLVideoDriver *owner, unsigned int index) : driver(owner), band(index) {}
+	~BandWorker() { Join(); }
+protected:
+	void Run();
+private:
+	SDLVideoDriver *driver;
+	unsigned int band;
+};
+
+void BandWorker::Run()
+{
+	unsigned int generation = 0;
+	while (driver->WaitForBand(generation)) {
+		driver->DrawBand(band);
+		driver->BandFinished();
+	}
+}
+
+}
+
 SDLVideoDriver::SDLVideoDriver(void)
 {
 	xCorr = 0;
 	yCorr = 0;
 	lastTime = 0;
+	frameDue = 0;
 	backBuf=NULL;
 	extra=NULL;
 	lastMouseDownTime = lastMouseMoveTime = GetTickCount();
 	subtitlestrref = 0;
 	subtitletext = NULL;
 	disp = tmpBuf =  NULL;
+	redrawOverlays = true;
+	overlayCursor = NULL;
+	overlayMouseFlags = 0;
+	overlayTooltip = false;
+	bandsStarted = bandsStopping = false;
+	bandGeneration = bandsPending = 0;
 }
 
 SDLVideoDriver::~SDLVideoDriver(void)
 {
 	delete subtitletext;
+	StopBandWorkers();
 
 	if(backBuf) SDL_FreeSurface( backBuf );
 	if(extra) SDL_FreeSurface( extra );
@@ -105,25 +140,80 @@ int SDLVideoDriver::Init(void)
 
 int SDLVideoDriver::SwapBuffers(void)
 {
+	TRACE_SCOPE("SDLVideo::SwapBuffers");
+	FlushBlits();
+	LimitFrameRate();
+	DrawOverlays();
+	return PollEvents();
+}
+
+void SDLVideoDriver::LimitFrameRate()
+{
+	TRACE_SCOPE("SDLVideo::LimitFrameRate");
 	unsigned long time;
 	time = GetTickCount();
-	if (( time - lastTime ) < 33) {
 #ifndef NOFPSLIMIT
-		SDL_Delay( 33 - (time - lastTime) );
-#endif
-		time = GetTickCount();
+	if (core->MaxFPS > 0) {
+		// the frames keep to a schedule, so the time overslept doesn't add up,
+		// but after a frame late by more than one the schedule starts over
+		unsigned long frameTime = 1000 / core->MaxFPS;
+		unsigned long due = frameDue + frameTime;
+		if (time < due) {
+			SDL_Delay( due - time );
+			time = GetTickCount();
+			frameDue = due;
+		} else if (time - due < frameTime) {
+			frameDue = due;
+		} else {
+			frameDue = time;
+		}
 	}
+#endif
 	lastTime = time;
+}
 
-	if (Cursor[CursorIndex] && !(MouseFlags & (MOUSE_DISABLED | MOUSE_HIDDEN))) {
-		
+void SDLVideoDriver::UpdateOverlays()
+{
+	Sprite2D* cursor = NULL;
+	if (!(MouseFlags & (MOUSE_DISABLED | MOUSE_HIDDEN))) {
+		cursor = Cursor[CursorIndex];
+	}
+	// tooltips animate and go away on their own, so they are always redone
+	redrawOverlays = overlayTooltip || cursor != overlayCursor
+		|| (cursor && CursorPos != overlayCursorPos)
+		|| (MouseFlags & MOUSE_GRAYED) != overlayMouseFlags;
+	std::vector<Region>::const_iterator it;
+	for (it = overlayRegions.begin(); !redrawOverlays && it != overlayRegions.end(); ++it) {
+		redrawOverlays = IsDirty(*it);
+	}
+	if (!redrawOverlays) {
+		return;
+	}
+
+	std::vector<Region> covered;
+	covered.swap(overlayRegions);
+	for (it = covered.begin(); it != covered.end(); ++it) {
+		MarkDirty(*it);
+	}
+	overlayCursor = cursor;
+	overlayCursorPos = CursorPos;
+	overlayMouseFlags = MouseFlags & MOUSE_GRAYED;
+}
+
+void SDLVideoDriver::DrawOverlays()
+{
+	drawingOverlays = true;
+	if (redrawOverlays && Cursor[CursorIndex] && !(MouseFlags & (MOUSE_DISABLED | MOUSE_HIDDEN))) {
+		Sprite2D* cursor = Cursor[CursorIndex];
 		if (MouseFlags&MOUSE_GRAYED) {
 			//used for greyscale blitting, fadeColor is unused
-			BlitGameSprite(Cursor[CursorIndex], CursorPos.x, CursorPos.y, BLIT_GREY, fadeColor, NULL, NULL, NULL, true);
+			BlitGameSprite(cursor, CursorPos.x, CursorPos.y, BLIT_GREY, fadeColor, NULL, NULL, NULL, true);
 		} else {
-			BlitSprite(Cursor[CursorIndex], CursorPos.x, CursorPos.y, true);
+			BlitSprite(cursor, CursorPos.x, CursorPos.y, true);
 		}
+		MarkDirty(Region(CursorPos.x - cursor->XPos, CursorPos.y - cursor->YPos, cursor->Width, cursor->Height));
 	}
+	size_t overlays = overlayRegions.size();
 	if (!(MouseFlags & MOUSE_NO_TOOLTIPS)) {
 		//handle tooltips
 		unsigned int delay = core->TooltipDelay;
@@ -139,18 +229,92 @@ int SDLVideoDriver::SwapBuffers(void)
 			core->DrawTooltip();
 		}
 	}
+	overlayTooltip = overlayRegions.size() != overlays;
+	drawingOverlays = false;
+}
 
-	return PollEvents();
+// motion and scrolling events only matter in sum, so runs of them can be merged
+static bool Coalescable(const SDL_Event &event)
+{
+	switch (event.type) {
+		case SDL_MOUSEMOTION:
+#if SDL_VERSION_ATLEAST(1,3,0)
+		case SDL_MOUSEWHEEL:
+		case SDL_FINGERMOTION:
+#endif
+			return true;
+		default:
+			return false;
+	}
+}
+
+// folds event into pending if both are the same kind of motion or scrolling,
+// only the end position matters for those, while the deltas add up
+static bool CoalesceEvent(SDL_Event &pending, const SDL_Event &event)
+{
+	if (pending.type != event.type) {
+		return false;
+	}
+	switch (event.type) {
+		case SDL_MOUSEMOTION:
+			pending.motion.x = event.motion.x;
+			pending.motion.y = event.motion.y;
+			pending.motion.xrel += event.motion.xrel;
+			pending.motion.yrel += event.motion.yrel;
+			pending.motion.state = event.motion.state;
+			return true;
+#if SDL_VERSION_ATLEAST(1,3,0)
+		case SDL_MOUSEWHEEL:
+			pending.wheel.x += event.wheel.x;
+			pending.wheel.y += event.wheel.y;
+			return true;
+		case SDL_FINGERMOTION:
+			if (pending.tfinger.fingerId != event.tfinger.fingerId) {
+				return false;
+			}
+			pending.tfinger.x = event.tfinger.x;
+			pending.tfinger.y = event.tfinger.y;
+			pending.tfinger.dx += event.tfinger.dx;
+			pending.tfinger.dy += event.tfinger.dy;
+			return true;
+#endif
+		default:
+			return false;
+	}
 }
 
 int SDLVideoDriver::PollEvents()
 {
+	TRACE_SCOPE("SDLVideo::PollEvents");
+	FrameTimer timer(FRAME_INPUT);
 	int ret = GEM_OK;
 	SDL_Event currentEvent;
+	// a run of motion or scroll events is merged and dispatched once, as soon
+	// as anything else (e.g. a click) comes in, so the ordering stays intact
+	SDL_Event pendingEvent;
+	bool pending = false;
 
 	while (ret != GEM_ERROR && SDL_PollEvent(&currentEvent)) {
+		if (pending) {
+			if (CoalesceEvent(pendingEvent, currentEvent)) {
+				continue;
+			}
+			pending = false;
+			ret = ProcessEvent(pendingEvent);
+			if (ret == GEM_ERROR) {
+				break;
+			}
+		}
+		if (Coalescable(currentEvent)) {
+			pendingEvent = currentEvent;
+			pending = true;
+			continue;
+		}
 		ret = ProcessEvent(currentEvent);
 	}
+	if (pending && ret != GEM_ERROR) {
+		ret = ProcessEvent(pendingEvent);
+	}
 
 	if (ret == GEM_OK && !(MouseFlags & (MOUSE_DISABLED | MOUSE_GRAYED))
 		&& lastTime>lastMouseDownTime
@@ -382,7 +546,15 @@ Sprite2D* SDLVideoDriver::CreateSprite(int w, int h, int bpp, ieDword rMask,
 Sprite2D* SDLVideoDriver::CreateSprite8(int w, int h, void* pixels,
 										Palette* palette, bool cK, int index)
 {
-	return CreatePalettedSprite(w, h, 8, pixels, palette->col, cK, index);
+	if (palette == NULL) return NULL;
+
+	// holds on to the palette itself, so GetPalette doesn't have to copy it
+	SDLSurfaceSprite2D* spr = new SDLSurfaceSprite2D(w, h, 8, pixels);
+	spr->SetPalette(palette);
+	if (cK) {
+		spr->SetColorKey(index);
+	}
+	return spr;
 }
 
 Sprite2D* SDLVideoDriver::CreatePalettedSprite(int w, int h, int bpp, void* pixels,
@@ -400,6 +572,8 @@ Sprite2D* SDLVideoDriver::CreatePalettedSprite(int w, int h, int bpp, void* pixe
 
 void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, int y, const Region* clip, unsigned int flags)
 {
+	FrameStats::Count(FRAME_BLITS);
+	FlushBlits();
 	if (spr->BAM) {
 		Log(ERROR, "SDLVideo", "Tile blit not supported for this sprite");
 		return;
@@ -408,8 +582,36 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	x -= Viewport.x;
 	y -= Viewport.y;
 
-	Region fClip = ClippedDrawingRect(Region(x, y, 64, 64), clip);
+	BlitTileInto(backBuf, spr, mask, x, y, ClippedDrawingRect(Region(x, y, 64, 64), clip), flags);
+}
 
+Sprite2D* SDLVideoDriver::CreateTileCache(int w, int h)
+{
+	SDL_PixelFormat* fmt = backBuf->format;
+	// the cells of the animated tiles are drawn over, so they may stay black
+	void* pixels = calloc(w * h, fmt->BytesPerPixel);
+	return new SDLSurfaceSprite2D(w, h, fmt->BitsPerPixel, pixels, fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+}
+
+void SDLVideoDriver::BlitTileToCache(Sprite2D* cache, const Sprite2D* spr, const Sprite2D* mask,
+									 int x, int y, unsigned int flags)
+{
+	if (spr->BAM) {
+		Log(ERROR, "SDLVideo", "Tile blit not supported for this sprite");
+		return;
+	}
+
+	SDL_Surface* target = ((SDLSurfaceSprite2D*)cache)->GetSurface();
+	Region fClip = Region(x, y, 64, 64).Intersect(Region(0, 0, cache->Width, cache->Height));
+	if (fClip.Dimensions().IsEmpty()) {
+		return;
+	}
+	BlitTileInto(target, spr, mask, x, y, fClip, flags);
+}
+
+void SDLVideoDriver::BlitTileInto(SDL_Surface* target, const Sprite2D* spr, const Sprite2D* mask,
+								  int x, int y, const Region& fClip, unsigned int flags)
+{
 	const Uint8* data = (const Uint8*)spr->pixels;
 	const SDL_Color* pal = reinterpret_cast<const SDL_Color*>(spr->GetPaletteColors());
 
@@ -424,7 +626,7 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	Color tintcol = {255,255,255,0};
 
 	if (core->GetGame()) {
-		const Color* totint = core->GetGame()->GetGlobalTint();
+		const Color* totint = core->GetGame()->GetSpriteTint();
 		if (totint) {
 			tintcol = *totint;
 			tint = true;
@@ -432,20 +634,20 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	}
 
 #define DO_BLIT \
-		if (backBuf->format->BytesPerPixel == 4) \
-			BlitTile_internal<Uint32>(backBuf, x, y, fClip.x - x, fClip.y - y, fClip.w, fClip.h, data, pal, mask_data, ck, T, B); \
+		if (target->format->BytesPerPixel == 4) \
+			BlitTile_internal<Uint32>(target, x, y, fClip.x - x, fClip.y - y, fClip.w, fClip.h, data, pal, mask_data, ck, T, B); \
 		else \
-			BlitTile_internal<Uint16>(backBuf, x, y, fClip.x - x, fClip.y - y, fClip.w, fClip.h, data, pal, mask_data, ck, T, B); \
+			BlitTile_internal<Uint16>(target, x, y, fClip.x - x, fClip.y - y, fClip.w, fClip.h, data, pal, mask_data, ck, T, B); \
 
 	if (flags & TILE_GREY) {
 
 		if (flags & TILE_HALFTRANS) {
-			TRBlender_HalfTrans B(backBuf->format);
+			TRBlender_HalfTrans B(target->format);
 
 			TRTinter_Grey T(tintcol);
 			DO_BLIT
 		} else {
-			TRBlender_Opaque B(backBuf->format);
+			TRBlender_Opaque B(target->format);
 
 			TRTinter_Grey T(tintcol);
 			DO_BLIT
@@ -454,12 +656,12 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	} else if (flags & TILE_SEPIA) {
 
 		if (flags & TILE_HALFTRANS) {
-			TRBlender_HalfTrans B(backBuf->format);
+			TRBlender_HalfTrans B(target->format);
 
 			TRTinter_Sepia T(tintcol);
 			DO_BLIT
 		} else {
-			TRBlender_Opaque B(backBuf->format);
+			TRBlender_Opaque B(target->format);
 
 			TRTinter_Sepia T(tintcol);
 			DO_BLIT
@@ -468,7 +670,7 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 	} else {
 
 		if (flags & TILE_HALFTRANS) {
-			TRBlender_HalfTrans B(backBuf->format);
+			TRBlender_HalfTrans B(target->format);
 
 			if (tint) {
 				TRTinter_Tint T(tintcol);
@@ -478,7 +680,7 @@ void SDLVideoDriver::BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x,
 				DO_BLIT
 			}
 		} else {
-			TRBlender_Opaque B(backBuf->format);
+			TRBlender_Opaque B(target->format);
 
 			if (tint) {
 				TRTinter_Tint T(tintcol);
@@ -527,6 +729,8 @@ void SDLVideoDriver::BlitSprite(const Sprite2D* spr, int x, int y, bool anchor,
 
 void SDLVideoDriver::BlitSprite(const Sprite2D* spr, const Region& src, const Region& dst, Palette* palette)
 {
+	FrameStats::Count(FRAME_BLITS);
+	FlushBlits();
 	if (dst.w <= 0 || dst.h <= 0)
 		return; // we already know blit fails
 
@@ -605,6 +809,7 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 			palette->release(); // GetPalette increases the ref count
 		}
 	}
+	FrameStats::Count(FRAME_BLITS);
 
 	// global tint is handled by the callers
 
@@ -638,7 +843,6 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 	// other combinations use general case
 
 
-	const Uint8* srcdata = (const Uint8*)spr->pixels;
 	int tx = x - spr->XPos;
 	int ty = y - spr->YPos;
 	if (!anchor) {
@@ -650,7 +854,45 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 	if (finalclip.w <= 0 || finalclip.h <= 0)
 		return;
 
-	SDL_LockSurface(backBuf);
+	QueuedBlit blit;
+	blit.spr = spr;
+	blit.tx = tx;
+	blit.ty = ty;
+	blit.flags = flags;
+	blit.tint = tint;
+	blit.cover = cover;
+	blit.palette = palette;
+	blit.clip = finalclip;
+
+	if (!bandsStarted) StartBandWorkers();
+	if (bandWorkers.empty()) {
+		SDL_LockSurface(backBuf);
+		RenderGameSprite(blit, finalclip);
+		SDL_UnlockSurface(backBuf);
+		return;
+	}
+
+	// drawn by the raster threads on the next flush, so hold on to everything
+	// and build the row index of the RLE data here, it isn't built thread safely
+	const_cast<Sprite2D*>(spr)->acquire();
+	if (palette) palette->acquire();
+	if (spr->BAM) spr->GetRLERows();
+	queuedBlits.push_back(blit);
+}
+
+void SDLVideoDriver::RenderGameSprite(const QueuedBlit& blit, const Region& finalclip)
+{
+	const Sprite2D* spr = blit.spr;
+	const Uint8* srcdata = (const Uint8*)spr->pixels;
+	int tx = blit.tx;
+	int ty = blit.ty;
+	unsigned int flags = blit.flags;
+	Color tint = blit.tint;
+	SpriteCover* cover = blit.cover;
+	Palette* palette = blit.palette;
+
+	// implicit flags, set by BlitGameSprite:
+	const unsigned int blit_PALETTEALPHA = 0x80000000U;
 
 	bool hflip = spr->BAM ? (spr->renderFlags&BLIT_MIRRORX) : false;
 	bool vflip = spr->BAM ? (spr->renderFlags&BLIT_MIRRORY) : false;
@@ -833,12 +1075,117 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 
 	}
 
+}
+
+void SDLVideoDriver::StartBandWorkers()
+{
+	bandsStarted = true;
+	int threads = core->RenderThreads;
+	if (threads < 0) {
+		threads = Thread::GetProcessorCount() - 1;
+	}
+	if (threads <= 0) {
+		return;
+	}
+	// settle the lazy check of the renderers before the threads share it
+	SRHasVector();
+	for (int i = 0; i < threads; i++) {
+		BandWorker *worker = new BandWorker(this, i + 1);
+		if (!worker->Start()) {
+			Log(ERROR, "SDLVideo", "Couldn't start raster thread %d!", i);
+			delete worker;
+			break;
+		}
+		bandWorkers.push_back(worker);
+	}
+	if (bandWorkers.size()) {
+		Log(MESSAGE, "SDLVideo", "Started %d raster threads.", (int) bandWorkers.size());
+	}
+}
+
+void SDLVideoDriver::StopBandWorkers()
+{
+	{
+		MutexLock l(bandLock);
+		bandsStopping = true;
+		bandWakeup.Broadcast();
+	}
+	for (size_t i = 0; i < bandWorkers.size(); i++) {
+		delete bandWorkers[i];
+	}
+	bandWorkers.clear();
+}
+
+bool SDLVideoDriver::WaitForBand(unsigned int& generation)
+{
+	MutexLock l(bandLock);
+	while (!bandsStopping && generation == bandGeneration) {
+		bandWakeup.Wait(bandLock);
+	}
+	generation = bandGeneration;
+	return !bandsStopping;
+}
+
+void SDLVideoDriver::BandFinished()
+{
+	MutexLock l(bandLock);
+	if (--bandsPending == 0) {
+		bandDone.Signal();
+	}
+}
+
+void SDLVideoDriver::DrawBand(unsigned int band)
+{
+	// every band replays all the blits in order, so the overlaps come out
+	// the same as if they were drawn one by one
+	unsigned int bands = bandWorkers.size() + 1;
+	int top = backBuf->h * band / bands;
+	int bottom = backBuf->h * (band + 1) / bands;
+	Region bandRgn(0, top, backBuf->w, bottom - top);
+	for (size_t i = 0; i < queuedBlits.size(); i++) {
+		Region clip = queuedBlits[i].clip.Intersect(bandRgn);
+		if (clip.w > 0 && clip.h > 0) {
+			RenderGameSprite(queuedBlits[i], clip);
+		}
+	}
+}
+
+void SDLVideoDriver::DrawQueuedBlits()
+{
+	// the lock count of the surface isn't thread safe, so it is only taken here
+	SDL_LockSurface(backBuf);
+	{
+		MutexLock l(bandLock);
+		bandsPending = bandWorkers.size();
+		bandGeneration++;
+		bandWakeup.Broadcast();
+	}
+	DrawBand(0);
+	{
+		MutexLock l(bandLock);
+		while (bandsPending) {
+			bandDone.Wait(bandLock);
+		}
+	}
 	SDL_UnlockSurface(backBuf);
 
+	for (size_t i = 0; i < queuedBlits.size(); i++) {
+		const_cast<Sprite2D*>(queuedBlits[i].spr)->release();
+		if (queuedBlits[i].palette) queuedBlits[i].palette->release();
+	}
+	queuedBlits.clear();
+}
+
+void SDLVideoDriver::DestroySpriteCover(SpriteCover* sc)
+{
+	// a queued blit may still be using it
+	FlushBlits();
+	Video::DestroySpriteCover(sc);
 }
 
 Sprite2D* SDLVideoDriver::GetScreenshot( Region r )
 {
+	FlushBlits();
 	unsigned int Width = r.w ? r.w : disp->w;
 	unsigned int Height = r.h ? r.h : disp->h;
 
@@ -851,9 +1198,63 @@ Sprite2D* SDLVideoDriver::GetScreenshot( Region r )
 	return screenshot;
 }
 
+// the channels are multiplied through a table each, indexed by the stored
+// value, so a pixel costs three lookups whatever its format
+template<typename PixelType>
+static void TintSurfaceRect(SDL_Surface* surf, const Region& rgn, const Color& tint)
+{
+	const SDL_PixelFormat* fmt = surf->format;
+	const Uint32 masks[3] = { fmt->Rmask, fmt->Gmask, fmt->Bmask };
+	const Uint8 shifts[3] = { fmt->Rshift, fmt->Gshift, fmt->Bshift };
+	const Uint8 tints[3] = { tint.r, tint.g, tint.b };
+	Uint32 tables[3][256];
+	for (int c = 0; c < 3; c++) {
+		Uint32 max = masks[c] >> shifts[c];
+		for (Uint32 v = 0; v <= max && v < 256; v++) {
+			tables[c][v] = ((v * tints[c]) >> 8) << shifts[c];
+		}
+	}
+	const Uint32 keep = ~(fmt->Rmask | fmt->Gmask | fmt->Bmask);
+
+	for (int y = rgn.y; y < rgn.y + rgn.h; y++) {
+		PixelType* line = (PixelType*) ((Uint8*) surf->pixels + y*surf->pitch) + rgn.x;
+		PixelType* end = line + rgn.w;
+		for (; line < end; line++) {
+			Uint32 p = *line;
+			*line = (PixelType) ((p & keep)
+				| tables[0][(p & masks[0]) >> shifts[0]]
+				| tables[1][(p & masks[1]) >> shifts[1]]
+				| tables[2][(p & masks[2]) >> shifts[2]]);
+		}
+	}
+}
+
+bool SDLVideoDriver::CanTintGameArea() const
+{
+	return backBuf && (backBuf->format->BytesPerPixel == 2 || backBuf->format->BytesPerPixel == 4);
+}
+
+void SDLVideoDriver::TintGameArea(const Region& rgn, const Color& tint)
+{
+	FlushBlits();
+	Region clip = ClippedDrawingRect(rgn);
+	if (clip.w <= 0 || clip.h <= 0) {
+		return;
+	}
+
+	SDL_LockSurface(backBuf);
+	if (backBuf->format->BytesPerPixel == 4) {
+		TintSurfaceRect<Uint32>(backBuf, clip, tint);
+	} else {
+		TintSurfaceRect<Uint16>(backBuf, clip, tint);
+	}
+	SDL_UnlockSurface(backBuf);
+}
+
 /** This function Draws the Border of a Rectangle as described by the Region parameter. The Color used to draw the rectangle is passes via the Color parameter. */
 void SDLVideoDriver::DrawRect(const Region& rgn, const Color& color, bool fill, bool clipped)
 {
+	FlushBlits();
 	if (fill) {
 		if ( SDL_ALPHA_TRANSPARENT == color.a ) {
 			return;
@@ -910,6 +1311,7 @@ void SDLVideoDriver::DrawRectSprite(const Region& rgn, const Color& color, const
 
 void SDLVideoDriver::SetPixel(short x, short y, const Color& color, bool clipped)
 {
+	FlushBlits();
 	//print("x: %d; y: %d; XC: %d; YC: %d, VX: %d, VY: %d, VW: %d, VH: %d", x, y, xCorr, yCorr, Viewport.x, Viewport.y, Viewport.w, Viewport.h);
 	if (clipped) {
 		x += xCorr;
@@ -932,8 +1334,42 @@ void SDLVideoDriver::SetPixel(short x, short y, const Color& color, bool clipped
 	SDLVideoDriver::SetSurfacePixel(backBuf, x, y, color);
 }
 
+void SDLVideoDriver::DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped)
+{
+	FlushBlits();
+	SDL_PixelFormat* fmt = backBuf->format;
+	if (fmt->BytesPerPixel != 2 && fmt->BytesPerPixel != 4) {
+		Video::DrawPoints(points, color, clipped);
+		return;
+	}
+
+	// the same clipping as SetPixel, but the colour is mapped and the surface locked only once
+	Region clip = clipped ? Region(xCorr, yCorr, Viewport.w, Viewport.h) : Region(0, 0, disp->w, disp->h);
+	int dx = clipped ? xCorr : 0;
+	int dy = clipped ? yCorr : 0;
+	Uint32 val = SDL_MapRGBA(fmt, color.r, color.g, color.b, color.a);
+
+	SDL_LockSurface(backBuf);
+	Uint8* pixels = (Uint8*) backBuf->pixels;
+	for (size_t i = 0; i < points.size(); i++) {
+		int x = points[i].x + dx;
+		int y = points[i].y + dy;
+		if (x < clip.x || y < clip.y || x >= clip.x + clip.w || y >= clip.y + clip.h) {
+			continue;
+		}
+		Uint8* pixel = pixels + y*backBuf->pitch + x*fmt->BytesPerPixel;
+		if (fmt->BytesPerPixel == 4) {
+			*(Uint32*) pixel = val;
+		} else {
+			*(Uint16*) pixel = (Uint16) val;
+		}
+	}
+	SDL_UnlockSurface(backBuf);
+}
+
 void SDLVideoDriver::GetPixel(short x, short y, Color& c)
 {
+	FlushBlits();
 	SDLVideoDriver::GetSurfacePixel(backBuf, x, y, c);
 }
 
@@ -1189,16 +1625,24 @@ void SDLVideoDriver::DrawEllipseSegment(short cx, short cy, unsigned short xr,
 }
 
 
-/** This functions Draws an Ellipse */
-void SDLVideoDriver::DrawEllipse(short cx, short cy, unsigned short xr,
-	unsigned short yr, const Color& color, bool clipped)
+// selection circles come in a handful of sizes, more than this are dropped
+#define ELLIPSE_CACHE_SIZE 32
+
+// Bresenham's ellipse algorithm, done once per radii
+const std::vector<Point>& SDLVideoDriver::GetEllipseOutline(unsigned short xr, unsigned short yr)
 {
-	//Uses Bresenham's Ellipse Algorithm
+	std::pair<unsigned short, unsigned short> key(xr, yr);
+	std::map<std::pair<unsigned short, unsigned short>, std::vector<Point> >::iterator it = ellipseOutlines.find(key);
+	if (it != ellipseOutlines.end()) {
+		return it->second;
+	}
+	if (ellipseOutlines.size() >= ELLIPSE_CACHE_SIZE) {
+		ellipseOutlines.clear();
+	}
+	std::vector<Point>& outline = ellipseOutlines[key];
+
 	long x, y, xc, yc, ee, tas, tbs, sx, sy;
 
-	if (SDL_MUSTLOCK( disp )) {
-		SDL_LockSurface( disp );
-	}
 	tas = 2 * xr * xr;
 	tbs = 2 * yr * yr;
 	x = xr;
@@ -1210,10 +1654,10 @@ void SDLVideoDriver::DrawEllipse(short cx, short cy, unsigned short xr,
 	sy = 0;
 
 	while (sx >= sy) {
-		SetPixel( cx + ( short ) x, cy + ( short ) y, color, clipped );
-		SetPixel( cx - ( short ) x, cy + ( short ) y, color, clipped );
-		SetPixel( cx - ( short ) x, cy - ( short ) y, color, clipped );
-		SetPixel( cx + ( short ) x, cy - ( short ) y, color, clipped );
+		outline.push_back(Point((short) x, (short) y));
+		outline.push_back(Point((short) -x, (short) y));
+		outline.push_back(Point((short) -x, (short) -y));
+		outline.push_back(Point((short) x, (short) -y));
 		y++;
 		sy += tas;
 		ee += yc;
@@ -1235,10 +1679,10 @@ void SDLVideoDriver::DrawEllipse(short cx, short cy, unsigned short xr,
 	sy = tas * yr;
 
 	while (sx <= sy) {
-		SetPixel( cx + ( short ) x, cy + ( short ) y, color, clipped );
-		SetPixel( cx - ( short ) x, cy + ( short ) y, color, clipped );
-		SetPixel( cx - ( short ) x, cy - ( short ) y, color, clipped );
-		SetPixel( cx + ( short ) x, cy - ( short ) y, color, clipped );
+		outline.push_back(Point((short) x, (short) y));
+		outline.push_back(Point((short) -x, (short) y));
+		outline.push_back(Point((short) -x, (short) -y));
+		outline.push_back(Point((short) x, (short) -y));
 		x++;
 		sx += tbs;
 		ee += xc;
@@ -1250,13 +1694,24 @@ void SDLVideoDriver::DrawEllipse(short cx, short cy, unsigned short xr,
 			yc += tas;
 		}
 	}
-	if (SDL_MUSTLOCK( disp )) {
-		SDL_UnlockSurface( disp );
+	return outline;
+}
+
+/** This functions Draws an Ellipse */
+void SDLVideoDriver::DrawEllipse(short cx, short cy, unsigned short xr,
+	unsigned short yr, const Color& color, bool clipped)
+{
+	const std::vector<Point>& outline = GetEllipseOutline(xr, yr);
+	shapePoints.resize(outline.size());
+	for (size_t i = 0; i < outline.size(); i++) {
+		shapePoints[i] = Point(cx + outline[i].x, cy + outline[i].y);
 	}
+	DrawPoints(shapePoints, color, clipped);
 }
 
 void SDLVideoDriver::DrawPolyline(Gem_Polygon* poly, const Color& color, bool fill)
 {
+	FlushBlits();
 	if (!poly->count) {
 		return;
 	}
@@ -1336,17 +1791,13 @@ void SDLVideoDriver::DrawPolyline(Gem_Polygon* poly, const Color& color, bool fi
 		SDL_UnlockSurface(backBuf);
 	}
 
-	short lastX = poly->points[0]. x, lastY = poly->points[0].y;
-	unsigned int i;
-
-	for (i = 1; i < poly->count; i++) {
-		DrawLine( lastX, lastY, poly->points[i].x, poly->points[i].y, color, true );
-		lastX = poly->points[i].x;
-		lastY = poly->points[i].y;
+	// the stroke is kept with the polygon, only placing it is left per frame
+	const std::vector<Point>& outline = poly->GetOutlinePoints();
+	shapePoints.resize(outline.size());
+	for (size_t i = 0; i < outline.size(); i++) {
+		shapePoints[i] = Point(outline[i].x - Viewport.x, outline[i].y - Viewport.y);
 	}
-	DrawLine( lastX, lastY, poly->points[0].x, poly->points[0].y, color, true );
-
-	return;
+	DrawPoints(shapePoints, color, true);
 }
 
 void SDLVideoDriver::SetFadeColor(int r, int g, int b)
@@ -1360,6 +1811,9 @@ void SDLVideoDriver::SetFadeColor(int r, int g, int b)
 	if (b>255) b=255;
 	else if(b<0) b=0;
 	fadeColor.b=b;
+	if (fadeColor.a) {
+		MarkScreenDirty();
+	}
 	long val = SDL_MapRGBA( extra->format, fadeColor.r, fadeColor.g, fadeColor.b, fadeColor.a );
 	SDL_FillRect( extra, NULL, val );
 }
@@ -1368,7 +1822,11 @@ void SDLVideoDriver::SetFadePercent(int percent)
 {
 	if (percent>100) percent = 100;
 	else if (percent<0) percent = 0;
-	fadeColor.a = (255 * percent ) / 100;
+	unsigned char alpha = (255 * percent ) / 100;
+	if (alpha != fadeColor.a) {
+		MarkScreenDirty();
+	}
+	fadeColor.a = alpha;
 }
 
 void SDLVideoDriver::MouseMovement(int x, int y)
@@ -1458,6 +1916,7 @@ void SDLVideoDriver::DrawMovieSubtitle(ieDword strRef)
 
 void SDLVideoDriver::BlitSurfaceClipped(SDL_Surface* surf, const Region& src, const Region& dst)
 {
+	FlushBlits();
 	SDL_Rect srect = RectFromRegion(src); // FIXME: this may not be clipped
 	Region dclipped = ClippedDrawingRect(dst);
 	int trim = dst.h - dclipped.h;
@@ -24,8 +24,10 @@
 #include "Video.h"
 
 #include "GUI/EventMgr.h"
+#include "System/Thread.h"
 #include "win32def.h"
 
+#include <map>
 #include <vector>
 #include <SDL.h>
 
@@ -37,6 +39,8 @@ typedef unsigned char
 
 namespace GemRB {
 
+class BandWorker;
+
 inline int GetModState(int modstate)
 {
 	int value = 0;
@@ -58,13 +62,44 @@ protected:
 	// tmpBuf is here as a truly ugly hack, so we can copy backBuf to tmpBuf before blitting cursors, and then back again after the screen is presented. Only applies for SDL2.
 	SDL_Surface* tmpBuf;
 	SDL_Surface* extra;
-	std::vector< Region> upd;//Regions of the Screen to Update in the next SwapBuffer operation.
 	unsigned long lastTime;
+	unsigned long frameDue; // when the last frame was due by the frame rate cap
 	unsigned long lastMouseMoveTime;
 	unsigned long lastMouseDownTime;
 
 	String *subtitletext;
 	ieDword subtitlestrref;
+
+	// the cursor and tooltips last drawn over the presented frame
+	bool redrawOverlays;
+	Sprite2D* overlayCursor;
+	Point overlayCursorPos;
+	int overlayMouseFlags;
+	bool overlayTooltip;
+
+	// a game sprite blit, with the clipping and implicit flags already worked out
+	struct QueuedBlit {
+		const Sprite2D* spr;
+		int tx, ty;
+		unsigned int flags;
+		Color tint;
+		SpriteCover* cover;
+		Palette* palette;
+		Region clip;
+	};
+	// the game sprites drawn since the last flush, the raster threads
+	// replay all of them, each within its own band of backBuf
+	std::vector<QueuedBlit> queuedBlits;
+	std::vector<BandWorker*> bandWorkers;
+	bool bandsStarted, bandsStopping;
+	unsigned int bandGeneration, bandsPending;
+	Mutex bandLock;
+	ConditionVariable bandWakeup, bandDone;
+
+	// the rasterized outlines of the recently drawn ellipses by radii, relative to the centre
+	std::map<std::pair<unsigned short, unsigned short>, std::vector<Point> > ellipseOutlines;
+	std::vector<Point> shapePoints; // scratch space for placing a cached outline
+	const std::vector<Point>& GetEllipseOutline(unsigned short xr, unsigned short yr);
 public:
 	SDLVideoDriver(void);
 	virtual ~SDLVideoDriver(void);
@@ -84,7 +119,7 @@ public:
 	
 	void InitSpriteCover(SpriteCover* sc, int flags);
 	void AddPolygonToSpriteCover(SpriteCover* sc, Wall_Polygon* poly);
-	void DestroySpriteCover(SpriteCover* sc);
+	virtual void DestroySpriteCover(SpriteCover* sc);
 
 	void MouseMovement(int x, int y);
 	void ClickMouse(unsigned int button);
@@ -101,6 +136,9 @@ public:
 
 	virtual void BlitTile(const Sprite2D* spr, const Sprite2D* mask, int x, int y,
 						  const Region* clip, unsigned int flags);
+	virtual Sprite2D* CreateTileCache(int w, int h);
+	virtual void BlitTileToCache(Sprite2D* cache, const Sprite2D* spr, const Sprite2D* mask,
+								 int x, int y, unsigned int flags);
 	virtual void BlitSprite(const Sprite2D* spr, int x, int y, bool anchor = false,
 							const Region* clip = NULL, Palette* palette = NULL);
 	virtual void BlitSprite(const Sprite2D* spr, const Region& src, const Region& dst, Palette* pal = NULL);
@@ -109,6 +147,9 @@ public:
 								const Region* clip = NULL, bool anchor = false);
 
 	virtual Sprite2D* GetScreenshot( Region r );
+	virtual bool CanCacheRegions() const { return true; }
+	virtual bool CanTintGameArea() const;
+	virtual void TintGameArea(const Region& rgn, const Color& tint);
 	/** This function Draws the Border of a Rectangle as described by the Region parameter. The Color used to draw the rectangle is passes via the Color parameter. */
 	virtual void DrawRect(const Region& rgn, const Color& color, bool fill = true, bool clipped = false);
 	void DrawRectSprite(const Region& rgn, const Color& color, const Sprite2D* sprite);
@@ -116,6 +157,7 @@ public:
 	void SetPixel(short x, short y, const Color& color, bool clipped = true);
 	/** Gets the pixel of the backbuffer surface */
 	void GetPixel(short x, short y, Color& color);
+	virtual void DrawPoints(const std::vector<Point>& points, const Color& color, bool clipped = false);
 	virtual void DrawCircle(short cx, short cy, unsigned short r, const Color& color, bool clipped = true);
 	/** This functions Draws an Ellipse Segment */
 	void DrawEllipseSegment(short cx, short cy, unsigned short xr, unsigned short yr, const Color& color,
@@ -166,13 +208,34 @@ public:
 	void FreeBackgroundBuffer() {};
 	void TakeBackgroundBuffer() {};
 protected:
+	/** Waits out the rest of the frame time */
+	void LimitFrameRate();
+	/** Decides if the cursor and tooltips have to be drawn again, marking
+	 * what they covered dirty so it gets restored; call before compositing */
+	void UpdateOverlays();
+	/** Draws the cursor and tooltips over the composited frame */
+	void DrawOverlays();
 	void DrawMovieSubtitle(ieDword strRef);
+	/** Draws the queued game sprites, anything else using backBuf has to call it first */
+	void FlushBlits() { if (!queuedBlits.empty()) DrawQueuedBlits(); }
+	void DrawQueuedBlits();
+	void RenderGameSprite(const QueuedBlit& blit, const Region& clip);
+	void StartBandWorkers();
+	void StopBandWorkers();
 	void BlitSurfaceClipped(SDL_Surface*, const Region& src, const Region& dst);
+	/** BlitTile into target, clipped to fClip (in target coordinates) */
+	void BlitTileInto(SDL_Surface* target, const Sprite2D* spr, const Sprite2D* mask, int x, int y,
+					  const Region& fClip, unsigned int flags);
 	virtual bool SetSurfaceAlpha(SDL_Surface* surface, unsigned short alpha)=0;
 	/* used to process the SDL events dequeued by PollEvents or an arbitraty event from another source.*/
 	virtual int ProcessEvent(const SDL_Event & event);
 
 public:
+	// for the raster threads
+	bool WaitForBand(unsigned int& generation);
+	void DrawBand(unsigned int band);
+	void BandFinished();
+
 	// static functions for manipulating surfaces
 	static void SetSurfacePalette(SDL_Surface* surf, SDL_Color* pal, int numcolors = 256);
 	static void SetSurfacePixel(SDL_Surface* surf, short x, short y, const Color& color);
@@ -18,6 +18,11 @@
  *
  */
 
+// included ahead of the using directive of SDLVideo.cpp
+namespace {
+using namespace GemRB;
+}
+
 // For debugging:
 //#define HIGHLIGHTCOVER
 
@@ -72,6 +77,33 @@ const unsigned int BSHIFT32 = 0;
 
 const Uint16 halfmask16 = ((0xFFU >> (RLOSS16+1)) << RSHIFT16) | ((0xFFU >> (GLOSS16+1)) << GSHIFT16) | ((0xFFU >> (BLOSS16+1)) << BSHIFT16);
 const Uint32 halfmask32 = ((0xFFU >> 1) << RSHIFT32) | ((0xFFU >> 1) << GSHIFT32) | ((0xFFU >> 1) << BSHIFT32);
+// the byte left over by the colours, the blenders always clear it
+const unsigned int ASHIFT32 = 48 - RSHIFT32 - GSHIFT32 - BSHIFT32;
+const Uint32 colormask32 = ~(0xFFU << ASHIFT32);
+
+// Vector kernels, where the compiler targets an instruction set for them
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPRITE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SPRITE_NEON
+#include <arm_neon.h>
+#endif
+
+// the processor may still lack them, so ask once at runtime too
+static bool SRHasVector()
+{
+#if defined(SPRITE_SSE2)
+	static const bool available = SDL_HasSSE2() == SDL_TRUE;
+#elif defined(SPRITE_NEON) && SDL_VERSION_ATLEAST(2,0,6)
+	static const bool available = SDL_HasNEON() == SDL_TRUE;
+#elif defined(SPRITE_NEON)
+	static const bool available = true;
+#else
+	static const bool available = false;
+#endif
+	return available;
+}
 
 struct SRShadow_NOP {
 	template<typename PTYPE>
@@ -292,6 +324,186 @@ struct SRBlender<Uint32, SRBlender_Alpha, SRFormat_Hard> {
 };
 
 
+// Blends four neighbouring pixels at once, pix[i] gets src[i] where mask[i]
+// is set (all ones), the others are left alone. src is packed like the target,
+// with the alpha in the spare byte. The results match the blenders above.
+// Only the alpha blender has one, the others are bound by the memory traffic
+// and the scalar loop already keeps up with it.
+template<typename PTYPE, typename Blender>
+struct SRVector {
+	enum { Available = 0 };
+	static void Blend4(PTYPE* /*pix*/, const Uint32* /*src*/, const Uint32* /*mask*/) { assert(false); }
+};
+
+#if defined(SPRITE_SSE2)
+
+// built from the elements rather than loaded, src and the mask are filled a
+// lane at a time just before and a wide load would stall on those stores
+static inline __m128i SRLoad4(const Uint32* v)
+{
+	return _mm_set_epi32(v[3], v[2], v[1], v[0]);
+}
+
+static inline void SRStore4(Uint32* pix, __m128i res, __m128i dst, const Uint32* lanes)
+{
+	const __m128i mask = SRLoad4(lanes);
+	res = _mm_and_si128(res, _mm_set1_epi32(colormask32));
+	_mm_storeu_si128((__m128i*) pix, _mm_or_si128(_mm_and_si128(mask, res), _mm_andnot_si128(mask, dst)));
+}
+
+// the alpha word of each pixel, copied to all four of its words
+const int SR_ALPHA_WORDS = (ASHIFT32 / 8) * 0x55;
+
+static inline __m128i SRAlphaBlend(__m128i s, __m128i d)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i full = _mm_set1_epi16(255);
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, SR_ALPHA_WORDS), SR_ALPHA_WORDS);
+	__m128i t = _mm_add_epi16(_mm_add_epi16(one, _mm_mullo_epi16(a, s)),
+	                          _mm_mullo_epi16(_mm_sub_epi16(full, a), d));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+template<>
+struct SRVector<Uint32, SRBlender<Uint32, SRBlender_Alpha, SRFormat_Hard> > {
+	enum { Available = 1 };
+	static void Blend4(Uint32* pix, const Uint32* src, const Uint32* lanes) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i s = SRLoad4(src);
+		__m128i d = _mm_loadu_si128((const __m128i*) pix);
+		__m128i lo = SRAlphaBlend(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+		__m128i hi = SRAlphaBlend(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+		SRStore4(pix, _mm_packus_epi16(lo, hi), d, lanes);
+	}
+};
+
+#elif defined(SPRITE_NEON)
+
+static inline void SRStore4(Uint32* pix, uint32x4_t res, uint32x4_t dst, const Uint32* lanes)
+{
+	res = vandq_u32(res, vdupq_n_u32(colormask32));
+	vst1q_u32(pix, vbslq_u32(vld1q_u32(lanes), res, dst));
+}
+
+static inline uint8x8_t SRAlphaBlend(uint8x8_t s, uint8x8_t d, uint8x8_t a)
+{
+	uint16x8_t t = vaddq_u16(vdupq_n_u16(1), vmull_u8(a, s));
+	t = vmlal_u8(t, vsub_u8(vdup_n_u8(255), a), d);
+	return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+template<>
+struct SRVector<Uint32, SRBlender<Uint32, SRBlender_Alpha, SRFormat_Hard> > {
+	enum { Available = 1 };
+	static void Blend4(Uint32* pix, const Uint32* src, const Uint32* lanes) {
+		uint32x4_t s = vld1q_u32(src);
+		uint32x4_t d = vld1q_u32(pix);
+		// spread the alpha byte over its pixel
+		uint32x4_t a = vandq_u32(vshlq_u32(s, vdupq_n_s32(-(int) ASHIFT32)), vdupq_n_u32(0xFF));
+		uint8x16_t a8 = vreinterpretq_u8_u32(vmulq_u32(a, vdupq_n_u32(0x01010101)));
+		uint8x16_t s8 = vreinterpretq_u8_u32(s);
+		uint8x16_t d8 = vreinterpretq_u8_u32(d);
+		uint8x16_t res = vcombine_u8(SRAlphaBlend(vget_low_u8(s8), vget_low_u8(d8), vget_low_u8(a8)),
+		                             SRAlphaBlend(vget_high_u8(s8), vget_high_u8(d8), vget_high_u8(a8)));
+		SRStore4(pix, vreinterpretq_u32_u8(res), d, lanes);
+	}
+};
+
+#endif
+
+// Palette lookup for the big blits
+// the tint, the shadow alpha and whether the shadow takes over only depend on
+// the palette index, so they can be worked out once per entry, not per pixel
+struct SRPaletteEntry {
+	Uint8 r, g, b, a;
+	Uint32 packed; // for the vector blenders
+	bool shadow; // left to the shadow
+};
+
+// blits smaller than this aren't worth preparing the lookup for
+#define SR_LUT_PIXELS 256
+
+// without a tint there is next to nothing to save, unless the lookup feeds a
+// vector blender
+template<typename Tinter>
+struct SRLookupTint { enum { Worth = 1 }; };
+
+template<bool PALALPHA>
+struct SRLookupTint<SRTinter_NoTint<PALALPHA> > { enum { Worth = 0 }; };
+
+template<typename PTYPE, typename Shadow, typename Tinter>
+static void SRBuildLUT(SRPaletteEntry* lut, const Color* col, unsigned int flags,
+            const Shadow& shadow, const Tinter& tint, PTYPE /*dummy*/)
+{
+	for (int p = 0; p < 256; p++) {
+		// the shadows don't look at the pixel, only HalfTrans changes it
+		PTYPE pix = 0;
+		int extra_alpha = 0;
+		SRPaletteEntry& entry = lut[p];
+		entry.shadow = shadow(pix, (Uint8) p, extra_alpha, flags);
+		Uint8 r = col[p].r;
+		Uint8 g = col[p].g;
+		Uint8 b = col[p].b;
+		Uint8 a = col[p].a;
+		tint(r, g, b, a, flags);
+		entry.r = r;
+		entry.g = g;
+		entry.b = b;
+		entry.a = a >> extra_alpha;
+		entry.packed = (r << RSHIFT32) | (g << GSHIFT32) | (b << BSHIFT32) | (entry.a << ASHIFT32);
+	}
+}
+
+template<typename PTYPE, typename Shadow, typename Blender>
+static inline void SRBlendLUT(PTYPE& pix, Uint8 p, const SRPaletteEntry& entry,
+            const Shadow& shadow, const Blender& blend, unsigned int flags)
+{
+	if (entry.shadow) {
+		int extra_alpha = 0;
+		shadow(pix, p, extra_alpha, flags);
+	} else {
+		blend(pix, entry.r, entry.g, entry.b, entry.a);
+	}
+}
+
+// One lane of SRGather4: the palette entry of the i-th source pixel and whether
+// the vector blender should take it (all ones) or leave the target alone.
+// The shadows are drawn right away, not blended.
+template<typename PTYPE, bool COVER, bool XFLIP, typename Shadow>
+static inline Uint32 SRGather1(Uint32& src, int i, PTYPE* pix, const Uint8* srcdata,
+            const Uint8* coverpix, int transindex, const SRPaletteEntry* lut,
+            const Shadow& shadow, unsigned int flags)
+{
+	int offset = XFLIP ? -i : i;
+	Uint8 p = srcdata[i];
+	const SRPaletteEntry& entry = lut[p];
+	// kept free of branches, the sprites mix these up a lot
+	unsigned int visible = ((int)p != transindex) & !(COVER && coverpix[offset]);
+	if (visible & entry.shadow) {
+		int extra_alpha = 0;
+		shadow(pix[offset], p, extra_alpha, flags);
+	}
+	src = entry.packed;
+	return 0U - (visible & !entry.shadow);
+}
+
+// Prepares the next four source pixels (going the XFLIP way from pix) for
+// SRVector::Blend4, filling the lanes in memory order; returns false if there
+// is nothing to blend. Unrolled by hand, so the lanes can stay in registers.
+template<typename PTYPE, bool COVER, bool XFLIP, typename Shadow>
+static inline bool SRGather4(Uint32* src, Uint32* mask, PTYPE* pix, const Uint8* srcdata,
+            const Uint8* coverpix, int transindex, const SRPaletteEntry* lut,
+            const Shadow& shadow, unsigned int flags)
+{
+	const int first = XFLIP ? 3 : 0;
+	const int step = XFLIP ? -1 : 1;
+	mask[first] = SRGather1<PTYPE, COVER, XFLIP>(src[first], 0, pix, srcdata, coverpix, transindex, lut, shadow, flags);
+	mask[first + step] = SRGather1<PTYPE, COVER, XFLIP>(src[first + step], 1, pix, srcdata, coverpix, transindex, lut, shadow, flags);
+	mask[first + 2*step] = SRGather1<PTYPE, COVER, XFLIP>(src[first + 2*step], 2, pix, srcdata, coverpix, transindex, lut, shadow, flags);
+	mask[first + 3*step] = SRGather1<PTYPE, COVER, XFLIP>(src[first + 3*step], 3, pix, srcdata, coverpix, transindex, lut, shadow, flags);
+	return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
+
 // MSVC6 requires all template arguments to a function to be reflected in the
 // argument list. We wrap them in the type of a dummy argument.
 template <bool b>
@@ -339,8 +551,9 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 
 
 	// Clipping strategy:
-	// Because we can't jump to the right spot in the RLE data,
-	// we have to process the full sprite.
+	// The rows above the clipping rectangle are jumped over with the
+	// row index of the sprite, but within a row we can't jump to the
+	// right spot in the RLE data.
 	// We fast-forward through the bits outside of the clipping rectangle.
 
 	// This is done line-by-line.
@@ -361,7 +574,7 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 
 
 	PTYPE *line, *end, *pix;
-	Uint8 *coverline, *coverpix;
+	Uint8 *coverline, *coverpix = NULL;
 	if (!yflip) {
 		line = (PTYPE*)target->pixels + ty*pitch;
 		end = (PTYPE*)target->pixels + (clip.y + clip.h)*pitch;
@@ -393,6 +606,34 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 	const int yfactor = yflip ? -1 : 1;
 	const int xfactor = XFLIP ? -1 : 1;
 
+	int skiprows = yflip ? ty + height - clip.y - clip.h : clip.y - ty;
+	const ieDword* rows = skiprows > 0 ? spr->GetRLERows() : NULL;
+	if (rows) {
+		// the row starts this far in, behind a run from the row before
+		int spill = rows[skiprows] & 0xff;
+		int jump = yfactor * skiprows * pitch;
+		srcdata += rows[skiprows] >> 8;
+		line += jump;
+		pix += jump + xfactor * spill;
+		clipstartpix += jump;
+		clipendpix += jump;
+		if (COVER)
+			coverpix += yfactor * skiprows * cover->Width + xfactor * spill;
+	}
+
+	SRPaletteEntry lutdata[256];
+	const SRPaletteEntry *lut = NULL;
+	if ((SRLookupTint<Tinter>::Worth || SRVector<PTYPE, Blender>::Available) &&
+	    clip.w * clip.h >= SR_LUT_PIXELS) {
+		SRBuildLUT(lutdata, col, flags, shadow, tint, (PTYPE) 0);
+		lut = lutdata;
+	}
+#ifndef HIGHLIGHTCOVER
+	const bool vectorize = lut && SRVector<PTYPE, Blender>::Available && SRHasVector();
+#else
+	const bool vectorize = false;
+#endif
+
 	while (line != end) {
 
 		// Fast-forward through the RLE data until we reach clipstartpix
@@ -429,6 +670,21 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 		{
 			while ( (!XFLIP && pix < clipendpix) || (XFLIP && pix > clipendpix) )
 			{
+				// four opaque pixels in a row go to the vector blender
+				// (every pixel left takes a byte, so they can be peeked at)
+				if (vectorize && (XFLIP ? pix - clipendpix : clipendpix - pix) >= 4 &&
+				    srcdata[0] != transindex && srcdata[1] != transindex &&
+				    srcdata[2] != transindex && srcdata[3] != transindex) {
+					Uint32 src[4], mask[4];
+					if (SRGather4<PTYPE, COVER, XFLIP>(src, mask, pix, srcdata,
+					    coverpix, transindex, lut, shadow, flags)) {
+						SRVector<PTYPE, Blender>::Blend4(XFLIP ? pix - 3 : pix, src, mask);
+					}
+					srcdata += 4;
+					pix += 4 * xfactor;
+					if (COVER) coverpix += 4 * xfactor;
+					continue;
+				}
 				Uint8 p = *srcdata++;
 				if (p == transindex) {
 					int count = (int)(*srcdata++) + 1;
@@ -444,7 +700,9 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 				} else {
 					if (!COVER || !*coverpix) {
 						int extra_alpha = 0;
-						if (!shadow(*pix, p, extra_alpha, flags)) {
+						if (lut) {
+							SRBlendLUT(*pix, p, lut[p], shadow, blend, flags);
+						} else if (!shadow(*pix, p, extra_alpha, flags)) {
 							Uint8 r = col[p].r;
 							Uint8 g = col[p].g;
 							Uint8 b = col[p].b;
@@ -525,7 +783,7 @@ static void BlitSprite_internal(SDL_Surface* target,
 
 
 	PTYPE *line, *end;
-	Uint8 *coverpix;
+	Uint8 *coverpix = NULL;
 
 	if (!yflip) {
 		line = (PTYPE*)target->pixels + clip.y*pitch;
@@ -541,16 +799,14 @@ static void BlitSprite_internal(SDL_Surface* target,
 			coverpix = (Uint8*)cover->pixels + (clip.y - ty + clip.h + covery - 1)*cover->Width;
 	}
 
-	PTYPE *pix, *endpix;
+	PTYPE *pix;
 	if (!XFLIP) {
 		pix = line + clip.x;
-		endpix = pix + clip.w;
 		srcdata += clip.x - tx;
 		if (COVER)
 			coverpix += clip.x - tx + coverx;
 	} else {
 		pix = line + clip.x + clip.w - 1;
-		endpix = pix - clip.w;
 		srcdata += tx + spr->Width - (clip.x + clip.w);
 		if (COVER)
 			coverpix += clip.x - tx + clip.w + coverx - 1;
@@ -559,13 +815,41 @@ static void BlitSprite_internal(SDL_Surface* target,
 	const int yfactor = yflip ? -1 : 1;
 	const int xfactor = XFLIP ? -1 : 1;
 
+	SRPaletteEntry lutdata[256];
+	const SRPaletteEntry *lut = NULL;
+	if ((SRLookupTint<Tinter>::Worth || SRVector<PTYPE, Blender>::Available) &&
+	    clip.w * clip.h >= SR_LUT_PIXELS) {
+		SRBuildLUT(lutdata, col, flags, shadow, tint, (PTYPE) 0);
+		lut = lutdata;
+	}
+#ifndef HIGHLIGHTCOVER
+	const bool vectorize = lut && SRVector<PTYPE, Blender>::Available && SRHasVector();
+#else
+	const bool vectorize = false;
+#endif
+
 	while (line != end) {
-		do {
+		int count = clip.w;
+		if (vectorize) {
+			for (; count >= 4; count -= 4) {
+				Uint32 src[4], mask[4];
+				if (SRGather4<PTYPE, COVER, XFLIP>(src, mask, pix, srcdata,
+				    coverpix, transindex, lut, shadow, flags)) {
+					SRVector<PTYPE, Blender>::Blend4(XFLIP ? pix - 3 : pix, src, mask);
+				}
+				srcdata += 4;
+				pix += 4 * xfactor;
+				if (COVER) coverpix += 4 * xfactor;
+			}
+		}
+		for (; count > 0; count--) {
 			Uint8 p = *srcdata++;
 			if ((int)p != transindex) {
 				if (!COVER || !*coverpix) {
 					int extra_alpha = 0;
-					if (!shadow(*pix, p, extra_alpha, flags)) {
+					if (lut) {
+						SRBlendLUT(*pix, p, lut[p], shadow, blend, flags);
+					} else if (!shadow(*pix, p, extra_alpha, flags)) {
 						Uint8 r = col[p].r;
 						Uint8 g = col[p].g;
 						Uint8 b = col[p].b;
@@ -587,11 +871,10 @@ static void BlitSprite_internal(SDL_Surface* target,
 				pix--;
 				if (COVER) coverpix--;
 			}
-		} while (pix != endpix);
+		}
 
 		// advance all pointers to the next line
 		pix += yfactor * pitch - xfactor * clip.w;
-		endpix += yfactor * pitch;
 		line += yfactor * pitch;
 		srcdata += (width - clip.w);
 		if (COVER)
@@ -89,6 +89,105 @@ struct TRBlender_HalfTrans {
 	Uint32 mask;
 };
 
+// Blends four neighbouring 32bpp tile pixels at once, buf[i] gets the blend of
+// src[i] where sel[i] is set (all ones), the others are left alone. The results
+// match the blenders above. The vector support comes from SpriteRenderer.inl.
+template<class Blender>
+struct TRVector {
+	enum { Available = 0 };
+	static void Blend4(Uint32* /*buf*/, const Uint32* /*src*/, const Uint32* /*sel*/, const Blender& /*blend*/) { assert(false); }
+};
+
+#if defined(SPRITE_SSE2)
+
+static inline void TRStore4(Uint32* buf, __m128i res, __m128i dst, const Uint32* sel)
+{
+	const __m128i lanes = SRLoad4(sel);
+	_mm_storeu_si128((__m128i*) buf, _mm_or_si128(_mm_and_si128(lanes, res), _mm_andnot_si128(lanes, dst)));
+}
+
+template<>
+struct TRVector<TRBlender_Opaque> {
+	enum { Available = 1 };
+	static void Blend4(Uint32* buf, const Uint32* src, const Uint32* sel, const TRBlender_Opaque&) {
+		TRStore4(buf, SRLoad4(src), _mm_loadu_si128((const __m128i*) buf), sel);
+	}
+};
+
+template<>
+struct TRVector<TRBlender_HalfTrans> {
+	enum { Available = 1 };
+	static void Blend4(Uint32* buf, const Uint32* src, const Uint32* sel, const TRBlender_HalfTrans& blend) {
+		const __m128i half = _mm_set1_epi32(blend.mask);
+		__m128i s = SRLoad4(src);
+		__m128i d = _mm_loadu_si128((const __m128i*) buf);
+		__m128i res = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(s, 1), half),
+		                            _mm_and_si128(_mm_srli_epi32(d, 1), half));
+		TRStore4(buf, res, d, sel);
+	}
+};
+
+#elif defined(SPRITE_NEON)
+
+static inline void TRStore4(Uint32* buf, uint32x4_t res, uint32x4_t dst, const Uint32* sel)
+{
+	vst1q_u32(buf, vbslq_u32(vld1q_u32(sel), res, dst));
+}
+
+template<>
+struct TRVector<TRBlender_Opaque> {
+	enum { Available = 1 };
+	static void Blend4(Uint32* buf, const Uint32* src, const Uint32* sel, const TRBlender_Opaque&) {
+		TRStore4(buf, vld1q_u32(src), vld1q_u32(buf), sel);
+	}
+};
+
+template<>
+struct TRVector<TRBlender_HalfTrans> {
+	enum { Available = 1 };
+	static void Blend4(Uint32* buf, const Uint32* src, const Uint32* sel, const TRBlender_HalfTrans& blend) {
+		const uint32x4_t half = vdupq_n_u32(blend.mask);
+		uint32x4_t s = vld1q_u32(src);
+		uint32x4_t d = vld1q_u32(buf);
+		uint32x4_t res = vaddq_u32(vandq_u32(vshrq_n_u32(s, 1), half),
+		                           vandq_u32(vshrq_n_u32(d, 1), half));
+		TRStore4(buf, res, d, sel);
+	}
+};
+
+#endif
+
+// Draws a row of a 32bpp tile four pixels at a time and returns how many
+// pixels it did, the rest is left to the scalar loop. Without a mask every
+// lane is taken; with one, groups the mask leaves out entirely are skipped.
+template<class Blender>
+static inline int TRBlitRow4(Uint32* buf, const Uint8* data, const Uint8* mask, Uint8 mask_key,
+			int w, const Uint32* opal, const Blender& blend)
+{
+	int x = 0;
+	for (; x + 4 <= w; x += 4) {
+		Uint32 src[4], sel[4];
+		// unrolled by hand, so the lanes can stay in registers
+		src[0] = opal[data[x]];
+		src[1] = opal[data[x + 1]];
+		src[2] = opal[data[x + 2]];
+		src[3] = opal[data[x + 3]];
+		if (mask) {
+			sel[0] = 0U - (mask[x] == mask_key);
+			sel[1] = 0U - (mask[x + 1] == mask_key);
+			sel[2] = 0U - (mask[x + 2] == mask_key);
+			sel[3] = 0U - (mask[x + 3] == mask_key);
+			if (!(sel[0] | sel[1] | sel[2] | sel[3])) {
+				continue;
+			}
+		} else {
+			sel[0] = sel[1] = sel[2] = sel[3] = ~0U;
+		}
+		TRVector<Blender>::Blend4(buf + x, src, sel, blend);
+	}
+	return x;
+}
+
 
 //the dummy variable is a hint for MSVC6, otherwise it compiles bad code
 //because it cannot select between the 16 and 32 bit variants
@@ -117,13 +216,23 @@ static void BlitTile_internal(SDL_Surface* target,
 		                   | (b >> target->format->Bloss) << target->format->Bshift;
 	}
 
+	// the vector kernels only know the 32bpp targets
+	const bool vectorize = sizeof(PixelType) == 4 && TRVector<Blender>::Available && SRHasVector();
+
 	if (mask) {
 		const Uint8* mask_line = mask + ry*64;
 		for (int y = 0; y < h; ++y) {
 			PixelType* buf = buf_line + tx + rx;
 			data = data_line + rx;
 			mask = mask_line + rx;
-			for (int x = 0; x < w; ++x) {
+			int x = 0;
+			if (vectorize) {
+				x = TRBlitRow4((Uint32*) buf, data, mask, mask_key, w, (const Uint32*) opal, blend);
+				buf += x;
+				data += x;
+				mask += x;
+			}
+			for (; x < w; ++x) {
 				Uint8 p = *data++;
 				Uint8 m = *mask++;
 				if (m == mask_key)
@@ -140,7 +249,13 @@ static void BlitTile_internal(SDL_Surface* target,
 		for (int y = 0; y < h; ++y) {
 			PixelType* buf = buf_line + tx + rx;
 			data = data_line + rx;
-			for (int x = 0; x < w; ++x) {
+			int x = 0;
+			if (vectorize) {
+				x = TRBlitRow4((Uint32*) buf, data, (const Uint8*) NULL, 0, w, (const Uint32*) opal, blend);
+				buf += x;
+				data += x;
+			}
+			for (; x < w; ++x) {
 				Uint8 p = *data++;
 				*buf = (PixelType)blend(opal[p],*buf);
 				buf++;
@@ -184,6 +184,16 @@ Spell* SPLImporter::GetSpell(Spell *s, bool /*silent*/)
 		GetExtHeader( s, s->ext_headers+i );
 	}
 
+	s->SetFeaturesPending();
+
+	return s;
+}
+
+bool SPLImporter::GetSpellFeatures(Spell *s)
+{
+	unsigned int i;
+
+	//48 is the size of the feature block
 	s->casting_features = core->GetFeatures(s->CastingFeatureCount);
 	str->Seek( s->FeatureBlockOffset + 48*s->CastingFeatureOffset,
 			GEM_STREAM_START );
@@ -191,7 +201,15 @@ Spell* SPLImporter::GetSpell(Spell *s, bool /*silent*/)
 		GetFeature(s, s->casting_features+i);
 	}
 
-	return s;
+	for (i = 0; i < s->ExtHeaderCount; i++) {
+		SPLExtHeader* eh = s->ext_headers+i;
+		eh->features = core->GetFeatures( eh->FeatureCount );
+		str->Seek( s->FeatureBlockOffset + 48*eh->FeatureOffset, GEM_STREAM_START );
+		for (unsigned int j = 0; j < eh->FeatureCount; j++) {
+			GetFeature(s, eh->features+j);
+		}
+	}
+	return true;
 }
 
 void SPLImporter::GetExtHeader(Spell *s, SPLExtHeader* eh)
@@ -234,11 +252,6 @@ void SPLImporter::GetExtHeader(Spell *s, SPLExtHeader* eh)
 	if (eh->ProjectileAnimation) {
 		eh->ProjectileAnimation--;
 	}
-	eh->features = core->GetFeatures( eh->FeatureCount );
-	str->Seek( s->FeatureBlockOffset + 48*eh->FeatureOffset, GEM_STREAM_START );
-	for (unsigned int i = 0; i < eh->FeatureCount; i++) {
-		GetFeature(s, eh->features+i);
-	}
 }
 
 void SPLImporter::GetFeature(Spell *s, Effect *fx)
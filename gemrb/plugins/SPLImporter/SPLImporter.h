@@ -40,6 +40,7 @@ public:
 	~SPLImporter(void);
 	bool Open(DataStream* stream);
 	Spell* GetSpell(Spell *spl, bool silent=false);
+	bool GetSpellFeatures(Spell *spl);
 private:
 	void GetExtHeader(Spell *s, SPLExtHeader* eh);
 	void GetFeature(Spell *s, Effect *f);
@@ -37,14 +37,50 @@ TISImporter::TISImporter(void)
 
 TISImporter::~TISImporter(void)
 {
+	ClearDecoded();
 	delete str;
 }
 
+void TISImporter::ClearDecoded()
+{
+	for (size_t i = 0; i < decoded.size(); i++) {
+		if (decoded[i]) {
+			free(decoded[i]->pixels);
+			delete decoded[i];
+		}
+	}
+	decoded.clear();
+}
+
+// the green palette entry is the transparent one
+static void ConvertPalette(const RevColor* RevCol, DecodedTile* tile)
+{
+	tile->transindex = 0;
+	tile->transparent = false;
+	tile->twoGreens = false;
+	for (int i = 0; i < 256; i++) {
+		Color& c = tile->Palette[i];
+		c.r = RevCol[i].r;
+		c.g = RevCol[i].g;
+		c.b = RevCol[i].b;
+		c.a = RevCol[i].a;
+		if (c.g==255 && !c.r && !c.b) {
+			if (tile->transparent) {
+				tile->twoGreens = true;
+			} else {
+				tile->transparent = true;
+				tile->transindex = i;
+			}
+		}
+	}
+}
+
 bool TISImporter::Open(DataStream* stream)
 {
 	if (stream == NULL) {
 		return false;
 	}
+	ClearDecoded();
 	delete str;
 	str = stream;
 	char Signature[8];
@@ -61,10 +97,41 @@ bool TISImporter::Open(DataStream* stream)
 		str->ReadDword( &TileSize );
 	} else {
 		str->Seek( -8, GEM_CURRENT_POS );
+		TilesCount = str->Size() / (1024+4096);
 	}
+	decoded.assign(TilesCount, NULL);
 	return true;
 }
 
+/** Reads and converts the tiles through a private copy of the stream, so
+ * any number of these may run at once, as long as the ranges don't overlap.
+ * The sprites are only created by GetTile, on the main thread. */
+void TISImporter::DecodeTiles(DataStream* tiles, unsigned int first, unsigned int count)
+{
+	if (!tiles || first >= decoded.size()) {
+		return;
+	}
+	if (count > decoded.size() - first) {
+		count = decoded.size() - first;
+	}
+
+	RevColor RevCol[256];
+	for (unsigned int index = first; index < first + count; index++) {
+		unsigned long pos = index *(1024+4096) + headerShift;
+		// corrupt tiles are left to GetTile, which reports them
+		if (tiles->Size() < pos+1024+4096) {
+			break;
+		}
+		tiles->Seek( pos, GEM_STREAM_START );
+		tiles->Read( &RevCol, 1024 );
+		DecodedTile* tile = new DecodedTile();
+		ConvertPalette(RevCol, tile);
+		tile->pixels = malloc( 4096 );
+		tiles->Read( tile->pixels, 4096 );
+		decoded[index] = tile;
+	}
+}
+
 Tile* TISImporter::GetTile(unsigned short* indexes, int count,
 	unsigned short* secondary)
 {
@@ -88,6 +155,18 @@ Tile* TISImporter::GetTile(unsigned short* indexes, int count,
 
 Sprite2D* TISImporter::GetTile(int index)
 {
+	if (index >= 0 && (size_t) index < decoded.size() && decoded[index]) {
+		DecodedTile* tile = decoded[index];
+		decoded[index] = NULL;
+		if (tile->twoGreens) {
+			Log(ERROR, "TISImporter", "Tile has two green (transparent) palette entries");
+		}
+		Sprite2D* spr = core->GetVideoDriver()->CreatePalettedSprite( 64, 64, 8, tile->pixels, tile->Palette, tile->transparent, tile->transindex );
+		spr->XPos = spr->YPos = 0;
+		delete tile;
+		return spr;
+	}
+
 	RevColor RevCol[256];
 	Color Palette[256];
 	void* pixels = malloc( 4096 );
@@ -114,24 +193,13 @@ Sprite2D* TISImporter::GetTile(int index)
 	}
 	str->Seek( pos, GEM_STREAM_START );
 	str->Read( &RevCol, 1024 );
-	int transindex = 0;
-	bool transparent = false;
-	for (int i = 0; i < 256; i++) {
-		Palette[i].r = RevCol[i].r;
-		Palette[i].g = RevCol[i].g;
-		Palette[i].b = RevCol[i].b;
-		Palette[i].a = RevCol[i].a;
-		if (Palette[i].g==255 && !Palette[i].r && !Palette[i].b) {
-			if (transparent) {
-				Log(ERROR, "TISImporter", "Tile has two green (transparent) palette entries");
-			} else {
-				transparent = true;
-				transindex = i;
-			}
-		}
+	DecodedTile tile;
+	ConvertPalette(RevCol, &tile);
+	if (tile.twoGreens) {
+		Log(ERROR, "TISImporter", "Tile has two green (transparent) palette entries");
 	}
 	str->Read( pixels, 4096 );
-	Sprite2D* spr = core->GetVideoDriver()->CreatePalettedSprite( 64, 64, 8, pixels, Palette, transparent, transindex );
+	Sprite2D* spr = core->GetVideoDriver()->CreatePalettedSprite( 64, 64, 8, pixels, tile.Palette, tile.transparent, tile.transindex );
 	spr->XPos = spr->YPos = 0;
 	return spr;
 }
@@ -23,13 +23,29 @@
 
 #include "TileSetMgr.h"
 
+#include "RGBAColor.h"
+
+#include <vector>
+
 namespace GemRB {
 
+/** A tile read by DecodeTiles, waiting for its sprite */
+struct DecodedTile {
+	Color Palette[256];
+	void* pixels;
+	int transindex;
+	bool transparent;
+	bool twoGreens;
+};
+
 class TISImporter : public TileSetMgr {
 private:
 	DataStream* str;
 	ieDword headerShift;
 	ieDword TilesCount, TilesSectionLen, TileSize;
+	std::vector<DecodedTile*> decoded;
+
+	void ClearDecoded();
 public:
 	TISImporter(void);
 	~TISImporter(void);
@@ -37,6 +53,9 @@ public:
 	Tile* GetTile(unsigned short* indexes, int count,
 		unsigned short* secondary = NULL);
 	Sprite2D* GetTile(int index);
+	unsigned int GetTilesCount() { return TilesCount; }
+	DataStream* CloneStream() { return str ? str->Clone() : NULL; }
+	void DecodeTiles(DataStream* tiles, unsigned int first, unsigned int count);
 public:
 };
 
@@ -33,6 +33,9 @@
 
 using namespace GemRB;
 
+//the number of resolved strings kept around
+#define STRING_CACHE_SIZE 512
+
 //set this to -1 if charname is gabber (iwd2)
 static int charname=0;
 struct gt_type
@@ -44,6 +47,7 @@ struct gt_type
 static Variables gtmap;
 
 TLKImporter::TLKImporter(void)
+	: cache(STRING_CACHE_SIZE, ReleaseCacheEntry)
 {
 	int gtcount;
 
@@ -57,6 +61,7 @@ TLKImporter::TLKImporter(void)
 	}
 	str = NULL;
 	override = NULL;
+	tokensResolved = false;
 	StrRefCount = Offset = Language = 0;
 
 	AutoTable tm("gender");
@@ -91,8 +96,20 @@ TLKImporter::~TLKImporter(void)
 	CloseAux();
 }
 
+void TLKImporter::ReleaseCacheEntry(const char* /*key*/, CacheEntry& e)
+{
+	free(e.text);
+	delete e.string;
+}
+
+void TLKImporter::ClearCache()
+{
+	cache.Clear();
+}
+
 void TLKImporter::CloseAux()
 {
+	ClearCache();
 	if (override) {
 		delete override;
 	}
@@ -127,9 +144,32 @@ bool TLKImporter::Open(DataStream* stream)
 	str->ReadWord( &Language ); // English is 0
 	str->ReadDword( &StrRefCount );
 	str->ReadDword( &Offset );
+	ClearCache();
+	MapFile();
 	return true;
 }
 
+// swaps the file stream for one reading from a mapping of the same file,
+// so looking up a string doesn't hit the disk
+void TLKImporter::MapFile()
+{
+	MappedFile* mf = MappedFile::Open(str->originalfile);
+	if (!mf) {
+		return;
+	}
+	if (mf->GetSize() != str->Size()) {
+		delete mf;
+		return;
+	}
+	mapping = mf;
+
+	unsigned long pos = str->GetPos();
+	DataStream* mapped = new MappedStream(mf, 0, mf->GetSize(), str->originalfile);
+	mapped->Seek(pos, GEM_STREAM_START);
+	delete str;
+	str = mapped;
+}
+
 //when copying the token, skip spaces
 inline const char* mystrncpy(char* dest, const char* source, int maxlength,
 	char delim)
@@ -379,6 +419,7 @@ bool TLKImporter::GetNewStringLength(char* string, int& Length)
 		if (string[i] == '<') {
 			// token
 			lChange = true;
+			tokensResolved = true;
 			i = (int) (mystrncpy( Token, string + i + 1, MAX_VARIABLE_LENGTH, '>' ) - string);
 			int TokenLength = BuiltinToken( Token, NULL );
 			if (TokenLength == -1) {
@@ -411,18 +452,68 @@ ieStrRef TLKImporter::UpdateString(ieStrRef strref, const char *newvalue)
 		return 0xffffffff;
 	}
 
+	ClearCache();
 	return override->UpdateString(strref, newvalue);
 }
 
 String* TLKImporter::GetString(ieStrRef strref, ieDword flags)
 {
-	char* cstr = GetCString(strref, flags);
-	String* string = StringFromCString(cstr);
-	free(cstr);
-	return string;
+	char* cstr;
+	CacheEntry* e = GetCacheEntry(strref, flags, cstr);
+	if (!e) {
+		String* string = StringFromCString(cstr);
+		free(cstr);
+		return string;
+	}
+	if (!e->string) {
+		e->string = StringFromCString(e->text);
+	}
+	return new String(*e->string);
 }
 
 char* TLKImporter::GetCString(ieStrRef strref, ieDword flags)
+{
+	char* cstr;
+	CacheEntry* e = GetCacheEntry(strref, flags, cstr);
+	if (!e) {
+		return cstr;
+	}
+	return strdup(e->text);
+}
+
+TLKImporter::CacheEntry* TLKImporter::GetCacheEntry(ieStrRef strref, ieDword flags, char*& uncached)
+{
+	uncached = NULL;
+	// playing the sound is a side effect we can't skip
+	if (flags & IE_STR_SOUND) {
+		uncached = ResolveString(strref, flags);
+		return NULL;
+	}
+
+	char key[32];
+	snprintf(key, sizeof(key), "%u_%u", strref, flags);
+	CacheEntry* cached = cache.Use(key);
+	if (cached) {
+		return cached;
+	}
+
+	// tokens change all the time (names, dates, the speaker), so
+	// strings using them are resolved anew on each request
+	tokensResolved = false;
+	char* string = ResolveString(strref, flags);
+	if (tokensResolved) {
+		uncached = string;
+		return NULL;
+	}
+
+	CacheEntry e;
+	e.text = string;
+	e.string = NULL;
+	// the cache drops and releases the least recently used past its size
+	return &cache.SetAt(key, e)->value;
+}
+
+char* TLKImporter::ResolveString(ieStrRef strref, ieDword flags)
 {
 	char* string;
 	
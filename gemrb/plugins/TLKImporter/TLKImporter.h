@@ -23,7 +23,9 @@
 
 #include "StringMgr.h"
 
+#include "LRUCache.h"
 #include "TlkOverride.h"
+#include "System/MappedFile.h"
 
 namespace GemRB {
 
@@ -35,6 +37,16 @@ private:
 	ieWord Language;
 	ieDword StrRefCount, Offset;
 	CTlkOverride *override;
+	Holder<MappedFile> mapping;
+
+	// recently resolved strings, keyed by strref and flags
+	struct CacheEntry {
+		char *text;
+		String *string;
+	};
+	LRUCache<CacheEntry> cache;
+	// set when resolving a string looked up a token, those aren't cached
+	bool tokensResolved;
 
 public:
 	TLKImporter(void);
@@ -53,6 +65,12 @@ public:
 	void FreeString(char *str);
 	bool HasAltTLK() const;
 private:
+	void MapFile();
+	void ClearCache();
+	static void ReleaseCacheEntry(const char* key, CacheEntry& e);
+	/** returns the cached entry of a string, or NULL and the string in uncached */
+	CacheEntry* GetCacheEntry(ieStrRef strref, ieDword flags, char *&uncached);
+	char* ResolveString(ieStrRef strref, ieDword flags);
 	/** resolves day and monthname tokens */
 	void GetMonthName(int dayandmonth);
 	/** replaces tags in dest, don't exceed Length */
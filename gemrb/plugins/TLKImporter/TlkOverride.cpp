@@ -22,6 +22,8 @@
 
 #include "TlkOverride.h"
 
+#include "SaveExtractor.h"
+
 #include <algorithm>
 #include <cstdio>
 #include <cassert>
@@ -69,9 +71,31 @@ bool CTlkOverride::Init()
 	}
 	NextStrRef = 0xffffffff;
 
+	IndexEntries();
 	return true;
 }
 
+//reads the toh entries once, so strings are found without scanning it
+void CTlkOverride::IndexEntries()
+{
+	entries.init(AuxCount + 64, 64);
+	toh_str->Seek(TOH_HEADER_SIZE, GEM_STREAM_START);
+	for (ieDword i = 0; i < AuxCount; i++) {
+		ieDword strref, offset;
+		if (toh_str->ReadDword(&strref) != 4) {
+			break;
+		}
+		toh_str->Seek(20, GEM_CURRENT_POS);
+		if (toh_str->ReadDword(&offset) != 4) {
+			break;
+		}
+		// the first entry wins, like it did with the linear search
+		if (!entries.get(strref)) {
+			entries.set(strref, offset);
+		}
+	}
+}
+
 void CTlkOverride::CloseResources()
 {
 	if (toh_str) {
@@ -85,60 +109,45 @@ void CTlkOverride::CloseResources()
 #ifdef CACHE_TLK_OVERRIDE
 	stringmap.clear();
 #endif
+	entries.clear();
 }
 
-//gets the length of a stored string which might span more than one segment
-ieDword CTlkOverride::GetLength(ieDword offset)
+//returns a string stored at a given offset of the .tot file,
+//it might span more than one segment; each is read whole, once
+char* CTlkOverride::GetString(ieDword offset)
 {
-	ieDword tmp = offset;
-	char buffer[SEGMENT_SIZE];
-
-	if (tot_str->Seek(offset+8, GEM_STREAM_START) != GEM_OK) {
-		return 0;
+	if (!tot_str) {
+		return NULL;
 	}
 
+	//strings are limited to 64k, more segments mean a broken chain
+	const int maxSegments = 65536 / SEGMENT_SIZE + 1;
+	char *ret = NULL;
 	ieDword length = 0;
-	do
-	{
-		if (tot_str->Seek(tmp+8, GEM_STREAM_START) != GEM_OK) {
-			return 0;
+	int segments = 0;
+	while (offset != 0xffffffff && segments++ < maxSegments) {
+		if (tot_str->Seek(offset+8, GEM_STREAM_START) != GEM_OK) {
+			break;
+		}
+		//assuming char is one byte
+		ret = (char *) realloc(ret, length + SEGMENT_SIZE + 1);
+		memset(ret + length, 0, SEGMENT_SIZE + 1);
+		tot_str->Read(ret + length, SEGMENT_SIZE);
+		if (tot_str->ReadDword(&offset) != 4) {
+			offset = 0xffffffff;
 		}
-		memset(buffer,0,sizeof(buffer));
-		tot_str->Read(buffer, SEGMENT_SIZE);
-		tot_str->ReadDword(&tmp);
-		if (tmp != 0xffffffff) {
+		//only the last segment is terminated
+		if (offset == 0xffffffff) {
+			length += strlen(ret + length);
+		} else {
 			length += SEGMENT_SIZE;
 		}
-	} while (tmp != 0xffffffff);
-	length += strlen(buffer);
-	return length;
-}
-
-//returns a string stored at a given offset of the .tot file
-char* CTlkOverride::GetString(ieDword offset)
-{
-	if (!tot_str) {
-		return NULL;
 	}
-
-	ieDword length = GetLength(offset);
-	if (length == 0) {
+	if (!length) {
+		free(ret);
 		return NULL;
 	}
-
-	//assuming char is one byte
-	char *ret = (char *) malloc(length+1);
-	char *pos = ret;
-	ret[length]=0;
-	while(length) {
-		tot_str->Seek(offset+8, GEM_STREAM_START);
-		ieDword tmp = std::min<ieDword>(length, SEGMENT_SIZE);
-		tot_str->Read(pos, tmp);
-		tot_str->Seek(SEGMENT_SIZE-tmp, GEM_CURRENT_POS);
-		tot_str->ReadDword(&offset);
-		length-=tmp;
-		pos+=tmp;
-	}
+	ret[length] = 0;
 	return ret;
 }
 
@@ -285,23 +294,18 @@ ieStrRef CTlkOverride::GetNewStrRef(ieStrRef strref)
 	AuxCount++;
 	toh_str->Seek(12,GEM_STREAM_START);
 	toh_str->WriteDword(&AuxCount);
+	if (!entries.get(entry.strref)) {
+		entries.set(entry.strref, entry.offset);
+	}
 	return entry.strref;
 }
 
 ieDword CTlkOverride::LocateString(ieStrRef strref)
 {
-	ieDword strref2;
-	ieDword offset;
-
 	if (!toh_str) return 0xffffffff;
-	toh_str->Seek(TOH_HEADER_SIZE,GEM_STREAM_START);
-	for(ieDword i=0;i<AuxCount;i++) {
-		toh_str->ReadDword(&strref2);
-		toh_str->Seek(20,GEM_CURRENT_POS);
-		toh_str->ReadDword(&offset);
-		if (strref2==strref) {
-			return offset;
-		}
+	const ieDword *offset = entries.get(strref);
+	if (offset) {
+		return *offset;
 	}
 	return 0xffffffff;
 }
@@ -344,6 +348,8 @@ DataStream* CTlkOverride::GetAuxHdr(bool create)
 	char Signature[TOH_HEADER_SIZE];
 
 	PathJoin( nPath, core->CachePath, "default.toh", NULL );
+	// part of the save, which may not have put it in the cache yet
+	core->GetSaveExtractor()->Extract(nPath);
 	FileStream* fs = new FileStream();
 retry:
 	if (fs->Modify(nPath)) {
@@ -365,6 +371,8 @@ DataStream* CTlkOverride::GetAuxTlk(bool create)
 {
 	char nPath[_MAX_PATH];
 	PathJoin( nPath, core->CachePath, "default.tot", NULL );
+	// part of the save, which may not have put it in the cache yet
+	core->GetSaveExtractor()->Extract(nPath);
 	FileStream* fs = new FileStream();
 retry:
 	if (fs->Modify(nPath)) {
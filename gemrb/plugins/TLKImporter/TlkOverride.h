@@ -26,6 +26,7 @@
 
 #include "globals.h"
 
+#include "HashMap.h"
 #include "Interface.h"
 #include "System/FileStream.h"
 
@@ -63,8 +64,11 @@ private:
 	ieDword AuxCount;
 	ieDword FreeOffset;
 	ieDword NextStrRef;
+	// strref -> offset of its first segment in the tot
+	HashMap<ieStrRef, ieDword> entries;
 
 	void CloseResources();
+	void IndexEntries();
 	DataStream *GetAuxHdr(bool create);
 	DataStream *GetAuxTlk(bool create);
 	ieStrRef GetNewStrRef(ieStrRef strref);
@@ -73,7 +77,6 @@ private:
 	ieDword ClaimFreeSegment();
 	void ReleaseSegment(ieDword offset);
 	char *GetString(ieDword offset);
-	ieDword GetLength(ieDword offset);
 public:
 	CTlkOverride();
 	virtual ~CTlkOverride();
@@ -0,0 +1,208 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2011 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "GlyphCache.h"
+
+#include "TTFFont.h"
+
+#include "Interface.h"
+#include "System/FileStream.h"
+#include "System/VFS.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace GemRB {
+
+static const char GlyphCacheSignature[] = "GLC V1.0";
+
+// the characters the warm-up rasterizes: latin, the cjk punctuation and kana, the fullwidth forms
+static const ieWord WarmUpRanges[][2] = {
+	{ 0x21, 0x7E }, { 0xA1, 0xFF }, { 0x3000, 0x30FF }, { 0xFF01, 0xFF5E }
+};
+
+GlyphCache::GlyphCache(const FontFile* file, ieWord pxSize, int style)
+	: dirty(false)
+{
+	// dot files are spared when the cache is cleaned up, so this survives the restarts
+	char fname[_MAX_PATH];
+	snprintf(fname, sizeof(fname), ".ttf-%08x-%08x-%u-%d.glyphs", file->hash,
+		(unsigned int) file->data.size(), (unsigned int) pxSize, style);
+	char fpath[_MAX_PATH];
+	PathJoin(fpath, core->CachePath, fname, NULL);
+	path = fpath;
+}
+
+bool GlyphCache::Find(ieWord chr, CachedGlyph& glyph)
+{
+	MutexLock l(lock);
+	GlyphMap::const_iterator it = glyphs.find(chr);
+	if (it == glyphs.end()) {
+		return false;
+	}
+	glyph = it->second;
+	return true;
+}
+
+bool GlyphCache::Has(ieWord chr)
+{
+	MutexLock l(lock);
+	return glyphs.find(chr) != glyphs.end();
+}
+
+void GlyphCache::Add(ieWord chr, const CachedGlyph& glyph)
+{
+	MutexLock l(lock);
+	if (glyphs.insert(std::make_pair(chr, glyph)).second) {
+		dirty = true;
+	}
+}
+
+void GlyphCache::Load()
+{
+	if (!file_exists(path.c_str())) {
+		return;
+	}
+	FileStream* str = FileStream::OpenFile(path.c_str());
+	if (!str) {
+		return;
+	}
+
+	// read without the lock, the font may already be asking for glyphs
+	GlyphMap loaded;
+	char signature[8];
+	ieDword count = 0;
+	if (str->Read(signature, 8) == 8 && !strncmp(signature, GlyphCacheSignature, 8)) {
+		str->ReadDword(&count);
+	}
+	for (ieDword i = 0; i < count; i++) {
+		ieWord chr, w, h;
+		ieDword ypos;
+		str->ReadWord(&chr);
+		str->ReadWord(&w);
+		str->ReadWord(&h);
+		if (str->ReadDword(&ypos) != 4) {
+			break;
+		}
+		CachedGlyph glyph;
+		glyph.size = Size(w, h);
+		glyph.ypos = (int) ypos;
+		glyph.pixels.resize(w * h);
+		if (glyph.pixels.empty() || str->Read(&glyph.pixels[0], w * h) != w * h) {
+			break;
+		}
+		loaded[chr] = glyph;
+	}
+	delete str;
+
+	MutexLock l(lock);
+	// whatever was rasterized meanwhile is as good
+	loaded.insert(glyphs.begin(), glyphs.end());
+	glyphs.swap(loaded);
+}
+
+void GlyphCache::Save()
+{
+	MutexLock l(lock);
+	if (!dirty) {
+		return;
+	}
+	FileStream out;
+	if (!out.Create(path.c_str())) {
+		Log(WARNING, "TTFImporter", "Cannot write the glyph cache %s.", path.c_str());
+		return;
+	}
+	out.Write(GlyphCacheSignature, 8);
+	ieDword count = (ieDword) glyphs.size();
+	out.WriteDword(&count);
+	GlyphMap::const_iterator it = glyphs.begin();
+	for (; it != glyphs.end(); ++it) {
+		const CachedGlyph& glyph = it->second;
+		ieWord chr = it->first;
+		ieWord w = glyph.size.w;
+		ieWord h = glyph.size.h;
+		ieDword ypos = (ieDword) glyph.ypos;
+		out.WriteWord(&chr);
+		out.WriteWord(&w);
+		out.WriteWord(&h);
+		out.WriteDword(&ypos);
+		out.Write(&glyph.pixels[0], w * h);
+	}
+	dirty = false;
+}
+
+GlyphWarmer::GlyphWarmer(FontFile* file, FT_UInt pxWidth, FT_UInt pxHeight, GlyphCache* cache)
+	: file(file), pxWidth(pxWidth), pxHeight(pxHeight), cache(cache), stopping(false)
+{
+}
+
+GlyphWarmer::~GlyphWarmer()
+{
+	Stop();
+	Join();
+}
+
+void GlyphWarmer::Stop()
+{
+	MutexLock l(lock);
+	stopping = true;
+}
+
+bool GlyphWarmer::Stopping()
+{
+	MutexLock l(lock);
+	return stopping;
+}
+
+void GlyphWarmer::Run()
+{
+	cache->Load();
+
+	// freetype libraries and faces can't be shared between threads
+	FT_Library library;
+	if (FT_Init_FreeType(&library)) {
+		return;
+	}
+	FT_Face face;
+	if (FT_New_Memory_Face(library, &file->data[0], (FT_Long) file->data.size(), 0, &face)) {
+		FT_Done_FreeType(library);
+		return;
+	}
+	FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+	if (!FT_Set_Pixel_Sizes(face, pxWidth, pxHeight)) {
+		for (size_t r = 0; r < sizeof(WarmUpRanges) / sizeof(WarmUpRanges[0]); r++) {
+			for (unsigned int chr = WarmUpRanges[r][0]; chr <= WarmUpRanges[r][1]; chr++) {
+				if (Stopping()) break;
+				if (cache->Has(chr)) continue;
+
+				CachedGlyph glyph;
+				if (!TTFFont::RasterizeGlyph(face, chr, glyph) && !glyph.pixels.empty()) {
+					cache->Add(chr, glyph);
+				}
+			}
+		}
+	}
+	FT_Done_Face(face);
+	FT_Done_FreeType(library);
+
+	cache->Save();
+}
+
+}
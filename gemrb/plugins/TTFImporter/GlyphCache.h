@@ -0,0 +1,97 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2011 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef __GemRB__GlyphCache__
+#define __GemRB__GlyphCache__
+
+#include "Freetype.h"
+
+#include "Holder.h"
+#include "Region.h"
+#include "System/Thread.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GemRB {
+
+// the bytes of a font file, so the warm-up can open a face of its own
+class FontFile : public Held<FontFile> {
+public:
+	std::vector<unsigned char> data;
+	unsigned int hash;
+
+	FontFile() : hash(0) {}
+};
+
+// a rasterized glyph, padded like the glyph sprites
+struct CachedGlyph {
+	Size size;
+	int ypos;
+	std::vector<unsigned char> pixels;
+
+	CachedGlyph() : ypos(0) {}
+};
+
+// the rasterized glyphs of one font file, size and style, kept on disk between launches
+// the warm-up thread fills it too, so everything goes through the lock
+class GlyphCache {
+private:
+	typedef std::map<ieWord, CachedGlyph> GlyphMap;
+	GlyphMap glyphs;
+	Mutex lock;
+	std::string path;
+	bool dirty;
+
+public:
+	GlyphCache(const FontFile* file, ieWord pxSize, int style);
+
+	bool Find(ieWord chr, CachedGlyph& glyph);
+	bool Has(ieWord chr);
+	void Add(ieWord chr, const CachedGlyph& glyph);
+
+	void Load();
+	// only writes anything if glyphs were added since loading
+	void Save();
+};
+
+// rasterizes the common characters into the cache with its own face, so the first screens find them ready
+class GlyphWarmer : public Thread {
+public:
+	GlyphWarmer(FontFile* file, FT_UInt pxWidth, FT_UInt pxHeight, GlyphCache* cache);
+	~GlyphWarmer();
+
+	void Stop();
+protected:
+	void Run();
+private:
+	Holder<FontFile> file;
+	FT_UInt pxWidth, pxHeight;
+	GlyphCache* cache;
+	Mutex lock;
+	bool stopping;
+
+	bool Stopping();
+};
+
+}
+
+#endif /* defined(__GemRB__GlyphCache__) */
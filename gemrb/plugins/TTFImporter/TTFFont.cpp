@@ -19,6 +19,7 @@
  */
 
 #include "TTFFont.h"
+#include "GlyphCache.h"
 #include "Interface.h"
 #include "Sprite2D.h"
 #include "Video.h"
@@ -68,7 +69,34 @@ const Glyph& TTFFont::GetGlyph(ieWord chr) const
 		return g;
 	}
 
-	// attempt to generate glyph
+	// then if it was rasterized before, maybe on an earlier run
+	CachedGlyph cached;
+	if (!cache || !cache->Find(chr, cached)) {
+		// attempt to generate glyph
+		FT_Error error = RasterizeGlyph(face, chr, cached);
+		if (error) {
+			LogFTError(error);
+		}
+		if (cached.pixels.empty()) {
+			return AliasBlank(chr);
+		}
+		if (cache) {
+			cache->Add(chr, cached);
+		}
+	}
+
+	uint8_t* pixels = (uint8_t*)malloc(cached.pixels.size());
+	memcpy(pixels, &cached.pixels[0], cached.pixels.size());
+	Sprite2D* spr = core->GetVideoDriver()->CreateSprite8(cached.size.w, cached.size.h, pixels, palette, true, 0);
+	spr->YPos = cached.ypos;
+	// FIXME: casting away const
+	const Glyph& ret = ((TTFFont*)this)->CreateGlyphForCharSprite(chr, spr);
+	spr->release();
+	return ret;
+}
+
+FT_Error TTFFont::RasterizeGlyph(FT_Face face, ieWord chr, CachedGlyph& cached)
+{
 
 	// TODO: fix the font styles!
 	/*
@@ -92,13 +120,12 @@ const Glyph& TTFFont::GetGlyph(ieWord chr) const
 	FT_Error error = 0;
 	FT_UInt index = FT_Get_Char_Index(face, chr);
 	if (!index) {
-		return AliasBlank(chr);
+		return 0;
 	}
 
 	error = FT_Load_Glyph( face, index, FT_LOAD_DEFAULT | FT_LOAD_TARGET_MONO);
 	if( error ) {
-		LogFTError(error);
-		return AliasBlank(chr);
+		return error;
 	}
 
 	FT_GlyphSlot glyph = face->glyph;
@@ -128,13 +155,11 @@ const Glyph& TTFFont::GetGlyph(ieWord chr) const
 	 */
 
 	FT_Bitmap* bitmap;
-	uint8_t* pixels = NULL;
 
 	/* Render the glyph */
 	error = FT_Render_Glyph( glyph, ft_render_mode_normal );
 	if( error ) {
-		LogFTError(error);
-		return AliasBlank(chr);
+		return error;
 	}
 
 	bitmap = &glyph->bitmap;
@@ -149,13 +174,16 @@ const Glyph& TTFFont::GetGlyph(ieWord chr) const
 	}*/
 
 	if (sprSize.IsEmpty()) {
-		return AliasBlank(chr);
+		return 0;
 	}
 
 	// we need 1px empty space on each side
 	sprSize.w += 2;
 
-	pixels = (uint8_t*)malloc(sprSize.w * sprSize.h);
+	cached.size = sprSize;
+	cached.ypos = FT_FLOOR(metrics->horiBearingY);
+	cached.pixels.resize(sprSize.w * sprSize.h);
+	uint8_t* pixels = &cached.pixels[0];
 	uint8_t* dest = pixels;
 	uint8_t* src = bitmap->buffer;
 
@@ -175,13 +203,7 @@ const Glyph& TTFFont::GetGlyph(ieWord chr) const
 	assert((dest - pixels) == (sprSize.w * sprSize.h));
 
 	// TODO: do an underline if requested
-
-	Sprite2D* spr = core->GetVideoDriver()->CreateSprite8(sprSize.w, sprSize.h, pixels, palette, true, 0);
-	spr->YPos = FT_FLOOR(metrics->horiBearingY);
-	// FIXME: casting away const
-	const Glyph& ret = ((TTFFont*)this)->CreateGlyphForCharSprite(chr, spr);
-	spr->release();
-	return ret;
+	return 0;
 }
 
 int TTFFont::GetKerningOffset(ieWord leftChr, ieWord rightChr) const
@@ -199,8 +221,8 @@ int TTFFont::GetKerningOffset(ieWord leftChr, ieWord rightChr) const
 	return (int)(-kerning.x / 64);
 }
 
-TTFFont::TTFFont(Palette* pal, FT_Face face, int lineheight, int baseline)
-	: Font(pal, lineheight, baseline), face(face)
+TTFFont::TTFFont(Palette* pal, FT_Face face, int lineheight, int baseline, GlyphCache* cache)
+	: Font(pal, lineheight, baseline), face(face), cache(cache), warmer(NULL)
 {
 // on FT < 2.4.2 the manager will defer ownership to this object
 #if FREETYPE_VERSION_ATLEAST(2,4,2)
@@ -220,7 +242,27 @@ TTFFont::TTFFont(Palette* pal, FT_Face face, int lineheight, int baseline)
 
 TTFFont::~TTFFont()
 {
+	// stops the warm-up, the cache is saved right after
+	delete warmer;
+	if (cache) {
+		cache->Save();
+		delete cache;
+	}
 	FT_Done_Face(face);
 }
 
+void TTFFont::WarmUp(FontFile* file, FT_UInt pxWidth, FT_UInt pxHeight)
+{
+	if (!cache || warmer || file->data.empty()) {
+		return;
+	}
+	warmer = new GlyphWarmer(file, pxWidth, pxHeight, cache);
+	if (!warmer->Start()) {
+		delete warmer;
+		warmer = NULL;
+		// at least the glyphs of the earlier runs
+		cache->Load();
+	}
+}
+
 }
@@ -29,19 +29,32 @@
 
 namespace GemRB {
 
+class FontFile;
+class GlyphCache;
+class GlyphWarmer;
+struct CachedGlyph;
+
 class TTFFont : public Font
 {
 private:
 	FT_Face face;
+	GlyphCache* cache;
+	GlyphWarmer* warmer;
 
 	const Glyph& AliasBlank(ieWord chr) const;
 protected:
 	int GetKerningOffset(ieWord leftChr, ieWord rightChr) const;
 public:
-	TTFFont(Palette* pal, FT_Face face, int lineheight, int baseline);
+	// the font takes ownership of the cache, if any
+	TTFFont(Palette* pal, FT_Face face, int lineheight, int baseline, GlyphCache* cache = NULL);
 	~TTFFont(void);
 
 	const Glyph& GetGlyph(ieWord chr) const;
+	// fills the cache with the common characters in the background
+	void WarmUp(FontFile* file, FT_UInt pxWidth, FT_UInt pxHeight);
+
+	// the glyph pixels are left empty for the characters without any
+	static FT_Error RasterizeGlyph(FT_Face face, ieWord chr, CachedGlyph& glyph);
 };
 
 }
@@ -53,6 +53,16 @@ unsigned long TTFFontManager::read(FT_Stream		stream,
 	return dstream->Read(buffer, (int)count);
 }
 
+unsigned int TTFFontManager::HashData(const std::vector<unsigned char>& data)
+{
+	// FNV-1a over the bytes
+	unsigned int hash = 2166136261U;
+	for (size_t i = 0; i < data.size(); i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+	return hash;
+}
+
 void TTFFontManager::close( FT_Stream stream )
 {
 	if (stream)
@@ -81,6 +91,17 @@ bool TTFFontManager::Open(DataStream* stream)
 	if (stream) {
 		FT_Error error;
 
+		// keep a copy of the file, so the glyph caches can tell it apart from others
+		unsigned long pos = stream->GetPos();
+		file = new FontFile();
+		file->data.resize(stream->Size());
+		stream->Seek(0, GEM_STREAM_START);
+		if (file->data.empty() || stream->Read(&file->data[0], (unsigned int) file->data.size()) != (int) file->data.size()) {
+			file->data.clear();
+		}
+		file->hash = HashData(file->data);
+		stream->Seek((int) pos, GEM_STREAM_START);
+
 		ftStream = (FT_Stream)calloc(sizeof(*ftStream), 1);
 		ftStream->read = read;
 		ftStream->close = close;
@@ -113,10 +134,11 @@ void TTFFontManager::Close()
 		FT_Done_Face(face);
 	}
 	close(ftStream);
+	file.release();
 }
 
 Font* TTFFontManager::GetFont(unsigned short pxSize,
-							  FontStyle /*style*/, Palette* pal)
+							  FontStyle style, Palette* pal)
 {
 	if (!pal) {
 		pal = new Palette( ColorWhite, ColorBlack );
@@ -125,6 +147,7 @@ Font* TTFFontManager::GetFont(unsigned short pxSize,
 
 	FT_Error error = 0;
 	ieWord lineHeight = 0, baseline = 0;
+	FT_UInt pxWidth = 0, pxHeight = pxSize;
 	/* Make sure that our font face is scalable (global metrics) */
 	if ( FT_IS_SCALABLE(face) ) {
 		FT_Fixed scale;
@@ -150,9 +173,9 @@ Font* TTFFontManager::GetFont(unsigned short pxSize,
 		if ( pxSize >= face->num_fixed_sizes )
 			pxSize = face->num_fixed_sizes - 1;
 
-		error = FT_Set_Pixel_Sizes( face,
-								   face->available_sizes[pxSize].height,
-								   face->available_sizes[pxSize].width );
+		pxWidth = face->available_sizes[pxSize].height;
+		pxHeight = face->available_sizes[pxSize].width;
+		error = FT_Set_Pixel_Sizes( face, pxWidth, pxHeight );
 
 		if (error) {
 			LogFTError(error);
@@ -169,7 +192,12 @@ Font* TTFFontManager::GetFont(unsigned short pxSize,
 		//font->underline_height = FT_FLOOR(face->underline_thickness);
 	}
 
-	return new TTFFont(pal, face, lineHeight, baseline);
+	if (error || !file || file->data.empty()) {
+		return new TTFFont(pal, face, lineHeight, baseline);
+	}
+	TTFFont* font = new TTFFont(pal, face, lineHeight, baseline, new GlyphCache(file.get(), pxSize, style));
+	font->WarmUp(file.get(), pxWidth, pxHeight);
+	return font;
 }
 
 #include "plugindef.h"
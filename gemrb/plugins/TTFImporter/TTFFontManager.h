@@ -24,6 +24,7 @@
 #include "Freetype.h"
 
 #include "FontManager.h"
+#include "GlyphCache.h"
 
 namespace GemRB {
 
@@ -34,6 +35,10 @@ Private ivars
 private:
 	FT_Stream ftStream;
 	FT_Face face;
+	// what the glyph caches are keyed by and the warm-up reads
+	Holder<FontFile> file;
+
+	static unsigned int HashData(const std::vector<unsigned char>& data);
 
 public:
 /*
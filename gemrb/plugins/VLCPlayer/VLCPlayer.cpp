@@ -23,6 +23,9 @@
 
 using namespace GemRB;
 
+// how long the player waits for a new picture before polling the events again
+#define FRAME_WAIT 10
+
 VLCPlayer::VLCPlayer(void)
 {
 	libvlc = libvlc_new(0, NULL);
@@ -86,9 +89,14 @@ int VLCPlayer::Play()
 
 			bool done = false;
 			while (!done && libvlc_media_player_is_playing(mediaPlayer)) {
-				ctx->Lock();
 				done = video->PollMovieEvents();
 
+				// only a new picture is uploaded, the decoder meanwhile
+				// fills another frame instead of waiting for us
+				int frame = ctx->TakeFrame(FRAME_WAIT);
+				if (frame < 0) {
+					continue;
+				}
 				if (ctx->isYUV()) {
 					unsigned int strides[3];
 					strides[0] = ctx->GetStride(0);
@@ -96,9 +104,9 @@ int VLCPlayer::Play()
 					strides[2] = ctx->GetStride(2);
 
 					void* planes[3];
-					planes[0] = ctx->GetPlane(0);
-					planes[1] = ctx->GetPlane(1);
-					planes[2] = ctx->GetPlane(2);
+					planes[0] = ctx->GetPlane(frame, 0);
+					planes[1] = ctx->GetPlane(frame, 1);
+					planes[2] = ctx->GetPlane(frame, 2);
 
 					// TODO: center the video on the player.
 					video->showYUVFrame((unsigned char**)planes, strides, 
@@ -106,12 +114,12 @@ int VLCPlayer::Play()
 										ctx->Width(), ctx->Height(),
 										0, 0, 0);
 				} else {
-					video->showFrame((unsigned char*)ctx->GetPlane(0),
+					video->showFrame((unsigned char*)ctx->GetPlane(frame),
 									 ctx->Width(), ctx->Height(), 0, 0,
 									 ctx->Width(), ctx->Height(), 0, 0,
 									 true, NULL, 0);
 				}
-				ctx->Unlock();
+				ctx->ReleaseFrame(frame);
 			}
 		}
 		Stop();
@@ -121,23 +129,24 @@ int VLCPlayer::Play()
 
 // static vlc callbacks
 
-void VLCPlayer::display(void* /*data*/, void *id){
-	assert(id == NULL); // we are using a single buffer so id should always be NULL
-}
+// the picture id VLC hands back is our frame number
 
-void VLCPlayer::unlock(void *data, void *id, void *const * /*planes*/){
-	assert(id == NULL); // we are using a single buffer so id should always be NULL
+void VLCPlayer::display(void *data, void *id){
 	VideoContext* context = *(VideoContext**)data;
-	context->Unlock();
+	context->EndFrame((int) (size_t) id);
+}
+
+void VLCPlayer::unlock(void* /*data*/, void* /*id*/, void *const * /*planes*/){
+	// the frame is only handed over when VLC wants it displayed
 }
 
 void* VLCPlayer::lock(void *data, void **planes){
 	VideoContext* context = *(VideoContext**)data;
-	context->Lock();
-	planes[0] = context->GetPlane(0);
-	planes[1] = context->GetPlane(1);
-	planes[2] = context->GetPlane(2);
-	return NULL; // we are using a single buffer so return NULL
+	int frame = context->BeginFrame();
+	planes[0] = context->GetPlane(frame, 0);
+	planes[1] = context->GetPlane(frame, 1);
+	planes[2] = context->GetPlane(frame, 2);
+	return (void*) (size_t) frame;
 }
 
 void VLCPlayer::cleanup(void *opaque)
@@ -198,7 +207,7 @@ unsigned VLCPlayer::setup(void **opaque, char *chroma, unsigned *width, unsigned
 	lines[1] = h;
 	lines[2] = h;
 
-	return 1; // indicates the number of buffers allocated
+	return 1; // indicates the number of buffers allocated, VideoContext rotates the planes behind it
 }
 
 #include "plugindef.h"
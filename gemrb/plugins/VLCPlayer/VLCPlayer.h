@@ -39,6 +39,8 @@ namespace GemRB {
 
  1. we could enhance our video drivers to allow for additional pixel formats. (at least via bpp for RGB video)
  2. instead of VLC -> context -> video texture/surface we could provide a way to do VLC -> texture/surface
+    (the textures can't be locked from the decoder thread, so for now the context rotates
+    its frames and only the new pictures are uploaded)
  3. in VLCPlayer::setup() we could use the provided pitches and lines instead of forcing VLC to convert
  (see lazyness notes in VLCPlayer.cpp)
 */
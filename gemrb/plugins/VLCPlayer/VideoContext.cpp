@@ -21,6 +21,8 @@
 #include "VLCPlayer.h"
 #include "Video.h"
 
+#include <sys/time.h>
+
 using namespace GemRB;
 
 VideoContext::VideoContext(unsigned w, unsigned h, bool yuv)
@@ -29,45 +31,94 @@ VideoContext::VideoContext(unsigned w, unsigned h, bool yuv)
 	if(pthread_mutex_init(&mutex, NULL) != GEM_OK) {
 		Log(ERROR, "VLC Player", "Unable to create mutex!");
 	}
+	if (pthread_cond_init(&decoded, NULL) != GEM_OK) {
+		Log(ERROR, "VLC Player", "Unable to create condition variable!");
+	}
+	ready = showing = -1;
 
 	int size = width * height;
-	if (YUV) {
-		planes[0] = new char[size];
-		planes[1] = new char[size / 2];
-		planes[2] = new char[size / 2];
-	} else { // 16bit RGB
-		planes[0] = new char[size * 2];
-		planes[1] = NULL;
-		planes[2] = NULL;
+	for (int i = 0; i < VIDEO_FRAMES; i++) {
+		if (YUV) {
+			planes[i][0] = new char[size];
+			planes[i][1] = new char[size / 2];
+			planes[i][2] = new char[size / 2];
+		} else { // 16bit RGB
+			planes[i][0] = new char[size * 2];
+			planes[i][1] = NULL;
+			planes[i][2] = NULL;
+		}
 	}
 }
 
 VideoContext::~VideoContext(void)
 {
+	pthread_cond_destroy(&decoded);
 	pthread_mutex_destroy(&mutex);
-	delete[] (char*)planes[0];
-	if (YUV) {
-		delete[] (char*)planes[1];
-		delete[] (char*)planes[2];
+	for (int i = 0; i < VIDEO_FRAMES; i++) {
+		delete[] (char*)planes[i][0];
+		if (YUV) {
+			delete[] (char*)planes[i][1];
+			delete[] (char*)planes[i][2];
+		}
+	}
+}
+
+int VideoContext::BeginFrame()
+{
+	pthread_mutex_lock(&mutex);
+	int frame = 0;
+	while (frame == ready || frame == showing) {
+		frame++;
 	}
+	pthread_mutex_unlock(&mutex);
+	return frame;
 }
 
-int VideoContext::Lock()
+void VideoContext::EndFrame(int frame)
 {
-	return pthread_mutex_lock(&mutex);
+	pthread_mutex_lock(&mutex);
+	// a frame the player didn't get to is dropped
+	ready = frame;
+	pthread_cond_signal(&decoded);
+	pthread_mutex_unlock(&mutex);
 }
 
-int VideoContext::Unlock()
+int VideoContext::TakeFrame(unsigned int ms)
 {
-	return pthread_mutex_unlock(&mutex);
+	pthread_mutex_lock(&mutex);
+	if (ready < 0) {
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		struct timespec until;
+		long usec = now.tv_usec + ms * 1000;
+		until.tv_sec = now.tv_sec + usec / 1000000;
+		until.tv_nsec = (usec % 1000000) * 1000;
+		pthread_cond_timedwait(&decoded, &mutex, &until);
+	}
+	int frame = ready;
+	if (frame >= 0) {
+		showing = frame;
+		ready = -1;
+	}
+	pthread_mutex_unlock(&mutex);
+	return frame;
+}
+
+void VideoContext::ReleaseFrame(int frame)
+{
+	pthread_mutex_lock(&mutex);
+	if (showing == frame) {
+		showing = -1;
+	}
+	pthread_mutex_unlock(&mutex);
 }
 
-void* VideoContext::GetPlane(unsigned idx)
+void* VideoContext::GetPlane(int frame, unsigned idx)
 {
 	if (YUV) {
-		if (idx < 3) return planes[idx];
+		if (idx < 3) return planes[frame][idx];
 	} else {
-		return planes[0];
+		return planes[frame][0];
 	}
 	Log(ERROR, "VLCPlayer", "Plane index out of range.");
 	return NULL;
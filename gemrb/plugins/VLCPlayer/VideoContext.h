@@ -24,12 +24,21 @@
 #include <pthread.h>
 
 namespace GemRB {
-	
+
+// one frame being decoded, one waiting to be shown and one being shown,
+// so neither side waits for the other
+#define VIDEO_FRAMES 3
+
 class VideoContext
 {
 private:
 	pthread_mutex_t mutex;
-	void* planes[3];
+	pthread_cond_t decoded;
+	void* planes[VIDEO_FRAMES][3];
+	// the newest complete frame not taken yet and the one being shown, -1 if none
+	// (VLC gets a single picture, so any other frame is free to decode into)
+	int ready;
+	int showing;
 
 	bool YUV;
 	unsigned width;
@@ -38,10 +47,16 @@ public:
 	VideoContext(unsigned w, unsigned h, bool yuv);
 	~VideoContext(void);
 
-	int Lock();
-	int Unlock();
+	/* the decoder side: a frame neither shown nor waiting, for the next picture */
+	int BeginFrame();
+	/* the picture is complete, it replaces the one waiting, if any */
+	void EndFrame(int frame);
+	/* the player side: the newest frame, -1 if none arrived within ms */
+	int TakeFrame(unsigned int ms);
+	/* the frame was shown, the decoder may have it again */
+	void ReleaseFrame(int frame);
 
-	void* GetPlane(unsigned idx = 0);
+	void* GetPlane(int frame, unsigned idx = 0);
 	unsigned GetStride(unsigned idx = 0);
 	bool isYUV() { return YUV; };
 	unsigned Width() { return width; };
@@ -19,7 +19,6 @@
  */
 
 #ifdef ANDROID
-#include "swab.h"
 #endif
 
 #include "WEDImporter.h"
@@ -30,6 +29,7 @@
 #include "Interface.h"
 #include "PluginMgr.h"
 #include "TileSetMgr.h"
+#include "System/Thread.h"
 
 #if HAVE_UNISTD_H
 #include <unistd.h>
@@ -47,6 +47,51 @@ struct wed_polygon {
 //the net sizeof(wed_polygon) is 0x12 but not all compilers know that
 #define WED_POLYGON_SIZE  0x12
 
+// tiles handed out to a decoder at once, and the most decoders running
+#define TILE_JOB_SIZE 128
+#define MAX_TILE_DECODERS 4
+
+namespace GemRB {
+
+/** The tile ranges of the preloaded tileset still waiting for a decoder */
+struct TileJobs {
+	Mutex lock;
+	TileSetMgr* tis;
+	unsigned int next, total;
+
+	// decodes ranges until there are none left
+	void Run(DataStream* tiles)
+	{
+		while (true) {
+			unsigned int first;
+			{
+				MutexLock l(lock);
+				if (next >= total) {
+					return;
+				}
+				first = next;
+				next += TILE_JOB_SIZE;
+			}
+			tis->DecodeTiles(tiles, first, TILE_JOB_SIZE);
+		}
+	}
+};
+
+/** A worker decoding tiles through its own copy of the tileset stream */
+class TileDecoder : public Thread {
+public:
+	TileDecoder(TileJobs* jobs, DataStream* tiles) : jobs(jobs), tiles(tiles) {}
+	// the stream copy is deleted here, on the main thread
+	~TileDecoder() { Join(); delete tiles; }
+protected:
+	void Run() { jobs->Run(tiles); }
+private:
+	TileJobs* jobs;
+	DataStream* tiles;
+};
+
+}
+
 WEDImporter::WEDImporter(void)
 {
 	str = NULL;
@@ -55,10 +100,13 @@ WEDImporter::WEDImporter(void)
 	WallPolygonsCount = PolygonsOffset = VerticesOffset = WallGroupsOffset = 0;
 	OpenPolyCount = ClosedPolyCount = OpenPolyOffset = ClosedPolyOffset = 0;
 	ExtendedNight = false;
+	preloadedResRef[0] = 0;
+	tileJobs = NULL;
 }
 
 WEDImporter::~WEDImporter(void)
 {
+	FinishPreload();
 	delete str;
 }
 
@@ -104,12 +152,9 @@ bool WEDImporter::Open(DataStream* stream)
 	return true;
 }
 
-int WEDImporter::AddOverlay(TileMap *tm, Overlay *overlays, bool rain)
+void WEDImporter::GetTileSetResRef(const Overlay *overlay, bool rain, ieResRef res)
 {
-	ieResRef res;
-	int usedoverlays = 0;
-
-	memcpy(res, overlays->TilesetResRef, sizeof(ieResRef));
+	memcpy(res, overlay->TilesetResRef, sizeof(ieResRef));
 	int len = strlen(res);
 	// in BG1 extended night WEDs alway reference the day TIS instead of the matching night TIS
 	if (ExtendedNight && len == 6) {
@@ -127,12 +172,96 @@ int WEDImporter::AddOverlay(TileMap *tm, Overlay *overlays, bool rain)
 			res[len] = '\0';
 		}
 	}
-	DataStream* tisfile = gamedata->GetResource(res, IE_TIS_CLASS_ID);
+}
+
+/** Opens the base tileset and starts decoding its tiles on a few threads.
+ * Only the sprite creation is left for GetTileMap, the rest of the area can
+ * load on the main thread in the meantime. The other overlays are small. */
+void WEDImporter::PreloadTileSets()
+{
+	FinishPreload();
+	// streamed tiles are only decoded when they come into view
+	if (!overlays.size() || core->TileBudget > 0) {
+		return;
+	}
+
+	GetTileSetResRef(&overlays.at(0), false, preloadedResRef);
+	DataStream* tisfile = gamedata->GetResource(preloadedResRef, IE_TIS_CLASS_ID);
 	if (!tisfile) {
-		return -1;
+		return;
+	}
+	preloaded = PluginHolder<TileSetMgr>(IE_TIS_CLASS_ID);
+	if (!preloaded->Open(tisfile)) {
+		preloaded = PluginHolder<TileSetMgr>();
+		return;
+	}
+
+	tileJobs = new TileJobs();
+	tileJobs->tis = preloaded.get();
+	tileJobs->next = 0;
+	tileJobs->total = preloaded->GetTilesCount();
+	unsigned int count = Thread::GetProcessorCount();
+	if (count > MAX_TILE_DECODERS) {
+		count = MAX_TILE_DECODERS;
+	}
+	if (count > tileJobs->total / TILE_JOB_SIZE) {
+		count = tileJobs->total / TILE_JOB_SIZE;
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		DataStream* tiles = preloaded->CloneStream();
+		if (!tiles) {
+			break;
+		}
+		TileDecoder* decoder = new TileDecoder(tileJobs, tiles);
+		if (!decoder->Start()) {
+			Log(WARNING, "WEDImporter", "Couldn't start a tile decoding thread.");
+			delete decoder;
+			break;
+		}
+		decoders.push_back(decoder);
+	}
+}
+
+/** Helps the decoders with the remaining tiles and waits for them */
+void WEDImporter::FinishPreload()
+{
+	if (!tileJobs) {
+		return;
+	}
+	DataStream* tiles = preloaded->CloneStream();
+	if (tiles) {
+		tileJobs->Run(tiles);
+		delete tiles;
+	}
+	for (size_t i = 0; i < decoders.size(); i++) {
+		delete decoders[i];
+	}
+	decoders.clear();
+	delete tileJobs;
+	tileJobs = NULL;
+}
+
+int WEDImporter::AddOverlay(TileMap *tm, Overlay *overlays, bool rain)
+{
+	ieResRef res;
+	int usedoverlays = 0;
+
+	GetTileSetResRef(overlays, rain, res);
+	PluginHolder<TileSetMgr> tis;
+	if (preloaded && !strnicmp(res, preloadedResRef, sizeof(ieResRef))) {
+		FinishPreload();
+		tis = preloaded;
+		preloaded = PluginHolder<TileSetMgr>();
+	} else {
+		DataStream* tisfile = gamedata->GetResource(res, IE_TIS_CLASS_ID);
+		if (!tisfile) {
+			return -1;
+		}
+		tis = PluginHolder<TileSetMgr>(IE_TIS_CLASS_ID);
+		tis->Open( tisfile );
 	}
-	PluginHolder<TileSetMgr> tis(IE_TIS_CLASS_ID);
-	tis->Open( tisfile );
+	// the base overlay of a big area may be streamed, the rest is small
+	bool stream = core->TileBudget > 0 && overlays == &this->overlays.at(0);
 	TileOverlay *over = new TileOverlay( overlays->Width, overlays->Height );
 	for (int y = 0; y < overlays->Height; y++) {
 		for (int x = 0; x < overlays->Width; x++) {
@@ -152,24 +281,30 @@ int WEDImporter::AddOverlay(TileMap *tm, Overlay *overlays, bool rain)
 			str->Seek( overlays->TILOffset + ( startindex * 2 ),
 				GEM_STREAM_START );
 			ieWord* indices = ( ieWord* ) calloc( count, sizeof(ieWord) );
-			str->Read( indices, count * sizeof(ieWord) );
-			if( DataStream::IsEndianSwitch()) {
-				swab( (char*) indices, (char*) indices, count * sizeof(ieWord) );
-			}
+			str->ReadWords( indices, count );
 			Tile* tile;
-			if (secondary == 0xffff) {
+			if (stream) {
+				// decoded once it is first drawn, it keeps the indices
+				tile = new Tile( indices, count, secondary, animspeed );
+				indices = NULL;
+			} else if (secondary == 0xffff) {
 				tile = tis->GetTile( indices, count );
 			} else {
 				tile = tis->GetTile( indices, 1, &secondary );
 				tile->anim[1]->fps = animspeed;
 			}
-			tile->anim[0]->fps = animspeed;
+			if (tile->anim[0]) {
+				tile->anim[0]->fps = animspeed;
+			}
 			tile->om = overlaymask;
 			usedoverlays |= overlaymask;
 			over->AddTile( tile );
 			free( indices );
 		}
 	}
+	if (stream) {
+		over->SetTileSource( tis, core->TileBudget );
+	}
 	
 	if (rain) {
 		tm->AddRainOverlay( over );
@@ -279,10 +414,7 @@ ieWord* WEDImporter::GetDoorIndices(char* ResRef, int* count, bool& BaseClosed)
 	//Reading Door Tile Cells
 	str->Seek( DoorTilesOffset + ( DoorTileStart * 2 ), GEM_STREAM_START );
 	DoorTiles = ( ieWord* ) calloc( DoorTileCount, sizeof( ieWord) );
-	str->Read( DoorTiles, DoorTileCount * sizeof( ieWord ) );
-	if( DataStream::IsEndianSwitch()) {
-		swab( (char*) DoorTiles, (char*) DoorTiles, DoorTileCount * sizeof( ieWord) );
-	}
+	str->ReadWords( DoorTiles, DoorTileCount );
 	*count = DoorTileCount;
 	BaseClosed = DoorClosed != 0;
 	return DoorTiles;
@@ -331,10 +463,7 @@ Wall_Polygon **WEDImporter::GetWallGroups()
 			flags |= WF_BASELINE;
 		}
 		Point *points = new Point[count];
-		str->Read (points, count * sizeof (Point) );
-		if( DataStream::IsEndianSwitch()) {
-			swab( (char*) points, (char*) points, count * sizeof (Point) );
-		}
+		str->ReadPoints( points, count );
 
 		if (!(flags&WF_BASELINE) ) {
 			if (PolygonHeaders[i].Flags&WF_BASELINE) {
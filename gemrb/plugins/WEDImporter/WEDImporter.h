@@ -23,8 +23,16 @@
 
 #include "TileMapMgr.h"
 
+#include "PluginMgr.h"
+#include "TileSetMgr.h"
+
+#include <vector>
+
 namespace GemRB {
 
+class TileDecoder;
+struct TileJobs;
+
 struct Overlay {
 	ieWord  Width;
 	ieWord  Height;
@@ -47,14 +55,22 @@ private:
 	ieWord OpenPolyCount, ClosedPolyCount;
 	ieDword OpenPolyOffset, ClosedPolyOffset;
 	bool ExtendedNight;
+	// the base tileset, decoded by a few threads while the area loads the rest
+	PluginHolder<TileSetMgr> preloaded;
+	ieResRef preloadedResRef;
+	TileJobs* tileJobs;
+	std::vector<TileDecoder*> decoders;
 
 private:
 	void GetDoorPolygonCount(ieWord count, ieDword offset);
+	void GetTileSetResRef(const Overlay *overlay, bool rain, ieResRef res);
 	int AddOverlay(TileMap *tm, Overlay *overlays, bool rain);
+	void FinishPreload();
 public:
 	WEDImporter(void);
 	~WEDImporter(void);
 	bool Open(DataStream* stream);
+	void PreloadTileSets();
 	//if tilemap already exists, don't create it
 	TileMap* GetTileMap(TileMap *tm);
 	ieWord* GetDoorIndices(char* ResRef, int* count, bool& BaseClosed);
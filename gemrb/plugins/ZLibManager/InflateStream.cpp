@@ -0,0 +1,156 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "InflateStream.h"
+
+#include "globals.h"
+#include "win32def.h"
+
+#include <cstring>
+
+using namespace GemRB;
+
+InflateStream::InflateStream(DataStream *source, unsigned int complen, unsigned int declen)
+	: source(source), complen(complen), consumed(0), inflated(0)
+{
+	start = source->GetPos();
+	size = declen;
+	strlcpy(originalfile, source->originalfile, _MAX_PATH);
+	strlcpy(filename, source->filename, sizeof(filename));
+
+	memset(&zstream, 0, sizeof(zstream));
+	zstream.zalloc = Z_NULL;
+	zstream.zfree = Z_NULL;
+	zstream.opaque = Z_NULL;
+	ready = inflateInit(&zstream) == Z_OK;
+}
+
+InflateStream::~InflateStream()
+{
+	if (ready) {
+		inflateEnd(&zstream);
+	}
+	delete source;
+}
+
+DataStream* InflateStream::Clone()
+{
+	DataStream *copy = source->Clone();
+	if (!copy) {
+		return NULL;
+	}
+	copy->Seek(start, GEM_STREAM_START);
+	return new InflateStream(copy, complen, size);
+}
+
+int InflateStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (!ready || Pos + length > size) {
+		return GEM_ERROR;
+	}
+	if (Pos < inflated && !Restart()) {
+		return GEM_ERROR;
+	}
+	if (!Skip(Pos - inflated) || !Inflate(dest, length)) {
+		return GEM_ERROR;
+	}
+	Pos += length;
+	return length;
+}
+
+int InflateStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	return GEM_ERROR;
+}
+
+int InflateStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+		default:
+			return GEM_ERROR;
+	}
+	if (Pos > size) {
+		print("[Streams]: Invalid seek position %ld in file %s(limit: %ld)", Pos, filename, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
+bool InflateStream::Restart()
+{
+	if (inflateReset(&zstream) != Z_OK || source->Seek(start, GEM_STREAM_START) != GEM_OK) {
+		return false;
+	}
+	zstream.avail_in = 0;
+	consumed = 0;
+	inflated = 0;
+	return true;
+}
+
+bool InflateStream::Inflate(void *dest, unsigned int length)
+{
+	zstream.next_out = (Bytef *) dest;
+	zstream.avail_out = length;
+	while (zstream.avail_out) {
+		if (!zstream.avail_in) {
+			unsigned int chunk = complen - consumed;
+			if (chunk > INFLATE_BUFFER) {
+				chunk = INFLATE_BUFFER;
+			}
+			if (!chunk || source->Read(buffer, chunk) != (int) chunk) {
+				break;
+			}
+			consumed += chunk;
+			zstream.next_in = buffer;
+			zstream.avail_in = chunk;
+		}
+		int result = inflate(&zstream, Z_NO_FLUSH);
+		if (result != Z_OK) {
+			// Z_STREAM_END too, since the stream ended early
+			break;
+		}
+	}
+	inflated += length - zstream.avail_out;
+	return !zstream.avail_out;
+}
+
+bool InflateStream::Skip(unsigned long length)
+{
+	unsigned char scratch[INFLATE_BUFFER];
+	while (length) {
+		unsigned int chunk = length < INFLATE_BUFFER ? (unsigned int) length : INFLATE_BUFFER;
+		if (!Inflate(scratch, chunk)) {
+			return false;
+		}
+		length -= chunk;
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#ifndef INFLATESTREAM_H
+#define INFLATESTREAM_H
+
+#include "System/DataStream.h"
+
+#include <zlib.h>
+
+namespace GemRB {
+
+#define INFLATE_BUFFER 8192
+
+/* Reads a zlib stream embedded in another stream, inflating it only as far
+ * as it is read. The data goes straight into the buffers of the reader and
+ * seeks are only acted upon by the next read: forward ones inflate the gap
+ * into a scratch buffer, backward ones start over.
+ */
+class InflateStream : public DataStream {
+public:
+	InflateStream(DataStream *source, unsigned int complen, unsigned int declen);
+	~InflateStream();
+	DataStream* Clone();
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+
+private:
+	DataStream *source;
+	unsigned long start;
+	unsigned int complen, consumed;
+	unsigned long inflated; // where the inflater is
+	bool ready;
+	z_stream zstream;
+	unsigned char buffer[INFLATE_BUFFER];
+
+	bool Restart();
+	bool Inflate(void *dest, unsigned int length);
+	bool Skip(unsigned long length);
+};
+
+}
+
+#endif
@@ -20,10 +20,15 @@
 
 #include "ZLibManager.h"
 
+#include "InflateStream.h"
+
 #include "globals.h"
 #include "win32def.h"
 
 #include <zlib.h>
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 
 using namespace GemRB;
 
@@ -153,6 +158,39 @@ int ZLibManager::Compress(DataStream* dest, DataStream* source) const
 	}
 }
 
+// the whole stream is at hand, so there is no need to go through the buffers
+int ZLibManager::DecompressBuffer(void *dest, unsigned int destlen, const void *source, unsigned int sourcelen) const
+{
+#ifdef HAVE_LIBDEFLATE
+	// the decompressors can't be shared between threads, but they are cheap
+	struct libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+	if (!decompressor) {
+		return GEM_ERROR;
+	}
+	size_t inflated;
+	enum libdeflate_result result = libdeflate_zlib_decompress(decompressor, source, sourcelen, dest, destlen, &inflated);
+	libdeflate_free_decompressor(decompressor);
+	if (result != LIBDEFLATE_SUCCESS) {
+		return GEM_ERROR;
+	}
+	return (int) inflated;
+#else
+	uLongf inflated = destlen;
+	if (uncompress((Bytef *) dest, &inflated, (const Bytef *) source, sourcelen) != Z_OK) {
+		return GEM_ERROR;
+	}
+	return (int) inflated;
+#endif
+}
+
+DataStream* ZLibManager::CreateInflateStream(DataStream *source, unsigned int complen, unsigned int declen) const
+{
+	if (!complen || complen > source->Remains()) {
+		complen = (unsigned int) source->Remains();
+	}
+	return new InflateStream(source, complen, declen);
+}
+
 #include "plugindef.h"
 
 GEMRB_PLUGIN(0x2477C688, "ZLib Compression Manager")
@@ -33,6 +33,10 @@ public:
 	int Decompress(DataStream* dest, DataStream* source, unsigned int size_guess) const;
 	// ZLib Compression
 	int Compress(DataStream* dest, DataStream* source) const;
+	// inflating a whole buffer at once
+	int DecompressBuffer(void *dest, unsigned int destlen, const void *source, unsigned int sourcelen) const;
+	// inflating on demand
+	DataStream* CreateInflateStream(DataStream *source, unsigned int complen, unsigned int declen) const;
 };
 
 }
@@ -0,0 +1,377 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// gemrb_bench: runs the microbenchmarks or the scenarios and writes their
+// results as json
+
+#include "Bench.h"
+
+#include "win32def.h" // logging
+
+#include "Game.h"
+#include "Interface.h"
+#include "InterfaceConfig.h"
+#include "GameScript/ScriptProfiler.h"
+#include "System/FileStream.h"
+#include "System/VFS.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+using namespace GemRB;
+
+// every allocation of the process goes through these, so the scenarios can
+// tell how much they allocated; the worker threads may lose a few counts
+static unsigned long allocations = 0;
+static unsigned long allocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+	allocations++;
+	allocatedBytes += size;
+	void *p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+namespace GemRB {
+
+volatile ieDword BenchSink = 0;
+BenchOptions BenchConfig = { NULL, NULL, NULL, NULL, 20, 1000 };
+
+BenchCase::BenchCase(const char *name)
+	: name(name)
+{
+	GetAll().push_back(this);
+}
+
+std::vector<BenchCase*> &BenchCase::GetAll()
+{
+	static std::vector<BenchCase*> cases;
+	return cases;
+}
+
+BenchScenario::BenchScenario(const char *name)
+	: name(name)
+{
+	GetAll().push_back(this);
+}
+
+std::vector<BenchScenario*> &BenchScenario::GetAll()
+{
+	static std::vector<BenchScenario*> scenarios;
+	return scenarios;
+}
+
+}
+
+#define BENCH_SAMPLES 5
+
+struct BenchResult {
+	const char *name;
+	unsigned int iterations;
+	double median; // ns per iteration
+	double min;
+};
+
+struct ScenarioResult {
+	const char *name;
+	double ms;
+	unsigned long allocations;
+	unsigned long bytes;
+	bool passed;
+};
+
+// the limits of a scenario, 0 means there is none
+struct ScenarioThreshold {
+	std::string name;
+	double ms;
+	unsigned long allocations;
+};
+
+static unsigned __int64 TimeRun(BenchCase *bench, unsigned int iterations)
+{
+	unsigned __int64 start = ScriptProfiler::Now();
+	bench->Run(iterations);
+	return ScriptProfiler::Now() - start;
+}
+
+// doubles the iterations until a sample takes sampleTime, then takes the samples
+static BenchResult Measure(BenchCase *bench, unsigned __int64 sampleTime)
+{
+	unsigned int iterations = 1;
+	// the first run is the warm up (caches, lazy loading)
+	unsigned __int64 elapsed = TimeRun(bench, iterations);
+	while (elapsed < sampleTime && iterations < 0x40000000) {
+		iterations *= 2;
+		elapsed = TimeRun(bench, iterations);
+	}
+
+	double samples[BENCH_SAMPLES];
+	for (int i = 0; i < BENCH_SAMPLES; i++) {
+		samples[i] = (double) TimeRun(bench, iterations) / iterations;
+	}
+	std::sort(samples, samples + BENCH_SAMPLES);
+
+	BenchResult result;
+	result.name = bench->GetName();
+	result.iterations = iterations;
+	result.median = samples[BENCH_SAMPLES / 2];
+	result.min = samples[0];
+	return result;
+}
+
+// lines of "name max_ms max_allocations", # starts a comment
+static bool LoadThresholds(const char *path, std::vector<ScenarioThreshold> &thresholds)
+{
+	FileStream in;
+	if (!in.Open(path)) {
+		Log(ERROR, "Bench", "Couldn't open '%s'!", path);
+		return false;
+	}
+	char line[256];
+	while (in.ReadLine(line, sizeof(line)) != -1) {
+		char name[64];
+		ScenarioThreshold threshold;
+		if (line[0] == '#' || sscanf(line, "%63s %lf %lu", name, &threshold.ms, &threshold.allocations) != 3) {
+			continue;
+		}
+		threshold.name = name;
+		thresholds.push_back(threshold);
+	}
+	return true;
+}
+
+static ScenarioResult RunScenario(BenchScenario *scenario, const std::vector<ScenarioThreshold> &thresholds)
+{
+	unsigned long startAllocations = allocations;
+	unsigned long startBytes = allocatedBytes;
+	unsigned __int64 start = ScriptProfiler::Now();
+	bool ok = scenario->Run();
+	unsigned __int64 elapsed = ScriptProfiler::Now() - start;
+
+	ScenarioResult result;
+	result.name = scenario->GetName();
+	result.ms = elapsed / 1000000.0;
+	result.allocations = allocations - startAllocations;
+	result.bytes = allocatedBytes - startBytes;
+	result.passed = ok;
+	if (!ok) {
+		Log(ERROR, "Bench", "%s failed.", result.name);
+	}
+	for (size_t i = 0; i < thresholds.size(); i++) {
+		const ScenarioThreshold &threshold = thresholds[i];
+		if (threshold.name != result.name) continue;
+		if (threshold.ms && result.ms > threshold.ms) {
+			Log(ERROR, "Bench", "%s took %.1fms, the limit is %.1fms.", result.name, result.ms, threshold.ms);
+			result.passed = false;
+		}
+		if (threshold.allocations && result.allocations > threshold.allocations) {
+			Log(ERROR, "Bench", "%s made %lu allocations, the limit is %lu.", result.name, result.allocations, threshold.allocations);
+			result.passed = false;
+		}
+	}
+	return result;
+}
+
+static bool WriteResults(const char *path, const std::vector<BenchResult> &results,
+	const std::vector<ScenarioResult> &scenarios, const std::vector<const char*> &skipped)
+{
+	FileStream out;
+	if (!out.Create(path)) {
+		Log(ERROR, "Bench", "Couldn't create '%s'!", path);
+		return false;
+	}
+
+	char line[256];
+	int len = snprintf(line, sizeof(line), "{\"version\":\"%s\",\"samples\":%d,\"benchmarks\":[\n", VERSION_GEMRB, BENCH_SAMPLES);
+	out.Write(line, (unsigned int) len);
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult &result = results[i];
+		len = snprintf(line, sizeof(line),
+			"%s{\"name\":\"%s\",\"iterations\":%u,\"median_ns\":%.1f,\"min_ns\":%.1f}",
+			i ? ",\n" : "", result.name, result.iterations, result.median, result.min);
+		out.Write(line, (unsigned int) len);
+	}
+	out.Write("\n],\"scenarios\":[\n", 17);
+	for (size_t i = 0; i < scenarios.size(); i++) {
+		const ScenarioResult &result = scenarios[i];
+		len = snprintf(line, sizeof(line),
+			"%s{\"name\":\"%s\",\"ms\":%.3f,\"allocations\":%lu,\"allocated_bytes\":%lu,\"passed\":%s}",
+			i ? ",\n" : "", result.name, result.ms, result.allocations, result.bytes,
+			result.passed ? "true" : "false");
+		out.Write(line, (unsigned int) len);
+	}
+	out.Write("\n],\"skipped\":[", 14);
+	for (size_t i = 0; i < skipped.size(); i++) {
+		len = snprintf(line, sizeof(line), "%s\"%s\"", i ? "," : "", skipped[i]);
+		out.Write(line, (unsigned int) len);
+	}
+	out.Write("]}\n", 3);
+	return true;
+}
+
+static const char *GetOption(const char *arg, const char *option)
+{
+	size_t len = strlen(option);
+	if (strncmp(arg, option, len) || arg[len] != '=') {
+		return NULL;
+	}
+	return arg + len + 1;
+}
+
+int main(int argc, char* argv[])
+{
+	const char *outPath = "gemrb-bench.json";
+	const char *filter = NULL;
+	const char *thresholdsPath = NULL;
+	unsigned __int64 sampleTime = 20000000; // 20ms
+	bool enterGame = false;
+	bool scenarioMode = false;
+
+	// take our options out, the rest is for the config (-c, --Key=Value)
+	std::vector<char*> args;
+	// look for gemrb.cfg, not gemrb_bench.cfg
+	std::string appName(argv[0]);
+	size_t slash = appName.rfind(PathDelimiter);
+	appName.replace(slash == std::string::npos ? 0 : slash + 1, std::string::npos, "gemrb");
+	args.push_back(&appName[0]);
+	for (int i = 1; i < argc; i++) {
+		const char *value;
+		if ((value = GetOption(argv[i], "--bench-out"))) {
+			outPath = value;
+		} else if ((value = GetOption(argv[i], "--bench-filter"))) {
+			filter = value;
+		} else if ((value = GetOption(argv[i], "--bench-sound"))) {
+			BenchConfig.sound = value;
+		} else if ((value = GetOption(argv[i], "--bench-time"))) {
+			sampleTime = (unsigned __int64) atoi(value) * 1000000;
+		} else if ((value = GetOption(argv[i], "--bench-thresholds"))) {
+			thresholdsPath = value;
+		} else if ((value = GetOption(argv[i], "--bench-creature"))) {
+			BenchConfig.creature = value;
+		} else if ((value = GetOption(argv[i], "--bench-actors"))) {
+			BenchConfig.actors = atoi(value);
+		} else if ((value = GetOption(argv[i], "--bench-ticks"))) {
+			BenchConfig.ticks = atoi(value);
+		} else if ((value = GetOption(argv[i], "--bench-load-area"))) {
+			BenchConfig.area = value;
+		} else if ((value = GetOption(argv[i], "--bench-window-pack"))) {
+			BenchConfig.windowPack = value;
+		} else if (!strcmp(argv[i], "--bench-game")) {
+			enterGame = true;
+		} else if (!strcmp(argv[i], "--bench-scenarios")) {
+			enterGame = scenarioMode = true;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	args.push_back(NULL);
+
+	std::vector<ScenarioThreshold> thresholds;
+	if (thresholdsPath && !LoadThresholds(thresholdsPath, thresholds)) {
+		return -1;
+	}
+
+	Interface::SanityCheck(VERSION_GEMRB);
+	InitializeLogging();
+
+	core = new Interface();
+	CFGConfig* config = new CFGConfig((int) args.size() - 1, &args[0]);
+	if (core->Init( config ) == GEM_ERROR) {
+		delete config;
+		delete( core );
+		Log(MESSAGE, "Bench", "Aborting due to fatal error...");
+		ShutdownLogging();
+		return -1;
+	}
+	delete config;
+
+	// the benchmarks of the area, actor and script code need a loaded game
+	if (enterGame && !core->EnterBenchmarkGame()) {
+		Log(WARNING, "Bench", "Couldn't load the game, its benchmarks are skipped.");
+	}
+
+	std::vector<BenchResult> results;
+	std::vector<ScenarioResult> scenarioResults;
+	std::vector<const char*> skipped;
+	bool passed = true;
+	if (scenarioMode) {
+		std::vector<BenchScenario*> &scenarios = BenchScenario::GetAll();
+		for (size_t i = 0; i < scenarios.size(); i++) {
+			BenchScenario *scenario = scenarios[i];
+			if (filter && !strstr(scenario->GetName(), filter)) {
+				continue;
+			}
+			if (!core->GetGame() || !scenario->Setup()) {
+				Log(MESSAGE, "Bench", "%-28s skipped", scenario->GetName());
+				skipped.push_back(scenario->GetName());
+				continue;
+			}
+			ScenarioResult result = RunScenario(scenario, thresholds);
+			scenario->Teardown();
+			Log(MESSAGE, "Bench", "%-28s %10.1f ms, %lu allocations (%lu bytes)%s",
+				result.name, result.ms, result.allocations, result.bytes, result.passed ? "" : " FAILED");
+			passed = passed && result.passed;
+			scenarioResults.push_back(result);
+		}
+	} else {
+		std::vector<BenchCase*> &cases = BenchCase::GetAll();
+		for (size_t i = 0; i < cases.size(); i++) {
+			BenchCase *bench = cases[i];
+			if (filter && !strstr(bench->GetName(), filter)) {
+				continue;
+			}
+			if (!bench->Setup()) {
+				Log(MESSAGE, "Bench", "%-28s skipped", bench->GetName());
+				skipped.push_back(bench->GetName());
+				continue;
+			}
+			BenchResult result = Measure(bench, sampleTime);
+			bench->Teardown();
+			Log(MESSAGE, "Bench", "%-28s %12.1f ns/op (min %.1f, %u iterations)",
+				result.name, result.median, result.min, result.iterations);
+			results.push_back(result);
+		}
+	}
+
+	int ret = 0;
+	if (WriteResults(outPath, results, scenarioResults, skipped)) {
+		Log(MESSAGE, "Bench", "Wrote %d results to '%s'.", (int) (results.size() + scenarioResults.size()), outPath);
+	} else {
+		ret = -1;
+	}
+	if (!passed) {
+		Log(ERROR, "Bench", "Some scenarios failed or went over their limits.");
+		ret = 1;
+	}
+	delete( core );
+	ShutdownLogging();
+	return ret;
+}
@@ -0,0 +1,100 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "ie_types.h"
+
+#include <vector>
+
+namespace GemRB {
+
+/* A microbenchmark: Setup() prepares the data once (false skips the case,
+ * eg. without game data), Run() does the measured work the given number of
+ * times. The cases register themselves by being constructed, so each one is
+ * just a static instance in one of the bench sources.
+ */
+class BenchCase {
+public:
+	BenchCase(const char *name);
+	virtual ~BenchCase() {}
+
+	virtual bool Setup() { return true; }
+	virtual void Run(unsigned int iterations) = 0;
+	virtual void Teardown() {}
+
+	const char *GetName() const { return name; }
+	static std::vector<BenchCase*> &GetAll();
+private:
+	const char *name;
+};
+
+/* An end to end scenario on the loaded game: Run() is measured once, its
+ * wall time and allocations are compared to the thresholds. The scenarios
+ * run in the order they are declared in Scenarios.cpp.
+ */
+class BenchScenario {
+public:
+	BenchScenario(const char *name);
+	virtual ~BenchScenario() {}
+
+	virtual bool Setup() { return true; }
+	/* false if the scenario failed */
+	virtual bool Run() = 0;
+	virtual void Teardown() {}
+
+	const char *GetName() const { return name; }
+	static std::vector<BenchScenario*> &GetAll();
+private:
+	const char *name;
+};
+
+/* the data the benchmarks work on, from the command line */
+struct BenchOptions {
+	const char *sound; // decoded by sound/decode
+	const char *creature; // spawned by scenario/ticks
+	const char *area; // loaded by scenario/area-load
+	const char *windowPack; // opened by scenario/window-pack
+	unsigned int actors;
+	unsigned int ticks;
+};
+
+extern BenchOptions BenchConfig;
+
+/* the fixed seed random numbers, so the synthetic data is the same each run */
+class BenchRandom {
+public:
+	BenchRandom(ieDword seed = 0x6d2b79f5) : state(seed) {}
+	ieDword Next()
+	{
+		state = state * 1664525 + 1013904223;
+		return state >> 8;
+	}
+	ieDword Next(ieDword range) { return Next() % range; }
+private:
+	ieDword state;
+};
+
+/* results are folded into this, so the compiler can't drop the work */
+extern volatile ieDword BenchSink;
+
+}
+
+#endif
@@ -0,0 +1,262 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// the data side: sound decoding, inflating, variables, caches and tables
+
+#include "Bench.h"
+
+#include "Cache.h"
+#include "Compressor.h"
+#include "GameData.h"
+#include "Interface.h"
+#include "PluginMgr.h"
+#include "SoundMgr.h"
+#include "TableMgr.h"
+#include "Variables.h"
+#include "System/MemoryStream.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace GemRB {
+
+// decodes the whole --bench-sound resource (usually an acm) per iteration
+class SoundDecodeBench : public BenchCase {
+public:
+	SoundDecodeBench()
+		: BenchCase("sound/decode"), samples(NULL), length(0) {}
+
+	bool Setup()
+	{
+		if (!BenchConfig.sound) return false;
+		ResourceHolder<SoundMgr> sound(BenchConfig.sound, true);
+		if (!sound) return false;
+		length = sound->get_length();
+		samples = new short[length];
+		return length > 0;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			ResourceHolder<SoundMgr> sound(BenchConfig.sound, true);
+			BenchSink += sound->read_samples(samples, length);
+		}
+	}
+
+	void Teardown()
+	{
+		delete[] samples;
+	}
+private:
+	short *samples;
+	int length;
+};
+
+// inflates a megabyte of bif like data: runs of structures and noise
+class InflateBench : public BenchCase {
+public:
+	InflateBench()
+		: BenchCase("zlib/inflate"), packed(NULL), packedSize(0), unpacked(NULL) {}
+
+	bool Setup()
+	{
+		if (!core->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) return false;
+		comp = PluginHolder<Compressor>(PLUGIN_COMPRESSION_ZLIB);
+
+		BenchRandom random;
+		char *data = (char *) malloc(UnpackedSize);
+		unsigned int pos = 0;
+		while (pos < UnpackedSize) {
+			unsigned int run = random.Next(256) + 1;
+			char value = (char) random.Next(256);
+			bool noise = random.Next(4) == 0;
+			for (; run && pos < UnpackedSize; run--, pos++) {
+				data[pos] = noise ? (char) random.Next(256) : value;
+			}
+		}
+		unsigned int bound = UnpackedSize + UnpackedSize / 10 + 4096;
+		MemoryStream source((char *) "bench", data, UnpackedSize);
+		MemoryStream dest((char *) "bench.z", malloc(bound), bound);
+		if (comp->Compress(&dest, &source) != GEM_OK) {
+			return false;
+		}
+		packedSize = dest.GetPos();
+		packed = (char *) malloc(packedSize);
+		dest.Seek(0, GEM_STREAM_START);
+		dest.Read(packed, packedSize);
+		unpacked = (char *) malloc(UnpackedSize);
+		return true;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			comp->DecompressBuffer(unpacked, UnpackedSize, packed, packedSize);
+			BenchSink += unpacked[i % UnpackedSize];
+		}
+	}
+
+	void Teardown()
+	{
+		free(packed);
+		free(unpacked);
+		comp.release();
+	}
+private:
+	static const unsigned int UnpackedSize = 1024 * 1024;
+	PluginHolder<Compressor> comp;
+	char *packed;
+	unsigned int packedSize;
+	char *unpacked;
+};
+
+#define BENCH_KEYS 2048
+
+// script variable lookups in a game sized dictionary
+class VariablesBench : public BenchCase {
+public:
+	VariablesBench(const char *name, bool set)
+		: BenchCase(name), set(set), vars(NULL) {}
+
+	bool Setup()
+	{
+		vars = new Variables();
+		vars->SetType(GEM_VARIABLES_INT);
+		vars->ParseKey(1);
+		for (int i = 0; i < BENCH_KEYS; i++) {
+			snprintf(keys[i], sizeof(keys[i]), "BENCH_VARIABLE_%d", i);
+			vars->SetAt(keys[i], (ieDword) i);
+		}
+		return true;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		BenchRandom random;
+		for (unsigned int i = 0; i < iterations; i++) {
+			const char *key = keys[random.Next(BENCH_KEYS)];
+			if (set) {
+				vars->SetAt(key, (ieDword) i);
+			} else {
+				ieDword value = 0;
+				vars->Lookup(key, value);
+				BenchSink += value;
+			}
+		}
+	}
+
+	void Teardown()
+	{
+		delete vars;
+	}
+private:
+	bool set;
+	Variables *vars;
+	char keys[BENCH_KEYS][32];
+};
+
+static void ReleaseNothing(void *) {}
+
+// resref lookups, a reference taken and dropped each time
+class CacheBench : public BenchCase {
+public:
+	CacheBench()
+		: BenchCase("cache/lookup"), cache(NULL) {}
+
+	bool Setup()
+	{
+		cache = new Cache(10, 257);
+		for (int i = 0; i < BENCH_KEYS; i++) {
+			snprintf(keys[i], sizeof(ieResRef), "BNC%05d", i);
+			cache->SetAt(keys[i], &values[i]);
+			// unreferenced, as the released resources are
+			cache->DecRef(&values[i], keys[i], false);
+		}
+		return true;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		BenchRandom random;
+		for (unsigned int i = 0; i < iterations; i++) {
+			unsigned int index = random.Next(BENCH_KEYS);
+			void *value = cache->GetResource(keys[index]);
+			cache->DecRef(value, keys[index], false);
+			BenchSink += (ieDword) (value != NULL);
+		}
+	}
+
+	void Teardown()
+	{
+		cache->RemoveAll(ReleaseNothing);
+		delete cache;
+	}
+private:
+	Cache *cache;
+	ieResRef keys[BENCH_KEYS];
+	int values[BENCH_KEYS];
+};
+
+// keymap.2da comes with gemrb, so it is there for every game
+class TableBench : public BenchCase {
+public:
+	TableBench(const char *name, bool byName)
+		: BenchCase(name), byName(byName) {}
+
+	bool Setup()
+	{
+		return table.load("keymap", true) && table->GetRowCount() && table->GetColNamesCount();
+	}
+
+	void Run(unsigned int iterations)
+	{
+		BenchRandom random;
+		ieDword rows = table->GetRowCount();
+		ieDword columns = table->GetColNamesCount();
+		for (unsigned int i = 0; i < iterations; i++) {
+			const char *row = table->GetRowName(random.Next(rows));
+			if (byName) {
+				const char *field = table->QueryField(row, table->GetColumnName(random.Next(columns)));
+				BenchSink += field ? (ieDword) field[0] : 0;
+			} else {
+				BenchSink += (ieDword) table->GetRowIndex(row);
+			}
+		}
+	}
+
+	void Teardown()
+	{
+		table.release();
+	}
+private:
+	bool byName;
+	AutoTable table;
+};
+
+static SoundDecodeBench soundDecode;
+static InflateBench inflate;
+static VariablesBench variablesLookup("variables/lookup", false);
+static VariablesBench variablesSet("variables/set", true);
+static CacheBench cacheLookup;
+static TableBench tableQuery("2da/query-by-name", true);
+static TableBench tableRowIndex("2da/row-index", false);
+
+}
@@ -0,0 +1,122 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// the actor side of the game loop, on the area of the loaded game
+
+#include "Bench.h"
+
+#include "Game.h"
+#include "Interface.h"
+#include "Map.h"
+#include "GameScript/GameScript.h"
+#include "Scriptable/Actor.h"
+
+namespace GemRB {
+
+static void GetAreaActors(std::vector<Actor*> &actors)
+{
+	Game *game = core->GetGame();
+	if (!game) return;
+	Map *area = game->GetMap(game->CurrentArea, false);
+	if (!area) return;
+	int count = area->GetActorCount(true);
+	for (int i = 0; i < count; i++) {
+		actors.push_back(area->GetActor(i, true));
+	}
+}
+
+// RefreshEffects reapplies each actor's whole effect queue
+class EffectsBench : public BenchCase {
+public:
+	EffectsBench()
+		: BenchCase("effects/refresh") {}
+
+	bool Setup()
+	{
+		GetAreaActors(actors);
+		return !actors.empty();
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			Actor *actor = actors[i % actors.size()];
+			actor->RefreshEffects(NULL);
+			BenchSink += actor->GetStat(IE_HITPOINTS);
+		}
+	}
+
+	void Teardown()
+	{
+		actors.clear();
+	}
+private:
+	std::vector<Actor*> actors;
+};
+
+// one evaluation of an actor's scripts, the queued actions are dropped
+// so they don't pile up between the iterations
+class ScriptsBench : public BenchCase {
+public:
+	ScriptsBench()
+		: BenchCase("bcs/evaluate") {}
+
+	bool Setup()
+	{
+		GetAreaActors(actors);
+		for (size_t i = 0; i < actors.size(); i++) {
+			for (int j = 0; j < MAX_SCRIPTS; j++) {
+				if (actors[i]->Scripts[j]) {
+					scripted.push_back(actors[i]);
+					break;
+				}
+			}
+		}
+		actors.clear();
+		return !scripted.empty();
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			Actor *actor = scripted[i % scripted.size()];
+			for (int j = 0; j < MAX_SCRIPTS; j++) {
+				GameScript *script = actor->Scripts[j];
+				if (script && script->Update()) {
+					BenchSink++;
+				}
+			}
+			actor->ClearActions();
+		}
+	}
+
+	void Teardown()
+	{
+		scripted.clear();
+	}
+private:
+	std::vector<Actor*> actors;
+	std::vector<Actor*> scripted;
+};
+
+static EffectsBench effectsRefresh;
+static ScriptsBench scriptsEvaluate;
+
+}
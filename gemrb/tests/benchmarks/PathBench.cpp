@@ -0,0 +1,163 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// path searches on a generated searchmap and on the loaded area's one
+
+#include "Bench.h"
+
+#include "Game.h"
+#include "Interface.h"
+#include "Map.h"
+#include "PathFinder.h"
+#include "SearchMap.h"
+
+namespace GemRB {
+
+#define PATH_PAIRS 64
+
+struct PathPair {
+	Point s, d;
+};
+
+static Point CellCenter(unsigned int x, unsigned int y)
+{
+	return Point((short) (x * 16 + 8), (short) (y * 12 + 6));
+}
+
+// a big outdoor area sized map with random rectangles of walls
+class SyntheticPathBench : public BenchCase {
+public:
+	SyntheticPathBench()
+		: BenchCase("path/synthetic"), cells(NULL), map(NULL), finder(NULL) {}
+
+	bool Setup()
+	{
+		const unsigned int width = 320, height = 320;
+		BenchRandom random;
+		cells = new unsigned short[width * height];
+		for (unsigned int i = 0; i < width * height; i++) {
+			cells[i] = PATH_MAP_PASSABLE;
+		}
+		for (int r = 0; r < 600; r++) {
+			unsigned int x = random.Next(width), y = random.Next(height);
+			unsigned int w = random.Next(12) + 1, h = random.Next(12) + 1;
+			for (unsigned int j = y; j < y + h && j < height; j++) {
+				for (unsigned int i = x; i < x + w && i < width; i++) {
+					cells[j * width + i] = PATH_MAP_IMPASSABLE;
+				}
+			}
+		}
+		map = new SearchMap(cells, width, height, 8);
+		finder = new PathFinder(width, height, 10, 14);
+
+		// only pairs with a path, the unreachable ones would just hit the limits
+		while (pairs.size() < PATH_PAIRS) {
+			PathPair pair;
+			pair.s = CellCenter(random.Next(width), random.Next(height));
+			pair.d = CellCenter(random.Next(width), random.Next(height));
+			if (map->GetBlocked(pair.s.x, pair.s.y, 1) || map->GetBlocked(pair.d.x, pair.d.y, 1)) {
+				continue;
+			}
+			PathNode *path = finder->FindNear(*map, pair.s, pair.d, 1, 0, false);
+			if (!path) continue;
+			PathNode::FreePath(path);
+			pairs.push_back(pair);
+		}
+		return true;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			const PathPair &pair = pairs[i % PATH_PAIRS];
+			PathNode *path = finder->FindNear(*map, pair.s, pair.d, 1, 0, false);
+			BenchSink += path->x;
+			PathNode::FreePath(path);
+		}
+	}
+
+	void Teardown()
+	{
+		pairs.clear();
+		delete finder;
+		delete map;
+		delete[] cells;
+	}
+private:
+	unsigned short *cells;
+	SearchMap *map;
+	PathFinder *finder;
+	std::vector<PathPair> pairs;
+};
+
+// Map::FindPath in the area of the loaded game (--bench-game)
+class AreaPathBench : public BenchCase {
+public:
+	AreaPathBench()
+		: BenchCase("path/area"), area(NULL) {}
+
+	bool Setup()
+	{
+		Game *game = core->GetGame();
+		if (!game) return false;
+		area = game->GetMap(game->CurrentArea, false);
+		if (!area) return false;
+
+		BenchRandom random;
+		unsigned int width = area->GetWidth(), height = area->GetHeight();
+		for (int tries = 0; pairs.size() < PATH_PAIRS && tries < 100000; tries++) {
+			PathPair pair;
+			pair.s = CellCenter(random.Next(width), random.Next(height));
+			pair.d = CellCenter(random.Next(width), random.Next(height));
+			if (area->GetBlocked(pair.s.x, pair.s.y, 1) || area->GetBlocked(pair.d.x, pair.d.y, 1)) {
+				continue;
+			}
+			PathNode *path = area->FindPath(pair.s, pair.d, 1);
+			if (!path) continue;
+			PathNode::FreePath(path);
+			pairs.push_back(pair);
+		}
+		return pairs.size() == PATH_PAIRS;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		for (unsigned int i = 0; i < iterations; i++) {
+			const PathPair &pair = pairs[i % PATH_PAIRS];
+			PathNode *path = area->FindPath(pair.s, pair.d, 1);
+			if (!path) continue;
+			BenchSink += path->x;
+			PathNode::FreePath(path);
+		}
+	}
+
+	void Teardown()
+	{
+		pairs.clear();
+	}
+private:
+	Map *area;
+	std::vector<PathPair> pairs;
+};
+
+static SyntheticPathBench syntheticPath;
+static AreaPathBench areaPath;
+
+}
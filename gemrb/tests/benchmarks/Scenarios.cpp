@@ -0,0 +1,183 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// the end to end scenarios, in the order they run: each one leaves the game
+// as it found it, except for the fights of the last one
+
+#include "Bench.h"
+
+#include "win32def.h" // logging
+
+#include "Game.h"
+#include "GameData.h"
+#include "Interface.h"
+#include "Map.h"
+#include "SaveGameIterator.h"
+#include "GameScript/GameScript.h"
+#include "Scriptable/Actor.h"
+
+namespace GemRB {
+
+#define BENCH_SAVE_SLOT "GemRB-Bench"
+
+static Map *GetCurrentArea()
+{
+	Game *game = core->GetGame();
+	return game->GetMap(game->CurrentArea, false);
+}
+
+// loads --bench-load-area from scratch, it must not be the current one
+class AreaLoadScenario : public BenchScenario {
+public:
+	AreaLoadScenario()
+		: BenchScenario("scenario/area-load") {}
+
+	bool Setup()
+	{
+		return BenchConfig.area && core->GetGame()->FindMap(BenchConfig.area) < 0;
+	}
+
+	bool Run()
+	{
+		return core->GetGame()->LoadMap(BenchConfig.area, false) >= 0;
+	}
+
+	void Teardown()
+	{
+		Game *game = core->GetGame();
+		int index = game->FindMap(BenchConfig.area);
+		if (index >= 0) {
+			game->DelMap(index, true);
+		}
+	}
+};
+
+// saves the game into a slot of its own and loads it back
+class SaveLoadScenario : public BenchScenario {
+public:
+	SaveLoadScenario()
+		: BenchScenario("scenario/save-load") {}
+
+	bool Run()
+	{
+		SaveGameIterator *sgi = core->GetSaveGameIterator();
+		if (sgi->CreateSaveGame(sgi->GetSaveGame(BENCH_SAVE_SLOT), BENCH_SAVE_SLOT)) {
+			return false;
+		}
+		sgi->WaitForSave();
+		Holder<SaveGame> save = sgi->GetSaveGame(BENCH_SAVE_SLOT);
+		return save && core->EnterSavedGame(save);
+	}
+
+	void Teardown()
+	{
+		SaveGameIterator *sgi = core->GetSaveGameIterator();
+		sgi->DeleteSaveGame(sgi->GetSaveGame(BENCH_SAVE_SLOT));
+	}
+};
+
+// opens every window of --bench-window-pack and closes them again
+class WindowPackScenario : public BenchScenario {
+public:
+	WindowPackScenario()
+		: BenchScenario("scenario/window-pack") {}
+
+	bool Setup()
+	{
+		return BenchConfig.windowPack != NULL;
+	}
+
+	bool Run()
+	{
+		if (!core->LoadWindowPack(BenchConfig.windowPack)) {
+			return false;
+		}
+		std::vector<int> opened;
+		for (unsigned short id = 0; id < 100; id++) {
+			int index = core->LoadWindow(id);
+			if (index >= 0) {
+				opened.push_back(index);
+			}
+		}
+		for (size_t i = 0; i < opened.size(); i++) {
+			core->DelWindow((unsigned short) opened[i]);
+		}
+		return !opened.empty();
+	}
+};
+
+// --bench-actors copies of --bench-creature in two teams around the middle
+// of the area: a third of them walks around, the rest fights the other team
+class TicksScenario : public BenchScenario {
+public:
+	TicksScenario()
+		: BenchScenario("scenario/ticks") {}
+
+	bool Setup()
+	{
+		Map *area = GetCurrentArea();
+		if (!BenchConfig.creature || !area) {
+			return false;
+		}
+		BenchRandom random;
+		for (unsigned int i = 0; i < BenchConfig.actors; i++) {
+			Actor *actor = gamedata->GetCreature(BenchConfig.creature);
+			if (!actor) {
+				Teardown();
+				return false;
+			}
+			area->AddActor(actor, true);
+			Point pos((short) (area->GetWidth() * 8 + random.Next(320) - 160),
+				(short) (area->GetHeight() * 6 + random.Next(240) - 120));
+			actor->SetPosition(pos, true, 8, 8);
+			actor->SetBase(IE_EA, i % 2 ? EA_ENEMY : EA_ALLY);
+			Action *action = GenerateAction(i % 3 ? "AttackReevaluate(NearestEnemyOf(Myself),30)" : "RandomWalkContinuous()");
+			if (action) {
+				actor->AddAction(action);
+			}
+			spawned.push_back(actor);
+		}
+		return true;
+	}
+
+	bool Run()
+	{
+		return core->RunTicks(BenchConfig.ticks) == BenchConfig.ticks;
+	}
+
+	void Teardown()
+	{
+		for (size_t i = 0; i < spawned.size(); i++) {
+			spawned[i]->DestroySelf();
+		}
+		spawned.clear();
+		// the area drops them on its next update
+		core->RunTicks(1);
+	}
+private:
+	std::vector<Actor*> spawned;
+};
+
+static AreaLoadScenario areaLoad;
+static SaveLoadScenario saveLoad;
+static WindowPackScenario windowPack;
+static TicksScenario ticks;
+
+}
@@ -0,0 +1,141 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// the sprite and tile blitters, through the configured video driver
+
+#include "Bench.h"
+
+#include "Interface.h"
+#include "Palette.h"
+#include "Sprite2D.h"
+#include "Video.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace GemRB {
+
+// random 8 bit pixels, a tenth of them transparent
+static Sprite2D *CreateNoiseSprite(Video *video, int w, int h, bool colorKey)
+{
+	BenchRandom random((ieDword) (w * h));
+	unsigned char *pixels = (unsigned char *) malloc(w * h);
+	for (int i = 0; i < w * h; i++) {
+		pixels[i] = (unsigned char) random.Next(256);
+		if (colorKey && random.Next(10) == 0) {
+			pixels[i] = 0;
+		}
+	}
+	Palette *palette = new Palette();
+	for (int i = 0; i < 256; i++) {
+		palette->col[i].r = (unsigned char) random.Next(256);
+		palette->col[i].g = (unsigned char) random.Next(256);
+		palette->col[i].b = (unsigned char) random.Next(256);
+		palette->col[i].a = 255;
+	}
+	Sprite2D *sprite = video->CreateSprite8(w, h, pixels, palette, colorKey, 0);
+	palette->release();
+	return sprite;
+}
+
+static bool HaveVideo()
+{
+	return core->GetVideoDriver() && stricmp(core->GetVideoDriverName(), "none");
+}
+
+// creature sized sprites all over the screen, as the area draws them
+class SpriteBlitBench : public BenchCase {
+public:
+	SpriteBlitBench(const char *name, unsigned int flags)
+		: BenchCase(name), flags(flags), sprite(NULL) {}
+
+	bool Setup()
+	{
+		if (!HaveVideo()) return false;
+		video = core->GetVideoDriver();
+		sprite = CreateNoiseSprite(video, 96, 128, true);
+		return sprite != NULL;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		Color tint = { 255, 160, 96, 255 };
+		int w = video->GetWidth() - sprite->Width;
+		int h = video->GetHeight() - sprite->Height;
+		for (unsigned int i = 0; i < iterations; i++) {
+			video->BlitGameSprite(sprite, (int) (i * 37) % w, (int) (i * 23) % h, flags, tint, NULL);
+		}
+	}
+
+	void Teardown()
+	{
+		Sprite2D::FreeSprite(sprite);
+	}
+private:
+	unsigned int flags;
+	Video *video;
+	Sprite2D *sprite;
+};
+
+// 64x64 area tiles laid out in a grid
+class TileBlitBench : public BenchCase {
+public:
+	TileBlitBench(const char *name, unsigned int flags)
+		: BenchCase(name), flags(flags), tile(NULL) {}
+
+	bool Setup()
+	{
+		if (!HaveVideo()) return false;
+		video = core->GetVideoDriver();
+		tile = CreateNoiseSprite(video, 64, 64, false);
+		return tile != NULL;
+	}
+
+	void Run(unsigned int iterations)
+	{
+		int columns = video->GetWidth() / 64;
+		int rows = video->GetHeight() / 64;
+		if (columns < 1) columns = 1;
+		if (rows < 1) rows = 1;
+		for (unsigned int i = 0; i < iterations; i++) {
+			int cell = (int) (i % (columns * rows));
+			video->BlitTile(tile, NULL, (cell % columns) * 64, (cell / columns) * 64, NULL, flags);
+		}
+	}
+
+	void Teardown()
+	{
+		Sprite2D::FreeSprite(tile);
+	}
+private:
+	unsigned int flags;
+	Video *video;
+	Sprite2D *tile;
+};
+
+static SpriteBlitBench spriteBlit("blit/sprite", 0);
+static SpriteBlitBench spriteBlitTinted("blit/sprite-tinted", BLIT_TINTED);
+static SpriteBlitBench spriteBlitHalfTrans("blit/sprite-halftrans-mirror", BLIT_HALFTRANS|BLIT_MIRRORX);
+static SpriteBlitBench spriteBlitGrey("blit/sprite-grey", BLIT_GREY);
+static TileBlitBench tileBlit("blit/tile", 0);
+static TileBlitBench tileBlitHalfTrans("blit/tile-halftrans", TILE_HALFTRANS);
+static TileBlitBench tileBlitGrey("blit/tile-grey", TILE_GREY);
+
+}
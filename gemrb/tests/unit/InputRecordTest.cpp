@@ -0,0 +1,89 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// records a few frames of input and plays them back
+
+#include "Test.h"
+
+#include "InputRecord.h"
+#include "Interface.h"
+#include "Video.h"
+#include "GUI/EventMgr.h"
+#include "System/VFS.h"
+
+#include <cstdio>
+
+namespace GemRB {
+
+#define RECORD_FRAMES 3
+
+class InputRecordTest : public TestCase {
+public:
+	InputRecordTest() : TestCase("input/round-trip") {}
+
+	bool Run()
+	{
+		EventMgr *evntmgr = core->GetEventMgr();
+		Video *video = core->GetVideoDriver();
+		if (!Check(evntmgr && video, "the engine has input and video")) {
+			return false;
+		}
+		char path[_MAX_PATH];
+		PathJoin(path, core->CachePath, "test.rec", NULL);
+
+		// each frame gets a mouse move, the game rolls a die in each
+		int rolls[RECORD_FRAMES];
+		unsigned long ticks[RECORD_FRAMES];
+		if (!Check(InputRecord::StartRecording(path, 10), "the recording starts")) {
+			return false;
+		}
+		for (int i = 0; i < RECORD_FRAMES; i++) {
+			InputRecord::BeginFrame(evntmgr);
+			evntmgr->MouseMove((unsigned short) (100 + i), (unsigned short) (50 + i));
+			rolls[i] = core->Roll(1, 1000000, 0);
+			ticks[i] = InputRecord::GetTicks();
+		}
+		InputRecord::Stop();
+
+		bool passed = Check(InputRecord::StartReplay(path), "the replay starts");
+		if (!passed) {
+			return false;
+		}
+		video->SetCursorPos(0, 0);
+		for (int i = 0; i < RECORD_FRAMES; i++) {
+			InputRecord::BeginFrame(evntmgr);
+			int x, y;
+			video->GetMousePos(x, y);
+			passed &= Check(x == 100 + i && y == 50 + i, "the frame's mouse move is replayed");
+			passed &= Check(rolls[i] == core->Roll(1, 1000000, 0), "the dice roll the same");
+			passed &= Check(ticks[i] == InputRecord::GetTicks(), "the frame clock is the same");
+		}
+		passed &= Check(!InputRecord::Accept(INPUT_KEYPRESS, 'a'), "the live input is ignored");
+		InputRecord::Stop();
+		passed &= Check(!InputRecord::IsActive(), "the replay stops");
+
+		remove(path);
+		return passed;
+	}
+};
+
+static InputRecordTest inputRecord;
+
+}
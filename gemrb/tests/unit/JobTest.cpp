@@ -0,0 +1,78 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// the jobs wanted right away and the ones dropped before they start
+
+#include "Test.h"
+
+#include "JobSystem.h"
+
+namespace GemRB {
+
+class CountJob : public Job {
+public:
+	CountJob(JobPriority priority) : Job("CountJob", priority), runs(0), runner(Thread::GetCurrentID()) {}
+	int runs;
+	ThreadID runner;
+protected:
+	void Run()
+	{
+		runs++;
+		runner = Thread::GetCurrentID();
+	}
+};
+
+// no worker runs anything before Update, so everything stays queued
+class JobClaimTest : public TestCase {
+public:
+	JobClaimTest() : TestCase("jobs/claim") {}
+
+	bool Run()
+	{
+		JobSystem jobs(0);
+		bool passed = true;
+
+		Holder<CountJob> waited(new CountJob(JOB_BACKGROUND));
+		Holder<CountJob> cancelled(new CountJob(JOB_FRAME));
+		Holder<CountJob> other(new CountJob(JOB_FRAME));
+		jobs.Submit(waited.get());
+		jobs.Submit(cancelled.get());
+		jobs.Submit(other.get());
+
+		jobs.Wait(waited.get());
+		passed &= Check(waited->runs == 1, "Wait runs the queued job");
+		passed &= Check(Thread::IsSameThread(waited->runner, Thread::GetCurrentID()), "Wait runs it on the caller");
+		passed &= Check(other->runs == 0, "Wait runs the one asked for first");
+
+		passed &= Check(jobs.Cancel(cancelled.get()), "Cancel takes a queued job");
+		passed &= Check(cancelled->IsDone(), "a cancelled job counts as done");
+		jobs.Wait(cancelled.get());
+		passed &= Check(!jobs.Cancel(waited.get()), "Cancel leaves the finished ones");
+
+		jobs.Update();
+		passed &= Check(other->runs == 1, "Update runs the frame jobs left");
+		passed &= Check(cancelled->runs == 0, "the cancelled job never runs");
+		return passed;
+	}
+};
+
+static JobClaimTest jobClaimTest;
+
+}
@@ -0,0 +1,86 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// path searches towards goals that can or can't be reached
+
+#include "Test.h"
+
+#include "PathFinder.h"
+#include "SearchMap.h"
+
+namespace GemRB {
+
+static Point CellCenter(unsigned int x, unsigned int y)
+{
+	return Point((short) (x * 16 + 8), (short) (y * 12 + 6));
+}
+
+// a big open map with the goal walled in, so it can't be reached
+class UnreachablePathTest : public TestCase {
+public:
+	UnreachablePathTest() : TestCase("path/unreachable") {}
+
+	bool Run()
+	{
+		const unsigned int width = 400, height = 400;
+		unsigned short *cells = new unsigned short[width * height];
+		for (unsigned int i = 0; i < width * height; i++) {
+			cells[i] = PATH_MAP_PASSABLE;
+		}
+		for (unsigned int j = 196; j <= 204; j++) {
+			for (unsigned int i = 196; i <= 204; i++) {
+				if (i == 196 || i == 204 || j == 196 || j == 204) {
+					cells[j * width + i] = PATH_MAP_IMPASSABLE;
+				}
+			}
+		}
+		SearchMap map(cells, width, height, 8);
+		PathFinder finder(width, height, 10, 14);
+		bool passed = true;
+
+		PathNode *path = finder.FindNear(map, CellCenter(10, 10), CellCenter(200, 200), 1, 0, false);
+		passed &= Check(path && !path->Next && path->x == 10 && path->y == 10, "FindNear stays at the start");
+		passed &= Check(finder.GetClosedCount() < width * height / 2, "FindNear doesn't flood the map");
+		PathNode::FreePath(path);
+
+		PathNode *tail = new PathNode;
+		tail->Parent = tail->Next = NULL;
+		// Trace searches from its goal, so start in the walls for the flood
+		passed &= Check(!finder.Trace(map, tail, Point(200, 200), Point(10, 10), 1, 0), "Trace finds no path");
+		passed &= Check(finder.GetClosedCount() < width * height / 2, "Trace doesn't flood the map");
+		PathNode::FreePath(tail);
+
+		// the limits mustn't get in the way of a long path that exists
+		path = finder.FindNear(map, CellCenter(10, 10), CellCenter(390, 390), 1, 0, false);
+		PathNode *end = path;
+		while (end && end->Next) {
+			end = end->Next;
+		}
+		passed &= Check(end && end->x == 390 && end->y == 390, "FindNear reaches the open corner");
+		PathNode::FreePath(path);
+
+		delete[] cells;
+		return passed;
+	}
+};
+
+static UnreachablePathTest unreachablePath;
+
+}
@@ -0,0 +1,115 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+// gemrb_test: runs the checks on the engine started with the given config,
+// fails if any of them does
+
+#include "Test.h"
+
+#include "win32def.h" // logging
+
+#include "Interface.h"
+#include "InterfaceConfig.h"
+#include "System/VFS.h"
+
+#include <cstring>
+#include <string>
+
+using namespace GemRB;
+
+namespace GemRB {
+
+TestCase::TestCase(const char *name)
+	: name(name)
+{
+	GetAll().push_back(this);
+}
+
+std::vector<TestCase*> &TestCase::GetAll()
+{
+	static std::vector<TestCase*> cases;
+	return cases;
+}
+
+bool TestCase::Check(bool condition, const char *what) const
+{
+	if (!condition) {
+		Log(ERROR, "Test", "%s: failed check '%s'.", name, what);
+	}
+	return condition;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const char *filter = NULL;
+
+	// take our options out, the rest is for the config (-c, --Key=Value)
+	std::vector<char*> args;
+	// look for gemrb.cfg, not gemrb_test.cfg
+	std::string appName(argv[0]);
+	size_t slash = appName.rfind(PathDelimiter);
+	appName.replace(slash == std::string::npos ? 0 : slash + 1, std::string::npos, "gemrb");
+	args.push_back(&appName[0]);
+	for (int i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "--test-filter=", 14)) {
+			filter = argv[i] + 14;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	args.push_back(NULL);
+
+	Interface::SanityCheck(VERSION_GEMRB);
+	InitializeLogging();
+
+	core = new Interface();
+	CFGConfig* config = new CFGConfig((int) args.size() - 1, &args[0]);
+	if (core->Init( config ) == GEM_ERROR) {
+		delete config;
+		delete( core );
+		Log(MESSAGE, "Test", "Aborting due to fatal error...");
+		ShutdownLogging();
+		return -1;
+	}
+	delete config;
+
+	int failed = 0;
+	std::vector<TestCase*> &cases = TestCase::GetAll();
+	for (size_t i = 0; i < cases.size(); i++) {
+		TestCase *test = cases[i];
+		if (filter && !strstr(test->GetName(), filter)) {
+			continue;
+		}
+		bool passed = test->Run();
+		Log(passed ? MESSAGE : ERROR, "Test", "%-28s %s", test->GetName(), passed ? "passed" : "FAILED");
+		if (!passed) {
+			failed++;
+		}
+	}
+
+	if (failed) {
+		Log(ERROR, "Test", "%d checks failed.", failed);
+	}
+	delete( core );
+	ShutdownLogging();
+	return failed ? 1 : 0;
+}
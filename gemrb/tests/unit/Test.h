@@ -0,0 +1,50 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef TEST_H
+#define TEST_H
+
+#include <vector>
+
+namespace GemRB {
+
+/* A check: Run() returns false if it failed, Check() logs the expectations
+ * that didn't hold. The cases register themselves by being constructed,
+ * just like the benchmarks, so each one is a static instance in one of the
+ * test sources.
+ */
+class TestCase {
+public:
+	TestCase(const char *name);
+	virtual ~TestCase() {}
+
+	virtual bool Run() = 0;
+
+	const char *GetName() const { return name; }
+	static std::vector<TestCase*> &GetAll();
+protected:
+	/* logs what when condition doesn't hold, returns condition */
+	bool Check(bool condition, const char *what) const;
+private:
+	const char *name;
+};
+
+}
+
+#endif